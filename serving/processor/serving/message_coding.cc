@@ -1,6 +1,7 @@
 #include "serving/processor/serving/model_message.h"
 #include "serving/processor/serving/message_coding.h"
 #include "serving/processor/serving/util.h"
+#include "tensorflow/core/platform/protobuf.h"
 
 namespace tensorflow {
 namespace processor {
@@ -12,7 +13,12 @@ ProtoBufParser::ProtoBufParser(int thread_num) {
 Status ProtoBufParser::ParseRequestFromBuf(
     const void* input_data, int input_size, Call& call,
     const SignatureInfo* signature_info) {
-  eas::PredictRequest request;
+  // Decode on an arena: a request holds one map node and one string
+  // per feature, and arena allocation turns those per-field mallocs
+  // into pointer bumps freed in one shot when parsing is done.
+  protobuf::Arena arena;
+  eas::PredictRequest& request =
+      *protobuf::Arena::CreateMessage<eas::PredictRequest>(&arena);
   request.ParseFromArray(input_data, input_size);
 
   for (auto& input : request.inputs()) {
@@ -47,8 +53,15 @@ Status ProtoBufParser::ParseRequestFromBuf(
 Status ProtoBufParser::ParseResponseToBuf(
     const Call& call, void** output_data, int* output_size,
     const SignatureInfo* signature_info) {
-  eas::PredictResponse response = util::Tensor2Response(call.request,
-      call.response, signature_info);
+  // Encode on an arena as on the request side: the response map nodes
+  // and per-output ArrayProtos otherwise cost a malloc/free pair each
+  // per request, and the arena releases them wholesale once the
+  // response is serialized.
+  protobuf::Arena arena;
+  eas::PredictResponse& response =
+      *protobuf::Arena::CreateMessage<eas::PredictResponse>(&arena);
+  util::Tensor2Response(call.request, call.response, signature_info,
+                        &response);
   *output_size = response.ByteSize();
   *output_data = new char[*output_size];
   response.SerializeToArray(*output_data, *output_size);
@@ -62,10 +75,12 @@ Status ProtoBufParser::ParseBatchRequestFromBuf(
   call.call_num = size;
   auto do_work = [&call, input_data, input_size,
                   signature_info](size_t begin, size_t end) {
+    protobuf::Arena arena;
     for (size_t i = begin; i < end; ++i) {
-      eas::PredictRequest request;
+      eas::PredictRequest& request =
+          *protobuf::Arena::CreateMessage<eas::PredictRequest>(&arena);
       request.ParseFromArray(input_data[i], input_size[i]);
-      
+
       for (auto& input : request.inputs()) {
         if (signature_info->input_key_idx.find(input.first) ==
             signature_info->input_key_idx.end()) {
@@ -107,12 +122,15 @@ Status ProtoBufParser::ParseBatchResponseToBuf(
   call.SplitResponse();
   auto do_work = [&call, output_data, output_size,
 	              signature_info](size_t begin, size_t end) {
+    protobuf::Arena arena;
     for (size_t i = begin; i < end; ++i) {
-      eas::PredictResponse response = util::Tensor2Response(call.request[i],
-          call.response[i], signature_info);
+      eas::PredictResponse& response =
+          *protobuf::Arena::CreateMessage<eas::PredictResponse>(&arena);
+      util::Tensor2Response(call.request[i], call.response[i], signature_info,
+                            &response);
       output_size[i] = response.ByteSize();
       output_data[i] = new char[*output_size];
-      response.SerializeToArray(output_data[i], output_size[i]); 
+      response.SerializeToArray(output_data[i], output_size[i]);
     }
   };
   thread_pool_->ParallelFor(call.call_num, 10000, do_work);
@@ -0,0 +1,189 @@
+#include <chrono>
+#include <cstring>
+
+#include "serving/processor/serving/micro_batcher.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/types.h"
+
+namespace tensorflow {
+namespace processor {
+namespace {
+
+// The batch dimension of a request: dim 0 shared by all of its
+// inputs, or -1 when the inputs disagree (then it can't be merged).
+int64 RequestBatchDim(const Request& req) {
+  if (req.inputs.empty()) return -1;
+  int64 dim = -1;
+  for (auto& input : req.inputs) {
+    const Tensor& t = input.second;
+    if (t.dims() == 0) return -1;
+    if (dim == -1) {
+      dim = t.dim_size(0);
+    } else if (dim != t.dim_size(0)) {
+      return -1;
+    }
+  }
+  return dim;
+}
+
+// Two requests can merge when every input lines up pairwise: same
+// name, same dtype the raw copy can handle, same non-batch dims, and
+// the same output filter.
+bool CanMerge(const Request& lhs, const Request& rhs) {
+  if (lhs.inputs.size() != rhs.inputs.size() ||
+      lhs.output_tensor_names != rhs.output_tensor_names) {
+    return false;
+  }
+  for (size_t i = 0; i < lhs.inputs.size(); ++i) {
+    if (lhs.inputs[i].first != rhs.inputs[i].first) return false;
+    const Tensor& a = lhs.inputs[i].second;
+    const Tensor& b = rhs.inputs[i].second;
+    if (a.dtype() != b.dtype() ||
+        !DataTypeCanUseMemcpy(a.dtype()) ||
+        a.dims() != b.dims()) {
+      return false;
+    }
+    for (int d = 1; d < a.dims(); ++d) {
+      if (a.dim_size(d) != b.dim_size(d)) return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+MicroBatcher::MicroBatcher(PredictFn predict_fn, int max_batch_size,
+                           int window_micros)
+    : predict_fn_(std::move(predict_fn)),
+      max_batch_size_(max_batch_size),
+      window_micros_(window_micros) {
+}
+
+Status MicroBatcher::Predict(Request& req, Response& resp) {
+  PendingCall call;
+  call.req = &req;
+  call.resp = &resp;
+
+  std::unique_lock<std::mutex> lock(mu_);
+  pending_.push_back(&call);
+  if (pending_.size() == 1) {
+    // Leader: give followers a window to arrive.
+    leader_cv_.wait_for(lock, std::chrono::microseconds(window_micros_),
+        [this] {
+          return pending_.size() >=
+                 static_cast<size_t>(max_batch_size_);
+        });
+    std::vector<PendingCall*> batch;
+    batch.swap(pending_);
+    lock.unlock();
+
+    RunBatch(batch);
+
+    lock.lock();
+    for (PendingCall* c : batch) {
+      c->done = true;
+    }
+    done_cv_.notify_all();
+    return call.status;
+  }
+
+  if (pending_.size() >= static_cast<size_t>(max_batch_size_)) {
+    leader_cv_.notify_one();
+  }
+  done_cv_.wait(lock, [&call] { return call.done; });
+  return call.status;
+}
+
+void MicroBatcher::RunBatch(std::vector<PendingCall*>& batch) {
+  if (batch.size() == 1) {
+    batch[0]->status = predict_fn_(*batch[0]->req, *batch[0]->resp);
+    return;
+  }
+
+  bool mergeable = true;
+  for (PendingCall* c : batch) {
+    mergeable = mergeable && RequestBatchDim(*c->req) > 0;
+  }
+  for (size_t i = 1; mergeable && i < batch.size(); ++i) {
+    mergeable = CanMerge(*batch[0]->req, *batch[i]->req);
+  }
+
+  if (mergeable && RunMerged(batch)) {
+    return;
+  }
+
+  for (PendingCall* c : batch) {
+    c->status = predict_fn_(*c->req, *c->resp);
+  }
+}
+
+bool MicroBatcher::RunMerged(std::vector<PendingCall*>& batch) {
+  int64 total_rows = 0;
+  for (PendingCall* c : batch) {
+    total_rows += RequestBatchDim(*c->req);
+  }
+
+  // Concatenate every input along dim 0.
+  Request merged;
+  merged.output_tensor_names = batch[0]->req->output_tensor_names;
+  for (size_t i = 0; i < batch[0]->req->inputs.size(); ++i) {
+    const Tensor& first = batch[0]->req->inputs[i].second;
+    TensorShape shape = first.shape();
+    shape.set_dim(0, total_rows);
+    Tensor merged_tensor(first.dtype(), shape);
+    char* dst = const_cast<char*>(merged_tensor.tensor_data().data());
+    for (PendingCall* c : batch) {
+      const Tensor& t = c->req->inputs[i].second;
+      memcpy(dst, t.tensor_data().data(), t.tensor_data().size());
+      dst += t.tensor_data().size();
+    }
+    merged.inputs.emplace_back(batch[0]->req->inputs[i].first,
+                               merged_tensor);
+  }
+
+  Response merged_resp;
+  Status s = predict_fn_(merged, merged_resp);
+  if (!s.ok()) {
+    // The whole step failed, every caller gets the same status.
+    for (PendingCall* c : batch) {
+      c->status = s;
+    }
+    return true;
+  }
+
+  // An output without the batch dimension (e.g. a reduced scalar)
+  // can't be split back per request; rerun unbatched in that case.
+  for (const Tensor& out : merged_resp.outputs) {
+    if (!DataTypeCanUseMemcpy(out.dtype()) || out.dims() == 0 ||
+        out.dim_size(0) != total_rows) {
+      return false;
+    }
+  }
+
+  std::vector<const char*> src(merged_resp.outputs.size());
+  std::vector<size_t> row_bytes(merged_resp.outputs.size());
+  for (size_t j = 0; j < merged_resp.outputs.size(); ++j) {
+    src[j] = merged_resp.outputs[j].tensor_data().data();
+    row_bytes[j] = merged_resp.outputs[j].tensor_data().size() /
+                   total_rows;
+  }
+
+  for (PendingCall* c : batch) {
+    int64 rows = RequestBatchDim(*c->req);
+    for (size_t j = 0; j < merged_resp.outputs.size(); ++j) {
+      const Tensor& out = merged_resp.outputs[j];
+      TensorShape shape = out.shape();
+      shape.set_dim(0, rows);
+      Tensor slice(out.dtype(), shape);
+      memcpy(const_cast<char*>(slice.tensor_data().data()),
+             src[j], rows * row_bytes[j]);
+      src[j] += rows * row_bytes[j];
+      c->resp->outputs.emplace_back(slice);
+    }
+    c->status = Status::OK();
+  }
+  return true;
+}
+
+} // processor
+} // tensorflow
@@ -0,0 +1,59 @@
+#ifndef SERVING_PROCESSOR_SERVING_MICRO_BATCHER_H
+#define SERVING_PROCESSOR_SERVING_MICRO_BATCHER_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "serving/processor/serving/model_message.h"
+#include "tensorflow/core/lib/core/status.h"
+
+namespace tensorflow {
+namespace processor {
+
+// Merges prediction requests that arrive within a short window into
+// one session step along the batch dimension and splits the outputs
+// back, so the device runs fewer, larger batches.
+//
+// The first request of a batch becomes the leader: it waits up to
+// window_micros for followers (or until max_batch_size requests are
+// pending), runs the merged step and hands every follower its slice.
+// Requests that can't be merged (mismatched non-batch dims, differing
+// output filters or dtypes the raw copy can't handle) run one by one.
+class MicroBatcher {
+ public:
+  typedef std::function<Status(Request&, Response&)> PredictFn;
+
+  MicroBatcher(PredictFn predict_fn, int max_batch_size,
+               int window_micros);
+
+  Status Predict(Request& req, Response& resp);
+
+ private:
+  struct PendingCall {
+    Request* req = nullptr;
+    Response* resp = nullptr;
+    Status status;
+    bool done = false;
+  };
+
+  void RunBatch(std::vector<PendingCall*>& batch);
+  // Returns false when the batch has to fall back to per-request
+  // execution, e.g. the merged outputs don't carry the batch dim.
+  bool RunMerged(std::vector<PendingCall*>& batch);
+
+  PredictFn predict_fn_;
+  int max_batch_size_;
+  int window_micros_;
+
+  std::mutex mu_;
+  std::condition_variable leader_cv_;
+  std::condition_variable done_cv_;
+  std::vector<PendingCall*> pending_;
+};
+
+} // processor
+} // tensorflow
+
+#endif // SERVING_PROCESSOR_SERVING_MICRO_BATCHER_H
@@ -0,0 +1,114 @@
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "serving/processor/serving/micro_batcher.h"
+#include "tensorflow/core/framework/tensor.h"
+
+namespace tensorflow {
+namespace processor {
+namespace {
+
+Request MakeRequest(const std::vector<float>& rows, int64 row_width) {
+  Request req;
+  int64 num_rows = rows.size() / row_width;
+  Tensor t(DT_FLOAT, TensorShape({num_rows, row_width}));
+  auto flat = t.flat<float>();
+  for (int64 i = 0; i < flat.size(); ++i) {
+    flat(i) = rows[i];
+  }
+  req.inputs.emplace_back("input", t);
+  req.output_tensor_names.emplace_back("output");
+  return req;
+}
+
+// Echoes the first input as the only output.
+Status EchoPredict(Request& req, Response& resp) {
+  resp.outputs.emplace_back(req.inputs[0].second);
+  return Status::OK();
+}
+
+} // namespace
+
+class MicroBatcherTest : public ::testing::Test {
+};
+
+TEST_F(MicroBatcherTest, SingleRequestRunsUnbatched) {
+  MicroBatcher batcher(EchoPredict, /*max_batch_size*/4,
+                       /*window_micros*/1000);
+  Request req = MakeRequest({1.0, 2.0}, 2);
+  Response resp;
+  EXPECT_TRUE(batcher.Predict(req, resp).ok());
+  ASSERT_EQ(1, resp.outputs.size());
+  EXPECT_EQ(1, resp.outputs[0].dim_size(0));
+  EXPECT_EQ(1.0, resp.outputs[0].flat<float>()(0));
+  EXPECT_EQ(2.0, resp.outputs[0].flat<float>()(1));
+}
+
+TEST_F(MicroBatcherTest, ConcurrentRequestsGetTheirOwnRowsBack) {
+  int merged_steps = 0;
+  MicroBatcher batcher(
+      [&merged_steps](Request& req, Response& resp) {
+        if (req.inputs[0].second.dim_size(0) > 1) {
+          ++merged_steps;
+        }
+        return EchoPredict(req, resp);
+      },
+      /*max_batch_size*/2, /*window_micros*/2000000);
+
+  Request req1 = MakeRequest({1.0, 2.0}, 2);
+  Request req2 = MakeRequest({3.0, 4.0}, 2);
+  Response resp1, resp2;
+  Status s1, s2;
+
+  std::thread t1([&] { s1 = batcher.Predict(req1, resp1); });
+  std::thread t2([&] { s2 = batcher.Predict(req2, resp2); });
+  t1.join();
+  t2.join();
+
+  EXPECT_TRUE(s1.ok());
+  EXPECT_TRUE(s2.ok());
+  ASSERT_EQ(1, resp1.outputs.size());
+  ASSERT_EQ(1, resp2.outputs.size());
+  EXPECT_EQ(1, resp1.outputs[0].dim_size(0));
+  EXPECT_EQ(1, resp2.outputs[0].dim_size(0));
+  // Each caller got its own rows, whichever of them led the batch.
+  float first1 = resp1.outputs[0].flat<float>()(0);
+  float first2 = resp2.outputs[0].flat<float>()(0);
+  EXPECT_EQ(1.0, first1);
+  EXPECT_EQ(2.0, resp1.outputs[0].flat<float>()(1));
+  EXPECT_EQ(3.0, first2);
+  EXPECT_EQ(4.0, resp2.outputs[0].flat<float>()(1));
+  EXPECT_EQ(1, merged_steps);
+}
+
+TEST_F(MicroBatcherTest, MismatchedShapesFallBackToPerRequestRuns) {
+  int steps = 0;
+  MicroBatcher batcher(
+      [&steps](Request& req, Response& resp) {
+        ++steps;
+        return EchoPredict(req, resp);
+      },
+      /*max_batch_size*/2, /*window_micros*/2000000);
+
+  Request req1 = MakeRequest({1.0, 2.0}, 2);
+  Request req2 = MakeRequest({3.0, 4.0, 5.0}, 3);
+  Response resp1, resp2;
+  Status s1, s2;
+
+  std::thread t1([&] { s1 = batcher.Predict(req1, resp1); });
+  std::thread t2([&] { s2 = batcher.Predict(req2, resp2); });
+  t1.join();
+  t2.join();
+
+  EXPECT_TRUE(s1.ok());
+  EXPECT_TRUE(s2.ok());
+  EXPECT_EQ(2, steps);
+  ASSERT_EQ(1, resp1.outputs.size());
+  EXPECT_EQ(2, resp1.outputs[0].dim_size(1));
+  ASSERT_EQ(1, resp2.outputs.size());
+  EXPECT_EQ(3, resp2.outputs[0].dim_size(1));
+}
+
+} // processor
+} // tensorflow
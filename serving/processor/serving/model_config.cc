@@ -1,5 +1,7 @@
 #include <stdlib.h>
 
+#include <algorithm>
+
 #include "serving/processor/serving/model_config.h"
 #include "serving/processor/serving/tracer.h"
 #include "include/json/json.h"
@@ -61,6 +63,21 @@ Status ModelConfigFactory::Create(const char* model_config, ModelConfig** config
     (*config)->session_num = 1;
   }
 
+  if (!json_config["micro_batch_max_size"].isNull()) {
+    (*config)->micro_batch_max_size =
+      json_config["micro_batch_max_size"].asInt();
+  }
+
+  if (!json_config["micro_batch_window_micros"].isNull()) {
+    (*config)->micro_batch_window_micros =
+      json_config["micro_batch_window_micros"].asInt();
+  }
+
+  if (!json_config["shed_deadline_micros"].isNull()) {
+    (*config)->shed_deadline_micros =
+      json_config["shed_deadline_micros"].asInt();
+  }
+
   (*config)->select_session_policy = "MOD";
   if (!json_config["select_session_policy"].isNull()) {
     (*config)->select_session_policy =
@@ -140,6 +157,13 @@ Status ModelConfigFactory::Create(const char* model_config, ModelConfig** config
     (*config)->warmup_file_name = "";
   }
 
+  if (!json_config["warmup_memory_planner_steps"].isNull()) {
+    (*config)->warmup_memory_planner_steps =
+      json_config["warmup_memory_planner_steps"].asInt();
+  } else {
+    (*config)->warmup_memory_planner_steps = 0;
+  }
+
   if (!json_config["serialize_protocol"].isNull()) {
     (*config)->serialize_protocol =
       json_config["serialize_protocol"].asString();
@@ -163,6 +187,21 @@ Status ModelConfigFactory::Create(const char* model_config, ModelConfig** config
                  << "processor only load saved model.";
   }
 
+  if (!json_config["shared_storage_update"].isNull()) {
+    (*config)->shared_storage_update =
+      json_config["shared_storage_update"].asBool();
+  }
+
+  if (!json_config["prefault_standby_pages"].isNull()) {
+    (*config)->prefault_standby_pages =
+      json_config["prefault_standby_pages"].asBool();
+  }
+
+  if (!json_config["reuse_lookup_resources"].isNull()) {
+    (*config)->reuse_lookup_resources =
+      json_config["reuse_lookup_resources"].asBool();
+  }
+
   if (!json_config["savedmodel_dir"].isNull()) {
     (*config)->savedmodel_dir =
       json_config["savedmodel_dir"].asString();
@@ -219,6 +258,21 @@ Status ModelConfigFactory::Create(const char* model_config, ModelConfig** config
     } else {
       (*config)->update_thread_num = 2;
     }
+
+    if (!json_config["redis_pipeline_size"].isNull()) {
+      (*config)->redis_pipeline_size =
+        json_config["redis_pipeline_size"].asInt();
+    }
+
+    if (!json_config["feature_cache_size"].isNull()) {
+      (*config)->feature_cache_size =
+        json_config["feature_cache_size"].asInt();
+    }
+
+    if (!json_config["feature_cache_ttl_seconds"].isNull()) {
+      (*config)->feature_cache_ttl_seconds =
+        json_config["feature_cache_ttl_seconds"].asInt();
+    }
   }
 
   if (!json_config["model_store_type"].isNull()) {
@@ -307,6 +361,32 @@ Status ModelConfigFactory::Create(const char* model_config, ModelConfig** config
         json_config["use_per_session_threads"].asBool();
   }
 
+  if (!json_config["shared_nothing_lanes"].isNull()) {
+    (*config)->shared_nothing_lanes =
+        json_config["shared_nothing_lanes"].asInt();
+  }
+  if ((*config)->shared_nothing_lanes > 0) {
+    // Shared-nothing lane mode: one session per lane with a private
+    // thread pool and least-loaded steering. One big shared pool stops
+    // scaling past ~64 cores, where cross-core pool contention eats
+    // throughput-per-core.
+    (*config)->session_num = (*config)->shared_nothing_lanes;
+    (*config)->use_per_session_threads = true;
+    (*config)->select_session_policy = "LANE";
+    if (json_config["inter_op_parallelism_threads"].isNull()) {
+      (*config)->inter_threads = 1;
+    }
+    if (json_config["intra_op_parallelism_threads"].isNull()) {
+      (*config)->intra_threads = std::max<int>(
+          1, static_cast<int>(
+                 schedule_threads / (*config)->shared_nothing_lanes));
+    }
+    LOG(INFO) << "[TensorFlow] Shared-nothing serving enabled: "
+              << (*config)->shared_nothing_lanes << " lanes, "
+              << (*config)->inter_threads << " inter / "
+              << (*config)->intra_threads << " intra threads per lane.";
+  }
+
   (*config)->shard_embedding = false;
   bool shard_embedding = false;
   if (!json_config["shard_embedding"].isNull()) {
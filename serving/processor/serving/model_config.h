@@ -11,10 +11,37 @@ struct ModelConfig {
 
   // Model Info
   bool enable_incr_model_update = true;
+  // Restore a new full checkpoint into the serving session group
+  // instead of building a new one, so the new version's EmbeddingVars
+  // attach to the storage the previous version already holds. Avoids
+  // doubling memory during the switch; requests served while the
+  // restore runs may see a mix of both versions, the same semantics
+  // as the existing delta model update.
+  bool shared_storage_update = false;
+  // Sequentially read every file of the next model version before it
+  // is restored and swapped in, so rollouts serve from a warm page
+  // cache instead of cold-faulting the model (including mmap'd frozen
+  // EmbeddingVar regions) through the first served requests.
+  bool prefault_standby_pages = false;
+  // Carry the serving session group's shared CPU resources into the
+  // group built for the next full model version, so stateful lookup
+  // resources (vocabulary and hash tables keyed by shared_name) are
+  // found already initialized and their init ops are no-ops instead
+  // of re-loading the files. Identity follows the shared_name
+  // convention: file-initialized tables embed the filename in it, so
+  // a changed vocabulary gets a new name and is loaded fresh.
+  bool reuse_lookup_resources = false;
   std::string checkpoint_dir;
   std::string savedmodel_dir;
   std::string signature_name;
   std::string warmup_file_name;
+  // Repeat the warmup request this many times at load time to drive the
+  // tensor-pool memory planner (see common_runtime/memory_planner.h)
+  // through its statistic window, so tensor slab offsets are planned
+  // before real traffic instead of during the first served requests.
+  // Should cover START_STATISTIC_STEP + MAX_STATISTIC_STEP runs.
+  // 0 disables the extra iterations.
+  int warmup_memory_planner_steps = 0;
   std::string serialize_protocol;
   int init_timeout_minutes = 0;
 
@@ -32,6 +59,13 @@ struct ModelConfig {
   int lock_timeout = 15 * 60;
   int read_thread_num = 1;
   int update_thread_num = 1;
+  // Split a large MGET into pipelined commands of this many
+  // keys each, 0 means one MGET per feature column.
+  int redis_pipeline_size = 0;
+  // Entry num of the local TTL'd LRU cache for hot keys,
+  // 0 disables the cache.
+  int feature_cache_size = 0;
+  int feature_cache_ttl_seconds = 60;
 
   // OSS Config
   std::string model_store_type;
@@ -57,6 +91,31 @@ struct ModelConfig {
   // session use self-owned thread pool
   bool use_per_session_threads = false;
 
+  // Shared-nothing serving lanes for many-core hosts: run this many
+  // sessions, each with a private thread pool, and steer every request
+  // to a free lane instead of scheduling it on one big shared pool.
+  // Frozen EmbeddingVars and lookup tables stay shared read-only
+  // between lanes through the session group's shared resource manager.
+  // Overrides session_num, use_per_session_threads and
+  // select_session_policy; when the thread counts are not set
+  // explicitly each lane gets schedulable_cpus / lanes intra threads.
+  // 0 disables lane mode.
+  int shared_nothing_lanes = 0;
+
+  // Merge requests arriving within micro_batch_window_micros into
+  // one session step, at most micro_batch_max_size per step.
+  // micro_batch_max_size <= 1 disables the micro batcher.
+  int micro_batch_max_size = 0;
+  int micro_batch_window_micros = 1000;
+
+  // Admission control: reject a request up front when its projected
+  // completion time (requests already in flight times the recent
+  // average predict latency) exceeds this deadline. Shedding the
+  // excess keeps the latency of admitted requests flat under
+  // overload instead of letting every request degrade together.
+  // 0 disables shedding.
+  int shed_deadline_micros = 0;
+
   // EmbeddingVariable Config
   embedding::StorageType storage_type = embedding::StorageType::INVALID;
   std::string storage_path;
@@ -282,6 +282,40 @@ const std::string oss_config = " \
       ModelConfigFactory::Create(oss_config.c_str(), &config).code());
 }
 
+TEST_F(ModelConfigTest, ShouldDeriveLaneModeWhenSharedNothingLanes) {
+const std::string lane_config = " \
+  { \
+    \"serialize_protocol\": \"protobuf\", \
+    \"inter_op_parallelism_threads\" : 4, \
+    \"intra_op_parallelism_threads\" : 2, \
+    \"init_timeout_minutes\" : 1, \
+    \"signature_name\": \"tensorflow_serving\", \
+    \"checkpoint_dir\" : \"oss://test_ckpt/1\", \
+    \"savedmodel_dir\" : \"oss://test_savedmodel/1\", \
+    \"feature_store_type\" : \"memory\", \
+    \"read_thread_num\" : 2, \
+    \"update_thread_num\":1, \
+    \"model_store_type\": \"oss\", \
+    \"oss_endpoint\": \"test.endpoint\", \
+    \"oss_access_id\" : \"test_id\", \
+    \"oss_access_key\" : \"test_key\", \
+    \"shared_nothing_lanes\" : 8 \
+  }";
+
+  ModelConfig* config = nullptr;
+  auto s = ModelConfigFactory::Create(lane_config.c_str(), &config);
+  EXPECT_EQ(s.error_message(), "");
+
+  EXPECT_EQ(8, config->shared_nothing_lanes);
+  EXPECT_EQ(8, config->session_num);
+  EXPECT_TRUE(config->use_per_session_threads);
+  EXPECT_EQ("LANE", config->select_session_policy);
+  // Explicit thread counts are kept; only unset ones are derived from
+  // the lane count.
+  EXPECT_EQ(4, config->inter_threads);
+  EXPECT_EQ(2, config->intra_threads);
+}
+
 } // processor
 } // tensorflow
 
@@ -118,6 +118,23 @@ bool ShouldWarmup(SignatureDef& sig_def) {
   return true;
 }
 
+// Sequentially read a file so its pages are resident in the page
+// cache. Errors are ignored: pre-faulting is best effort and the
+// restore will read the file again anyway.
+void PreFaultFile(Env* env, const std::string& fname) {
+  uint64 size = 0;
+  if (!env->GetFileSize(fname, &size).ok() || size == 0) return;
+  std::unique_ptr<RandomAccessFile> file;
+  if (!env->NewRandomAccessFile(fname, &file).ok()) return;
+  const uint64 kChunkSize = 8 << 20;
+  std::vector<char> scratch(kChunkSize);
+  StringPiece result;
+  for (uint64 offset = 0; offset < size; offset += kChunkSize) {
+    uint64 n = std::min(kChunkSize, size - offset);
+    if (!file->Read(offset, n, &result, scratch.data()).ok()) return;
+  }
+}
+
 void StringReplace(std::string& strBig, const std::string& strsrc,
                    const std::string& strdst) {
   std::string::size_type pos = 0;
@@ -264,6 +281,8 @@ Status LocalSessionInstance::Init(ModelConfig* config,
         {kSavedModelTagServe}, &meta_graph_def_));
 
   warmup_file_name_ = config->warmup_file_name;
+  warmup_memory_planner_steps_ = config->warmup_memory_planner_steps;
+  prefault_standby_pages_ = config->prefault_standby_pages;
 
   GraphOptimizerOption option;
   option.native_tf_mode = true;
@@ -360,13 +379,36 @@ Status LocalSessionInstance::Warmup(
                               warmup_file_name_);
   }
 
+  Status s;
   if (warmup_session) {
-    return warmup_session->LocalPredict(
+    s = warmup_session->Warmup(
+        call.request, call.response);
+  } else {
+    s = session_mgr_->Warmup(
         call.request, call.response);
   }
-
-  return session_mgr_->LocalPredict(
-      call.request, call.response);
+  if (!s.ok()) {
+    return s;
+  }
+
+  // Repeat the warmup request so the process-wide memory planner sees
+  // enough runs to plan the tensor pool slabs at load time, instead of
+  // profiling the first few hundred served requests.
+  for (int i = 0; i < warmup_memory_planner_steps_; ++i) {
+    Call planner_call;
+    planner_call.request = call.request;
+    if (warmup_session) {
+      s = warmup_session->Warmup(
+          planner_call.request, planner_call.response);
+    } else {
+      s = session_mgr_->Warmup(
+          planner_call.request, planner_call.response);
+    }
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  return s;
 }
 
 std::string LocalSessionInstance::DebugString() {
@@ -381,8 +423,61 @@ const SignatureInfo* LocalSessionInstance::GetSignatureInfo() {
   return &signature_info_;
 }
 
+// Walk the files of the next model version and fault them into the
+// page cache before the restore runs and traffic is swapped over.
+// Without this a rollout cold-faults the whole model (including any
+// mmap'd frozen EmbeddingVar regions) through the first served
+// requests, which shows up as a long p99 degradation window.
+void LocalSessionInstance::PreFaultModelPages(const Version& version) {
+  Env* env = Env::Default();
+  uint64 start_micros = env->NowMicros();
+  std::vector<std::string> files;
+  if (!version.SavedModelEmpty()) {
+    // The saved model directory has one level of sub-directories
+    // (e.g. variables/); anything deeper is not part of the model.
+    for (const char* pattern : {"*", "*/*"}) {
+      std::vector<std::string> matches;
+      if (env->GetMatchingPaths(
+              io::JoinPath(version.savedmodel_dir, pattern), &matches).ok()) {
+        files.insert(files.end(), matches.begin(), matches.end());
+      }
+    }
+  }
+  if (!version.CkptEmpty()) {
+    std::vector<std::string> matches;
+    if (env->GetMatchingPaths(version.full_ckpt_name + "*", &matches).ok()) {
+      files.insert(files.end(), matches.begin(), matches.end());
+    }
+  }
+  for (const auto& fname : files) {
+    // Directories fail the size lookup and are skipped inside.
+    PreFaultFile(env, fname);
+  }
+  LOG(INFO) << "[Model Instance] Pre-faulted " << files.size()
+            << " model files of version " << version.full_ckpt_version
+            << " in " << (env->NowMicros() - start_micros) / 1000 << " ms.";
+}
+
 Status LocalSessionInstance::FullModelUpdate(
     const Version& version, ModelConfig* model_config) {
+  if (prefault_standby_pages_) {
+    PreFaultModelPages(version);
+  }
+  if (model_config->shared_storage_update) {
+    // Shared-storage mode: restore the new full checkpoint into the
+    // serving session group so its EmbeddingVars stay attached to the
+    // storage the previous version holds, instead of loading a complete
+    // second copy before the switch.
+    Status s = session_mgr_->InPlaceFullModelUpdate(version);
+    if (s.ok()) {
+      UpdateVersion(version);
+      return s;
+    }
+    LOG(WARNING) << "[Model Instance] In-place full model update failed, "
+                 << "fall back to loading a new model session: "
+                 << s.error_message();
+  }
+
   ModelSession* new_model_session = nullptr;
 
   TF_RETURN_IF_ERROR(
@@ -474,6 +569,7 @@ Status RemoteSessionInstance::Init(ModelConfig* model_config,
   backup_storage_ = new FeatureStoreMgr(&backup_model_config);
 
   warmup_file_name_ = model_config->warmup_file_name;
+  warmup_memory_planner_steps_ = model_config->warmup_memory_planner_steps;
 
   // set active flag
   serving_storage_->SetStorageActiveStatus(active);
@@ -542,13 +638,36 @@ Status RemoteSessionInstance::Warmup(
                               warmup_file_name_);
   }
 
+  Status s;
   if (warmup_session) {
-    return warmup_session->Predict(
+    s = warmup_session->Warmup(
+        call.request, call.response);
+  } else {
+    s = session_mgr_->Warmup(
         call.request, call.response);
   }
-
-  return session_mgr_->Predict(
-      call.request, call.response);
+  if (!s.ok()) {
+    return s;
+  }
+
+  // Repeat the warmup request so the process-wide memory planner sees
+  // enough runs to plan the tensor pool slabs at load time, instead of
+  // profiling the first few hundred served requests.
+  for (int i = 0; i < warmup_memory_planner_steps_; ++i) {
+    Call planner_call;
+    planner_call.request = call.request;
+    if (warmup_session) {
+      s = warmup_session->Warmup(
+          planner_call.request, planner_call.response);
+    } else {
+      s = session_mgr_->Warmup(
+          planner_call.request, planner_call.response);
+    }
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  return s;
 }
 
 Status RemoteSessionInstance::FullModelUpdate(
@@ -49,6 +49,7 @@ class LocalSessionInstance {
   Status ReadModelSignature(ModelConfig* model_config);
   Status LoadModelFromCheckpoint(ModelConfig* config);
   Status LoadSavedModel(ModelConfig* config);
+  void PreFaultModelPages(const Version& version);
 
  private: 
   MetaGraphDef meta_graph_def_;
@@ -59,12 +60,14 @@ class LocalSessionInstance {
   SignatureInfo signature_info_;
 
   std::string warmup_file_name_;
+  int warmup_memory_planner_steps_ = 0;
+  bool prefault_standby_pages_ = false;
 
   ModelSessionMgr* session_mgr_ = nullptr;
   SessionOptions* session_options_ = nullptr;
   RunOptions* run_options_ = nullptr;
   SavedModelOptimizer* optimizer_ = nullptr;
-  
+
   Version version_;
 };
 
@@ -108,6 +111,7 @@ class RemoteSessionInstance {
   SignatureInfo signature_info_;
 
   std::string warmup_file_name_;
+  int warmup_memory_planner_steps_ = 0;
 
   ModelSessionMgr* session_mgr_ = nullptr;
   SessionOptions* session_options_ = nullptr;
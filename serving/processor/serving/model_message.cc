@@ -8,7 +8,7 @@ namespace {
 Status ValidateShape(const std::vector<Request>& requests) {
   for (int i = 0; i < requests[0].inputs.size(); ++i) {
     auto shape = requests[0].inputs[i].second.shape();
-    for(auto it : requests) {
+    for (const auto& it : requests) {
       if (shape != it.inputs[i].second.shape()) {
         return Status(error::Code::INVALID_ARGUMENT,
             "Invalid input shapes when batched process.");
@@ -33,7 +33,7 @@ Tensor BatchOneInput(const std::vector<Request>& requests, int index) {
   Tensor batched_tensor(input.dtype(), tensor_shape);
   auto batched_tensor_flat = batched_tensor.flat<T>();
   size_t current_pos = 0;
-  for (auto req : requests) {
+  for (const auto& req : requests) {
     auto flat = req.inputs[index].second.flat<T>();
     memcpy(batched_tensor_flat.data() + current_pos,
            flat.data(), single_input_size);
@@ -3,7 +3,12 @@
 #include "serving/processor/serving/model_config.h"
 #include "serving/processor/serving/model_message.h"
 #include "serving/processor/serving/message_coding.h"
+#include "serving/processor/serving/micro_batcher.h"
+#include "serving/processor/serving/request_stats.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
 
 namespace tensorflow {
 namespace processor {
@@ -13,6 +18,7 @@ Model::Model(const std::string& model_entry)
 }
 
 Model::~Model() {
+  delete batcher_;
   delete impl_;
 }
 
@@ -31,20 +37,43 @@ Status Model::Init(const char* model_config) {
   parser_ = ParserFactory::GetInstance(config->serialize_protocol,
       4);
   impl_ = ModelImplFactory::Create(config);
+  status = impl_->Init();
+  if (!status.ok()) {
+    return status;
+  }
 
-  return impl_->Init();
+  shed_deadline_micros_ = config->shed_deadline_micros;
+
+  if (config->micro_batch_max_size > 1) {
+    batcher_ = new MicroBatcher(
+        [this](Request& req, Response& resp) {
+          return impl_->Predict(req, resp);
+        },
+        config->micro_batch_max_size,
+        config->micro_batch_window_micros);
+  }
+
+  return Status::OK();
 }
 
 Status Model::Predict(const void* input_data, int input_size,
     void** output_data, int* output_size) {
   Call call;
-  parser_->ParseRequestFromBuf(input_data, input_size, call,
-                               impl_->GetSignatureInfo());
-  auto status = Predict(call.request, call.response);
+  {
+    ScopedStageTimer timer(RequestStats::kDecode);
+    parser_->ParseRequestFromBuf(input_data, input_size, call,
+                                 impl_->GetSignatureInfo());
+  }
+  Status status;
+  {
+    ScopedStageTimer timer(RequestStats::kPredict);
+    status = Predict(call.request, call.response);
+  }
   if (!status.ok()) {
     return status;
   }
 
+  ScopedStageTimer timer(RequestStats::kEncode);
   parser_->ParseResponseToBuf(call, output_data, output_size,
                               impl_->GetSignatureInfo());
   return Status::OK();
@@ -53,20 +82,73 @@ Status Model::Predict(const void* input_data, int input_size,
 Status Model::BatchPredict(const void* input_data[], int* input_size,
     void* output_data[], int* output_size) {
   BatchCall call;
-  parser_->ParseBatchRequestFromBuf(input_data, input_size, call,
-                                    impl_->GetSignatureInfo());
-  auto status = Predict(call.batched_request, call.batched_response);
+  {
+    ScopedStageTimer timer(RequestStats::kDecode);
+    parser_->ParseBatchRequestFromBuf(input_data, input_size, call,
+                                      impl_->GetSignatureInfo());
+  }
+  Status status;
+  {
+    ScopedStageTimer timer(RequestStats::kPredict);
+    status = Predict(call.batched_request, call.batched_response);
+  }
   if (!status.ok()) {
     return status;
   }
 
+  ScopedStageTimer timer(RequestStats::kEncode);
   parser_->ParseBatchResponseToBuf(call, output_data, output_size,
                                    impl_->GetSignatureInfo());
   return Status::OK();
 }
 
 Status Model::Predict(Request& req, Response& resp) {
-  return impl_->Predict(req, resp);
+  if (shed_deadline_micros_ <= 0) {
+    if (batcher_) {
+      return batcher_->Predict(req, resp);
+    }
+    return impl_->Predict(req, resp);
+  }
+
+  // Admission control: everything already in flight runs ahead of this
+  // request, so its projected completion is the queue depth (itself
+  // included) times the recent average predict cost. A request that
+  // projects past the deadline would time out on the client anyway;
+  // failing it here keeps the session threads for requests that can
+  // still make it. An empty queue always admits, so a latency spike in
+  // the average cannot wedge the model.
+  int64_t depth = inflight_.fetch_add(1) + 1;
+  int64_t avg = avg_predict_micros_.load(std::memory_order_relaxed);
+  if (depth > 1 && depth * avg > shed_deadline_micros_) {
+    inflight_.fetch_sub(1);
+    int64_t shed = shed_count_.fetch_add(1) + 1;
+    if (shed % 1000 == 1) {
+      LOG(WARNING) << "Model " << model_entry_ << " is shedding load: "
+                   << (depth - 1) << " requests in flight, avg predict cost "
+                   << avg << " us, deadline " << shed_deadline_micros_
+                   << " us, " << shed << " requests shed so far.";
+    }
+    return errors::ResourceExhausted(
+        "Request shed: ", depth - 1, " requests in flight at ", avg,
+        " us each projects past the ", shed_deadline_micros_,
+        " us deadline.");
+  }
+
+  Status status;
+  uint64 begin = Env::Default()->NowMicros();
+  if (batcher_) {
+    status = batcher_->Predict(req, resp);
+  } else {
+    status = impl_->Predict(req, resp);
+  }
+  int64_t cost = Env::Default()->NowMicros() - begin;
+  // EWMA with 1/8 weight: smooth enough to ride out one slow step,
+  // fresh enough to track a real shift within a few requests.
+  avg_predict_micros_.store(avg + (cost - avg) / 8,
+                            std::memory_order_relaxed);
+  inflight_.fetch_sub(1);
+  served_count_.fetch_add(1);
+  return status;
 }
 
 Status Model::GetServingModelInfo(void* output_data[],
@@ -85,7 +167,18 @@ Status Model::Rollback() {
 }
 
 std::string Model::DebugString() {
-  return impl_->DebugString();
+  std::string info = impl_->DebugString();
+  if (shed_deadline_micros_ > 0) {
+    strings::StrAppend(
+        &info, "\nload_shedding: inflight=",
+        inflight_.load(std::memory_order_relaxed),
+        " avg_predict_micros=",
+        avg_predict_micros_.load(std::memory_order_relaxed),
+        " shed_deadline_micros=", shed_deadline_micros_,
+        " served=", served_count_.load(std::memory_order_relaxed),
+        " shed=", shed_count_.load(std::memory_order_relaxed));
+  }
+  return info;
 }
 
 } // processor
@@ -1,12 +1,15 @@
 #ifndef SERVING_PROCESSOR_SERVING_MODEL_SERVING_H
 #define SERVING_PROCESSOR_SERVING_MODEL_SERVING_H
 
+#include <atomic>
+
 #include "tensorflow/core/lib/core/status.h"
 
 namespace tensorflow {
 class Tensor;
 namespace processor {
 class ModelImpl;
+class MicroBatcher;
 class Request;
 class Response;
 class IParser;
@@ -36,6 +39,17 @@ class Model {
   std::string model_entry_ = "";
   ModelImpl* impl_ = nullptr;
   IParser* parser_ = nullptr; // not owned
+  // nullptr unless micro_batch_max_size > 1 in the model config.
+  MicroBatcher* batcher_ = nullptr;
+
+  // Load shedding state (see Predict): requests currently inside
+  // predict, an EWMA of predict latency, and shed/served counters.
+  // 0 deadline disables shedding.
+  int64_t shed_deadline_micros_ = 0;
+  std::atomic<int64_t> inflight_{0};
+  std::atomic<int64_t> avg_predict_micros_{0};
+  std::atomic<int64_t> shed_count_{0};
+  std::atomic<int64_t> served_count_{0};
 };
 
 } // processor
@@ -1,6 +1,7 @@
 #include <random>
 #include "serving/processor/serving/model_session.h"
 #include "serving/processor/serving/model_message.h"
+#include "serving/processor/serving/request_stats.h"
 #include "serving/processor/serving/tracer.h"
 #include "serving/processor/serving/util.h"
 #include "serving/processor/storage/model_store.h"
@@ -142,8 +143,23 @@ Status ModelSessionMgr::CreateSession(Session** session) {
 
 Status ModelSessionMgr::CreateSessionGroup(
     SessionGroup** session_group, ModelConfig* config) {
+  ResourceMgr* reuse_rmgr = nullptr;
+  if (config->reuse_lookup_resources && serving_session_ != nullptr) {
+    // Build the new group on the serving group's shared CPU resource
+    // manager so its stateful lookup resources (vocabulary and hash
+    // tables) are found already initialized and the init ops become
+    // no-ops, instead of re-loading unchanged tables on every version
+    // switch.
+    reuse_rmgr = serving_session_->session_group_->GetCpuSharedResourceMgr();
+  }
   TF_RETURN_IF_ERROR(NewSessionGroup(*session_options_,
-                                     session_group, config->session_num));
+                                     session_group, config->session_num,
+                                     reuse_rmgr));
+  if (reuse_rmgr != nullptr) {
+    // The new group owns the manager now; drop the old group's
+    // ownership so retiring it leaves the shared resources alive.
+    serving_session_->session_group_->ReleaseCpuSharedResourceMgr();
+  }
   TF_RETURN_IF_ERROR((*session_group)->Create(meta_graph_def_.graph_def()));
   return util::GetAssetFileDefs(meta_graph_def_, &asset_file_defs_);
 }
@@ -202,8 +218,11 @@ ModelSession::ModelSession(SessionGroup* s,
     select_session_policy_ = SelectSessionPolicy::MOD;
   } else if (select_session_policy == "RR") {
     select_session_policy_ = SelectSessionPolicy::RR;
+  } else if (select_session_policy == "LANE") {
+    select_session_policy_ = SelectSessionPolicy::LANE;
+    InitLaneState();
   } else {
-    LOG(FATAL) << "[ModelSession] select_session_policy must be RR or MOD, current get "
+    LOG(FATAL) << "[ModelSession] select_session_policy must be RR, MOD or LANE, current get "
                << select_session_policy;
   }
 
@@ -216,6 +235,8 @@ ModelSession::ModelSession(SessionGroup* s,
   t_version.scalar<uint64>()() = version.full_ckpt_version;
   model_version_tensor_ = t_version;
   model_version_name_ = GetModelVersionNodeName();
+
+  RequestStats::GetInstance()->SetCurrentVersion(version.full_ckpt_version);
 }
 
 ModelSession::ModelSession(SessionGroup* s,
@@ -226,8 +247,11 @@ ModelSession::ModelSession(SessionGroup* s,
     select_session_policy_ = SelectSessionPolicy::MOD;
   } else if (select_session_policy == "RR") {
     select_session_policy_ = SelectSessionPolicy::RR;
+  } else if (select_session_policy == "LANE") {
+    select_session_policy_ = SelectSessionPolicy::LANE;
+    InitLaneState();
   } else {
-    LOG(FATAL) << "[ModelSession] select_session_policy must be RR or MOD, current get "
+    LOG(FATAL) << "[ModelSession] select_session_policy must be RR, MOD or LANE, current get "
                << select_session_policy;
   }
 
@@ -235,6 +259,8 @@ ModelSession::ModelSession(SessionGroup* s,
   t_version.scalar<uint64>()() = version.full_ckpt_version;
   model_version_tensor_ = t_version;
   model_version_name_ = GetModelVersionNodeName();
+
+  RequestStats::GetInstance()->SetCurrentVersion(version.full_ckpt_version);
 }
 
 ModelSession::~ModelSession() {
@@ -258,9 +284,106 @@ int ModelSession::GetServingSessionId() {
   if (tid == -1) {
     tid = counter.fetch_add(1);
   }
+  if (select_session_policy_ == SelectSessionPolicy::LANE) {
+    return PickLane(tid);
+  }
   return tid;
 }
 
+void ModelSession::InitLaneState() {
+  lane_num_ = session_group_->GetSessionNum();
+  lane_inflight_.reset(new std::atomic<int64>[lane_num_]);
+  for (int i = 0; i < lane_num_; ++i) {
+    lane_inflight_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+int ModelSession::PickLane(int tid) {
+  // Stick to the thread-affine lane while it is free, so a caller
+  // thread keeps hitting one lane's warm thread pool and allocator
+  // state. When that lane is busy, take the least-loaded one instead
+  // of queueing behind a slow request.
+  const int preferred = tid % lane_num_;
+  int64 best_load = lane_inflight_[preferred].load(std::memory_order_relaxed);
+  if (best_load == 0) {
+    return preferred;
+  }
+  int best = preferred;
+  for (int i = 0; i < lane_num_; ++i) {
+    const int64 load = lane_inflight_[i].load(std::memory_order_relaxed);
+    if (load < best_load) {
+      best = i;
+      best_load = load;
+    }
+  }
+  return best;
+}
+
+bool ModelSession::TryRunPreBound(Request& req, Response& resp,
+                                  int session_id, Status* status) {
+  if (callables_disabled_) return false;
+
+  // The binding signature: feed names then fetch names, in request
+  // order. Separators keep "a","bc" distinct from "ab","c".
+  std::string key;
+  for (const auto& input : req.inputs) {
+    key.append(input.first);
+    key.push_back('\x1f');
+  }
+  key.push_back('\x1e');
+  for (const auto& name : req.output_tensor_names) {
+    key.append(name);
+    key.push_back('\x1f');
+  }
+
+  int64 handle = -1;
+  bool found = false;
+  {
+    std::lock_guard<std::mutex> lock(callable_mu_);
+    auto it = callable_handles_.find(key);
+    if (it != callable_handles_.end()) {
+      handle = it->second;
+      found = true;
+    } else if (callable_handles_.size() >= kMaxCallables) {
+      return false;
+    }
+  }
+  if (!found) {
+    CallableOptions callable_options;
+    for (const auto& input : req.inputs) {
+      callable_options.add_feed(input.first);
+    }
+    for (const auto& name : req.output_tensor_names) {
+      callable_options.add_fetch(name);
+    }
+    Session::CallableHandle new_handle;
+    Status s = session_group_->MakeCallable(callable_options, &new_handle);
+    if (!s.ok()) {
+      LOG(WARNING) << "[Model Session] MakeCallable failed, fall back to "
+                   << "name-keyed Run: " << s.error_message();
+      callables_disabled_ = true;
+      return false;
+    }
+    std::lock_guard<std::mutex> lock(callable_mu_);
+    auto res = callable_handles_.emplace(key, new_handle);
+    if (!res.second) {
+      // Another request raced us to it; use the existing handle and
+      // drop ours.
+      session_group_->ReleaseCallable(new_handle).IgnoreError();
+    }
+    handle = res.first->second;
+  }
+
+  std::vector<Tensor> feeds;
+  feeds.reserve(req.inputs.size());
+  for (const auto& input : req.inputs) {
+    feeds.push_back(input.second);
+  }
+  *status = session_group_->RunCallable(handle, feeds, &resp.outputs,
+                                        nullptr, session_id);
+  return true;
+}
+
 Status ModelSession::Predict(Request& req, Response& resp) {
   if (is_local_) {
     return Status(error::Code::INTERNAL,
@@ -270,19 +393,30 @@ Status ModelSession::Predict(Request& req, Response& resp) {
   req.inputs.emplace_back(sparse_storage_name_, sparse_storage_tensor_);
   req.inputs.emplace_back(model_version_name_, model_version_tensor_);
   ++counter_;
+  // Pick the session once so the lane the request is steered to is the
+  // lane whose in-flight counter it holds.
+  const int session_id = GetServingSessionId();
+  if (select_session_policy_ == SelectSessionPolicy::LANE) {
+    lane_inflight_[session_id].fetch_add(1, std::memory_order_relaxed);
+  }
   Status status;
-  if (Tracer::GetTracer()->NeedTracing()) {
-    tensorflow::RunOptions run_options;
-    run_options.set_trace_level(tensorflow::RunOptions::FULL_TRACE);
-    tensorflow::RunMetadata run_metadata;
-    // TODO: which session selected to run on, add some policy here
-    status = session_group_->Run(run_options, req.inputs,
-        req.output_tensor_names, {}, &resp.outputs,
-        &run_metadata, GetServingSessionId());
-    Tracer::GetTracer()->GenTimeline(run_metadata);
-  } else {
-    status = session_group_->Run(req.inputs, req.output_tensor_names,
-        {}, &resp.outputs, GetServingSessionId());
+  {
+    ScopedStageTimer timer(RequestStats::kSessionRun);
+    if (Tracer::GetTracer()->NeedTracing()) {
+      tensorflow::RunOptions run_options;
+      run_options.set_trace_level(tensorflow::RunOptions::FULL_TRACE);
+      tensorflow::RunMetadata run_metadata;
+      status = session_group_->Run(run_options, req.inputs,
+          req.output_tensor_names, {}, &resp.outputs,
+          &run_metadata, session_id);
+      Tracer::GetTracer()->GenTimeline(run_metadata);
+    } else if (!TryRunPreBound(req, resp, session_id, &status)) {
+      status = session_group_->Run(req.inputs, req.output_tensor_names,
+          {}, &resp.outputs, session_id);
+    }
+  }
+  if (select_session_policy_ == SelectSessionPolicy::LANE) {
+    lane_inflight_[session_id].fetch_sub(1, std::memory_order_relaxed);
   }
   --counter_;
   return status;
@@ -294,28 +428,77 @@ Status ModelSession::LocalPredict(Request& req, Response& resp) {
         "Remote sparse storage, please use Predict.");
   }
   ++counter_;
+  const int session_id = GetServingSessionId();
+  if (select_session_policy_ == SelectSessionPolicy::LANE) {
+    lane_inflight_[session_id].fetch_add(1, std::memory_order_relaxed);
+  }
   Status status;
-  if (Tracer::GetTracer()->NeedTracing()) {
-    tensorflow::RunOptions run_options;
-    run_options.set_trace_level(tensorflow::RunOptions::FULL_TRACE);
-    tensorflow::RunMetadata run_metadata;
-    // TODO: which session selected to run on, add some policy here
-    status = session_group_->Run(run_options, req.inputs,
-        req.output_tensor_names, {}, &resp.outputs,
-        &run_metadata, GetServingSessionId());
-    Tracer::GetTracer()->GenTimeline(run_metadata); 
-  } else {
-    status = session_group_->Run(req.inputs, req.output_tensor_names,
-        {}, &resp.outputs, GetServingSessionId());
+  {
+    ScopedStageTimer timer(RequestStats::kSessionRun);
+    if (Tracer::GetTracer()->NeedTracing()) {
+      tensorflow::RunOptions run_options;
+      run_options.set_trace_level(tensorflow::RunOptions::FULL_TRACE);
+      tensorflow::RunMetadata run_metadata;
+      status = session_group_->Run(run_options, req.inputs,
+          req.output_tensor_names, {}, &resp.outputs,
+          &run_metadata, session_id);
+      Tracer::GetTracer()->GenTimeline(run_metadata);
+    } else if (!TryRunPreBound(req, resp, session_id, &status)) {
+      status = session_group_->Run(req.inputs, req.output_tensor_names,
+          {}, &resp.outputs, session_id);
+    }
+  }
+  if (select_session_policy_ == SelectSessionPolicy::LANE) {
+    lane_inflight_[session_id].fetch_sub(1, std::memory_order_relaxed);
   }
   --counter_;
   return status;
 }
 
+Status ModelSession::Warmup(Request& req, Response& resp) {
+  int32_t session_num = session_group_->GetSessionNum();
+  if (session_num <= 1) {
+    return is_local_ ? LocalPredict(req, resp) : Predict(req, resp);
+  }
+
+  // Warm every session concurrently: each session builds its pruned
+  // executors on its first run, and rolling a large group serially makes
+  // version switches take minutes. Each thread gets its own copy of the
+  // request since Predict appends the storage tensors to the inputs.
+  std::vector<Status> statuses(session_num);
+  std::vector<std::thread> threads;
+  for (int32_t id = 0; id < session_num; ++id) {
+    threads.emplace_back([this, id, &req, &statuses]() {
+      Request warmup_req = req;
+      Response warmup_resp;
+      if (!is_local_) {
+        warmup_req.inputs.emplace_back(
+            sparse_storage_name_, sparse_storage_tensor_);
+        warmup_req.inputs.emplace_back(
+            model_version_name_, model_version_tensor_);
+      }
+      statuses[id] = session_group_->Run(
+          warmup_req.inputs, warmup_req.output_tensor_names,
+          {}, &warmup_resp.outputs, id);
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  for (auto& s : statuses) {
+    TF_RETURN_IF_ERROR(s);
+  }
+  return Status::OK();
+}
+
 Status ModelSessionMgr::Predict(Request& req, Response& resp) {
   return serving_session_->Predict(req, resp);
 }
 
+Status ModelSessionMgr::Warmup(Request& req, Response& resp) {
+  return serving_session_->Warmup(req, resp);
+}
+
 Status ModelSessionMgr::LocalPredict(Request& req, Response& resp) {
   return serving_session_->LocalPredict(req, resp);
 }
@@ -517,6 +700,45 @@ Status ModelSessionMgr::CreateModelSession(
   return Status::OK();
 }
 
+Status ModelSessionMgr::InPlaceFullModelUpdate(
+    const Version& version) {
+  if (serving_session_ == nullptr) {
+    return Status(error::Code::FAILED_PRECONDITION,
+        "No serving session, can't update full model in place.");
+  }
+
+  // The restore ops import the checkpoint into the EmbeddingVars the
+  // serving session group already holds, so only the changed ids get
+  // rewritten and no second copy of the model is built. Like the delta
+  // update path, the leader session is enough: the group shares its
+  // variable resources.
+  Session* session = serving_session_->GetSession();
+  TF_RETURN_IF_ERROR(util::RunRestoreCheckpoint(
+      /*is_incr_ckpt*/false, *run_options_,
+      version.full_ckpt_name.c_str(),
+      version.delta_ckpt_name.c_str(),
+      version.savedmodel_dir.c_str(),
+      meta_graph_def_.saver_def().restore_op_name(),
+      meta_graph_def_.saver_def().filename_tensor_name(),
+      meta_graph_def_.incr_saver_def().filename_tensor_name(),
+      asset_file_defs_, session));
+
+  if (util::HasMainOp(meta_graph_def_)) {
+    TF_RETURN_IF_ERROR(util::RunMainOp(*run_options_,
+        version.savedmodel_dir.c_str(),
+        meta_graph_def_, asset_file_defs_,
+        session, kSavedModelMainOpKey));
+  } else {
+    TF_RETURN_IF_ERROR(util::RunMainOp(
+        *run_options_, version.savedmodel_dir.c_str(),
+        meta_graph_def_, asset_file_defs_, session,
+        kSavedModelLegacyInitOpKey));
+  }
+
+  serving_session_->UpdateVersion(version);
+  return Status::OK();
+}
+
 Status ModelSessionMgr::CleanupModelSession() {
   mutex_lock lock(mu_);
   sessions_.erase(
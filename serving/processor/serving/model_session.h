@@ -9,6 +9,9 @@
 #include "tensorflow/core/framework/tensor.h"
 #include <thread>
 #include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 namespace tensorflow {
 class SessionOptions;
@@ -23,7 +26,11 @@ class Request;
 class Response;
 enum SelectSessionPolicy {
   MOD = 1,
-  RR = 2
+  RR = 2,
+  // Shared-nothing lane steering: every session is a lane with its own
+  // thread pool; a request sticks to its thread-affine lane while that
+  // lane is free and otherwise takes the least-loaded one.
+  LANE = 3
 };
 struct ModelSession {
   ModelSession(SessionGroup* s, const std::string& select_session_policy,
@@ -34,6 +41,9 @@ struct ModelSession {
 
   Status Predict(Request& req, Response& resp);
   Status LocalPredict(Request& req, Response& resp);
+  // Runs the warmup request on every session in the group concurrently,
+  // so a freshly created group is fully warm before it starts serving.
+  Status Warmup(Request& req, Response& resp);
   Version GetVersion() {return version_;}
   void UpdateVersion(const Version& v) { version_ = v; }
   Session* GetSession();
@@ -54,6 +64,32 @@ struct ModelSession {
 
  private:
   int GetServingSessionId();
+
+  // LANE policy state: per-lane in-flight request counters drive the
+  // steering decision, and the thread-affine lane keeps a caller
+  // thread on one lane's warm thread pool and allocator state.
+  void InitLaneState();
+  int PickLane(int tid);
+
+  // Runs the request through a callable pre-bound to its feed/fetch
+  // names, creating one per distinct name signature on first use.
+  // Returns false when the request has to go through the name-keyed
+  // Run path instead (callable creation failed or the cache is full);
+  // when it returns true, *status is the final run status.
+  bool TryRunPreBound(Request& req, Response& resp, int session_id,
+                      Status* status);
+
+  // Pre-bound callable handles keyed by the concatenated feed/fetch
+  // names of the request. Steady serving traffic uses one entry, so
+  // per-request cost is only argument binding; the cap below guards
+  // against clients that vary their output filter per request.
+  std::mutex callable_mu_;
+  std::unordered_map<std::string, int64> callable_handles_;
+  std::atomic<bool> callables_disabled_{false};
+  static constexpr size_t kMaxCallables = 64;
+
+  int lane_num_ = 0;
+  std::unique_ptr<std::atomic<int64>[]> lane_inflight_;
 };
 
 class ModelSessionMgr {
@@ -64,6 +100,7 @@ class ModelSessionMgr {
 
   Status Predict(Request& req, Response& resp);
   Status LocalPredict(Request& req, Response& resp);
+  Status Warmup(Request& req, Response& resp);
 
   Status CreateModelSession(
       const Version& version,
@@ -93,6 +130,11 @@ class ModelSessionMgr {
       const char* incr_ckpt_name, bool is_incr_ckpt,
       ModelConfig* config, ModelSession** new_model_session);
 
+  // Restores a new full checkpoint into the current serving session
+  // group instead of building a new one, so the new version's
+  // EmbeddingVars attach to the storage the group already holds.
+  Status InPlaceFullModelUpdate(const Version& version);
+
   Status CleanupModelSession();
 
   void ResetServingSession(ModelSession* model_session);
@@ -4,6 +4,7 @@
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "serving/processor/serving/predict.pb.h"
+#include "serving/processor/serving/request_stats.h"
 
 extern "C" {
 void* initialize(const char* model_entry, const char* model_config,
@@ -99,4 +100,14 @@ int get_serving_model_info(
   return 200;
 }
 
+// Reports per-model-version stage latency histograms (decode, predict,
+// session run, encode) collected on every request.
+int get_serving_stats(
+    void* model_buf, void** output_data, int* output_size) {
+  auto report = tensorflow::processor::RequestStats::GetInstance()->Report();
+  *output_data = strndup(report.c_str(), report.length());
+  *output_size = report.length();
+  return 200;
+}
+
 } // extern "C"
@@ -8,5 +8,6 @@ int process(void* model_buf, const void* input_data, int input_size,
 int batch_process(void* model_buf, const void* input_data[], int* input_size,
                   void* output_data[], int* output_size);
 int get_serving_model_info(void* model_buf, void** output_data, int* output_size);
+int get_serving_stats(void* model_buf, void** output_data, int* output_size);
 }
 #endif
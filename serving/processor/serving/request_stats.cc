@@ -0,0 +1,98 @@
+#include "serving/processor/serving/request_stats.h"
+
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+
+namespace tensorflow {
+namespace processor {
+namespace {
+
+const char* StageName(int stage) {
+  switch (stage) {
+    case RequestStats::kDecode: return "decode";
+    case RequestStats::kPredict: return "predict";
+    case RequestStats::kSessionRun: return "session_run";
+    case RequestStats::kEncode: return "encode";
+    default: return "unknown";
+  }
+}
+
+}  // namespace
+
+RequestStats* RequestStats::GetInstance() {
+  static RequestStats* stats = new RequestStats();
+  return stats;
+}
+
+uint64 RequestStats::NowCycles() {
+#if defined(__x86_64__) || defined(__amd64__)
+  return __builtin_ia32_rdtsc();
+#else
+  return Env::Default()->NowNanos();
+#endif
+}
+
+RequestStats::RequestStats() : current_version_(-1) {
+  // Calibrate cycles against the wall clock once; on non-x86 NowCycles
+  // is nanoseconds and this measures ~1000 cycles per microsecond.
+  Env* env = Env::Default();
+  uint64 c0 = NowCycles();
+  uint64 t0 = env->NowMicros();
+  env->SleepForMicroseconds(2000);
+  uint64 c1 = NowCycles();
+  uint64 t1 = env->NowMicros();
+  cycles_per_micro_ =
+      (t1 > t0) ? static_cast<double>(c1 - c0) / (t1 - t0) : 1.0;
+}
+
+void RequestStats::SetCurrentVersion(int64 version) {
+  current_version_.store(version, std::memory_order_relaxed);
+}
+
+RequestStats::VersionStats* RequestStats::GetVersionStats(int64 version) {
+  mutex_lock l(mu_);
+  auto& stats = stats_[version];
+  if (stats == nullptr) {
+    stats.reset(new VersionStats());
+  }
+  return stats.get();
+}
+
+void RequestStats::Record(Stage stage, uint64 begin_cycles,
+                          uint64 end_cycles) {
+  if (end_cycles <= begin_cycles) return;
+  VersionStats* stats =
+      GetVersionStats(current_version_.load(std::memory_order_relaxed));
+  double us = (end_cycles - begin_cycles) / cycles_per_micro_;
+  stats->stage_us[stage].Add(us);
+  stats->stage_count[stage].fetch_add(1, std::memory_order_relaxed);
+}
+
+std::string RequestStats::Report() {
+  std::string out;
+  mutex_lock l(mu_);
+  for (auto& it : stats_) {
+    for (int stage = 0; stage < kNumStages; ++stage) {
+      int64 count = it.second->stage_count[stage].load(
+          std::memory_order_relaxed);
+      if (count == 0) continue;
+      auto& h = it.second->stage_us[stage];
+      strings::StrAppend(&out,
+          "model_version=", it.first,
+          " stage=", StageName(stage),
+          " count=", count,
+          " avg_us=", static_cast<int64>(h.Average()),
+          " p50_us=", static_cast<int64>(h.Percentile(50)),
+          " p90_us=", static_cast<int64>(h.Percentile(90)),
+          " p99_us=", static_cast<int64>(h.Percentile(99)),
+          " p999_us=", static_cast<int64>(h.Percentile(99.9)), "\n");
+    }
+  }
+  if (out.empty()) {
+    out = "no requests recorded\n";
+  }
+  return out;
+}
+
+}  // namespace processor
+}  // namespace tensorflow
@@ -0,0 +1,95 @@
+#ifndef SERVING_PROCESSOR_SERVING_REQUEST_STATS_H
+#define SERVING_PROCESSOR_SERVING_REQUEST_STATS_H
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "tensorflow/core/lib/histogram/histogram.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace processor {
+
+// Per-request stage cost accounting for the serving processor. Each
+// Predict records how long it spent decoding the request, queued plus
+// running in the session, and encoding the response; costs aggregate
+// into per-model-version histograms that the get_serving_stats entry
+// point reports. Timestamps come from the cycle counter, so recording
+// is cheap enough to stay on for every request.
+class RequestStats {
+ public:
+  enum Stage {
+    kDecode = 0,
+    // Micro-batch queueing plus session run, measured at Model::Predict.
+    kPredict,
+    // Graph execution only. Feature fetch from the sparse storage runs
+    // inside the graph, so it is part of this stage.
+    kSessionRun,
+    kEncode,
+    kNumStages,
+  };
+
+  static RequestStats* GetInstance();
+
+  // Timestamp in cycles: rdtsc on x86, monotonic nanoseconds elsewhere.
+  // Only differences are meaningful; Record() converts via the
+  // calibration done at startup.
+  static uint64 NowCycles();
+
+  // Called when a model version starts serving; subsequent records
+  // aggregate under it.
+  void SetCurrentVersion(int64 version);
+
+  void Record(Stage stage, uint64 begin_cycles, uint64 end_cycles);
+
+  // Human/scrape-friendly report of all versions and stages.
+  std::string Report();
+
+ private:
+  RequestStats();
+
+  struct VersionStats {
+    histogram::ThreadSafeHistogram stage_us[kNumStages];
+    std::atomic<int64> stage_count[kNumStages];
+
+    VersionStats() {
+      for (int i = 0; i < kNumStages; ++i) stage_count[i] = 0;
+    }
+  };
+
+  VersionStats* GetVersionStats(int64 version);
+
+  mutex mu_;
+  std::map<int64, std::unique_ptr<VersionStats>> stats_ GUARDED_BY(mu_);
+  std::atomic<int64> current_version_;
+  double cycles_per_micro_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(RequestStats);
+};
+
+// Records one stage from construction to destruction.
+class ScopedStageTimer {
+ public:
+  explicit ScopedStageTimer(RequestStats::Stage stage)
+      : stage_(stage), begin_(RequestStats::NowCycles()) {}
+
+  ~ScopedStageTimer() {
+    RequestStats::GetInstance()->Record(
+        stage_, begin_, RequestStats::NowCycles());
+  }
+
+ private:
+  RequestStats::Stage stage_;
+  uint64 begin_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ScopedStageTimer);
+};
+
+}  // namespace processor
+}  // namespace tensorflow
+
+#endif  // SERVING_PROCESSOR_SERVING_REQUEST_STATS_H
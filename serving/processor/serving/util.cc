@@ -622,16 +622,28 @@ Tensor Proto2Tensor(const eas::ArrayProto& input) {
   return Tensor();
 }
 
-eas::PredictResponse Tensor2Response(
+void Tensor2Response(
     const processor::Request& req,
     const processor::Response& resp,
-    const SignatureInfo* signature_info) {
-  eas::PredictResponse response;
+    const SignatureInfo* signature_info,
+    eas::PredictResponse* response) {
   const auto& output_tensor_names = req.output_tensor_names;
   const auto & outputs = resp.outputs;
 
   for (size_t i = 0; i < outputs.size(); ++i) {
-    eas::ArrayProto output;
+    if (signature_info->output_value_name_idx.find(output_tensor_names[i]) ==
+        signature_info->output_value_name_idx.end()) {
+      LOG(ERROR) << "Response contain invalid output tensor name: "
+                 << output_tensor_names[i];
+      continue;
+    }
+    const std::string& key =
+        signature_info->output_key[signature_info->output_value_name_idx.at(
+            output_tensor_names[i])];
+    // Build the ArrayProto in its map slot directly: it holds every
+    // value of the output tensor, and copying it at the end of the
+    // loop would double the encode cost.
+    eas::ArrayProto& output = (*response->mutable_outputs())[key];
     int64 total_dim_size = 1;
     for (int j = 0; j < outputs[i].dims(); ++j) {
       int64 dim_size = outputs[i].dim_size(j);
@@ -807,16 +819,7 @@ eas::PredictResponse Tensor2Response(
         LOG(ERROR) << "Output Tensor Not Support this DataType";
         break;
     }
-    if (signature_info->output_value_name_idx.find(output_tensor_names[i]) ==
-        signature_info->output_value_name_idx.end()) {
-      LOG(ERROR) << "Response contain invalid output tensor name: "
-                 << output_tensor_names[i];
-    }
-    std::string key =
-        signature_info->output_key[signature_info->output_value_name_idx.at(output_tensor_names[i])];
-    (*response.mutable_outputs())[key] = output;
   }
-  return response;
 }
 
 } // namespace util
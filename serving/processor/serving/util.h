@@ -85,10 +85,14 @@ Status ValidateSavedTensors(const GraphDef& graph_def);
 
 Tensor Proto2Tensor(const eas::ArrayProto& input);
 
-eas::PredictResponse Tensor2Response(
+// Fills `response`, which may be arena-allocated by the caller so the
+// per-output ArrayProtos are bump-allocated and freed wholesale after
+// the response is serialized.
+void Tensor2Response(
     const processor::Request& req,
     const processor::Response& resp,
-    const SignatureInfo* info);
+    const SignatureInfo* info,
+    eas::PredictResponse* response);
  
 } // namespace util
 } // namespace processor
@@ -13,9 +13,13 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <cstring>
+#include <unordered_map>
+
 #include "serving/processor/storage/feature_store_mgr.h"
 #include "serving/processor/serving/model_config.h"
 #include "absl/synchronization/mutex.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
 
 namespace tensorflow {
@@ -122,6 +126,7 @@ FeatureStore* CreateFeatureStore(ModelConfig* config) {
     }
     redis_config.passwd = config->redis_password;
     redis_config.db_idx = config->redis_db_idx;
+    redis_config.pipeline_size = config->redis_pipeline_size;
 
     return new LocalRedis(redis_config);
   } else {
@@ -132,6 +137,20 @@ FeatureStore* CreateFeatureStore(ModelConfig* config) {
   return nullptr;
 }
 
+std::string MakeCacheKey(uint64_t model_version,
+                         uint64_t feature2id,
+                         const char* key,
+                         size_t bytes_per_key) {
+  std::string s;
+  s.reserve(sizeof(model_version) + sizeof(feature2id) + bytes_per_key);
+  s.append(reinterpret_cast<const char*>(&model_version),
+           sizeof(model_version));
+  s.append(reinterpret_cast<const char*>(&feature2id),
+           sizeof(feature2id));
+  s.append(key, bytes_per_key);
+  return s;
+}
+
 #define CALL_BY_UPDATE_THREAD(fn, ...)                        \
   do {                                                        \
     uint64_t index = active_update_thread_index_++;           \
@@ -316,7 +335,58 @@ bool AsyncFeatureStoreMgr::ShouldStop() {
   return stop_;
 }
 
-FeatureStoreMgr::FeatureStoreMgr(ModelConfig* config) 
+FeatureLRUCache::FeatureLRUCache(size_t capacity, int ttl_seconds)
+  : capacity_(capacity),
+    ttl_micros_(static_cast<uint64_t>(ttl_seconds) * 1000 * 1000) {
+}
+
+bool FeatureLRUCache::Get(const std::string& key,
+                          char* value, size_t bytes) {
+  std::lock_guard<std::mutex> lock(mu_);
+  auto it = index_.find(key);
+  if (it == index_.end()) {
+    return false;
+  }
+
+  if (Env::Default()->NowMicros() >= it->second->expire_micros ||
+      it->second->value.size() != bytes) {
+    lru_.erase(it->second);
+    index_.erase(it);
+    return false;
+  }
+
+  memcpy(value, it->second->value.data(), bytes);
+  lru_.splice(lru_.begin(), lru_, it->second);
+  return true;
+}
+
+void FeatureLRUCache::Put(const std::string& key,
+                          const char* value, size_t bytes) {
+  uint64_t expire_micros = Env::Default()->NowMicros() + ttl_micros_;
+  std::lock_guard<std::mutex> lock(mu_);
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    it->second->value.assign(value, bytes);
+    it->second->expire_micros = expire_micros;
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return;
+  }
+
+  while (lru_.size() >= capacity_) {
+    index_.erase(lru_.back().key);
+    lru_.pop_back();
+  }
+  lru_.push_front(Entry{key, std::string(value, bytes), expire_micros});
+  index_[key] = lru_.begin();
+}
+
+void FeatureLRUCache::Clear() {
+  std::lock_guard<std::mutex> lock(mu_);
+  lru_.clear();
+  index_.clear();
+}
+
+FeatureStoreMgr::FeatureStoreMgr(ModelConfig* config)
   : thread_num_(config->read_thread_num),
     update_thread_num_(config->update_thread_num),
     active_thread_index_(0),
@@ -342,6 +412,12 @@ FeatureStoreMgr::FeatureStoreMgr(ModelConfig* config)
   for (int i = 0; i < update_thread_num_; ++i) {
     update_store_[i] = CreateFeatureStore(config);
   }
+
+  if (config->feature_cache_size > 0) {
+    feature_cache_ = new FeatureLRUCache(
+        config->feature_cache_size,
+        config->feature_cache_ttl_seconds);
+  }
 }
 
 FeatureStoreMgr::~FeatureStoreMgr() {
@@ -352,6 +428,8 @@ FeatureStoreMgr::~FeatureStoreMgr() {
   for (auto store : update_store_) {
     delete store;
   }
+
+  delete feature_cache_;
 }
 
 Status FeatureStoreMgr::GetValues(
@@ -364,14 +442,120 @@ Status FeatureStoreMgr::GetValues(
     size_t N,
     const char* default_value,
     BatchGetCallback cb) {
+  // A ranking request scoring hundreds of candidates repeats many ids
+  // within one feature column (multi-hot features, duplicated items).
+  // Fetch each distinct key once and fan the value out to every
+  // position afterwards, so the packed MGET and its reply only carry
+  // unique keys.
+  if (N > 1) {
+    std::unordered_map<std::string, size_t> first_pos;
+    first_pos.reserve(N);
+    std::vector<size_t> unique_pos;
+    std::vector<size_t> dup_src;
+    std::vector<size_t> dup_dst;
+    for (size_t i = 0; i < N; ++i) {
+      auto res = first_pos.emplace(
+          std::string(keys + i * bytes_per_key, bytes_per_key), i);
+      if (res.second) {
+        unique_pos.push_back(i);
+      } else {
+        dup_src.push_back(res.first->second);
+        dup_dst.push_back(i);
+      }
+    }
+    if (!dup_dst.empty()) {
+      std::vector<char> unique_keys(unique_pos.size() * bytes_per_key);
+      std::vector<char> unique_values(unique_pos.size() * bytes_per_values);
+      for (size_t i = 0; i < unique_pos.size(); ++i) {
+        memcpy(unique_keys.data() + i * bytes_per_key,
+               keys + unique_pos[i] * bytes_per_key, bytes_per_key);
+      }
+      // The fetch below runs synchronously; the caller's callback is
+      // deferred until the values have been fanned out.
+      Status s = GetValues(
+          model_version, feature2id, unique_keys.data(),
+          unique_values.data(), bytes_per_key, bytes_per_values,
+          unique_pos.size(), default_value, [](const Status&) {});
+      if (s.ok()) {
+        for (size_t i = 0; i < unique_pos.size(); ++i) {
+          memcpy(values + unique_pos[i] * bytes_per_values,
+                 unique_values.data() + i * bytes_per_values,
+                 bytes_per_values);
+        }
+        for (size_t d = 0; d < dup_dst.size(); ++d) {
+          memcpy(values + dup_dst[d] * bytes_per_values,
+                 values + dup_src[d] * bytes_per_values,
+                 bytes_per_values);
+        }
+        cb(s);
+      }
+      return s;
+    }
+  }
+
+  std::vector<size_t> missing;
+  if (feature_cache_ != nullptr) {
+    for (size_t i = 0; i < N; ++i) {
+      std::string key = MakeCacheKey(
+          model_version, feature2id,
+          keys + i * bytes_per_key, bytes_per_key);
+      if (!feature_cache_->Get(key, values + i * bytes_per_values,
+                               bytes_per_values)) {
+        missing.push_back(i);
+      }
+    }
+
+    if (missing.empty()) {
+      Status s;
+      cb(s);
+      return s;
+    }
+  }
+
   uint64_t index = active_thread_index_++;
   index %= thread_num_;
   {
     std::lock_guard<std::mutex> lock(mutex_[index]);
-    Status s = store_[index]->BatchGet(
-        model_version, feature2id, keys, values, 
-        bytes_per_key, bytes_per_values, N,
-        default_value);
+    Status s;
+    if (feature_cache_ != nullptr && missing.size() < N) {
+      // Only the keys the cache missed go to the storage backend.
+      std::vector<char> miss_keys(missing.size() * bytes_per_key);
+      std::vector<char> miss_values(missing.size() * bytes_per_values);
+      for (size_t i = 0; i < missing.size(); ++i) {
+        memcpy(miss_keys.data() + i * bytes_per_key,
+               keys + missing[i] * bytes_per_key, bytes_per_key);
+      }
+      s = store_[index]->BatchGet(
+          model_version, feature2id, miss_keys.data(), miss_values.data(),
+          bytes_per_key, bytes_per_values, missing.size(),
+          default_value);
+      if (s.ok()) {
+        for (size_t i = 0; i < missing.size(); ++i) {
+          memcpy(values + missing[i] * bytes_per_values,
+                 miss_values.data() + i * bytes_per_values,
+                 bytes_per_values);
+          feature_cache_->Put(
+              MakeCacheKey(model_version, feature2id,
+                           keys + missing[i] * bytes_per_key,
+                           bytes_per_key),
+              miss_values.data() + i * bytes_per_values,
+              bytes_per_values);
+        }
+      }
+    } else {
+      s = store_[index]->BatchGet(
+          model_version, feature2id, keys, values,
+          bytes_per_key, bytes_per_values, N,
+          default_value);
+      if (s.ok() && feature_cache_ != nullptr) {
+        for (size_t i = 0; i < N; ++i) {
+          feature_cache_->Put(
+              MakeCacheKey(model_version, feature2id,
+                           keys + i * bytes_per_key, bytes_per_key),
+              values + i * bytes_per_values, bytes_per_values);
+        }
+      }
+    }
     if (s.ok()) {
       cb(s);
     }
@@ -403,6 +587,9 @@ Status FeatureStoreMgr::SetValues(
 }
 
 Status FeatureStoreMgr::Reset() {
+  if (feature_cache_ != nullptr) {
+    feature_cache_->Clear();
+  }
   uint64_t index = active_update_thread_index_++;
   index %= update_thread_num_;
   {
@@ -17,7 +17,10 @@ limitations under the License.
 #define SERVING_PROCESSOR_STORAGE_FEATURE_STORE_MGR_H_
 
 #include <atomic>
+#include <list>
+#include <string>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 #include <mutex>                // std::mutex, std::unique_lock
 #include <condition_variable>   // std::condition_variable
@@ -119,6 +122,33 @@ class AsyncFeatureStoreMgr {
   std::vector<FeatureStore*> update_store_;
 };
 
+// A small TTL'd LRU cache in front of the remote feature storage.
+// It holds the raw value bytes of the hottest keys so repeated
+// lookups skip the redis round trip until the entry expires.
+class FeatureLRUCache {
+ public:
+  FeatureLRUCache(size_t capacity, int ttl_seconds);
+
+  // Returns true and copies the cached bytes into @value on a
+  // fresh hit, false on a miss or an expired entry.
+  bool Get(const std::string& key, char* value, size_t bytes);
+  void Put(const std::string& key, const char* value, size_t bytes);
+  void Clear();
+
+ private:
+  struct Entry {
+    std::string key;
+    std::string value;
+    uint64_t expire_micros;
+  };
+
+  size_t capacity_;
+  uint64_t ttl_micros_;
+  std::mutex mu_;
+  std::list<Entry> lru_; // front is the most recently used
+  std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+};
+
 class IFeatureStoreMgr {
  public:
   virtual ~IFeatureStoreMgr() {}
@@ -209,6 +239,8 @@ class FeatureStoreMgr : public IFeatureStoreMgr {
   std::vector<FeatureStore*> store_; // one connection per store
   std::vector<FeatureStore*> update_store_;
   std::string storage_type_;
+  // nullptr when the local cache is disabled.
+  FeatureLRUCache* feature_cache_ = nullptr;
 };
 
 } // processor
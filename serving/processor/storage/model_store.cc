@@ -1,9 +1,16 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+
 #include "serving/processor/framework/model_version.h"
 #include "serving/processor/serving/model_config.h"
 #include "serving/processor/storage/model_store.h"
 #include "serving/processor/storage/feature_store_mgr.h"
 #include "tensorflow/cc/saved_model/loader.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/lib/io/path.h"
 #include "tensorflow/cc/saved_model/constants.h"
@@ -167,5 +174,105 @@ Status ModelStore::DetectLatestCheckpointDir() {
   return Status::OK();
 }
 
+Status ModelStore::DownloadFile(const std::string& src,
+                                const std::string& dst,
+                                int parallelism) {
+  Env* env = Env::Default();
+  uint64 src_size = 0;
+  TF_RETURN_IF_ERROR(file_system_->GetFileSize(src, &src_size));
+
+  int fd = open(dst.c_str(), O_CREAT | O_WRONLY | O_TRUNC, 0644);
+  if (fd < 0) {
+    return errors::Internal("[Model Store] Create local file failed: ", dst,
+                            ", errno: ", errno);
+  }
+  if (src_size == 0) {
+    close(fd);
+    return Status::OK();
+  }
+
+  // Below this range size the per-range request overhead dominates
+  // and extra readers stop helping.
+  const uint64 kMinRangeSize = 8 << 20;
+  int num_ranges = std::max<int>(
+      1, std::min<uint64>(parallelism,
+                          (src_size + kMinRangeSize - 1) / kMinRangeSize));
+  uint64 range_size = (src_size + num_ranges - 1) / num_ranges;
+
+  uint64 start_micros = env->NowMicros();
+  std::vector<Status> range_status(num_ranges);
+  thread::ThreadPool pool(env, "model_store_download", num_ranges);
+  BlockingCounter counter(num_ranges);
+  for (int r = 0; r < num_ranges; ++r) {
+    pool.Schedule([this, r, fd, src_size, range_size, &src,
+                   &range_status, &counter]() {
+      uint64 begin = r * range_size;
+      uint64 end = std::min(src_size, begin + range_size);
+      // One handle per reader: RandomAccessFile reads of one handle
+      // would serialize on the underlying connection.
+      std::unique_ptr<RandomAccessFile> file;
+      Status s = file_system_->NewRandomAccessFile(src, &file);
+      if (s.ok()) {
+        const uint64 kChunkSize = 4 << 20;
+        std::vector<char> scratch(std::min(kChunkSize, end - begin));
+        for (uint64 offset = begin; s.ok() && offset < end;
+             offset += kChunkSize) {
+          uint64 n = std::min(kChunkSize, end - offset);
+          StringPiece result;
+          s = file->Read(offset, n, &result, scratch.data());
+          // Verify while writing: a short range read means the object
+          // changed or the transfer was truncated.
+          if (s.ok() && result.size() != n) {
+            s = errors::DataLoss("[Model Store] Short read of ", src,
+                                 " at offset ", offset, ": got ",
+                                 result.size(), " of ", n, " bytes.");
+          }
+          if (s.ok() &&
+              pwrite(fd, result.data(), n, offset) !=
+                  static_cast<ssize_t>(n)) {
+            s = errors::Internal("[Model Store] Write failed, errno: ", errno);
+          }
+        }
+      }
+      range_status[r] = s;
+      counter.DecrementCount();
+    });
+  }
+  counter.Wait();
+  close(fd);
+
+  for (const Status& s : range_status) {
+    TF_RETURN_IF_ERROR(s);
+  }
+  uint64 dst_size = 0;
+  TF_RETURN_IF_ERROR(env->GetFileSize(dst, &dst_size));
+  if (dst_size != src_size) {
+    return errors::DataLoss("[Model Store] Downloaded size of ", dst, " (",
+                            dst_size, ") does not match source size (",
+                            src_size, ").");
+  }
+  LOG(INFO) << "[Model Store] Downloaded " << src << " (" << src_size
+            << " bytes) with " << num_ranges << " ranges in "
+            << (env->NowMicros() - start_micros) / 1000 << " ms.";
+  return Status::OK();
+}
+
+Status ModelStore::DownloadDir(const std::string& src_dir,
+                               const std::string& dst_dir,
+                               int parallelism) {
+  TF_RETURN_IF_ERROR(Env::Default()->RecursivelyCreateDir(dst_dir));
+  std::vector<string> children;
+  TF_RETURN_IF_ERROR(file_system_->GetChildren(src_dir, &children));
+  for (const auto& child : children) {
+    const string src = io::JoinPath(src_dir, child);
+    if (file_system_->IsDirectory(src).ok()) {
+      continue;
+    }
+    TF_RETURN_IF_ERROR(
+        DownloadFile(src, io::JoinPath(dst_dir, child), parallelism));
+  }
+  return Status::OK();
+}
+
 } // namespace processor
 } // namespace tensorflow
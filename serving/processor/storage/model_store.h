@@ -15,6 +15,20 @@ class ModelStore {
   Status Init();
   Status GetLatestVersion(Version& version);
 
+  // Downloads `src` (typically an OSS object) to the local path `dst`
+  // using `parallelism` concurrent ranged readers; the object store
+  // serves several ranges of one object at line rate while a single
+  // sequential reader does not fill the NIC.  Each range is verified
+  // to return exactly the requested bytes and the final file size is
+  // checked against the source before returning OK.
+  Status DownloadFile(const std::string& src, const std::string& dst,
+                      int parallelism = 8);
+
+  // Downloads every file directly under `src_dir` into `dst_dir`,
+  // each with DownloadFile.
+  Status DownloadDir(const std::string& src_dir, const std::string& dst_dir,
+                     int parallelism = 8);
+
  protected:
   Status GetFullModelVersion(Version& version);
   Status GetDeltaModelVersion(Version& version);
@@ -200,12 +200,39 @@ Status GetRedisMeta(redisContext *c, int db, StorageMeta *meta) {
   return Status::OK();
 }
 
+Status FillValuesFromReply(redisReply* reply,
+                           char* const values,
+                           size_t bytes_per_values,
+                           const char* default_value) {
+  if (REDIS_REPLY_ARRAY != reply->type) {
+    return Status(error::Code::INTERNAL,
+        "[Redis] run redisCommandArgv-MGET failed." +
+        std::string(reply->str ? reply->str : ""));
+  }
+  for (int i = 0; i < reply->elements; i++) {
+    if (REDIS_REPLY_NIL == reply->element[i]->type) {
+      memcpy(values + i * bytes_per_values,
+             default_value,
+             bytes_per_values);
+    } else if (REDIS_REPLY_STRING == reply->element[i]->type) {
+      memcpy(values + i * bytes_per_values,
+             reply->element[i]->str,
+             reply->element[i]->len);
+    } else {
+      return Status(error::Code::INTERNAL,
+          "[Redis] run redisCommandArgv-MGET failed.");
+    }
+  }
+  return Status::OK();
+}
+
 } // anonymous namespace
 
 LocalRedis::LocalRedis(const Config& config)
   : ip_(config.ip),
     port_(config.port),
     db_idx_(config.db_idx),
+    pipeline_size_(config.pipeline_size),
     c_(nullptr) {
   assert((c_ = redisConnect(ip_.c_str(), port_)) != nullptr);
 
@@ -415,6 +442,55 @@ Status LocalRedis::BatchGet(uint64_t model_version,
   }
 #endif
 
+  if (pipeline_size_ > 0 && len > pipeline_size_) {
+    // Pipeline the MGET in chunks: every chunk is written to the
+    // socket before the first reply is read, so the server processes
+    // the next chunk while the previous reply is in flight.
+    int64_t num_chunks = (len + pipeline_size_ - 1) / pipeline_size_;
+    for (int64_t c = 0; c < num_chunks; ++c) {
+      int64_t begin = c * pipeline_size_;
+      int64_t count = len - begin < pipeline_size_ ?
+                      len - begin : pipeline_size_;
+      std::vector<const char*> chunk_argv(count + 1);
+      std::vector<size_t> chunk_argvlen(count + 1);
+      chunk_argv[0] = argv[0];
+      chunk_argvlen[0] = argvlen[0];
+      for (int64_t k = 0; k < count; ++k) {
+        chunk_argv[k + 1] = argv[1 + begin + k];
+        chunk_argvlen[k + 1] = argvlen[1 + begin + k];
+      }
+      redisAppendCommandArgv(c_, count + 1, chunk_argv.data(),
+                             chunk_argvlen.data());
+    }
+
+    Status s;
+    for (int64_t c = 0; c < num_chunks; ++c) {
+      int64_t begin = c * pipeline_size_;
+      redisReply *reply = nullptr;
+      if (redisGetReply(c_, (void**)&reply) != REDIS_OK ||
+          reply == nullptr) {
+        s = Status(error::Code::INTERNAL,
+            "[Redis] run pipelined MGET failed: " +
+            std::string(c_->errstr ? c_->errstr : "unknown error"));
+        break;
+      }
+      if (s.ok()) {
+        s = FillValuesFromReply(reply, values + begin * bytes_per_values,
+                                bytes_per_values, default_value);
+      }
+      freeReplyObject(reply);
+    }
+
+    for(int i = 0; i < j; i++) {
+      delete [] argv[i];
+      argv[i] = NULL;
+    }
+    delete []argv;
+    delete []argvlen;
+
+    return s;
+  }
+
   redisReply *reply = (redisReply *)redisCommandArgv(c_,
                           len + 1, const_cast<const char **>(argv), argvlen);
 
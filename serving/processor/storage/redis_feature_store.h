@@ -22,6 +22,9 @@ class LocalRedis : public FeatureStore {
       int32_t port = 0;
       std::string passwd;
       size_t db_idx = 0;
+      // Split a large MGET into pipelined commands of this many
+      // keys each, 0 means one MGET per BatchGet call.
+      int32_t pipeline_size = 0;
     };
 
     LocalRedis(const Config& config);
@@ -79,6 +82,7 @@ class LocalRedis : public FeatureStore {
     std::string ip_;
     int32_t port_;
     size_t db_idx_;
+    int32_t pipeline_size_;
     redisContext *c_;
 };
 
@@ -0,0 +1,294 @@
+// Replay benchmark for the serving processor.
+//
+// Feeds recorded PredictRequests (length-prefixed protobuf records or
+// line-delimited JSON) through the process() entry point at configurable
+// load, and reports client-side end-to-end latency percentiles plus the
+// processor's own per-stage / per-model-version stats from
+// get_serving_stats(). Two load modes:
+//   open:   requests are released on a fixed schedule (--qps); latency is
+//           measured from the scheduled release time, so queueing delay
+//           from an overloaded processor shows up in the numbers.
+//   closed: --concurrency threads issue requests back to back.
+//
+// Example:
+//   replay_benchmark --model_config=config.json --requests=predict.log \
+//       --format=pb --mode=open --qps=2000 --concurrency=16 --duration_s=60
+//
+// Without --requests a synthetic single-float request is used, which is
+// enough to exercise the batching and RPC machinery with the bundled
+// simple_model.py graph.
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "google/protobuf/util/json_util.h"
+#include "serving/processor/serving/predict.pb.h"
+#include "serving/processor/serving/processor.h"
+
+namespace {
+
+struct Options {
+  std::string model_config_path;
+  std::string requests_path;
+  std::string format = "pb";  // "pb" or "json"
+  std::string mode = "closed";
+  double qps = 1000.0;
+  int concurrency = 8;
+  int duration_s = 30;
+  int warmup = 100;
+};
+
+bool ParseFlag(const std::string& arg, const std::string& name,
+               std::string* value) {
+  std::string prefix = "--" + name + "=";
+  if (arg.compare(0, prefix.size(), prefix) != 0) return false;
+  *value = arg.substr(prefix.size());
+  return true;
+}
+
+bool ParseOptions(int argc, char** argv, Options* opts) {
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    std::string value;
+    if (ParseFlag(arg, "model_config", &opts->model_config_path) ||
+        ParseFlag(arg, "requests", &opts->requests_path) ||
+        ParseFlag(arg, "format", &opts->format) ||
+        ParseFlag(arg, "mode", &opts->mode)) {
+      continue;
+    } else if (ParseFlag(arg, "qps", &value)) {
+      opts->qps = atof(value.c_str());
+    } else if (ParseFlag(arg, "concurrency", &value)) {
+      opts->concurrency = atoi(value.c_str());
+    } else if (ParseFlag(arg, "duration_s", &value)) {
+      opts->duration_s = atoi(value.c_str());
+    } else if (ParseFlag(arg, "warmup", &value)) {
+      opts->warmup = atoi(value.c_str());
+    } else {
+      std::cerr << "unknown flag: " << arg << "\n";
+      return false;
+    }
+  }
+  if (opts->mode != "open" && opts->mode != "closed") {
+    std::cerr << "--mode must be open or closed\n";
+    return false;
+  }
+  if (opts->format != "pb" && opts->format != "json") {
+    std::cerr << "--format must be pb or json\n";
+    return false;
+  }
+  return true;
+}
+
+// Serialized request bodies, ready to hand to process().
+using RequestLog = std::vector<std::string>;
+
+// pb logs are a sequence of records, each a 4-byte little-endian length
+// followed by a serialized PredictRequest.
+bool LoadPbLog(const std::string& path, RequestLog* log) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) return false;
+  while (true) {
+    uint32_t len = 0;
+    if (!in.read(reinterpret_cast<char*>(&len), sizeof(len))) break;
+    std::string body(len, '\0');
+    if (!in.read(&body[0], len)) {
+      std::cerr << "truncated record in " << path << "\n";
+      return false;
+    }
+    // Validate so a corrupt log fails here, not inside the processor.
+    ::tensorflow::eas::PredictRequest req;
+    if (!req.ParseFromString(body)) {
+      std::cerr << "unparseable record " << log->size() << " in " << path
+                << "\n";
+      return false;
+    }
+    log->push_back(std::move(body));
+  }
+  return !log->empty();
+}
+
+// JSON logs hold one PredictRequest per line, in proto3 JSON form.
+bool LoadJsonLog(const std::string& path, RequestLog* log) {
+  std::ifstream in(path);
+  if (!in) return false;
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty()) continue;
+    ::tensorflow::eas::PredictRequest req;
+    auto status = google::protobuf::util::JsonStringToMessage(line, &req);
+    if (!status.ok()) {
+      std::cerr << "bad JSON record " << log->size() << " in " << path << ": "
+                << status.ToString() << "\n";
+      return false;
+    }
+    log->push_back(req.SerializeAsString());
+  }
+  return !log->empty();
+}
+
+std::string SyntheticRequest() {
+  ::tensorflow::eas::ArrayProto input;
+  input.set_dtype(::tensorflow::eas::ArrayDataType::DT_FLOAT);
+  input.mutable_array_shape()->add_dim(1);
+  input.mutable_array_shape()->add_dim(1);
+  input.add_float_val(1.0);
+  ::tensorflow::eas::PredictRequest req;
+  req.set_signature_name("serving_default");
+  req.add_output_filter("y");
+  (*req.mutable_inputs())["x"] = input;
+  return req.SerializeAsString();
+}
+
+int64_t NowMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+struct WorkerResult {
+  std::vector<double> latencies_ms;
+  int64_t errors = 0;
+};
+
+void SendOne(void* model, const std::string& body, WorkerResult* result,
+             int64_t begin_us) {
+  void* output = nullptr;
+  int output_size = 0;
+  int state = process(model, body.data(), body.size(), &output, &output_size);
+  result->latencies_ms.push_back((NowMicros() - begin_us) / 1000.0);
+  if (state != 200) {
+    ++result->errors;
+  }
+  free(output);
+}
+
+void ClosedLoopWorker(void* model, const RequestLog* log, size_t offset,
+                      int64_t deadline_us, WorkerResult* result) {
+  size_t i = offset;
+  while (NowMicros() < deadline_us) {
+    const std::string& body = (*log)[i++ % log->size()];
+    SendOne(model, body, result, NowMicros());
+  }
+}
+
+// Open loop: request k is released at start + k/qps regardless of how
+// long earlier requests took; workers claim slots from a shared counter.
+void OpenLoopWorker(void* model, const RequestLog* log, double qps,
+                    int64_t start_us, int64_t deadline_us,
+                    std::atomic<int64_t>* next_slot, WorkerResult* result) {
+  const double interval_us = 1e6 / qps;
+  while (true) {
+    int64_t slot = next_slot->fetch_add(1, std::memory_order_relaxed);
+    int64_t scheduled_us = start_us + static_cast<int64_t>(slot * interval_us);
+    if (scheduled_us >= deadline_us) return;
+    int64_t now = NowMicros();
+    if (scheduled_us > now) {
+      std::this_thread::sleep_for(
+          std::chrono::microseconds(scheduled_us - now));
+    }
+    const std::string& body = (*log)[slot % log->size()];
+    SendOne(model, body, result, scheduled_us);
+  }
+}
+
+double Percentile(std::vector<double>* sorted, double p) {
+  if (sorted->empty()) return 0.0;
+  size_t idx = std::min(sorted->size() - 1,
+                        static_cast<size_t>(sorted->size() * p));
+  return (*sorted)[idx];
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opts;
+  if (!ParseOptions(argc, argv, &opts)) return 1;
+  if (opts.model_config_path.empty()) {
+    std::cerr << "--model_config is required\n";
+    return 1;
+  }
+
+  std::ifstream config_in(opts.model_config_path);
+  if (!config_in) {
+    std::cerr << "cannot read " << opts.model_config_path << "\n";
+    return 1;
+  }
+  std::stringstream config_buf;
+  config_buf << config_in.rdbuf();
+  const std::string model_config = config_buf.str();
+
+  RequestLog log;
+  if (opts.requests_path.empty()) {
+    std::cout << "no --requests given, using a synthetic request\n";
+    log.push_back(SyntheticRequest());
+  } else if (opts.format == "pb") {
+    if (!LoadPbLog(opts.requests_path, &log)) return 1;
+  } else {
+    if (!LoadJsonLog(opts.requests_path, &log)) return 1;
+  }
+  std::cout << "loaded " << log.size() << " requests\n";
+
+  int state = 0;
+  void* model = initialize("", model_config.c_str(), &state);
+  if (state == -1) {
+    std::cerr << "initialize failed\n";
+    return 1;
+  }
+
+  WorkerResult warmup_result;
+  for (int i = 0; i < opts.warmup; ++i) {
+    SendOne(model, log[i % log.size()], &warmup_result, NowMicros());
+  }
+
+  const int64_t start_us = NowMicros();
+  const int64_t deadline_us = start_us + opts.duration_s * 1000000LL;
+  std::vector<WorkerResult> results(opts.concurrency);
+  std::vector<std::thread> workers;
+  std::atomic<int64_t> next_slot(0);
+  for (int i = 0; i < opts.concurrency; ++i) {
+    if (opts.mode == "open") {
+      workers.emplace_back(OpenLoopWorker, model, &log, opts.qps, start_us,
+                           deadline_us, &next_slot, &results[i]);
+    } else {
+      workers.emplace_back(ClosedLoopWorker, model, &log,
+                           i * (log.size() / opts.concurrency), deadline_us,
+                           &results[i]);
+    }
+  }
+  for (auto& t : workers) t.join();
+  const double elapsed_s = (NowMicros() - start_us) / 1e6;
+
+  std::vector<double> all;
+  int64_t errors = 0;
+  for (auto& r : results) {
+    all.insert(all.end(), r.latencies_ms.begin(), r.latencies_ms.end());
+    errors += r.errors;
+  }
+  std::sort(all.begin(), all.end());
+
+  std::cout << "mode=" << opts.mode << " requests=" << all.size()
+            << " errors=" << errors << " elapsed_s=" << elapsed_s
+            << " achieved_qps=" << all.size() / elapsed_s << "\n";
+  std::cout << "e2e latency ms: p50=" << Percentile(&all, 0.50)
+            << " p90=" << Percentile(&all, 0.90)
+            << " p99=" << Percentile(&all, 0.99)
+            << " p999=" << Percentile(&all, 0.999)
+            << " max=" << (all.empty() ? 0.0 : all.back()) << "\n";
+
+  // Per-stage and per-model-version breakdown from the processor itself.
+  void* stats_data = nullptr;
+  int stats_size = 0;
+  if (get_serving_stats(model, &stats_data, &stats_size) == 200) {
+    std::cout << std::string(static_cast<char*>(stats_data), stats_size)
+              << "\n";
+    free(stats_data);
+  }
+  return errors == 0 ? 0 : 2;
+}
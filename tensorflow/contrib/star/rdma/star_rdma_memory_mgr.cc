@@ -0,0 +1,141 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/contrib/star/rdma/star_rdma_memory_mgr.h"
+
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+
+namespace {
+
+bool StarRdmaTransportRequested() {
+  bool requested = false;
+  Status s = ReadBoolFromEnvVar("STAR_RDMA_TRANSPORT", false, &requested);
+  if (!s.ok()) {
+    LOG(WARNING) << s.error_message();
+  }
+  return requested;
+}
+
+} // namespace
+
+#ifdef TENSORFLOW_USE_VERBS
+
+StarRdmaMemoryMgr::StarRdmaMemoryMgr() {
+  int num_devices = 0;
+  ibv_device** dev_list = ibv_get_device_list(&num_devices);
+  if (dev_list == nullptr || num_devices == 0) {
+    LOG(WARNING) << "No RDMA device found, star RDMA transport disabled.";
+    if (dev_list != nullptr) {
+      ibv_free_device_list(dev_list);
+    }
+    return;
+  }
+  context_ = ibv_open_device(dev_list[0]);
+  ibv_free_device_list(dev_list);
+  if (context_ == nullptr) {
+    LOG(WARNING) << "Could not open RDMA device, "
+                 << "star RDMA transport disabled.";
+    return;
+  }
+  pd_ = ibv_alloc_pd(context_);
+  if (pd_ == nullptr) {
+    LOG(WARNING) << "Could not allocate protection domain, "
+                 << "star RDMA transport disabled.";
+    ibv_close_device(context_);
+    context_ = nullptr;
+  }
+}
+
+StarRdmaMemoryMgr::~StarRdmaMemoryMgr() {
+  mutex_lock l(mu_);
+  for (auto& it : mrs_) {
+    ibv_dereg_mr(it.second);
+  }
+  mrs_.clear();
+  if (pd_ != nullptr) {
+    ibv_dealloc_pd(pd_);
+  }
+  if (context_ != nullptr) {
+    ibv_close_device(context_);
+  }
+}
+
+StarRdmaMemoryMgr* StarRdmaMemoryMgr::Singleton() {
+  static StarRdmaMemoryMgr* instance = new StarRdmaMemoryMgr;
+  return instance;
+}
+
+ibv_mr* StarRdmaMemoryMgr::RegisterMemoryRegion(void* addr, size_t len) {
+  if (pd_ == nullptr) {
+    return nullptr;
+  }
+  mutex_lock l(mu_);
+  auto it = mrs_.find(addr);
+  if (it != mrs_.end()) {
+    if (it->second->length >= len) {
+      return it->second;
+    }
+    // The buffer at this address grew (e.g. an EmbeddingVar value store
+    // was reallocated in place), re-register it with the new length.
+    ibv_dereg_mr(it->second);
+    mrs_.erase(it);
+  }
+  ibv_mr* mr = ibv_reg_mr(pd_, addr, len,
+                          IBV_ACCESS_LOCAL_WRITE |
+                          IBV_ACCESS_REMOTE_WRITE |
+                          IBV_ACCESS_REMOTE_READ);
+  if (mr == nullptr) {
+    LOG(WARNING) << "ibv_reg_mr failed for a buffer of " << len << " bytes.";
+    return nullptr;
+  }
+  mrs_[addr] = mr;
+  return mr;
+}
+
+void StarRdmaMemoryMgr::DeregisterMemoryRegion(void* addr) {
+  mutex_lock l(mu_);
+  auto it = mrs_.find(addr);
+  if (it == mrs_.end()) {
+    return;
+  }
+  ibv_dereg_mr(it->second);
+  mrs_.erase(it);
+}
+
+bool StarRdmaTransportEnabled() {
+  if (!StarRdmaTransportRequested()) {
+    return false;
+  }
+  return StarRdmaMemoryMgr::Singleton()->IsAvailable();
+}
+
+#else
+
+bool StarRdmaTransportEnabled() {
+  if (StarRdmaTransportRequested()) {
+    LOG(WARNING) << "STAR_RDMA_TRANSPORT is set but tensorflow was built "
+                 << "without verbs support, falling back to the seastar "
+                 << "TCP transport.";
+  }
+  return false;
+}
+
+#endif  // TENSORFLOW_USE_VERBS
+
+} // namespace tensorflow
@@ -0,0 +1,78 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CONTRIB_STAR_RDMA_STAR_RDMA_MEMORY_MGR_H_
+#define TENSORFLOW_CONTRIB_STAR_RDMA_STAR_RDMA_MEMORY_MGR_H_
+
+#include <cstddef>
+
+#ifdef TENSORFLOW_USE_VERBS
+#include <infiniband/verbs.h>
+#include <unordered_map>
+
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#endif  // TENSORFLOW_USE_VERBS
+
+namespace tensorflow {
+
+// Returns true when the star transport should try to move tensor payloads
+// over RDMA: STAR_RDMA_TRANSPORT is set, verbs support was compiled in and
+// an RDMA-capable NIC could be opened. When it returns false the caller
+// keeps the seastar TCP path.
+bool StarRdmaTransportEnabled();
+
+#ifdef TENSORFLOW_USE_VERBS
+
+// Registration side of the star RDMA data plane. Opens the first verbs
+// device, allocates a protection domain and caches memory regions so the
+// EmbeddingVar gather/push buffers that are shipped on every step pay
+// ibv_reg_mr only once instead of once per request.
+class StarRdmaMemoryMgr {
+ public:
+  static StarRdmaMemoryMgr* Singleton();
+
+  // True iff a device was opened and a protection domain allocated.
+  bool IsAvailable() const { return pd_ != nullptr; }
+
+  // Registers [addr, addr + len) for local write and remote read/write.
+  // Returns the cached region when the same buffer was registered before,
+  // or nullptr when registration fails (the caller must fall back to the
+  // TCP path for that tensor).
+  ibv_mr* RegisterMemoryRegion(void* addr, size_t len);
+
+  // Drops the cached region for addr, e.g. when an EmbeddingVar buffer is
+  // freed. Growing buffers are handled by RegisterMemoryRegion itself.
+  void DeregisterMemoryRegion(void* addr);
+
+ private:
+  StarRdmaMemoryMgr();
+  ~StarRdmaMemoryMgr();
+
+  ibv_context* context_ = nullptr;
+  ibv_pd* pd_ = nullptr;
+
+  mutex mu_;
+  std::unordered_map<void*, ibv_mr*> mrs_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StarRdmaMemoryMgr);
+};
+
+#endif  // TENSORFLOW_USE_VERBS
+
+} // namespace tensorflow
+
+#endif // TENSORFLOW_CONTRIB_STAR_RDMA_STAR_RDMA_MEMORY_MGR_H_
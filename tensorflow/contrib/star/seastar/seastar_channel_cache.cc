@@ -13,6 +13,7 @@
 #include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/util/device_name_utils.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 namespace {
@@ -21,26 +22,58 @@ string MakeAddress(const string& job, int task) {
   return strings::StrCat("/job:", job, "/replica:0/task:", task);
 }
 
+// Number of seastar connections to open per remote target. Each extra
+// connection is assigned to a different reactor core, so large ps/worker
+// meshes can spread one pair's traffic over several cores.
+int64 ConnectionsPerPair() {
+  static int64 connections = [] {
+    int64 value = 1;
+    Status s = ReadInt64FromEnvVar("NETWORK_CONNECTIONS_PER_PAIR", 1, &value);
+    if (!s.ok()) {
+      LOG(WARNING) << "Invalid NETWORK_CONNECTIONS_PER_PAIR: " << s;
+    }
+    return std::max(value, static_cast<int64>(1));
+  }();
+  return connections;
+}
+
 class CachingSeastarChannelCache : public SeastarChannelCache {
  public:
   CachingSeastarChannelCache() {}
   ~CachingSeastarChannelCache() override {}
 
   seastar::channel* FindWorkerChannel(const string& target) override {
-    seastar::channel* ch = nullptr;
+    std::vector<seastar::channel*> channels;
+    FindWorkerChannels(target, &channels);
+    return channels.empty() ? nullptr : channels[0];
+  }
+
+  void FindWorkerChannels(const string& target,
+                          std::vector<seastar::channel*>* channels) override {
     {
       mutex_lock l(mu_);
-      ch = gtl::FindPtrOrNull(channels_, target);
-      if (ch) {
-        return ch;
+      auto it = channels_.find(target);
+      if (it != channels_.end()) {
+        *channels = it->second;
+        return;
       }
     }
-    ch = FindChannelOnce(target);
-    if (ch) {
-      mutex_lock l(mu_);
-      channels_.insert({target, ch});
+    // Each FindChannelOnce call opens a fresh connection on the next
+    // reactor core in round-robin order.
+    std::vector<seastar::channel*> created;
+    const int64 count = ConnectionsPerPair();
+    for (int64 i = 0; i < count; ++i) {
+      seastar::channel* ch = FindChannelOnce(target);
+      if (ch == nullptr) {
+        break;
+      }
+      created.push_back(ch);
+    }
+    if (created.empty()) {
+      return;
     }
-    return ch;
+    mutex_lock l(mu_);
+    *channels = channels_.emplace(target, std::move(created)).first->second;
   }
 
  protected:
@@ -48,7 +81,8 @@ class CachingSeastarChannelCache : public SeastarChannelCache {
 
  private:
   mutex mu_;
-  std::unordered_map<string, seastar::channel*> channels_ TF_GUARDED_BY(mu_);
+  std::unordered_map<string, std::vector<seastar::channel*>> channels_
+      TF_GUARDED_BY(mu_);
 };
 
 class MultiSeastarChannelCache : public CachingSeastarChannelCache {
@@ -76,6 +110,20 @@ class MultiSeastarChannelCache : public CachingSeastarChannelCache {
     }
   }
 
+  // Delegates to the sub-cache owning "target" so the per-pair connection
+  // set is built (and cached) exactly once, by that sub-cache.
+  void FindWorkerChannels(const string& target,
+                          std::vector<seastar::channel*>* channels) override {
+    for (SeastarChannelCache* cache : caches_) {
+      cache->FindWorkerChannels(target, channels);
+      if (!channels->empty()) {
+        mutex_lock l(mu_);
+        target_caches_.insert({target, cache});
+        return;
+      }
+    }
+  }
+
   string TranslateTask(const string& target) override {
     mutex_lock l(mu_);
     SeastarChannelCache* cache = gtl::FindPtrOrNull(target_caches_, target);
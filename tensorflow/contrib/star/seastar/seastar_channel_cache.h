@@ -25,6 +25,12 @@ class SeastarChannelCache {
   virtual void ListWorkersInJob(const string& job_name,
                                 std::vector<string>* workers) = 0;
   virtual seastar::channel* FindWorkerChannel(const std::string& target) = 0;
+  // Fills "channels" with every connection to "target". More than one
+  // connection per worker pair is created when NETWORK_CONNECTIONS_PER_PAIR
+  // is set; each lands on a different reactor core.
+  virtual void FindWorkerChannels(
+      const std::string& target,
+      std::vector<seastar::channel*>* channels) = 0;
   virtual std::string TranslateTask(const std::string& task) = 0;
 };
 
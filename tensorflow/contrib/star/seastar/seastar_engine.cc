@@ -8,6 +8,7 @@
 #include "tensorflow/contrib/star/seastar/seastar_engine.h"
 #include "tensorflow/contrib/star/seastar/seastar_server.h"
 #include "tensorflow/contrib/star/seastar/seastar_tag_factory.h"
+#include "tensorflow/contrib/star/star_ring_dispatcher.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/platform/logging.h"
@@ -64,6 +65,12 @@ namespace {
   }
 
   size_t GetCoreNumber(const std::string& job_name, size_t total_connections) {
+    // Dedicated polling mode reserves exactly the configured number of
+    // cores, independent of the connection count.
+    int64 dedicated_cores = DedicatedPollingCores(job_name);
+    if (dedicated_cores > 0) {
+      return dedicated_cores;
+    }
     if (total_connections == 0) {
       // NOTE(rangeng.llb): allocate one core to make seastar work correctly.
       return 1;
@@ -93,6 +100,10 @@ namespace {
 
   // By default, ps & worker disable pin core.
   bool DisablePinCores(const std::string& job_name) {
+    // Dedicated polling mode must pin: the reactors own their cores.
+    if (DedicatedPollingCores(job_name) > 0) {
+      return false;
+    }
     auto env_name = IsWorker(job_name) ?
                     "WORKER_DISABLE_PIN_CORES" :
                     "PS_DISABLE_PIN_CORES";
@@ -107,6 +118,9 @@ namespace {
 
   // By default, ps & worker disable polling.
   bool EnablePolling(const std::string& job_name) {
+    if (DedicatedPollingCores(job_name) > 0) {
+      return true;
+    }
     auto env_name = IsWorker(job_name) ?
                     "WORKER_ENABLE_POLLING" :
                     "PS_ENABLE_POLLING";
@@ -1,4 +1,5 @@
 #include <utility>
+#include <vector>
 
 #include "tensorflow/contrib/star/seastar/seastar_remote_worker.h"
 #include "tensorflow/contrib/star/seastar/seastar_client_tag.h"
@@ -11,6 +12,7 @@
 #include "tensorflow/core/distributed_runtime/worker_interface.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/hash/hash.h"
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/tracing.h"
@@ -20,10 +22,12 @@ namespace tensorflow {
 
 class SeastarRemoteWorker : public WorkerInterface, public StarWorkerInterface {
  public:
-  explicit SeastarRemoteWorker(seastar::channel* chan, WorkerCacheLogger* logger, WorkerEnv* env)
-      : seastar_channel_(chan),
+  explicit SeastarRemoteWorker(std::vector<seastar::channel*> chans,
+                               WorkerCacheLogger* logger, WorkerEnv* env)
+      : seastar_channels_(std::move(chans)),
         logger_(logger),
         env_(env) {
+    CHECK(!seastar_channels_.empty());
   }
 
   ~SeastarRemoteWorker() override {}
@@ -151,7 +155,8 @@ class SeastarRemoteWorker : public WorkerInterface, public StarWorkerInterface {
 
     IssueRequest(req_copy ? req_copy : request, response,
                  StarWorkerServiceMethod::kRecvTensor,
-                 std::move(*cb_to_use), call_opts);
+                 std::move(*cb_to_use), call_opts,
+                 Hash64(request->rendezvous_key()));
   }
 
   void FuseRecvTensorAsync(CallOptions* call_opts,
@@ -180,7 +185,9 @@ class SeastarRemoteWorker : public WorkerInterface, public StarWorkerInterface {
 
     IssueRequest(req_copy ? req_copy : request, response,
                  StarWorkerServiceMethod::kFuseRecvTensor,
-                 std::move(*cb_to_use), call_opts);
+                 std::move(*cb_to_use), call_opts,
+                 request->rendezvous_key_size() > 0
+                     ? Hash64(request->rendezvous_key(0)) : 0);
   }
 
   void LoggingAsync(const LoggingRequest* request, LoggingResponse* response,
@@ -223,37 +230,50 @@ class SeastarRemoteWorker : public WorkerInterface, public StarWorkerInterface {
   }
 
  private:
+  // Each channel is bound to a single reactor core, so steering by a
+  // stable per-stream hash keeps a request's send and its completion on
+  // one core. Control-plane requests use hash 0 (the first channel).
+  seastar::channel* PickChannel(uint64 steering_hash) {
+    if (seastar_channels_.size() == 1) {
+      return seastar_channels_[0];
+    }
+    return seastar_channels_[steering_hash % seastar_channels_.size()];
+  }
+
   void IssueRequest(const protobuf::Message* request,
                     protobuf::Message* response,
                     const StarWorkerServiceMethod method,
                     StatusCallback done,
-                    CallOptions* call_opts = nullptr) {
+                    CallOptions* call_opts = nullptr,
+                    uint64 steering_hash = 0) {
       auto tag = new SeastarClientTag(method, env_);
       InitStarClientTag(const_cast<protobuf::Message*>(request),
                            response, std::move(done), tag, call_opts);
-      tag->StartReq(seastar_channel_);
+      tag->StartReq(PickChannel(steering_hash));
     }
 
   void IssueRequest(const protobuf::Message* request,
                     StarTensorResponse* response,
                     const StarWorkerServiceMethod method,
                     StatusCallback done,
-                    CallOptions* call_opts = nullptr) {
+                    CallOptions* call_opts = nullptr,
+                    uint64 steering_hash = 0) {
     auto tag = new SeastarClientTag(method, env_, 1);
     InitStarClientTag(const_cast<protobuf::Message*>(request),
                       response, std::move(done), tag, call_opts);
-    tag->StartReq(seastar_channel_);
+    tag->StartReq(PickChannel(steering_hash));
   }
 
   void IssueRequest(const protobuf::Message* request,
                     StarFuseTensorResponse* response,
                     const StarWorkerServiceMethod method,
                     StatusCallback done,
-                    CallOptions* call_opts = nullptr) {
+                    CallOptions* call_opts = nullptr,
+                    uint64 steering_hash = 0) {
     auto tag = new SeastarClientTag(method, env_, response->GetFuseCount());
     InitStarClientTag(const_cast<protobuf::Message*>(request),
                       response, std::move(done), tag, call_opts);
-    tag->StartReq(seastar_channel_);
+    tag->StartReq(PickChannel(steering_hash));
   }
 
   void IssueRequest(StarRunGraphRequest* request,
@@ -263,12 +283,14 @@ class SeastarRemoteWorker : public WorkerInterface, public StarWorkerInterface {
     auto tag = new SeastarClientTag(method, env_,
                                     request->fetch_names_.size(),
                                     request->feed_names_.size());
+    // A partition's run-graph stream stays on the core owning its handle.
+    const uint64 steering_hash = Hash64(request->graph_handle_);
     InitStarClientTag(request, response, std::move(done), tag);
-    tag->StartReq(seastar_channel_);
+    tag->StartReq(PickChannel(steering_hash));
   }
 
 private:
-  seastar::channel* seastar_channel_;
+  std::vector<seastar::channel*> seastar_channels_;
   // Support for logging.
   WorkerCacheLogger* logger_;
   WorkerEnv* env_;
@@ -276,10 +298,11 @@ private:
   TF_DISALLOW_COPY_AND_ASSIGN(SeastarRemoteWorker);
 };
 
-WorkerInterface* NewSeastarRemoteWorker(seastar::channel* seastar_channel,
-                                        WorkerCacheLogger* logger,
-                                        WorkerEnv* env) {
-  return new SeastarRemoteWorker(seastar_channel, logger, env);
+WorkerInterface* NewSeastarRemoteWorker(
+    std::vector<seastar::channel*> seastar_channels,
+    WorkerCacheLogger* logger,
+    WorkerEnv* env) {
+  return new SeastarRemoteWorker(std::move(seastar_channels), logger, env);
 }
 
 } // namespace tensorflow
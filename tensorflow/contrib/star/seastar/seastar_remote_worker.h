@@ -1,6 +1,8 @@
 #ifndef TENSORFLOW_CONTRIB_STAR_SEASTAR_SEASTAR_REMOTE_WORKER_H_
 #define TENSORFLOW_CONTRIB_STAR_SEASTAR_SEASTAR_REMOTE_WORKER_H_
 
+#include <vector>
+
 namespace seastar {
 class channel;
 }
@@ -11,9 +13,13 @@ class WorkerInterface;
 class WorkerCacheLogger;
 struct WorkerEnv;
 
-WorkerInterface* NewSeastarRemoteWorker(seastar::channel* seastar_channel,
-                                        WorkerCacheLogger* logger,
-                                        WorkerEnv* env);
+// "seastar_channels" holds one or more connections to the same remote
+// target, each bound to a different reactor core. Requests are steered
+// onto one of them by hashing a stable per-stream key.
+WorkerInterface* NewSeastarRemoteWorker(
+    std::vector<seastar::channel*> seastar_channels,
+    WorkerCacheLogger* logger,
+    WorkerEnv* env);
 
 } // namespace tensorflow
 
@@ -36,10 +36,11 @@ public:
     if (target == local_target_) {
       return local_worker_;
     } else {
-      seastar::channel* chan = channel_cache_->FindWorkerChannel(target);
-      if (!chan) return nullptr;
-      return NewSeastarRemoteWorker(chan, &logger_, env_);
-    }    
+      std::vector<seastar::channel*> chans;
+      channel_cache_->FindWorkerChannels(target, &chans);
+      if (chans.empty()) return nullptr;
+      return NewSeastarRemoteWorker(std::move(chans), &logger_, env_);
+    }
   }
 
   void ReleaseWorker(const string& target, WorkerInterface* worker) {
@@ -381,6 +381,10 @@ void InitStarClientTag(StarRunGraphRequest* request,
                                              &tag->req_message_bufs_[i],
                                              &tag->req_tensor_bufs_[i]);
   }
+  // The memcpy-able feed tensors are sent zero-copy: the fragments built
+  // from 'req_tensor_bufs_' point at the tensor buffers. Pin them on the
+  // tag until the write completed.
+  tag->pinned_req_tensors_ = request->feed_tensors_;
   memcpy(tag->req_header_buf_.data_ + StarClientTag::kPayloadLenIndex,
          &payload_size, 8);
 
@@ -97,6 +97,12 @@ class StarClientTag {
 
   std::vector<StarBuf> resp_tensor_bufs_;
 
+  // Extra references on the feed tensors whose buffers are referenced
+  // directly by the zero-copy send fragments, so the write does not depend
+  // on the caller keeping the request alive; dropped when the tag is
+  // destroyed after the response arrived.
+  std::vector<Tensor> pinned_req_tensors_;
+
   ParseMetaDataCallback parse_meta_data_;
   ParseMessageCallback parse_message_;
   StatusCallback done_;
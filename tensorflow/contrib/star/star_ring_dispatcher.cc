@@ -0,0 +1,141 @@
+#include <unistd.h>
+
+#include "tensorflow/contrib/star/star_ring_dispatcher.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+namespace {
+const static int kIdleRoundsBeforeSleep = 64;
+const static int kConsumerSleepInUs = 50;
+
+bool IsWorker(const std::string& name) {
+  return name == "worker" || name == "chief";
+}
+
+size_t RoundUpToPowerOfTwo(size_t n) {
+  size_t p = 1;
+  while (p < n) {
+    p <<= 1;
+  }
+  return p;
+}
+} // namespace
+
+int64 DedicatedPollingCores(const std::string& job_name) {
+  auto env_name = IsWorker(job_name) ?
+                  "WORKER_DEDICATED_POLLING_CORES" :
+                  "PS_DEDICATED_POLLING_CORES";
+  int64 cores = 0;
+  auto status = ReadInt64FromEnvVar(env_name, 0, &cores);
+  if (!status.ok()) {
+    LOG(WARNING) << "Fail to get int value: " << env_name
+                 << " from env. Error msg: " << status.error_message();
+  }
+  return cores < 0 ? 0 : cores;
+}
+
+// Single-producer single-consumer ring of closures. The producer and
+// consumer cursors live on separate cache lines so the reactor's push never
+// contends with the consumer's pop.
+class StarRingDispatcher::Ring {
+public:
+  explicit Ring(size_t capacity)
+    : mask_(capacity - 1), slots_(capacity), tail_(0), head_(0) {}
+
+  // Producer side. Returns false when the ring is full.
+  bool Push(std::function<void()>* fn) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) > mask_) {
+      return false;
+    }
+    slots_[tail & mask_] = std::move(*fn);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Returns false when the ring is empty.
+  bool Pop(std::function<void()>* fn) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    *fn = std::move(slots_[head & mask_]);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+private:
+  const size_t mask_;
+  std::vector<std::function<void()>> slots_;
+  alignas(64) std::atomic_size_t tail_;
+  alignas(64) std::atomic_size_t head_;
+};
+
+StarRingDispatcher::StarRingDispatcher(thread::ThreadPool* compute_pool,
+                                       size_t num_rings,
+                                       size_t ring_capacity)
+  : compute_pool_(compute_pool), next_ring_(0), stopped_(false) {
+  CHECK_GT(num_rings, 0);
+  size_t capacity = RoundUpToPowerOfTwo(ring_capacity);
+  for (size_t i = 0; i < num_rings; ++i) {
+    rings_.emplace_back(new Ring(capacity));
+  }
+  for (size_t i = 0; i < num_rings; ++i) {
+    consumers_.emplace_back(&StarRingDispatcher::ConsumeLoop, this,
+                            rings_[i].get());
+  }
+  LOG(INFO) << "Star ring dispatcher started with " << num_rings
+            << " rings of capacity " << capacity << ".";
+}
+
+StarRingDispatcher::~StarRingDispatcher() {
+  stopped_.store(true, std::memory_order_relaxed);
+  for (auto& consumer : consumers_) {
+    consumer.join();
+  }
+}
+
+void StarRingDispatcher::Schedule(std::function<void()> fn) {
+  Ring* ring = RingForThisThread();
+  if (ring == nullptr || !ring->Push(&fn)) {
+    // All rings are owned by other threads, or the consumer fell behind;
+    // pay the pool mutex rather than block the reactor.
+    compute_pool_->Schedule(std::move(fn));
+  }
+}
+
+StarRingDispatcher::Ring* StarRingDispatcher::RingForThisThread() {
+  static thread_local StarRingDispatcher* cached_owner = nullptr;
+  static thread_local Ring* cached_ring = nullptr;
+  if (cached_owner != this) {
+    cached_owner = this;
+    size_t index = next_ring_.fetch_add(1, std::memory_order_relaxed);
+    cached_ring = index < rings_.size() ? rings_[index].get() : nullptr;
+  }
+  return cached_ring;
+}
+
+void StarRingDispatcher::ConsumeLoop(Ring* ring) {
+  std::function<void()> fn;
+  int idle_rounds = 0;
+  while (!stopped_.load(std::memory_order_relaxed)) {
+    if (ring->Pop(&fn)) {
+      compute_pool_->Schedule(std::move(fn));
+      idle_rounds = 0;
+      continue;
+    }
+    if (++idle_rounds < kIdleRoundsBeforeSleep) {
+      std::this_thread::yield();
+    } else {
+      usleep(kConsumerSleepInUs);
+    }
+  }
+  // Drain whatever the reactors pushed before shutdown.
+  while (ring->Pop(&fn)) {
+    compute_pool_->Schedule(std::move(fn));
+  }
+}
+
+} // namespace tensorflow
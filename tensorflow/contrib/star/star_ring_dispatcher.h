@@ -0,0 +1,74 @@
+#ifndef TENSORFLOW_CONTRIB_STAR_STAR_RING_DISPATCHER_H_
+#define TENSORFLOW_CONTRIB_STAR_STAR_RING_DISPATCHER_H_
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+namespace thread {
+class ThreadPool;
+} // namespace thread
+
+// Returns the number of isolated poll-mode cores to dedicate to the seastar
+// reactors for this job, or 0 when the mode is off. Configured with
+// PS_DEDICATED_POLLING_CORES / WORKER_DEDICATED_POLLING_CORES. When set, the
+// engine pins the reactors to their own cpuset, runs them in poll mode, and
+// the worker service hands tensor work to the compute pool through
+// StarRingDispatcher instead of the shared pool queue.
+int64 DedicatedPollingCores(const std::string& job_name);
+
+// Lock-free handoff between the seastar reactors and the TF compute pool.
+//
+// Scheduling directly on the compute pool takes the pool mutex, so a
+// poll-mode reactor can stall behind compute threads whenever a large apply
+// burst hammers the same queue. Instead, each reactor thread gets its own
+// single-producer single-consumer ring: the reactor only does a wait-free
+// push, and a dedicated consumer thread per ring forwards the closures into
+// the compute pool off the reactor's core.
+//
+// Rings are claimed lazily, one per producer thread, in the order threads
+// first call Schedule; with one ring per reactor every reactor gets its own.
+// Threads that arrive after all rings are claimed, and pushes that find
+// their ring full, fall back to scheduling on the pool directly so the
+// caller never blocks.
+class StarRingDispatcher {
+public:
+  StarRingDispatcher(thread::ThreadPool* compute_pool, size_t num_rings,
+                     size_t ring_capacity = kDefaultRingCapacity);
+  virtual ~StarRingDispatcher();
+
+  // Pushes fn onto the calling thread's ring. Never blocks.
+  void Schedule(std::function<void()> fn);
+
+  static const size_t kDefaultRingCapacity = 1024;
+
+private:
+  class Ring;
+
+  // Returns the ring owned by the calling thread, claiming one on first
+  // use. Returns nullptr when all rings are taken by other threads.
+  Ring* RingForThisThread();
+
+  void ConsumeLoop(Ring* ring);
+
+private:
+  thread::ThreadPool* compute_pool_; // not owned
+  std::vector<std::unique_ptr<Ring>> rings_;
+  std::atomic_size_t next_ring_;
+  std::atomic<bool> stopped_;
+  std::vector<std::thread> consumers_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StarRingDispatcher);
+};
+
+} // namespace tensorflow
+
+#endif // TENSORFLOW_CONTRIB_STAR_STAR_RING_DISPATCHER_H_
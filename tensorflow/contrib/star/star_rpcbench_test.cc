@@ -0,0 +1,212 @@
+/* Copyright 2022 The DeepRec Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// RecvTensor microbenchmark for the star transport, mirroring
+// distributed_runtime/rpcbench_test.cc so the star numbers are directly
+// comparable with the gRPC ones.
+//
+// The transport is chosen with STAR_BENCH_PROTOCOL (default
+// "star_server"; set "grpc" for the baseline), so a single binary
+// quantifies the star transport against gRPC, and later RDMA or
+// zero-copy work, without rebuilding. Reactor core counts are the
+// engine's own knobs: set NETWORK_WORKER_CORE_NUMBER before launching.
+// Benchmark args cover message size (1KB-100MB) and cluster size, which
+// controls the number of concurrent connections per step.
+
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/distributed_runtime/rpc/grpc_session.h"
+#include "tensorflow/core/distributed_runtime/server_lib.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/graph/default_device.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/protobuf/cluster.pb.h"
+#include "tensorflow/core/protobuf/tensorflow_server.pb.h"
+#include "tensorflow/core/public/session.h"
+
+namespace tensorflow {
+
+namespace {
+
+string BenchProtocol() {
+  const char* protocol = std::getenv("STAR_BENCH_PROTOCOL");
+  return protocol == nullptr ? "star_server" : string(protocol);
+}
+
+string ReactorCoresLabel() {
+  const char* cores = std::getenv("NETWORK_WORKER_CORE_NUMBER");
+  return cores == nullptr ? "default" : string(cores);
+}
+
+struct BenchCluster {
+  SessionOptions options;
+  std::vector<string> workers;
+  std::vector<DeviceAttributes> devices;  // One per server.
+  thread::ThreadPool* server_threads;
+
+  explicit BenchCluster(int n) {
+    (*options.config.mutable_device_count())["CPU"] = 1;
+    options.config.set_intra_op_parallelism_threads(1);
+    options.config.set_inter_op_parallelism_threads(1);
+
+    const string protocol = BenchProtocol();
+    std::vector<int> port(n);
+    for (int i = 0; i < n; ++i) {
+      port[i] = testing::PickUnusedPortOrDie();
+      // Sessions always speak gRPC to the master; only the
+      // worker-to-worker tensor traffic goes over the star transport.
+      workers.push_back(strings::StrCat("grpc://localhost:", port[i]));
+    }
+
+    server_threads =
+        new thread::ThreadPool(Env::Default(), "star_bench_servers", n);
+    for (int worker_idx = 0; worker_idx < n; ++worker_idx) {
+      server_threads->Schedule([this, worker_idx, n, &port, protocol] {
+        ServerDef server;
+        server.set_protocol(protocol);
+        server.set_job_name("worker");
+        server.set_task_index(worker_idx);
+
+        auto job_def = server.mutable_cluster()->add_job();
+        job_def->set_name("worker");
+        for (int i = 0; i < n; i++) {
+          (*(job_def->mutable_tasks()))[i] =
+              strings::StrCat("localhost:", port[i]);
+        }
+
+        auto config = server.mutable_default_session_config();
+        (*config->mutable_device_count())["CPU"] = 1;
+
+        std::unique_ptr<ServerInterface> svr;
+        TF_CHECK_OK(NewServer(server, &svr));
+        TF_CHECK_OK(svr->Start());
+        TF_CHECK_OK(svr->Join());
+      });
+    }
+
+    SessionOptions options_copy(options);
+    options_copy.target = workers[0];
+    std::unique_ptr<GrpcSession> session;
+    TF_CHECK_OK(GrpcSession::Create(options_copy, &session));
+    TF_CHECK_OK(session->ListDevices(&devices));
+    CHECK_GE(devices.size(), n);
+    options.target = workers[0];
+  }
+};
+
+// Servers can't be torn down cleanly mid-process, so clusters are
+// created once per size and reused across benchmarks.
+const BenchCluster* GetCluster(int n) {
+  static std::unordered_map<int, BenchCluster*>* clusters =
+      new std::unordered_map<int, BenchCluster*>;
+  auto it = clusters->find(n);
+  if (it == clusters->end()) {
+    it = clusters->emplace(n, new BenchCluster(n)).first;
+  }
+  return it->second;
+}
+
+// One step pushes x from worker 0 to every peer and the result back:
+// 2 * (num_workers - 1) tensor transfers per session run.
+GraphDef CreateRecvTensorGraph(int num_elems, const BenchCluster* cluster,
+                               int num_workers) {
+  using namespace ::tensorflow::ops;  // NOLINT(build/namespaces)
+
+  Scope s = Scope::NewRootScope();
+  Output x = Const(s.WithOpName("x").WithDevice(cluster->devices[0].name()),
+                   0.0f, {num_elems, 1});
+  std::vector<Output> echoes;
+  for (int j = 1; j < num_workers; ++j) {
+    echoes.push_back(
+        Identity(s.WithDevice(cluster->devices[j].name()), x));
+  }
+  /* Output y = */ AddN(
+      s.WithOpName("y").WithDevice(cluster->devices[0].name()), echoes);
+
+  GraphDef def;
+  TF_CHECK_OK(s.ToGraphDef(&def));
+  return def;
+}
+
+void BM_StarRecvTensorHelper(int iters, int num_workers, int64 tensor_bytes) {
+  testing::StopTiming();
+  const BenchCluster* cluster = GetCluster(num_workers);
+  const int num_elems = std::max<int64>(1, tensor_bytes / sizeof(float));
+
+  std::unique_ptr<Session> session(NewSession(cluster->options));
+  GraphDef def = CreateRecvTensorGraph(num_elems, cluster, num_workers);
+  graph::SetDefaultDevice(cluster->devices[0].name(), &def);
+  TF_CHECK_OK(session->Create(def));
+
+  std::vector<Tensor> outputs;
+  for (int i = 0; i < 3; i++) {
+    outputs.clear();
+    TF_CHECK_OK(session->Run({}, {"y:0"}, {}, &outputs));
+    CHECK_EQ(size_t{1}, outputs.size());
+  }
+
+  const int64 bytes_per_iter =
+      2 * (num_workers - 1) * num_elems * static_cast<int64>(sizeof(float));
+  testing::SetLabel(strings::StrCat(
+      "protocol=", BenchProtocol(), "; reactor_cores=", ReactorCoresLabel(),
+      "; bytes/transfer=", num_elems * sizeof(float)));
+  testing::UseRealTime();
+  testing::BytesProcessed(static_cast<int64>(iters) * bytes_per_iter);
+
+  testing::StartTiming();
+  for (int i = 0; i < iters; i++) {
+    outputs.clear();
+    TF_CHECK_OK(session->Run({}, {"y:0"}, {}, &outputs));
+  }
+  testing::StopTiming();
+  TF_CHECK_OK(session->Close());
+}
+
+// Throughput across message sizes, two workers: one connection each way.
+void BM_StarRecvTensor(int iters, int kilobytes) {
+  BM_StarRecvTensorHelper(iters, 2, static_cast<int64>(kilobytes) * 1024);
+}
+BENCHMARK(BM_StarRecvTensor)
+    ->Arg(1)
+    ->Arg(16)
+    ->Arg(256)
+    ->Arg(1 << 10)
+    ->Arg(16 << 10)
+    ->Arg(100 << 10);
+
+// Fan-out across connection counts at a fixed mid-size message.
+void BM_StarRecvTensorFanout(int iters, int num_workers) {
+  BM_StarRecvTensorHelper(iters, num_workers, 1 << 20);
+}
+BENCHMARK(BM_StarRecvTensorFanout)->Arg(2)->Arg(4)->Arg(8);
+
+// Round-trip latency: tiny tensor, single transfer pair in flight.
+void BM_StarRecvTensorLatency(int iters) {
+  BM_StarRecvTensorHelper(iters, 2, 256);
+}
+BENCHMARK(BM_StarRecvTensorLatency);
+
+}  // namespace
+}  // namespace tensorflow
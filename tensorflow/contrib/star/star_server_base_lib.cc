@@ -6,8 +6,10 @@
 #include "grpc++/security/credentials.h"
 #include "grpc++/server_builder.h"
 #include "grpc/support/alloc.h"
+#include "tensorflow/contrib/star/rdma/star_rdma_memory_mgr.h"
 #include "tensorflow/contrib/star/star_channel_spec.h"
 #include "tensorflow/contrib/star/star_rendezvous_mgr.h"
+#include "tensorflow/contrib/star/star_ring_dispatcher.h"
 #include "tensorflow/contrib/star/star_server_base_lib.h"
 #include "tensorflow/contrib/star/star_worker_service.h"
 #include "tensorflow/core/common_runtime/device_factory.h"
@@ -249,11 +251,32 @@ Status StarServerBase::Init() {
   worker_service_ = CreateWorkerService(worker_impl_);
 
   worker_env_.compute_pool = ComputePool(sess_opts);
+
+  int64 dedicated_cores =
+      DedicatedPollingCores(star_port_mgr_->get_job_name());
+  if (dedicated_cores > 0) {
+    // The reactors poll on their own isolated cores; hand tensor work to
+    // the compute pool through one SPSC ring per reactor so a busy pool
+    // never stalls the RPC path.
+    ring_dispatcher_.reset(
+        new StarRingDispatcher(worker_env_.compute_pool, dedicated_cores));
+    worker_service_->SetRingDispatcher(ring_dispatcher_.get());
+  }
+
   star_bound_port_ = star_port_mgr_->GetLocalStarPort();
   size_t server_number = ParseServers(worker_cache_factory_options);
 
   CreateEngine(server_number, star_port_mgr_->get_job_name());
 
+  if (StarRdmaTransportEnabled()) {
+    // The registration plane (NIC, protection domain and the memory region
+    // cache used for EmbeddingVar gather/push buffers) is up; the tensor
+    // payloads themselves still go through the seastar TCP engine until
+    // the write-with-imm data plane is wired into the tag send path.
+    LOG(INFO) << "RDMA device initialized for the star transport, "
+              << "tensor payloads remain on seastar TCP.";
+  }
+
   WorkerCacheInterface* worker_cache;
   TF_RETURN_IF_ERROR(
       StarWorkerCacheFactory(worker_cache_factory_options, &worker_cache));
@@ -20,6 +20,7 @@ class StarWorker;
 class StarWorkerService;
 class StarChannelSpec;
 class StarPortMgr;
+class StarRingDispatcher;
 
 class StarServerBase : public ServerInterface {
 protected:
@@ -86,6 +87,8 @@ protected:
   StarWorker* worker_impl_;
   StarWorkerService* worker_service_ = nullptr;
   StarPortMgr* star_port_mgr_ = nullptr;
+  // Present only when dedicated polling cores are configured.
+  std::unique_ptr<StarRingDispatcher> ring_dispatcher_;
 };
 
 } // namespace tensorflow
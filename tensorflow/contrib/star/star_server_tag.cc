@@ -82,6 +82,10 @@ void InitStarServerTag(protobuf::Message* request,
                                               response->GetIsDead(),
                                               &tag->resp_message_bufs_[0],
                                               &tag->resp_tensor_bufs_[0]);
+      // The tensor buffer is referenced directly by the send fragment;
+      // keep a reference until the write completed so the lifetime does
+      // not depend on when 'clear_' releases the response.
+      tag->pinned_resp_tensors_.push_back(response->GetTensor());
       memcpy(tag->resp_header_buf_.data_ + StarServerTag::kPayloadLenIndex,
              &payload_len, 8);
 
@@ -132,6 +136,9 @@ void InitStarServerTag(protobuf::Message* request,
                                                  &tag->resp_message_bufs_[idx],
                                                  &tag->resp_tensor_bufs_[idx]);
       }
+      // Same as the single-tensor case: the fused tensor buffers are sent
+      // zero-copy, pin them until the write completed.
+      tag->pinned_resp_tensors_ = response->GetTensors();
       memcpy(tag->resp_header_buf_.data_ + StarServerTag::kPayloadLenIndex,
              &payload_len, 8);
     } else {
@@ -282,6 +289,8 @@ void StarServerTag::FillRespBody() {
                                              &resp_message_bufs_[i],
                                              &resp_tensor_bufs_[i]);
   }
+  // Fetch tensor buffers are referenced directly by the send fragments.
+  pinned_resp_tensors_ = star_graph_response_.fetch_tensors_;
 
   memcpy(resp_header_buf_.data_ + StarServerTag::kPayloadLenIndex,
          &payload_len, 8);
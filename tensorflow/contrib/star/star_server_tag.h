@@ -103,6 +103,12 @@ class StarServerTag {
 
   std::vector<StarBuf> req_tensor_bufs_;
 
+  // Extra references on the response tensors whose buffers are referenced
+  // directly by the zero-copy send fragments. They guarantee the buffers
+  // outlive the scatter-gather write no matter when the response object is
+  // cleared; dropped when the tag is destroyed in SendRespDone().
+  std::vector<Tensor> pinned_resp_tensors_;
+
   StarRunGraphRequest star_graph_request_;
   StarRunGraphResponse star_graph_response_;
 
@@ -1,3 +1,4 @@
+#include "tensorflow/contrib/star/star_ring_dispatcher.h"
 #include "tensorflow/contrib/star/star_worker_service.h"
 #include "tensorflow/contrib/star/star_server_tag.h"
 #include "tensorflow/contrib/star/star_tensor_coding.h"
@@ -16,6 +17,7 @@
 #include "tensorflow/core/distributed_runtime/rendezvous_mgr_interface.h"
 #include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/public/session_options.h"
+#include "tensorflow/core/util/env_var.h"
 
 
 namespace tensorflow {
@@ -28,6 +30,22 @@ public:
   ResponseMessage resp_;
 };
 
+// When enabled, run-graph requests that fetch nothing (pure gradient
+// pushes) are applied inline on the receiving thread instead of being
+// handed off to the compute pool. The feed buffers were already filled
+// in place during receive, so the apply kernels run directly over them.
+bool FusedApplyPushEnabled() {
+  static bool enabled = [] {
+    bool value = false;
+    Status s = ReadBoolFromEnvVar("TF_STAR_FUSED_APPLY_PUSH", false, &value);
+    if (!s.ok()) {
+      LOG(WARNING) << "Invalid TF_STAR_FUSED_APPLY_PUSH: " << s;
+    }
+    return value;
+  }();
+  return enabled;
+}
+
 } // namespace
 
 using HandleRequestFunction = void (StarWorkerService::*)(StarServerTag*);
@@ -81,6 +99,19 @@ void StarWorkerService::RunGraphHandler(StarServerTag* tag) {
 }
 
 void StarWorkerService::StarRunGraphHandler(StarServerTag* tag) {
+  if (FusedApplyPushEnabled() &&
+      tag->star_graph_request_.fetch_names_.empty()) {
+    // Fused recv-and-apply: nothing is fetched, so skip the compute-pool
+    // handoff and run the apply graph straight over the received buffers.
+    worker_->StarRunGraphAsync(&(tag->star_graph_request_),
+                               &(tag->star_graph_response_),
+                               [this, tag](const Status& s) {
+      auto step_id = tag->star_graph_request_.step_id_;
+      tag->ProcessDone(s);
+      worker_->Cleanup(step_id);
+    });
+    return;
+  }
   Schedule([this, tag]() {
     worker_->StarRunGraphAsync(&(tag->star_graph_request_),
                                &(tag->star_graph_response_),
@@ -261,6 +292,10 @@ void StarWorkerService::FuseRecvTensorHandlerRaw(StarServerTag *tag) {
 }
 
 void StarWorkerService::Schedule(std::function<void()> f) {
+  if (ring_dispatcher_ != nullptr) {
+    ring_dispatcher_->Schedule(std::move(f));
+    return;
+  }
   worker_->env()->compute_pool->Schedule(std::move(f));
 }
 
@@ -273,13 +308,17 @@ WorkerEnv* StarWorker::env() {
 }
 
 StarWorker::StarWorker(WorkerEnv* worker_env)
-    : Worker(worker_env), cancel_mgr_(new CancellationManager) {
+    : Worker(worker_env) {
+  for (StepShard& shard : step_shards_) {
+    shard.cancel_mgr = new CancellationManager;
+  }
 }
 
 void StarWorker::Cleanup(int64 step_id) {
+  StepShard* shard = Shard(step_id);
   if (env()->lockless) {
-    if (--pending_graph_count_[step_id] == 0) {
-      pending_graph_count_.erase(step_id);
+    if (--shard->pending_graph_count[step_id] == 0) {
+      shard->pending_graph_count.erase(step_id);
       env()->rendezvous_mgr->Cleanup(step_id);
     }
     return;
@@ -287,10 +326,10 @@ void StarWorker::Cleanup(int64 step_id) {
 
   int left = -1;
   {
-    mutex_lock l(graph_count_mu_);
-    left = --pending_graph_count_[step_id];
+    mutex_lock l(shard->mu);
+    left = --shard->pending_graph_count[step_id];
     if (left == 0) {
-      pending_graph_count_.erase(step_id);
+      shard->pending_graph_count.erase(step_id);
     }
   }
   if (left == 0) {
@@ -308,16 +347,17 @@ void StarWorker::StarRunGraphAsync(StarRunGraphRequest* request,
   const int64 step_id = request->step_id_;
   WorkerSession* session = env_->session_mgr->LegacySession().get();
 
+  StepShard* shard = Shard(step_id);
   if (env()->lockless) {
-    if (pending_graph_count_.find(step_id) ==
-        pending_graph_count_.end()) {
-        pending_graph_count_[step_id] = request->ps_graph_count_;
+    if (shard->pending_graph_count.find(step_id) ==
+        shard->pending_graph_count.end()) {
+        shard->pending_graph_count[step_id] = request->ps_graph_count_;
     }
   } else {
-    mutex_lock l(graph_count_mu_);
-    if (pending_graph_count_.find(step_id) ==
-        pending_graph_count_.end()) {
-        pending_graph_count_[step_id] = request->ps_graph_count_;
+    mutex_lock l(shard->mu);
+    if (shard->pending_graph_count.find(step_id) ==
+        shard->pending_graph_count.end()) {
+        shard->pending_graph_count[step_id] = request->ps_graph_count_;
     }
   }
 
@@ -358,9 +398,9 @@ void StarWorker::StarRunGraphAsync(StarRunGraphRequest* request,
   });
   CancellationToken token;
   {
-    mutex_lock l(mu_cm_);
-    token = cancel_mgr_->get_cancellation_token();
-    bool already_cancelled = !cancel_mgr_->RegisterCallback(
+    mutex_lock l(shard->mu);
+    token = shard->cancel_mgr->get_cancellation_token();
+    bool already_cancelled = !shard->cancel_mgr->RegisterCallback(
         token, [cm]() { cm->StartCancel(); });
     if (already_cancelled) {
       opts->ClearCancelCallback();
@@ -376,18 +416,19 @@ void StarWorker::StarRunGraphAsync(StarRunGraphRequest* request,
   session->graph_mgr->ExecuteAsync(
       request->graph_handle_, step_id, session, exec_opts,
       collector, nullptr, cm, in, is_send_dead,
-       [this, step_id, response, session, cm, out, token, collector, opts, done
-       ](Status s) {
+       [this, shard, step_id, response, session, cm, out, token, collector,
+        opts, done](Status s) {
 
         std::map<std::string, bool> is_out_dead;
-        if (s.ok()) {
+        // Pure pushes fetch nothing; skip the rendezvous round trip.
+        if (s.ok() && !out->empty()) {
           s = session->graph_mgr->RecvOutputs(step_id, out, &is_out_dead);
         }
 
         opts->ClearCancelCallback();
         {
-          mutex_lock l(mu_cm_);
-          cancel_mgr_->DeregisterCallback(token);
+          mutex_lock l(shard->mu);
+          shard->cancel_mgr->DeregisterCallback(token);
         }
         delete cm;
 
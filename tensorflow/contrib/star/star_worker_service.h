@@ -3,6 +3,7 @@
 
 #include <map>
 #include <memory>
+#include <unordered_map>
 
 #include "tensorflow/contrib/star/star_worker_interface.h"
 #include "tensorflow/contrib/star/star_worker_service_method.h"
@@ -12,6 +13,7 @@
 
 namespace tensorflow {
 
+class StarRingDispatcher;
 class StarServerTag;
 class CallOptions;
 class RecvTensorRequest;
@@ -42,10 +44,19 @@ class StarWorker : public Worker, public StarWorkerInterface {
   virtual void Cleanup(int64 step_id);
 
  private:
-  mutex mu_cm_;
-  CancellationManager* cancel_mgr_ GUARDED_BY(mu_cm_);
-  mutex graph_count_mu_;
-  std::unordered_map<int64, int> pending_graph_count_ GUARDED_BY(graph_count_mu_);
+  // Per-step state (cancellation registration and pending graph counts)
+  // is sharded by step id so concurrent run-graph dispatches from many
+  // workers do not serialize on a single lock.
+  static constexpr int kNumStepShards = 8;
+  struct StepShard {
+    mutex mu;
+    CancellationManager* cancel_mgr GUARDED_BY(mu);
+    std::unordered_map<int64, int> pending_graph_count GUARDED_BY(mu);
+  };
+  StepShard* Shard(int64 step_id) {
+    return &step_shards_[static_cast<uint64>(step_id) % kNumStepShards];
+  }
+  StepShard step_shards_[kNumStepShards];
 };
 
 class StarWorkerService {
@@ -77,12 +88,20 @@ public:
   void FuseRecvTensorHandlerRaw(StarServerTag* tag);
   StarWorker* GetWorker() const;
 
+  // Routes the compute handoff through per-reactor SPSC rings instead of
+  // the shared pool queue. Set when dedicated polling cores are configured;
+  // the dispatcher is owned by the server.
+  void SetRingDispatcher(StarRingDispatcher* dispatcher) {
+    ring_dispatcher_ = dispatcher;
+  }
+
 private:
   virtual void Schedule(std::function<void()> f);
 
 private:
   std::map<StarWorkerServiceMethod, HandleRequestFunction> handler_map_;
   StarWorker* worker_;
+  StarRingDispatcher* ring_dispatcher_ = nullptr; // not owned
 
   TF_DISALLOW_COPY_AND_ASSIGN(StarWorkerService);
 };
@@ -169,6 +169,20 @@ class Device : public DeviceBase {
     return Status::OK();
   }
 
+  // "graph" is the graph that is about to be executed on this device.
+  // Devices that run different nodes of the graph on different
+  // DeviceContexts (e.g. a GPU executing independent subgraphs on separate
+  // streams) fill "device_context_map", indexed by Node::id(), with the
+  // context to use for each node. Devices that run the whole graph on the
+  // context returned by TryGetDeviceContext leave the map empty.
+  //
+  // The caller takes ownership of one reference on every DeviceContext*
+  // placed in the map and should call Unref() on each.
+  virtual Status FillContextMap(const Graph* /*graph*/,
+                                DeviceContextMap* /*device_context_map*/) {
+    return Status::OK();
+  }
+
   // Returns the op segment of this device.  The caller can reuse op
   // kernels registered for the same session running on this device.
   OpSegment* op_segment() { return &op_seg_; }
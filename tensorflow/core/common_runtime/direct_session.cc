@@ -15,7 +15,9 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/direct_session.h"
 
+#include <algorithm>
 #include <atomic>
+#include <cmath>
 #include <string>
 #include <vector>
 #include <memory>
@@ -92,6 +94,18 @@ auto* direct_session_runs = monitoring::Counter<0>::New(
     "/tensorflow/core/direct_session_runs",
     "The number of times DirectSession::Run() has been called.");
 
+// Applies the spin-then-park policy configured on `thread_pool_options`
+// to a freshly created pool.
+void ConfigureSpinPolicy(const SessionOptions& options,
+                         const ThreadPoolOptionProto& thread_pool_options,
+                         thread::ThreadPool* pool) {
+  if (thread_pool_options.adaptive_spin()) {
+    pool->EnableAdaptiveSpin(options.env);
+  } else if (thread_pool_options.spin_count() != 0) {
+    pool->SetSpinCount(std::max(thread_pool_options.spin_count(), 0));
+  }
+}
+
 Status NewThreadPoolFromThreadPoolOptions(
     const SessionOptions& options,
     const ThreadPoolOptionProto& thread_pool_options, int pool_number,
@@ -109,6 +123,7 @@ Status NewThreadPoolFromThreadPoolOptions(
         options.env, ThreadOptions(), strings::StrCat("Compute", pool_number),
         num_threads, !options.config.experimental().disable_thread_spinning(),
         /*allocator=*/nullptr);
+    ConfigureSpinPolicy(options, thread_pool_options, *pool);
     *owned = true;
     return Status::OK();
   }
@@ -126,6 +141,7 @@ Status NewThreadPoolFromThreadPoolOptions(
         options.env, ThreadOptions(), strings::StrCat("Compute", pool_number),
         num_threads, !options.config.experimental().disable_thread_spinning(),
         /*allocator=*/nullptr);
+    ConfigureSpinPolicy(options, thread_pool_options, mvalue->second);
   } else {
     if (mvalue->first != thread_pool_options.num_threads()) {
       return errors::InvalidArgument(
@@ -158,9 +174,62 @@ string GetRendezvousKey(const string& tensor_name,
                          frame_iter.frame_id, ":", frame_iter.iter_id);
 }
 
+// Parse user specified cpu cores for each session in the group from
+// TF_SESSION_GROUP_CPUSETS, sessions are separated by ';' and cores
+// in one session can be single cores or ranges, for example
+// "0-7,32-39;8-15;16-23" describes a group with 3 sessions.
+bool ParseCpusetsFromEnvironment(
+    int session_num,
+    std::vector<std::vector<unsigned> >& visible_cpus_per_session) {
+  const char* cpusets_env = std::getenv("TF_SESSION_GROUP_CPUSETS");
+  if (cpusets_env == nullptr) {
+    return false;
+  }
+  std::vector<std::vector<unsigned> > cpus_per_session;
+  for (const string& session_spec : str_util::Split(cpusets_env, ';')) {
+    std::vector<unsigned> cpus;
+    for (const string& range_spec : str_util::Split(session_spec, ',')) {
+      int32 start = -1, end = -1;
+      std::vector<string> bounds = str_util::Split(range_spec, '-');
+      if (bounds.size() == 1 && strings::safe_strto32(bounds[0], &start)) {
+        end = start;
+      } else if (bounds.size() != 2 ||
+                 !strings::safe_strto32(bounds[0], &start) ||
+                 !strings::safe_strto32(bounds[1], &end)) {
+        start = -1;
+      }
+      if (start < 0 || end < start) {
+        LOG(WARNING) << "Invalid cpu range '" << range_spec
+                     << "' in TF_SESSION_GROUP_CPUSETS, ignore the env.";
+        return false;
+      }
+      for (int32 c = start; c <= end; ++c) {
+        cpus.push_back(c);
+      }
+    }
+    if (cpus.empty()) {
+      LOG(WARNING) << "Empty cpuset in TF_SESSION_GROUP_CPUSETS,"
+                   << " ignore the env.";
+      return false;
+    }
+    cpus_per_session.push_back(cpus);
+  }
+  if (cpus_per_session.size() != static_cast<size_t>(session_num)) {
+    LOG(WARNING) << "TF_SESSION_GROUP_CPUSETS has "
+                 << cpus_per_session.size() << " cpusets but session group"
+                 << " needs " << session_num << ", ignore the env.";
+    return false;
+  }
+  visible_cpus_per_session = std::move(cpus_per_session);
+  return true;
+}
+
 // TODO: Any better allocate policy?
 void AllocateVisibleCpusForSession(const std::vector<unsigned>& visible_cpus, int session_num,
                                    std::vector<std::vector<unsigned> >& visible_cpus_per_session) {
+  if (ParseCpusetsFromEnvironment(session_num, visible_cpus_per_session)) {
+    return;
+  }
   if (session_num > 0) {
     int cpus_count_per_session = visible_cpus.size() / session_num;
     for (int i = 0; i < session_num; ++i) {
@@ -175,6 +244,20 @@ void AllocateVisibleCpusForSession(const std::vector<unsigned>& visible_cpus, in
   }
 }
 
+// True iff the step-time anomaly watchdog is enabled via
+// TF_STEP_TIME_WATCHDOG=1 (checked once).
+bool StepTimeWatchdogEnabled() {
+  static bool enabled = [] {
+    bool value = false;
+    Status s = ReadBoolFromEnvVar("TF_STEP_TIME_WATCHDOG", false, &value);
+    if (!s.ok()) {
+      LOG(WARNING) << s.error_message();
+    }
+    return value;
+  }();
+  return enabled;
+}
+
 }  // namespace
 
 class DirectSessionFactory : public SessionFactory {
@@ -231,7 +314,8 @@ class DirectSessionFactory : public SessionFactory {
 
   Status NewSessionGroup(const SessionOptions& options,
                          SessionGroup** out_session_group,
-                         int session_num = 1) {
+                         int session_num = 1,
+                         ResourceMgr* shared_cpu_rmgr = nullptr) override {
     if (session_num < 1) {
       return errors::InvalidArgument(
           "Must specify session_num of NewSessionGroup");
@@ -298,8 +382,12 @@ class DirectSessionFactory : public SessionFactory {
                                   visible_cpus_per_session);
 #endif  // TENSORFLOW_USE_NUMA
 
-    // Create shared resource for cpu devices
-    ResourceMgr* shared_rmgr = new ResourceMgr("localhost");
+    // Create shared resource for cpu devices. A caller-provided
+    // manager carries the previous group's stateful resources (e.g.
+    // initialized lookup tables) into this one; ownership moves to
+    // the new group either way.
+    ResourceMgr* shared_rmgr =
+        shared_cpu_rmgr ? shared_cpu_rmgr : new ResourceMgr("localhost");
     DeviceResourceMgrMap dev_rmgr_map;
     std::string dev_prefix("/job:localhost/replica:0/task:0");
     dev_rmgr_map.device_rmgr_map[dev_prefix+"/device:CPU:0"] = shared_rmgr;
@@ -323,6 +411,11 @@ class DirectSessionFactory : public SessionFactory {
     DeviceGlobalThreadPoolOptions dev_global_tp_opt;
     dev_global_tp_opt.global_threadpool_num = session_num;
     dev_global_tp_opt.device_threadpool_index = 0;
+#ifdef TENSORFLOW_USE_NUMA
+    // Each session's intra-op threadpool is pinned on the session's
+    // visible cpus.
+    dev_global_tp_opt.visible_cpus = visible_cpus_per_session[0];
+#endif  // TENSORFLOW_USE_NUMA
     std::vector<std::unique_ptr<Device>> devices;
     TF_RETURN_IF_ERROR(DeviceFactory::AddDevices(
         options, "/job:localhost/replica:0/task:0",
@@ -335,8 +428,12 @@ class DirectSessionFactory : public SessionFactory {
 #endif // GOOGLE_CUDA
     DeviceMgr* device_mgr = new DeviceMgr(std::move(devices));
 
-    SessionGroup* session_group =
+    DirectSessionGroup* session_group =
         new DirectSessionGroup(shared_rmgr, gpu_shared_rmgr);
+    bool share_group_kernels = true;
+    ReadBoolFromEnvVar("TF_SESSION_GROUP_SHARED_KERNELS", true,
+                       &share_group_kernels).IgnoreError();
+    share_group_kernels = share_group_kernels && session_num > 1;
     SessionOptions leader_options = options;
 #if GOOGLE_CUDA
     if (use_multi_stream) {
@@ -353,9 +450,15 @@ class DirectSessionFactory : public SessionFactory {
     DirectSession* leader_session =
         new DirectSession(leader_options, device_mgr, true, this);
 #endif  // TENSORFLOW_USE_NUMA
+    if (share_group_kernels) {
+      leader_session->SetGroupKernelCache(session_group->kernel_cache());
+    }
     session_group->CreateLeaderSession(leader_session);
     for (int i = 1; i < session_num; ++i) {
       dev_global_tp_opt.device_threadpool_index = i;
+#ifdef TENSORFLOW_USE_NUMA
+      dev_global_tp_opt.visible_cpus = visible_cpus_per_session[i];
+#endif  // TENSORFLOW_USE_NUMA
       std::vector<std::unique_ptr<Device>> dev;
       TF_RETURN_IF_ERROR(DeviceFactory::AddDevices(
           options, "/job:localhost/replica:0/task:0", &dev,
@@ -391,6 +494,9 @@ class DirectSessionFactory : public SessionFactory {
       DirectSession* follower_session =
           new DirectSession(follower_options, dev_mgr, true, this);
 #endif  // TENSORFLOW_USE_NUMA
+      if (share_group_kernels) {
+        follower_session->SetGroupKernelCache(session_group->kernel_cache());
+      }
       session_group->CreateFollowerSession(follower_session);
       {
         mutex_lock l(sessions_lock_);
@@ -572,6 +678,7 @@ DirectSession::DirectSession(const SessionOptions& options,
 
   bool use_cost_model_executor = false;
   bool use_inline_executor = false;
+  bool use_work_stealing_executor = false;
   bool pin_threadpool_to_cpu_core = false;
   Status s =
       ReadBoolFromEnvVar("USE_COST_MODEL_EXECUTOR", false, &use_cost_model_executor);
@@ -582,6 +689,11 @@ DirectSession::DirectSession(const SessionOptions& options,
   if (!s.ok()) {
     LOG(FATAL) << s.error_message();
   }
+  s = ReadBoolFromEnvVar("USE_WORK_STEALING_EXECUTOR", false,
+                         &use_work_stealing_executor);
+  if (!s.ok()) {
+    LOG(FATAL) << s.error_message();
+  }
   s = ReadBoolFromEnvVar("SET_SESSION_THREAD_POOL_AFFINITY", false,
                          &pin_threadpool_to_cpu_core);
   if (!s.ok()) {
@@ -595,6 +707,10 @@ DirectSession::DirectSession(const SessionOptions& options,
   } else if (options_.config.executor_policy() ==
              ExecutorPolicy::USE_INLINE_EXECUTOR || use_inline_executor) {
     run_in_caller_thread_ = true;
+  } else if (options_.config.executor_policy() ==
+             ExecutorPolicy::USE_WORK_STEALING_EXECUTOR ||
+             use_work_stealing_executor) {
+    run_work_stealing_executor_ = true;
   }
 
   // The default value of sync_on_finish will be flipped soon and this
@@ -775,6 +891,8 @@ Status DirectSession::RunInternal(
     const thread::ThreadPoolOptions& threadpool_options) {
   const uint64 start_time_usecs = options_.env->NowMicros();
   const int64 executor_step_count = executors_and_keys->step_count.fetch_add(1);
+  const bool watchdog_capture =
+      StepTimeWatchdogEnabled() && watchdog_capture_next_.exchange(false);
   RunState run_state(step_id, &devices_);
 
   profiler::TraceMe activity(
@@ -863,6 +981,8 @@ Status DirectSession::RunInternal(
     args.executor_policy = ExecutorPolicy::USE_INLINE_EXECUTOR;
   } else if (run_cost_model_executor_) {
     args.executor_policy = ExecutorPolicy::USE_COST_MODEL_EXECUTOR;
+  } else if (run_work_stealing_executor_) {
+    args.executor_policy = ExecutorPolicy::USE_WORK_STEALING_EXECUTOR;
   } else {
     args.executor_policy = ExecutorPolicy::USE_NORMAL_EXECUTOR;
   }
@@ -881,11 +1001,18 @@ Status DirectSession::RunInternal(
           ((measure_step_count + 1) % build_cost_model_every == 0);
     }
   }
+  StepStats watchdog_step_stats;
   if (do_trace || update_cost_model ||
       run_options.report_tensor_allocations_upon_oom()) {
     run_state.collector.reset(
         new StepStatsCollector(run_metadata->mutable_step_stats()));
     args.stats_collector = run_state.collector.get();
+  } else if (watchdog_capture) {
+    // One-shot capture armed by the watchdog after an anomalous step:
+    // collect stats for this step without touching the caller's
+    // RunMetadata.
+    run_state.collector.reset(new StepStatsCollector(&watchdog_step_stats));
+    args.stats_collector = run_state.collector.get();
   }
 
   std::unique_ptr<ProfilerSession> profiler_session;
@@ -1001,10 +1128,12 @@ Status DirectSession::RunInternal(
     item.executor->RunAsync(args, barrier->Get());
   }
 
+  watchdog_inflight_steps_.fetch_add(1);
   WaitForNotification(&run_state, &step_cancellation_manager,
                       run_options.timeout_in_ms() > 0
                           ? run_options.timeout_in_ms()
                           : operation_timeout_in_ms_);
+  watchdog_inflight_steps_.fetch_sub(1);
 
   if (!cancellation_manager_->DeregisterCallback(cancellation_token)) {
     // The step has been cancelled: make sure we don't attempt to receive the
@@ -1033,6 +1162,9 @@ Status DirectSession::RunInternal(
   if (run_state.collector) {
     run_state.collector->Finalize();
   }
+  if (watchdog_capture && watchdog_step_stats.dev_stats_size() > 0) {
+    WatchdogDumpStepStats(step_id, watchdog_step_stats);
+  }
 
   // Build and return the cost model as instructed.
   if (update_cost_model) {
@@ -1066,11 +1198,82 @@ Status DirectSession::RunInternal(
       exec_and_lib.graph->ToGraphDef(partition_graph_def);
     }
   }
-  metrics::UpdateGraphExecTime(options_.env->NowMicros() - start_time_usecs);
+  const uint64 elapsed_usecs = options_.env->NowMicros() - start_time_usecs;
+  metrics::UpdateGraphExecTime(elapsed_usecs);
+  if (StepTimeWatchdogEnabled()) {
+    WatchdogRecordStep(elapsed_usecs, pool);
+  }
 
   return Status::OK();
 }
 
+void DirectSession::WatchdogRecordStep(uint64 elapsed_usecs,
+                                       thread::ThreadPool* pool) {
+  // Warm-up steps prime the estimate but never fire: early steps pay
+  // one-time costs (kernel instantiation, allocator growth) that would
+  // otherwise poison the baseline.
+  static const int64 kWarmupSteps = 64;
+  static const double kDecay = 0.99;
+  static const double kSigmas = 3.0;
+
+  double mean, var;
+  int64 steps;
+  {
+    mutex_lock l(watchdog_mu_);
+    const double diff =
+        static_cast<double>(elapsed_usecs) - watchdog_mean_usecs_;
+    watchdog_mean_usecs_ += (1.0 - kDecay) * diff;
+    watchdog_var_usecs_ =
+        kDecay * (watchdog_var_usecs_ + (1.0 - kDecay) * diff * diff);
+    steps = ++watchdog_steps_;
+    mean = watchdog_mean_usecs_;
+    var = watchdog_var_usecs_;
+  }
+  if (steps <= kWarmupSteps) return;
+  const double threshold = mean + kSigmas * std::sqrt(var);
+  if (static_cast<double>(elapsed_usecs) <= threshold) return;
+
+  LOG(WARNING) << "Step-time watchdog: slow step of " << elapsed_usecs
+               << " us (mean " << static_cast<int64>(mean) << " us, threshold "
+               << static_cast<int64>(threshold) << " us, "
+               << watchdog_inflight_steps_.load()
+               << " step(s) in flight); stats will be captured for the"
+               << " next step.";
+  watchdog_capture_next_ = true;
+
+  // Executor ready queues are not observable from here, so probe the
+  // inter-op pool instead: the time until a no-op closure gets a thread
+  // reflects the depth of work queued ahead of it.
+  if (pool != nullptr) {
+    Env* env = options_.env;
+    const uint64 enqueued_usecs = env->NowMicros();
+    pool->Schedule([env, enqueued_usecs]() {
+      LOG(WARNING) << "Step-time watchdog: inter-op pool probe ran after "
+                   << env->NowMicros() - enqueued_usecs << " us in queue.";
+    });
+  }
+}
+
+void DirectSession::WatchdogDumpStepStats(int64 step_id,
+                                          const StepStats& step_stats) {
+  string dir;
+  Status s = ReadStringFromEnvVar("TF_STEP_TIME_WATCHDOG_DIR", "/tmp", &dir);
+  if (!s.ok()) {
+    LOG(WARNING) << s.error_message();
+    return;
+  }
+  options_.env->RecursivelyCreateDir(dir).IgnoreError();
+  const string fname = strings::StrCat(dir, "/watchdog_step_stats_",
+                                       session_handle_, "_", step_id,
+                                       ".pbtxt");
+  s = WriteTextProto(options_.env, fname, step_stats);
+  if (s.ok()) {
+    LOG(WARNING) << "Step-time watchdog: wrote step stats to " << fname;
+  } else {
+    LOG(WARNING) << "Step-time watchdog: failed to write step stats: " << s;
+  }
+}
+
 bool DirectSession::EnableTensorPoolTracking(ExecutorsAndKeys* executors_and_keys) {
   static std::unordered_map<ExecutorsAndKeys*, bool> has_training_graph;
   if (has_training_graph.find(executors_and_keys) == has_training_graph.end()) {
@@ -1231,6 +1434,8 @@ Status DirectSession::PRunSetup(const std::vector<string>& input_names,
     args.executor_policy = ExecutorPolicy::USE_INLINE_EXECUTOR;
   } else if (run_cost_model_executor_) {
     args.executor_policy = ExecutorPolicy::USE_COST_MODEL_EXECUTOR;
+  } else if (run_work_stealing_executor_) {
+    args.executor_policy = ExecutorPolicy::USE_WORK_STEALING_EXECUTOR;
   } else {
     args.executor_policy = ExecutorPolicy::USE_NORMAL_EXECUTOR;
   }
@@ -1647,13 +1852,27 @@ Status DirectSession::CreateExecutors(
     params.session_metadata = session_metadata;
     params.function_library = lib;
     auto opseg = device->op_segment();
-    params.create_kernel = [this, lib, opseg](const NodeDef& ndef,
-                                              OpKernel** kernel) {
+    params.create_kernel = [this, lib, opseg, device](const NodeDef& ndef,
+                                                      OpKernel** kernel) {
       // NOTE(mrry): We must not share function kernels (implemented
       // using `CallOp`) between subgraphs, because `CallOp::handle_`
       // is tied to a particular subgraph. Even if the function itself
       // is stateful, the `CallOp` that invokes it is not.
       if (!OpSegment::ShouldOwnKernel(lib, ndef.op())) {
+        // Stateless non-function kernels are immutable once constructed
+        // (they already run concurrently across steps), so the sessions of
+        // a group share one instance per node signature. GPU kernels stay
+        // per session: they may bind per-stream state at construction.
+        if (group_kernel_cache_ != nullptr &&
+            device->device_type() == DEVICE_CPU &&
+            lib->GetFunctionLibraryDefinition()->Find(ndef.op()) == nullptr) {
+          auto create_fn = [lib, &ndef](OpKernel** kernel) {
+            return lib->CreateKernel(ndef, kernel);
+          };
+          return group_kernel_cache_->FindOrCreate(
+              strings::StrCat(device->name(), "/", ndef.ShortDebugString()),
+              kernel, create_fn);
+        }
         return lib->CreateKernel(ndef, kernel);
       }
       auto create_fn = [lib, &ndef](OpKernel** kernel) {
@@ -1665,7 +1884,11 @@ Status DirectSession::CreateExecutors(
       return opseg->FindOrCreate(session_handle_, ndef.name(), kernel,
                                  create_fn);
     };
-    params.delete_kernel = [lib](OpKernel* kernel) {
+    params.delete_kernel = [this, lib](OpKernel* kernel) {
+      if (kernel && group_kernel_cache_ != nullptr &&
+          group_kernel_cache_->Owns(kernel)) {
+        return;  // Freed when the group's kernel cache goes away.
+      }
       if (kernel && !OpSegment::ShouldOwnKernel(lib, kernel->type_string()))
         delete kernel;
     };
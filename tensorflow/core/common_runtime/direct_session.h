@@ -52,6 +52,7 @@ class CostModel;
 class DebugGateway;
 class Device;
 class DirectSessionFactory;
+class GroupKernelCache;
 
 class DirectSession : public Session {
  public:
@@ -135,6 +136,13 @@ class DirectSession : public Session {
 
   const SessionOptions& options() const { return options_; }
 
+  // Set by DirectSessionFactory when this session joins a session group:
+  // stateless non-function CPU kernels are then fetched from the group-wide
+  // cache instead of being instantiated once per member session.
+  void SetGroupKernelCache(std::shared_ptr<GroupKernelCache> cache) {
+    group_kernel_cache_ = std::move(cache);
+  }
+
  private:
   // For access to collective_graph_key_.
   friend class DirectSessionCollectiveTest;
@@ -379,6 +387,9 @@ class DirectSession : public Session {
   SessionState session_state_;
 
   DirectSessionFactory* const factory_;  // not owned
+  // Kernel instances shared with the other sessions of this session's
+  // group; null outside of session group mode.
+  std::shared_ptr<GroupKernelCache> group_kernel_cache_;
   CancellationManager* cancellation_manager_;
   std::unique_ptr<CollectiveExecutorMgrInterface> collective_executor_mgr_;
 
@@ -415,6 +426,22 @@ class DirectSession : public Session {
   // Manages all the cost models for the graphs executed in this session.
   CostModelManager cost_model_manager_;
 
+  // Step-time anomaly watchdog (TF_STEP_TIME_WATCHDOG=1). Folds each
+  // step's wall time into an exponential moving average and variance; a
+  // step slower than mean + 3 sigma logs the anomaly, probes the
+  // inter-op pool's scheduling delay and arms a one-shot step stats
+  // capture of the next step, dumped as text proto under
+  // TF_STEP_TIME_WATCHDOG_DIR (default /tmp).
+  void WatchdogRecordStep(uint64 elapsed_usecs, thread::ThreadPool* pool);
+  void WatchdogDumpStepStats(int64 step_id, const StepStats& step_stats);
+
+  mutex watchdog_mu_;
+  double watchdog_mean_usecs_ GUARDED_BY(watchdog_mu_) = 0;
+  double watchdog_var_usecs_ GUARDED_BY(watchdog_mu_) = 0;
+  int64 watchdog_steps_ GUARDED_BY(watchdog_mu_) = 0;
+  std::atomic<bool> watchdog_capture_next_ = {false};
+  std::atomic<int64> watchdog_inflight_steps_ = {0};
+
   // For testing collective graph key generation.
   mutex collective_graph_key_lock_;
   int64 collective_graph_key_ GUARDED_BY(collective_graph_key_lock_) = -1;
@@ -434,6 +461,10 @@ class DirectSession : public Session {
   // If true, will use cost_model_executor to run the graph.
   bool run_cost_model_executor_ = false;
 
+  // If true, ready nodes are dispatched to the inter-op pool in
+  // half-splitting batches instead of one task per node.
+  bool run_work_stealing_executor_ = false;
+
   TF_DISALLOW_COPY_AND_ASSIGN(DirectSession);
 
   // EXPERIMENTAL: debugger (tfdbg) related
@@ -13,11 +13,45 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <thread>
+
 #include "tensorflow/core/common_runtime/direct_session_group.h"
+#include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/resource_mgr.h"
 
 namespace tensorflow {
 
+GroupKernelCache::~GroupKernelCache() {
+  mutex_lock l(mu_);
+  for (auto& entry : kernels_) {
+    delete entry.second;
+  }
+  kernels_.clear();
+  owned_.clear();
+}
+
+Status GroupKernelCache::FindOrCreate(const string& key, OpKernel** kernel,
+                                      KernelCreator create_fn) {
+  // The lock is held across creation, like OpSegment does: concurrent
+  // executor construction in sibling sessions must not race to build the
+  // same kernel twice.
+  mutex_lock l(mu_);
+  auto it = kernels_.find(key);
+  if (it != kernels_.end()) {
+    *kernel = it->second;
+    return Status::OK();
+  }
+  TF_RETURN_IF_ERROR(create_fn(kernel));
+  kernels_.emplace(key, *kernel);
+  owned_.insert(*kernel);
+  return Status::OK();
+}
+
+bool GroupKernelCache::Owns(const OpKernel* kernel) const {
+  mutex_lock l(mu_);
+  return owned_.count(kernel) > 0;
+}
+
 DirectSessionGroup::DirectSessionGroup()
     : cpu_shared_resource_mgr_(nullptr),
       gpu_shared_resource_mgr_(nullptr) {}
@@ -81,8 +115,28 @@ Session* DirectSessionGroup::GetLeaderSession() {
 }
 
 Status DirectSessionGroup::Create(const GraphDef& graph) {
-  for (auto& sess : sessions_) {
-    Status s = sess->Create(graph);
+  if (session_num_ <= 1) {
+    for (auto& sess : sessions_) {
+      Status s = sess->Create(graph);
+      if (!s.ok()) return s;
+    }
+    return Status::OK();
+  }
+
+  // Every session extends its own copy of the graph; doing that serially
+  // makes creating a large group pay the graph setup cost session_num_
+  // times back to back.
+  std::vector<Status> statuses(session_num_);
+  std::vector<std::thread> threads;
+  for (int32_t i = 0; i < session_num_; ++i) {
+    threads.emplace_back([this, i, &graph, &statuses]() {
+      statuses[i] = sessions_[i]->Create(graph);
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  for (const Status& s : statuses) {
     if (!s.ok()) return s;
   }
   return Status::OK();
@@ -124,6 +178,67 @@ Session* DirectSessionGroup::GetSession(int32_t hint_id) {
   return sessions_[id].get();
 }
 
+Status DirectSessionGroup::MakeCallable(
+    const CallableOptions& callable_options,
+    Session::CallableHandle* out_handle) {
+  mutex_lock l(callables_mu_);
+  std::vector<Session::CallableHandle> handles(session_num_);
+  for (int32_t i = 0; i < session_num_; ++i) {
+    Status s = sessions_[i]->MakeCallable(callable_options, &handles[i]);
+    if (!s.ok()) {
+      // Roll back the members that already succeeded so a failed
+      // group-level creation leaks nothing.
+      for (int32_t j = 0; j < i; ++j) {
+        sessions_[j]->ReleaseCallable(handles[j]).IgnoreError();
+      }
+      return s;
+    }
+  }
+  *out_handle = callable_handles_.size();
+  callable_handles_.push_back(std::move(handles));
+  return Status::OK();
+}
+
+Status DirectSessionGroup::RunCallable(
+    Session::CallableHandle handle,
+    const std::vector<Tensor>& feed_tensors,
+    std::vector<Tensor>* fetch_tensors,
+    RunMetadata* run_metadata, int32_t session_id) {
+  int32_t id = 0;
+  Status s = GetServingSessionId(&id, session_id);
+  if (!s.ok()) return s;
+  Session::CallableHandle member_handle;
+  {
+    mutex_lock l(callables_mu_);
+    if (handle < 0 ||
+        handle >= static_cast<int64>(callable_handles_.size()) ||
+        id >= static_cast<int32_t>(callable_handles_[handle].size())) {
+      return errors::InvalidArgument(
+          "Invalid session group callable handle: ", handle);
+    }
+    member_handle = callable_handles_[handle][id];
+  }
+  return sessions_[id]->RunCallable(member_handle, feed_tensors,
+                                    fetch_tensors, run_metadata);
+}
+
+Status DirectSessionGroup::ReleaseCallable(Session::CallableHandle handle) {
+  mutex_lock l(callables_mu_);
+  if (handle < 0 ||
+      handle >= static_cast<int64>(callable_handles_.size())) {
+    return errors::InvalidArgument(
+        "Invalid session group callable handle: ", handle);
+  }
+  Status result;
+  for (size_t i = 0; i < callable_handles_[handle].size(); ++i) {
+    result.Update(sessions_[i]->ReleaseCallable(callable_handles_[handle][i]));
+  }
+  // Keep the slot so existing handles stay stable; it simply becomes
+  // unusable for the released members.
+  callable_handles_[handle].clear();
+  return result;
+}
+
 std::unique_ptr<Session>* DirectSessionGroup::GetSessionPtr(int id) {
   if (id < 0 || id >= session_num_) {
     LOG(ERROR) << "session num in current sess_group is " << session_num_
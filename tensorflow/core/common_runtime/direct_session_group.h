@@ -17,14 +17,48 @@ limitations under the License.
 #define TENSORFLOW_CORE_COMMON_RUNTIME_DIRECT_SESSION_GROUP_H_
 
 #include <atomic>
+#include <functional>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/public/session.h"
 
 namespace tensorflow {
+class OpKernel;
 class ResourceMgr;
 
+// Shares immutable op kernel instances across the sessions of a
+// DirectSessionGroup. The member sessions run the same graph, so the
+// stateless, non-function kernels each executor instantiates are identical;
+// caching them by node signature builds them once and keeps a single copy
+// resident instead of one per session. The cache owns its kernels and is
+// held by shared_ptr from the group and every member session, so entries
+// stay valid until the last executor referencing them is gone.
+class GroupKernelCache {
+ public:
+  typedef std::function<Status(OpKernel**)> KernelCreator;
+
+  ~GroupKernelCache();
+
+  // Returns the kernel cached under `key`, invoking `create_fn` on a miss.
+  Status FindOrCreate(const string& key, OpKernel** kernel,
+                      KernelCreator create_fn);
+
+  // Whether `kernel` came out of this cache; such kernels must not be
+  // deleted by the executors that use them.
+  bool Owns(const OpKernel* kernel) const;
+
+ private:
+  mutable mutex mu_;
+  std::unordered_map<string, OpKernel*> kernels_ GUARDED_BY(mu_);
+  std::unordered_set<const OpKernel*> owned_ GUARDED_BY(mu_);
+};
+
 class DirectSessionGroup : public SessionGroup {
  public:
   DirectSessionGroup();
@@ -50,6 +84,26 @@ class DirectSessionGroup : public SessionGroup {
       int32_t session_id = -1) override;
   virtual Session* GetSession(int32_t hint_id = -1) override;
   virtual std::unique_ptr<Session>* GetSessionPtr(int id) override;
+  virtual Status MakeCallable(const CallableOptions& callable_options,
+                              Session::CallableHandle* out_handle) override;
+  virtual Status RunCallable(Session::CallableHandle handle,
+                             const std::vector<Tensor>& feed_tensors,
+                             std::vector<Tensor>* fetch_tensors,
+                             RunMetadata* run_metadata,
+                             int32_t session_id = -1) override;
+  virtual Status ReleaseCallable(Session::CallableHandle handle) override;
+  virtual ResourceMgr* GetCpuSharedResourceMgr() override {
+    return cpu_shared_resource_mgr_;
+  }
+  virtual ResourceMgr* ReleaseCpuSharedResourceMgr() override {
+    ResourceMgr* mgr = cpu_shared_resource_mgr_;
+    cpu_shared_resource_mgr_ = nullptr;
+    return mgr;
+  }
+
+  const std::shared_ptr<GroupKernelCache>& kernel_cache() const {
+    return kernel_cache_;
+  }
 
  private:
   // sessions_[0] is leader session which own resource,
@@ -58,8 +112,15 @@ class DirectSessionGroup : public SessionGroup {
   std::vector<std::unique_ptr<Session>> sessions_;
   int32_t session_num_ = 0;
   std::atomic<int64_t> serving_index_{0};
+  // Group-level callable handles: entry i holds the per-session
+  // handles of group handle i, one per member session in order.
+  mutex callables_mu_;
+  std::vector<std::vector<Session::CallableHandle>> callable_handles_
+      GUARDED_BY(callables_mu_);
   ResourceMgr* cpu_shared_resource_mgr_ = nullptr;
   ResourceMgr* gpu_shared_resource_mgr_ = nullptr;
+  std::shared_ptr<GroupKernelCache> kernel_cache_ =
+      std::make_shared<GroupKernelCache>();
 
   Status GetServingSessionId(int32_t* serving_id, int32_t hint_id = -1) {
     if (session_num_ < 1) {
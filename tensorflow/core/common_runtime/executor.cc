@@ -27,6 +27,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/costmodel_manager.h"
 #include "tensorflow/core/common_runtime/entry.h"
 #include "tensorflow/core/common_runtime/executor_factory.h"
+#include "tensorflow/core/common_runtime/frozen_execution_plan.h"
 #include "tensorflow/core/common_runtime/graph_view.h"
 #include "tensorflow/core/common_runtime/immutable_executor_state.h"
 #include "tensorflow/core/common_runtime/kernel_stat.h"
@@ -35,6 +36,8 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/renamed_device.h"
 #include "tensorflow/core/common_runtime/simple_propagator_state.h"
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
+#include "tensorflow/core/framework/alloc_audit.h"
+#include "tensorflow/core/framework/output_slab_recycler.h"
 #include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/cancellation.h"
 #include "tensorflow/core/framework/collective.h"
@@ -174,6 +177,14 @@ class ExecutorImpl : public Executor {
     TF_RETURN_IF_ERROR(immutable_state_.Initialize());
     kernel_stats_.Initialize(immutable_state_.graph_view(),
                              immutable_state_.graph());
+    frozen_plan_.Initialize(immutable_state_.graph_view());
+    // Host memory only: reissuing a device buffer would need stream
+    // ordering guarantees this layer does not have.
+    if (OutputSlabRecycler::EnabledFromEnv() &&
+        immutable_state_.params().device->attributes().device_type() ==
+            DEVICE_CPU) {
+      output_slab_recycler_.reset(new OutputSlabRecycler);
+    }
     return Status::OK();
   }
 
@@ -189,12 +200,23 @@ class ExecutorImpl : public Executor {
     return &kernel_stats_;
   }
 
+  ExecutorInternal::FrozenExecutionPlan* GetFrozenPlan() {
+    return frozen_plan_.Enabled() ? &frozen_plan_ : nullptr;
+  }
+
+  OutputSlabRecycler* GetOutputSlabRecycler() {
+    return output_slab_recycler_.get();
+  }
+
  private:
   template <class PropagatorStateType>
   friend class ExecutorState;
 
   ImmutableExecutorState immutable_state_;
   ExecutorInternal::KernelStats kernel_stats_;
+  ExecutorInternal::FrozenExecutionPlan frozen_plan_;
+  // Null unless TF_OUTPUT_SLAB_RECYCLE=1 and this executor runs on CPU.
+  std::unique_ptr<OutputSlabRecycler> output_slab_recycler_;
 
   bool enable_cost_model_ = false;
   std::atomic<int> build_cost_model_counter_{0};
@@ -271,6 +293,14 @@ class ExecutorState {
     return kernel_stats_;
   }
 
+  void SetFrozenPlan(ExecutorInternal::FrozenExecutionPlan* plan) {
+    frozen_plan_ = plan;
+  }
+
+  void SetOutputSlabRecycler(OutputSlabRecycler* recycler) {
+    output_slab_recycler_ = recycler;
+  }
+
  protected:
   // Use `TaggedNode` types defined by `PropagatorStateType`.
   typedef typename PropagatorStateType::TaggedNode TaggedNode;
@@ -326,6 +356,12 @@ class ExecutorState {
   template <typename Closure>
   void RunTask(Closure&& c);
 
+  // Dispatches one expensive node to the threadpool. With the adaptive
+  // inline threshold enabled this also samples the dispatch latency and
+  // feeds it back into the kernel stats.
+  void DispatchExpensiveNode(const TaggedNode& tagged_node,
+                             int64_t scheduled_nsec);
+
   // Clean up when this executor is done.
   void Finish();
   void ScheduleFinish();
@@ -336,6 +372,12 @@ class ExecutorState {
   // step.
   DeviceContext* device_context_ = nullptr;
 
+  // Per-node device contexts, indexed by node id. Only filled in when the
+  // device executes different nodes on different contexts (e.g. a GPU
+  // spreading independent subgraphs over multiple streams); empty otherwise,
+  // in which case every node uses device_context_.
+  DeviceContextMap device_context_map_;
+
   const bool vlog_;  // true if VLOG_IS_ON(1). Used to check vlog cheaply.
 
   // true if LogMemory::IsEnabled(). Used to check memory enabled cheaply.
@@ -369,6 +411,10 @@ class ExecutorState {
   CallFrameInterface* call_frame_;
   const ImmutableExecutorState& immutable_state_;
   ExecutorInternal::KernelStats* const kernel_stats_;
+  // Not owned; null unless the frozen execution plan is enabled.
+  ExecutorInternal::FrozenExecutionPlan* frozen_plan_ = nullptr;
+  // Not owned; null unless output slab recycling is enabled.
+  OutputSlabRecycler* output_slab_recycler_ = nullptr;
   ExecutorInternal::ExecuteCostModel* const cost_model_;
   CancellationManager* cancellation_manager_;
   // If not null, use this device to schedule intra-op operation
@@ -451,6 +497,37 @@ class CostExecutorState : public ExecutorState<PropagatorStateType> {
   }
 };
 
+// Executor variant for high-core-count hosts: instead of pushing one
+// closure per ready node into the shared inter-op queue, ready nodes are
+// handed over as batches that repeatedly split in half on worker
+// threads. A worker keeps the front half of its batch and re-dispatches
+// the back half, so queue insertions per scheduling event drop from N to
+// log2(N) and chains of small ops stay on the thread that made them
+// ready. The inline-execution heuristic for inexpensive nodes is
+// unchanged.
+template <class PropagatorStateType>
+class WorkStealingExecutorState : public ExecutorState<PropagatorStateType> {
+ public:
+  WorkStealingExecutorState(const Executor::Args& args,
+                            const ImmutableExecutorState& immutable_state_,
+                            ExecutorInternal::KernelStats* kernel_stats_)
+      : ExecutorState<PropagatorStateType>(
+            args, immutable_state_, kernel_stats_) {}
+  ~WorkStealingExecutorState() {}
+
+ protected:
+  // Use `TaggedNode` types defined by `PropagatorStateType`.
+  typedef typename PropagatorStateType::TaggedNode TaggedNode;
+  typedef
+      typename PropagatorStateType::TaggedNodeReadyQueue TaggedNodeReadyQueue;
+  typedef typename PropagatorStateType::TaggedNodeSeq TaggedNodeSeq;
+
+  void ScheduleReady(TaggedNodeSeq* ready, TaggedNodeReadyQueue* inline_ready);
+
+ private:
+  void RunSplitBatch(std::vector<TaggedNode> nodes, int64_t scheduled_nsec);
+};
+
 class ExecutorStateFactory {
  public:
   template <class PropagatorStateType>
@@ -459,22 +536,30 @@ class ExecutorStateFactory {
     ImmutableExecutorState& immutable_state = impl->GetImmutableState();
     ExecutorInternal::KernelStats* kernel_stats = impl->GetKernelStat();
 
+    ExecutorState<PropagatorStateType>* state = nullptr;
     // InlineExecuteState
     if (args.executor_policy == ExecutorPolicy::USE_INLINE_EXECUTOR) {
-      return new InlineExecutorState<PropagatorStateType>(
+      state = new InlineExecutorState<PropagatorStateType>(
           args, immutable_state, kernel_stats);
     } else if (args.cost_runner &&
                args.executor_policy == ExecutorPolicy::USE_COST_MODEL_EXECUTOR) {
       // TODO: FIXME consider function lib executor, set cost_runner for it?
       // Schedule by cost model
       ExecutorInternal::ExecuteCostModel* cm = impl->TryToBuildCostModel();
-      return new CostExecutorState<PropagatorStateType>(
+      state = new CostExecutorState<PropagatorStateType>(
           args, immutable_state, kernel_stats, cm);
+    } else if (args.executor_policy ==
+               ExecutorPolicy::USE_WORK_STEALING_EXECUTOR) {
+      state = new WorkStealingExecutorState<PropagatorStateType>(
+          args, immutable_state, kernel_stats);
     } else {
       // normal schedule
-      return new ExecutorState<PropagatorStateType>(
+      state = new ExecutorState<PropagatorStateType>(
           args, immutable_state, kernel_stats);
     }
+    state->SetFrozenPlan(impl->GetFrozenPlan());
+    state->SetOutputSlabRecycler(impl->GetOutputSlabRecycler());
+    return state;
   }
 };
 
@@ -552,6 +637,11 @@ ExecutorState<PropagatorStateType>::~ExecutorState() {
   if (device_context_) {
     device_context_->Unref();
   }
+  for (DeviceContext* device_context : device_context_map_) {
+    if (device_context) {
+      device_context->Unref();
+    }
+  }
   delete slice_reader_cache_;
 }
 
@@ -568,6 +658,7 @@ void ExecutorState<PropagatorStateType>::RunTask(Closure&& c) {
 template <class PropagatorStateType>
 void ExecutorState<PropagatorStateType>::RunAsync(Executor::DoneCallback done) {
   MaybeCollectKernelStats();
+  AllocAudit::RecordRun();
 
   TaggedNodeSeq ready;
 
@@ -580,6 +671,15 @@ void ExecutorState<PropagatorStateType>::RunAsync(Executor::DoneCallback done) {
     done(get_context_status);
     return;
   }
+  if (const Graph* graph = immutable_state_.graph()) {
+    const Status fill_status =
+        device->FillContextMap(graph, &device_context_map_);
+    if (!fill_status.ok()) {
+      delete this;
+      done(fill_status);
+      return;
+    }
+  }
 
   // Initialize the ready queue.
   ready.reserve(immutable_state_.root_nodes().size());
@@ -673,6 +773,9 @@ Status ExecutorState<PropagatorStateType>::ProcessSync(
   OpKernel* op_kernel = item.kernel;
   Device* device = immutable_state_.params().device;
   const bool is_expensive = kernel_stats_->IsExpensive(item);
+  // Attributes any heap allocation the kernel makes to this op when
+  // the allocation audit is armed.
+  AllocAudit::ScopedOp alloc_audit_op(op_kernel->name().c_str());
 
   if (TF_PREDICT_FALSE(MightTrace(item, event_collector_))) {
     const string& op_name = op_kernel->name();
@@ -712,6 +815,14 @@ Status ExecutorState<PropagatorStateType>::ProcessSync(
       const_cast<ExecutorInternal::KernelStatsInfo*>(&kernel_stat_buffer));
 
   nodestats::SetOpEnd(stats);
+  if (TF_PREDICT_FALSE(params->record_tensor_accesses)) {
+    // Multi-stream devices must keep every tensor the kernel touched alive
+    // until the stream has drained; hand the accessed set to the device,
+    // which defers the release via its event manager.
+    TensorReferenceVector accessed;
+    ctx.retrieve_accessed_tensors(&accessed);
+    device->ConsumeListOfAccessedTensors(ctx.op_device_context(), accessed);
+  }
   if (outputs->size() < item.num_outputs) outputs->resize(item.num_outputs);
   s = ProcessOutputs(item, &ctx, outputs->data(), stats);
   nodestats::SetMemory(stats, &ctx);
@@ -738,6 +849,12 @@ void ExecutorState<PropagatorStateType>::ProcessAsync(
     nodestats::SetOpEnd(stats);
     this->GetKernelStats()->StopCollectOp(state->item,
         const_cast<ExecutorInternal::KernelStatsInfo*>(&kernel_stat_buffer));
+    if (TF_PREDICT_FALSE(state->params.record_tensor_accesses)) {
+      TensorReferenceVector accessed;
+      state->ctx.retrieve_accessed_tensors(&accessed);
+      device->ConsumeListOfAccessedTensors(state->ctx.op_device_context(),
+                                           accessed);
+    }
     EntryVector outputs(state->item->num_outputs);
     Status s = ProcessOutputs(*state->item, &state->ctx, outputs.data(), stats);
     nodestats::SetMemory(stats, &state->ctx);
@@ -778,6 +895,9 @@ void ExecutorState<PropagatorStateType>::ProcessAsync(
           },
           profiler::GetTFTraceMeLevel(async_kernel->IsExpensive()));
 
+    // Only the synchronous part of the launch is attributed; work the
+    // async kernel hands to other threads shows up as "<outside-op>".
+    AllocAudit::ScopedOp alloc_audit_op(async_kernel->name().c_str());
     immutable_state_.params().device->ComputeAsync(async_kernel, &state->ctx,
                                                    std::move(done));
   }
@@ -873,8 +993,10 @@ void ExecutorState<PropagatorStateType>::BatchProcess(std::vector<TaggedNode> no
     if (finish_when_deferred_ops_done) Finish();
   };
 
-  // Set the device_context for this device, if it exists.
+  // Set the device_context for this device, if it exists. Nodes with an
+  // entry in device_context_map_ override this below.
   params.op_device_context = device_context_;
+  params.record_tensor_accesses = device->RequiresRecordingAccessedTensors();
 
   Status s;
   NodeExecStatsInterface* stats = nullptr;
@@ -894,6 +1016,11 @@ void ExecutorState<PropagatorStateType>::BatchProcess(std::vector<TaggedNode> no
     const NodeItem& item = tagged_node.get_node_item();
     const int id = item.node_id;
 
+    if (TF_PREDICT_FALSE(!device_context_map_.empty()) &&
+        static_cast<size_t>(id) < device_context_map_.size()) {
+      params.op_device_context = device_context_map_[id];
+    }
+
     propagator_.MaybeMarkStarted(tagged_node);
 
     params.track_allocations = false;
@@ -954,6 +1081,8 @@ void ExecutorState<PropagatorStateType>::BatchProcess(std::vector<TaggedNode> no
       params.output_attr_array = item.output_attrs();
       params.forward_from_array = item.forward_from();
       params.outputs_required_array = item.outputs_required.get();
+      params.output_slab_recycler = output_slab_recycler_;
+      params.output_slab_node_id = id;
 
       if (item.kernel_is_async) {
         ProcessAsync(item, params, tagged_node, first_input, stats);
@@ -1149,6 +1278,32 @@ Status ExecutorState<PropagatorStateType>::ProcessOutputs(
     return s;
   }
 
+  if (frozen_plan_ != nullptr) {
+    if (!frozen_plan_->Frozen()) {
+      frozen_plan_->RecordNodeOutputs(item, ctx);
+    } else if (stats == nullptr && !log_memory_ &&
+               frozen_plan_->IsReplayable(item)) {
+      // Every warmup step saw plain, initialized outputs of the declared
+      // type here, so replay the recorded allocator decisions and skip
+      // the per-output dynamic checks.
+      for (int i = 0; i < item.num_outputs; ++i) {
+        const TensorValue val = ctx->release_output(i);
+        if (TF_PREDICT_FALSE(val.tensor == nullptr)) {
+          s.Update(errors::Internal("Missing ", i, "-th output from ",
+                                    FormatNodeDefForError(item.kernel->def())));
+          continue;
+        }
+        Entry* out = &outputs[i];
+        DCHECK(out->state == Entry::State::NO_VALUE);
+        out->alloc_attr = frozen_plan_->planned_alloc_attr(item, i);
+        out->state = Entry::State::HAS_VALUE;
+        out->val.Init(std::move(*val.tensor));
+        delete val.tensor;
+      }
+      return s;
+    }
+  }
+
   for (int i = 0; i < item.num_outputs; ++i) {
     const TensorValue val = ctx->release_output(i);
     Entry* out = &outputs[i];
@@ -1189,6 +1344,9 @@ Status ExecutorState<PropagatorStateType>::ProcessOutputs(
                                           ctx->step_id(), i, to_log);
           }
         } else {
+          if (output_slab_recycler_ != nullptr) {
+            output_slab_recycler_->Store(item.node_id, i, *val.tensor);
+          }
           // NOTE that std::move is used here, so val.tensor goes to
           // uninitialized state (val.tensor->IsInitialized return false).
           out->state = Entry::State::HAS_VALUE;
@@ -1294,6 +1452,28 @@ bool ExecutorState<PropagatorStateType>::NodeDone(
   }
 }
 
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::DispatchExpensiveNode(
+    const TaggedNode& tagged_node, int64_t scheduled_nsec) {
+  if (kernel_stats_->AdaptiveInlineThreshold()) {
+    // Sample ~1/16 of dispatches; the last bits of the cycle counter are
+    // assumed uniformly distributed (as for kernel cost tracking above).
+    const uint64 dispatch_start_cycles =
+        profile_utils::CpuUtils::GetCurrentClockCycle();
+    if (dispatch_start_cycles % 16 == 0) {
+      RunTask([this, tagged_node, scheduled_nsec, dispatch_start_cycles]() {
+        kernel_stats_->UpdateDispatchCostEstimate(
+            profile_utils::CpuUtils::GetCurrentClockCycle() -
+            dispatch_start_cycles);
+        Process(tagged_node, scheduled_nsec);
+      });
+      return;
+    }
+  }
+  RunTask(
+      std::bind(&ExecutorState::Process, this, tagged_node, scheduled_nsec));
+}
+
 template <class PropagatorStateType>
 void ExecutorState<PropagatorStateType>::ScheduleReady(
     TaggedNodeSeq* ready, TaggedNodeReadyQueue* inline_ready) {
@@ -1321,8 +1501,7 @@ void ExecutorState<PropagatorStateType>::ScheduleReady(
           if (curr_expensive_node) {
             // Dispatch to another thread since there is plenty of work to
             // do for this thread.
-            RunTask(std::bind(&ExecutorState::Process, this,
-                              *curr_expensive_node, scheduled_nsec));
+            DispatchExpensiveNode(*curr_expensive_node, scheduled_nsec);
           }
           curr_expensive_node = &tagged_node;
         }
@@ -1334,8 +1513,7 @@ void ExecutorState<PropagatorStateType>::ScheduleReady(
       } else {
         // There are inline nodes to run already. We dispatch this expensive
         // node to other thread.
-        RunTask(std::bind(&ExecutorState::Process, this, *curr_expensive_node,
-                          scheduled_nsec));
+        DispatchExpensiveNode(*curr_expensive_node, scheduled_nsec);
       }
     }
   }
@@ -1369,6 +1547,9 @@ void ExecutorState<PropagatorStateType>::MaybeCollectKernelStats() {
 
 template <class PropagatorStateType>
 void ExecutorState<PropagatorStateType>::Finish() {
+  if (frozen_plan_ != nullptr) {
+    frozen_plan_->StepDone();
+  }
   mu_.lock();
   auto status = status_;
   auto done_cb = std::move(done_cb_);
@@ -1483,6 +1664,71 @@ void InlineExecutorState<PropagatorStateType>::ScheduleReady(
   ready->clear();
 }
 
+template <class PropagatorStateType>
+void WorkStealingExecutorState<PropagatorStateType>::ScheduleReady(
+    TaggedNodeSeq* ready, TaggedNodeReadyQueue* inline_ready) {
+  DCHECK(!ready->empty());
+
+  int64_t scheduled_nsec = 0;
+  if (this->stats_collector_) {
+    scheduled_nsec = nodestats::NowInNsec();
+  }
+
+  if (inline_ready == nullptr) {
+    // Hand the whole ready set to one worker; it splits on its own
+    // thread, so the shared queue sees one insertion here instead of
+    // one per node.
+    std::vector<TaggedNode> batch(ready->begin(), ready->end());
+    this->RunTask([this, batch = std::move(batch), scheduled_nsec]() mutable {
+      RunSplitBatch(std::move(batch), scheduled_nsec);
+    });
+    ready->clear();
+    return;
+  }
+
+  std::vector<TaggedNode> expensive;
+  for (auto& tagged_node : *ready) {
+    const NodeItem& item = *tagged_node.node_item;
+    if (tagged_node.get_is_dead() || !this->kernel_stats_->IsExpensive(item)) {
+      // Inline this inexpensive node.
+      inline_ready->push_back(tagged_node);
+    } else {
+      expensive.push_back(tagged_node);
+    }
+  }
+  if (!expensive.empty()) {
+    if (inline_ready->empty()) {
+      // This thread has nothing queued, keep one expensive node local.
+      inline_ready->push_back(expensive.back());
+      expensive.pop_back();
+    }
+    if (!expensive.empty()) {
+      this->RunTask(
+          [this, batch = std::move(expensive), scheduled_nsec]() mutable {
+            RunSplitBatch(std::move(batch), scheduled_nsec);
+          });
+    }
+  }
+  ready->clear();
+}
+
+template <class PropagatorStateType>
+void WorkStealingExecutorState<PropagatorStateType>::RunSplitBatch(
+    std::vector<TaggedNode> nodes, int64_t scheduled_nsec) {
+  // Steal-half handoff: keep the front half and re-dispatch the back
+  // half until one node is left, which runs here together with the
+  // inexpensive descendants it makes ready.
+  while (nodes.size() > 1) {
+    size_t give = nodes.size() / 2;
+    std::vector<TaggedNode> given(nodes.end() - give, nodes.end());
+    nodes.resize(nodes.size() - give);
+    this->RunTask([this, given = std::move(given), scheduled_nsec]() mutable {
+      RunSplitBatch(std::move(given), scheduled_nsec);
+    });
+  }
+  this->Process(nodes[0], scheduled_nsec);
+}
+
 template <class PropagatorStateType>
 template <typename Closure>
 void CostExecutorState<PropagatorStateType>::CostRunTask(
@@ -0,0 +1,170 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_FROZEN_EXECUTION_PLAN_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_FROZEN_EXECUTION_PLAN_H_
+
+#include <atomic>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/graph_view.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/gtl/inlined_vector.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+namespace ExecutorInternal {
+
+namespace {
+static const std::string frozen_plan_warmup_steps_env_name =
+    "EXECUTOR_FROZEN_PLAN_WARMUP_STEPS";
+}
+
+// Per-executor plan of the output shapes and allocator decisions observed
+// for each node during the first N warmup steps. Serving graphs with fixed
+// batch sizes produce the same shapes every step, so once the plan is
+// frozen the executor can replay the recorded decisions and skip the
+// per-output dynamic checks in ProcessOutputs for nodes that behaved
+// identically in every warmup step.
+//
+// User can set environment 'EXECUTOR_FROZEN_PLAN_WARMUP_STEPS' to the
+// number of warmup steps, 0 (the default) disables the plan.
+class FrozenExecutionPlan {
+ public:
+  FrozenExecutionPlan() {
+    Status s = ReadInt64FromEnvVar(
+        frozen_plan_warmup_steps_env_name, 0, &warmup_steps_);
+    if (!s.ok()) {
+      LOG(WARNING) << "Read EXECUTOR_FROZEN_PLAN_WARMUP_STEPS envrionment"
+                   << " error. " << s.error_message();
+    }
+    if (warmup_steps_ > 0) {
+      enabled_ = true;
+      VLOG(1) << "User enables frozen execution plan, warmup_steps is "
+              << warmup_steps_;
+    }
+  }
+
+  void Initialize(const GraphView& gview) {
+    if (!enabled_) return;
+    entries_.resize(gview.num_nodes());
+  }
+
+  bool Enabled() const { return enabled_; }
+
+  bool Frozen() const {
+    return frozen_.load(std::memory_order_acquire);
+  }
+
+  // Records the outputs of one node execution during warmup. A node stays
+  // replayable only while every warmup step observes plain (non-ref),
+  // initialized outputs of the declared type with identical shapes and
+  // allocator attributes.
+  void RecordNodeOutputs(const NodeItem& item, OpKernelContext* ctx) {
+    if (!enabled_ || Frozen()) return;
+
+    mutex_lock l(mu_);
+    NodeEntry& entry = entries_[item.node_id];
+    if (!entry.stable) return;
+
+    // Nodes whose outputs may legitimately be absent in some steps can
+    // never be replayed from a static plan.
+    if (item.is_recv_or_switch || item.is_fuse_recv_op ||
+        item.is_run_graph_op) {
+      entry.stable = false;
+      return;
+    }
+
+    for (int i = 0; i < item.num_outputs; ++i) {
+      Tensor* t = ctx->mutable_output(i);
+      if (t == nullptr || IsRefType(item.output_type(i)) ||
+          t->dtype() != item.output_type(i) || !t->IsInitialized()) {
+        entry.stable = false;
+        return;
+      }
+      if (!entry.seen) {
+        entry.shapes.push_back(t->shape());
+        entry.alloc_attrs.push_back(ctx->output_alloc_attr(i));
+      } else if (entry.shapes[i] != t->shape()) {
+        entry.stable = false;
+        return;
+      }
+    }
+    entry.seen = true;
+  }
+
+  // Called once per finished step; freezes the plan after the warmup steps
+  // are done.
+  void StepDone() {
+    if (!enabled_ || Frozen()) return;
+    auto current = step_counter_.fetch_add(1);
+    if (current + 1 >= warmup_steps_) {
+      mutex_lock l(mu_);
+      if (Frozen()) return;
+      int64 stable_nodes = 0;
+      for (auto& entry : entries_) {
+        // Nodes that never executed during warmup have no recorded plan.
+        if (!entry.seen) entry.stable = false;
+        if (entry.stable) ++stable_nodes;
+      }
+      frozen_.store(true, std::memory_order_release);
+      LOG(INFO) << "Frozen execution plan is ready after " << warmup_steps_
+                << " warmup steps, " << stable_nodes << " of "
+                << entries_.size() << " nodes are replayable.";
+    }
+  }
+
+  // Valid after Frozen() returns true.
+  bool IsReplayable(const NodeItem& item) const {
+    return entries_[item.node_id].stable;
+  }
+
+  const TensorShape& planned_output_shape(const NodeItem& item, int i) const {
+    return entries_[item.node_id].shapes[i];
+  }
+
+  const AllocatorAttributes& planned_alloc_attr(const NodeItem& item,
+                                                int i) const {
+    return entries_[item.node_id].alloc_attrs[i];
+  }
+
+ private:
+  struct NodeEntry {
+    bool seen = false;
+    bool stable = true;
+    gtl::InlinedVector<TensorShape, 4> shapes;
+    gtl::InlinedVector<AllocatorAttributes, 4> alloc_attrs;
+  };
+
+  bool enabled_ = false;
+  int64 warmup_steps_ = 0;
+  std::atomic<int64_t> step_counter_{0};
+  std::atomic<bool> frozen_{false};
+  // Guards entries_ during warmup; after frozen_ is set with release
+  // semantics the entries are immutable and read without the lock.
+  mutex mu_;
+  std::vector<NodeEntry> entries_;
+};
+
+}  // end namespace ExecutorInternal
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_FROZEN_EXECUTION_PLAN_H_
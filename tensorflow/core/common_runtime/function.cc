@@ -45,6 +45,7 @@ limitations under the License.
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/profiler/lib/traceme.h"
 #include "tensorflow/core/protobuf/config.pb.h"
+#include "tensorflow/core/util/env_var.h"
 
 // See core/kernels/function_ops.cc for related kernels.
 
@@ -315,6 +316,197 @@ Status FunctionLibraryRuntimeOverlay::Clone(
   return base_flr_->Clone(out_lib_def, out_pflr, out_flr, skip_flib_def);
 }
 
+namespace {
+
+// Inline execution of tiny functions (TF_INLINE_FUNCTION_EXECUTION=1).
+// Feature-transform graphs dispatch thousands of very small functions
+// whose executor setup (rendezvous, call frame, scheduling) costs far
+// more than the bodies themselves.
+bool InlineFunctionExecutionEnabled() {
+  static bool enabled = [] {
+    bool value = false;
+    Status s =
+        ReadBoolFromEnvVar("TF_INLINE_FUNCTION_EXECUTION", false, &value);
+    if (!s.ok()) {
+      LOG(WARNING) << s.error_message();
+    }
+    return value;
+  }();
+  return enabled;
+}
+
+// Largest function body (in op nodes, including _Arg/_Retval) the inline
+// runner accepts.
+int64 InlineFunctionMaxNodes() {
+  static int64 max_nodes = [] {
+    int64 value = 32;
+    Status s = ReadInt64FromEnvVar("TF_INLINE_FUNCTION_MAX_NODES", 32, &value);
+    if (!s.ok()) {
+      LOG(WARNING) << s.error_message();
+    }
+    return value;
+  }();
+  return max_nodes;
+}
+
+}  // namespace
+
+// Executes a small, stateless, CPU-only function body directly in the
+// caller's thread: kernels run synchronously in a fixed topological
+// order with tensors handed over in plain vectors, skipping rendezvous,
+// call-frame and executor scheduling entirely. Built once per
+// instantiated function; Run() is reentrant.
+class InlineFunctionRunner {
+ public:
+  // Builds a runner for `graph` or returns non-OK when the body does not
+  // qualify (too large, stateful, control flow, async or ref-typed
+  // nodes), in which case the caller falls back to the normal executor.
+  static Status Create(
+      const Graph* graph,
+      const std::function<Status(const NodeDef&, OpKernel**)>& create_kernel,
+      Device* device, FunctionLibraryRuntime* flr,
+      std::unique_ptr<InlineFunctionRunner>* out) {
+    if (graph->num_op_nodes() > InlineFunctionMaxNodes()) {
+      return errors::FailedPrecondition("function body too large");
+    }
+    std::unique_ptr<InlineFunctionRunner> runner(
+        new InlineFunctionRunner(device, flr));
+    std::vector<Node*> order;
+    GetReversePostOrder(*graph, &order);
+    std::vector<int> plan_index(graph->num_node_ids(), -1);
+    for (Node* n : order) {
+      if (!n->IsOp()) continue;
+      if (n->IsControlFlow() || n->op_def().is_stateful()) {
+        return errors::FailedPrecondition("stateful or control flow node ",
+                                          n->name());
+      }
+      for (DataType dt : n->output_types()) {
+        if (IsRefType(dt)) {
+          return errors::FailedPrecondition("ref-typed node ", n->name());
+        }
+      }
+      NodeExec ne;
+      ne.inputs.resize(n->num_inputs(), std::make_pair(-1, -1));
+      for (const Edge* e : n->in_edges()) {
+        if (e->IsControlEdge()) continue;
+        const int src = plan_index[e->src()->id()];
+        if (src < 0) {
+          return errors::Internal("graph is not in topological order");
+        }
+        ne.inputs[e->dst_input()] = {src, e->src_output()};
+      }
+      if (n->type_string() == kDeviceArgOp || n->type_string() == kDeviceRetOp) {
+        // These read the call frame, which the inline path does not set up.
+        return errors::FailedPrecondition("device arg/ret node ", n->name());
+      }
+      if (n->type_string() == kArgOp) {
+        TF_RETURN_IF_ERROR(GetNodeAttr(n->attrs(), "index", &ne.arg_index));
+        ne.num_outputs = 1;
+      } else if (n->type_string() == kRetOp) {
+        TF_RETURN_IF_ERROR(GetNodeAttr(n->attrs(), "index", &ne.ret_index));
+        runner->num_rets_ = std::max(runner->num_rets_, ne.ret_index + 1);
+      } else {
+        OpKernel* kernel = nullptr;
+        TF_RETURN_IF_ERROR(create_kernel(n->def(), &kernel));
+        ne.kernel = kernel;
+        if (kernel->AsAsync() != nullptr) {
+          DeleteNonCachedKernel(kernel);
+          ne.kernel = nullptr;
+          return errors::FailedPrecondition("async kernel ", n->name());
+        }
+        ne.num_outputs = n->num_outputs();
+        ne.output_attrs.resize(ne.num_outputs);
+      }
+      plan_index[n->id()] = runner->nodes_.size();
+      runner->nodes_.push_back(std::move(ne));
+    }
+    *out = std::move(runner);
+    return Status::OK();
+  }
+
+  ~InlineFunctionRunner() {
+    for (NodeExec& ne : nodes_) {
+      if (ne.kernel != nullptr) {
+        DeleteNonCachedKernel(ne.kernel);
+      }
+    }
+  }
+
+  Status Run(const FunctionLibraryRuntime::Options& opts,
+             gtl::ArraySlice<Tensor> args, std::vector<Tensor>* rets) {
+    std::vector<gtl::InlinedVector<Tensor, 4>> outputs(nodes_.size());
+    rets->clear();
+    rets->resize(num_rets_);
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+      NodeExec& ne = nodes_[i];
+      if (ne.arg_index >= 0) {
+        if (ne.arg_index >= static_cast<int>(args.size())) {
+          return errors::InvalidArgument("missing argument ", ne.arg_index);
+        }
+        outputs[i].push_back(args[ne.arg_index]);
+        continue;
+      }
+      if (ne.ret_index >= 0) {
+        (*rets)[ne.ret_index] =
+            outputs[ne.inputs[0].first][ne.inputs[0].second];
+        continue;
+      }
+      gtl::InlinedVector<TensorValue, 4> inputs;
+      gtl::InlinedVector<AllocatorAttributes, 4> input_alloc_attrs;
+      inputs.reserve(ne.inputs.size());
+      input_alloc_attrs.resize(ne.inputs.size());
+      for (const auto& in : ne.inputs) {
+        inputs.push_back(TensorValue(&outputs[in.first][in.second]));
+      }
+      OpKernelContext::Params params;
+      params.step_id = opts.step_id;
+      params.device = device_;
+      params.op_kernel = ne.kernel;
+      params.frame_iter = FrameAndIter(0, 0);
+      params.inputs = &inputs;
+      params.input_alloc_attrs = &input_alloc_attrs;
+      params.output_attr_array = ne.output_attrs.data();
+      params.function_library = flr_;
+      params.resource_manager = device_->resource_manager();
+      params.step_container = opts.step_container;
+      params.cancellation_manager = opts.cancellation_manager;
+      OpKernelContext ctx(&params, ne.num_outputs);
+      device_->Compute(ne.kernel, &ctx);
+      TF_RETURN_IF_ERROR(ctx.status());
+      outputs[i].resize(ne.num_outputs);
+      for (int j = 0; j < ne.num_outputs; ++j) {
+        TensorValue val = ctx.release_output(j);
+        if (val.tensor != nullptr) {
+          outputs[i][j] = *val.tensor;
+          delete val.tensor;
+        }
+      }
+    }
+    return Status::OK();
+  }
+
+ private:
+  InlineFunctionRunner(Device* device, FunctionLibraryRuntime* flr)
+      : device_(device), flr_(flr) {}
+
+  struct NodeExec {
+    OpKernel* kernel = nullptr;  // Null for _Arg/_Retval.
+    int arg_index = -1;
+    int ret_index = -1;
+    // Per input slot: (producer's position in nodes_, output slot).
+    gtl::InlinedVector<std::pair<int, int>, 4> inputs;
+    gtl::InlinedVector<AllocatorAttributes, 4> output_attrs;
+    int num_outputs = 0;
+  };
+
+  Device* const device_;
+  FunctionLibraryRuntime* const flr_;
+  std::vector<NodeExec> nodes_;  // Topological order.
+  int num_rets_ = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(InlineFunctionRunner);
+};
+
 class FunctionLibraryRuntimeImpl : public FunctionLibraryRuntime {
  public:
   FunctionLibraryRuntimeImpl(const DeviceMgr* dmgr, Env* env, Device* device,
@@ -403,6 +595,9 @@ class FunctionLibraryRuntimeImpl : public FunctionLibraryRuntime {
     FunctionLibraryRuntimeOverlay* overlay_flr = nullptr;
     string executor_type;
     Executor::RendezvousFactory rendezvous_factory = nullptr;
+    // Set when the body qualifies for inline execution; see
+    // InlineFunctionRunner.
+    std::unique_ptr<InlineFunctionRunner> inline_runner;
 
     ~Item() {
       delete this->func_graph;
@@ -963,6 +1158,16 @@ Status FunctionLibraryRuntimeImpl::CreateItem(Item** item) {
   params.rendezvous_factory = (*item)->rendezvous_factory;
   params.session_metadata = session_metadata_;
   Graph* graph = g.get();
+  std::unique_ptr<InlineFunctionRunner> inline_runner;
+  if (InlineFunctionExecutionEnabled() &&
+      device_->device_type() == DEVICE_CPU) {
+    Status inline_s = InlineFunctionRunner::Create(
+        graph, params.create_kernel, device_, flr, &inline_runner);
+    if (!inline_s.ok()) {
+      VLOG(2) << "Function does not qualify for inline execution: "
+              << inline_s.error_message();
+    }
+  }
   std::unique_ptr<Executor> exec;
   TF_RETURN_IF_ERROR(NewExecutor(executor_type, params, std::move(g), &exec));
   {
@@ -971,6 +1176,7 @@ Status FunctionLibraryRuntimeImpl::CreateItem(Item** item) {
     if ((*item)->exec == nullptr) {
       (*item)->graph = graph;
       (*item)->exec = exec.release();
+      (*item)->inline_runner = std::move(inline_runner);
     }
   }
   return Status::OK();
@@ -1123,6 +1329,20 @@ void FunctionLibraryRuntimeImpl::Run(const Options& opts, Handle handle,
     done(errors::Cancelled(""));
     return;
   }
+  if (InlineFunctionExecutionEnabled() && !opts.remote_execution) {
+    // Tiny stateless bodies run synchronously in the caller's thread,
+    // before any rendezvous or call frame is set up.
+    LocalHandle inline_handle =
+        parent_->GetHandleOnDevice(device_name_, handle);
+    if (inline_handle != kInvalidLocalHandle) {
+      Item* item = nullptr;
+      if (GetOrCreateItem(inline_handle, &item).ok() &&
+          item->inline_runner != nullptr) {
+        done(item->inline_runner->Run(opts, args, rets));
+        return;
+      }
+    }
+  }
   Options run_opts = opts;
   if (opts.create_rendezvous) {
     Rendezvous* rendezvous = new IntraProcessRendezvous(device_mgr_);
@@ -505,6 +505,68 @@ Status BaseGPUDevice::Init(const SessionOptions& options) {
   return Status::OK();
 }
 
+Status BaseGPUDevice::FillContextMap(const Graph* graph,
+                                     DeviceContextMap* device_context_map) {
+  VLOG(2) << "FillContextMap";
+  if (streams_.size() <= 1) {
+    // Every node runs on device_contexts_[0]; nothing to fill in.
+    return Status::OK();
+  }
+
+  const size_t num_streams = streams_.size();
+  gpu_stream_util::AssignStreamsOpts opts;
+  opts.max_streams = static_cast<int32>(num_streams);
+  std::unordered_map<int, int> node_to_stream_id;
+  TF_RETURN_IF_ERROR(
+      gpu_stream_util::AssignStreams(graph, opts, &node_to_stream_id));
+
+  // Fill in the context map. Nodes whose inputs all live on their own stream
+  // share the per-stream context; a node that joins work from other streams
+  // gets a dedicated context listing the producer streams so Compute() can
+  // enqueue the cross-stream waits before launching its kernels.
+  device_context_map->resize(graph->num_node_ids());
+  for (Node* n : graph->nodes()) {
+    const int mapped_stream = node_to_stream_id[n->id()];
+    CHECK_LT(mapped_stream, static_cast<int>(num_streams));
+    gtl::InlinedVector<se::Stream*, 4> wait_streams;
+    for (const Edge* e : n->in_edges()) {
+      const Node* src = e->src();
+      if (!src->IsOp()) continue;
+      auto it = node_to_stream_id.find(src->id());
+      if (it == node_to_stream_id.end() || it->second == mapped_stream) {
+        continue;
+      }
+      se::Stream* producer = streams_[it->second]->compute;
+      if (std::find(wait_streams.begin(), wait_streams.end(), producer) ==
+          wait_streams.end()) {
+        wait_streams.push_back(producer);
+      }
+    }
+    GPUDeviceContext* ctx;
+    if (wait_streams.empty()) {
+      ctx = device_contexts_[mapped_stream];
+      ctx->Ref();
+    } else {
+      StreamGroup* group = streams_[mapped_stream];
+      ctx = new GPUDeviceContext(mapped_stream, group->compute,
+#if TENSORFLOW_USE_ROCM
+                                 group->nccl,
+#endif
+                                 group->host_to_device, group->device_to_host,
+                                 group->device_to_device);
+      for (se::Stream* s : wait_streams) {
+        ctx->AddWaitStream(s);
+      }
+    }
+    VLOG(3) << "Assigned stream " << node_to_stream_id[n->id()]
+            << " ==> stream[" << ctx->stream_id() << "] for node id " << n->id()
+            << " " << n->type_string() << " " << n->name();
+    (*device_context_map)[n->id()] = ctx;
+  }
+
+  return Status::OK();
+}
+
 bool BaseGPUDevice::RequiresRecordingAccessedTensors() const {
   // When there is no more than one stream, we release the tensor reference
   // at the end of the kernel launch, instead of at the end of the kernel
@@ -549,6 +611,13 @@ void BaseGPUDevice::Compute(OpKernel* op_kernel, OpKernelContext* context) {
     }
   }
   ScopedActivateExecutorContext scoped_activation{stream->parent()};
+  // Join point for multi-stream execution: all producers on other streams
+  // have already enqueued their kernels (the executor dispatches nodes in
+  // data-dependency order), so waiting on those streams here orders this
+  // node's kernels after its cross-stream inputs.
+  for (se::Stream* wait_stream : gpu_device_context->wait_streams()) {
+    stream->ThenWaitFor(wait_stream);
+  }
   op_kernel->Compute(context);
   if (context->status().ok()) {
     if (sync_every_op_) {
@@ -613,6 +682,9 @@ void BaseGPUDevice::ComputeAsync(AsyncOpKernel* op_kernel,
           << stream_id << "]";
 
   ScopedActivateExecutorContext scoped_activation{stream->parent()};
+  for (se::Stream* wait_stream : gpu_device_context->wait_streams()) {
+    stream->ThenWaitFor(wait_stream);
+  }
   op_kernel->ComputeAsync(context, done);
 }
 
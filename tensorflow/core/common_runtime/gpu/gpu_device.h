@@ -102,6 +102,14 @@ class BaseGPUDevice : public LocalDevice {
                                DeviceContext* dc,
                                Allocator* allocator) override;
 
+  // When the device was created with more than one stream, assigns every
+  // node of "graph" to one of the compute streams so independent subgraphs
+  // can execute concurrently, and records in the map which DeviceContext
+  // each node should run on.  Leaves the map empty for single-stream
+  // devices.
+  Status FillContextMap(const Graph* graph,
+                        DeviceContextMap* device_context_map) override;
+
   // Returns the platform GPU id of this device within the native driver system;
   // e.g., for CUDA and ROCm this is the ordinal of the GPU within the system.
   int gpu_id() const {
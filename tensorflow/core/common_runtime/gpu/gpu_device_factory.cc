@@ -23,11 +23,37 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/gpu/gpu_process_state.h"
 #include "tensorflow/core/common_runtime/threadpool_device.h"
 #include "tensorflow/core/platform/numa.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 
 class DeviceResourceMgrMap;
 
+namespace {
+
+// Number of compute streams to create per GPU device. With more than one
+// stream, BaseGPUDevice::FillContextMap spreads independent subgraphs (e.g.
+// the per-feature-column embedding lookups in a serving graph) over separate
+// streams so their kernels can overlap instead of serializing on a single
+// compute stream.
+int32 NumGpuStreams() {
+  static const int32 num_streams = [] {
+    int64 val = 1;
+    Status s = ReadInt64FromEnvVar("TF_GPU_MAX_STREAMS", 1, &val);
+    if (!s.ok()) {
+      LOG(ERROR) << s.error_message();
+    }
+    if (val < 1) {
+      LOG(WARNING) << "TF_GPU_MAX_STREAMS must be at least 1, got " << val;
+      val = 1;
+    }
+    return static_cast<int32>(val);
+  }();
+  return num_streams;
+}
+
+}  // namespace
+
 class GPUDevice : public BaseGPUDevice {
  public:
   GPUDevice(const SessionOptions& options, const string& name,
@@ -36,7 +62,7 @@ class GPUDevice : public BaseGPUDevice {
             Allocator* gpu_allocator, Allocator* cpu_allocator)
       : BaseGPUDevice(options, name, memory_limit, locality, tf_gpu_id,
                       physical_device_desc, gpu_allocator, cpu_allocator,
-                      false /* sync every op */, 1 /* max_streams */) {
+                      false /* sync every op */, NumGpuStreams()) {
     if (options.config.has_gpu_options()) {
       force_gpu_compatible_ =
           options.config.gpu_options().force_gpu_compatible();
@@ -51,7 +77,7 @@ class GPUDevice : public BaseGPUDevice {
             const DeviceGlobalThreadPoolOptions& opt)
       : BaseGPUDevice(options, name, physical_name, memory_limit, locality,
                       tf_gpu_id, physical_device_desc, gpu_allocator, cpu_allocator,
-                      false /* sync every op */, 1 /* max_streams */, dev_rmgr_map, opt) {
+                      false /* sync every op */, NumGpuStreams(), dev_rmgr_map, opt) {
     if (options.config.has_gpu_options()) {
       force_gpu_compatible_ =
           options.config.gpu_options().force_gpu_compatible();
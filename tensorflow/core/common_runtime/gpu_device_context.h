@@ -59,6 +59,16 @@ class GPUDeviceContext : public DeviceContext {
   }
   int stream_id() const { return stream_id_; }
 
+  // Streams whose enqueued work must complete before kernels launched on
+  // this context's compute stream.  Populated by
+  // BaseGPUDevice::FillContextMap for nodes that consume tensors produced on
+  // a different stream; BaseGPUDevice enqueues the corresponding waits right
+  // before the kernel launch.  Empty for single-stream execution.
+  void AddWaitStream(se::Stream* stream) { wait_streams_.push_back(stream); }
+  const gtl::InlinedVector<se::Stream*, 4>& wait_streams() const {
+    return wait_streams_;
+  }
+
   void CopyCPUTensorToDevice(const Tensor* cpu_tensor, Device* device,
                              Tensor* device_tensor, StatusCallback done,
                              bool sync_dst_compute) const override;
@@ -92,6 +102,9 @@ class GPUDeviceContext : public DeviceContext {
   se::Stream* device_to_host_stream_;
   // Streams to use for copying data between GPUs.
   gtl::InlinedVector<se::Stream*, 4> device_to_device_stream_;
+  // Streams to wait for before launching kernels on stream_. See
+  // AddWaitStream().
+  gtl::InlinedVector<se::Stream*, 4> wait_streams_;
 };
 
 }  // namespace tensorflow
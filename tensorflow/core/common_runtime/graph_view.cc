@@ -26,6 +26,7 @@ limitations under the License.
 #include "tensorflow/core/framework/node_def_util.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/graph/algorithm.h"
 #include "tensorflow/core/graph/edgeset.h"
 #include "tensorflow/core/graph/graph.h"
 #include "tensorflow/core/lib/core/errors.h"
@@ -264,9 +265,24 @@ Status GraphView::Initialize(const Graph* g) {
 
   space_ = new char[total_bytes];  // NodeItem objects are allocated here
   char* ptr = space_;
-  for (const Node* n : g->nodes()) {
+  // Lay the NodeItems out in topological order rather than node-id
+  // order: step-time graph walks visit successors of what just ran, so
+  // execution moves roughly forward through space_ and the hardware
+  // prefetcher gets sequential lines instead of id-order scatter.
+  // node_offsets_ keeps id-based lookup independent of placement.
+  std::vector<Node*> order;
+  GetReversePostOrder(*g, &order);
+  std::vector<bool> placed(num_nodes, false);
+  for (const Node* n : order) {
+    placed[n->id()] = true;
     ptr = InitializeNode(ptr, n);
   }
+  // Nodes the traversal cannot reach from SOURCE go at the tail.
+  for (const Node* n : g->nodes()) {
+    if (!placed[n->id()]) {
+      ptr = InitializeNode(ptr, n);
+    }
+  }
   CHECK_EQ(ptr, space_ + total_bytes);
   return Status::OK();
 }
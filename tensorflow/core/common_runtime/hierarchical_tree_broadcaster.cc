@@ -14,6 +14,7 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/common_runtime/hierarchical_tree_broadcaster.h"
 
+#include <algorithm>
 #include <functional>
 #include <memory>
 #include <string>
@@ -34,6 +35,7 @@ limitations under the License.
 #include "tensorflow/core/platform/tracing.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/profiler/lib/traceme.h"
+#include "tensorflow/core/util/env_var.h"
 
 // Set true for greater intelligibility of debug mode log messages.
 #define READABLE_KEYS false
@@ -41,17 +43,41 @@ limitations under the License.
 namespace tensorflow {
 
 namespace {
-// Key to be used for BufRendezvous by Broadcaster.
+// Key to be used for BufRendezvous by Broadcaster. `chunk` is -1 for a
+// whole-tensor transfer and the chunk index when the broadcast is
+// pipelined at chunk granularity.
 string BroadcastBufKey(const string& exec_key, int subdiv, int src_rank,
-                       int dst_rank) {
+                       int dst_rank, int chunk = -1) {
   if (READABLE_KEYS) {
-    return strings::StrCat("broadcast(", exec_key, "):subdiv(", subdiv,
-                           "):src(", src_rank, "):dst(", dst_rank, ")");
+    string key = strings::StrCat("broadcast(", exec_key, "):subdiv(", subdiv,
+                                 "):src(", src_rank, "):dst(", dst_rank, ")");
+    if (chunk >= 0) strings::StrAppend(&key, ":chunk(", chunk, ")");
+    return key;
   } else {
     // TODO(b/78352018): Try a denser format, e.g. a 64 or 128 bit hash.
-    return strings::StrCat(exec_key, ":", subdiv, ":", src_rank, ":", dst_rank);
+    string key =
+        strings::StrCat(exec_key, ":", subdiv, ":", src_rank, ":", dst_rank);
+    if (chunk >= 0) strings::StrAppend(&key, ":c", chunk);
+    return key;
   }
 }
+
+// Target chunk size for pipelined tree broadcast, 0 disables chunking.
+// When set, every relay forwards each chunk to its descendants as soon
+// as the chunk arrives instead of holding the whole tensor back, so a
+// deep tree streams instead of paying depth x tensor latency. Every
+// participant derives the chunking from the tensor shape and this
+// value, so it must be set identically on all hosts of the job.
+int64 BcastChunkBytes() {
+  static const int64 chunk_bytes = [] {
+    int64 b = 0;
+    Status s =
+        ReadInt64FromEnvVar("TF_COLLECTIVE_BCAST_CHUNK_BYTES", 0, &b);
+    if (!s.ok() || b < 0) b = 0;
+    return b;
+  }();
+  return chunk_bytes;
+}
 }  // namespace
 
 HierarchicalTreeBroadcaster::HierarchicalTreeBroadcaster()
@@ -315,7 +341,85 @@ void HierarchicalTreeBroadcaster::RunTree() {
     int pending_count = 0;  // GUARDED_BY(mu)
     condition_variable all_done;
 
-    if (my_rank >= 0 && my_rank != source_rank) {
+    // Decide whether this subdiv streams the tensor in chunks. Every
+    // participant derives the same chunking from the output shape, so
+    // the per-chunk buf keys agree between peers.
+    const int64 chunk_bytes = BcastChunkBytes();
+    int64 chunk_rows = 0;
+    int num_chunks = 1;
+    if (chunk_bytes > 0 && col_ctx_->output->dims() > 0) {
+      const int64 rows = col_ctx_->output->dim_size(0);
+      const int64 total_bytes =
+          static_cast<int64>(col_ctx_->output->TotalBytes());
+      if (rows > 1 && total_bytes > chunk_bytes) {
+        const int64 bytes_per_row = total_bytes / rows;
+        chunk_rows =
+            std::max<int64>(1, chunk_bytes / std::max<int64>(1, bytes_per_row));
+        num_chunks = static_cast<int>((rows + chunk_rows - 1) / chunk_rows);
+      }
+    }
+
+    if (num_chunks > 1 && my_rank >= 0) {
+      // Pipelined path: relay each chunk to the descendants as soon as
+      // it arrives instead of holding the whole tensor back, so a deep
+      // tree streams at chunk granularity and only the first chunk
+      // pays the full tree depth.
+      profiler::TraceMe activity(
+          [&] { return strings::StrCat("StreamValue:", si); },
+          profiler::TraceMeLevel::kInfo);
+      const int recv_from_rank = TreeRecvFrom(*col_params_, si);
+      std::vector<int> send_to_ranks;
+      TreeSendTo(*col_params_, si, &send_to_ranks);
+      const Tensor* send_src = is_source_ ? col_ctx_->input : col_ctx_->output;
+      const int64 rows = col_ctx_->output->dim_size(0);
+      // The slices alias the full tensors; keep them alive until every
+      // pending send completed.
+      std::vector<Tensor> recv_chunks;
+      std::vector<Tensor> send_chunks;
+      recv_chunks.reserve(num_chunks);
+      send_chunks.reserve(num_chunks);
+      for (int c = 0; c < num_chunks; ++c) {
+        const int64 start = c * chunk_rows;
+        const int64 limit = std::min(rows, start + chunk_rows);
+        recv_chunks.push_back(col_ctx_->output->Slice(start, limit));
+        send_chunks.push_back(send_src->Slice(start, limit));
+      }
+      for (int c = 0; c < num_chunks; ++c) {
+        if (my_rank != source_rank) {
+          Notification note;
+          DispatchRecv(si, recv_from_rank, my_rank, c, &recv_chunks[c],
+                       [this, &mu, &note](const Status& s) {
+                         mutex_lock l(mu);
+                         status_.Update(s);
+                         note.Notify();
+                       });
+          note.WaitForNotification();
+        }
+        if (!status_.ok()) break;
+        for (int target_rank : send_to_ranks) {
+          {
+            mutex_lock l(mu);
+            ++pending_count;
+          }
+          DispatchSend(si, target_rank, my_rank, c, &send_chunks[c],
+                       [this, &mu, &pending_count, &all_done](const Status& s) {
+                         mutex_lock l(mu);
+                         status_.Update(s);
+                         --pending_count;
+                         if (pending_count == 0) {
+                           all_done.notify_all();
+                         }
+                       });
+        }
+      }
+      {
+        mutex_lock l(mu);
+        if (pending_count > 0) {
+          all_done.wait(l);
+        }
+        pending_count = 0;
+      }
+    } else if (my_rank >= 0 && my_rank != source_rank) {
       // Begin by receiving the value.
       profiler::TraceMe activity(
           [&] { return strings::StrCat("ReceiveValue:", si); },
@@ -336,7 +440,7 @@ void HierarchicalTreeBroadcaster::RunTree() {
       profiler::TraceMe activity(
           [&] { return strings::StrCat("ForwardValue:", si); },
           profiler::TraceMeLevel::kInfo);
-      if (my_rank >= 0 && status_.ok()) {
+      if (num_chunks == 1 && my_rank >= 0 && status_.ok()) {
         std::vector<int> send_to_ranks;
         TreeSendTo(*col_params_, si, &send_to_ranks);
         for (int i = 0; i < send_to_ranks.size(); ++i) {
@@ -409,8 +513,15 @@ void HierarchicalTreeBroadcaster::DispatchSend(int subdiv, int dst_rank,
                                                int src_rank,
                                                const Tensor* src_tensor,
                                                const StatusCallback& done) {
+  DispatchSend(subdiv, dst_rank, src_rank, /*chunk=*/-1, src_tensor, done);
+}
+
+void HierarchicalTreeBroadcaster::DispatchSend(int subdiv, int dst_rank,
+                                               int src_rank, int chunk,
+                                               const Tensor* src_tensor,
+                                               const StatusCallback& done) {
   string send_buf_key =
-      BroadcastBufKey(col_ctx_->exec_key, subdiv, src_rank, dst_rank);
+      BroadcastBufKey(col_ctx_->exec_key, subdiv, src_rank, dst_rank, chunk);
   int dst_idx =
       col_params_->instance.impl_details.subdiv_permutations[subdiv][dst_rank];
   VLOG(3) << "DispatchSend " << send_buf_key << " from_device "
@@ -428,8 +539,15 @@ void HierarchicalTreeBroadcaster::DispatchSend(int subdiv, int dst_rank,
 void HierarchicalTreeBroadcaster::DispatchRecv(int subdiv, int src_rank,
                                                int dst_rank, Tensor* dst_tensor,
                                                const StatusCallback& done) {
+  DispatchRecv(subdiv, src_rank, dst_rank, /*chunk=*/-1, dst_tensor, done);
+}
+
+void HierarchicalTreeBroadcaster::DispatchRecv(int subdiv, int src_rank,
+                                               int dst_rank, int chunk,
+                                               Tensor* dst_tensor,
+                                               const StatusCallback& done) {
   string recv_buf_key =
-      BroadcastBufKey(col_ctx_->exec_key, subdiv, src_rank, dst_rank);
+      BroadcastBufKey(col_ctx_->exec_key, subdiv, src_rank, dst_rank, chunk);
   int src_idx =
       col_params_->instance.impl_details.subdiv_permutations[subdiv][src_rank];
   VLOG(3) << "DispatchRecv " << recv_buf_key << " from_device "
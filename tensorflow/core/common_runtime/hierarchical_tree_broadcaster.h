@@ -71,12 +71,22 @@ class HierarchicalTreeBroadcaster : public CollectiveImplementationInterface {
   void DispatchSend(int subdiv, int dst_rank, int src_rank,
                     const Tensor* src_tensor, const StatusCallback& done);
 
+  // As above, keyed additionally by `chunk` so the pipelined broadcast
+  // can move several slices of the same tensor between the same pair of
+  // ranks concurrently.  `chunk` -1 produces the whole-tensor key.
+  void DispatchSend(int subdiv, int dst_rank, int src_rank, int chunk,
+                    const Tensor* src_tensor, const StatusCallback& done);
+
   // Receives a tensor into the memory buffer owned by `dst_tensor` at this
   // device from device at `src_rank` in `subdiv`.  Calls `done` upon
   // completion.
   void DispatchRecv(int subdiv, int src_rank, int dst_rank, Tensor* dst_tensor,
                     const StatusCallback& done);
 
+  // Chunk-keyed variant of the above, see DispatchSend.
+  void DispatchRecv(int subdiv, int src_rank, int dst_rank, int chunk,
+                    Tensor* dst_tensor, const StatusCallback& done);
+
   // Executes the hierarchical broadcast defined by this op.
   void RunTree();
 
@@ -253,6 +253,9 @@ Status ImmutableExecutorState::Initialize() {
   // Initialize PendingCounts only after pending_ids_[node.id] is initialized
   // for all nodes.
   InitializePending(&graph, cf_info);
+
+  step_workspace_pool_.reset(new ExecutorInternal::StepWorkspacePool);
+
   return gview_.SetAllocAttrs(&graph, params_.device);
 }
 
@@ -24,6 +24,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/executor.h"
 #include "tensorflow/core/common_runtime/graph_view.h"
 #include "tensorflow/core/common_runtime/pending_counts.h"
+#include "tensorflow/core/common_runtime/step_workspace_pool.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/gtl/flatmap.h"
@@ -103,6 +104,13 @@ class ImmutableExecutorState {
 
   bool requires_control_flow_support() const { return requires_control_flow_; }
 
+  // Pool of reusable per-step metadata buffers shared by all invocations
+  // of this executor. The pool itself is internally synchronized; it is
+  // the only mutable state hanging off this class.
+  ExecutorInternal::StepWorkspacePool* step_workspace_pool() const {
+    return step_workspace_pool_.get();
+  }
+
   // Copies the pending counts for nodes in this graph to the given array.
   //
   // This method provides a more efficient way of initializing
@@ -158,6 +166,9 @@ class ImmutableExecutorState {
   // Shallow copies of the constant tensors used in the graph.
   std::vector<Tensor> const_tensors_;
 
+  // See step_workspace_pool().
+  std::unique_ptr<ExecutorInternal::StepWorkspacePool> step_workspace_pool_;
+
   TF_DISALLOW_COPY_AND_ASSIGN(ImmutableExecutorState);
 };
 
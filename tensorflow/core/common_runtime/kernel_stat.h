@@ -42,6 +42,8 @@ static const std::string start_node_stats_step_env_name =
     "START_NODE_STATS_STEP";
 static const std::string stop_node_stats_step_env_name =
     "STOP_NODE_STATS_STEP";
+static const std::string adaptive_inline_threshold_env_name =
+    "EXECUTOR_ADAPTIVE_INLINE_THRESHOLD";
 }
 
 // Hold stats info
@@ -68,13 +70,23 @@ class KernelStats {
       LOG(WARNING) << "Read STOP_NODE_STATS_STEP envrionment error. "
                  << s.error_message();
     }    
-    if (start_step_ > 0 && stop_step_ > 0 && 
+    if (start_step_ > 0 && stop_step_ > 0 &&
         stop_step_ > start_step_) {
       collect_kernel_stats = true;
       VLOG(1) << "User collect node stats, start_step is " << start_step_
               << ", stop_step is " << stop_step_;
-    }    
-  }    
+    }
+    s = ReadBoolFromEnvVar(
+        adaptive_inline_threshold_env_name, false,
+        &adaptive_inline_threshold_);
+    if (!s.ok()) {
+      LOG(WARNING) << "Read EXECUTOR_ADAPTIVE_INLINE_THRESHOLD envrionment"
+                   << " error. " << s.error_message();
+    }
+    if (adaptive_inline_threshold_) {
+      VLOG(1) << "User enables adaptive inline threshold for the executor.";
+    }
+  }
 
   void Initialize(const GraphView& gview,
                   const Graph* g) { 
@@ -106,7 +118,37 @@ class KernelStats {
   bool IsExpensive(const NodeItem& node) const {
     return is_expensive_[node.node_id] &&
            (cost_estimates_[node.node_id].load(std::memory_order_relaxed) >
-            kOpIsExpensiveThresholdCycles);
+            DispatchThresholdCycles());
+  }
+
+  bool AdaptiveInlineThreshold() const { return adaptive_inline_threshold_; }
+
+  // Returns the cycles threshold above which a node is worth dispatching
+  // to the threadpool. In adaptive mode this tracks the measured cost of
+  // a dispatch itself, so nodes cheaper than the dispatch stay inline;
+  // otherwise it is the static default.
+  uint64 DispatchThresholdCycles() const {
+    if (!adaptive_inline_threshold_) return kOpIsExpensiveThresholdCycles;
+    return dispatch_cost_estimate_.load(std::memory_order_relaxed);
+  }
+
+  // Folds one measured dispatch latency (cycles between handing a node to
+  // the runner and the worker picking it up) into the adaptive threshold.
+  // The sample is clamped so a transient pool stall cannot push the
+  // threshold to a level where every node runs inline.
+  void UpdateDispatchCostEstimate(uint64 elapsed_cycles) {
+    if (!adaptive_inline_threshold_) return;
+    if (elapsed_cycles > kDispatchCostClampCycles) {
+      elapsed_cycles = kDispatchCostClampCycles;
+    }
+    auto prev_estimate =
+        dispatch_cost_estimate_.load(std::memory_order_relaxed);
+    uint64 new_estimate =
+        ((kCostDecay - 1) * prev_estimate + elapsed_cycles) / kCostDecay;
+    if (new_estimate < kDispatchCostMinCycles) {
+      new_estimate = kDispatchCostMinCycles;
+    }
+    dispatch_cost_estimate_.store(new_estimate, std::memory_order_relaxed);
   }
 
   // Returns the value of kernel->IsExpensive().
@@ -273,9 +315,16 @@ class KernelStats {
   static constexpr uint64 kInitialCostEstimateCycles = 100 * 1000 * 1000;
   static constexpr uint64 kOpIsExpensiveThresholdCycles = 8000;
   static constexpr uint64 kCostDecay = 10;
+  // Bounds for the adaptive dispatch threshold.
+  static constexpr uint64 kDispatchCostMinCycles = 2000;
+  static constexpr uint64 kDispatchCostClampCycles =
+      8 * kOpIsExpensiveThresholdCycles;
 
   std::vector<bool> is_expensive_;
   std::unique_ptr<std::atomic_uint_fast64_t[]> cost_estimates_;
+  bool adaptive_inline_threshold_ = false;
+  std::atomic_uint_fast64_t dispatch_cost_estimate_{
+      kOpIsExpensiveThresholdCycles};
 
   // step to start/stop trace node
   // User can set envrionment
@@ -159,9 +159,29 @@ void LocalDevice::Init(const SessionOptions& options,
           global_tp_info_.push_back(nullptr);
         }
         if (!global_tp_info_[opt.device_threadpool_index]) {
+          SessionOptions tp_options = options;
+          if (!opt.visible_cpus.empty() &&
+              tp_options.config.intra_op_parallelism_threads() == 0) {
+            // Size the pool to this session's core slice so sessions in
+            // a session group do not oversubscribe each other's cores.
+            tp_options.config.set_intra_op_parallelism_threads(
+                opt.visible_cpus.size());
+          }
           global_tp_info_[opt.device_threadpool_index] =
               new LocalDevice::EigenThreadPoolInfo(
-                  options, port::kNUMANoAffinity, nullptr);
+                  tp_options, port::kNUMANoAffinity, nullptr);
+          if (!opt.visible_cpus.empty()) {
+            cpu_set_t cpuset;
+            CPU_ZERO(&cpuset);
+            for (auto c : opt.visible_cpus) {
+              CPU_SET(c, &cpuset);
+            }
+            global_tp_info_[opt.device_threadpool_index]
+                ->eigen_worker_threads_.workers->SetThreadPoolAffinity(cpuset);
+            LOG(INFO) << "Intra-op threadpool " << opt.device_threadpool_index
+                      << " is pinned to " << opt.visible_cpus.size()
+                      << " cpu cores.";
+          }
         }
         tp_info = global_tp_info_[opt.device_threadpool_index];
       } else {
@@ -16,6 +16,8 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_COMMON_RUNTIME_LOCAL_DEVICE_H_
 #define TENSORFLOW_CORE_COMMON_RUNTIME_LOCAL_DEVICE_H_
 
+#include <vector>
+
 #include "tensorflow/core/common_runtime/device.h"
 #include "tensorflow/core/framework/device_attributes.pb.h"
 #include "tensorflow/core/platform/macros.h"
@@ -33,6 +35,10 @@ struct DeviceGlobalThreadPoolOptions {
   int global_threadpool_num = 1;
   // Default all devices use global_threadpool[0]
   int device_threadpool_index = 0;
+  // If non-empty, the threadpool indicated by device_threadpool_index
+  // is sized to and pinned on these cpu cores, so that sessions in a
+  // session group do not contend for each other's cores.
+  std::vector<unsigned> visible_cpus;
 };
 
 // This class is shared by ThreadPoolDevice and GPUDevice and
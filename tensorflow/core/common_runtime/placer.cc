@@ -16,6 +16,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/placer.h"
 
 #include <memory>
+#include <unordered_set>
 #include <vector>
 
 #include "tensorflow/core/common_runtime/colocation_graph.h"
@@ -28,7 +29,9 @@ limitations under the License.
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/util/dump_graph.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/port.h"
 
 namespace tensorflow {
@@ -57,6 +60,54 @@ void LogDeviceAssignment(const Node* node, bool log_device_placement) {
   }
 }
 
+// Returns true if TF_SPARSE_OPS_PREFER_CPU is set. When enabled, sparse
+// preprocessing nodes without an explicit placement are defaulted to a CPU
+// device (when their constraints allow one) instead of the highest priority
+// device. Such nodes are mostly id bookkeeping and launch microsecond
+// kernels that fragment the GPU stream between the dense compute.
+bool SparseOpsPreferCpu() {
+  static const bool prefer_cpu = [] {
+    bool value = false;
+    TF_CHECK_OK(ReadBoolFromEnvVar("TF_SPARSE_OPS_PREFER_CPU", false, &value));
+    return value;
+  }();
+  return prefer_cpu;
+}
+
+// The set of op types treated as sparse preprocessing by Heuristic C below.
+// TF_SPARSE_CPU_OPS extends it with a comma separated list of op names.
+const std::unordered_set<string>& SparsePreprocessingOps() {
+  static const std::unordered_set<string>* ops = [] {
+    auto* result = new std::unordered_set<string>(
+        {"Unique", "UniqueV2", "UniqueWithCounts", "SparseReshape",
+         "SparseReorder", "SparseSlice", "SparseSplit", "SparseConcat",
+         "SparseFillEmptyRows", "SparseCross", "StringToHashBucket",
+         "StringToHashBucketFast", "StringToHashBucketStrong", "Bucketize"});
+    string extra;
+    TF_CHECK_OK(ReadStringFromEnvVar("TF_SPARSE_CPU_OPS", "", &extra));
+    for (const string& op : str_util::Split(extra, ',')) {
+      if (!op.empty()) result->insert(op);
+    }
+    return result;
+  }();
+  return *ops;
+}
+
+// Output shapes are not known at placement time, so the cost model is a
+// proxy: the op must be in the sparse preprocessing set and must not
+// produce floating point outputs. Nodes emitting float tensors carry real
+// embedding data, and moving those across the PCIe bus would cost more
+// than their kernels save.
+bool IsSmallSparsePreprocessingNode(const Node* node) {
+  if (SparsePreprocessingOps().count(node->type_string()) == 0) {
+    return false;
+  }
+  for (DataType dt : node->output_types()) {
+    if (DataTypeIsFloating(dt)) return false;
+  }
+  return true;
+}
+
 Status AssignAndLog(int assigned_device, Node* node,
                     ColocationGraph* colocation_graph,
                     bool log_device_placement) {
@@ -178,6 +229,20 @@ Status Placer::Run() {
       }
     }
 
+    // Heuristic C: small sparse preprocessing ops (id dedup, segment
+    // bookkeeping) are better off on the host when a GPU would otherwise
+    // win by device priority; their outputs ride the executor's existing
+    // per-step transfers. Opt-in via TF_SPARSE_OPS_PREFER_CPU.
+    if (assigned_device == -1 && SparseOpsPreferCpu() &&
+        IsSmallSparsePreprocessingNode(node)) {
+      for (Device* d : *devices) {
+        if (d->device_type() == DEVICE_CPU) {
+          assigned_device = graph_->InternDeviceName(d->name());
+          break;
+        }
+      }
+    }
+
     // Provide the default, if necessary.
     if (assigned_device == -1) {
       assigned_device = graph_->InternDeviceName((*devices)[0]->name());
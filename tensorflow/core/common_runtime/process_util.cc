@@ -22,12 +22,17 @@ limitations under the License.
 #endif  // INTEL_MKL
 #include <string.h>
 
+#if defined(__linux__) && !defined(__ANDROID__)
+#include <sched.h>
+#endif
+
 #include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/platform/byte_order.h"
 #include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/tracing.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/util.h"
 
 namespace tensorflow {
@@ -71,16 +76,42 @@ int32 DefaultNumInterOpThreads() {
 #endif
 }
 
+// When TF_INTER_OP_THREAD_AFFINITY is set, pin the inter-op workers to
+// the CPUs the process may run on. This keeps workers from being
+// migrated onto cores that a later affinity change (or an inherited
+// wider mask) would expose, which matters in cpuset-constrained
+// containers where migrations evict warm caches.
+void MaybeAffinitizeInterOpPool(thread::ThreadPool* pool) {
+#if defined(__linux__) && !defined(__ANDROID__)
+  static const bool affinitize = [] {
+    bool value = false;
+    Status s =
+        ReadBoolFromEnvVar("TF_INTER_OP_THREAD_AFFINITY", false, &value);
+    if (!s.ok()) {
+      LOG(ERROR) << s.error_message();
+    }
+    return value;
+  }();
+  if (!affinitize) return;
+  cpu_set_t cpuset;
+  if (sched_getaffinity(0, sizeof(cpu_set_t), &cpuset) == 0) {
+    pool->SetThreadPoolAffinity(cpuset);
+  }
+#endif
+}
+
 static thread::ThreadPool* InitComputePool(const SessionOptions& options) {
   int32 inter_op_parallelism_threads =
       options.config.inter_op_parallelism_threads();
   if (inter_op_parallelism_threads == 0) {
     inter_op_parallelism_threads = DefaultNumInterOpThreads();
   }
-  return new thread::ThreadPool(
+  thread::ThreadPool* pool = new thread::ThreadPool(
       Env::Default(), ThreadOptions(), "Compute", inter_op_parallelism_threads,
       !options.config.experimental().disable_thread_spinning(),
       /*allocator=*/nullptr);
+  MaybeAffinitizeInterOpPool(pool);
+  return pool;
 }
 
 }  // namespace
@@ -157,10 +188,12 @@ thread::ThreadPool* NewThreadPoolFromSessionOptions(
     const SessionOptions& options) {
   const int32 num_threads = NumInterOpThreadsFromSessionOptions(options);
   VLOG(1) << "Direct session inter op parallelism threads: " << num_threads;
-  return new thread::ThreadPool(
+  thread::ThreadPool* pool = new thread::ThreadPool(
       options.env, ThreadOptions(), "Compute", num_threads,
       !options.config.experimental().disable_thread_spinning(),
       /*allocator=*/nullptr);
+  MaybeAffinitizeInterOpPool(pool);
+  return pool;
 }
 
 void SchedClosure(std::function<void()> closure) {
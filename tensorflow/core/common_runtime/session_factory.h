@@ -25,6 +25,7 @@ limitations under the License.
 
 namespace tensorflow {
 
+class ResourceMgr;
 class Session;
 class SessionGroup;
 struct SessionOptions;
@@ -37,9 +38,14 @@ class SessionFactory {
   virtual Status NewSession(const SessionOptions& options,
                             Session** out_session) = 0;
 
+  // When shared_cpu_rmgr is non-null, the group is built on that
+  // resource manager (taking ownership) instead of creating a fresh
+  // one, so a replacement group can inherit the stateful resources of
+  // the group it replaces.
   virtual Status NewSessionGroup(const SessionOptions& options,
                                  SessionGroup** out_session_group,
-                                 int session_num) = 0;
+                                 int session_num,
+                                 ResourceMgr* shared_cpu_rmgr = nullptr) = 0;
 
   virtual bool AcceptsOptions(const SessionOptions& options) = 0;
 
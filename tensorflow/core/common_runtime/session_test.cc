@@ -55,7 +55,8 @@ class FakeSessionFactory : public SessionFactory {
 
   Status NewSessionGroup(const SessionOptions& options,
                          SessionGroup** out_session_group,
-                         int session_num = 1) {
+                         int session_num = 1,
+                         ResourceMgr* shared_cpu_rmgr = nullptr) override {
     return errors::Internal(
         "NewSessionGroup method not implemented in GrpcSessionFactory.");
   }
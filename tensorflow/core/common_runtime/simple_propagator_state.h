@@ -20,6 +20,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/entry.h"
 #include "tensorflow/core/common_runtime/immutable_executor_state.h"
 #include "tensorflow/core/common_runtime/pending_counts.h"
+#include "tensorflow/core/common_runtime/step_workspace_pool.h"
 #include "tensorflow/core/framework/control_flow.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/platform/logging.h"
@@ -165,6 +166,11 @@ class SimplePropagatorState {
   const int64_t step_id_;
   const bool vlog_;
 
+  // Holds the storage for input_tensors_ and pending_; acquired from the
+  // executor's StepWorkspacePool at construction and returned (for reuse
+  // by a later step) at destruction.
+  std::unique_ptr<ExecutorInternal::StepWorkspace> workspace_;
+
   // The i-th node's j-th input is stored at
   // `input_tensors[impl_->nodes[i].input_start + j]`.
   //
@@ -173,9 +179,9 @@ class SimplePropagatorState {
   // source node of an edge and is cleared by the destination of the same
   // edge. The destination node always runs after the source node, so there
   // is never concurrent access to the same entry.
-  std::vector<Entry> input_tensors_;
+  std::vector<Entry>& input_tensors_;
 
-  std::unique_ptr<std::atomic<int32>[]> pending_;
+  std::atomic<int32>* const pending_;
 
   // If `vlog_` is true, this stores a bit vector of active nodes, indexed by
   // node ID.
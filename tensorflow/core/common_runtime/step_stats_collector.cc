@@ -27,6 +27,7 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/scanner.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/util/perf_event_counters.h"
 #include "tensorflow/core/util/ptr_util.h"
 
 namespace tensorflow {
@@ -123,6 +124,7 @@ void NodeExecStatsWrapper::RecordComputeStarted() {
   stats_->set_op_start_rel_micros(now_nanos / EnvTime::kMicrosToNanos -
                                   stats_->all_start_micros());
   stats_->set_op_start_rel_nanos(now_nanos - stats_->all_start_nanos());
+  perf_sampled_ = PerfEventCounters::Read(&perf_start_);
 }
 
 void NodeExecStatsWrapper::RecordComputeEnded() {
@@ -132,6 +134,16 @@ void NodeExecStatsWrapper::RecordComputeEnded() {
   stats_->set_op_end_rel_micros(now_nanos / EnvTime::kMicrosToNanos -
                                 stats_->all_start_micros());
   stats_->set_op_end_rel_nanos(now_nanos - stats_->all_start_nanos());
+  PerfEventCounters::Sample perf_end;
+  if (perf_sampled_ && PerfEventCounters::Read(&perf_end)) {
+    // Only valid for synchronous CPU kernels: start and end are sampled
+    // on the thread that ran Compute. Async ops get no counters.
+    const int64 kCacheLineBytes = 64;
+    stats_->set_llc_misses(perf_end.llc_misses - perf_start_.llc_misses);
+    stats_->set_llc_references(perf_end.llc_references -
+                               perf_start_.llc_references);
+    stats_->set_mem_bytes_accessed(stats_->llc_misses() * kCacheLineBytes);
+  }
 }
 
 void NodeExecStatsWrapper::RecordExecutorEnded() {
@@ -408,24 +420,29 @@ void StepStatsCollector::Save(const string& device,
                                 nullptr, this));
 }
 
+StepStatsCollector::StatsShard* StepStatsCollector::shard() {
+  static thread_local int32 thread_id = Env::Default()->GetCurrentThreadId();
+  return &shards_[static_cast<uint32>(thread_id) % kNumShards];
+}
+
 void StepStatsCollector::Save(const string& device,
                               NodeExecStatsWrapper* node_stats) {
   if (!node_stats) return;
   VLOG(1) << "Save dev " << device << " node stats " << node_stats->stats();
-  {
-    mutex_lock l(mu_);
-    if (finalized_) {
-      LOG(WARNING) << "stats saved after finalize will not be collected.";
-    }
-    if (!step_stats_ || collected_nodes_ >= kMaxCollectedNodes) {
-      VLOG(1) << "step_stats_ nullptr or already collected too many nodes.";
-      delete node_stats;
-      return;
-    }
-    auto& device_stats = dev_stats_[device];
-    device_stats.push_back(std::unique_ptr<NodeExecStatsWrapper>(node_stats));
-    collected_nodes_++;
+  if (finalized_.load(std::memory_order_acquire)) {
+    LOG(WARNING) << "stats saved after finalize will not be collected.";
+  }
+  if (!step_stats_ ||
+      collected_nodes_.fetch_add(1, std::memory_order_relaxed) >=
+          kMaxCollectedNodes) {
+    VLOG(1) << "step_stats_ nullptr or already collected too many nodes.";
+    delete node_stats;
+    return;
   }
+  StatsShard* stats_shard = shard();
+  mutex_lock l(stats_shard->mu);
+  stats_shard->dev_stats[device].push_back(
+      std::unique_ptr<NodeExecStatsWrapper>(node_stats));
 }
 
 void StepStatsCollector::SaveThreadName(const string& device,
@@ -435,7 +452,7 @@ void StepStatsCollector::SaveThreadName(const string& device,
           << thread_name;
   {
     mutex_lock l(mu_);
-    if (finalized_) {
+    if (finalized_.load(std::memory_order_acquire)) {
       LOG(WARNING) << "thread_name saved after finalize will not be collected.";
     }
     auto& thread_names_map = thread_names_[device];
@@ -453,44 +470,46 @@ NodeExecStatsInterface* StepStatsCollector::CreateNodeExecStats(
 }
 
 string StepStatsCollector::ReportAllocsOnResourceExhausted(const string& err) {
-  mutex_lock l(mu_);
   if (err.find("OOM") == err.npos) {
     return "";
   }
   // <device, allocator> -> AllocStats
   std::map<std::pair<string, string>, AllocStats> allocs_map;
   string report = "\n";
-  for (const auto& dev_stat : dev_stats_) {
-    const string& device = dev_stat.first;
-    // Only print the device that has OOM.
-    // TODO(xpan): Extract device from err first to speed it up.
-    if (err.find(device) == err.npos) {
-      continue;
-    }
-    // NodeExecStatsWrapper*
-    for (const auto& stats : dev_stat.second) {
-      // std::pair<AllocatorMemoryUsed*, TrackingAllocator*>
-      for (const auto& alloc : stats->allocations_) {
-        // Only print the allocator that has OOM.
-        // TODO(xpan): Extract device from err first to speed it up.
-        if (err.find(alloc.first->allocator_name()) == err.npos) {
-          continue;
-        }
-        auto dev_allocator =
-            std::make_pair(dev_stat.first, alloc.first->allocator_name());
-        AllocStats& dev_allocs_stats = allocs_map[dev_allocator];
-        TrackingAllocator* tracking_alloc = alloc.second;
-        gtl::InlinedVector<AllocRecord, 4> cur_records =
-            tracking_alloc->GetCurrentRecords();
-        int64 cur_bytes = 0;
-        for (const auto& r : cur_records) {
-          cur_bytes += r.alloc_bytes;
-        }
-        if (cur_bytes > 0) {
-          dev_allocs_stats.total_bytes += cur_bytes;
-          dev_allocs_stats.total_nodes++;
-          dev_allocs_stats.nodes_by_size[cur_bytes].push_back(
-              stats->stats()->node_name());
+  for (StatsShard& stats_shard : shards_) {
+    mutex_lock shard_lock(stats_shard.mu);
+    for (const auto& dev_stat : stats_shard.dev_stats) {
+      const string& device = dev_stat.first;
+      // Only print the device that has OOM.
+      // TODO(xpan): Extract device from err first to speed it up.
+      if (err.find(device) == err.npos) {
+        continue;
+      }
+      // NodeExecStatsWrapper*
+      for (const auto& stats : dev_stat.second) {
+        // std::pair<AllocatorMemoryUsed*, TrackingAllocator*>
+        for (const auto& alloc : stats->allocations_) {
+          // Only print the allocator that has OOM.
+          // TODO(xpan): Extract device from err first to speed it up.
+          if (err.find(alloc.first->allocator_name()) == err.npos) {
+            continue;
+          }
+          auto dev_allocator =
+              std::make_pair(dev_stat.first, alloc.first->allocator_name());
+          AllocStats& dev_allocs_stats = allocs_map[dev_allocator];
+          TrackingAllocator* tracking_alloc = alloc.second;
+          gtl::InlinedVector<AllocRecord, 4> cur_records =
+              tracking_alloc->GetCurrentRecords();
+          int64 cur_bytes = 0;
+          for (const auto& r : cur_records) {
+            cur_bytes += r.alloc_bytes;
+          }
+          if (cur_bytes > 0) {
+            dev_allocs_stats.total_bytes += cur_bytes;
+            dev_allocs_stats.total_nodes++;
+            dev_allocs_stats.nodes_by_size[cur_bytes].push_back(
+                stats->stats()->node_name());
+          }
         }
       }
     }
@@ -541,28 +560,33 @@ void StepStatsCollector::FinalizeAndSwap(StepStats* step_stats) {
   CHECK(step_stats_);
   FinalizeInternal();
   step_stats->Swap(step_stats_);
-  collected_nodes_ = 0;
+  collected_nodes_.store(0, std::memory_order_relaxed);
 }
 
 void StepStatsCollector::FinalizeInternal() {
-  if (!step_stats_ || finalized_) {
+  if (!step_stats_ || finalized_.load(std::memory_order_acquire)) {
     return;
   }
-  finalized_ = true;
+  finalized_.store(true, std::memory_order_release);
   std::map<string, DeviceStepStats*> dev_stats_pb;
   for (auto& ds : *step_stats_->mutable_dev_stats()) {
     dev_stats_pb[ds.device()] = &ds;
   }
-  for (const auto& dev_stat : dev_stats_) {
-    if (dev_stats_pb.find(dev_stat.first) == dev_stats_pb.end()) {
-      DeviceStepStats* ndev_stat = step_stats_->add_dev_stats();
-      ndev_stat->set_device(dev_stat.first);
-      dev_stats_pb[dev_stat.first] = ndev_stat;
-    }
-    DeviceStepStats* dss = dev_stats_pb.at(dev_stat.first);
-    for (auto& stats : dev_stat.second) {
-      stats->Finalize();
-      stats->stats()->Swap(dss->add_node_stats());
+  // Merge the per-thread shards; this is the only point where the
+  // buffered stats of different threads meet.
+  for (StatsShard& stats_shard : shards_) {
+    mutex_lock shard_lock(stats_shard.mu);
+    for (const auto& dev_stat : stats_shard.dev_stats) {
+      if (dev_stats_pb.find(dev_stat.first) == dev_stats_pb.end()) {
+        DeviceStepStats* ndev_stat = step_stats_->add_dev_stats();
+        ndev_stat->set_device(dev_stat.first);
+        dev_stats_pb[dev_stat.first] = ndev_stat;
+      }
+      DeviceStepStats* dss = dev_stats_pb.at(dev_stat.first);
+      for (auto& stats : dev_stat.second) {
+        stats->Finalize();
+        stats->stats()->Swap(dss->add_node_stats());
+      }
     }
   }
   for (const auto& device_thread : thread_names_) {
@@ -15,6 +15,8 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_COMMON_RUNTIME_STEP_STATS_COLLECTOR_H_
 #define TENSORFLOW_CORE_COMMON_RUNTIME_STEP_STATS_COLLECTOR_H_
 
+#include <array>
+#include <atomic>
 #include <memory>
 #include <unordered_map>
 #include <vector>
@@ -25,6 +27,7 @@ limitations under the License.
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/perf_event_counters.h"
 
 namespace tensorflow {
 
@@ -139,6 +142,9 @@ class NodeExecStatsWrapper : public NodeExecStatsInterface {
   std::unique_ptr<NodeExecStats> stats_;
   const NodeDef* const node_;                       // Not owned.
   StepStatsCollector* const step_stats_collector_;  // Not owned.
+  // Hardware counters at compute start (TF_NODE_PERF_COUNTERS=1 only).
+  PerfEventCounters::Sample perf_start_;
+  bool perf_sampled_ = false;
 };
 
 // Statistics collection interface for step execution.
@@ -200,17 +206,32 @@ class StepStatsCollector : public StepStatsCollectorInterface {
   // that works for all cases.
   static const uint64 kMaxCollectedNodes = 1 << 20;
 
+  // Save() runs on every op completion of every executor thread, so the
+  // collected stats are sharded by thread id and only merged at
+  // finalization. A thread takes the same uncontended shard lock for the
+  // whole step instead of racing all other threads for one mutex, which
+  // keeps collection from distorting the timings it measures.
+  static const int kNumShards = 16;
+
   typedef std::vector<std::unique_ptr<NodeExecStatsWrapper>> NodeStatsVector;
   typedef std::unordered_map<uint32, string> ThreadNamesMap;
 
+  struct StatsShard {
+    mutex mu;
+    std::unordered_map<string, NodeStatsVector> dev_stats GUARDED_BY(mu);
+  };
+
+  // Shard serving the calling thread.
+  StatsShard* shard();
+
   void FinalizeInternal() EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
   mutex mu_;
-  bool finalized_ GUARDED_BY(mu_);
-  std::unordered_map<string, NodeStatsVector> dev_stats_ GUARDED_BY(mu_);
+  std::atomic<bool> finalized_;
+  std::array<StatsShard, kNumShards> shards_;
   std::unordered_map<string, ThreadNamesMap> thread_names_ GUARDED_BY(mu_);
-  StepStats* step_stats_ GUARDED_BY(mu_);
-  uint64 collected_nodes_ GUARDED_BY(mu_) = 0;
+  StepStats* step_stats_;  // set once in the constructor
+  std::atomic<uint64> collected_nodes_{0};
 };
 
 }  // namespace tensorflow
@@ -0,0 +1,115 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_STEP_WORKSPACE_POOL_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_STEP_WORKSPACE_POOL_H_
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/entry.h"
+#include "tensorflow/core/lib/gtl/inlined_vector.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+namespace ExecutorInternal {
+
+namespace {
+static const std::string step_workspace_pool_env_name =
+    "EXECUTOR_STEP_WORKSPACE_POOL";
+}
+
+// Per-step transient edge-state metadata of one Executor::Run invocation:
+// the input tensor entries and the pending-count array. The sizes only
+// depend on the executor's graph, so the buffers can be reset and reused
+// between steps instead of being reallocated for every Session::Run.
+struct StepWorkspace {
+  std::vector<Entry> input_tensors;
+  std::unique_ptr<std::atomic<int32>[]> pending;
+  size_t pending_size = 0;
+};
+
+// A small per-executor pool of StepWorkspaces. At high QPS the per-step
+// allocation of this metadata shows up in profiles; the pool keeps up to
+// kMaxPooledWorkspaces of them (bounding retained memory to the number of
+// concurrently running steps actually observed) and hands them back out
+// with the entries cleared.
+//
+// User can set environment 'EXECUTOR_STEP_WORKSPACE_POOL' to false to
+// always allocate fresh buffers.
+class StepWorkspacePool {
+ public:
+  StepWorkspacePool() {
+    Status s = ReadBoolFromEnvVar(
+        step_workspace_pool_env_name, true, &enabled_);
+    if (!s.ok()) {
+      LOG(WARNING) << "Read EXECUTOR_STEP_WORKSPACE_POOL envrionment error. "
+                   << s.error_message();
+    }
+  }
+
+  std::unique_ptr<StepWorkspace> Acquire(size_t total_inputs,
+                                         size_t num_nodes) {
+    std::unique_ptr<StepWorkspace> workspace;
+    if (enabled_) {
+      mutex_lock l(mu_);
+      if (!free_list_.empty()) {
+        workspace = std::move(free_list_.back());
+        free_list_.pop_back();
+      }
+    }
+    if (workspace == nullptr) {
+      workspace.reset(new StepWorkspace);
+    }
+    // The sizes are fixed per executor; resizing is a no-op on reuse.
+    workspace->input_tensors.resize(total_inputs);
+    if (workspace->pending_size < num_nodes) {
+      workspace->pending.reset(new std::atomic<int32>[num_nodes]);
+      workspace->pending_size = num_nodes;
+    }
+    return workspace;
+  }
+
+  void Release(std::unique_ptr<StepWorkspace> workspace) {
+    if (!enabled_ || workspace == nullptr) return;
+    // Drop any tensors a cancelled or failed step left behind; after a
+    // successful step the entries are already empty and this is a cheap
+    // scan over NO_VALUE states.
+    for (Entry& entry : workspace->input_tensors) {
+      entry.ClearVal();
+    }
+    mutex_lock l(mu_);
+    if (free_list_.size() < kMaxPooledWorkspaces) {
+      free_list_.push_back(std::move(workspace));
+    }
+  }
+
+ private:
+  static constexpr size_t kMaxPooledWorkspaces = 8;
+
+  bool enabled_ = true;
+  mutex mu_;
+  gtl::InlinedVector<std::unique_ptr<StepWorkspace>, 4> free_list_
+      GUARDED_BY(mu_);
+};
+
+}  // end namespace ExecutorInternal
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_STEP_WORKSPACE_POOL_H_
@@ -20,7 +20,7 @@ limitations under the License.
 namespace tensorflow {
 
 CallOptions::CallOptions()
-  : timeout_in_ms_(0), use_wait_for_ready_(false) {}
+  : timeout_in_ms_(0), use_wait_for_ready_(false), priority_(0) {}
 
 void CallOptions::StartCancel() {
   mutex_lock l(mu_);
@@ -62,4 +62,14 @@ void CallOptions::SetUseWaitForReady(bool wait_for_ready) {
   use_wait_for_ready_ = wait_for_ready;
 }
 
+int32 CallOptions::GetPriority() {
+  mutex_lock l(mu_);
+  return priority_;
+}
+
+void CallOptions::SetPriority(int32 priority) {
+  mutex_lock l(mu_);
+  priority_ = priority;
+}
+
 }  // end namespace tensorflow
@@ -68,6 +68,12 @@ class CallOptions {
   bool UseWaitForReady();
   void SetUseWaitForReady(bool wait_for_ready);
 
+  // Get and set RPC priority. 0 (the default) marks bulk traffic; higher
+  // values mark latency-critical transfers, which servers with priority
+  // lanes enabled dispatch ahead of bulk traffic.
+  int32 GetPriority();
+  void SetPriority(int32 priority);
+
  private:
   mutex mu_;
   CancelFunction cancel_func_ GUARDED_BY(mu_);
@@ -77,6 +83,9 @@ class CallOptions {
 
   // use_rpc_wait_for_ready
   bool use_wait_for_ready_ GUARDED_BY(mu_);
+
+  // RPC priority lane.
+  int32 priority_ GUARDED_BY(mu_);
   TF_DISALLOW_COPY_AND_ASSIGN(CallOptions);
 };
 
@@ -21,6 +21,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/process_util.h"
 #include "tensorflow/core/distributed_runtime/cancellable_call.h"
 #include "tensorflow/core/distributed_runtime/request_id.h"
+#include "tensorflow/core/distributed_runtime/shm_transport.h"
 #include "tensorflow/core/distributed_runtime/worker_cache.h"
 #include "tensorflow/core/platform/protobuf_internal.h"
 #include "tensorflow/core/protobuf/transport_options.pb.h"
@@ -50,6 +51,13 @@ class RecvBufCall : public CancellableCall {
     req_.set_src_incarnation(server_attributes.incarnation());
     req_.set_dst_device(to_device->name());
     req_.set_request_id(GetUniqueRequestId());
+    if (shm_transport::Enabled()) {
+      // Advertise our host identity so a co-located server can return a
+      // shared memory descriptor instead of the tensor bytes.
+      RecvBufShmHint hint;
+      hint.set_host_id(shm_transport::HostId());
+      req_.mutable_transport_options()->PackFrom(hint);
+    }
   }
 
   ~RecvBufCall() override {}
@@ -101,14 +109,33 @@ void CollectiveRemoteAccessDistributed::RecvFromPeer(
                             done](const Status& s) {
     if (s.ok()) {
       // In this generic implementation the bytes come back in the
-      // RPC response protobuf rather than via RDMA so we need to copy
-      // them into the destination tensor here.
+      // RPC response protobuf, or, for same-host peers using the shm
+      // transport, in a shared memory segment the response names. Either
+      // way we need to copy them into the destination tensor here.
       RecvBufRespExtra extra;
-      state->call->resp_.transport_options().UnpackTo(&extra);
+      RecvBufShmExtra shm_extra;
+      const bool via_shm =
+          state->call->resp_.transport_options().Is<RecvBufShmExtra>();
       int64 num_bytes = 0;
-      for (const auto& chunk : extra.tensor_content()) {
-        num_bytes += chunk.size();
+      if (via_shm) {
+        state->call->resp_.transport_options().UnpackTo(&shm_extra);
+        num_bytes = shm_extra.byte_size();
+      } else {
+        state->call->resp_.transport_options().UnpackTo(&extra);
+        for (const auto& chunk : extra.tensor_content()) {
+          num_bytes += chunk.size();
+        }
       }
+      auto populate_tensor = [via_shm, &shm_extra, &extra,
+                              num_bytes](Tensor* cpu_tensor) {
+        if (via_shm) {
+          return shm_transport::ReadSegment(shm_extra.segment_name(),
+                                            num_bytes,
+                                            DMAHelper::base(cpu_tensor));
+        }
+        PopulateTensorFromExtra(extra, cpu_tensor);
+        return Status::OK();
+      };
       if (num_bytes != to_tensor->TotalBytes()) {
         done(errors::Internal("RecvBufResponse returned ", num_bytes,
                               " bytes where to_tensor expected ",
@@ -131,7 +158,13 @@ void CollectiveRemoteAccessDistributed::RecvFromPeer(
         cpu_attr.set_gpu_compatible(true);
         Tensor* cpu_tensor = new Tensor(cpu_dev->GetAllocator(cpu_attr),
                                         to_tensor->dtype(), to_tensor->shape());
-        PopulateTensorFromExtra(extra, cpu_tensor);
+        Status populate_status = populate_tensor(cpu_tensor);
+        if (!populate_status.ok()) {
+          delete cpu_tensor;
+          done(populate_status);
+          delete state;
+          return;
+        }
         // Then copy it to the GPU.
         CopyTensor::ViaDMA("",  // edge name (non-existent)
                            nullptr /*send_dev_ctx*/, to_device_ctx, cpu_dev,
@@ -147,7 +180,12 @@ void CollectiveRemoteAccessDistributed::RecvFromPeer(
         return;
       } else {
         // CPU device
-        PopulateTensorFromExtra(extra, to_tensor);
+        Status populate_status = populate_tensor(to_tensor);
+        if (!populate_status.ok()) {
+          delete state;
+          done(populate_status);
+          return;
+        }
       }
     }
     if (!s.ok() && errors::IsFailedPrecondition(s)) {
@@ -47,6 +47,8 @@ limitations under the License.
 #include "tensorflow/core/graph/graph_partition.h"
 #include "tensorflow/core/graph/validate.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
@@ -68,13 +70,25 @@ GraphMgr::GraphMgr(const WorkerEnv* worker_env, DeviceMgr* device_mgr)
   if (!status.ok()) {
     LOG(ERROR) << status.error_message();
   }
+  status = ReadBoolFromEnvVar("TF_GRAPH_MGR_DIFF_REGISTER", true,
+                              &reuse_unchanged_graphs_);
+  if (!status.ok()) {
+    LOG(ERROR) << status.error_message();
+  }
 }
 
 GraphMgr::~GraphMgr() {
+  for (auto p : last_item_by_session_) p.second->Unref();
   for (auto p : table_) p.second->Unref();
 }
 
 GraphMgr::Item::~Item() {
+  if (this->reuse_parent != nullptr) {
+    // Executors, kernels, op-segment holds and cost models belong to
+    // the item this one borrowed from.
+    this->reuse_parent->Unref();
+    return;
+  }
   for (const auto& unit : this->units) {
     CHECK_NOTNULL(unit.device);
     if (!graph_mgr->skip_cost_models_) {
@@ -301,6 +315,39 @@ Status GraphMgr::Register(const string& handle, const GraphDef& gdef,
                           int64 collective_graph_key,
                           DistributedFunctionLibraryRuntime* cluster_flr,
                           string* graph_handle) {
+  // Streaming model pushes re-register an unchanged graph just to swap
+  // variable values. When the fingerprint matches the session's last
+  // registration, hand out a new handle that borrows the existing
+  // executors instead of repartitioning, re-optimizing and rebuilding
+  // kernels. Debug-decorated graphs are never fingerprinted: the
+  // decoration rewrites the executors per registration.
+  uint64 fingerprint = 0;
+  if (reuse_unchanged_graphs_ &&
+      debug_options.debug_tensor_watch_opts().empty()) {
+    fingerprint = Hash64Combine(DeterministicProtoHash64(gdef),
+                                static_cast<uint64>(collective_graph_key));
+    mutex_lock l(mu_);
+    auto iter = last_item_by_session_.find(handle);
+    if (iter != last_item_by_session_.end() &&
+        iter->second->fingerprint == fingerprint) {
+      Item* parent = iter->second;
+      Item* item = new Item;
+      item->session = handle;
+      item->fingerprint = fingerprint;
+      item->collective_graph_key = parent->collective_graph_key;
+      item->units = parent->units;
+      item->graph_mgr = this;
+      item->reuse_parent = parent;
+      parent->Ref();
+      *graph_handle = strings::Printf("%016llx", ++next_id_);
+      item->handle = *graph_handle;
+      CHECK(table_.insert({*graph_handle, item}).second);
+      VLOG(1) << "GraphMgr reusing executors of unchanged graph for session "
+              << handle << ", new handle " << *graph_handle;
+      return Status::OK();
+    }
+  }
+
   Item* item = new Item;
   Status s = InitItem(handle, gdef, session, graph_options, debug_options,
                       collective_graph_key, cluster_flr, item);
@@ -308,6 +355,7 @@ Status GraphMgr::Register(const string& handle, const GraphDef& gdef,
     item->Unref();
     return s;
   }
+  item->fingerprint = fingerprint;
 
   // Inserts one item into table_.
   {
@@ -315,6 +363,14 @@ Status GraphMgr::Register(const string& handle, const GraphDef& gdef,
     *graph_handle = strings::Printf("%016llx", ++next_id_);
     item->handle = *graph_handle;
     CHECK(table_.insert({*graph_handle, item}).second);
+    if (fingerprint != 0) {
+      // This item becomes the session's reuse donor; drop the previous
+      // generation.
+      Item*& last = last_item_by_session_[handle];
+      if (last != nullptr) last->Unref();
+      last = item;
+      item->Ref();
+    }
   }
   return Status::OK();
 }
@@ -345,6 +401,10 @@ Status GraphMgr::DeregisterAll() {
       items.push_back(entry.second);
     }
     table_.clear();
+    for (const auto& entry : last_item_by_session_) {
+      items.push_back(entry.second);
+    }
+    last_item_by_session_.clear();
   }
   for (auto item : items) {
     item->Unref();
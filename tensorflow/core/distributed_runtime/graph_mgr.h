@@ -154,6 +154,18 @@ class GraphMgr {
     GraphMgr* graph_mgr;
 
     int64 collective_graph_key;
+
+    // Deterministic hash of the registered GraphDef (plus the
+    // collective key), used to detect re-registrations of an unchanged
+    // graph. 0 when fingerprinting is off for this item.
+    uint64 fingerprint = 0;
+
+    // Set when this item was registered against an unchanged graph and
+    // borrows its executors: `units` aliases the parent's units, the
+    // parent holds the kernels, op-segment holds and cost models, and
+    // this item only pins the parent alive. Destruction then just
+    // releases the parent.
+    Item* reuse_parent = nullptr;
   };
 
   const WorkerEnv* worker_env_;  // Not owned.
@@ -175,6 +187,16 @@ class GraphMgr {
   // mechanism to gc these graphs.
   std::unordered_map<string, Item*> table_;
 
+  // Differential registration: the most recent item registered per
+  // session, held with one extra ref so its executors survive the
+  // deregister of a streaming model push. A re-registration whose
+  // graph fingerprint matches borrows these executors instead of
+  // rebuilding; one that does not match replaces the entry. At most
+  // one spare generation is kept per session. Controlled by
+  // TF_GRAPH_MGR_DIFF_REGISTER (default true).
+  std::unordered_map<string, Item*> last_item_by_session_ GUARDED_BY(mu_);
+  bool reuse_unchanged_graphs_ = true;
+
   void StartParallelExecutors(const string& handle, int64 step_id, Item* item,
                               Rendezvous* rendezvous,
                               Rendezvous* global_rendezvous,
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/master_session.h"
 
+#include <limits>
 #include <memory>
 #include <unordered_map>
 #include <unordered_set>
@@ -1442,6 +1443,22 @@ string BuildGraphOptionsString(const BuildGraphOptions& opts) {
   return buf;
 }
 
+namespace {
+
+// Upper bound on the number of cached partitioned subgraphs per run table.
+// 0 keeps the historical unbounded behavior.
+int64 RunGraphCacheLimit() {
+  int64 limit = 0;
+  Status s =
+      ReadInt64FromEnvVar("TF_MASTER_RUN_GRAPH_CACHE_SIZE", 0, &limit);
+  if (!s.ok()) {
+    LOG(WARNING) << "Invalid TF_MASTER_RUN_GRAPH_CACHE_SIZE: " << s;
+  }
+  return limit;
+}
+
+} // namespace
+
 MasterSession::MasterSession(
     const SessionOptions& opt, const MasterEnv* env,
     std::unique_ptr<std::vector<std::unique_ptr<Device>>> remote_devs,
@@ -1459,7 +1476,8 @@ MasterSession::MasterSession(
       stats_publisher_factory_(std::move(stats_publisher_factory)),
       graph_version_(0),
       run_graphs_(5),
-      partial_run_graphs_(5) {
+      partial_run_graphs_(5),
+      run_graph_cache_limit_(RunGraphCacheLimit()) {
   UpdateLastAccessTime();
   CHECK(devices_) << "device_set was null!";
 
@@ -1721,6 +1739,7 @@ WorkerCacheInterface* MasterSession::get_worker_cache() const {
 Status MasterSession::StartStep(const BuildGraphOptions& opts, bool is_partial,
                                 ReffedClientGraph** out_rcg, int64* out_count) {
   const uint64 hash = HashBuildGraphOptions(opts);
+  std::vector<ReffedClientGraph*> to_unref;
   {
     mutex_lock l(mu_);
     // TODO(suharshs): We cache partial run graphs and run graphs separately
@@ -1758,8 +1777,17 @@ Status MasterSession::StartStep(const BuildGraphOptions& opts, bool is_partial,
       VLOG(1) << "Preparing to execute new graph";
     }
     *out_rcg = iter->second;
+    rcg_last_use_[*out_rcg] = ++rcg_use_tick_;
     (*out_rcg)->Ref();
     *out_count = (*out_rcg)->get_and_increment_execution_count();
+    if (run_graph_cache_limit_ > 0 &&
+        m->size() > static_cast<size_t>(run_graph_cache_limit_)) {
+      EvictStaleRunGraphs(m, &to_unref);
+    }
+  }
+  // Deregistering evicted partitions issues RPCs; do it outside of mu_.
+  for (ReffedClientGraph* rcg : to_unref) {
+    rcg->Unref();
   }
   return Status::OK();
 }
@@ -1769,6 +1797,7 @@ void MasterSession::ClearRunsTable(std::vector<ReffedClientGraph*>* to_unref,
   VLOG(1) << "Discarding all reffed graphs";
   for (auto p : *rcg_map) {
     ReffedClientGraph* rcg = p.second;
+    rcg_last_use_.erase(rcg);
     if (to_unref) {
       to_unref->push_back(rcg);
     } else {
@@ -1778,6 +1807,30 @@ void MasterSession::ClearRunsTable(std::vector<ReffedClientGraph*>* to_unref,
   rcg_map->clear();
 }
 
+void MasterSession::EvictStaleRunGraphs(
+    RCGMap* rcg_map, std::vector<ReffedClientGraph*>* to_unref) {
+  while (rcg_map->size() > static_cast<size_t>(run_graph_cache_limit_)) {
+    auto victim = rcg_map->end();
+    int64 oldest_tick = std::numeric_limits<int64>::max();
+    for (auto it = rcg_map->begin(); it != rcg_map->end(); ++it) {
+      auto tick_iter = rcg_last_use_.find(it->second);
+      const int64 tick =
+          tick_iter == rcg_last_use_.end() ? 0 : tick_iter->second;
+      if (tick < oldest_tick) {
+        oldest_tick = tick;
+        victim = it;
+      }
+    }
+    if (victim == rcg_map->end()) {
+      return;
+    }
+    VLOG(1) << "Evicting cached subgraph with hash " << victim->first;
+    rcg_last_use_.erase(victim->second);
+    to_unref->push_back(victim->second);
+    rcg_map->erase(victim);
+  }
+}
+
 uint64 MasterSession::NewStepId(int64 graph_key) {
   if (graph_key == BuildGraphOptions::kNoCollectiveGraphKey) {
     // StepId must leave the most-significant 7 bits empty for future use.
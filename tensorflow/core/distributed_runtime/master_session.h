@@ -155,6 +155,14 @@ class MasterSession : public core::RefCounted {
   typedef std::unordered_map<uint64, ReffedClientGraph*> RCGMap;
   RCGMap run_graphs_ GUARDED_BY(mu_);
   RCGMap partial_run_graphs_ GUARDED_BY(mu_);
+  // Bounds run_graphs_ and partial_run_graphs_. When positive, the least
+  // recently used cached subgraphs are evicted (and their partitions
+  // deregistered from the workers) once a table exceeds the limit, so
+  // jobs that keep changing feeds/fetches do not grow the tables without
+  // bound. 0 (the default) keeps the tables unbounded.
+  const int64 run_graph_cache_limit_;
+  int64 rcg_use_tick_ GUARDED_BY(mu_) = 0;
+  std::unordered_map<ReffedClientGraph*, int64> rcg_last_use_ GUARDED_BY(mu_);
   int64 next_callable_handle_ GUARDED_BY(mu_) = 0;
   RCGMap callables_ GUARDED_BY(mu_);
 
@@ -226,6 +234,13 @@ class MasterSession : public core::RefCounted {
                    ReffedClientGraph** out_rcg, int64* out_count);
   void ClearRunsTable(std::vector<ReffedClientGraph*>* to_unref,
                       RCGMap* rcg_map) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Evicts least recently used entries from "rcg_map" until it is within
+  // run_graph_cache_limit_. Evicted graphs are appended to "to_unref" so
+  // the caller can release them (and trigger partition deregistration)
+  // outside of mu_.
+  void EvictStaleRunGraphs(RCGMap* rcg_map,
+                           std::vector<ReffedClientGraph*>* to_unref)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
   void FillPerStepState(MasterSession::ReffedClientGraph* rcg,
                         const RunOptions& run_options, uint64 step_id,
                         int64 count, PerStepState* out_pss,
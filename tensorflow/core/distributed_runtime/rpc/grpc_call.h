@@ -16,6 +16,8 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_GRPC_CALL_H_
 #define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_GRPC_CALL_H_
 
+#include <vector>
+
 #include "grpcpp/completion_queue.h"
 #include "grpcpp/impl/service_type.h"
 #include "grpcpp/server_builder.h"
@@ -163,7 +165,7 @@ class Call : public UntypedCall<Service> {
   Call(HandleRequestFunction handle_request_function)
       : handle_request_function_(handle_request_function), responder_(&ctx_) {}
 
-  virtual ~Call() {}
+  virtual ~Call() { get_message_freelist()->Release(messages_); }
 
   void RequestReceived(Service* service, bool ok) override {
     if (ok) {
@@ -243,8 +245,71 @@ class Call : public UntypedCall<Service> {
                                     &call->request_received_tag_);
   }
 
-  RequestMessage request;
-  ResponseMessage response;
+ private:
+  // Backing storage for `request` and `response`. Message pairs are drawn
+  // from a per-specialization free list and returned to it, cleared, when
+  // the call is destroyed. protobuf Clear() retains allocated storage, so
+  // steady-state RPC traffic stops cycling message subobjects through the
+  // heap. The call object itself cannot be pooled, since gRPC requires a
+  // fresh ServerContext for every call. This mirrors the client-side
+  // RpcRecvTensorFreeList in rpc_rendezvous_mgr.cc; a single locked free
+  // list is used rather than a per-thread one because a call may complete
+  // on a different completion-queue thread than the one that enqueued it.
+  struct MessagePair {
+    RequestMessage request;
+    ResponseMessage response;
+  };
+
+  class MessagePairFreeList {
+   public:
+    ~MessagePairFreeList() {
+      for (size_t i = 0; i < objects_.size(); i++) {
+        delete objects_[i];
+      }
+    }
+
+    MessagePair* New() {
+      {
+        mutex_lock l(mu_);
+        if (!objects_.empty()) {
+          MessagePair* result = objects_.back();
+          objects_.pop_back();
+          return result;
+        }
+      }
+      return new MessagePair;
+    }
+
+    void Release(MessagePair* obj) {
+      obj->request.Clear();
+      obj->response.Clear();
+      {
+        mutex_lock l(mu_);
+        if (objects_.size() < kMaxObjects) {
+          objects_.push_back(obj);
+          return;
+        }
+      }
+      delete obj;
+    }
+
+   private:
+    static const int kMaxObjects = 1000;
+
+    mutex mu_;
+    std::vector<MessagePair*> objects_ GUARDED_BY(mu_);
+  };
+
+  static MessagePairFreeList* get_message_freelist() {
+    static MessagePairFreeList* freelist = new MessagePairFreeList;
+    return freelist;
+  }
+
+  MessagePair* const messages_ = get_message_freelist()->New();
+
+ public:
+  RequestMessage& request = messages_->request;
+  ResponseMessage& response = messages_->response;
 
   const std::multimap<::grpc::string_ref, ::grpc::string_ref>& client_metadata()
       const {
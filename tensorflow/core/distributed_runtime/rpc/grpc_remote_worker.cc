@@ -217,6 +217,15 @@ class GrpcRemoteWorker :
     // Type-specialized logging for this method.
     bool logging_active = logger_->LoggingActive() || VLOG_IS_ON(2);
 
+    // Carry the caller's priority lane to the server so workers with
+    // priority lanes enabled can dispatch this transfer ahead of bulk
+    // traffic.
+    if (call_opts != nullptr && call_opts->GetPriority() > 0 &&
+        request->priority() == 0) {
+      const_cast<RecvTensorRequest*>(request)->set_priority(
+          call_opts->GetPriority());
+    }
+
     auto callback = [this, request, response, done, start_usec,
                      logging_active](Status s) {
       if (logging_active) {
@@ -14,9 +14,18 @@ limitations under the License.
 ==============================================================================*/
 
 #include "tensorflow/core/distributed_runtime/rpc/grpc_tensor_coding.h"
+
+#include <lz4.h>
+#include <zstd.h>
+
+#include <climits>
+
 #include "grpcpp/support/byte_buffer.h"
 #include "grpcpp/support/slice.h"
 #include "tensorflow/core/common_runtime/dma_helper.h"
+#include "tensorflow/core/distributed_runtime/tensor_coding.h"
+#include "tensorflow/core/lib/core/coding.h"
+#include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/tensor_reference.h"
@@ -375,5 +384,70 @@ void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val, bool require_ack,
   }
 }
 
+Status CompressTensorByteBuffer(const string& algorithm,
+                                ::grpc::ByteBuffer* result) {
+  uint8 codec;
+  if (algorithm == "lz4") {
+    codec = kTensorCompressionLz4;
+  } else if (algorithm == "zstd") {
+    codec = kTensorCompressionZstd;
+  } else {
+    return errors::InvalidArgument("Unknown compression algorithm: ",
+                                   algorithm);
+  }
+
+  std::vector<::grpc::Slice> slices;
+  ::grpc::Status gs = result->Dump(&slices);
+  if (!gs.ok()) {
+    return errors::Internal("Could not dump the response byte buffer");
+  }
+  string raw;
+  raw.reserve(result->Length());
+  for (const ::grpc::Slice& s : slices) {
+    raw.append(reinterpret_cast<const char*>(s.begin()), s.size());
+  }
+  if (raw.empty() || raw.size() > static_cast<size_t>(INT_MAX)) {
+    // Nothing to gain, or beyond what LZ4 can address in one block.
+    return Status::OK();
+  }
+
+  string frame;
+  size_t compressed_size = 0;
+  if (codec == kTensorCompressionLz4) {
+    const int bound = LZ4_compressBound(static_cast<int>(raw.size()));
+    frame.resize(kTensorCompressionHeaderSize + bound);
+    const int n =
+        LZ4_compress_default(raw.data(), &frame[kTensorCompressionHeaderSize],
+                             static_cast<int>(raw.size()), bound);
+    if (n <= 0) {
+      return errors::Internal("LZ4 compression failed");
+    }
+    compressed_size = n;
+  } else {
+    const size_t bound = ZSTD_compressBound(raw.size());
+    frame.resize(kTensorCompressionHeaderSize + bound);
+    const size_t n = ZSTD_compress(&frame[kTensorCompressionHeaderSize], bound,
+                                   raw.data(), raw.size(), /*level=*/1);
+    if (ZSTD_isError(n)) {
+      return errors::Internal("ZSTD compression failed: ",
+                              ZSTD_getErrorName(n));
+    }
+    compressed_size = n;
+  }
+  if (kTensorCompressionHeaderSize + compressed_size >= raw.size()) {
+    // Incompressible payload; keep the raw encoding.
+    return Status::OK();
+  }
+  frame.resize(kTensorCompressionHeaderSize + compressed_size);
+  frame[0] = static_cast<char>(kTensorCompressionMagic);
+  frame[1] = static_cast<char>(codec);
+  core::EncodeFixed64(&frame[2], raw.size());
+
+  ::grpc::Slice frame_slice(frame.data(), frame.size());
+  ::grpc::ByteBuffer compressed(&frame_slice, 1);
+  result->Swap(&compressed);
+  return Status::OK();
+}
+
 }  // namespace grpc
 }  // namespace tensorflow
@@ -20,6 +20,8 @@ limitations under the License.
 
 #include "grpc++/support/slice.h"
 #include "grpcpp/impl/codegen/byte_buffer.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/types.h"
 
 namespace tensorflow {
 class Tensor;
@@ -55,6 +57,15 @@ void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val, bool require_ack,
 void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val,
                               std::vector<std::vector<::grpc::Slice> >* slices,
                               int idx, uint64_t fuse_count);
+
+// Rewrites *result in place into a compressed RecvTensor frame (see
+// tensor_coding.h for the layout). "algorithm" is "lz4" or "zstd", as
+// advertised by the receiver in RecvTensorRequest.compression_algorithm.
+// *result is left unchanged when the compressed frame would not be smaller
+// than the raw encoding; the receiver detects the frame by its leading
+// magic byte, so skipping compression is always safe.
+Status CompressTensorByteBuffer(const string& algorithm,
+                                ::grpc::ByteBuffer* result);
 }  // namespace grpc
 }  // namespace tensorflow
 
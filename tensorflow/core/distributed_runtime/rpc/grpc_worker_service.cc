@@ -42,6 +42,7 @@ limitations under the License.
 #include "tensorflow/core/distributed_runtime/rpc/grpc_tensor_coding.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_util.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_worker_service_impl.h"
+#include "tensorflow/core/distributed_runtime/shm_transport.h"
 #include "tensorflow/core/distributed_runtime/worker.h"
 #include "tensorflow/core/distributed_runtime/worker_cache.h"
 #include "tensorflow/core/distributed_runtime/worker_session.h"
@@ -50,6 +51,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/gtl/map_util.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
@@ -58,11 +60,128 @@ limitations under the License.
 #include "tensorflow/core/platform/tracing.h"
 #include "tensorflow/core/protobuf/transport_options.pb.h"
 #include "tensorflow/core/protobuf/worker.pb.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 
 namespace {
 
+// Weighted-fair two-lane dispatcher for RecvTensor handling. Transfers
+// whose request carries a non-zero priority (see CallOptions::SetPriority)
+// are queued in the high lane; bulk traffic goes to the low lane. While
+// the compute pool is saturated, queued work is drained "weight" high-lane
+// closures per low-lane closure, so small latency-sensitive transfers are
+// not stuck behind variable broadcasts. When the pool has idle threads,
+// closures are dispatched immediately and the lanes stay empty.
+class RecvTensorLaneScheduler {
+ public:
+  RecvTensorLaneScheduler(thread::ThreadPool* pool, int64 weight)
+      : pool_(pool),
+        weight_(std::max(weight, static_cast<int64>(1))),
+        max_inflight_(std::max(pool->NumThreads(), 1)),
+        high_credit_(weight_) {}
+
+  void Schedule(int32 priority, std::function<void()> fn) {
+    {
+      mutex_lock l(mu_);
+      if (inflight_ >= max_inflight_) {
+        (priority > 0 ? high_ : low_).push_back(std::move(fn));
+        return;
+      }
+      ++inflight_;
+    }
+    std::function<void()> fn_copy = std::move(fn);
+    pool_->Schedule([this, fn_copy]() {
+      fn_copy();
+      Drain();
+    });
+  }
+
+ private:
+  // Runs queued closures on the current pool thread until both lanes are
+  // empty, then retires the in-flight slot.
+  void Drain() {
+    while (true) {
+      std::function<void()> next;
+      {
+        mutex_lock l(mu_);
+        next = PickLocked();
+        if (!next) {
+          --inflight_;
+          return;
+        }
+      }
+      next();
+    }
+  }
+
+  std::function<void()> PickLocked() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    std::function<void()> fn;
+    const bool take_high =
+        !high_.empty() && (low_.empty() || high_credit_ > 0);
+    if (take_high) {
+      --high_credit_;
+      fn = std::move(high_.front());
+      high_.pop_front();
+    } else if (!low_.empty()) {
+      high_credit_ = weight_;
+      fn = std::move(low_.front());
+      low_.pop_front();
+    }
+    return fn;
+  }
+
+  thread::ThreadPool* const pool_;
+  const int64 weight_;
+  const int max_inflight_;
+
+  mutex mu_;
+  int64 high_credit_ GUARDED_BY(mu_);
+  int inflight_ GUARDED_BY(mu_) = 0;
+  std::deque<std::function<void()>> high_ GUARDED_BY(mu_);
+  std::deque<std::function<void()>> low_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(RecvTensorLaneScheduler);
+};
+
+// Returns a lane scheduler when TF_WORKER_PRIORITY_LANES is set, else
+// nullptr (requests then go straight to the compute pool as before).
+// TF_WORKER_PRIORITY_LANE_WEIGHT controls how many high-lane closures are
+// drained per low-lane closure under load.
+RecvTensorLaneScheduler* CreateLaneSchedulerIfEnabled(
+    thread::ThreadPool* pool) {
+  bool enabled = false;
+  Status s = ReadBoolFromEnvVar("TF_WORKER_PRIORITY_LANES", false, &enabled);
+  if (!s.ok()) {
+    LOG(WARNING) << "Invalid TF_WORKER_PRIORITY_LANES: " << s;
+  }
+  if (!enabled) {
+    return nullptr;
+  }
+  int64 weight = 4;
+  s = ReadInt64FromEnvVar("TF_WORKER_PRIORITY_LANE_WEIGHT", 4, &weight);
+  if (!s.ok()) {
+    LOG(WARNING) << "Invalid TF_WORKER_PRIORITY_LANE_WEIGHT: " << s;
+  }
+  return new RecvTensorLaneScheduler(pool, weight);
+}
+
+// Tensors below this size are sent uncompressed even when the receiver
+// negotiated a compression codec; the per-message compression overhead is
+// not worth it for small payloads.
+int64 RecvTensorCompressMinBytes() {
+  static int64 min_bytes = [] {
+    int64 v = 4096;
+    Status s =
+        ReadInt64FromEnvVar("RECV_TENSOR_COMPRESSION_MIN_BYTES", 4096, &v);
+    if (!s.ok()) {
+      LOG(WARNING) << s.error_message();
+    }
+    return v;
+  }();
+  return min_bytes;
+}
+
 // This macro creates a new request for the given RPC method name
 // (e.g., `ENQUEUE_REQUEST(GetStatus, false);`), and enqueues it on
 // `this->cq_`.
@@ -103,11 +222,13 @@ class GrpcWorkerServiceThread {
   explicit GrpcWorkerServiceThread(
       GrpcWorker* worker, ::grpc::ServerBuilder* builder,
       std::unordered_map<int, int> queue_depth, GrpcResponseCache* cache,
-      grpc::WorkerService::AsyncService* worker_service)
+      grpc::WorkerService::AsyncService* worker_service,
+      RecvTensorLaneScheduler* lane_scheduler)
       : worker_(worker),
         queue_depth_(queue_depth),
         cache_(cache),
         worker_service_(worker_service),
+        lane_scheduler_(lane_scheduler),
         is_shutdown_(false) {
     cq_ = builder->AddCompletionQueue();
   }
@@ -186,6 +307,15 @@ class GrpcWorkerServiceThread {
     worker_->env()->compute_pool->Schedule(std::move(f));
   }
 
+  // Tensor transfers go through the priority lanes when they are enabled.
+  void ScheduleRecvTensor(int32 priority, std::function<void()> f) {
+    if (lane_scheduler_ != nullptr) {
+      lane_scheduler_->Schedule(priority, std::move(f));
+      return;
+    }
+    Schedule(std::move(f));
+  }
+
   // The following section contains one request handler method per
   // RPC. The `FooHandler` method is called (indirectly) by
   // `HandleRPCsLoop()` when the next Foo RPC is received. Each
@@ -277,7 +407,7 @@ class GrpcWorkerServiceThread {
 
   void RecvTensorHandlerRaw(
       WorkerCall<RecvTensorRequest, ::grpc::ByteBuffer>* call) {
-    Schedule([this, call]() {
+    ScheduleRecvTensor(call->request.priority(), [this, call]() {
       CallOptions* call_opts = new CallOptions;
       call->SetCancelCallback([call_opts]() { call_opts->StartCancel(); });
 
@@ -400,6 +530,7 @@ class GrpcWorkerServiceThread {
   std::unordered_map<int, int> queue_depth_;
   GrpcResponseCache* cache_;
   grpc::WorkerService::AsyncService* const worker_service_;
+  RecvTensorLaneScheduler* const lane_scheduler_;  // not owned, may be null
 
   mutex shutdown_mu_;
   bool is_shutdown_ GUARDED_BY(shutdown_mu_);
@@ -412,11 +543,14 @@ class GrpcWorkerService : public AsyncServiceInterface {
                     GrpcWorkerServiceOptions options)
       : is_shutdown_(false) {
     builder->RegisterService(&worker_service_);
+    lane_scheduler_.reset(
+        CreateLaneSchedulerIfEnabled(worker->env()->compute_pool));
 
     for (int i = 0; i < options.num_serving_threads; i++) {
       threads_.emplace_back(
           new GrpcWorkerServiceThread(worker, builder, options.queue_depth,
-                                      cache_.get(), &worker_service_));
+                                      cache_.get(), &worker_service_,
+                                      lane_scheduler_.get()));
     }
   }
 
@@ -449,6 +583,7 @@ class GrpcWorkerService : public AsyncServiceInterface {
 
  private:
   grpc::WorkerService::AsyncService worker_service_;
+  std::unique_ptr<RecvTensorLaneScheduler> lane_scheduler_;
   std::vector<std::unique_ptr<GrpcWorkerServiceThread>> threads_;
 
   std::unique_ptr<GrpcResponseCache> cache_;
@@ -489,11 +624,24 @@ void GrpcWorker::GrpcRecvTensorAsync(CallOptions* opts,
 
   bool cache_enabled = (response_cache_ != nullptr && request_id != 0);
 
-  auto do_response = [response, done, cache_enabled](const Tensor& tensor,
-                                                     bool is_dead,
-                                                     const Status& status) {
+  const string compression_algorithm = request->compression_algorithm();
+  auto do_response = [response, done, cache_enabled, compression_algorithm](
+                         const Tensor& tensor, bool is_dead,
+                         const Status& status) {
     if (status.ok()) {
       grpc::EncodeTensorToByteBuffer(is_dead, tensor, cache_enabled, response);
+      if (!compression_algorithm.empty() && !is_dead &&
+          static_cast<int64>(tensor.TotalBytes()) >=
+              RecvTensorCompressMinBytes()) {
+        Status cs =
+            grpc::CompressTensorByteBuffer(compression_algorithm, response);
+        if (!cs.ok()) {
+          // The raw encoding is still in *response; the receiver accepts
+          // either form, so compression failures only cost bandwidth.
+          LOG(WARNING) << "RecvTensor compression failed: "
+                       << cs.error_message();
+        }
+      }
     }
     done(status);
   };
@@ -772,6 +920,16 @@ void SetTensorInRecvBufResp(int64 max_chunk_bytes, const Tensor* tensor,
   }
   response->mutable_transport_options()->PackFrom(extra);
 }
+
+// Returns true if the client that sent `request` advertised the same host
+// identity as this process, i.e. it can map shared memory we create.
+bool PeerIsSameHost(const RecvBufRequest& request) {
+  if (!shm_transport::Enabled()) return false;
+  if (!request.transport_options().Is<RecvBufShmHint>()) return false;
+  RecvBufShmHint hint;
+  request.transport_options().UnpackTo(&hint);
+  return hint.host_id() == shm_transport::HostId();
+}
 }  // namespace
 
 void GrpcWorker::RecvBufAsync(CallOptions* opts, const RecvBufRequest* request,
@@ -779,12 +937,35 @@ void GrpcWorker::RecvBufAsync(CallOptions* opts, const RecvBufRequest* request,
   const int64 request_id = request->request_id();
   const int64 step_id = request->step_id();
   bool cache_enabled = (response_cache_ != nullptr && request_id != 0);
+  const bool peer_same_host = PeerIsSameHost(*request);
 
-  auto do_response = [this, response, done, cache_enabled](
+  auto do_response = [this, response, done, cache_enabled, peer_same_host](
                          const Tensor& tensor, bool is_dead,
                          const Status& status) {
     if (status.ok()) {
-      SetTensorInRecvBufResp(recv_buf_max_chunk_, &tensor, response);
+      // For same-host peers pass a shared memory descriptor instead of the
+      // tensor bytes; fall back to the inline path if the segment cannot
+      // be created.
+      bool sent_via_shm = false;
+      const int64 num_bytes = tensor.TotalBytes();
+      if (peer_same_host && num_bytes >= shm_transport::MinBytes()) {
+        string segment_name;
+        Status shm_status = shm_transport::WriteSegment(
+            DMAHelper::base(&tensor), num_bytes, &segment_name);
+        if (shm_status.ok()) {
+          RecvBufShmExtra extra;
+          extra.set_segment_name(segment_name);
+          extra.set_byte_size(num_bytes);
+          response->mutable_transport_options()->PackFrom(extra);
+          sent_via_shm = true;
+        } else {
+          LOG(WARNING) << "Falling back to inline RecvBuf response: "
+                       << shm_status;
+        }
+      }
+      if (!sent_via_shm) {
+        SetTensorInRecvBufResp(recv_buf_max_chunk_, &tensor, response);
+      }
     }
     response->set_send_start_micros(env_->env->NowMicros());
     response->set_require_ack(cache_enabled);
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/rpc/rpc_rendezvous_mgr.h"
 
+#include <unordered_map>
 #include <unordered_set>
 
 #include "tensorflow/core/common_runtime/device.h"
@@ -30,14 +31,77 @@ limitations under the License.
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/strings/numbers.h"
 #include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 
 namespace {
 
+// Deadline-aware coalescing of RecvTensor calls. When RECV_TENSOR_BATCHING
+// is set, host recvs from the same remote worker that arrive within
+// RECV_TENSOR_BATCH_WINDOW_US microseconds are sent as one FuseRecvTensor
+// RPC instead of one gRPC call each, which amortizes the per-call overhead
+// that dominates transfers of small tensors.
+bool RecvTensorBatchingEnabled() {
+  static bool enabled = [] {
+    bool b = false;
+    Status s = ReadBoolFromEnvVar("RECV_TENSOR_BATCHING", false, &b);
+    if (!s.ok()) {
+      LOG(WARNING) << s.error_message();
+    }
+    return b;
+  }();
+  return enabled;
+}
+
+int64 RecvTensorBatchWindowUsec() {
+  static int64 window = [] {
+    int64 v = 50;
+    Status s = ReadInt64FromEnvVar("RECV_TENSOR_BATCH_WINDOW_US", 50, &v);
+    if (!s.ok()) {
+      LOG(WARNING) << s.error_message();
+    }
+    return v;
+  }();
+  return window;
+}
+
+int64 RecvTensorBatchMaxCount() {
+  static int64 max_count = [] {
+    int64 v = 32;
+    Status s = ReadInt64FromEnvVar("RECV_TENSOR_BATCH_MAX_COUNT", 32, &v);
+    if (!s.ok()) {
+      LOG(WARNING) << s.error_message();
+    }
+    return v;
+  }();
+  return max_count;
+}
+
+// Compression codec ("lz4" or "zstd") this worker advertises on its
+// RecvTensor requests. The sender still skips compression for tensors
+// below its size threshold, so small transfers stay untouched.
+const string& RecvTensorCompressionAlgorithm() {
+  static const string* algorithm = [] {
+    string v;
+    Status s = ReadStringFromEnvVar("RECV_TENSOR_COMPRESSION", "", &v);
+    if (!s.ok()) {
+      LOG(WARNING) << s.error_message();
+    }
+    if (!v.empty() && v != "lz4" && v != "zstd") {
+      LOG(WARNING) << "Unknown RECV_TENSOR_COMPRESSION codec \"" << v
+                   << "\", tensor responses will not be compressed.";
+      v.clear();
+    }
+    return new string(v);
+  }();
+  return *algorithm;
+}
+
 class RpcRemoteRendezvous : public BaseRemoteRendezvous {
  public:
   RpcRemoteRendezvous(const WorkerEnv* env, int64 step_id)
@@ -56,6 +120,35 @@ class RpcRemoteRendezvous : public BaseRemoteRendezvous {
  private:
   ~RpcRemoteRendezvous() override {}
 
+  // A RecvTensor call queued during the coalescing window.
+  struct PendingRecv {
+    Rendezvous::ParsedKey parsed;
+    Rendezvous::Args recv_args;
+    DoneCallback done;
+  };
+
+  // Issues a single RecvTensor RPC for `parsed`; the non-batched path.
+  void IssueRecvFromRemote(const Rendezvous::ParsedKey& parsed,
+                           const Rendezvous::Args& recv_args,
+                           DoneCallback done);
+
+  // True iff `parsed` may be coalesced with other pending recvs.
+  bool ShouldBatchRecv(const Rendezvous::ParsedKey& parsed,
+                       const Rendezvous::Args& recv_args);
+
+  void EnqueueBatchedRecv(const Rendezvous::ParsedKey& parsed,
+                          const Rendezvous::Args& recv_args,
+                          DoneCallback done);
+
+  // Drains the pending recvs accumulated under `batch_key` into one
+  // FuseRecvTensor RPC and scatters the fused response to the per-call
+  // done callbacks.
+  void FlushBatchedRecvs(const string& batch_key);
+
+  mutex batch_mu_;
+  std::unordered_map<string, std::vector<PendingRecv>> pending_recvs_
+      GUARDED_BY(batch_mu_);
+
   TF_DISALLOW_COPY_AND_ASSIGN(RpcRemoteRendezvous);
 };
 
@@ -75,6 +168,10 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
     req_.set_step_id(step_id);
     req_.set_rendezvous_key(key.data(), key.size());
     req_.set_request_id(GetUniqueRequestId());
+    const string& compression = RecvTensorCompressionAlgorithm();
+    if (!compression.empty()) {
+      req_.set_compression_algorithm(compression);
+    }
   }
 
   void Reset() {
@@ -222,6 +319,109 @@ static RpcRecvTensorFreeList* get_call_freelist() {
 void RpcRemoteRendezvous::RecvFromRemoteAsync(
     const Rendezvous::ParsedKey& parsed, const Rendezvous::Args& recv_args,
     DoneCallback done) {
+  if (ShouldBatchRecv(parsed, recv_args)) {
+    EnqueueBatchedRecv(parsed, recv_args, std::move(done));
+    return;
+  }
+  IssueRecvFromRemote(parsed, recv_args, std::move(done));
+}
+
+bool RpcRemoteRendezvous::ShouldBatchRecv(const Rendezvous::ParsedKey& parsed,
+                                          const Rendezvous::Args& recv_args) {
+  if (!RecvTensorBatchingEnabled()) {
+    return false;
+  }
+  // Only host recvs are coalesced: the fused response is parsed with the
+  // allocator of the first call in the batch, which is only safe when every
+  // member lands in host memory without a device context.
+  if (recv_args.device_context != nullptr) {
+    return false;
+  }
+  if (!parsed.dst.has_type || parsed.dst.type != "CPU") {
+    return false;
+  }
+  return true;
+}
+
+void RpcRemoteRendezvous::EnqueueBatchedRecv(
+    const Rendezvous::ParsedKey& parsed, const Rendezvous::Args& recv_args,
+    DoneCallback done) {
+  // Calls are only fused when they share the source worker, the destination
+  // device and the allocator attributes the response is parsed with.
+  string batch_key = strings::StrCat(parsed.src_device, ";", parsed.dst_device,
+                                     ";", recv_args.alloc_attrs.value);
+  bool first_in_window = false;
+  int64 batch_size = 0;
+  {
+    mutex_lock l(batch_mu_);
+    std::vector<PendingRecv>& pending = pending_recvs_[batch_key];
+    pending.push_back(PendingRecv{parsed, recv_args, std::move(done)});
+    first_in_window = (pending.size() == 1);
+    batch_size = pending.size();
+  }
+  if (batch_size >= RecvTensorBatchMaxCount()) {
+    FlushBatchedRecvs(batch_key);
+    return;
+  }
+  if (first_in_window) {
+    // The deadline for this window. The ref keeps the rendezvous alive
+    // until the flush ran; a flush triggered by the max-count path above
+    // leaves this closure to drain whatever queued up after it.
+    Ref();
+    env_->env->SchedClosureAfter(RecvTensorBatchWindowUsec(),
+                                 [this, batch_key]() {
+                                   FlushBatchedRecvs(batch_key);
+                                   Unref();
+                                 });
+  }
+}
+
+void RpcRemoteRendezvous::FlushBatchedRecvs(const string& batch_key) {
+  std::vector<PendingRecv> batch;
+  {
+    mutex_lock l(batch_mu_);
+    auto it = pending_recvs_.find(batch_key);
+    if (it == pending_recvs_.end()) {
+      return;
+    }
+    batch.swap(it->second);
+    pending_recvs_.erase(it);
+  }
+  if (batch.empty()) {
+    return;
+  }
+  if (batch.size() == 1) {
+    IssueRecvFromRemote(batch[0].parsed, batch[0].recv_args,
+                        std::move(batch[0].done));
+    return;
+  }
+
+  std::vector<Rendezvous::ParsedKey> parsed_keys;
+  parsed_keys.reserve(batch.size());
+  for (const PendingRecv& pending : batch) {
+    parsed_keys.push_back(pending.parsed);
+  }
+  auto dones = std::make_shared<std::vector<DoneCallback>>();
+  dones->reserve(batch.size());
+  for (PendingRecv& pending : batch) {
+    dones->push_back(std::move(pending.done));
+  }
+  FuseRecvFromRemoteAsync(
+      parsed_keys, batch[0].recv_args,
+      [dones](const Status& s, const std::vector<Args>& send_args,
+              const Args& recv_args, const std::vector<Tensor>& tensors,
+              const std::vector<bool>& is_deads) {
+        for (size_t i = 0; i < dones->size(); ++i) {
+          (*dones)[i](s, i < send_args.size() ? send_args[i] : Args(),
+                      recv_args, i < tensors.size() ? tensors[i] : Tensor(),
+                      i < is_deads.size() ? is_deads[i] : false);
+        }
+      });
+}
+
+void RpcRemoteRendezvous::IssueRecvFromRemote(
+    const Rendezvous::ParsedKey& parsed, const Rendezvous::Args& recv_args,
+    DoneCallback done) {
   CHECK(is_initialized());
   Status s;
 
@@ -0,0 +1,121 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/distributed_runtime/shm_transport.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/random/random.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/host_info.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+namespace shm_transport {
+
+bool Enabled() {
+  static const bool enabled = []() {
+    bool value;
+    TF_CHECK_OK(
+        ReadBoolFromEnvVar("TF_COLLECTIVE_SHM_TRANSPORT", false, &value));
+    return value;
+  }();
+  return enabled;
+}
+
+int64 MinBytes() {
+  static const int64 min_bytes = []() {
+    int64 value;
+    TF_CHECK_OK(
+        ReadInt64FromEnvVar("TF_COLLECTIVE_SHM_MIN_BYTES", 4096, &value));
+    return value;
+  }();
+  return min_bytes;
+}
+
+const string& HostId() {
+  // The hostname is a sufficient identity as long as workers that share a
+  // hostname also share a /dev/shm namespace, which holds for processes on
+  // one machine and for containers that mount the host's /dev/shm. A
+  // mismatch surfaces as a ReadSegment failure, not silent corruption.
+  static const string* host_id = new string(port::Hostname());
+  return *host_id;
+}
+
+Status WriteSegment(const void* src, size_t num_bytes, string* segment_name) {
+  string name =
+      strings::StrCat("/tf_recvbuf_", getpid(), "_", random::New64());
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) {
+    return errors::Internal("shm_open(", name,
+                            ") failed: ", strerror(errno));
+  }
+  if (ftruncate(fd, num_bytes) != 0) {
+    int err = errno;
+    close(fd);
+    shm_unlink(name.c_str());
+    return errors::Internal("ftruncate(", name, ", ", num_bytes,
+                            ") failed: ", strerror(err));
+  }
+  void* addr = mmap(nullptr, num_bytes, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    fd, 0);
+  int err = errno;
+  close(fd);
+  if (addr == MAP_FAILED) {
+    shm_unlink(name.c_str());
+    return errors::Internal("mmap(", name, ") failed: ", strerror(err));
+  }
+  memcpy(addr, src, num_bytes);
+  munmap(addr, num_bytes);
+  *segment_name = name;
+  return Status::OK();
+}
+
+Status ReadSegment(const string& segment_name, size_t num_bytes, void* dst) {
+  int fd = shm_open(segment_name.c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    return errors::Internal("shm_open(", segment_name,
+                            ") failed: ", strerror(errno));
+  }
+  // Unlink immediately so the kernel reclaims the segment once it is
+  // unmapped, even if this process dies mid-copy.
+  shm_unlink(segment_name.c_str());
+  struct stat st;
+  if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < num_bytes) {
+    close(fd);
+    return errors::Internal("Shared memory segment ", segment_name,
+                            " is smaller than the expected ", num_bytes,
+                            " bytes");
+  }
+  void* addr = mmap(nullptr, num_bytes, PROT_READ, MAP_SHARED, fd, 0);
+  int err = errno;
+  close(fd);
+  if (addr == MAP_FAILED) {
+    return errors::Internal("mmap(", segment_name,
+                            ") failed: ", strerror(err));
+  }
+  memcpy(dst, addr, num_bytes);
+  munmap(addr, num_bytes);
+  return Status::OK();
+}
+
+}  // namespace shm_transport
+}  // namespace tensorflow
@@ -0,0 +1,63 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_SHM_TRANSPORT_H_
+#define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_SHM_TRANSPORT_H_
+
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// Shared-memory transport for RecvBuf transfers between workers that are
+// co-located on one host. When enabled, a client advertises its host
+// identity in RecvBufRequest.transport_options; a server that recognizes
+// the identity as its own writes the tensor bytes into a POSIX shared
+// memory segment and returns the segment name instead of the bytes, so
+// only a descriptor crosses the gRPC stack. Servers on other hosts ignore
+// the hint and the regular tensor_content path is used.
+//
+// Segments are created per transfer and unlinked by the reader, so the
+// kernel reclaims the memory as soon as both sides have unmapped it. If a
+// response is lost before the client reads it, the segment persists in
+// /dev/shm until it is cleaned up externally; the transport is therefore
+// opt-in.
+namespace shm_transport {
+
+// True if the transport is enabled via TF_COLLECTIVE_SHM_TRANSPORT=true
+// (default false). All workers on a host must agree on this setting and
+// share a /dev/shm namespace.
+bool Enabled();
+
+// Transfers smaller than this many bytes stay on the inline gRPC path,
+// where the descriptor round trip is not worth it. Controlled by
+// TF_COLLECTIVE_SHM_MIN_BYTES (default 4096).
+int64 MinBytes();
+
+// Token identifying the local host, exchanged to detect same-host peers.
+const string& HostId();
+
+// Copies `num_bytes` starting at `src` into a freshly created shared
+// memory segment and returns its name in `*segment_name`. The writer
+// keeps no reference to the segment; ownership passes to the reader.
+Status WriteSegment(const void* src, size_t num_bytes, string* segment_name);
+
+// Copies `num_bytes` out of the named segment into `dst` and unlinks the
+// segment. Fails if the segment does not exist or is too small.
+Status ReadSegment(const string& segment_name, size_t num_bytes, void* dst);
+
+}  // namespace shm_transport
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_SHM_TRANSPORT_H_
@@ -0,0 +1,67 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/shm_transport.h"
+
+#include <vector>
+
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+
+TEST(ShmTransport, RoundTrip) {
+  std::vector<char> src(1 << 20);
+  for (size_t i = 0; i < src.size(); ++i) {
+    src[i] = static_cast<char>(i * 31);
+  }
+  string segment_name;
+  TF_ASSERT_OK(
+      shm_transport::WriteSegment(src.data(), src.size(), &segment_name));
+  std::vector<char> dst(src.size());
+  TF_ASSERT_OK(
+      shm_transport::ReadSegment(segment_name, dst.size(), dst.data()));
+  EXPECT_EQ(src, dst);
+}
+
+TEST(ShmTransport, ReadUnlinksSegment) {
+  std::vector<char> buf(4096, 'x');
+  string segment_name;
+  TF_ASSERT_OK(
+      shm_transport::WriteSegment(buf.data(), buf.size(), &segment_name));
+  TF_ASSERT_OK(
+      shm_transport::ReadSegment(segment_name, buf.size(), buf.data()));
+  // A second read must fail: the first reader unlinked the segment.
+  EXPECT_FALSE(
+      shm_transport::ReadSegment(segment_name, buf.size(), buf.data()).ok());
+}
+
+TEST(ShmTransport, ReadMissingSegmentFails) {
+  char byte;
+  EXPECT_FALSE(
+      shm_transport::ReadSegment("/tf_recvbuf_does_not_exist", 1, &byte).ok());
+}
+
+TEST(ShmTransport, ReadTooLargeFails) {
+  std::vector<char> buf(128, 'y');
+  string segment_name;
+  TF_ASSERT_OK(
+      shm_transport::WriteSegment(buf.data(), buf.size(), &segment_name));
+  std::vector<char> dst(256);
+  EXPECT_FALSE(
+      shm_transport::ReadSegment(segment_name, dst.size(), dst.data()).ok());
+}
+
+}  // namespace tensorflow
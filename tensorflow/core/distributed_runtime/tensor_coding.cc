@@ -15,11 +15,18 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/tensor_coding.h"
 
+#include <lz4.h>
+#include <zstd.h>
+
+#include <memory>
+
 #include "google/protobuf/any.pb.h"
 
 #include "tensorflow/core/common_runtime/device.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
+#include "tensorflow/core/lib/core/coding.h"
+#include "tensorflow/core/lib/core/errors.h"
 
 namespace tensorflow {
 
@@ -79,7 +86,99 @@ void TensorResponse::InitPartial(const RecvTensorResponse& response,
   tensor_ = std::move(t);
 }
 
+namespace {
+
+// Source over the decompressed bytes; each contents() call restarts from
+// the beginning, matching the sources the RPC layers provide.
+class FlatBufferSource : public TensorResponse::Source {
+ public:
+  FlatBufferSource(const char* data, size_t len) : data_(data), len_(len) {}
+
+  protobuf::io::ZeroCopyInputStream* contents() override {
+    stream_.reset(
+        new protobuf::io::ArrayInputStream(data_, static_cast<int>(len_)));
+    return stream_.get();
+  }
+
+ private:
+  const char* const data_;
+  const size_t len_;
+  std::unique_ptr<protobuf::io::ArrayInputStream> stream_;
+};
+
+// Checks whether source holds a compressed RecvTensor frame (see
+// tensor_coding.h for the layout) and inflates it into *out if so.
+Status MaybeDecompressFrame(TensorResponse::Source* source, string* out,
+                            bool* was_compressed) {
+  *was_compressed = false;
+  protobuf::io::ZeroCopyInputStream* stream = source->contents();
+  const void* data = nullptr;
+  int size = 0;
+  do {
+    if (!stream->Next(&data, &size)) {
+      return Status::OK();  // Empty response; leave it to the parser.
+    }
+  } while (size == 0);
+  if (static_cast<const uint8*>(data)[0] != kTensorCompressionMagic) {
+    return Status::OK();
+  }
+
+  string raw;
+  raw.append(static_cast<const char*>(data), size);
+  while (stream->Next(&data, &size)) {
+    raw.append(static_cast<const char*>(data), size);
+  }
+  if (raw.size() < kTensorCompressionHeaderSize) {
+    return errors::InvalidArgument("Truncated compressed tensor response");
+  }
+  const uint8 codec = static_cast<uint8>(raw[1]);
+  const uint64 uncompressed_size = core::DecodeFixed64(raw.data() + 2);
+  const char* payload = raw.data() + kTensorCompressionHeaderSize;
+  const size_t payload_size = raw.size() - kTensorCompressionHeaderSize;
+  if (uncompressed_size == 0) {
+    out->clear();
+    *was_compressed = true;
+    return Status::OK();
+  }
+  out->resize(uncompressed_size);
+  if (codec == kTensorCompressionLz4) {
+    const int n = LZ4_decompress_safe(payload, &(*out)[0],
+                                      static_cast<int>(payload_size),
+                                      static_cast<int>(uncompressed_size));
+    if (n < 0 || static_cast<uint64>(n) != uncompressed_size) {
+      return errors::InvalidArgument("Corrupt LZ4 tensor response");
+    }
+  } else if (codec == kTensorCompressionZstd) {
+    const size_t n =
+        ZSTD_decompress(&(*out)[0], uncompressed_size, payload, payload_size);
+    if (ZSTD_isError(n) || n != uncompressed_size) {
+      return errors::InvalidArgument("Corrupt ZSTD tensor response");
+    }
+  } else {
+    return errors::InvalidArgument("Unknown tensor compression codec: ",
+                                   static_cast<int>(codec));
+  }
+  *was_compressed = true;
+  return Status::OK();
+}
+
+}  // namespace
+
 Status TensorResponse::ParseFrom(Source* source) {
+  // A sender that honored RecvTensorRequest.compression_algorithm wrapped
+  // the serialized response in a compressed frame; inflate it first.
+  string decompressed;
+  bool was_compressed = false;
+  Status ds = MaybeDecompressFrame(source, &decompressed, &was_compressed);
+  if (!ds.ok()) return ds;
+  if (was_compressed) {
+    FlatBufferSource flat(decompressed.data(), decompressed.size());
+    return ParseFromUncompressed(&flat);
+  }
+  return ParseFromUncompressed(source);
+}
+
+Status TensorResponse::ParseFromUncompressed(Source* source) {
   if (!on_host_) {
     protobuf::io::CodedInputStream input(source->contents());
     input.SetTotalBytesLimit(INT_MAX, INT_MAX);  // Unlimited
@@ -31,6 +31,23 @@ class Allocator;
 class DeviceBase;
 class TensorProto;
 
+// Wire framing for compressed RecvTensor responses. When a receiver
+// advertises a codec in RecvTensorRequest.compression_algorithm, the sender
+// may replace the serialized RecvTensorResponse with:
+//
+//   | kTensorCompressionMagic : 1B | codec : 1B |
+//   | uncompressed size (fixed64 LE) : 8B | compressed payload |
+//
+// The magic byte is not a valid protocol buffer tag, so an uncompressed
+// response can never be mistaken for a frame and senders are free to skip
+// compression (e.g. for small or incompressible tensors).
+enum TensorCompressionCodec : uint8 {
+  kTensorCompressionLz4 = 1,
+  kTensorCompressionZstd = 2,
+};
+constexpr uint8 kTensorCompressionMagic = 0xFF;
+constexpr size_t kTensorCompressionHeaderSize = 10;
+
 // TensorResponse can be used as the destination of an RPC that returns
 // a RecvTensorResponse.  It efficiently decodes the incoming data
 // into Tensor contents as well as associated metadata.
@@ -94,6 +111,9 @@ class TensorResponse {
   DeviceBase* device() const { return device_; }
 
  private:
+  // Parses a raw serialized RecvTensorResponse; ParseFrom inflates
+  // compressed frames before delegating here.
+  Status ParseFromUncompressed(Source* source);
   bool ParseTensorSubmessage(protobuf::io::CodedInputStream* input,
                              TensorProto* tensor_meta);
   bool ParseFast(Source* source);
@@ -0,0 +1,254 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_FRAMEWORK_ALLOC_AUDIT_H_
+#define TENSORFLOW_CORE_FRAMEWORK_ALLOC_AUDIT_H_
+
+#include <execinfo.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// Audit mode for hunting down per-step heap allocations in serving.
+// With TF_ALLOC_AUDIT=1 the CPU allocator reports every AllocateRaw to
+// RecordAlloc, which attributes it to the op the calling thread is
+// executing (via the ScopedOp annotation the executor installs around
+// kernel dispatch; anything outside an op scope — session plumbing,
+// the request path — lands under "<outside-op>") and to a hash of the
+// caller stack. Recording only arms after
+// TF_ALLOC_AUDIT_WARMUP_STEPS executor runs (default 100), so one-off
+// warmup allocations (kernel construction, caches filling, pools
+// growing to their high-water mark) do not drown the steady-state
+// offenders that actually recur every step.
+//
+// A report thread logs the most active sites every
+// TF_ALLOC_AUDIT_REPORT_INTERVAL_SEC seconds (default 60), with the
+// symbolized stack the first time each site appears. An empty report
+// is the goal state: it means no step allocated after warmup.
+//
+// The mode costs one backtrace and one short critical section per
+// allocation and is for diagnosis runs, not production serving.
+class AllocAudit {
+ public:
+  static const int kMaxFrames = 16;
+  static const int kReportTopN = 20;
+
+  static bool Enabled() {
+    static const bool enabled = [] {
+      const char* env = std::getenv("TF_ALLOC_AUDIT");
+      return env != nullptr && env[0] == '1';
+    }();
+    return enabled;
+  }
+
+  // Called once per executor run; arms recording once the warmup run
+  // count has passed.
+  static void RecordRun() {
+    if (!Enabled()) {
+      return;
+    }
+    State* s = GetState();
+    if (!s->active.load(std::memory_order_relaxed) &&
+        s->runs.fetch_add(1, std::memory_order_relaxed) + 1 >=
+            s->warmup_runs) {
+      s->active.store(true, std::memory_order_relaxed);
+      LOG(INFO) << "AllocAudit armed after " << s->warmup_runs
+                << " executor runs; steady-state allocations are now "
+                << "recorded per op.";
+    }
+  }
+
+  // Called from the CPU allocator. Re-entrant calls (the audit's own
+  // bookkeeping, LOG during a report) are dropped via a thread-local
+  // flag.
+  static void RecordAlloc(size_t num_bytes) {
+    State* s = GetState();
+    if (!s->active.load(std::memory_order_relaxed)) {
+      return;
+    }
+    if (InRecord()) {
+      return;
+    }
+    InRecord() = true;
+    void* frames[kMaxFrames];
+    int depth = backtrace(frames, kMaxFrames);
+    uint64 stack_hash = 0;
+    for (int i = 0; i < depth; ++i) {
+      stack_hash =
+          Hash64Combine(stack_hash, reinterpret_cast<uint64>(frames[i]));
+    }
+    const char* op = CurrentOp();
+    if (op == nullptr) {
+      op = "<outside-op>";
+    }
+    uint64 key = Hash64Combine(stack_hash, Hash64(op, strlen(op)));
+    {
+      mutex_lock l(s->mu);
+      Site& site = s->sites[key];
+      if (site.count == 0) {
+        site.op = op;
+        site.stack_hash = stack_hash;
+        site.depth = depth;
+        memcpy(site.frames, frames, depth * sizeof(void*));
+      }
+      ++site.count;
+      site.bytes += num_bytes;
+    }
+    InRecord() = false;
+  }
+
+  // RAII op annotation installed by the executor around kernel
+  // dispatch. Nests: the previous annotation is restored on
+  // destruction, so function-calling kernels stay attributed to the
+  // innermost op. The name pointer must outlive the scope (kernel
+  // names do).
+  class ScopedOp {
+   public:
+    explicit ScopedOp(const char* op_name) : prev_(nullptr) {
+      if (Enabled()) {
+        prev_ = CurrentOp();
+        CurrentOp() = op_name;
+      }
+    }
+    ~ScopedOp() {
+      if (Enabled()) {
+        CurrentOp() = prev_;
+      }
+    }
+
+   private:
+    const char* prev_;
+  };
+
+ private:
+  struct Site {
+    string op;
+    uint64 stack_hash = 0;
+    int64 count = 0;
+    int64 bytes = 0;
+    int64 reported_count = 0;
+    bool symbolized = false;
+    int depth = 0;
+    void* frames[kMaxFrames];
+  };
+
+  struct State {
+    mutex mu;
+    std::unordered_map<uint64, Site> sites GUARDED_BY(mu);
+    std::atomic<int64> runs{0};
+    std::atomic<bool> active{false};
+    int64 warmup_runs;
+    int64 interval_sec;
+    std::unique_ptr<Thread> report_thread;
+
+    State() {
+      const char* warmup = std::getenv("TF_ALLOC_AUDIT_WARMUP_STEPS");
+      warmup_runs = (warmup == nullptr) ? 100 : atoll(warmup);
+      const char* interval =
+          std::getenv("TF_ALLOC_AUDIT_REPORT_INTERVAL_SEC");
+      interval_sec = (interval == nullptr) ? 60 : atoll(interval);
+      report_thread.reset(Env::Default()->StartThread(
+          ThreadOptions(), "alloc_audit_report", [this]() { ReportLoop(); }));
+    }
+
+    void ReportLoop() {
+      while (true) {
+        Env::Default()->SleepForMicroseconds(interval_sec * 1000 * 1000);
+        if (!active.load(std::memory_order_relaxed)) {
+          continue;
+        }
+        Report();
+      }
+    }
+
+    // Logs the sites with the most new allocations since the last
+    // report. LOG itself allocates, so the re-entrancy flag is held
+    // across the whole pass to keep RecordAlloc from deadlocking on
+    // mu.
+    void Report() {
+      InRecord() = true;
+      mutex_lock l(mu);
+      std::vector<Site*> order;
+      for (auto& it : sites) {
+        if (it.second.count > it.second.reported_count) {
+          order.push_back(&it.second);
+        }
+      }
+      std::sort(order.begin(), order.end(), [](Site* a, Site* b) {
+        return a->count - a->reported_count > b->count - b->reported_count;
+      });
+      if (order.size() > kReportTopN) {
+        order.resize(kReportTopN);
+      }
+      if (order.empty()) {
+        LOG(INFO) << "AllocAudit: no post-warmup allocations since the "
+                  << "last report.";
+      }
+      for (Site* site : order) {
+        LOG(INFO) << "AllocAudit op:" << site->op << ", site:" << std::hex
+                  << site->stack_hash << std::dec
+                  << ", new allocs:" << site->count - site->reported_count
+                  << ", total allocs:" << site->count
+                  << ", total bytes:" << site->bytes;
+        if (!site->symbolized) {
+          // Skip the two innermost frames (RecordAlloc, AllocateRaw).
+          char** symbols = backtrace_symbols(site->frames, site->depth);
+          if (symbols != nullptr) {
+            for (int i = 2; i < site->depth; ++i) {
+              LOG(INFO) << "AllocAudit site:" << std::hex << site->stack_hash
+                        << std::dec << " #" << i - 2 << " " << symbols[i];
+            }
+            free(symbols);
+          }
+          site->symbolized = true;
+        }
+        site->reported_count = site->count;
+      }
+      InRecord() = false;
+    }
+  };
+
+  static State* GetState() {
+    static State* state = new State();
+    return state;
+  }
+
+  static const char*& CurrentOp() {
+    static thread_local const char* op = nullptr;
+    return op;
+  }
+
+  static bool& InRecord() {
+    static thread_local bool in_record = false;
+    return in_record;
+  }
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_FRAMEWORK_ALLOC_AUDIT_H_
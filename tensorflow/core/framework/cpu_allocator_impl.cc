@@ -15,6 +15,7 @@ limitations under the License.
 
 #include <atomic>
 
+#include "tensorflow/core/framework/alloc_audit.h"
 #include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/allocator_registry.h"
 #include "tensorflow/core/framework/tracking_allocator.h"
@@ -84,6 +85,9 @@ class CPUAllocator : public Allocator {
     }
 
     void* p = port::AlignedMalloc(num_bytes, alignment);
+    if (AllocAudit::Enabled()) {
+      AllocAudit::RecordAlloc(num_bytes);
+    }
     if (cpu_allocator_collect_stats) {
       const std::size_t alloc_size = port::MallocExtension_GetAllocatedSize(p);
       mutex_lock l(mu_);
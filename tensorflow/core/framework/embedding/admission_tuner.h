@@ -0,0 +1,170 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_ADMISSION_TUNER_H_
+#define TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_ADMISSION_TUNER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/lib/strings/numbers.h"
+#include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace embedding {
+
+// Adapts a counter filter's admission threshold to an admitted-keys
+// memory budget, so a novelty spike grows the threshold instead of the
+// table and nobody hand-tunes filter_freq per feature.
+//
+// The tuner keeps a streaming histogram of observed key frequencies in
+// log2 buckets. A key of frequency f is observed ~f times, so dividing
+// a bucket's observation count by its representative frequency
+// estimates the number of distinct keys in it. Every kRetuneInterval
+// observations the tuner picks the smallest bucket boundary T for which
+// the estimated keys with freq >= T fit the byte budget, and halves the
+// histogram so the estimate tracks drift. The fast path is one relaxed
+// histogram increment plus one relaxed threshold load.
+class AdmissionThresholdTuner {
+ public:
+  AdmissionThresholdTuner(int64 budget_bytes, int64 initial_threshold)
+      : budget_bytes_(budget_bytes),
+        threshold_(std::max<int64>(initial_threshold, 1)) {
+    for (int b = 0; b < kNumBuckets; ++b) {
+      histogram_[b].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  // Current admission threshold; replaces the static filter_freq.
+  int64 Threshold() const {
+    return threshold_.load(std::memory_order_relaxed);
+  }
+
+  // Records one key observation at its current frequency. row_bytes is
+  // the resident cost of one admitted key; it is not known when the
+  // filter is constructed, so callers pass it along.
+  void RecordObservation(int64 freq, int64 row_bytes) {
+    histogram_[Log2Bucket(freq)].fetch_add(1, std::memory_order_relaxed);
+    row_bytes_.store(row_bytes, std::memory_order_relaxed);
+    if ((observations_.fetch_add(1, std::memory_order_relaxed) + 1) %
+            kRetuneInterval == 0) {
+      Retune();
+    }
+  }
+
+  std::string DebugString(const std::string& table) {
+    return strings::StrCat(
+        "AdmissionTuner(", table, "): threshold=", Threshold(),
+        " budget_bytes=", budget_bytes_,
+        " observations=", observations_.load(std::memory_order_relaxed));
+  }
+
+ private:
+  static constexpr int kNumBuckets = 32;
+  static constexpr int64 kRetuneInterval = 1 << 16;
+
+  static int Log2Bucket(int64 freq) {
+    if (freq <= 0) return 0;
+    int bucket = 0;
+    while (freq > 1 && bucket < kNumBuckets - 1) {
+      freq >>= 1;
+      ++bucket;
+    }
+    return bucket;
+  }
+
+  void Retune() {
+    mutex_lock l(mu_);
+    const int64 row_bytes =
+        std::max<int64>(row_bytes_.load(std::memory_order_relaxed), 1);
+    const int64 key_budget = budget_bytes_ / row_bytes;
+    // Distinct-key estimates per bucket, highest frequency first; the
+    // representative frequency of bucket b is 2^b.
+    int64 keys_above = 0;
+    int64 new_threshold = 1;
+    for (int b = kNumBuckets - 1; b >= 0; --b) {
+      const int64 observations =
+          histogram_[b].load(std::memory_order_relaxed);
+      const int64 bucket_keys = observations >> b;  // obs / 2^b
+      if (keys_above + bucket_keys > key_budget) {
+        // Admitting this bucket would blow the budget: the threshold is
+        // its upper boundary.
+        new_threshold = int64{1} << std::min(b + 1, kNumBuckets - 1);
+        break;
+      }
+      keys_above += bucket_keys;
+    }
+    threshold_.store(new_threshold, std::memory_order_relaxed);
+    // Exponential decay so a past spike does not pin the threshold
+    // forever.
+    for (int b = 0; b < kNumBuckets; ++b) {
+      histogram_[b].store(histogram_[b].load(std::memory_order_relaxed) / 2,
+                          std::memory_order_relaxed);
+    }
+  }
+
+  const int64 budget_bytes_;
+  std::atomic<int64> threshold_;
+  std::atomic<int64> row_bytes_{0};
+  std::atomic<int64> observations_{0};
+  std::atomic<int64> histogram_[kNumBuckets];
+  mutex mu_;  // serializes Retune
+};
+
+// Returns the admitted-keys byte budget configured for `table`, or 0
+// when the adaptive mode is off for it. TF_EV_ADMISSION_BUDGET is a
+// comma separated list of <name_substr>=<bytes> entries matched by
+// substring (first match wins), so one rule covers the per-part shards
+// of a partitioned table.
+inline int64 AdmissionBudgetBytesFromEnv(const std::string& table) {
+  static const std::vector<std::pair<std::string, int64>>* rules = [] {
+    auto* parsed = new std::vector<std::pair<std::string, int64>>;
+    const char* budgets = std::getenv("TF_EV_ADMISSION_BUDGET");
+    if (budgets != nullptr) {
+      for (const string& entry : str_util::Split(budgets, ',')) {
+        std::vector<string> name_and_bytes = str_util::Split(entry, '=');
+        int64 bytes = 0;
+        if (name_and_bytes.size() != 2 || name_and_bytes[0].empty() ||
+            !strings::safe_strto64(name_and_bytes[1].c_str(), &bytes) ||
+            bytes <= 0) {
+          LOG(WARNING) << "Ignoring malformed TF_EV_ADMISSION_BUDGET entry: "
+                       << entry;
+          continue;
+        }
+        parsed->emplace_back(name_and_bytes[0], bytes);
+      }
+    }
+    return parsed;
+  }();
+  for (const auto& rule : *rules) {
+    if (table.find(rule.first) != std::string::npos) {
+      return rule.second;
+    }
+  }
+  return 0;
+}
+
+}  // namespace embedding
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_ADMISSION_TUNER_H_
@@ -75,6 +75,203 @@ template __global__ void CopyEmbedding<float>(float**, float*, int, int);
 template __global__ void CopyEmbedding<double>(double**, double*, int, int);
 template __global__ void CopyEmbedding<long long>(long long**, long long*, int, int);
 
+// Murmur-style finalizer used for all hot-key-cache slot addressing.
+// Slot assignment happens entirely on the device (see
+// BatchSelectHotKeyCacheSlot below), so there is no host copy of this
+// mix to keep in sync.
+__device__ inline unsigned long long HotKeyCacheHash(unsigned long long k) {
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ULL;
+  k ^= k >> 33;
+  return k;
+}
+
+template<class K, class V>
+__global__ void BatchGatherHotKeyCache(const K* keys, const K* cache_keys,
+                                       const V* cache_values, int capacity,
+                                       int value_len, int max_probe,
+                                       V* val_base, bool* hit_flags, int limit) {
+  int i = blockDim.x * blockIdx.x + threadIdx.x;
+  int item_id = i / value_len;
+  int item_pos = i % value_len;
+
+  if (i < limit * value_len) {
+    K key = keys[item_id];
+    int slot = HotKeyCacheHash((unsigned long long)key) & (capacity - 1);
+    int found = -1;
+    for (int probe = 0; probe < max_probe; ++probe) {
+      K cached = cache_keys[slot];
+      if (cached == key) {
+        found = slot;
+        break;
+      }
+      if (cached == (K)-1) {
+        break;
+      }
+      slot = (slot + 1) & (capacity - 1);
+    }
+    if (found >= 0) {
+      val_base[i] = cache_values[(long long)found * value_len + item_pos];
+    }
+    if (item_pos == 0) {
+      hit_flags[item_id] = (found >= 0);
+    }
+  }
+}
+
+template<class K, class V>
+__global__ void BatchInsertHotKeyCache(const K* keys, const int* slots,
+                                       V** row_ptrs, K* cache_keys,
+                                       V* cache_values, int value_len,
+                                       int limit) {
+  int i = blockDim.x * blockIdx.x + threadIdx.x;
+  int item_id = i / value_len;
+  int item_pos = i % value_len;
+
+  if (i < limit * value_len) {
+    int slot = slots[item_id];
+    // Slot -1 means victim selection could not claim a slot for this
+    // key (it lost a CAS race within the batch); skip it this step.
+    if (slot < 0) {
+      return;
+    }
+    cache_values[(long long)slot * value_len + item_pos] =
+        *(row_ptrs[item_id] + item_pos);
+    if (item_pos == 0) {
+      cache_keys[slot] = keys[item_id];
+    }
+  }
+}
+
+__device__ inline bool HotKeyCacheClaimSlot(int* addr, int expected,
+                                            int desired) {
+  return atomicCAS(addr, expected, desired) == expected;
+}
+
+__device__ inline bool HotKeyCacheClaimSlot(long long* addr,
+                                            long long expected,
+                                            long long desired) {
+  return atomicCAS((unsigned long long*)addr, (unsigned long long)expected,
+                   (unsigned long long)desired) == (unsigned long long)expected;
+}
+
+template<class K>
+__global__ void BatchTouchHotKeyCache(const K* keys, const K* cache_keys,
+                                      unsigned long long* access_stamps,
+                                      int capacity, int max_probe,
+                                      unsigned long long stamp, int limit) {
+  int i = blockDim.x * blockIdx.x + threadIdx.x;
+
+  if (i < limit) {
+    K key = keys[i];
+    int slot = HotKeyCacheHash((unsigned long long)key) & (capacity - 1);
+    for (int probe = 0; probe < max_probe; ++probe) {
+      K cached = cache_keys[slot];
+      if (cached == key) {
+        // Plain store: the stamp only guides victim selection, the
+        // last writer winning for a duplicated key is fine.
+        access_stamps[slot] = stamp;
+        break;
+      }
+      if (cached == (K)-1) {
+        break;
+      }
+      slot = (slot + 1) & (capacity - 1);
+    }
+  }
+}
+
+// One block per key, one thread per probe-window position. Each thread
+// ranks its slot (own key < empty < occupied-by-stamp) and a
+// shared-memory tree reduction picks the best candidate; thread 0 then
+// claims it with a CAS on the key word so two batch keys can never
+// write the same victim slot. blockDim.x must equal max_probe and be a
+// power of two no larger than kMaxProbeWindow.
+template<class K>
+__global__ void BatchSelectHotKeyCacheSlot(const K* keys, K* cache_keys,
+                                           unsigned long long* access_stamps,
+                                           int capacity, int max_probe,
+                                           unsigned long long stamp,
+                                           int* slots, int limit) {
+  const int kMaxProbeWindow = 32;
+  __shared__ unsigned long long score[kMaxProbeWindow];
+  __shared__ int cand[kMaxProbeWindow];
+  __shared__ K seen[kMaxProbeWindow];
+
+  int item_id = blockIdx.x;
+  int t = threadIdx.x;
+  if (item_id >= limit || t >= max_probe) {
+    return;
+  }
+  K key = keys[item_id];
+  int home = HotKeyCacheHash((unsigned long long)key) & (capacity - 1);
+  int slot = (home + t) & (capacity - 1);
+  K cached = cache_keys[slot];
+  // Rank occupies the top two bits, the access stamp the rest, so the
+  // minimum score is "own slot, else an empty slot, else the least
+  // recently touched occupant".
+  unsigned long long s;
+  if (cached == key) {
+    s = 0ull;
+  } else if (cached == (K)-1) {
+    s = 1ull << 62;
+  } else {
+    s = (2ull << 62) |
+        (access_stamps[slot] & ((1ull << 62) - 1));
+  }
+  score[t] = s;
+  cand[t] = slot;
+  seen[t] = cached;
+  __syncthreads();
+
+  for (int stride = max_probe / 2; stride > 0; stride >>= 1) {
+    if (t < stride && score[t + stride] < score[t]) {
+      score[t] = score[t + stride];
+      cand[t] = cand[t + stride];
+      seen[t] = seen[t + stride];
+    }
+    __syncthreads();
+  }
+
+  if (t == 0) {
+    int best = cand[0];
+    if (seen[0] == key ||
+        HotKeyCacheClaimSlot(&cache_keys[best], seen[0], key)) {
+      access_stamps[best] = stamp;
+      slots[item_id] = best;
+    } else {
+      slots[item_id] = -1;
+    }
+  }
+}
+
+#define REGISTER_HOT_KEY_CACHE_KERNELS(ktype, vtype)                        \
+  template __global__ void BatchGatherHotKeyCache<ktype, vtype>(            \
+      const ktype*, const ktype*, const vtype*, int, int, int, vtype*,      \
+      bool*, int);                                                          \
+  template __global__ void BatchInsertHotKeyCache<ktype, vtype>(            \
+      const ktype*, const int*, vtype**, ktype*, vtype*, int, int);
+
+#define REGISTER_HOT_KEY_CACHE_META_KERNELS(ktype)                          \
+  template __global__ void BatchTouchHotKeyCache<ktype>(                    \
+      const ktype*, const ktype*, unsigned long long*, int, int,            \
+      unsigned long long, int);                                             \
+  template __global__ void BatchSelectHotKeyCacheSlot<ktype>(               \
+      const ktype*, ktype*, unsigned long long*, int, int,                  \
+      unsigned long long, int*, int);
+
+REGISTER_HOT_KEY_CACHE_META_KERNELS(int)
+REGISTER_HOT_KEY_CACHE_META_KERNELS(long long)
+#undef REGISTER_HOT_KEY_CACHE_META_KERNELS
+
+REGISTER_HOT_KEY_CACHE_KERNELS(int, float)
+REGISTER_HOT_KEY_CACHE_KERNELS(int, double)
+REGISTER_HOT_KEY_CACHE_KERNELS(long long, float)
+REGISTER_HOT_KEY_CACHE_KERNELS(long long, double)
+#undef REGISTER_HOT_KEY_CACHE_KERNELS
+
 }  // namespace tensorflow
 #endif  // TENSORFLOW_USE_GPU_EV
 #endif  // GOOGLE_CUDA
@@ -22,6 +22,31 @@ __global__ void SparseApplyAdagradGPU(V** a, V** v, V* g, float lr,
 template<class V>
 __global__ void CopyEmbedding(V** batch, V* batch_data_space, int total_dims, int limit);
 
+template<class K, class V>
+__global__ void BatchGatherHotKeyCache(const K* keys, const K* cache_keys,
+                                       const V* cache_values, int capacity,
+                                       int value_len, int max_probe,
+                                       V* val_base, bool* hit_flags, int limit);
+
+template<class K, class V>
+__global__ void BatchInsertHotKeyCache(const K* keys, const int* slots,
+                                       V** row_ptrs, K* cache_keys,
+                                       V* cache_values, int value_len,
+                                       int limit);
+
+template<class K>
+__global__ void BatchTouchHotKeyCache(const K* keys, const K* cache_keys,
+                                      unsigned long long* access_stamps,
+                                      int capacity, int max_probe,
+                                      unsigned long long stamp, int limit);
+
+template<class K>
+__global__ void BatchSelectHotKeyCacheSlot(const K* keys, K* cache_keys,
+                                           unsigned long long* access_stamps,
+                                           int capacity, int max_probe,
+                                           unsigned long long stamp,
+                                           int* slots, int limit);
+
 }  // namespace tensorflow
 
 #endif  // TENSORFLOW_USE_GPU_EV
@@ -1,5 +1,6 @@
 #ifndef TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_CACHE_H_
 #define TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_CACHE_H_
+#include <algorithm>
 #include <iostream>
 #include <map>
 #include <unordered_map>
@@ -14,6 +15,12 @@
 namespace tensorflow {
 namespace embedding {
 
+enum class CacheStrategy {
+  LRU = 0,
+  LFU = 1,
+  SHARDED_LRU = 2
+};
+
 template <class K>
 class BatchCache {
  public:
@@ -22,6 +29,9 @@ class BatchCache {
   void add_to_rank(const Tensor& t) {
     add_to_rank((K*)t.data(), t.NumElements());
   }
+  // Returned ids are sorted ascending: the eviction consumer writes
+  // them back into the lower tier, and a sorted run lets LevelDBKV
+  // assemble sequential WriteBatches instead of random point writes.
   virtual size_t get_evic_ids(K* evic_ids, size_t k_size) = 0;
   virtual void add_to_rank(const K* batch_ids, size_t batch_size) = 0;
   virtual size_t size() = 0;
@@ -77,6 +87,7 @@ class LRUCache : public BatchCache<K> {
     }
     evic_node->next = tail;
     tail->pre = evic_node;
+    std::sort(evic_ids, evic_ids + true_size);
     return true_size;
   }
 
@@ -155,6 +166,7 @@ class LFUCache : public BatchCache<K> {
         }
       }
     }
+    std::sort(evic_ids, evic_ids + true_size);
     return true_size;
   }
 
@@ -205,6 +217,71 @@ class LFUCache : public BatchCache<K> {
   mutex mu_;
 };
 
+// Hash-partitioned LRU: every shard keeps its own list, map and mutex,
+// so concurrent add_to_rank calls from the gather path only contend on
+// the shards their ids hash to instead of one global lock. Eviction
+// takes a proportional slice from every shard, which approximates
+// global LRU order closely enough for the BatchEviction loop in
+// StorageManager.
+template <class K>
+class ShardedLRUCache : public BatchCache<K> {
+ public:
+  explicit ShardedLRUCache(int num_shards = kDefaultShards) {
+    for (int i = 0; i < num_shards; ++i) {
+      shards_.emplace_back(new LRUCache<K>());
+    }
+  }
+
+  ~ShardedLRUCache() {
+    for (auto shard : shards_) {
+      delete shard;
+    }
+  }
+
+  size_t size() {
+    size_t total = 0;
+    for (auto shard : shards_) {
+      total += shard->size();
+    }
+    return total;
+  }
+
+  size_t get_evic_ids(K* evic_ids, size_t k_size) {
+    size_t true_size = 0;
+    size_t per_shard = k_size / shards_.size() + 1;
+    for (auto shard : shards_) {
+      if (true_size >= k_size) {
+        break;
+      }
+      // Each shard hands back a sorted run; merging as we go keeps the
+      // whole batch sorted without a final full sort.
+      size_t shard_size = shard->get_evic_ids(
+          evic_ids + true_size,
+          std::min(per_shard, k_size - true_size));
+      std::inplace_merge(evic_ids, evic_ids + true_size,
+                         evic_ids + true_size + shard_size);
+      true_size += shard_size;
+    }
+    return true_size;
+  }
+
+  void add_to_rank(const K* batch_ids, size_t batch_size) {
+    std::vector<std::vector<K>> parts(shards_.size());
+    for (size_t i = 0; i < batch_size; ++i) {
+      parts[batch_ids[i] % shards_.size()].emplace_back(batch_ids[i]);
+    }
+    for (size_t s = 0; s < shards_.size(); ++s) {
+      if (!parts[s].empty()) {
+        shards_[s]->add_to_rank(parts[s].data(), parts[s].size());
+      }
+    }
+  }
+
+ private:
+  static const int kDefaultShards = 16;
+  std::vector<LRUCache<K>*> shards_;
+};
+
 } // embedding
 } // tensorflow
 
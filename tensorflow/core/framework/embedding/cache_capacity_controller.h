@@ -0,0 +1,146 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_CACHE_CAPACITY_CONTROLLER_H_
+#define TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_CACHE_CAPACITY_CONTROLLER_H_
+
+#include <functional>
+#include <map>
+#include <utility>
+
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace embedding {
+
+// Rebalances the DRAM-tier capacity of all multi-tier embedding
+// storages in the process, enabled by TF_EV_ADAPTIVE_TIER_SIZING=1.
+// Every StorageManager registers its initial capacity together with a
+// callback draining its level-0 hit/miss counters and one applying a
+// new capacity. A background thread periodically redistributes the
+// combined budget proportionally to each table's observed hit rate:
+// tables with a flat access distribution keep missing no matter how
+// much DRAM they hold and donate budget to tables with skewed access
+// that can actually use it. Type-erased so StorageManager<K, V>
+// instantiations of different types share one budget.
+class CacheCapacityController {
+ public:
+  static CacheCapacityController* GetInstance() {
+    static CacheCapacityController* instance = new CacheCapacityController();
+    return instance;
+  }
+
+  static bool Enabled() {
+    static bool enabled = std::getenv("TF_EV_ADAPTIVE_TIER_SIZING") != nullptr
+        && std::getenv("TF_EV_ADAPTIVE_TIER_SIZING")[0] == '1';
+    return enabled;
+  }
+
+  int64 Register(int64 initial_capacity,
+                 std::function<std::pair<int64, int64>()> drain_stats,
+                 std::function<void(int64)> set_capacity) {
+    mutex_lock l(mu_);
+    int64 handle = next_handle_++;
+    entries_[handle] = Entry{initial_capacity, initial_capacity,
+                             drain_stats, set_capacity};
+    total_budget_ += initial_capacity;
+    if (rebalance_thread_ == nullptr) {
+      rebalance_thread_.reset(Env::Default()->StartThread(
+          ThreadOptions(), "ev_adaptive_tier_sizing",
+          [this]() { RebalanceLoop(); }));
+    }
+    return handle;
+  }
+
+  void Deregister(int64 handle) {
+    mutex_lock l(mu_);
+    auto it = entries_.find(handle);
+    if (it != entries_.end()) {
+      total_budget_ -= it->second.initial_capacity;
+      entries_.erase(it);
+    }
+  }
+
+ private:
+  struct Entry {
+    int64 initial_capacity;
+    int64 capacity;
+    std::function<std::pair<int64, int64>()> drain_stats;
+    std::function<void(int64)> set_capacity;
+  };
+
+  // Resize no table to less than 1/4 or more than 4x its configured
+  // capacity so a burst of unusual traffic cannot starve it for good.
+  static constexpr double kMinScale = 0.25;
+  static constexpr double kMaxScale = 4.0;
+  // A table with too few lookups in an interval keeps its capacity.
+  static const int64 kMinSamples = 1024;
+  static const int64 kIntervalSeconds = 10;
+
+  void RebalanceLoop() {
+    while (true) {
+      Env::Default()->SleepForMicroseconds(kIntervalSeconds * 1000 * 1000);
+      mutex_lock l(mu_);
+      if (entries_.size() < 2) {
+        continue;
+      }
+      double total_weight = 0;
+      std::map<int64, double> weights;
+      for (auto& entry : entries_) {
+        auto stats = entry.second.drain_stats();
+        int64 hits = stats.first;
+        int64 misses = stats.second;
+        double weight;
+        if (hits + misses < kMinSamples) {
+          // Not enough traffic to judge; weight by current share.
+          weight = static_cast<double>(entry.second.capacity) / total_budget_;
+        } else {
+          weight = static_cast<double>(hits) / (hits + misses);
+        }
+        weights[entry.first] = weight;
+        total_weight += weight;
+      }
+      if (total_weight <= 0) {
+        continue;
+      }
+      for (auto& entry : entries_) {
+        int64 capacity = total_budget_ * weights[entry.first] / total_weight;
+        int64 lo = entry.second.initial_capacity * kMinScale;
+        int64 hi = entry.second.initial_capacity * kMaxScale;
+        capacity = std::max(lo, std::min(hi, capacity));
+        if (capacity != entry.second.capacity) {
+          VLOG(1) << "Adaptive tier sizing: capacity "
+                  << entry.second.capacity << " -> " << capacity;
+          entry.second.capacity = capacity;
+          entry.second.set_capacity(capacity);
+        }
+      }
+    }
+  }
+
+  mutex mu_;
+  int64 next_handle_ = 0;
+  int64 total_budget_ = 0;
+  std::map<int64, Entry> entries_ GUARDED_BY(mu_);
+  std::unique_ptr<Thread> rebalance_thread_;
+};
+
+}  // namespace embedding
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_CACHE_CAPACITY_CONTROLLER_H_
@@ -0,0 +1,224 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_COMPACTION_SCHEDULER_H_
+#define TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_COMPACTION_SCHEDULER_H_
+
+#include <sys/stat.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <map>
+#include <string>
+
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace embedding {
+
+// Token-bucket limiter on compaction I/O operations, shared by every
+// SSDHashKV instance whose value log lives on the same device (keyed
+// by st_dev of the log directory), so several tiers compacting at once
+// cannot jointly saturate one SSD and starve foreground gathers.
+// Disabled unless TF_SSDHASH_COMPACTION_IOPS_LIMIT is set to a
+// positive operations-per-second number.
+class CompactionDeviceThrottle {
+ public:
+  static CompactionDeviceThrottle* GetForPath(const std::string& dir) {
+    static mutex registry_mu;
+    static std::map<uint64, CompactionDeviceThrottle*>* registry =
+        new std::map<uint64, CompactionDeviceThrottle*>();
+    struct stat st;
+    uint64 key = 0;
+    if (stat(dir.c_str(), &st) == 0) {
+      key = static_cast<uint64>(st.st_dev);
+    }
+    mutex_lock l(registry_mu);
+    auto it = registry->find(key);
+    if (it == registry->end()) {
+      it = registry->emplace(key, new CompactionDeviceThrottle()).first;
+    }
+    return it->second;
+  }
+
+  // Blocks until `ops` operations fit the per-second budget and
+  // returns the microseconds spent waiting. The lock is held across
+  // the sleep on purpose: the only callers are compaction threads of
+  // tiers on this same device, and making them queue here is exactly
+  // the throttling we want.
+  int64 Acquire(int64 ops) {
+    if (limit_ <= 0 || ops <= 0) {
+      return 0;
+    }
+    mutex_lock l(mu_);
+    int64 waited = 0;
+    Refill();
+    while (tokens_ < ops) {
+      int64 need_us = (ops - tokens_) * 1000000 / limit_ + 1;
+      Env::Default()->SleepForMicroseconds(need_us);
+      waited += need_us;
+      Refill();
+    }
+    tokens_ -= ops;
+    return waited;
+  }
+
+  int64 limit() const { return limit_; }
+
+ private:
+  CompactionDeviceThrottle() : tokens_(0) {
+    const char* env = std::getenv("TF_SSDHASH_COMPACTION_IOPS_LIMIT");
+    limit_ = (env == nullptr) ? 0 : atoll(env);
+    last_refill_us_ = Env::Default()->NowMicros();
+  }
+
+  // Burst is capped at one second of budget so an idle period cannot
+  // bank an I/O storm.
+  void Refill() {
+    int64 now = Env::Default()->NowMicros();
+    tokens_ += (now - last_refill_us_) * limit_ / 1000000;
+    if (tokens_ > limit_) {
+      tokens_ = limit_;
+    }
+    last_refill_us_ = now;
+  }
+
+  int64 limit_;
+  mutex mu_;
+  int64 tokens_;
+  int64 last_refill_us_;
+};
+
+// Decides when one SSDHashKV instance may run a GC pass and how fast
+// that pass may touch the device. The garbage trigger in ssd_hashkv.h
+// stays as is; this sits behind it and defers a pass that would
+// exceed the write-amplification budget while foreground traffic is
+// active. Three rules, in order:
+//
+//  1. Emergency: when more than half of all appended records are
+//     garbage the pass always runs, budget or not, so the value log
+//     cannot grow without bound under a hostile write pattern.
+//  2. Idle preference: when no user write has been recorded for
+//     TF_SSDHASH_COMPACTION_IDLE_MS milliseconds (default 10) the
+//     tier is between bursts and the pass runs for free.
+//  3. Budget: otherwise the pass runs only while cumulative
+//     compaction bytes stay under TF_SSDHASH_COMPACTION_WA_BUDGET
+//     (default 2.0) times cumulative user bytes, i.e. a bounded write
+//     amplification of 1 + budget.
+//
+// Counters are cumulative and logged after every finished pass, which
+// is rare enough that no export thread is needed.
+class CompactionScheduler {
+ public:
+  explicit CompactionScheduler(const std::string& path)
+      : throttle_(CompactionDeviceThrottle::GetForPath(path)), path_(path) {
+    const char* budget = std::getenv("TF_SSDHASH_COMPACTION_WA_BUDGET");
+    wa_budget_ = (budget == nullptr) ? 2.0 : atof(budget);
+    const char* idle = std::getenv("TF_SSDHASH_COMPACTION_IDLE_MS");
+    idle_us_ = ((idle == nullptr) ? 10 : atoll(idle)) * 1000;
+    last_user_write_us_.store(Env::Default()->NowMicros(),
+                              std::memory_order_relaxed);
+  }
+
+  // Called once per user commit batch, not per key.
+  void RecordUserWrite(int64 bytes) {
+    user_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    last_user_write_us_.store(Env::Default()->NowMicros(),
+                              std::memory_order_relaxed);
+  }
+
+  void RecordCompactionWrite(int64 bytes) {
+    compaction_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+  }
+
+  // Called after the garbage trigger fires; false defers the pass to
+  // a later commit (the trigger condition keeps holding, so nothing
+  // is lost, only delayed into idle time or budget headroom).
+  bool Admit(int64 live_count, int64 total_count) {
+    if (total_count > 0 && total_count - live_count > total_count / 2) {
+      emergencies_.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+    int64 now = Env::Default()->NowMicros();
+    if (now - last_user_write_us_.load(std::memory_order_relaxed) >=
+        idle_us_) {
+      idle_passes_.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+    if (compaction_bytes_.load(std::memory_order_relaxed) <=
+        wa_budget_ * user_bytes_.load(std::memory_order_relaxed)) {
+      return true;
+    }
+    deferrals_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  // One read op per rewritten record: the live records of a victim
+  // file are scattered, so each one costs roughly one device read.
+  void ThrottleReads(int64 records) {
+    throttle_wait_us_.fetch_add(throttle_->Acquire(records),
+                                std::memory_order_relaxed);
+  }
+
+  // Compaction output is written sequentially in large chunks; count
+  // one op per 256KB of payload.
+  void ThrottleWriteBytes(int64 bytes) {
+    static const int64 kWriteOpBytes = 256 << 10;
+    throttle_wait_us_.fetch_add(
+        throttle_->Acquire((bytes + kWriteOpBytes - 1) / kWriteOpBytes),
+        std::memory_order_relaxed);
+  }
+
+  void FinishPass() {
+    passes_.fetch_add(1, std::memory_order_relaxed);
+    int64 user = user_bytes_.load(std::memory_order_relaxed);
+    int64 compact = compaction_bytes_.load(std::memory_order_relaxed);
+    LOG(INFO) << "EV ssd compaction stats, path:" << path_
+              << ", passes:" << passes_.load(std::memory_order_relaxed)
+              << ", deferrals:" << deferrals_.load(std::memory_order_relaxed)
+              << ", idle_passes:"
+              << idle_passes_.load(std::memory_order_relaxed)
+              << ", emergencies:"
+              << emergencies_.load(std::memory_order_relaxed)
+              << ", user_bytes:" << user
+              << ", compaction_bytes:" << compact
+              << ", write_amplification:"
+              << (user == 0 ? 0.0 : 1.0 + static_cast<double>(compact) / user)
+              << ", throttle_wait_us:"
+              << throttle_wait_us_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  CompactionDeviceThrottle* throttle_;  // not owned, process lifetime
+  std::string path_;
+  double wa_budget_;
+  int64 idle_us_;
+  std::atomic<int64> last_user_write_us_{0};
+  std::atomic<int64> user_bytes_{0};
+  std::atomic<int64> compaction_bytes_{0};
+  std::atomic<int64> passes_{0};
+  std::atomic<int64> deferrals_{0};
+  std::atomic<int64> idle_passes_{0};
+  std::atomic<int64> emergencies_{0};
+  std::atomic<int64> throttle_wait_us_{0};
+};
+
+}  // namespace embedding
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_COMPACTION_SCHEDULER_H_
@@ -0,0 +1,103 @@
+#ifndef TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_COUNT_MIN_SKETCH_H_
+#define TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_COUNT_MIN_SKETCH_H_
+
+#include <limits>
+#include <vector>
+
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace embedding {
+
+// Approximate per-key frequency for admission filtering. Updates are
+// staged in a thread-local buffer and merged into the shared counter
+// table in batches, so the lookup hot path performs no shared-memory
+// write per key; the per-ValuePtr counter path dirties one cache line
+// per key per step instead. Estimates only over-count (standard
+// count-min guarantee), which for admission means a key is never
+// admitted later than with exact counts.
+//
+// The thread-local buffer keeps a raw owner pointer, so sketches are
+// expected to live as long as the EmbeddingVar that owns them.
+template <class K>
+class CountMinSketch {
+ public:
+  explicit CountMinSketch(int depth = 4, int64 width = 1 << 18)
+      : depth_(depth), width_(width) {
+    counters_.resize(depth_ * width_, 0);
+  }
+
+  void AddFreq(K key, int count) {
+    PendingBuffer* buf = pending();
+    buf->entries[buf->size].key = key;
+    buf->entries[buf->size].count = count;
+    if (++buf->size == kPendingSize) {
+      Flush(buf);
+    }
+  }
+
+  int64 GetFreq(K key) {
+    int64 freq = std::numeric_limits<int64>::max();
+    for (int d = 0; d < depth_; ++d) {
+      freq = std::min(freq,
+          static_cast<int64>(counters_[d * width_ + Bucket(key, d)]));
+    }
+    return freq;
+  }
+
+ private:
+  static const int kPendingSize = 256;
+
+  struct PendingEntry {
+    K key;
+    int count;
+  };
+
+  struct PendingBuffer {
+    PendingEntry entries[kPendingSize];
+    int size = 0;
+    CountMinSketch<K>* owner = nullptr;
+  };
+
+  PendingBuffer* pending() {
+    thread_local PendingBuffer buf;
+    if (buf.owner != this) {
+      if (buf.owner != nullptr) {
+        buf.owner->Flush(&buf);
+      }
+      buf.owner = this;
+    }
+    return &buf;
+  }
+
+  void Flush(PendingBuffer* buf) {
+    for (int i = 0; i < buf->size; ++i) {
+      for (int d = 0; d < depth_; ++d) {
+        __sync_fetch_and_add(
+            &counters_[d * width_ + Bucket(buf->entries[i].key, d)],
+            buf->entries[i].count);
+      }
+    }
+    buf->size = 0;
+  }
+
+  size_t Bucket(K key, int d) {
+    static const uint64 kSeeds[8] = {
+        0x9E3779B97F4A7C15ull, 0xC2B2AE3D27D4EB4Full,
+        0x165667B19E3779F9ull, 0x27D4EB2F165667C5ull,
+        0x85EBCA77C2B2AE63ull, 0xFF51AFD7ED558CCDull,
+        0xC4CEB9FE1A85EC53ull, 0x2545F4914F6CDD1Dull};
+    uint64 h = static_cast<uint64>(key) * kSeeds[d % 8];
+    h ^= h >> 33;
+    return h % width_;
+  }
+
+  int depth_;
+  int64 width_;
+  std::vector<int64> counters_;
+};
+
+}  // namespace embedding
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_COUNT_MIN_SKETCH_H_
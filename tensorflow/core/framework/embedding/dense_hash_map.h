@@ -21,6 +21,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/spin_rw_lock.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/framework/embedding/kv_interface.h"
+#include "tensorflow/core/framework/embedding/kv_stats.h"
 
 namespace tensorflow {
 template <class V>
@@ -39,16 +40,37 @@ class DenseHashMap : public KVInterface<K, V> {
       hash_map_[i].hash_map.set_empty_key(-1);
       hash_map_[i].hash_map.set_deleted_key(-2);
     }
+    stats_id_ = KVStatsCollector::GetInstance()->Register(
+        strings::StrCat("DenseHashMap@",
+                        strings::Hex(reinterpret_cast<uint64>(this))),
+        [this](KVStatsSnapshot* snap) {
+          // Size and capacity are summed over the partitions; the load
+          // factor is the aggregate occupancy.
+          for (int i = 0; i < partition_num_; i++) {
+            spin_rd_lock l(hash_map_[i].mu);
+            snap->size += hash_map_[i].hash_map.size();
+            snap->capacity += hash_map_[i].hash_map.bucket_count();
+          }
+          if (snap->capacity > 0) {
+            snap->load_factor =
+                static_cast<double>(snap->size) / snap->capacity;
+          }
+          snap->max_load_factor = hash_map_[0].hash_map.max_load_factor();
+          probe_stats_.Fill(snap);
+        });
   }
 
   ~DenseHashMap() {
+    KVStatsCollector::GetInstance()->Unregister(stats_id_);
     delete []hash_map_;
   }
 
   Status Lookup(K key, ValuePtr<V>** value_ptr) {
+    uint64 sample = KVStatsCollector::Begin();
     int64 l_id = std::abs(key)%partition_num_;
     spin_rd_lock l(hash_map_[l_id].mu);
     auto iter = hash_map_[l_id].hash_map.find(key);
+    probe_stats_.End(sample);
     if (iter == hash_map_[l_id].hash_map.end()) {
       return errors::NotFound(
           "Unable to find Key: ", key, " in DenseHashMap.");
@@ -121,6 +143,8 @@ class DenseHashMap : public KVInterface<K, V> {
     google::dense_hash_map<K, ValuePtr<V>* > hash_map;
   };
   dense_hash_map* hash_map_;
+  KVProbeStats probe_stats_;
+  int64 stats_id_ = -1;
 };
 
 }  // namespace embedding
@@ -0,0 +1,105 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_DIRTY_KEY_SET_H_
+#define TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_DIRTY_KEY_SET_H_
+
+#include <algorithm>
+#include <vector>
+
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace embedding {
+
+// Records keys updated since the last delta export in per-shard
+// lock-free rings. Writers reserve a slot with a fetch-and-add and
+// store the key; no lock is taken on the update path. When a ring
+// fills up before the next drain the shard is marked overflowed and
+// the caller is expected to fall back to a full export, so a dropped
+// slot never silently loses an update. Draining is expected to run on
+// a single exporter thread; keys recorded concurrently with a drain
+// may surface in the next delta instead of the current one.
+template <class K>
+class DirtyKeySet {
+ public:
+  explicit DirtyKeySet(int num_shards = kDefaultShards,
+                       int64 shard_capacity = kDefaultShardCapacity)
+      : shard_capacity_(shard_capacity) {
+    for (int i = 0; i < num_shards; ++i) {
+      shards_.push_back(new Shard(shard_capacity));
+    }
+  }
+
+  ~DirtyKeySet() {
+    for (auto shard : shards_) {
+      delete shard;
+    }
+  }
+
+  void Record(K key) {
+    Shard* shard = shards_[static_cast<uint64>(key) % shards_.size()];
+    int64 slot = __sync_fetch_and_add(&shard->head, 1);
+    if (slot >= shard_capacity_) {
+      shard->overflow = true;
+      return;
+    }
+    shard->ring[slot] = key;
+  }
+
+  // Moves all recorded keys into key_list, deduplicated. Returns false
+  // if any shard overflowed since the last drain; the recorded keys are
+  // then incomplete and the caller should export the full table.
+  bool Drain(std::vector<K>* key_list) {
+    bool complete = true;
+    for (auto shard : shards_) {
+      int64 n = __sync_lock_test_and_set(&shard->head, 0);
+      if (shard->overflow) {
+        shard->overflow = false;
+        complete = false;
+      }
+      n = std::min(n, shard_capacity_);
+      for (int64 i = 0; i < n; ++i) {
+        key_list->push_back(shard->ring[i]);
+      }
+    }
+    std::sort(key_list->begin(), key_list->end());
+    key_list->erase(std::unique(key_list->begin(), key_list->end()),
+                    key_list->end());
+    return complete;
+  }
+
+ private:
+  struct Shard {
+    explicit Shard(int64 capacity) : head(0), overflow(false) {
+      ring.resize(capacity);
+    }
+    int64 head;
+    volatile bool overflow;
+    std::vector<K> ring;
+  };
+
+  static const int kDefaultShards = 16;
+  static const int64 kDefaultShardCapacity = 1 << 17;
+
+  int64 shard_capacity_;
+  std::vector<Shard*> shards_;
+};
+
+}  // namespace embedding
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_DIRTY_KEY_SET_H_
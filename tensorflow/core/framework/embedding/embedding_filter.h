@@ -1,11 +1,17 @@
 #ifndef TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_EMBEDDING_FILTER_H_
 #define TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_EMBEDDING_FILTER_H_
 
+#include <memory>
+
 //#include "tensorflow/core/framework/embedding/embedding_var.h"
+#include "tensorflow/core/framework/embedding/admission_tuner.h"
 #include "tensorflow/core/framework/embedding/embedding_config.h"
+#include "tensorflow/core/framework/embedding/simd_copy.h"
+#include "tensorflow/core/lib/gtl/inlined_vector.h"
 #if GOOGLE_CUDA
 #if !TENSORFLOW_USE_GPU_EV
 #include "tensorflow/core/framework/embedding/batch.h"
+#include "tensorflow/core/framework/embedding/pinned_staging_pool.h"
 #endif  // TENSORFLOW_USE_GPU_EV
 #endif  // GOOGLE_CUDA
 
@@ -28,6 +34,29 @@ void UpdateCache(K* key_buff, int64 key_num, EV* ev) {
       cache->add_to_rank(key_buff, key_num);
     }
 }
+
+// When TF_EV_LAZY_DEFAULT_INIT=1, a gather of a never-updated key serves
+// the shared default row instead of allocating a private copy; the row is
+// materialized by the first update through LookupOrCreateEmb.
+inline bool LazyDefaultInitEnabled() {
+  static bool enabled = [] {
+    const char* flag = std::getenv("TF_EV_LAZY_DEFAULT_INIT");
+    return flag != nullptr && flag[0] == '1';
+  }();
+  return enabled;
+}
+
+// When TF_EV_BLOOM_BLOCKED=1, all bloom admission counters for a key
+// live in one cache-line-sized block, so a probe costs a single cache
+// miss instead of kHashFunc. The flag changes the hash-to-slot mapping
+// and must stay constant across a training run.
+inline bool BlockedBloomEnabled() {
+  static bool enabled = [] {
+    const char* flag = std::getenv("TF_EV_BLOOM_BLOCKED");
+    return flag != nullptr && flag[0] == '1';
+  }();
+  return enabled;
+}
 }
 
 struct RestoreBuffer {
@@ -54,12 +83,29 @@ class EmbeddingFilter {
   virtual void Lookup(EV* ev, K key, V* val, const V* default_value_ptr,
     const V* default_value_no_permission) {
     ValuePtr<V>* value_ptr = nullptr;
-    Status s = ev->LookupKey(key, &value_ptr);
-    if (s.ok()) {
+    if (!ev->LookupKey(key, &value_ptr).ok()) {
+      value_ptr = nullptr;
+    }
+    LookupResolved(ev, key, value_ptr, val, default_value_ptr,
+                   default_value_no_permission);
+  }
+
+  // Serves a key whose storage probe already happened, e.g. through a
+  // batched get: value_ptr is the probe result, nullptr when the key is
+  // absent from every tier. Shares the serve-or-default branches with
+  // Lookup above.
+  virtual void LookupResolved(EV* ev, K key, ValuePtr<V>* value_ptr, V* val,
+    const V* default_value_ptr, const V* default_value_no_permission) {
+    if (value_ptr != nullptr) {
+      if (ev->IsCompressedStorage()) {
+        ev->DequantizePrimaryEmb(value_ptr, val);
+        return;
+      }
       V* mem_val = ev->LookupPrimaryEmb(value_ptr);
-      memcpy(val, mem_val, sizeof(V) * ev->ValueLen());
+      // Pads back to the model dim when the key sits in a short bucket.
+      ev->CopyOutEmb(value_ptr, mem_val, val);
     } else {
-      memcpy(val, default_value_no_permission, sizeof(V) * ev->ValueLen());
+      embedding::CopyEmbRow(val, default_value_no_permission, ev->ValueLen());
     }
   }
 
@@ -104,6 +150,9 @@ class BloomFilter : public EmbeddingFilter<K, V, EV> {
         bloom_counter_ = (void *)calloc(config_.num_counter, sizeof(long));
     }
     GenerateSeed(config.kHashFunc);
+    slots_per_block_ = kCacheLineBytes / CounterBytes();
+    blocked_ = BlockedBloomEnabled() && config_.num_counter >= slots_per_block_;
+    num_blocks_ = blocked_ ? config_.num_counter / slots_per_block_ : 0;
   }
 
   void LookupOrCreate(K key, V* val, const V* default_value_ptr,
@@ -111,11 +160,16 @@ class BloomFilter : public EmbeddingFilter<K, V, EV> {
                       const V* default_value_no_permission) override {
     if (GetBloomFreq(key) >= config_.filter_freq) {
       TF_CHECK_OK(ev_->LookupOrCreateKey(key, value_ptr));
+      if (ev_->IsCompressedStorage()) {
+        ev_->LookupOrCreateEmb(*value_ptr, default_value_ptr);
+        ev_->DequantizeEmb(*value_ptr, val);
+        return;
+      }
       V* mem_val = ev_->LookupOrCreateEmb(*value_ptr, default_value_ptr);
-      memcpy(val, mem_val, sizeof(V) * ev_->ValueLen());
+      embedding::CopyEmbRow(val, mem_val, ev_->ValueLen());
     } else {
       AddFreq(key, count);
-      memcpy(val, default_value_no_permission, sizeof(V) * ev_->ValueLen());
+      embedding::CopyEmbRow(val, default_value_no_permission, ev_->ValueLen());
     }
   }
 
@@ -145,11 +199,43 @@ class BloomFilter : public EmbeddingFilter<K, V, EV> {
   }
 
  private:
-  int64 GetBloomFreq(K key) {
-    std::vector<int64> hash_val;
-    for (int64 i = 0; i < config_.kHashFunc; i++) {
-      hash_val.emplace_back(FastHash64(key, seeds_[i]) % config_.num_counter);
+  static const int64 kCacheLineBytes = 64;
+  static const uint64_t kBlockSeed = 0x9E3779B97F4A7C15ull;
+
+  int64 CounterBytes() const {
+    switch (config_.counter_type) {
+      case DT_UINT32:
+        return sizeof(int);
+      case DT_UINT16:
+        return sizeof(int16);
+      case DT_UINT8:
+        return sizeof(bool);
+      default:
+        return sizeof(long);
     }
+  }
+
+  // Computes the counter slots probed for `key` without touching the
+  // heap. Default layout: every hash addresses the full table. Blocked
+  // layout: a dedicated hash picks a cache-line-sized block and the
+  // configured hashes pick slots inside it.
+  void ComputeSlots(K key, gtl::InlinedVector<int64, 8>* slots) {
+    if (blocked_) {
+      const int64 block =
+          (FastHash64(key, kBlockSeed) % num_blocks_) * slots_per_block_;
+      for (int64 i = 0; i < config_.kHashFunc; i++) {
+        slots->push_back(block + FastHash64(key, seeds_[i]) % slots_per_block_);
+      }
+    } else {
+      for (int64 i = 0; i < config_.kHashFunc; i++) {
+        slots->push_back(FastHash64(key, seeds_[i]) % config_.num_counter);
+      }
+    }
+  }
+
+  int64 GetBloomFreq(K key) {
+    gtl::InlinedVector<int64, 8> hash_val;
+    ComputeSlots(key, &hash_val);
     int64 min_freq;
     switch (config_.counter_type){
       case DT_UINT64:
@@ -193,7 +279,7 @@ class BloomFilter : public EmbeddingFilter<K, V, EV> {
   }
 
   template<typename VBloom>
-  int64 GetMinFreq(std::vector<int64> hash_val) {
+  int64 GetMinFreq(const gtl::InlinedVector<int64, 8>& hash_val) {
     VBloom min_freq = *((VBloom*)bloom_counter_ + hash_val[0]);
     for (auto it : hash_val) {
       min_freq = std::min(*((VBloom*)bloom_counter_ + it), min_freq);
@@ -202,17 +288,15 @@ class BloomFilter : public EmbeddingFilter<K, V, EV> {
   }
 
   template<typename VBloom>
-  void SetMinFreq(std::vector<int64> hash_val, int64 freq) {
+  void SetMinFreq(const gtl::InlinedVector<int64, 8>& hash_val, int64 freq) {
     for (auto it : hash_val) {
       *((VBloom*)bloom_counter_ + it) = freq;
     }
   }
 
   void SetBloomFreq(K key, int64 freq) {
-    std::vector<int64> hash_val;
-    for (int64 i = 0; i < config_.kHashFunc; i++) {
-      hash_val.push_back(FastHash64(key, seeds_[i]) % config_.num_counter);
-    }
+    gtl::InlinedVector<int64, 8> hash_val;
+    ComputeSlots(key, &hash_val);
    int64 min_freq;
     switch (config_.counter_type){
       case DT_UINT64:
@@ -278,10 +362,8 @@ class BloomFilter : public EmbeddingFilter<K, V, EV> {
   }
 
   void AddFreq(K key) {
-    std::vector<int64> hash_val;
-    for (int64 i = 0; i < config_.kHashFunc; i++) {
-      hash_val.push_back(FastHash64(key, seeds_[i]) % config_.num_counter);
-    }
+    gtl::InlinedVector<int64, 8> hash_val;
+    ComputeSlots(key, &hash_val);
 
     for (auto it : hash_val){
       switch (config_.counter_type){
@@ -309,10 +391,8 @@ class BloomFilter : public EmbeddingFilter<K, V, EV> {
   }
 
   void AddFreq(K key, int64 count) {
-    std::vector<int64> hash_val;
-    for (int64 i = 0; i < config_.kHashFunc; i++) {
-      hash_val.push_back(FastHash64(key, seeds_[i]) % config_.num_counter);
-    }
+    gtl::InlinedVector<int64, 8> hash_val;
+    ComputeSlots(key, &hash_val);
 
     for (auto it : hash_val){
       switch (config_.counter_type){
@@ -373,6 +453,9 @@ class BloomFilter : public EmbeddingFilter<K, V, EV> {
   EmbeddingConfig config_;
   EV* ev_;
   std::vector<int64> seeds_;
+  bool blocked_;
+  int64 slots_per_block_;
+  int64 num_blocks_;
   embedding::StorageManager<K, V>* storage_manager_;
 };
 
@@ -382,17 +465,36 @@ class CounterFilter : public EmbeddingFilter<K, V, EV> {
   CounterFilter(const EmbeddingConfig& config,
       EV* ev, embedding::StorageManager<K, V>* storage_manager)
        : config_(config), ev_(ev), storage_manager_(storage_manager) {
+    const int64 budget =
+        embedding::AdmissionBudgetBytesFromEnv(config.name);
+    if (budget > 0) {
+      // Adaptive mode: the configured filter_freq is only the starting
+      // point, afterwards the tuner holds admitted rows to the budget.
+      tuner_.reset(new embedding::AdmissionThresholdTuner(
+          budget, config.filter_freq));
+      LOG(INFO) << tuner_->DebugString(config.name);
+    }
   }
 
   void LookupOrCreate(K key, V* val, const V* default_value_ptr,
                       ValuePtr<V>** value_ptr, int count,
                       const V* default_value_no_permission) override {
     TF_CHECK_OK(ev_->LookupOrCreateKey(key, value_ptr));
-    if (GetFreq(key, *value_ptr) >= config_.filter_freq) {
-      V* mem_val = ev_->LookupOrCreateEmb(*value_ptr, default_value_ptr);
-      memcpy(val, mem_val, sizeof(V) * ev_->ValueLen());
+    const int64 freq = GetFreq(key, *value_ptr);
+    if (freq >= AdmissionThreshold(freq)) {
+      if (ev_->IsCompressedStorage()) {
+        ev_->LookupOrCreateEmb(*value_ptr, default_value_ptr);
+        ev_->DequantizeEmb(*value_ptr, val);
+        return;
+      }
+      // The adaptive path sizes (and, past the promotion frequency,
+      // resizes) the row from the key's dim bucket; with adaptive dims
+      // off it degenerates to LookupOrCreateEmb plus a full-length copy.
+      V* mem_val =
+          ev_->LookupOrCreateAdaptiveEmb(*value_ptr, default_value_ptr, freq);
+      ev_->CopyOutEmb(*value_ptr, mem_val, val);
     } else {
-      memcpy(val, default_value_no_permission, sizeof(V) * ev_->ValueLen());
+      embedding::CopyEmbRow(val, default_value_no_permission, ev_->ValueLen());
     }
   }
 
@@ -403,15 +505,22 @@ class CounterFilter : public EmbeddingFilter<K, V, EV> {
 
   Status LookupOrCreateKey(K key, ValuePtr<V>** val, bool* is_filter) override {
     Status s = ev_->LookupOrCreateKey(key, val);
-    *is_filter = GetFreq(key, *val) >= config_.filter_freq;
+    const int64 freq = GetFreq(key, *val);
+    *is_filter = freq >= AdmissionThreshold(freq);
     return s;
   }
 
   int64 GetFreq(K key, ValuePtr<V>* value_ptr) override {
+    if (ev_->FreqSketch() != nullptr) {
+      return ev_->FreqSketch()->GetFreq(key);
+    }
     return value_ptr->GetFreq();
   }
 
   int64 GetFreq(K key) override {
+    if (ev_->FreqSketch() != nullptr) {
+      return ev_->FreqSketch()->GetFreq(key);
+    }
     ValuePtr<V>* value_ptr = nullptr;
     TF_CHECK_OK(ev_->LookupOrCreateKey(key, &value_ptr));
     return value_ptr->GetFreq();
@@ -461,9 +570,26 @@ class CounterFilter : public EmbeddingFilter<K, V, EV> {
   }
 
  private:
+  // The effective filter_freq: static config unless the adaptive tuner
+  // is armed, in which case every runtime admission decision feeds the
+  // frequency histogram. The restore path (Import) keeps the static
+  // config so reloading a checkpoint is deterministic.
+  int64 AdmissionThreshold(int64 freq) {
+    if (tuner_ == nullptr) return config_.filter_freq;
+    // Resident cost of one admitted key; the row plus the ValuePtr
+    // bookkeeping around it.
+    const int64 row_bytes =
+        ev_->ValueLen() * static_cast<int64>(sizeof(V)) + kPerKeyOverheadBytes;
+    tuner_->RecordObservation(freq, row_bytes);
+    return tuner_->Threshold();
+  }
+
+  static constexpr int64 kPerKeyOverheadBytes = 64;
+
   EmbeddingConfig config_;
   embedding::StorageManager<K, V>* storage_manager_;
   EV* ev_;
+  std::unique_ptr<embedding::AdmissionThresholdTuner> tuner_;
 };
 
 template<typename K, typename V, typename EV>
@@ -478,8 +604,25 @@ class NullableFilter : public EmbeddingFilter<K, V, EV> {
                       ValuePtr<V>** value_ptr, int count,
                       const V* default_value_no_permission) override {
     TF_CHECK_OK(ev_->LookupOrCreateKey(key, value_ptr));
+    if (ev_->IsCompressedStorage()) {
+      ev_->LookupOrCreateEmb(*value_ptr, default_value_ptr);
+      ev_->DequantizeEmb(*value_ptr, val);
+      return;
+    }
+    if (LazyDefaultInitEnabled()) {
+      V* mem_val = ev_->LookupEmb(*value_ptr);
+      if (mem_val == nullptr) {
+        // Never-updated key: its row would be a verbatim copy of the
+        // default, so serve the shared row and defer the allocation to
+        // the first update.
+        embedding::CopyEmbRow(val, default_value_ptr, ev_->ValueLen());
+        return;
+      }
+      embedding::CopyEmbRow(val, mem_val, ev_->ValueLen());
+      return;
+    }
     V* mem_val = ev_->LookupOrCreateEmb(*value_ptr, default_value_ptr);
-    memcpy(val, mem_val, sizeof(V) * ev_->ValueLen());
+    embedding::CopyEmbRow(val, mem_val, ev_->ValueLen());
   }
 
   void CreateGPUBatch(V* val_base, V** default_values, int64 size,
@@ -491,9 +634,25 @@ class NullableFilter : public EmbeddingFilter<K, V, EV> {
     V** dev_default_address = (V**)ev_->GetBuffer2(size);
     bool* dev_init_flags = (bool*)ev_->GetBuffer3(size);
 
-    cudaMemcpy(dev_value_address, memcpy_address, sizeof(V *) * size, cudaMemcpyHostToDevice);
-    cudaMemcpy(dev_default_address, default_values, sizeof(V *) * size, cudaMemcpyHostToDevice);
-    cudaMemcpy(dev_init_flags, init_flags, sizeof(bool) * size, cudaMemcpyHostToDevice);
+    // Pack the three host arrays into one pinned staging buffer so all
+    // uploads run as async DMA instead of pageable synchronous copies.
+    embedding::PinnedStagingPool* staging_pool = ev_->StagingPool();
+    char* staging = (char*)staging_pool->Acquire(
+        2 * sizeof(V*) * size + sizeof(bool) * size);
+    V** staged_value_address = (V**)staging;
+    V** staged_default_address = (V**)(staging + sizeof(V*) * size);
+    bool* staged_init_flags = (bool*)(staging + 2 * sizeof(V*) * size);
+    memcpy(staged_value_address, memcpy_address, sizeof(V*) * size);
+    memcpy(staged_default_address, default_values, sizeof(V*) * size);
+    memcpy(staged_init_flags, init_flags, sizeof(bool) * size);
+
+    cudaMemcpyAsync(dev_value_address, staged_value_address,
+                    sizeof(V *) * size, cudaMemcpyHostToDevice, NULL);
+    cudaMemcpyAsync(dev_default_address, staged_default_address,
+                    sizeof(V *) * size, cudaMemcpyHostToDevice, NULL);
+    cudaMemcpyAsync(dev_init_flags, staged_init_flags,
+                    sizeof(bool) * size, cudaMemcpyHostToDevice, NULL);
+    staging_pool->MarkCopyIssued(staging, NULL);
 
     int limit = size;
     int length = value_len;
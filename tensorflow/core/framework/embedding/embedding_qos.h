@@ -0,0 +1,250 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_EMBEDDING_QOS_H_
+#define TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_EMBEDDING_QOS_H_
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/lib/strings/numbers.h"
+#include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+
+namespace tensorflow {
+namespace embedding {
+
+// How strictly a table's callers are held to its token bucket.
+//   kHigh   never waits: it runs the bucket into debt and lower classes
+//           wait the debt out, so a latency-critical tenant keeps its
+//           p99 while a misbehaving one backs off.
+//   kNormal waits for tokens but never longer than a bounded cap, then
+//           proceeds in debt.
+//   kLow    waits until tokens are available.
+enum class QosPriority { kHigh, kNormal, kLow };
+
+// Token bucket guarding one embedding table. Tokens are keys: a lookup
+// or update of N ids costs N tokens, so the limit tracks actual traffic
+// rather than op counts. Burst capacity is one second of rate, and debt
+// is clamped to the same amount so a high-priority spike cannot starve
+// the bucket forever.
+class TableQosBucket {
+ public:
+  TableQosBucket(double keys_per_sec, QosPriority priority)
+      : keys_per_sec_(keys_per_sec),
+        burst_(keys_per_sec),
+        tokens_(keys_per_sec),
+        priority_(priority),
+        last_refill_ns_(Env::Default()->NowNanos()) {}
+
+  // Blocks (per the priority class policy) until `num_keys` tokens are
+  // taken. Safe to call from any number of threads.
+  void Acquire(int64 num_keys) {
+    if (keys_per_sec_ <= 0) return;
+    // Callers parked here are the table's queue depth.
+    queue_depth_.fetch_add(1, std::memory_order_relaxed);
+    int64 waited_us = 0;
+    while (true) {
+      int64 sleep_us = 0;
+      {
+        mutex_lock l(mu_);
+        Refill();
+        if (tokens_ >= num_keys || priority_ == QosPriority::kHigh) {
+          tokens_ -= num_keys;
+          if (tokens_ < -burst_) tokens_ = -burst_;
+          break;
+        }
+        sleep_us =
+            static_cast<int64>((num_keys - tokens_) / keys_per_sec_ * 1e6) + 1;
+      }
+      if (priority_ == QosPriority::kNormal &&
+          waited_us + sleep_us > kNormalWaitCapMicros) {
+        // Bounded wait exhausted: proceed in debt rather than stalling
+        // a normal-priority tenant indefinitely.
+        const int64 remaining = kNormalWaitCapMicros - waited_us;
+        if (remaining > 0) {
+          Env::Default()->SleepForMicroseconds(remaining);
+          waited_us += remaining;
+        }
+        mutex_lock l(mu_);
+        Refill();
+        tokens_ -= num_keys;
+        if (tokens_ < -burst_) tokens_ = -burst_;
+        break;
+      }
+      if (sleep_us > kMaxSleepSliceMicros) sleep_us = kMaxSleepSliceMicros;
+      Env::Default()->SleepForMicroseconds(sleep_us);
+      waited_us += sleep_us;
+    }
+    queue_depth_.fetch_sub(1, std::memory_order_relaxed);
+    admitted_keys_.fetch_add(num_keys, std::memory_order_relaxed);
+    if (waited_us > 0) {
+      throttled_requests_.fetch_add(1, std::memory_order_relaxed);
+      throttled_micros_.fetch_add(waited_us, std::memory_order_relaxed);
+    }
+  }
+
+  int64 QueueDepth() const {
+    return queue_depth_.load(std::memory_order_relaxed);
+  }
+
+  string DebugString(const string& table) const {
+    return strings::StrCat(
+        "EV QoS table=", table, " rate=", keys_per_sec_,
+        " keys/s queue_depth=", QueueDepth(),
+        " admitted_keys=", admitted_keys_.load(std::memory_order_relaxed),
+        " throttled_requests=",
+        throttled_requests_.load(std::memory_order_relaxed),
+        " throttled_ms=",
+        throttled_micros_.load(std::memory_order_relaxed) / 1000);
+  }
+
+ private:
+  void Refill() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    const uint64 now_ns = Env::Default()->NowNanos();
+    tokens_ += (now_ns - last_refill_ns_) * keys_per_sec_ * 1e-9;
+    if (tokens_ > burst_) tokens_ = burst_;
+    last_refill_ns_ = now_ns;
+  }
+
+  // Waiters re-check at most this often so a refill is never missed by
+  // much, even with a tiny rate.
+  static constexpr int64 kMaxSleepSliceMicros = 5 * 1000;
+  static constexpr int64 kNormalWaitCapMicros = 50 * 1000;
+
+  const double keys_per_sec_;
+  const double burst_;
+  mutex mu_;
+  double tokens_ GUARDED_BY(mu_);
+  const QosPriority priority_;
+  uint64 last_refill_ns_ GUARDED_BY(mu_);
+  std::atomic<int64> queue_depth_{0};
+  std::atomic<int64> admitted_keys_{0};
+  std::atomic<int64> throttled_requests_{0};
+  std::atomic<int64> throttled_micros_{0};
+};
+
+// Process-wide rule table mapping embedding variable names to QoS
+// buckets. Rules come from TF_EV_QOS_LIMITS, a comma separated list of
+//   <name_substr>=<keys_per_sec>[:high|normal|low]
+// entries matched by substring (first match wins) so one rule covers
+// the per-part shards of a partitioned table. The default class is
+// normal. TF_EV_QOS_STATS_INTERVAL_SEC > 0 arms a thread that logs each
+// active bucket's queue depth and throttle counters periodically.
+class EmbeddingQosRegistry {
+ public:
+  static EmbeddingQosRegistry* GetInstance() {
+    static EmbeddingQosRegistry* registry = new EmbeddingQosRegistry;
+    return registry;
+  }
+
+  // Returns the bucket guarding `table`, or nullptr when no rule
+  // matches. Buckets live for the process lifetime, so callers may
+  // cache the pointer.
+  TableQosBucket* Lookup(const string& table) {
+    if (rules_.empty()) return nullptr;
+    mutex_lock l(mu_);
+    auto iter = buckets_.find(table);
+    if (iter != buckets_.end()) {
+      return iter->second.get();
+    }
+    std::unique_ptr<TableQosBucket>& bucket = buckets_[table];
+    for (const Rule& rule : rules_) {
+      if (table.find(rule.name_substr) != string::npos) {
+        bucket.reset(new TableQosBucket(rule.keys_per_sec, rule.priority));
+        break;
+      }
+    }
+    return bucket.get();
+  }
+
+ private:
+  struct Rule {
+    string name_substr;
+    double keys_per_sec;
+    QosPriority priority;
+  };
+
+  EmbeddingQosRegistry() {
+    const char* limits = std::getenv("TF_EV_QOS_LIMITS");
+    if (limits != nullptr) {
+      for (const string& entry : str_util::Split(limits, ',')) {
+        std::vector<string> name_and_spec = str_util::Split(entry, '=');
+        if (name_and_spec.size() != 2 || name_and_spec[0].empty()) {
+          LOG(WARNING) << "Ignoring malformed TF_EV_QOS_LIMITS entry: "
+                       << entry;
+          continue;
+        }
+        std::vector<string> spec = str_util::Split(name_and_spec[1], ':');
+        double keys_per_sec = 0;
+        if (spec.empty() ||
+            !strings::safe_strtod(spec[0].c_str(), &keys_per_sec)) {
+          LOG(WARNING) << "Ignoring malformed TF_EV_QOS_LIMITS entry: "
+                       << entry;
+          continue;
+        }
+        QosPriority priority = QosPriority::kNormal;
+        if (spec.size() > 1) {
+          if (spec[1] == "high") {
+            priority = QosPriority::kHigh;
+          } else if (spec[1] == "low") {
+            priority = QosPriority::kLow;
+          } else if (spec[1] != "normal") {
+            LOG(WARNING) << "Unknown QoS class '" << spec[1] << "' in entry: "
+                         << entry << ", using normal";
+          }
+        }
+        rules_.push_back(Rule{name_and_spec[0], keys_per_sec, priority});
+      }
+    }
+    int64 interval_sec = 0;
+    const char* interval = std::getenv("TF_EV_QOS_STATS_INTERVAL_SEC");
+    if (interval != nullptr) {
+      strings::safe_strto64(interval, &interval_sec);
+    }
+    if (!rules_.empty() && interval_sec > 0) {
+      stats_thread_.reset(Env::Default()->StartThread(
+          ThreadOptions(), "ev_qos_stats", [this, interval_sec]() {
+            while (true) {
+              Env::Default()->SleepForMicroseconds(interval_sec * 1000000);
+              mutex_lock l(mu_);
+              for (const auto& it : buckets_) {
+                if (it.second != nullptr) {
+                  LOG(INFO) << it.second->DebugString(it.first);
+                }
+              }
+            }
+          }));
+    }
+  }
+
+  // Parsed once at startup, read-only afterwards.
+  std::vector<Rule> rules_;
+  mutex mu_;
+  // Memoized name -> bucket resolution; a nullptr entry records that no
+  // rule matched.
+  std::map<string, std::unique_ptr<TableQosBucket>> buckets_ GUARDED_BY(mu_);
+  std::unique_ptr<Thread> stats_thread_;
+};
+
+}  // namespace embedding
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_EMBEDDING_QOS_H_
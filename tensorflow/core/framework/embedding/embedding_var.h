@@ -21,13 +21,20 @@ limitations under the License.
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/io/path.h"
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/types.h"
 
 #include "tensorflow/core/framework/embedding/cache.h"
+#include "tensorflow/core/framework/embedding/count_min_sketch.h"
+#include "tensorflow/core/framework/embedding/dirty_key_set.h"
+#include "tensorflow/core/framework/embedding/gpu_hot_key_cache.h"
+#include "tensorflow/core/framework/embedding/pinned_staging_pool.h"
+#include "tensorflow/core/framework/embedding/simd_copy.h"
 #include "tensorflow/core/framework/embedding/value_ptr.h"
 #include "tensorflow/core/framework/embedding/embedding_filter.h"
 #include "tensorflow/core/framework/embedding/embedding_config.h"
@@ -50,16 +57,35 @@ class EmbeddingVar : public ResourceBase {
       alloc_(alloc),
       emb_config_(emb_cfg) {
         if (IsMultiLevel() || emb_config_.record_freq) {
-          add_freq_fn_ = [](ValuePtr<V>* value_ptr, int freq, int64 filter_freq) {
+          add_freq_fn_ = [](K key, ValuePtr<V>* value_ptr, int freq,
+                            int64 filter_freq) {
             value_ptr->AddFreq(freq);
           };
         } else if (emb_config_.is_counter_filter()) {
-          add_freq_fn_ = [](ValuePtr<V>* value_ptr, int freq, int64 filter_freq) {
-            if (value_ptr->GetFreq() < filter_freq)
-              value_ptr->AddFreq(freq);
-          };
+          const char* use_sketch = std::getenv("TF_EMBEDDING_FREQ_SKETCH");
+          if (use_sketch != nullptr && use_sketch[0] == '1') {
+            freq_sketch_ = new embedding::CountMinSketch<K>();
+            add_freq_fn_ = [this](K key, ValuePtr<V>* value_ptr, int freq,
+                                  int64 filter_freq) {
+              freq_sketch_->AddFreq(key, freq);
+            };
+          } else {
+            add_freq_fn_ = [this](K key, ValuePtr<V>* value_ptr, int freq,
+                              int64 filter_freq) {
+              // Counting normally stops once a key is admitted; with
+              // adaptive dims armed it continues up to the promotion
+              // threshold so a short-bucket key can still graduate.
+              int64 cap = filter_freq;
+              if (adaptive_dim_promote_freq_ > cap) {
+                cap = adaptive_dim_promote_freq_;
+              }
+              if (value_ptr->GetFreq() < cap)
+                value_ptr->AddFreq(freq);
+            };
+          }
         } else {
-          add_freq_fn_ = [](ValuePtr<V>* value_ptr, int freq, int64 filter_freq) {};
+          add_freq_fn_ = [](K key, ValuePtr<V>* value_ptr, int freq,
+                            int64 filter_freq) {};
         }
         if (emb_config_.steps_to_live != 0 || emb_config_.record_version) {
           update_version_fn_ = [](ValuePtr<V>* value_ptr, int64 gs) {
@@ -68,6 +94,10 @@ class EmbeddingVar : public ResourceBase {
         } else {
           update_version_fn_ = [](ValuePtr<V>* value_ptr, int64 gs) {};
         }
+        const char* delta_export = std::getenv("TF_EV_DELTA_EXPORT");
+        if (delta_export != nullptr && delta_export[0] == '1') {
+          dirty_set_ = new embedding::DirtyKeySet<K>();
+        }
       }
 
   Status Init(const Tensor& default_tensor, int64 default_value_dim) {
@@ -89,7 +119,15 @@ class EmbeddingVar : public ResourceBase {
         buffer1_size = 0;
         buffer2_size = 0;
         buffer3_size = 0;
+        staging_pool_ = new embedding::PinnedStagingPool();
         cudaMemcpy(default_value_, &default_tensor_flat(0), default_tensor.TotalBytes(), cudaMemcpyHostToDevice);
+        const char* gpu_cache_env = std::getenv("TF_EV_GPU_HOT_KEY_CACHE_SIZE");
+        if (gpu_cache_env != nullptr && atoll(gpu_cache_env) > 0) {
+          gpu_cache_ = new embedding::GPUHotKeyCache<K, V>(
+              atoll(gpu_cache_env), value_len_);
+          LOG(INFO) << "EV enables GPU hot key cache, capacity:"
+                    << gpu_cache_->Capacity();
+        }
 #endif  // TENSORFLOW_USE_GPU_EV
 #endif  // GOOGLE_CUDA
       } else {
@@ -105,6 +143,56 @@ class EmbeddingVar : public ResourceBase {
           default_value_no_permission_[i] = static_cast<V>(emb_config_.default_value_no_permission);
         }
       }
+      // Compact optimizer state: a slot column keeps one group-shared
+      // scalar per row instead of a full value_len_ row, shrinking
+      // Adagrad-like accumulators to 1/value_len of their size. Only the
+      // pointer-per-column layouts can allocate a column at its own
+      // length; the contiguous layouts precompute full-row offsets.
+      // Opt-in via TF_EMBEDDING_COMPACT_OPT_STATE=1 because it changes
+      // the update rule applied by the sparse-apply kernels and the
+      // slot shape stored in checkpoints. Only the CPU Adagrad kernel
+      // implements the row-wise rule; the other sparse-apply kernels
+      // reject compact slots.
+      if (!emb_config_.is_primary() &&
+          embedding::StorageType::HBM_DRAM !=
+              storage_manager_->GetStorageType() &&
+          (LayoutType::LIGHT == storage_manager_->GetLayoutType() ||
+           LayoutType::NORMAL == storage_manager_->GetLayoutType())) {
+        const char* compact_env = std::getenv("TF_EMBEDDING_COMPACT_OPT_STATE");
+        if (compact_env != nullptr && compact_env[0] == '1') {
+          compact_opt_state_ = true;
+          value_len_ = 1;
+        }
+      }
+      // Frequency-adaptive dimensions: a key that has not crossed the
+      // promotion frequency keeps only the first
+      // TF_EV_ADAPTIVE_DIM_SHORT_LEN elements of its rows; the gather
+      // zero-pads the tail back to the model dim and the CPU Adagrad
+      // kernel updates just the stored prefix (the adjoint of that
+      // padding); the other sparse-apply kernels reject adaptive
+      // tables. A key whose counter reaches
+      // TF_EV_ADAPTIVE_DIM_PROMOTE_FREQ (default 10x filter_freq) is
+      // reallocated at full length in place. Needs the counter filter
+      // for the frequencies and the pointer-per-column "normal" layout
+      // so a row can be sized per key; L2 shrink reads full rows, so
+      // the two features do not combine.
+      if (emb_config_.is_counter_filter() && !compact_opt_state_ &&
+          LayoutType::NORMAL == storage_manager_->GetLayoutType() &&
+          !IsMultiLevel() &&
+          emb_config_.l2_weight_threshold == -1.0) {
+        const char* short_env = std::getenv("TF_EV_ADAPTIVE_DIM_SHORT_LEN");
+        int64 short_len = (short_env == nullptr) ? 0 : atoll(short_env);
+        if (short_len > 0 && short_len < value_len_) {
+          adaptive_dim_short_len_ = short_len;
+          const char* promote_env =
+              std::getenv("TF_EV_ADAPTIVE_DIM_PROMOTE_FREQ");
+          adaptive_dim_promote_freq_ = (promote_env == nullptr) ?
+              emb_config_.filter_freq * 10 : atoll(promote_env);
+          LOG(INFO) << "EV " << name_ << " enables adaptive dims, short len:"
+                    << adaptive_dim_short_len_ << ", promote freq:"
+                    << adaptive_dim_promote_freq_;
+        }
+      }
       if (LayoutType::NORMAL_CONTIGUOUS == storage_manager_->GetLayoutType()) {
         storage_manager_->SetAllocLen(value_len_, emb_config_.slot_num + 1);
       }
@@ -126,6 +214,9 @@ class EmbeddingVar : public ResourceBase {
   }
 
   Status LookupOrCreateKey(K key, ValuePtr<V>** value_ptr, bool* is_filter) {
+    if (dirty_set_ != nullptr) {
+      dirty_set_->Record(key);
+    }
     return filter_->LookupOrCreateKey(key, value_ptr, is_filter);
   }
 
@@ -163,17 +254,87 @@ class EmbeddingVar : public ResourceBase {
     return filter_->GetFreq(key);
   }
 
+  embedding::CountMinSketch<K>* FreqSketch() {
+    return freq_sketch_;
+  }
+
+  bool IsDeltaExportEnabled() const {
+    return dirty_set_ != nullptr;
+  }
+
+  // Emits only the keys updated since the last call. Falls back to a
+  // full snapshot when a dirty-set ring overflowed, so the delta is
+  // never missing an update. Keys that were filtered or evicted after
+  // being recorded are skipped.
+  int64 GetDeltaSnapshot(std::vector<K>* key_list, std::vector<V*>* value_list,
+                         std::vector<int64>* version_list,
+                         std::vector<int64>* freq_list) {
+    std::vector<K> dirty_keys;
+    if (!dirty_set_->Drain(&dirty_keys)) {
+      LOG(WARNING) << "Dirty set of EmbeddingVar " << name_
+                   << " overflowed, falling back to full export.";
+      embedding::Iterator* it = nullptr;
+      return GetSnapshot(key_list, value_list, version_list, freq_list, &it);
+    }
+    bool record_version =
+        emb_config_.steps_to_live != 0 || emb_config_.record_version;
+    bool record_freq = emb_config_.filter_freq != 0 || IsMultiLevel() ||
+                       emb_config_.record_freq;
+    for (auto key : dirty_keys) {
+      ValuePtr<V>* value_ptr = nullptr;
+      if (!LookupKey(key, &value_ptr).ok()) {
+        continue;
+      }
+      V* val = value_ptr->GetValue(emb_config_.emb_index,
+          storage_manager_->GetOffset(emb_config_.emb_index));
+      if (val == nullptr) {
+        continue;
+      }
+      key_list->push_back(key);
+      value_list->push_back(val);
+      if (record_version) {
+        version_list->push_back(value_ptr->GetStep());
+      }
+      if (record_freq) {
+        freq_list->push_back(filter_->GetFreq(key, value_ptr));
+      }
+    }
+    return key_list->size();
+  }
+
   void Lookup(K key, V* val, V* default_v)  {
     const V* default_value_ptr = (default_v == nullptr) ? default_value_ : default_v;
     filter_->Lookup(this, key, val, default_value_ptr, default_value_no_permission_);
   }
 
+  // Batched read-only lookup over a contiguous run of keys: one storage
+  // probe for the whole run instead of a tier walk per key. Like the
+  // per-key Lookup above this never creates a key or promotes a
+  // lower-tier hit, so it is only correct on the inference path.
+  void BatchLookup(const K* keys, V* val_base, int64 n, V* default_v) {
+    const V* default_value_ptr =
+        (default_v == nullptr) ? default_value_ : default_v;
+    std::vector<ValuePtr<V>*> value_ptrs(n, nullptr);
+    Status s = storage_manager_->BatchGet(keys, n, value_ptrs.data());
+    if (!s.ok()) {
+      for (int64 i = 0; i < n; ++i) {
+        Lookup(keys[i], val_base + i * value_len_, default_v);
+      }
+      return;
+    }
+    for (int64 i = 0; i < n; ++i) {
+      filter_->LookupResolved(this, keys[i], value_ptrs[i],
+          val_base + i * value_len_, default_value_ptr,
+          default_value_no_permission_);
+    }
+  }
+
   void LookupOrCreate(K key, V* val, V* default_v, int count = 1)  {
     const V* default_value_ptr = (default_v == nullptr) ? default_value_ : default_v;
     ValuePtr<V>* value_ptr = nullptr;
     filter_->LookupOrCreate(key, val, default_value_ptr, &value_ptr, count,
                             default_value_no_permission_);
-    add_freq_fn_(value_ptr, count, emb_config_.filter_freq);
+    add_freq_fn_(key, value_ptr, count, emb_config_.filter_freq);
   }
 
   void LookupWithFreqBatch(K* keys, bool *init_flags, bool *copyback_flags, V** memcpy_address, int start, int limit) {
@@ -196,6 +357,14 @@ class EmbeddingVar : public ResourceBase {
 
 #if GOOGLE_CUDA
 #if !TENSORFLOW_USE_GPU_EV
+  embedding::GPUHotKeyCache<K, V>* GPUCache() {
+    return gpu_cache_;
+  }
+
+  embedding::PinnedStagingPool* StagingPool() {
+    return staging_pool_;
+  }
+
   void CreateGPUBatch(V* val_base, V** default_values, int64 size, int64 slice_elems, bool* init_flags, V** memcpy_address) {
     for (int i = 0;i < size;i++) {
       default_values[i] = (default_values[i] == nullptr) ? default_value_ : default_values[i];
@@ -217,9 +386,9 @@ class EmbeddingVar : public ResourceBase {
     ValuePtr<V>** gpu_value_ptrs = new ValuePtr<V>* [total];
     cudaMalloc(&memcpy_buffer_gpu, total * value_len * sizeof(V));
 
-    storage_manager_->CopyBackToGPU(total, keys, size, copyback_flags, memcpy_address, value_len, copyback_cursor, gpu_value_ptrs, memcpy_buffer_gpu);
+    storage_manager_->CopyBackToGPU(total, keys, size, copyback_flags, memcpy_address, value_len, copyback_cursor, gpu_value_ptrs, memcpy_buffer_gpu, staging_pool_);
 
-    value_address = (V**)malloc(sizeof(V*) * total);
+    value_address = (V**)staging_pool_->Acquire(sizeof(V*) * total);
     cudaMalloc(&dev_value_address, sizeof(V*) * total);
 
     for (int i = 0;i < total;i++) {
@@ -228,7 +397,8 @@ class EmbeddingVar : public ResourceBase {
       value_address[i] = memcpy_address[copyback_cursor[i]];
     }
 
-    cudaMemcpy(dev_value_address, value_address, sizeof(V*) * total, cudaMemcpyHostToDevice);
+    cudaMemcpyAsync(dev_value_address, value_address, sizeof(V*) * total, cudaMemcpyHostToDevice, NULL);
+    staging_pool_->MarkCopyIssued(value_address, NULL);
     int block_dim = 128;
     void* args[] = { (void*)&dev_value_address, (void*)&memcpy_buffer_gpu, (void*)&value_len, (void*)&total};
 
@@ -253,15 +423,105 @@ class EmbeddingVar : public ResourceBase {
         emb_config_.emb_index, storage_manager_->GetOffset(emb_config_.emb_index), need_initialize);
   }
 
+  bool IsCompressedStorage() {
+    return storage_manager_->GetLayoutType() == LayoutType::COMPRESSED;
+  }
+
+  // True when this key's weight and all optimizer slots live in one
+  // contiguous allocation, so an apply kernel can stream them in a
+  // single fused pass.
+  bool IsContiguousLayout() {
+    return storage_manager_->GetLayoutType() == LayoutType::NORMAL_CONTIGUOUS;
+  }
+
+  // True when this slot column stores one group-shared scalar per row;
+  // flat() then yields a length-1 view and the apply kernels must use
+  // the row-wise update rule.
+  bool IsCompactOptState() const {
+    return compact_opt_state_;
+  }
+
+  // True when this variable keeps short rows for low-frequency keys and
+  // pads them back to the model dim on gather.
+  bool IsAdaptiveDim() const {
+    return adaptive_dim_short_len_ > 0;
+  }
+
+  // Stored length of this key's rows: the short-bucket length for a
+  // demoted key, value_len_ for everyone else.
+  int64 EffectiveValueLen(ValuePtr<V>* value_ptr) {
+    if (adaptive_dim_short_len_ > 0 && value_ptr->GetDimBucket() != 0) {
+      return adaptive_dim_short_len_;
+    }
+    return value_len_;
+  }
+
+  // Gather copy-out: streams the stored row and zero-pads past the
+  // prefix of a short-bucket key, so the output is always value_len_.
+  void CopyOutEmb(ValuePtr<V>* value_ptr, const V* mem_val, V* val) {
+    const int64 len = EffectiveValueLen(value_ptr);
+    embedding::CopyEmbRow(val, mem_val, len);
+    if (len < value_len_) {
+      memset(val + len, 0, sizeof(V) * (value_len_ - len));
+    }
+  }
+
+  // Bucket-aware LookupOrCreateEmb. The first materialization of the
+  // primary column pins the key's bucket from its current frequency; a
+  // short key that has since crossed the promotion threshold is
+  // reallocated at full length before the row is handed out.
+  V* LookupOrCreateAdaptiveEmb(ValuePtr<V>* value_ptr, const V* default_v,
+                               int64 freq) {
+    if (!IsAdaptiveDim()) {
+      return LookupOrCreateEmb(value_ptr, default_v);
+    }
+    if (emb_config_.is_primary()) {
+      if (LookupEmb(value_ptr) == nullptr) {
+        if (freq < adaptive_dim_promote_freq_) {
+          value_ptr->SetDimBucket(kShortDimBucket);
+        }
+      } else if (value_ptr->GetDimBucket() != 0 &&
+                 freq >= adaptive_dim_promote_freq_) {
+        PromoteDimBucket(value_ptr, default_v);
+      }
+    }
+    return value_ptr->GetOrAllocate(alloc_, EffectiveValueLen(value_ptr),
+        default_v, emb_config_.emb_index,
+        storage_manager_->GetOffset(emb_config_.emb_index));
+  }
+
+  void DequantizeEmb(ValuePtr<V>* value_ptr, V* val) {
+    ((CompressedValuePtr<V>*)value_ptr)->Dequantize(
+        storage_manager_->GetOffset(emb_config_.emb_index), value_len_, val);
+  }
+
+  void DequantizePrimaryEmb(ValuePtr<V>* value_ptr, V* val) {
+    ((CompressedValuePtr<V>*)value_ptr)->Dequantize(
+        storage_manager_->GetOffset(emb_config_.primary_emb_index),
+        value_len_, val);
+  }
+
+  // Returns the private row for this variable's slot, or nullptr if the
+  // key has never been materialized (lazy default init leaves new keys
+  // without a row until the first update).
+  V* LookupEmb(ValuePtr<V>* value_ptr) {
+    return value_ptr->GetValue(emb_config_.emb_index,
+                               storage_manager_->GetOffset(emb_config_.emb_index));
+  }
+
   V* LookupPrimaryEmb(ValuePtr<V>* value_ptr) {
     V* primary_val = value_ptr->GetValue(emb_config_.primary_emb_index,
                                  storage_manager_->GetOffset(emb_config_.primary_emb_index));
     return primary_val;
   }
 
+  // The view length follows the key's dim bucket; apply kernels must
+  // size their updates from the view, not from the gradient width.
   typename TTypes<V>::Flat flat(ValuePtr<V>* value_ptr) {
-    V* val = LookupOrCreateEmb(value_ptr, default_value_);
-    Eigen::array<Eigen::DenseIndex, 1> dims({value_len_});
+    const int64 len = EffectiveValueLen(value_ptr);
+    V* val = value_ptr->GetOrAllocate(alloc_, len, default_value_,
+        emb_config_.emb_index, storage_manager_->GetOffset(emb_config_.emb_index));
+    Eigen::array<Eigen::DenseIndex, 1> dims({len});
     return typename TTypes<V>::Flat(val, dims);
   }
 
@@ -273,6 +533,10 @@ class EmbeddingVar : public ResourceBase {
     return value_len_;
   }
 
+  std::string Name() const {
+    return name_;
+  }
+
   int64 Size() const {
     return storage_manager_->Size();
   }
@@ -281,6 +545,10 @@ class EmbeddingVar : public ResourceBase {
     return storage_manager_->CacheSize();
   }
 
+  int64 MemoryUsage() const {
+    return storage_manager_->MemoryUsage();
+  }
+
   int64 MinFreq() {
     return emb_config_.filter_freq;
   }
@@ -317,13 +585,54 @@ class EmbeddingVar : public ResourceBase {
     return filter_;
   }
 
+  Status Reserve(int64 num_keys) {
+    return storage_manager_->Reserve(num_keys);
+  }
+
   Status Import(RestoreBuffer& restore_buff,
                 int64 key_num,
                 int bucket_num,
                 int64 partition_id,
                 int64 partition_num,
                 bool is_filter) {
-    return filter_->Import(restore_buff, key_num, bucket_num, partition_id, partition_num, is_filter);
+    int num_threads = ImportThreadNum();
+    if (num_threads <= 1 || key_num < kMinKeysPerImportThread * 2) {
+      return filter_->Import(restore_buff, key_num, bucket_num, partition_id,
+                             partition_num, is_filter);
+    }
+    // The backing hash map is lockless, so contiguous slices of the
+    // restore buffer can be imported concurrently.
+    thread::ThreadPool pool(Env::Default(), ThreadOptions(), "ev_bulk_import",
+                            num_threads, /*low_latency_hint=*/false);
+    BlockingCounter counter(num_threads);
+    int64 chunk_size = (key_num + num_threads - 1) / num_threads;
+    for (int t = 0; t < num_threads; ++t) {
+      int64 start = t * chunk_size;
+      int64 end = std::min(key_num, start + chunk_size);
+      pool.Schedule([this, &restore_buff, &counter, start, end, bucket_num,
+                     partition_id, partition_num, is_filter]() {
+        if (start < end) {
+          RestoreBuffer sub_buff;
+          sub_buff.key_buffer = restore_buff.key_buffer + start * sizeof(K);
+          sub_buff.value_buffer =
+              restore_buff.value_buffer + start * value_len_ * sizeof(V);
+          sub_buff.version_buffer =
+              restore_buff.version_buffer + start * sizeof(int64);
+          sub_buff.freq_buffer =
+              restore_buff.freq_buffer + start * sizeof(int64);
+          TF_CHECK_OK(filter_->Import(sub_buff, end - start, bucket_num,
+                                      partition_id, partition_num, is_filter));
+          // The views alias restore_buff; keep the destructor away.
+          sub_buff.key_buffer = nullptr;
+          sub_buff.value_buffer = nullptr;
+          sub_buff.version_buffer = nullptr;
+          sub_buff.freq_buffer = nullptr;
+        }
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+    return Status::OK();
   }
 
   int64 GetSnapshot(std::vector<K>* key_list, std::vector<V* >* value_list,
@@ -333,8 +642,13 @@ class EmbeddingVar : public ResourceBase {
     // TODO Multi-tiered Embedding should use iterator in 'GetSnapshot' caller
     embedding::Iterator* _it = nullptr;
     it = (it == nullptr) ? &_it : it;
-    return storage_manager_->GetSnapshot(key_list, value_list, version_list,
-                                         freq_list, emb_config_, filter_, it);
+    int64 num = storage_manager_->GetSnapshot(key_list, value_list,
+                                              version_list, freq_list,
+                                              emb_config_, filter_, it);
+    if (IsAdaptiveDim()) {
+      PadShortRowsForExport(*key_list, value_list);
+    }
+    return num;
   }
 
   Status Destroy() {
@@ -355,7 +669,7 @@ class EmbeddingVar : public ResourceBase {
 
   Status Shrink(int64 gs) {
     if (emb_config_.steps_to_live > 0) {
-      return storage_manager_->Shrink(gs, emb_config_.steps_to_live);
+      return storage_manager_->ShrinkAsync(gs, emb_config_.steps_to_live);
     }
   }
 
@@ -434,6 +748,59 @@ class EmbeddingVar : public ResourceBase {
   }
 
  private:
+  // Moves a key to the full-dim bucket: every materialized column is
+  // reallocated at value_len_ with a zeroed tail (the right restart for
+  // the optimizer slots), then the weight tail restarts from the
+  // initializer row. The short rows are parked until teardown because a
+  // concurrent gather may still be streaming out of them; the cost is
+  // short_len elements per promoted key.
+  void PromoteDimBucket(ValuePtr<V>* value_ptr, const V* default_v) {
+    std::vector<V*> retired;
+    value_ptr->PromoteColumns(alloc_, adaptive_dim_short_len_, value_len_,
+                              &retired);
+    V* primary = LookupPrimaryEmb(value_ptr);
+    if (primary != nullptr) {
+      memcpy(primary + adaptive_dim_short_len_,
+             default_v + adaptive_dim_short_len_,
+             sizeof(V) * (value_len_ - adaptive_dim_short_len_));
+    }
+    mutex_lock l(mu_);
+    retired_rows_.insert(retired_rows_.end(), retired.begin(), retired.end());
+  }
+
+  // Checkpoints always store full-length rows, so restore never has to
+  // know about buckets. Short rows are copied into an arena and
+  // zero-padded; the arena lives until the next snapshot because the
+  // caller keeps the raw pointers.
+  void PadShortRowsForExport(const std::vector<K>& key_list,
+                             std::vector<V*>* value_list) {
+    snapshot_pad_arena_.clear();
+    for (size_t i = 0; i < key_list.size(); ++i) {
+      ValuePtr<V>* value_ptr = nullptr;
+      if (!LookupKey(key_list[i], &value_ptr).ok() ||
+          value_ptr->GetDimBucket() == 0) {
+        continue;
+      }
+      std::unique_ptr<V[]> padded(new V[value_len_]);
+      memcpy(padded.get(), (*value_list)[i],
+             sizeof(V) * adaptive_dim_short_len_);
+      memset(padded.get() + adaptive_dim_short_len_, 0,
+             sizeof(V) * (value_len_ - adaptive_dim_short_len_));
+      (*value_list)[i] = padded.get();
+      snapshot_pad_arena_.push_back(std::move(padded));
+    }
+  }
+
+  static int ImportThreadNum() {
+    const char* env = std::getenv("TF_EV_IMPORT_THREAD_NUM");
+    if (env == nullptr) {
+      return 1;
+    }
+    return atoi(env);
+  }
+
+  static const int64 kMinKeysPerImportThread = 4096;
+
   std::string name_;
   bool is_initialized_ = false;
 
@@ -444,12 +811,26 @@ class EmbeddingVar : public ResourceBase {
   V **buffer1, **buffer2, **buffer3;
   int64 buffer1_size, buffer2_size, buffer3_size;
   int64 value_len_;
+  bool compact_opt_state_ = false;
+  static constexpr int kShortDimBucket = 1;
+  int64 adaptive_dim_short_len_ = 0;
+  int64 adaptive_dim_promote_freq_ = 0;
+  std::vector<V*> retired_rows_ GUARDED_BY(mu_);
+  std::vector<std::unique_ptr<V[]>> snapshot_pad_arena_;
   Allocator* alloc_;
   embedding::StorageManager<K, V>* storage_manager_;
   EmbeddingConfig emb_config_;
   EmbeddingFilter<K, V, EmbeddingVar<K, V>>* filter_;
-  std::function<void(ValuePtr<V>*, int, int64)> add_freq_fn_;
+  std::function<void(K, ValuePtr<V>*, int, int64)> add_freq_fn_;
+  embedding::CountMinSketch<K>* freq_sketch_ = nullptr;
+  embedding::DirtyKeySet<K>* dirty_set_ = nullptr;
   std::function<void(ValuePtr<V>*, int64)> update_version_fn_;
+#if GOOGLE_CUDA
+#if !TENSORFLOW_USE_GPU_EV
+  embedding::GPUHotKeyCache<K, V>* gpu_cache_ = nullptr;
+  embedding::PinnedStagingPool* staging_pool_ = nullptr;
+#endif  // TENSORFLOW_USE_GPU_EV
+#endif  // GOOGLE_CUDA
 
   ~EmbeddingVar() override {
     // When dynamic dimension embedding is used, there will be more than one primary slot
@@ -457,7 +838,15 @@ class EmbeddingVar : public ResourceBase {
       Destroy();
       delete storage_manager_;
     }
+    delete freq_sketch_;
+    delete dirty_set_;
     if (embedding::StorageType::HBM_DRAM == storage_manager_->GetStorageType()) {
+#if GOOGLE_CUDA
+#if !TENSORFLOW_USE_GPU_EV
+      delete gpu_cache_;
+      delete staging_pool_;
+#endif  // TENSORFLOW_USE_GPU_EV
+#endif  // GOOGLE_CUDA
       buffer1_size = 0;
       buffer2_size = 0;
       buffer3_size = 0;
@@ -474,6 +863,9 @@ class EmbeddingVar : public ResourceBase {
         buffer3 = nullptr;
       }
     }
+    for (V* row : retired_rows_) {
+      alloc_->DeallocateRaw(row);
+    }
     TypedAllocator::Deallocate(alloc_, default_value_, value_len_);
     TypedAllocator::Deallocate(alloc_, default_value_no_permission_, value_len_);
   }
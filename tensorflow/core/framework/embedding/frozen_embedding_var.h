@@ -0,0 +1,256 @@
+/* Copyright 2022 The DeepRec Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_FROZEN_EMBEDDING_VAR_H_
+#define TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_FROZEN_EMBEDDING_VAR_H_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "tensorflow/core/framework/embedding/embedding_var.h"
+#include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// On-disk layout of a frozen EmbeddingVar, all little-endian:
+//
+//   FrozenEmbeddingHeader
+//   bucket offsets          uint64[num_buckets + 1]
+//   keys                    K[num_keys], grouped by bucket, sorted within
+//   padding to 64 bytes
+//   values                  V[num_keys * value_len], row i belongs to key i
+//
+// The whole file is mmap'd read-only at load, so serving keeps no mutable
+// hash map and process start does no per-key work; the page cache is
+// shared between processes serving the same model.
+struct FrozenEmbeddingHeader {
+  uint64 magic;
+  uint32 format_version;
+  uint32 key_bytes;
+  uint32 value_bytes;
+  uint32 value_len;
+  uint64 num_keys;
+  uint64 num_buckets;
+  uint64 values_offset;
+};
+
+constexpr uint64 kFrozenEmbeddingMagic = 0x3156454e455a5246ULL;  // "FRZEEV1"
+constexpr uint32 kFrozenEmbeddingVersion = 1;
+// Bucket fan-out is sized so an average bucket's key range spans a few
+// cache lines; the binary search within a bucket touches at most that.
+constexpr int64 kFrozenEmbeddingKeysPerBucket = 64;
+constexpr int64 kFrozenEmbeddingValueAlign = 64;
+
+// Read-only serving variant of EmbeddingVar: a two-level index (bucket
+// table over per-bucket sorted key runs) on top of an mmap'd contiguous
+// value region. Lookup() has the same contract as EmbeddingVar::Lookup:
+// missing keys are served from the default value.
+template <class K, class V>
+class FrozenEmbeddingVar : public ResourceBase {
+ public:
+  // Writes the frozen file for "ev" at "path". Takes the storage manager
+  // mutex, so rows are a consistent point-in-time snapshot. Filtered and
+  // forward-only keys are dropped: they have no trained value to serve.
+  static Status Freeze(EmbeddingVar<K, V>* ev, const string& path, Env* env) {
+    std::vector<K> key_list;
+    std::vector<V*> valueptr_list;
+    std::vector<int64> version_list;
+    std::vector<int64> freq_list;
+    embedding::Iterator* it = nullptr;
+    int64 value_len = ev->ValueLen();
+
+    mutex_lock l(*ev->storage_manager()->get_mutex());
+    ev->GetSnapshot(&key_list, &valueptr_list, &version_list, &freq_list, &it);
+
+    std::vector<std::pair<K, V*>> rows;
+    rows.reserve(key_list.size());
+    for (size_t i = 0; i < key_list.size(); ++i) {
+      V* valueptr = valueptr_list[i];
+      if (valueptr == nullptr || valueptr == reinterpret_cast<V*>(-1)) {
+        continue;
+      }
+      rows.emplace_back(key_list[i], valueptr);
+    }
+
+    const uint64 num_keys = rows.size();
+    const uint64 num_buckets =
+        std::max<uint64>(1, num_keys / kFrozenEmbeddingKeysPerBucket);
+    std::sort(rows.begin(), rows.end(),
+              [num_buckets](const std::pair<K, V*>& a,
+                            const std::pair<K, V*>& b) {
+                uint64 ba = BucketOf(a.first, num_buckets);
+                uint64 bb = BucketOf(b.first, num_buckets);
+                if (ba != bb) return ba < bb;
+                return a.first < b.first;
+              });
+
+    std::vector<uint64> bucket_offsets(num_buckets + 1, 0);
+    for (const auto& row : rows) {
+      ++bucket_offsets[BucketOf(row.first, num_buckets) + 1];
+    }
+    for (uint64 b = 0; b < num_buckets; ++b) {
+      bucket_offsets[b + 1] += bucket_offsets[b];
+    }
+
+    FrozenEmbeddingHeader header;
+    header.magic = kFrozenEmbeddingMagic;
+    header.format_version = kFrozenEmbeddingVersion;
+    header.key_bytes = sizeof(K);
+    header.value_bytes = sizeof(V);
+    header.value_len = value_len;
+    header.num_keys = num_keys;
+    header.num_buckets = num_buckets;
+    uint64 keys_end = sizeof(FrozenEmbeddingHeader) +
+                      (num_buckets + 1) * sizeof(uint64) +
+                      num_keys * sizeof(K);
+    header.values_offset =
+        (keys_end + kFrozenEmbeddingValueAlign - 1) /
+        kFrozenEmbeddingValueAlign * kFrozenEmbeddingValueAlign;
+
+    std::unique_ptr<WritableFile> file;
+    TF_RETURN_IF_ERROR(env->NewWritableFile(path, &file));
+    TF_RETURN_IF_ERROR(file->Append(StringPiece(
+        reinterpret_cast<const char*>(&header), sizeof(header))));
+    TF_RETURN_IF_ERROR(file->Append(StringPiece(
+        reinterpret_cast<const char*>(bucket_offsets.data()),
+        bucket_offsets.size() * sizeof(uint64))));
+    std::vector<K> keys(num_keys);
+    for (uint64 i = 0; i < num_keys; ++i) keys[i] = rows[i].first;
+    TF_RETURN_IF_ERROR(file->Append(StringPiece(
+        reinterpret_cast<const char*>(keys.data()), num_keys * sizeof(K))));
+    const string pad(header.values_offset - keys_end, '\0');
+    TF_RETURN_IF_ERROR(file->Append(pad));
+    for (uint64 i = 0; i < num_keys; ++i) {
+      TF_RETURN_IF_ERROR(file->Append(StringPiece(
+          reinterpret_cast<const char*>(rows[i].second),
+          value_len * sizeof(V))));
+    }
+    return file->Close();
+  }
+
+  // Maps the frozen file at "path". The mapping is shared and read-only.
+  static Status Load(const string& path, FrozenEmbeddingVar** out) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return errors::NotFound("Frozen embedding file not found: ", path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      close(fd);
+      return errors::Internal("fstat failed for ", path);
+    }
+    void* base =
+        mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+      return errors::Internal("mmap failed for ", path);
+    }
+    if (static_cast<size_t>(st.st_size) < sizeof(FrozenEmbeddingHeader)) {
+      munmap(base, st.st_size);
+      return errors::DataLoss(path, " is too small to be a frozen "
+                              "embedding file");
+    }
+    const FrozenEmbeddingHeader* header =
+        reinterpret_cast<const FrozenEmbeddingHeader*>(base);
+    if (header->magic != kFrozenEmbeddingMagic ||
+        header->format_version != kFrozenEmbeddingVersion ||
+        header->key_bytes != sizeof(K) ||
+        header->value_bytes != sizeof(V)) {
+      munmap(base, st.st_size);
+      return errors::DataLoss(path, " is not a frozen embedding file of "
+                              "the expected key/value types");
+    }
+    uint64 expected_size =
+        header->values_offset +
+        header->num_keys * header->value_len * sizeof(V);
+    if (static_cast<uint64>(st.st_size) < expected_size) {
+      munmap(base, st.st_size);
+      return errors::DataLoss(path, " is truncated");
+    }
+    *out = new FrozenEmbeddingVar(path, base, st.st_size, header);
+    return Status::OK();
+  }
+
+  void Lookup(K key, V* val, V* default_v) const {
+    const uint64 bucket = BucketOf(key, header_->num_buckets);
+    const K* begin = keys_ + bucket_offsets_[bucket];
+    const K* end = keys_ + bucket_offsets_[bucket + 1];
+    const K* pos = std::lower_bound(begin, end, key);
+    if (pos != end && *pos == key) {
+      memcpy(val, values_ + (pos - keys_) * header_->value_len,
+             header_->value_len * sizeof(V));
+    } else {
+      memcpy(val, default_v, header_->value_len * sizeof(V));
+    }
+  }
+
+  int64 ValueLen() const { return header_->value_len; }
+
+  int64 Size() const { return header_->num_keys; }
+
+  string DebugString() const override {
+    return strings::StrCat("FrozenEmbeddingVar(path=", path_,
+                           ", num_keys=", header_->num_keys,
+                           ", value_len=", header_->value_len, ")");
+  }
+
+  ~FrozenEmbeddingVar() override {
+    munmap(const_cast<void*>(base_), map_size_);
+  }
+
+ private:
+  FrozenEmbeddingVar(const string& path, const void* base, size_t map_size,
+                     const FrozenEmbeddingHeader* header)
+      : path_(path), base_(base), map_size_(map_size), header_(header) {
+    const char* p = reinterpret_cast<const char*>(base_);
+    bucket_offsets_ = reinterpret_cast<const uint64*>(
+        p + sizeof(FrozenEmbeddingHeader));
+    keys_ = reinterpret_cast<const K*>(
+        p + sizeof(FrozenEmbeddingHeader) +
+        (header_->num_buckets + 1) * sizeof(uint64));
+    values_ = reinterpret_cast<const V*>(p + header_->values_offset);
+  }
+
+  static uint64 BucketOf(K key, uint64 num_buckets) {
+    // Feature ids are usually already well mixed hashes; a multiplicative
+    // mix keeps sequential id spaces from piling into few buckets.
+    uint64 h = static_cast<uint64>(key) * 0x9E3779B97F4A7C15ULL;
+    return (h >> 17) % num_buckets;
+  }
+
+  string path_;
+  const void* base_;
+  size_t map_size_;
+  const FrozenEmbeddingHeader* header_;
+  const uint64* bucket_offsets_;
+  const K* keys_;
+  const V* values_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(FrozenEmbeddingVar);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_FROZEN_EMBEDDING_VAR_H_
@@ -0,0 +1,144 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_GATHER_RESULT_CACHE_H_
+#define TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_GATHER_RESULT_CACHE_H_
+
+#include <atomic>
+#include <memory>
+
+#include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+namespace embedding {
+
+// Direct-mapped memoization cache for gather results in inference mode.
+//
+// Re-ranking traffic re-scores largely the same candidates request after
+// request, so the same hot keys hit the DRAM hash map over and over. This
+// cache keeps the most recent row per slot in a flat array indexed by the
+// key hash — a hit is one load plus a memcpy, with no probing. Entries
+// are valid for one table version (bumped by the owning kernel whenever
+// the resource it resolves changes, e.g. after a restore) and for a TTL,
+// so a model update or a long-idle key falls back to the real lookup.
+//
+// Slots use a seqlock: writers flip the sequence odd while copying and
+// readers retry-free — a torn read is detected and treated as a miss.
+// Colliding keys simply overwrite each other; the cache is best-effort
+// and the DRAM map stays the source of truth.
+//
+// Sized by TF_EV_GATHER_RESULT_CACHE (slot count, rounded up to a power
+// of two; 0 disables, the default). TTL comes from
+// TF_EV_GATHER_RESULT_CACHE_TTL_MS (default 1000).
+template <class K, class V>
+class GatherResultCache {
+ public:
+  GatherResultCache(int64 slots, int64 value_len, int64 ttl_nanos)
+      : value_len_(value_len), ttl_nanos_(ttl_nanos) {
+    num_slots_ = 1;
+    while (num_slots_ < slots) {
+      num_slots_ <<= 1;
+    }
+    mask_ = num_slots_ - 1;
+    slots_.reset(new Slot[num_slots_]);
+    values_.reset(new V[num_slots_ * value_len_]);
+  }
+
+  static int64 SlotsFromEnv() {
+    int64 slots = 0;
+    TF_CHECK_OK(ReadInt64FromEnvVar("TF_EV_GATHER_RESULT_CACHE", 0, &slots));
+    return slots;
+  }
+
+  static int64 TtlNanosFromEnv() {
+    int64 ttl_ms = 1000;
+    TF_CHECK_OK(ReadInt64FromEnvVar("TF_EV_GATHER_RESULT_CACHE_TTL_MS", 1000,
+                                    &ttl_ms));
+    return ttl_ms * 1000 * 1000;
+  }
+
+  // Invalidates every entry in O(1); called when the backing table
+  // changes identity. Entries written under the old epoch never match.
+  void BumpEpoch() { epoch_.fetch_add(1, std::memory_order_release); }
+
+  // On hit copies value_len values into out and returns true.
+  bool Lookup(K key, V* out) {
+    Slot& slot = slots_[SlotIndex(key)];
+    const uint64 seq = slot.seq.load(std::memory_order_acquire);
+    if (seq & 1) return false;
+    if (slot.key != key ||
+        slot.epoch != epoch_.load(std::memory_order_acquire) ||
+        slot.expire_ns <= Env::Default()->NowNanos()) {
+      return false;
+    }
+    const V* src = values_.get() + SlotIndex(key) * value_len_;
+    for (int64 i = 0; i < value_len_; ++i) {
+      out[i] = src[i];
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.seq.load(std::memory_order_relaxed) == seq;
+  }
+
+  // Best effort: if another writer holds the slot, the insert is
+  // dropped rather than waited for.
+  void Insert(K key, const V* val) {
+    Slot& slot = slots_[SlotIndex(key)];
+    uint64 seq = slot.seq.load(std::memory_order_relaxed);
+    if ((seq & 1) ||
+        !slot.seq.compare_exchange_strong(seq, seq + 1,
+                                          std::memory_order_acquire)) {
+      return;
+    }
+    slot.key = key;
+    slot.epoch = epoch_.load(std::memory_order_relaxed);
+    slot.expire_ns = Env::Default()->NowNanos() + ttl_nanos_;
+    V* dst = values_.get() + SlotIndex(key) * value_len_;
+    for (int64 i = 0; i < value_len_; ++i) {
+      dst[i] = val[i];
+    }
+    slot.seq.store(seq + 2, std::memory_order_release);
+  }
+
+  int64 num_slots() const { return num_slots_; }
+
+ private:
+  struct Slot {
+    std::atomic<uint64> seq{0};
+    K key = 0;
+    int64 epoch = -1;
+    uint64 expire_ns = 0;
+  };
+
+  int64 SlotIndex(K key) const {
+    return Hash64(reinterpret_cast<const char*>(&key), sizeof(K)) & mask_;
+  }
+
+  int64 num_slots_;
+  int64 mask_;
+  const int64 value_len_;
+  const int64 ttl_nanos_;
+  // Slots start at epoch -1 so an empty slot never matches.
+  std::atomic<int64> epoch_{0};
+  std::unique_ptr<Slot[]> slots_;
+  std::unique_ptr<V[]> values_;
+};
+
+}  // namespace embedding
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_GATHER_RESULT_CACHE_H_
@@ -0,0 +1,222 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_GPU_HOT_KEY_CACHE_H_
+#define TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_GPU_HOT_KEY_CACHE_H_
+
+#if GOOGLE_CUDA
+#if !TENSORFLOW_USE_GPU_EV
+
+#include <vector>
+
+#include "tensorflow/core/framework/embedding/batch.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace embedding {
+
+// HBM-resident hot-key cache placed in front of the DRAM table of an
+// HBM_DRAM EmbeddingVar. The cache is an open-addressing table of keys
+// plus a value arena, both living on the device: a batch whose keys all
+// hit is served by one async H2D key copy and one gather kernel, so the
+// device-side work is stream-capturable and no per-key host hashing or
+// PCIe row shuttling happens in steady state. Misses fall back to the
+// existing host path and the resolved rows are inserted afterwards.
+//
+// Cache maintenance also runs on the device, in the gather stream: a
+// touch kernel stamps the slots of hit keys during every gather, and
+// insert slots are picked by a per-key victim-selection kernel that
+// reduces over the probe window (own slot, else an empty slot, else
+// the least recently stamped occupant) and claims the winner with a
+// CAS on the key word. The host keeps no shadow of the key table and
+// never reads cache metadata back, so the steady-state maintenance
+// cost is two small kernels instead of a per-step host round trip.
+template <class K, class V>
+class GPUHotKeyCache {
+ public:
+  GPUHotKeyCache(int64 capacity, int64 value_len)
+      : value_len_(value_len), scratch_size_(0) {
+    capacity_ = 1;
+    while (capacity_ < capacity) {
+      capacity_ <<= 1;
+    }
+    cudaMalloc(&d_cache_keys_, capacity_ * sizeof(K));
+    // All-ones bit pattern is the empty-key marker ((K)-1) the device
+    // kernels probe against.
+    cudaMemset(d_cache_keys_, 0xff, capacity_ * sizeof(K));
+    cudaMalloc(&d_cache_values_, capacity_ * value_len_ * sizeof(V));
+    cudaMalloc(&d_access_stamps_, capacity_ * sizeof(unsigned long long));
+    cudaMemset(d_access_stamps_, 0, capacity_ * sizeof(unsigned long long));
+    stamp_ = 0;
+    d_keys_scratch_ = nullptr;
+    d_hit_flags_scratch_ = nullptr;
+    d_slots_scratch_ = nullptr;
+    d_row_ptrs_scratch_ = nullptr;
+  }
+
+  ~GPUHotKeyCache() {
+    cudaFree(d_cache_keys_);
+    cudaFree(d_cache_values_);
+    cudaFree(d_access_stamps_);
+    if (scratch_size_ != 0) {
+      cudaFree(d_keys_scratch_);
+      cudaFree(d_hit_flags_scratch_);
+      cudaFree(d_slots_scratch_);
+      cudaFree(d_row_ptrs_scratch_);
+    }
+  }
+
+  // Gathers the cached rows of keys into val_base and fills hit_flags.
+  // Returns true when every key was served from the cache, in which
+  // case val_base is complete and the host path can be skipped.
+  bool Gather(const K* keys, int64 n, V* val_base, bool* hit_flags,
+              cudaStream_t stream) {
+    mutex_lock l(mu_);
+    EnsureScratch(n);
+    cudaMemcpyAsync(d_keys_scratch_, keys, n * sizeof(K),
+                    cudaMemcpyHostToDevice, stream);
+    int capacity = capacity_;
+    int value_len = value_len_;
+    int max_probe = kMaxProbe;
+    int limit = n;
+    int block_dim = 128;
+    void* args[] = {(void*)&d_keys_scratch_, (void*)&d_cache_keys_,
+                    (void*)&d_cache_values_, (void*)&capacity,
+                    (void*)&value_len, (void*)&max_probe, (void*)&val_base,
+                    (void*)&d_hit_flags_scratch_, (void*)&limit};
+    cudaLaunchKernel((void*)BatchGatherHotKeyCache<K, V>,
+        (n * value_len_ + block_dim - 1) / block_dim, block_dim,
+        args, 0, stream);
+    // Stamp the slots of the keys we just looked up so victim
+    // selection sees fresh recency data; runs in the gather stream.
+    unsigned long long stamp = ++stamp_;
+    void* touch_args[] = {(void*)&d_keys_scratch_, (void*)&d_cache_keys_,
+                          (void*)&d_access_stamps_, (void*)&capacity,
+                          (void*)&max_probe, (void*)&stamp, (void*)&limit};
+    cudaLaunchKernel((void*)BatchTouchHotKeyCache<K>,
+        (n + block_dim - 1) / block_dim, block_dim,
+        touch_args, 0, stream);
+    cudaMemcpyAsync(hit_flags, d_hit_flags_scratch_, n * sizeof(bool),
+                    cudaMemcpyDeviceToHost, stream);
+    cudaStreamSynchronize(stream);
+    for (int64 i = 0; i < n; ++i) {
+      if (!hit_flags[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Copies the rows of the keys whose skip_flag is unset from their
+  // resolved HBM addresses into the cache arena. Called after the host
+  // path has materialized the missing rows; a hit key is refreshed when
+  // its skip_flag is unset.
+  void Insert(const K* keys, int64 n, const bool* skip_flags, V** row_ptrs,
+              cudaStream_t stream) {
+    mutex_lock l(mu_);
+    std::vector<K> insert_keys;
+    std::vector<V*> insert_rows;
+    for (int64 i = 0; i < n; ++i) {
+      if (skip_flags != nullptr && skip_flags[i]) {
+        continue;
+      }
+      insert_keys.push_back(keys[i]);
+      insert_rows.push_back(row_ptrs[i]);
+    }
+    if (insert_keys.empty()) {
+      return;
+    }
+    int64 num_insert = insert_keys.size();
+    EnsureScratch(num_insert);
+    cudaMemcpyAsync(d_keys_scratch_, insert_keys.data(),
+                    num_insert * sizeof(K), cudaMemcpyHostToDevice, stream);
+    cudaMemcpyAsync(d_row_ptrs_scratch_, insert_rows.data(),
+                    num_insert * sizeof(V*), cudaMemcpyHostToDevice, stream);
+    int capacity = capacity_;
+    int value_len = value_len_;
+    int max_probe = kMaxProbe;
+    int limit = num_insert;
+    int block_dim = 128;
+    // Pick (and claim) a slot per key on the device: one block per
+    // key, one thread per probe position, reduced to the best
+    // candidate. Keys that lose the claim race get slot -1 and are
+    // skipped by the copy kernel.
+    unsigned long long stamp = ++stamp_;
+    void* select_args[] = {(void*)&d_keys_scratch_, (void*)&d_cache_keys_,
+                           (void*)&d_access_stamps_, (void*)&capacity,
+                           (void*)&max_probe, (void*)&stamp,
+                           (void*)&d_slots_scratch_, (void*)&limit};
+    cudaLaunchKernel((void*)BatchSelectHotKeyCacheSlot<K>,
+        num_insert, kMaxProbe, select_args, 0, stream);
+    void* args[] = {(void*)&d_keys_scratch_, (void*)&d_slots_scratch_,
+                    (void*)&d_row_ptrs_scratch_, (void*)&d_cache_keys_,
+                    (void*)&d_cache_values_, (void*)&value_len,
+                    (void*)&limit};
+    cudaLaunchKernel((void*)BatchInsertHotKeyCache<K, V>,
+        (num_insert * value_len_ + block_dim - 1) / block_dim, block_dim,
+        args, 0, stream);
+    cudaStreamSynchronize(stream);
+  }
+
+  int64 Capacity() const {
+    return capacity_;
+  }
+
+ private:
+  void EnsureScratch(int64 n) {
+    if (n <= scratch_size_) {
+      return;
+    }
+    if (scratch_size_ != 0) {
+      cudaFree(d_keys_scratch_);
+      cudaFree(d_hit_flags_scratch_);
+      cudaFree(d_slots_scratch_);
+      cudaFree(d_row_ptrs_scratch_);
+    }
+    cudaMalloc(&d_keys_scratch_, n * sizeof(K));
+    cudaMalloc(&d_hit_flags_scratch_, n * sizeof(bool));
+    cudaMalloc(&d_slots_scratch_, n * sizeof(int));
+    cudaMalloc(&d_row_ptrs_scratch_, n * sizeof(V*));
+    scratch_size_ = n;
+  }
+
+  // Probe-window length; doubles as the victim-selection block size,
+  // so it must stay a power of two no larger than 32.
+  static const int kMaxProbe = 32;
+
+  int64 capacity_;
+  int64 value_len_;
+  int64 scratch_size_;
+  mutex mu_;
+  K* d_cache_keys_;
+  V* d_cache_values_;
+  // Per-slot recency stamps, device-resident; only ever touched by the
+  // metadata kernels. stamp_ is the batch counter they are fed from.
+  unsigned long long* d_access_stamps_;
+  unsigned long long stamp_;
+  K* d_keys_scratch_;
+  bool* d_hit_flags_scratch_;
+  int* d_slots_scratch_;
+  V** d_row_ptrs_scratch_;
+};
+
+}  // namespace embedding
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_USE_GPU_EV
+#endif  // GOOGLE_CUDA
+
+#endif  // TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_GPU_HOT_KEY_CACHE_H_
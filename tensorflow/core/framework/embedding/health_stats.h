@@ -0,0 +1,170 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_HEALTH_STATS_H_
+#define TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_HEALTH_STATS_H_
+
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "tensorflow/core/lib/strings/numbers.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace embedding {
+
+// Sampled training-health telemetry for one embedding table. An
+// exploding row norm or update magnitude on a hot key shows up here
+// within minutes instead of in offline analysis.
+//
+// The apply kernels sample one in kSampleInterval key updates with a
+// thread-local countdown, so the unsampled fast path costs a single
+// decrement. A sampled update records the row norm after the update,
+// the applied update magnitude, and whether the key passed admission;
+// maxima and sums land in relaxed atomics and a registry thread logs
+// and resets them periodically.
+class TableHealthStats {
+ public:
+  static constexpr int kSampleInterval = 4096;
+
+  // Thread-local stride sampling shared by all tables; exact per-table
+  // ratios do not matter for a health signal.
+  static bool ShouldSample() {
+    static thread_local int32 countdown = 0;
+    if (--countdown > 0) return false;
+    countdown = kSampleInterval;
+    return true;
+  }
+
+  void RecordSampledUpdate(bool admitted, double row_norm,
+                           double update_magnitude) {
+    sampled_keys_.fetch_add(1, std::memory_order_relaxed);
+    if (!admitted) return;
+    admitted_keys_.fetch_add(1, std::memory_order_relaxed);
+    AddMicros(&row_norm_sum_micros_, row_norm);
+    AddMicros(&update_sum_micros_, update_magnitude);
+    MaxMicros(&row_norm_max_micros_, row_norm);
+    MaxMicros(&update_max_micros_, update_magnitude);
+  }
+
+  // Logs one parseable line and resets the window. Returns false when
+  // the window saw no samples.
+  bool ReportAndReset(const std::string& table) {
+    const int64 sampled = sampled_keys_.exchange(0);
+    if (sampled == 0) return false;
+    const int64 admitted = admitted_keys_.exchange(0);
+    const double norm_sum = row_norm_sum_micros_.exchange(0) * 1e-6;
+    const double update_sum = update_sum_micros_.exchange(0) * 1e-6;
+    const double norm_max = row_norm_max_micros_.exchange(0) * 1e-6;
+    const double update_max = update_max_micros_.exchange(0) * 1e-6;
+    const double denom = admitted > 0 ? admitted : 1;
+    LOG(INFO) << "EVHealth(" << table << "): sampled_keys=" << sampled
+              << " admission_rate=" << static_cast<double>(admitted) / sampled
+              << " row_norm_mean=" << norm_sum / denom
+              << " row_norm_max=" << norm_max
+              << " update_mean=" << update_sum / denom
+              << " update_max=" << update_max;
+    return true;
+  }
+
+ private:
+  // Fixed-point micros so sums and maxima stay lock-free; health
+  // signals do not need more precision than 1e-6.
+  static void AddMicros(std::atomic<int64>* cell, double v) {
+    cell->fetch_add(static_cast<int64>(v * 1e6), std::memory_order_relaxed);
+  }
+
+  static void MaxMicros(std::atomic<int64>* cell, double v) {
+    const int64 fixed = static_cast<int64>(v * 1e6);
+    int64 seen = cell->load(std::memory_order_relaxed);
+    while (fixed > seen &&
+           !cell->compare_exchange_weak(seen, fixed,
+                                        std::memory_order_relaxed)) {
+    }
+  }
+
+  std::atomic<int64> sampled_keys_{0};
+  std::atomic<int64> admitted_keys_{0};
+  std::atomic<int64> row_norm_sum_micros_{0};
+  std::atomic<int64> update_sum_micros_{0};
+  std::atomic<int64> row_norm_max_micros_{0};
+  std::atomic<int64> update_max_micros_{0};
+};
+
+// Process-wide table name -> stats resolution, armed by
+// TF_EV_HEALTH_STATS=1. TF_EV_HEALTH_STATS_INTERVAL_SEC (default 60)
+// sets the reporting period. Stats objects live for the process
+// lifetime, so callers may cache the pointer, mirroring the QoS
+// registry.
+class EmbeddingHealthRegistry {
+ public:
+  static EmbeddingHealthRegistry* GetInstance() {
+    static EmbeddingHealthRegistry* registry = new EmbeddingHealthRegistry;
+    return registry;
+  }
+
+  // Returns the stats for `table`, or nullptr when telemetry is off.
+  TableHealthStats* Lookup(const string& table) {
+    if (!enabled_) return nullptr;
+    mutex_lock l(mu_);
+    std::unique_ptr<TableHealthStats>& stats = stats_[table];
+    if (stats == nullptr) {
+      stats.reset(new TableHealthStats);
+    }
+    return stats.get();
+  }
+
+ private:
+  EmbeddingHealthRegistry() {
+    const char* flag = std::getenv("TF_EV_HEALTH_STATS");
+    enabled_ = flag != nullptr && flag[0] == '1';
+    if (!enabled_) return;
+    int64 interval_sec = 60;
+    const char* interval = std::getenv("TF_EV_HEALTH_STATS_INTERVAL_SEC");
+    if (interval != nullptr) {
+      strings::safe_strto64(interval, &interval_sec);
+    }
+    if (interval_sec <= 0) interval_sec = 60;
+    report_thread_.reset(Env::Default()->StartThread(
+        ThreadOptions(), "ev_health_stats", [this, interval_sec]() {
+          while (true) {
+            Env::Default()->SleepForMicroseconds(interval_sec * 1000000);
+            mutex_lock l(mu_);
+            for (const auto& it : stats_) {
+              it.second->ReportAndReset(it.first);
+            }
+          }
+        }));
+  }
+
+  bool enabled_;
+  mutex mu_;
+  std::map<string, std::unique_ptr<TableHealthStats>> stats_ GUARDED_BY(mu_);
+  std::unique_ptr<Thread> report_thread_;
+};
+
+}  // namespace embedding
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_HEALTH_STATS_H_
@@ -52,6 +52,21 @@ class KVInterface {
     return Status(error::Code::UNIMPLEMENTED,
                       "Unimplemented for BatchLookup in KVInterface.");
   }
+  // KV Batch Lookup on contiguous keys, the slot of a missing key is
+  // set to nullptr. Backends override this to coalesce hash probes and
+  // amortize their internal synchronization, the default falls back to
+  // per-key Lookup.
+  virtual Status BatchLookup(const K* keys, size_t n,
+                             ValuePtr<V>** value_ptrs) {
+    for (size_t i = 0; i < n; ++i) {
+      ValuePtr<V>* value_ptr = nullptr;
+      if (!Lookup(keys[i], &value_ptr).ok()) {
+        value_ptr = nullptr;
+      }
+      value_ptrs[i] = value_ptr;
+    }
+    return Status::OK();
+  }
   // KV Batch Insert
   virtual Status BatchInsert(const std::vector<K>& keys,
                              const std::vector<const ValuePtr<V>*>& value_ptrs) {
@@ -70,6 +85,11 @@ class KVInterface {
   // KV Size
   virtual int64 Size() const = 0;
 
+  // Presize the backend for an expected number of keys so a bulk load
+  // does not rehash over and over. A no-op for backends without an
+  // in-memory index.
+  virtual Status Reserve(int64 num_keys) { return Status::OK(); }
+
   virtual void SetTotalDims(int total_dims) {}
 
   virtual void FreeValuePtr(ValuePtr<V>* value_ptr) {}
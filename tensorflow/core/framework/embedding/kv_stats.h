@@ -0,0 +1,285 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_KV_STATS_H_
+#define TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_KV_STATS_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <vector>
+
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/profile_utils/cpu_utils.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace embedding {
+
+// Point-in-time health snapshot of one KV backend's hash index.
+// The probe histogram buckets sampled lookup cost in cycles: sparsehash
+// does not expose per-find probe counts through its public API, and
+// lookup cycles are what an unhealthy load factor actually inflates, so
+// that is the signal production wants to alert on.
+struct KVStatsSnapshot {
+  string name;
+  int64 size = 0;
+  int64 capacity = 0;  // bucket count, summed over partitions
+  double load_factor = 0;
+  double max_load_factor = 0;
+  int64 resizes = 0;  // table growth/shrink steps observed so far
+  int64 samples = 0;  // 1-in-1024 sampled lookups
+  int64 cycles = 0;   // total cycles of the sampled lookups
+  int64 hist[24] = {0};
+};
+
+// Cheap health telemetry for the KVInterface hash backends, sharing the
+// stats surface of TierStatsCollector: armed by the same
+// TF_EV_TIER_STATS_INTERVAL_SEC knob, logged by a detached export
+// thread at the same cadence, and offered to the same kind of export
+// hooks. Backends register a snapshot provider on construction; lookup
+// paths bracket themselves with Begin()/End(), where Begin() is a
+// thread-local counter increment for 1023 of 1024 lookups so the hot
+// path stays off shared cache lines. Resize counts are derived from
+// capacity changes between snapshots (capacities move in doubling
+// steps), so inserts need no extra bookkeeping at all.
+//
+// A load factor within 90% of the configured maximum is warned about at
+// every interval: that is the condition that took days to find by hand.
+class KVStatsCollector {
+ public:
+  static const int kNumBuckets = 24;
+  static const int kSampleEvery = 1024;  // must be a power of two
+
+  static KVStatsCollector* GetInstance() {
+    static KVStatsCollector* instance = new KVStatsCollector();
+    return instance;
+  }
+
+  static bool Enabled() {
+    static int64 interval = IntervalFromEnv();
+    return interval > 0;
+  }
+
+  // Returns the rdtsc timestamp when this lookup is sampled, 0
+  // otherwise. Pass the result to End().
+  static uint64 Begin() {
+    if (!Enabled()) {
+      return 0;
+    }
+    static thread_local uint64 ops = 0;
+    if ((ops++ & (kSampleEvery - 1)) != 0) {
+      return 0;
+    }
+    return profile_utils::CpuUtils::GetCurrentClockCycle();
+  }
+
+  // Registers a backend; the provider is called by the export thread to
+  // fill size/capacity/load factors and the sampled counters. Returns a
+  // handle for Unregister, or -1 when the collector is disabled.
+  int64 Register(string name,
+                 std::function<void(KVStatsSnapshot*)> provider) {
+    if (!Enabled()) {
+      return -1;
+    }
+    mutex_lock l(mu_);
+    int64 id = next_id_++;
+    Entry& entry = entries_[id];
+    entry.name = std::move(name);
+    entry.provider = std::move(provider);
+    return id;
+  }
+
+  void Unregister(int64 id) {
+    if (id < 0) {
+      return;
+    }
+    mutex_lock l(mu_);
+    entries_.erase(id);
+  }
+
+  // The hook is invoked by the export thread with the cumulative
+  // per-backend snapshots at every interval.
+  void RegisterExportHook(
+      std::function<void(const std::vector<KVStatsSnapshot>&)> hook) {
+    mutex_lock l(mu_);
+    export_hooks_.emplace_back(std::move(hook));
+  }
+
+  std::vector<KVStatsSnapshot> Snapshot() {
+    std::vector<KVStatsSnapshot> result;
+    mutex_lock l(mu_);
+    for (auto& it : entries_) {
+      Entry& entry = it.second;
+      KVStatsSnapshot snap;
+      snap.name = entry.name;
+      entry.provider(&snap);
+      entry.resizes += ResizeSteps(entry.prev_capacity, snap.capacity);
+      entry.prev_capacity = snap.capacity;
+      snap.resizes = entry.resizes;
+      result.emplace_back(std::move(snap));
+    }
+    return result;
+  }
+
+  static int Bucket(uint64 cycles) {
+    int bucket = 0;
+    while (cycles > 1 && bucket < kNumBuckets - 1) {
+      cycles >>= 1;
+      ++bucket;
+    }
+    return bucket;
+  }
+
+ private:
+  struct Entry {
+    string name;
+    std::function<void(KVStatsSnapshot*)> provider;
+    int64 prev_capacity = 0;
+    int64 resizes = 0;
+  };
+
+  KVStatsCollector() {
+    if (Enabled()) {
+      export_thread_.reset(Env::Default()->StartThread(
+          ThreadOptions(), "ev_kv_stats_export", [this]() { ExportLoop(); }));
+    }
+  }
+
+  // Shares the tier stats interval so one knob arms the whole EV stats
+  // surface.
+  static int64 IntervalFromEnv() {
+    const char* env = std::getenv("TF_EV_TIER_STATS_INTERVAL_SEC");
+    if (env == nullptr) {
+      return 0;
+    }
+    return atoll(env);
+  }
+
+  // Number of doubling/halving steps between two capacities. Multiple
+  // resizes inside one interval are recovered from the ratio.
+  static int64 ResizeSteps(int64 prev, int64 curr) {
+    if (prev <= 0 || curr <= 0 || prev == curr) {
+      return 0;
+    }
+    int64 lo = std::min(prev, curr);
+    int64 hi = std::max(prev, curr);
+    int64 steps = 0;
+    while (lo < hi) {
+      lo <<= 1;
+      ++steps;
+    }
+    return steps;
+  }
+
+  void ExportLoop() {
+    int64 interval = IntervalFromEnv();
+    std::map<string, KVStatsSnapshot> prev;
+    while (true) {
+      Env::Default()->SleepForMicroseconds(interval * 1000 * 1000);
+      std::vector<KVStatsSnapshot> curr = Snapshot();
+      for (const KVStatsSnapshot& snap : curr) {
+        const KVStatsSnapshot& old = prev[snap.name];
+        int64 samples = snap.samples - old.samples;
+        int64 cycles = snap.cycles - old.cycles;
+        string hist;
+        for (int b = 0; b < kNumBuckets; ++b) {
+          strings::StrAppend(&hist, b == 0 ? "" : ",",
+                             snap.hist[b] - old.hist[b]);
+        }
+        LOG(INFO) << "EV kv stats, map:" << snap.name
+                  << ", size:" << snap.size << ", buckets:" << snap.capacity
+                  << ", load_factor:" << snap.load_factor
+                  << ", max_load_factor:" << snap.max_load_factor
+                  << ", resizes:" << snap.resizes << ", sampled:" << samples
+                  << ", avg lookup cycles:"
+                  << (samples == 0 ? 0 : cycles / samples)
+                  << ", log2 cycle hist:[" << hist << "]";
+        if (snap.max_load_factor > 0 &&
+            snap.load_factor >= 0.9 * snap.max_load_factor) {
+          LOG(WARNING) << "EV kv stats, map:" << snap.name
+                       << " load factor " << snap.load_factor
+                       << " is within 10% of its maximum "
+                       << snap.max_load_factor
+                       << "; probe lengths are likely degrading.";
+        }
+        prev[snap.name] = snap;
+      }
+      std::vector<std::function<void(const std::vector<KVStatsSnapshot>&)>>
+          hooks;
+      {
+        mutex_lock l(mu_);
+        hooks = export_hooks_;
+      }
+      for (auto& hook : hooks) {
+        hook(curr);
+      }
+    }
+  }
+
+  mutex mu_;
+  int64 next_id_ = 0;
+  std::map<int64, Entry> entries_;
+  std::vector<std::function<void(const std::vector<KVStatsSnapshot>&)>>
+      export_hooks_;
+  std::unique_ptr<Thread> export_thread_;
+};
+
+// Sampled lookup-cost accumulator embedded in a backend. End() is only
+// reached for 1-in-1024 lookups, so plain relaxed atomics are cheap
+// enough and keep concurrent lookup threads coherent.
+class KVProbeStats {
+ public:
+  KVProbeStats() {
+    for (auto& h : hist_) {
+      h.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  void End(uint64 begin_cycle) {
+    if (begin_cycle == 0) {
+      return;
+    }
+    uint64 delta =
+        profile_utils::CpuUtils::GetCurrentClockCycle() - begin_cycle;
+    samples_.fetch_add(1, std::memory_order_relaxed);
+    cycles_.fetch_add(delta, std::memory_order_relaxed);
+    hist_[KVStatsCollector::Bucket(delta)].fetch_add(
+        1, std::memory_order_relaxed);
+  }
+
+  void Fill(KVStatsSnapshot* snap) const {
+    snap->samples = samples_.load(std::memory_order_relaxed);
+    snap->cycles = cycles_.load(std::memory_order_relaxed);
+    for (int b = 0; b < KVStatsCollector::kNumBuckets; ++b) {
+      snap->hist[b] = hist_[b].load(std::memory_order_relaxed);
+    }
+  }
+
+ private:
+  std::atomic<int64> samples_{0};
+  std::atomic<int64> cycles_{0};
+  std::atomic<int64> hist_[KVStatsCollector::kNumBuckets];
+};
+
+}  // namespace embedding
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_KV_STATS_H_
@@ -5,12 +5,17 @@
 
 #include "tensorflow/core/framework/embedding/kv_interface.h"
 #include "tensorflow/core/framework/embedding/value_ptr.h"
+#include "tensorflow/core/framework/embedding/zstd_dict_codec.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/mutex.h"
 
 #include "leveldb/db.h"
 #include "leveldb/comparator.h"
 #include "leveldb/write_batch.h"
 
+#include <atomic>
+#include <map>
+#include <memory>
 #include <sstream>
 
 using leveldb::DB;
@@ -60,7 +65,8 @@ class SizeCounter {
 
 class DBIterator : public Iterator {
  public:
-  DBIterator(leveldb::Iterator* it):it_(it) {}
+  DBIterator(leveldb::Iterator* it, ZstdDictCodec* codec, size_t value_bytes)
+      : it_(it), codec_(codec), scratch_(value_bytes, '\0') {}
   virtual ~DBIterator() {
     delete it_;
   };
@@ -68,21 +74,42 @@ class DBIterator : public Iterator {
     return it_->Valid();
   }
   virtual void SeekToFirst() {
-    return it_->SeekToFirst();
+    it_->SeekToFirst();
+    SkipReservedKeys();
   }
   virtual void Next() {
-    return it_->Next();
+    it_->Next();
+    SkipReservedKeys();
   }
   virtual void Key(char* val, int64 dim) {
     memcpy(val, it_->key().ToString().data(), dim);
   }
   virtual void Value(char* val, int64 dim, int64 value_offset) {
+    if (codec_ != nullptr) {
+      const std::string val_str = it_->value().ToString();
+      TF_CHECK_OK(codec_->Decode(val_str.data(), val_str.size(), &scratch_[0],
+                                 scratch_.size()));
+      memcpy(val,
+             scratch_.data() + value_offset + sizeof(FixedLengthHeader),
+             dim);
+      return;
+    }
     memcpy(val,
            it_->value().ToString().data() + value_offset + sizeof(FixedLengthHeader),
            dim);
   }
  private:
+  // Entry keys are fixed width; anything else (the persisted zstd
+  // dictionary) is codec metadata the caller must not see.
+  void SkipReservedKeys() {
+    while (it_->Valid() && it_->key().size() != sizeof(void*)) {
+      it_->Next();
+    }
+  }
+
   leveldb::Iterator* it_;
+  ZstdDictCodec* codec_;
+  std::string scratch_;
 };
 
 template <class K, class V>
@@ -96,6 +123,16 @@ class LevelDBKV : public KVInterface<K, V> {
     counter_ =  new SizeCounter<K>(8);
     new_value_ptr_fn_ = [] (size_t size) { return new NormalContiguousValuePtr<V>(ev_allocator(), size); };
     total_dims_ = 0;
+    if (ZstdDictCodec::EnabledFromEnv()) {
+      codec_.reset(new ZstdDictCodec);
+    }
+    if (AsyncWritebackFromEnv()) {
+      writeback_flush_bytes_ = WritebackFlushBytesFromEnv();
+      writeback_thread_.reset(Env::Default()->StartThread(
+          ThreadOptions(), "leveldb_writeback", [this]() {
+            WritebackLoop();
+          }));
+    }
   }
 
   void SetTotalDims(int total_dims) {
@@ -103,11 +140,23 @@ class LevelDBKV : public KVInterface<K, V> {
   }
 
   ~LevelDBKV() {
+    if (writeback_thread_ != nullptr) {
+      {
+        mutex_lock l(writeback_mu_);
+        writeback_shutdown_ = true;
+        writeback_cv_.notify_all();
+      }
+      writeback_thread_.reset();
+      FlushWriteback();
+    }
     delete db_;
   }
 
   Status Lookup(K key, ValuePtr<V>** value_ptr) {
     std::string val_str;
+    if (writeback_thread_ != nullptr && LookupPending(key, &val_str)) {
+      return DecodeToValuePtr(val_str, value_ptr);
+    }
     leveldb::Slice db_key((char*)(&key), sizeof(void*));
     leveldb::ReadOptions options;
     leveldb::Status s = db_->Get(options, db_key, &val_str);
@@ -115,13 +164,29 @@ class LevelDBKV : public KVInterface<K, V> {
       return errors::NotFound(
           "Unable to find Key: ", key, " in LevelDB.");
     } else {
-      ValuePtr<V>* val = new_value_ptr_fn_(total_dims_);
-      memcpy((int64 *)(val->GetPtr()), &val_str[0], val_str.length());
-      *value_ptr = val;
-      return Status::OK();
+      return DecodeToValuePtr(val_str, value_ptr);
     }
   }
 
+  Status BatchLookup(const K* keys, size_t n, ValuePtr<V>** value_ptrs) {
+    leveldb::ReadOptions options;
+    std::string val_str;
+    for (size_t i = 0; i < n; ++i) {
+      if (writeback_thread_ != nullptr && LookupPending(keys[i], &val_str)) {
+        TF_RETURN_IF_ERROR(DecodeToValuePtr(val_str, &value_ptrs[i]));
+        continue;
+      }
+      leveldb::Slice db_key((char*)(&keys[i]), sizeof(void*));
+      leveldb::Status s = db_->Get(options, db_key, &val_str);
+      if (s.IsNotFound()) {
+        value_ptrs[i] = nullptr;
+      } else {
+        TF_RETURN_IF_ERROR(DecodeToValuePtr(val_str, &value_ptrs[i]));
+      }
+    }
+    return Status::OK();
+  }
+
   Status Insert(K key, const ValuePtr<V>* value_ptr) {
     counter_->add(key, 1);
     return Status::OK();
@@ -134,21 +199,55 @@ class LevelDBKV : public KVInterface<K, V> {
 
   Status BatchCommit(const std::vector<K>& keys,
                      const std::vector<ValuePtr<V>*>& value_ptrs) {
+    if (writeback_thread_ != nullptr) {
+      // Encode outside the buffer lock: zstd work must not block the
+      // pending-lookup path.
+      std::vector<std::string> framed(keys.size());
+      for (int i = 0; i < keys.size(); i++) {
+        EncodeValue(value_ptrs[i], &framed[i]);
+        delete value_ptrs[i];
+      }
+      {
+        mutex_lock l(writeback_mu_);
+        for (int i = 0; i < keys.size(); i++) {
+          pending_bytes_ += framed[i].size();
+          pending_[keys[i]].swap(framed[i]);
+        }
+        if (pending_bytes_ >= writeback_flush_bytes_) {
+          writeback_cv_.notify_all();
+        }
+      }
+      MaybePersistDict();
+      return Status::OK();
+    }
     WriteBatch batch;
+    std::string framed;
     for (int i = 0; i < keys.size(); i++) {
-      std::string value_res((char*)value_ptrs[i]->GetPtr(), sizeof(FixedLengthHeader) + total_dims_ * sizeof(V));
       leveldb::Slice db_key((char*)(&keys[i]), sizeof(void*));
-      batch.Put(db_key, value_res);
+      EncodeValue(value_ptrs[i], &framed);
+      batch.Put(db_key, framed);
       delete value_ptrs[i];
     }
     db_->Write(WriteOptions(),&batch);
+    MaybePersistDict();
     return Status::OK();
   }
 
   Status Commit(K key, const ValuePtr<V>* value_ptr) {
-    std::string value_res((char*)value_ptr->GetPtr(), sizeof(FixedLengthHeader) + total_dims_ * sizeof(V));
+    std::string value_res;
+    EncodeValue(value_ptr, &value_res);
+    if (writeback_thread_ != nullptr) {
+      mutex_lock l(writeback_mu_);
+      pending_bytes_ += value_res.size();
+      pending_[key].swap(value_res);
+      if (pending_bytes_ >= writeback_flush_bytes_) {
+        writeback_cv_.notify_all();
+      }
+      return Status::OK();
+    }
     leveldb::Slice db_key((char*)(&key), sizeof(void*));
     leveldb::Status s = db_->Put(WriteOptions(), db_key, value_res);
+    MaybePersistDict();
     if (!s.ok()){
       return errors::AlreadyExists(
           "already exists Key: ", key, " in RocksDB.");
@@ -159,6 +258,10 @@ class LevelDBKV : public KVInterface<K, V> {
 
   Status Remove(K key) {
     counter_->sub(key, 1);
+    if (writeback_thread_ != nullptr) {
+      mutex_lock l(writeback_mu_);
+      pending_.erase(key);
+    }
     leveldb::Slice db_key((char*)(&key), sizeof(void*));
     leveldb::Status s = db_->Delete(WriteOptions(), db_key);
     if (s.ok()) {
@@ -174,10 +277,15 @@ class LevelDBKV : public KVInterface<K, V> {
   }
 
   Iterator* GetIterator() {
+    // Checkpoint scans must see everything the writer has not flushed
+    // yet.
+    if (writeback_thread_ != nullptr) {
+      FlushWriteback();
+    }
     ReadOptions options;
     options.snapshot = db_->GetSnapshot();
     leveldb::Iterator* it = db_->NewIterator(options);
-    return new DBIterator(it);
+    return new DBIterator(it, codec_.get(), ValueBytes());
   }
 
   int64 Size() const {
@@ -192,14 +300,145 @@ class LevelDBKV : public KVInterface<K, V> {
     return "";
   }
  private:
+  size_t ValueBytes() const {
+    return sizeof(FixedLengthHeader) + total_dims_ * sizeof(V);
+  }
+
+  void EncodeValue(const ValuePtr<V>* value_ptr, std::string* framed) {
+    if (codec_ != nullptr) {
+      codec_->AddSample((char*)value_ptr->GetPtr(), ValueBytes());
+      codec_->Encode((char*)value_ptr->GetPtr(), ValueBytes(), framed);
+    } else {
+      framed->assign((char*)value_ptr->GetPtr(), ValueBytes());
+    }
+  }
+
+  Status DecodeToValuePtr(const std::string& val_str,
+                          ValuePtr<V>** value_ptr) {
+    ValuePtr<V>* val = new_value_ptr_fn_(total_dims_);
+    if (codec_ != nullptr) {
+      TF_RETURN_IF_ERROR(codec_->Decode((char*)val_str.data(),
+                                        val_str.length(),
+                                        (char*)val->GetPtr(), ValueBytes()));
+    } else {
+      memcpy((int64 *)(val->GetPtr()), &val_str[0], val_str.length());
+    }
+    *value_ptr = val;
+    return Status::OK();
+  }
+
+  bool LookupPending(K key, std::string* val_str) {
+    mutex_lock l(writeback_mu_);
+    auto it = pending_.find(key);
+    if (it == pending_.end()) {
+      return false;
+    }
+    *val_str = it->second;
+    return true;
+  }
+
+  // With TF_EV_LEVELDB_ASYNC_WRITEBACK=1 Commit/BatchCommit only park
+  // the encoded value in pending_ and this loop turns the accumulated
+  // entries into one WriteBatch per flush. pending_ is an ordered map,
+  // so the batch is applied in ascending key order — together with the
+  // sorted runs get_evic_ids now hands out, tier demotion stops
+  // spraying random single-key Puts between checkpoint writes on the
+  // same device. Flushes happen when the buffer passes the byte
+  // threshold or every few milliseconds, whichever comes first.
+  void WritebackLoop() {
+    const int kFlushIntervalMilliseconds = 10;
+    while (true) {
+      {
+        mutex_lock l(writeback_mu_);
+        if (writeback_shutdown_) {
+          break;
+        }
+        if (pending_bytes_ < writeback_flush_bytes_) {
+          WaitForMilliseconds(&l, &writeback_cv_,
+                              kFlushIntervalMilliseconds);
+        }
+        if (writeback_shutdown_) {
+          break;
+        }
+      }
+      FlushWriteback();
+    }
+  }
+
+  void FlushWriteback() {
+    std::map<K, std::string> batch_entries;
+    {
+      mutex_lock l(writeback_mu_);
+      if (pending_.empty()) {
+        return;
+      }
+      batch_entries.swap(pending_);
+      pending_bytes_ = 0;
+    }
+    WriteBatch batch;
+    for (auto& entry : batch_entries) {
+      leveldb::Slice db_key((char*)(&entry.first), sizeof(void*));
+      batch.Put(db_key, entry.second);
+    }
+    db_->Write(WriteOptions(), &batch);
+    MaybePersistDict();
+  }
+
+  static bool AsyncWritebackFromEnv() {
+    const char* flag = std::getenv("TF_EV_LEVELDB_ASYNC_WRITEBACK");
+    return flag != nullptr && flag[0] == '1';
+  }
+
+  static int64 WritebackFlushBytesFromEnv() {
+    const char* bytes = std::getenv("TF_EV_LEVELDB_WRITEBACK_BYTES");
+    if (bytes == nullptr) {
+      return 4 << 20;
+    }
+    return strtoll(bytes, nullptr, 10);
+  }
+
+  // Once training finishes, the dictionary is written into the DB under
+  // a reserved key (one byte longer than any entry key, so it can never
+  // collide) to keep the on-disk directory self-describing. The version
+  // byte in each value frame guards against decoding with the wrong
+  // dictionary.
+  void MaybePersistDict() {
+    if (codec_ == nullptr || dict_persisted_ || !codec_->trained()) {
+      return;
+    }
+    std::string dict_val;
+    dict_val.push_back(static_cast<char>(codec_->version()));
+    dict_val.append(codec_->dict_bytes());
+    db_->Put(WriteOptions(), leveldb::Slice(kDictKey, sizeof(void*) + 1),
+             dict_val);
+    dict_persisted_ = true;
+  }
+
+  static constexpr char kDictKey[] = "\xffZSTDDICT";
+
   DB* db_;
   SizeCounter<K>* counter_;
   Options options_;
   std::string path_;
   std::function<ValuePtr<V>*(size_t)> new_value_ptr_fn_;
   int total_dims_;
+  // Present iff TF_LEVELDB_ZSTD_DICT is set; see zstd_dict_codec.h.
+  std::unique_ptr<ZstdDictCodec> codec_;
+  std::atomic<bool> dict_persisted_{false};
+  // Group-commit buffer; see WritebackLoop. writeback_thread_ doubles
+  // as the enabled flag.
+  mutex writeback_mu_;
+  condition_variable writeback_cv_;
+  std::map<K, std::string> pending_ GUARDED_BY(writeback_mu_);
+  int64 pending_bytes_ GUARDED_BY(writeback_mu_) = 0;
+  bool writeback_shutdown_ GUARDED_BY(writeback_mu_) = false;
+  int64 writeback_flush_bytes_ = 0;
+  std::unique_ptr<Thread> writeback_thread_;
 };
 
+template <class K, class V>
+constexpr char LevelDBKV<K, V>::kDictKey[];
+
 } //namespace embedding
 } //namespace tensorflow
 
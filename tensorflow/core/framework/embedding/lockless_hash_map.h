@@ -18,7 +18,9 @@ limitations under the License.
 
 #include "sparsehash/dense_hash_map_lockless"
 #include "tensorflow/core/framework/embedding/kv_interface.h"
+#include "tensorflow/core/framework/embedding/kv_stats.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/numa.h"
 
 namespace tensorflow {
 template <class V>
@@ -34,13 +36,26 @@ class LocklessHashMap : public KVInterface<K, V> {
     hash_map_.set_empty_key_and_value(LocklessHashMap<K, V>::EMPTY_KEY_, nullptr);
     hash_map_.set_counternum(16);
     hash_map_.set_deleted_key(LocklessHashMap<K, V>::DELETED_KEY_);
+    stats_id_ = KVStatsCollector::GetInstance()->Register(
+        strings::StrCat("LocklessHashMap@",
+                        strings::Hex(reinterpret_cast<uint64>(this))),
+        [this](KVStatsSnapshot* snap) {
+          snap->size = hash_map_.size_lockless();
+          snap->capacity = hash_map_.bucket_count();
+          snap->load_factor = hash_map_.load_factor();
+          snap->max_load_factor = hash_map_.max_load_factor();
+          probe_stats_.Fill(snap);
+        });
   }
 
   ~LocklessHashMap() {
+    KVStatsCollector::GetInstance()->Unregister(stats_id_);
   }
 
   Status Lookup(K key, ValuePtr<V>** value_ptr) {
+    uint64 sample = KVStatsCollector::Begin();
     auto iter = hash_map_.find_wait_free(key);
+    probe_stats_.End(sample);
     if (iter.first == LocklessHashMap<K, V>::EMPTY_KEY_) {
       return errors::NotFound(
           "Unable to find Key: ", key, " in LocklessHashMap.");
@@ -50,6 +65,20 @@ class LocklessHashMap : public KVInterface<K, V> {
     }
   }
 
+  Status BatchLookup(const K* keys, size_t n, ValuePtr<V>** value_ptrs) {
+    for (size_t i = 0; i < n; ++i) {
+      uint64 sample = KVStatsCollector::Begin();
+      auto iter = hash_map_.find_wait_free(keys[i]);
+      probe_stats_.End(sample);
+      if (iter.first == LocklessHashMap<K, V>::EMPTY_KEY_) {
+        value_ptrs[i] = nullptr;
+      } else {
+        value_ptrs[i] = iter.second;
+      }
+    }
+    return Status::OK();
+  }
+
   Status Insert(K key, const ValuePtr<V>* value_ptr) {
     auto iter = hash_map_.insert_lockless(
         std::move(std::pair<K, ValuePtr<V>*>(key, const_cast<ValuePtr<V>*>(value_ptr))));
@@ -67,6 +96,11 @@ class LocklessHashMap : public KVInterface<K, V> {
     return hash_map_.size_lockless();
   }
 
+  Status Reserve(int64 num_keys) {
+    hash_map_.resize(num_keys);
+    return Status::OK();
+  }
+
   // Remove KV
   Status Remove(K key) {
     if (hash_map_.erase_lockless(key)) {
@@ -113,12 +147,110 @@ class LocklessHashMap : public KVInterface<K, V> {
   static const int EMPTY_KEY_;
   static const int DELETED_KEY_;
   LockLessHashMap hash_map_;
+  KVProbeStats probe_stats_;
+  int64 stats_id_ = -1;
 };
 template <class K, class V>
 const int LocklessHashMap<K, V>::EMPTY_KEY_ = -1;
 template <class K, class V>
 const int LocklessHashMap<K, V>::DELETED_KEY_ = -2;
 
+// NUMA-partitioned variant: the key space is split across one sub-table
+// per node and every sub-table's buckets are first-touched from a
+// thread bound to its node, so a probe stays inside one socket's memory
+// instead of hopping the interconnect for half the keys. Selected by
+// StorageManager when TF_EV_NUMA_PARTITION=1 and the host exposes more
+// than one node.
+template <class K, class V>
+class NumaLocklessHashMap : public KVInterface<K, V> {
+ public:
+  NumaLocklessHashMap() {
+    num_partitions_ = std::max(port::NUMANumNodes(), 1);
+    int prev_node = port::NUMAGetThreadNodeAffinity();
+    for (int i = 0; i < num_partitions_; ++i) {
+      if (port::NUMAEnabled()) {
+        port::NUMASetThreadNodeAffinity(i);
+      }
+      partitions_.emplace_back(new LocklessHashMap<K, V>());
+    }
+    if (port::NUMAEnabled()) {
+      port::NUMASetThreadNodeAffinity(prev_node);
+    }
+  }
+
+  ~NumaLocklessHashMap() {
+    for (auto partition : partitions_) {
+      delete partition;
+    }
+  }
+
+  Status Lookup(K key, ValuePtr<V>** value_ptr) {
+    return Partition(key)->Lookup(key, value_ptr);
+  }
+
+  Status BatchLookup(const K* keys, size_t n, ValuePtr<V>** value_ptrs) {
+    for (size_t i = 0; i < n; ++i) {
+      if (!Partition(keys[i])->Lookup(keys[i], &value_ptrs[i]).ok()) {
+        value_ptrs[i] = nullptr;
+      }
+    }
+    return Status::OK();
+  }
+
+  Status Insert(K key, const ValuePtr<V>* value_ptr) {
+    return Partition(key)->Insert(key, value_ptr);
+  }
+
+  Status Remove(K key) {
+    return Partition(key)->Remove(key);
+  }
+
+  Status Reserve(int64 num_keys) {
+    for (auto partition : partitions_) {
+      TF_RETURN_IF_ERROR(
+          partition->Reserve(num_keys / num_partitions_ + 1));
+    }
+    return Status::OK();
+  }
+
+  Status BatchCommit(const std::vector<K>& keys,
+                     const std::vector<ValuePtr<V>*>& value_ptrs) {
+    return Status::OK();
+  }
+
+  Status GetSnapshot(std::vector<K>* key_list,
+                     std::vector<ValuePtr<V>* >* value_ptr_list) {
+    for (auto partition : partitions_) {
+      TF_RETURN_IF_ERROR(partition->GetSnapshot(key_list, value_ptr_list));
+    }
+    return Status::OK();
+  }
+
+  int64 Size() const {
+    int64 total = 0;
+    for (auto partition : partitions_) {
+      total += partition->Size();
+    }
+    return total;
+  }
+
+  std::string DebugString() const {
+    LOG(INFO) << "numa partition number:" << num_partitions_;
+    for (auto partition : partitions_) {
+      partition->DebugString();
+    }
+    return "";
+  }
+
+ private:
+  LocklessHashMap<K, V>* Partition(K key) const {
+    return partitions_[static_cast<uint64>(key) % num_partitions_];
+  }
+
+  int num_partitions_;
+  std::vector<LocklessHashMap<K, V>*> partitions_;
+};
+
 }  // namespace embedding
 }  // namespace tensorflow
 
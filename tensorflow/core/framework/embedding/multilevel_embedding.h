@@ -2,17 +2,21 @@
 #define TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_MULTILEVEL_EMBEDDING_H_
 
 #include "tensorflow/core/framework/embedding/cache.h"
+#include "tensorflow/core/framework/embedding/cache_capacity_controller.h"
 #include "tensorflow/core/framework/embedding/config.pb.h"
 #include "tensorflow/core/framework/embedding/dense_hash_map.h"
 #include "tensorflow/core/framework/embedding/leveldb_kv.h"
 #include "tensorflow/core/framework/embedding/ssd_hashkv.h"
 #include "tensorflow/core/framework/embedding/lockless_hash_map.h"
+#include "tensorflow/core/framework/embedding/tier_stats.h"
 #if GOOGLE_CUDA
 #if !TENSORFLOW_USE_GPU_EV
 #include "tensorflow/core/framework/embedding/lockless_hash_map_cpu.h"
+#include "tensorflow/core/framework/embedding/pinned_staging_pool.h"
 #endif  // TENSORFLOW_USE_GPU_EV
 #endif  // GOOGLE_CUDA
 #include "tensorflow/core/framework/embedding/kv_interface.h"
+#include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/core/status.h"
 
@@ -26,29 +30,47 @@ class EmbeddingVar;
 namespace embedding {
 
 struct StorageConfig {
-  StorageConfig() : type(StorageType::INVALID), path(""), layout_type(LayoutType::NORMAL) {
+  StorageConfig() : type(StorageType::INVALID), path(""), layout_type(LayoutType::NORMAL),
+                    cache_strategy(CacheStrategyFromEnv()) {
     size = {1<<30,1<<30,1<<30,1<<30};
   }
   StorageConfig(StorageType t,
                 const std::string& p,
                 const std::vector<int64>& s,
-                const std::string& layout) : type(t), path(p) {
+                const std::string& layout) : type(t), path(p),
+                                             cache_strategy(CacheStrategyFromEnv()) {
     if ("normal" == layout) {
       layout_type = LayoutType::NORMAL;
     } else if ("light" == layout) {
       layout_type = LayoutType::LIGHT;
     } else if ("normal_contiguous" == layout){
       layout_type = LayoutType::NORMAL_CONTIGUOUS;
+    } else if ("compressed" == layout) {
+      layout_type = LayoutType::COMPRESSED;
     } else {
       LOG(WARNING) << "Unknown layout: " << layout << ", use LayoutType::NORMAL by default.";
       layout_type = LayoutType::NORMAL;
     }
     size = s;
   }
+  static CacheStrategy CacheStrategyFromEnv() {
+    const char* strategy = std::getenv("TF_EMBEDDING_CACHE_STRATEGY");
+    if (strategy == nullptr) {
+      return CacheStrategy::LRU;
+    } else if (std::string(strategy) == "lfu") {
+      return CacheStrategy::LFU;
+    } else if (std::string(strategy) == "sharded_lru") {
+      return CacheStrategy::SHARDED_LRU;
+    } else {
+      return CacheStrategy::LRU;
+    }
+  }
+
   StorageType type;
   LayoutType layout_type;
   std::string path;
   std::vector<int64> size;
+  CacheStrategy cache_strategy;
 };
 
 template <class K, class V>
@@ -62,12 +84,17 @@ class StorageManager {
   sc_(sc),
   cache_(nullptr),
   cache_capacity_(cap),
+  pmem_capacity_(-1),
   eviction_thread_(nullptr),
   total_dims_(0),
   alloc_len_(0),
-  is_multi_level_(false) {}
+  is_multi_level_(false),
+  is_async_promotion_(false) {}
 
   ~StorageManager() {
+    if (sizing_handle_ != -1) {
+      CacheCapacityController::GetInstance()->Deregister(sizing_handle_);
+    }
     for (auto kv: kvs_) {
       delete kv.first;
     }
@@ -86,7 +113,19 @@ class StorageManager {
         break;
       case LayoutType::NORMAL_CONTIGUOUS:
         new_value_ptr_fn_ = [] (Allocator* alloc, size_t size) {
-          return new NormalContiguousValuePtr<V>(alloc, size); };
+          // Tiny rows get the inline layout: the payload lives in the
+          // ValuePtr object itself, saving the second allocation and
+          // the pointer chase per key. Same behavior otherwise.
+          if (size <= InlineValuePtr<V>::kInlineCapacity) {
+            return static_cast<ValuePtr<V>*>(
+                new InlineValuePtr<V>(alloc, size));
+          }
+          return static_cast<ValuePtr<V>*>(
+              new NormalContiguousValuePtr<V>(alloc, size)); };
+        break;
+      case LayoutType::COMPRESSED:
+        new_value_ptr_fn_ = [] (Allocator* alloc, size_t size) {
+          return new CompressedValuePtr<V>(alloc, size); };
         break;
       default:
         new_value_ptr_fn_ = [] (Allocator* alloc, size_t size) {
@@ -97,7 +136,7 @@ class StorageManager {
       Allocator* alloc_ssd;
       case StorageType::DRAM:
         VLOG(1) << "StorageManager::DRAM: " << name_;
-        kvs_.push_back(std::make_pair(new LocklessHashMap<K, V>(), ev_allocator()));
+        kvs_.push_back(std::make_pair(NewDramHashMap(), ev_allocator()));
         break;
       case StorageType::PMEM_MEMKIND:
         VLOG(1) << "StorageManager::PMEM_MEMKIND: " << name_;
@@ -109,19 +148,32 @@ class StorageManager {
                                       experimental_pmem_allocator(sc_.path, sc_.size[0])));
         break;
       case StorageType::LEVELDB:
-        VLOG(1) << "StorageManager::LEVELDB: " << name_;
-        kvs_.push_back(std::make_pair(new LevelDBKV<K, V>(sc_.path), ev_allocator()));
+        if (UseValueLogForLevelDB()) {
+          VLOG(1) << "StorageManager::LEVELDB(value log): " << name_;
+          alloc_ssd = ev_allocator();
+          kvs_.emplace_back(std::make_pair(new SSDHashKV<K, V>(sc_.path, alloc_ssd), alloc_ssd));
+        } else {
+          VLOG(1) << "StorageManager::LEVELDB: " << name_;
+          kvs_.push_back(std::make_pair(new LevelDBKV<K, V>(sc_.path), ev_allocator()));
+        }
         break;
       case StorageType::DRAM_PMEM:
         VLOG(1) << "StorageManager::DRAM_PMEM: " << name_;
-        kvs_.push_back(std::make_pair(new LocklessHashMap<K, V>(), ev_allocator()));
+        kvs_.push_back(std::make_pair(NewDramHashMap(), ev_allocator()));
         kvs_.push_back(std::make_pair(new LocklessHashMap<K, V>(),
                                       experimental_pmem_allocator(sc_.path, sc_.size[1])));
         break;
       case StorageType::DRAM_LEVELDB:
-        VLOG(1) << "StorageManager::DRAM_LEVELDB: " << name_;
-        kvs_.push_back(std::make_pair(new LocklessHashMap<K, V>(), ev_allocator()));
-        kvs_.push_back(std::make_pair(new LevelDBKV<K, V>(sc_.path), ev_allocator()));
+        if (UseValueLogForLevelDB()) {
+          VLOG(1) << "StorageManager::DRAM_LEVELDB(value log): " << name_;
+          alloc_ssd = ev_allocator();
+          kvs_.push_back(std::make_pair(NewDramHashMap(), ev_allocator()));
+          kvs_.emplace_back(std::make_pair(new SSDHashKV<K, V>(sc_.path, alloc_ssd), alloc_ssd));
+        } else {
+          VLOG(1) << "StorageManager::DRAM_LEVELDB: " << name_;
+          kvs_.push_back(std::make_pair(NewDramHashMap(), ev_allocator()));
+          kvs_.push_back(std::make_pair(new LevelDBKV<K, V>(sc_.path), ev_allocator()));
+        }
         break;
       case StorageType::SSDHASH:
         VLOG(1) << "StorageManager::SSDHASH: " << name_;
@@ -131,7 +183,15 @@ class StorageManager {
       case StorageType::DRAM_SSDHASH:
         VLOG(1) << "StorageManager::DRAM_SSDHASH: " << name_;
         alloc_ssd = ev_allocator();
-        kvs_.emplace_back(std::make_pair(new LocklessHashMap<K, V>(), alloc_ssd));
+        kvs_.emplace_back(std::make_pair(NewDramHashMap(), alloc_ssd));
+        kvs_.emplace_back(std::make_pair(new SSDHashKV<K, V>(sc_.path, alloc_ssd), alloc_ssd));
+        break;
+      case StorageType::DRAM_PMEM_SSDHASH:
+        VLOG(1) << "StorageManager::DRAM_PMEM_SSDHASH: " << name_;
+        alloc_ssd = ev_allocator();
+        kvs_.push_back(std::make_pair(NewDramHashMap(), ev_allocator()));
+        kvs_.push_back(std::make_pair(new LocklessHashMap<K, V>(),
+                                      experimental_pmem_allocator(sc_.path, sc_.size[1])));
         kvs_.emplace_back(std::make_pair(new SSDHashKV<K, V>(sc_.path, alloc_ssd), alloc_ssd));
         break;
       case StorageType::HBM_DRAM:
@@ -152,13 +212,30 @@ class StorageManager {
     }
 
     if (sc_.type == embedding::DRAM_PMEM || sc_.type == embedding::DRAM_SSDHASH ||
-        sc_.type == embedding::HBM_DRAM || sc_.type == embedding::DRAM_LEVELDB) {
+        sc_.type == embedding::HBM_DRAM || sc_.type == embedding::DRAM_LEVELDB ||
+        sc_.type == embedding::DRAM_PMEM_SSDHASH) {
       is_multi_level_ = true;
+      const char* async_promotion = std::getenv("TF_EMBEDDING_ASYNC_PROMOTION");
+      if (async_promotion != nullptr && async_promotion[0] == '1') {
+        LOG(INFO) << "Use async promotion in multi-tier embedding storage: "
+                  << name_;
+        is_async_promotion_ = true;
+      }
     }
 
     hash_table_count_ = kvs_.size();
     if (hash_table_count_ > 1) {
-      cache_ = new LRUCache<K>();
+      switch (sc_.cache_strategy) {
+        case CacheStrategy::LFU:
+          cache_ = new LFUCache<K>();
+          break;
+        case CacheStrategy::SHARDED_LRU:
+          cache_ = new ShardedLRUCache<K>();
+          break;
+        default:
+          cache_ = new LRUCache<K>();
+          break;
+      }
       eviction_thread_ = Env::Default()->StartThread(ThreadOptions(), "EV_Eviction",
                                                      [this]() { BatchEviction(); });
       thread_pool_.reset(new thread::ThreadPool(Env::Default(), ThreadOptions(),
@@ -166,7 +243,9 @@ class StorageManager {
                                                /*low_latency_hint=*/false));
     }
     // DebugString();
-    CHECK(2 >= hash_table_count_) << "Not support multi-level(>2) embedding.";
+    if (sc_.type != StorageType::DRAM_PMEM_SSDHASH) {
+      CHECK(2 >= hash_table_count_) << "Not support multi-level(>2) embedding.";
+    }
 
     return Status::OK();
   }
@@ -184,12 +263,42 @@ class StorageManager {
         kvs_[1].first->SetTotalDims(total_dims_);
       } else if (sc_.type == StorageType::HBM_DRAM) {
         kvs_[1].first->SetTotalDims(total_dims_);
+      } else if (sc_.type == StorageType::DRAM_PMEM_SSDHASH) {
+        kvs_[2].first->SetTotalDims(total_dims_);
       }
       if (hash_table_count_ > 1) {
         cache_capacity_ = sc_.size[0] / (total_dims_ * sizeof(V));
+        int64 cap_bytes = MemoryCapBytesFromEnv();
+        if (cap_bytes > 0) {
+          int64 cap_entries =
+              std::max(cap_bytes / (total_dims_ * static_cast<int64>(sizeof(V))),
+                       static_cast<int64>(1));
+          if (cap_entries < cache_capacity_) {
+            LOG(INFO) << "TF_EV_STORAGE_CAP_BYTES caps top tier of " << name_
+                      << " at " << cap_entries << " entries (was "
+                      << cache_capacity_ << "); overflow is evicted to the"
+                      << " lower tier.";
+            cache_capacity_ = cap_entries;
+          }
+        }
         done_ = true;
         LOG(INFO) << "Cache cache_capacity: " << cache_capacity_;
       }
+      if (sc_.type == StorageType::DRAM_PMEM_SSDHASH) {
+        pmem_capacity_ = sc_.size[1] / (total_dims_ * sizeof(V));
+        LOG(INFO) << "PMEM tier capacity: " << pmem_capacity_;
+      }
+      if (hash_table_count_ > 1 && sizing_handle_ == -1 &&
+          CacheCapacityController::Enabled()) {
+        sizing_handle_ = CacheCapacityController::GetInstance()->Register(
+            cache_capacity_,
+            [this]() {
+              int64 hits = __sync_lock_test_and_set(&level0_hits_, 0);
+              int64 misses = __sync_lock_test_and_set(&level0_misses_, 0);
+              return std::make_pair(hits, misses);
+            },
+            [this](int64 capacity) { cache_capacity_ = capacity; });
+      }
     }
     flag_.clear(std::memory_order_release);
   }
@@ -244,6 +353,7 @@ class StorageManager {
   }
 
   Status Get(K key, ValuePtr<V>** value_ptr) {
+    uint64 stats_begin = TierStatsCollector::Begin();
     Status s;
     int level = 0;
     for (; level < hash_table_count_; ++level) {
@@ -252,10 +362,126 @@ class StorageManager {
         break;
       }
     }
+    TierStatsCollector::Record(level, stats_begin);
     return s;
   }
 
+  // Batched Get: probe level 0 with one backend call, only keys missed
+  // there fall through to the lower tiers. Slots of keys absent from all
+  // tiers are left as nullptr.
+  Status BatchGet(const K* keys, size_t n, ValuePtr<V>** value_ptrs) {
+    if (ShouldProbeSpeculatively()) {
+      return SpeculativeBatchGet(keys, n, value_ptrs);
+    }
+    TF_RETURN_IF_ERROR(kvs_[0].first->BatchLookup(keys, n, value_ptrs));
+    size_t level0_hits = 0;
+    for (size_t i = 0; i < n; ++i) {
+      if (value_ptrs[i] != nullptr) {
+        ++level0_hits;
+      }
+    }
+    RecordBatchProbeStats(level0_hits, n);
+    for (int level = 1; level < hash_table_count_; ++level) {
+      BatchLookupMisses(level, keys, n, value_ptrs);
+    }
+    return Status::OK();
+  }
+
+  // Forwards the keys still unresolved after the upper tiers to one
+  // backend BatchLookup, compacted so an I/O-backed tier (e.g. the SSD
+  // value log's batched AIO reads) sees the whole miss set in a single
+  // call. Backends without a batched override fall back to per-key
+  // Lookup inside KVInterface.
+  void BatchLookupMisses(int level, const K* keys, size_t n,
+                         ValuePtr<V>** value_ptrs) {
+    std::vector<K> miss_keys;
+    std::vector<size_t> miss_slots;
+    for (size_t i = 0; i < n; ++i) {
+      if (value_ptrs[i] == nullptr) {
+        miss_keys.push_back(keys[i]);
+        miss_slots.push_back(i);
+      }
+    }
+    if (miss_keys.empty()) {
+      return;
+    }
+    std::vector<ValuePtr<V>*> miss_ptrs(miss_keys.size(), nullptr);
+    Status s = kvs_[level].first->BatchLookup(miss_keys.data(),
+        miss_keys.size(), miss_ptrs.data());
+    if (!s.ok()) {
+      return;
+    }
+    for (size_t j = 0; j < miss_slots.size(); ++j) {
+      value_ptrs[miss_slots[j]] = miss_ptrs[j];
+    }
+  }
+
+  // Speculative mode (TF_EV_SPECULATIVE_GET=1): once the recent level-0
+  // hit rate of batched gets drops below kSpeculativeHitRatePct, the
+  // bottom tier is probed for the whole batch on the cache thread pool
+  // while level 0 is probed on the calling thread. Results for keys
+  // level 0 served are discarded, trading read amplification on DRAM
+  // hits for one serialized tier of latency on the misses that dominate
+  // p99 of cold-ish tables.
+  Status SpeculativeBatchGet(const K* keys, size_t n,
+                             ValuePtr<V>** value_ptrs) {
+    const int bottom = hash_table_count_ - 1;
+    std::vector<ValuePtr<V>*> spec_ptrs(n, nullptr);
+    Notification spec_done;
+    thread_pool_->Schedule([this, keys, n, &spec_ptrs, &spec_done, bottom]() {
+      Status s = kvs_[bottom].first->BatchLookup(keys, n, spec_ptrs.data());
+      if (!s.ok()) {
+        LOG(WARNING) << "Speculative bottom-tier probe failed: "
+                     << s.ToString();
+      }
+      spec_done.Notify();
+    });
+    Status s0 = kvs_[0].first->BatchLookup(keys, n, value_ptrs);
+    size_t level0_hits = 0;
+    if (s0.ok()) {
+      for (size_t i = 0; i < n; ++i) {
+        if (value_ptrs[i] != nullptr) {
+          ++level0_hits;
+        }
+      }
+      RecordBatchProbeStats(level0_hits, n);
+      // Middle tiers of a three-level storage stay on the calling
+      // thread; only the bottom tier pays an I/O round trip worth
+      // hiding.
+      for (int level = 1; level < bottom; ++level) {
+        BatchLookupMisses(level, keys, n, value_ptrs);
+      }
+    }
+    spec_done.WaitForNotification();
+    for (size_t i = 0; i < n; ++i) {
+      if (spec_ptrs[i] == nullptr) {
+        continue;
+      }
+      if (s0.ok() && value_ptrs[i] == nullptr) {
+        value_ptrs[i] = spec_ptrs[i];
+      } else {
+        kvs_[bottom].first->FreeValuePtr(spec_ptrs[i]);
+      }
+    }
+    return s0;
+  }
+
+  // Whether the next BatchGet takes the speculative branch: only after
+  // the warm-up window, and only while the recent level-0 hit rate of
+  // batched gets sits below kSpeculativeHitRatePct.
+  bool ShouldProbeSpeculatively() {
+    if (!SpeculativeGetEnabled() || hash_table_count_ <= 1) {
+      return false;
+    }
+    int64 total = batch_probe_total_;
+    if (total < kSpeculativeWarmupKeys) {
+      return false;
+    }
+    return batch_probe_hits_ * 100 < total * kSpeculativeHitRatePct;
+  }
+
   Status GetOrCreate(K key, ValuePtr<V>** value_ptr, size_t size) {
+    uint64 stats_begin = TierStatsCollector::Begin();
     bool found = false;
     int level = 0;
     for (; level < hash_table_count_; ++level) {
@@ -265,6 +491,8 @@ class StorageManager {
         break;
       }
     }
+    TierStatsCollector::Record(level, stats_begin);
+    RecordLevel0Stats(found && level == 0);
     if (!found) {
       *value_ptr = new_value_ptr_fn_(kvs_[0].second, size);
     }
@@ -281,6 +509,22 @@ class StorageManager {
 #endif  // GOOGLE_CUDA
     }
     if (level || !found) {
+      if (found && is_async_promotion_) {
+        // Promotion off the critical path: hand the lower-tier value
+        // back to the caller right away and let the cache thread pool
+        // insert it into DRAM. If another thread promoted the key in
+        // the meantime, the duplicate is queued for the eviction
+        // thread's batched deallocation instead of being freed inline.
+        ValuePtr<V>* promote_ptr = *value_ptr;
+        Schedule([this, key, promote_ptr]() {
+          Status s = kvs_[0].first->Insert(key, promote_ptr);
+          if (!s.ok()) {
+            mutex_lock l(mu_);
+            value_ptr_out_of_date_.emplace_back(promote_ptr);
+          }
+        });
+        return Status::OK();
+      }
       Status s = kvs_[0].first->Insert(key, *value_ptr);
       if (s.ok()) {
         // Insert Success
@@ -297,6 +541,7 @@ class StorageManager {
   }
 
 Status GetOrCreate(K key, ValuePtr<V>** value_ptr, size_t size, bool &need_copyback) {
+    uint64 stats_begin = TierStatsCollector::Begin();
     bool found = false;
     int level = 0;
     need_copyback = false;
@@ -308,6 +553,8 @@ Status GetOrCreate(K key, ValuePtr<V>** value_ptr, size_t size, bool &need_copyb
         break;
       }
     }
+    TierStatsCollector::Record(level, stats_begin);
+    RecordLevel0Stats(found && level == 0);
     if (!found) {
       *value_ptr = new_value_ptr_fn_(kvs_[0].second, size);
     }
@@ -335,9 +582,23 @@ Status GetOrCreate(K key, ValuePtr<V>** value_ptr, size_t size, bool &need_copyb
 #if !TENSORFLOW_USE_GPU_EV
   void CopyBackToGPU(int total, K* keys, int64 size, bool* copyback_flags,
                      V** memcpy_address, size_t value_len, int *copyback_cursor,
-                     ValuePtr<V> **gpu_value_ptrs, V* memcpy_buffer_gpu){
-    V *memcpy_buffer_cpu;
-    memcpy_buffer_cpu = (V*)malloc(total * value_len * sizeof(V));
+                     ValuePtr<V> **gpu_value_ptrs, V* memcpy_buffer_gpu,
+                     PinnedStagingPool* staging_pool){
+    // Rows are staged through pinned chunks so the H2D DMA of one chunk
+    // overlaps the host-side row assembly of the next; staging through a
+    // pageable malloc'd buffer would force each copy to run synchronously.
+    const size_t kStagingChunkBytes = 1 << 20;
+    const size_t row_bytes = value_len * sizeof(V);
+    int chunk_rows = kStagingChunkBytes / row_bytes;
+    if (chunk_rows < 1) {
+      chunk_rows = 1;
+    }
+    if (chunk_rows > total && total > 0) {
+      chunk_rows = total;
+    }
+    V* memcpy_buffer_cpu =
+        (V*)staging_pool->Acquire(chunk_rows * row_bytes);
+    int chunk_start = 0;
     int j = 0;
     for (int i = 0; i < size;i++) {
       if (copyback_flags[i]) {
@@ -348,20 +609,42 @@ Status GetOrCreate(K key, ValuePtr<V>** value_ptr, size_t size, bool &need_copyb
                sizeof(FixedLengthHeader));
         V* cpu_data_address = memcpy_address[i];
         V* gpu_data_address = gpu_value_ptr->GetValue(0, 0);
-        memcpy(memcpy_buffer_cpu + j * value_len, cpu_data_address, value_len * sizeof(V));
+        memcpy(memcpy_buffer_cpu + (j - chunk_start) * value_len,
+               cpu_data_address, row_bytes);
         copyback_cursor[j] = i;
         gpu_value_ptrs[j] = gpu_value_ptr;
         j++;
         kvs_[0].first->Insert(keys[i], gpu_value_ptr);
+        if (j - chunk_start == chunk_rows) {
+          cudaMemcpyAsync(memcpy_buffer_gpu + chunk_start * value_len,
+                          memcpy_buffer_cpu,
+                          (j - chunk_start) * row_bytes,
+                          cudaMemcpyHostToDevice, NULL);
+          staging_pool->MarkCopyIssued(memcpy_buffer_cpu, NULL);
+          chunk_start = j;
+          memcpy_buffer_cpu =
+              (V*)staging_pool->Acquire(chunk_rows * row_bytes);
+        }
       }
     }
-
-    cudaMemcpy(memcpy_buffer_gpu, memcpy_buffer_cpu,
-               total * value_len * sizeof(V), cudaMemcpyHostToDevice);
+    if (j > chunk_start) {
+      cudaMemcpyAsync(memcpy_buffer_gpu + chunk_start * value_len,
+                      memcpy_buffer_cpu,
+                      (j - chunk_start) * row_bytes,
+                      cudaMemcpyHostToDevice, NULL);
+      staging_pool->MarkCopyIssued(memcpy_buffer_cpu, NULL);
+    }
   }
 #endif  // TENSORFLOW_USE_GPU_EV
 #endif  // GOOGLE_CUDA
 
+  // Inserts a caller-constructed ValuePtr into the top tier; used by
+  // the mmap restore path which builds its own ValuePtrs around the
+  // checkpoint mapping.
+  Status Insert(K key, ValuePtr<V>* value_ptr) {
+    return kvs_[0].first->Insert(key, value_ptr);
+  }
+
   Status Remove(K key) {
     for (auto kv : kvs_) {
       kv.first->Remove(key);
@@ -381,6 +664,16 @@ Status GetOrCreate(K key, ValuePtr<V>** value_ptr, size_t size, bool &need_copyb
     return cache_capacity_;
   }
 
+  // Estimated resident bytes for this table: the aligned payload floats
+  // per entry (total_dims_) plus the ValuePtr header, summed over all
+  // tiers. total_dims_ is only known after SetAllocLen(), so calls made
+  // before the first lookup report zero.
+  int64 MemoryUsage() const {
+    const int64 bytes_per_entry =
+        total_dims_ * static_cast<int64>(sizeof(V)) + sizeof(ValuePtr<V>);
+    return Size() * bytes_per_entry;
+  }
+
   Status GetSnapshot(std::vector<K>* key_list,
                      std::vector<ValuePtr<V>* >* value_ptr_list) {
     for (auto kv : kvs_) {
@@ -463,6 +756,28 @@ Status GetOrCreate(K key, ValuePtr<V>** value_ptr, size_t size, bool &need_copyb
     return Status::OK();
   }
 
+  // Runs the steps_to_live expiry scan on a dedicated service thread
+  // when TF_EV_BACKGROUND_EXPIRED_EVICTION=1, so callers (the save path
+  // today) are not stalled by a full-table walk and one-by-one frees.
+  // The caller only records the latest global step; a scan that is
+  // already running picks it up on its next round.
+  Status ShrinkAsync(int64 gs, int64 steps_to_live) {
+    const char* background = std::getenv("TF_EV_BACKGROUND_EXPIRED_EVICTION");
+    if (background == nullptr || background[0] != '1') {
+      return Shrink(gs, steps_to_live);
+    }
+    mutex_lock l(shrink_mu_);
+    pending_shrink_gs_ = gs;
+    pending_steps_to_live_ = steps_to_live;
+    if (shrink_thread_ == nullptr) {
+      shrink_thread_.reset(
+          Env::Default()->StartThread(ThreadOptions(), "EV_ExpiredEviction",
+                                      [this]() { ExpiredEvictionLoop(); }));
+    }
+    shrink_cv_.notify_all();
+    return Status::OK();
+  }
+
   Status Shrink(int64 gs, int64 steps_to_live) {
     mutex_lock l(mu_);
     for (auto kv : kvs_) {
@@ -497,6 +812,19 @@ Status GetOrCreate(K key, ValuePtr<V>** value_ptr, size_t size, bool &need_copyb
       shutdown_ = true;
     }
     delete eviction_thread_;
+    if (shrink_thread_ != nullptr) {
+      {
+        mutex_lock sl(shrink_mu_);
+        shrink_shutdown_ = true;
+        shrink_cv_.notify_all();
+      }
+      shrink_thread_.reset();
+      for (auto& expired : expired_value_ptrs_) {
+        expired.first->Destroy(expired.second);
+        delete expired.first;
+      }
+      expired_value_ptrs_.clear();
+    }
     mutex_lock l(mu_);
     std::vector<K> key_list;
     std::vector<ValuePtr<V>* > value_ptr_list;
@@ -525,6 +853,10 @@ Status GetOrCreate(K key, ValuePtr<V>** value_ptr, size_t size, bool &need_copyb
     return Status::OK();
   }
 
+  Status Reserve(int64 num_keys) {
+    return kvs_[0].first->Reserve(num_keys);
+  }
+
   void FreeValuePtr(ValuePtr<V>* value_ptr) {
     for (auto kv : kvs_) {
       kv.first->FreeValuePtr(value_ptr);
@@ -534,6 +866,45 @@ Status GetOrCreate(K key, ValuePtr<V>** value_ptr, size_t size, bool &need_copyb
   mutex* get_mutex() { return &mu_; }
 
  private:
+  // Optional per-table byte budget for the top tier. When set, the top
+  // tier is shrunk so a runaway table spills to the lower tier instead
+  // of taking the whole PS down.
+  static int64 MemoryCapBytesFromEnv() {
+    const char* cap = std::getenv("TF_EV_STORAGE_CAP_BYTES");
+    if (cap == nullptr) {
+      return 0;
+    }
+    return strtoll(cap, nullptr, 10);
+  }
+
+  // When TF_EV_LEVELDB_USE_VALUE_LOG=1, LEVELDB-configured tiers are
+  // backed by the append-only value-log store (SSDHashKV: log files
+  // plus an in-DRAM lockless index and buffered group commits) instead
+  // of LevelDB, which pays LSM compaction and block-cache overhead for
+  // what are pure point lookups of fixed-size rows. The on-disk
+  // formats are not compatible: do not flip this over an existing
+  // leveldb path.
+  static bool UseValueLogForLevelDB() {
+    const char* flag = std::getenv("TF_EV_LEVELDB_USE_VALUE_LOG");
+    return flag != nullptr && flag[0] == '1';
+  }
+
+  static bool SpeculativeGetEnabled() {
+    const char* flag = std::getenv("TF_EV_SPECULATIVE_GET");
+    return flag != nullptr && flag[0] == '1';
+  }
+
+  KVInterface<K, V>* NewDramHashMap() {
+    const char* numa_partition = std::getenv("TF_EV_NUMA_PARTITION");
+    if (numa_partition != nullptr && numa_partition[0] == '1' &&
+        port::NUMAEnabled() && port::NUMANumNodes() > 1) {
+      LOG(INFO) << "Use NUMA-partitioned hash map for embedding storage: "
+                << name_;
+      return new NumaLocklessHashMap<K, V>();
+    }
+    return new LocklessHashMap<K, V>();
+  }
+
   void BatchEviction() {
     Env* env = Env::Default();
     const int EvictionSize = 10000;
@@ -559,6 +930,11 @@ Status GetOrCreate(K key, ValuePtr<V>** value_ptr, size_t size, bool &need_copyb
         delete value_ptr_out_of_date_[i];
       }
       value_ptr_out_of_date_.clear();
+      for (int i = 0; i < value_ptr_out_of_date_pmem_.size(); i++) {
+        value_ptr_out_of_date_pmem_[i]->Destroy(kvs_[1].second);
+        delete value_ptr_out_of_date_pmem_[i];
+      }
+      value_ptr_out_of_date_pmem_.clear();
       int cache_count = cache_->size();
       if (cache_count > cache_capacity_) {
         // eviction
@@ -592,6 +968,10 @@ Status GetOrCreate(K key, ValuePtr<V>** value_ptr, size_t size, bool &need_copyb
                     << (double)(end.tv_sec - start.tv_sec) * EnvTime::kSecondsToMillis +
                        (end.tv_nsec - start.tv_nsec) / EnvTime::kMillisToNanos<< "ms";
         } else {
+          // evic_ids is a sorted run; under
+          // TF_EV_LEVELDB_ASYNC_WRITEBACK these Commits only stage the
+          // rows and a background writer group-commits them as one
+          // ordered WriteBatch (see leveldb_kv.h).
           for (int64 i = 0; i < true_size; ++i) {
             if (kvs_[0].first->Lookup(evic_ids[i], &value_ptr).ok()) {
               TF_CHECK_OK(kvs_[1].first->Commit(evic_ids[i], value_ptr));
@@ -601,19 +981,112 @@ Status GetOrCreate(K key, ValuePtr<V>** value_ptr, size_t size, bool &need_copyb
               // bypass
             }
           }
+          SpillMiddleTier();
         }
       }
     }
   }
 
  private:
+  void ExpiredEvictionLoop() {
+    while (true) {
+      int64 gs, steps_to_live;
+      {
+        mutex_lock l(shrink_mu_);
+        while (pending_shrink_gs_ == -1 && !shrink_shutdown_) {
+          shrink_cv_.wait(l);
+        }
+        if (shrink_shutdown_) {
+          break;
+        }
+        gs = pending_shrink_gs_;
+        steps_to_live = pending_steps_to_live_;
+        pending_shrink_gs_ = -1;
+      }
+      // Free what the previous round unlinked: every reader that could
+      // still hold one of those pointers has left the table by now, and
+      // returning the whole batch at once keeps the allocator out of
+      // the scan loop.
+      for (auto& expired : expired_value_ptrs_) {
+        expired.first->Destroy(expired.second);
+        delete expired.first;
+      }
+      expired_value_ptrs_.clear();
+      for (auto kv : kvs_) {
+        std::vector<K> key_list;
+        std::vector<ValuePtr<V>*> value_ptr_list;
+        TF_CHECK_OK(kv.first->GetSnapshot(&key_list, &value_ptr_list));
+        for (int64 i = 0; i < key_list.size(); ++i) {
+          int64 version = value_ptr_list[i]->GetStep();
+          if (version == -1) {
+            value_ptr_list[i]->SetStep(gs);
+          } else if (gs - version > steps_to_live) {
+            if (kv.first->Remove(key_list[i]).ok()) {
+              expired_value_ptrs_.emplace_back(value_ptr_list[i], kv.second);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  void RecordBatchProbeStats(size_t hits, size_t n) {
+    __sync_fetch_and_add(&batch_probe_hits_, static_cast<int64>(hits));
+    int64 total =
+        __sync_add_and_fetch(&batch_probe_total_, static_cast<int64>(n));
+    // Age the window so the mode switches off again once the cache
+    // warms up.
+    if (total >= kSpeculativeWindowKeys) {
+      __sync_lock_test_and_set(&batch_probe_total_, total / 2);
+      __sync_lock_test_and_set(&batch_probe_hits_, batch_probe_hits_ / 2);
+    }
+  }
+
+  void RecordLevel0Stats(bool hit) {
+    if (sizing_handle_ == -1) {
+      return;
+    }
+    if (hit) {
+      __sync_fetch_and_add(&level0_hits_, 1);
+    } else {
+      __sync_fetch_and_add(&level0_misses_, 1);
+    }
+  }
+
+  // Demotes overflow from the middle (PMEM) tier to the bottom tier
+  // when a three-level storage is configured. The middle tier keeps no
+  // recency of its own, so an arbitrary batch is demoted; keys that are
+  // still hot come back through the read path like any other miss.
+  void SpillMiddleTier() {
+    if (kvs_.size() <= 2 || pmem_capacity_ <= 0) {
+      return;
+    }
+    int64 to_demote = kvs_[1].first->Size() - pmem_capacity_;
+    if (to_demote <= 0) {
+      return;
+    }
+    std::vector<K> key_list;
+    std::vector<ValuePtr<V>*> value_ptr_list;
+    TF_CHECK_OK(kvs_[1].first->GetSnapshot(&key_list, &value_ptr_list));
+    for (int64 i = 0; i < key_list.size() && to_demote > 0; ++i) {
+      if (!kvs_[1].first->Remove(key_list[i]).ok()) {
+        continue;
+      }
+      TF_CHECK_OK(kvs_[2].first->Commit(key_list[i], value_ptr_list[i]));
+      value_ptr_out_of_date_pmem_.emplace_back(value_ptr_list[i]);
+      --to_demote;
+    }
+  }
+
   int32 hash_table_count_;
   std::string name_;
   std::vector<std::pair<KVInterface<K, V>*, Allocator*>> kvs_;
   std::vector<ValuePtr<V>*> value_ptr_out_of_date_;
+  std::vector<ValuePtr<V>*> value_ptr_out_of_date_pmem_;
   std::function<ValuePtr<V>*(Allocator*, size_t)> new_value_ptr_fn_;
   StorageConfig sc_;
   bool is_multi_level_;
+  bool is_async_promotion_;
 
   int64 alloc_len_;
   int64 total_dims_;
@@ -622,6 +1095,17 @@ Status GetOrCreate(K key, ValuePtr<V>** value_ptr, size_t size, bool &need_copyb
   Thread* eviction_thread_;
   BatchCache<K>* cache_;
   int64 cache_capacity_;
+  int64 pmem_capacity_;
+  int64 sizing_handle_ = -1;
+  int64 level0_hits_ = 0;
+  int64 level0_misses_ = 0;
+  // Sliding window of level-0 hits over batched gets, driving the
+  // speculative probe of the bottom tier.
+  int64 batch_probe_hits_ = 0;
+  int64 batch_probe_total_ = 0;
+  static const int64 kSpeculativeHitRatePct = 80;
+  static const int64 kSpeculativeWarmupKeys = 1 << 14;
+  static const int64 kSpeculativeWindowKeys = 1 << 20;
   mutex mu_;
   condition_variable shutdown_cv_;
   volatile bool shutdown_ GUARDED_BY(mu_) = false;
@@ -629,6 +1113,15 @@ Status GetOrCreate(K key, ValuePtr<V>** value_ptr, size_t size, bool &need_copyb
   volatile bool done_ = false;
   std::atomic_flag flag_ = ATOMIC_FLAG_INIT;
 
+  mutex shrink_mu_;
+  condition_variable shrink_cv_;
+  std::unique_ptr<Thread> shrink_thread_;
+  int64 pending_shrink_gs_ GUARDED_BY(shrink_mu_) = -1;
+  int64 pending_steps_to_live_ GUARDED_BY(shrink_mu_) = 0;
+  bool shrink_shutdown_ GUARDED_BY(shrink_mu_) = false;
+  // Owned by the eviction service thread outside of Destroy().
+  std::vector<std::pair<ValuePtr<V>*, Allocator*>> expired_value_ptrs_;
+
 };
 
 } // embedding
@@ -0,0 +1,111 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_PINNED_STAGING_POOL_H_
+#define TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_PINNED_STAGING_POOL_H_
+
+#if GOOGLE_CUDA
+#if !TENSORFLOW_USE_GPU_EV
+
+#include <algorithm>
+
+#include "cuda_runtime.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace embedding {
+
+// Double-buffered pinned staging area for the host-to-device copies of an
+// HBM_DRAM EmbeddingVar. Staging through pageable memory forces the CUDA
+// driver to copy synchronously through its own bounce buffer; copies issued
+// from pinned memory run as true async DMA, so the host can assemble the
+// next chunk of rows while the previous one is in flight.
+//
+// The two buffers grow on demand and are reused across batches. Each buffer
+// carries an event recorded when a copy is issued from it, and Acquire waits
+// on that event so a buffer is never rewritten while its DMA is still
+// draining. The pool is owned by one EmbeddingVar and relies on the same
+// assumption as the GetBuffer scratch allocations: a single variable is not
+// gathered concurrently from multiple steps.
+class PinnedStagingPool {
+ public:
+  PinnedStagingPool() {}
+
+  ~PinnedStagingPool() {
+    for (auto& buf : buffers_) {
+      if (buf.ptr != nullptr) {
+        cudaFreeHost(buf.ptr);
+        cudaEventDestroy(buf.event);
+      }
+    }
+  }
+
+  // Returns a pinned host buffer of at least `bytes`, alternating between
+  // the two buffers. Blocks only until the copy previously issued from the
+  // returned buffer has drained, not until the other buffer is free.
+  void* Acquire(size_t bytes) {
+    Buffer& buf = buffers_[next_];
+    next_ ^= 1;
+    if (buf.event_recorded) {
+      cudaEventSynchronize(buf.event);
+      buf.event_recorded = false;
+    }
+    if (buf.size < bytes) {
+      if (buf.ptr != nullptr) {
+        cudaFreeHost(buf.ptr);
+      } else {
+        cudaEventCreateWithFlags(&buf.event, cudaEventDisableTiming);
+      }
+      // Grow geometrically so a ramping batch size settles after a few
+      // reallocations instead of reallocating every step.
+      size_t new_size = std::max(bytes, buf.size * 2);
+      cudaHostAlloc(&buf.ptr, new_size, cudaHostAllocPortable);
+      buf.size = new_size;
+    }
+    return buf.ptr;
+  }
+
+  // Marks that an async copy has been issued on `stream` from the buffer
+  // returned by Acquire, so the next Acquire of the same buffer waits for
+  // the DMA instead of corrupting it.
+  void MarkCopyIssued(void* ptr, cudaStream_t stream) {
+    for (auto& buf : buffers_) {
+      if (buf.ptr == ptr) {
+        cudaEventRecord(buf.event, stream);
+        buf.event_recorded = true;
+        return;
+      }
+    }
+  }
+
+ private:
+  struct Buffer {
+    void* ptr = nullptr;
+    size_t size = 0;
+    cudaEvent_t event;
+    bool event_recorded = false;
+  };
+
+  Buffer buffers_[2];
+  int next_ = 0;
+};
+
+}  // namespace embedding
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_USE_GPU_EV
+#endif  // GOOGLE_CUDA
+
+#endif  // TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_PINNED_STAGING_POOL_H_
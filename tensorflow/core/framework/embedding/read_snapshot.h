@@ -0,0 +1,207 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_READ_SNAPSHOT_H_
+#define TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_READ_SNAPSHOT_H_
+
+#include <atomic>
+#include <map>
+#include <string>
+
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+namespace embedding {
+
+// Epoch-based read/write coordination between embedding lookups and the
+// delta-import path. Without it a single inference request can read
+// table A before an online update and table B after it, skewing scores.
+//
+// Readers (session runs that gather from EmbeddingVars) enter the epoch
+// with one atomic increment on a thread-sharded cacheline and leave the
+// same way; there are no locks on the lookup fast path. A delta import
+// bumps the table's entry in a global version vector (odd while the
+// import is applying), then waits for every reader that entered before
+// the bump to drain before touching the table. Readers that arrive
+// during the drain do not block the writer forever: only entries
+// counted at the snapshot are waited on, so the wait is bounded by the
+// longest in-flight request.
+//
+// Opt-in via TF_EV_CONSISTENT_LOOKUP=true; imports are delayed by up to
+// one in-flight request, which is acceptable for a background path.
+class EmbeddingReadEpoch {
+ public:
+  static EmbeddingReadEpoch* GetInstance() {
+    static EmbeddingReadEpoch* instance = new EmbeddingReadEpoch;
+    return instance;
+  }
+
+  static bool Enabled() {
+    static const bool enabled = [] {
+      bool b = false;
+      TF_CHECK_OK(ReadBoolFromEnvVar("TF_EV_CONSISTENT_LOOKUP", false, &b));
+      return b;
+    }();
+    return enabled;
+  }
+
+  // Reader side. EnterRead returns the shard the caller incremented;
+  // the matching ExitRead must pass it back.
+  int EnterRead() {
+    const int shard = ShardForThisThread();
+    // seq_cst so the table reads that follow cannot be hoisted above
+    // the entry the writer snapshots.
+    shards_[shard].entries.fetch_add(1, std::memory_order_seq_cst);
+    return shard;
+  }
+
+  void ExitRead(int shard) {
+    shards_[shard].exits.fetch_add(1, std::memory_order_release);
+  }
+
+  // Writer side. BeginUpdate bumps the table version to odd and drains
+  // the readers that entered before the bump; EndUpdate bumps it to
+  // even. Concurrent imports of different tables each drain
+  // independently.
+  void BeginUpdate(const std::string& table) {
+    {
+      mutex_lock l(mu_);
+      ++versions_[table];
+    }
+    WaitForReaders();
+  }
+
+  void EndUpdate(const std::string& table) {
+    int64 version;
+    {
+      mutex_lock l(mu_);
+      version = ++versions_[table];
+    }
+    LOG(INFO) << "EmbeddingReadEpoch: table " << table << " now at version "
+              << version;
+  }
+
+  int64 TableVersion(const std::string& table) {
+    mutex_lock l(mu_);
+    auto it = versions_.find(table);
+    return it == versions_.end() ? 0 : it->second;
+  }
+
+  std::string VersionVectorDebugString() {
+    mutex_lock l(mu_);
+    std::string s;
+    for (const auto& it : versions_) {
+      strings::StrAppend(&s, it.first, "=", it.second, " ");
+    }
+    return s;
+  }
+
+ private:
+  EmbeddingReadEpoch() = default;
+
+  // Same shard count and rationale as StepStatsCollector: executor
+  // threads hash onto distinct cachelines so concurrent runs do not
+  // bounce one counter between cores.
+  static constexpr int kNumShards = 16;
+
+  struct alignas(64) ReaderShard {
+    std::atomic<int64> entries{0};
+    std::atomic<int64> exits{0};
+  };
+
+  static int ShardForThisThread() {
+    static thread_local int32 thread_id = Env::Default()->GetCurrentThreadId();
+    return static_cast<uint32>(thread_id) % kNumShards;
+  }
+
+  void WaitForReaders() {
+    int64 snapshot[kNumShards];
+    for (int i = 0; i < kNumShards; ++i) {
+      snapshot[i] = shards_[i].entries.load(std::memory_order_seq_cst);
+    }
+    while (true) {
+      bool drained = true;
+      for (int i = 0; i < kNumShards; ++i) {
+        if (shards_[i].exits.load(std::memory_order_acquire) < snapshot[i]) {
+          drained = false;
+          break;
+        }
+      }
+      if (drained) return;
+      Env::Default()->SleepForMicroseconds(kDrainPollMicros);
+    }
+  }
+
+  static constexpr int64 kDrainPollMicros = 100;
+
+  ReaderShard shards_[kNumShards];
+  mutex mu_;
+  std::map<std::string, int64> versions_ GUARDED_BY(mu_);
+};
+
+// Step-container resource that keeps one session run inside the read
+// epoch. The first gather of a run creates it; the step container is
+// cleaned up when the run finishes, so every gather of the run — across
+// all tables — observes either the pre-import or the post-import state,
+// never a mix.
+class ReadEpochTicket : public ResourceBase {
+ public:
+  ReadEpochTicket()
+      : shard_(EmbeddingReadEpoch::GetInstance()->EnterRead()) {}
+
+  ~ReadEpochTicket() override {
+    EmbeddingReadEpoch::GetInstance()->ExitRead(shard_);
+  }
+
+  string DebugString() const override { return "ReadEpochTicket"; }
+
+ private:
+  const int shard_;
+};
+
+// Pins the calling op's step to the read epoch. Cheap when the feature
+// is off (one latched bool); when on, one step-container resource
+// lookup per gather.
+inline void PinStepToReadEpoch(OpKernelContext* c) {
+  if (!EmbeddingReadEpoch::Enabled()) return;
+  ScopedStepContainer* step_container = c->step_container();
+  if (step_container == nullptr) return;
+  ReadEpochTicket* ticket = nullptr;
+  // Going through the ScopedStepContainer marks it dirty so the ticket
+  // is destroyed (and the epoch exited) when the run's cleanup fires.
+  Status s = step_container->LookupOrCreate<ReadEpochTicket>(
+      c->resource_manager(), "ev_read_epoch_ticket", &ticket,
+      [](ReadEpochTicket** t) {
+        *t = new ReadEpochTicket;
+        return Status::OK();
+      });
+  if (s.ok()) {
+    ticket->Unref();
+  } else {
+    LOG_EVERY_N(WARNING, 1000)
+        << "EmbeddingReadEpoch: failed to pin step to read epoch: " << s;
+  }
+}
+
+}  // namespace embedding
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_READ_SNAPSHOT_H_
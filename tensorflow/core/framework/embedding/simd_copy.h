@@ -0,0 +1,69 @@
+/* Copyright 2015 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_SIMD_COPY_H_
+#define TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_SIMD_COPY_H_
+
+#include <cstring>
+
+#include "tensorflow/core/platform/types.h"
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace tensorflow {
+namespace embedding {
+
+// Copies one embedding row of `len` elements from `src` to `dst`.
+// Rows assembled by KvResourceGatherOp are short (typically 8~256
+// floats), so the fixed call and loop setup cost of memcpy dominates;
+// the wide-register loops below keep the copy on the vector units
+// when the build targets AVX2/AVX-512. The ISA is selected at build
+// time, matching how Eigen picks its packet width.
+template <class V>
+inline void CopyEmbRow(V* dst, const V* src, int64 len) {
+  memcpy(dst, src, sizeof(V) * len);
+}
+
+#if defined(__AVX512F__)
+template <>
+inline void CopyEmbRow<float>(float* dst, const float* src, int64 len) {
+  int64 i = 0;
+  for (; i + 16 <= len; i += 16) {
+    _mm512_storeu_ps(dst + i, _mm512_loadu_ps(src + i));
+  }
+  if (i < len) {
+    __mmask16 mask = (1 << (len - i)) - 1;
+    _mm512_mask_storeu_ps(dst + i, mask, _mm512_maskz_loadu_ps(mask, src + i));
+  }
+}
+#elif defined(__AVX2__)
+template <>
+inline void CopyEmbRow<float>(float* dst, const float* src, int64 len) {
+  int64 i = 0;
+  for (; i + 8 <= len; i += 8) {
+    _mm256_storeu_ps(dst + i, _mm256_loadu_ps(src + i));
+  }
+  if (i < len) {
+    memcpy(dst + i, src + i, sizeof(float) * (len - i));
+  }
+}
+#endif
+
+}  // namespace embedding
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_SIMD_COPY_H_
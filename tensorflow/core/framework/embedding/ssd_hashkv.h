@@ -1,6 +1,7 @@
 #ifndef TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_SSD_HASHKV_H_
 #define TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_SSD_HASHKV_H_
 
+#include <aio.h>
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
@@ -14,7 +15,9 @@
 
 #include "sparsehash/dense_hash_map_lockless"
 #include "sparsehash/dense_hash_set_lockless"
+#include "tensorflow/core/framework/embedding/compaction_scheduler.h"
 #include "tensorflow/core/framework/embedding/kv_interface.h"
+#include "tensorflow/core/framework/embedding/kv_stats.h"
 #include "tensorflow/core/framework/embedding/value_ptr.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/core/threadpool.h"
@@ -84,6 +87,13 @@ class EmbFile {
     file_addr = (char*)mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
   }
 
+  // Asks the kernel to start paging the file in; the full-table scan
+  // of SSDIterator calls this on file N+1 while it decodes file N so
+  // the read overlaps serialization.
+  void Readahead() {
+    posix_fadvise(fd, 0, file_size, POSIX_FADV_WILLNEED);
+  }
+
   void Unmap() { munmap((void*)file_addr, file_size); }
 
   void ReadWithoutMap(char* val, const size_t val_len, const size_t offset) {
@@ -102,10 +112,18 @@ class EmbFile {
   }
 
   void Read(char* val, const size_t val_len, const size_t offset) {
-    char* file_addr_tmp =
-        (char*)mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
-    memcpy(val, file_addr_tmp + offset, val_len);
-    munmap((void*)file_addr_tmp, file_size);
+    // pread on the already-open fd; mapping the whole file per key
+    // costs two mmap syscalls and TLB shootdowns for a 4KB read.
+    size_t nread = 0;
+    while (nread < val_len) {
+      ssize_t ret = pread(fd, val + nread, val_len - nread, offset + nread);
+      if (ret <= 0) {
+        LOG(ERROR) << "Failed to read " << filepath << " at offset "
+                   << offset + nread << ": " << strerror(errno);
+        break;
+      }
+      nread += ret;
+    }
   }
  public:
   size_t app_count;
@@ -152,6 +170,9 @@ class SSDIterator : public Iterator {
     if (file_id_vec_.size() > 0) {
       int64 f_id = file_id_vec_[curr_file_];
       emb_files_[f_id]->Map();
+      if (file_id_vec_.size() > 1) {
+        emb_files_[file_id_vec_[1]]->Readahead();
+      }
     }
   }
   virtual void Next() {
@@ -161,8 +182,14 @@ class SSDIterator : public Iterator {
       emb_files_[f_id]->Unmap();
       curr_vec_ = 0;
       curr_file_++;
-      if (curr_file_ < file_id_vec_.size())
+      if (curr_file_ < file_id_vec_.size()) {
+        // The current file was prefetched while the previous one was
+        // decoded; kick off readahead for the one after it.
         emb_files_[file_id_vec_[curr_file_]]->Map();
+        if (curr_file_ + 1 < file_id_vec_.size()) {
+          emb_files_[file_id_vec_[curr_file_ + 1]]->Readahead();
+        }
+      }
     }
   }
   virtual void Key(char* val, int64 dim) {
@@ -206,9 +233,11 @@ class SSDHashKV : public KVInterface<K, V> {
     alloc(alloc_),
     total_app_count(0),
     val_len(-1),
+    flushes_since_snapshot_(0),
     compaction_thread(nullptr) {
     path_ = io::JoinPath(
         path, "ssd_kv_" + std::to_string(Env::Default()->NowMicros()) + "_");
+    compaction_scheduler_ = new CompactionScheduler(path_);
     hash_map.max_load_factor(0.8);
     hash_map.set_empty_key_and_value(-1, nullptr);
     hash_map.set_counternum(16);
@@ -222,6 +251,12 @@ class SSDHashKV : public KVInterface<K, V> {
     new_value_ptr_fn_ = [this](size_t size) {
       return new NormalContiguousValuePtr<V>(alloc, size);
     };
+    const char* batch_aio = std::getenv("TF_SSDHASH_BATCH_AIO_READ");
+    use_batch_aio_ = (batch_aio != nullptr && batch_aio[0] == '1');
+    if (use_batch_aio_) {
+      LOG(INFO) << "Use batched AIO read in SSDHashKV of Multi-tier "
+                << "Embedding Storage!";
+    }
     is_async_compaction = std::getenv("TF_SSDHASH_ASYNC_COMPACTION");
     if (is_async_compaction == nullptr|| is_async_compaction[0] == '0') {
       LOG(INFO)<<"Use Sync Compactor in SSDHashKV of Multi-tier Embedding Stroage!";
@@ -240,6 +275,25 @@ class SSDHashKV : public KVInterface<K, V> {
       compaction_thread = Env::Default()->StartThread(ThreadOptions(), "COMPACTION",
                                                      [this]() { CompactionThread(); });
     }
+    stats_id_ = KVStatsCollector::GetInstance()->Register(
+        strings::StrCat("SSDHashKV@",
+                        strings::Hex(reinterpret_cast<uint64>(this))),
+        [this](KVStatsSnapshot* snap) {
+          snap->size = hash_map.size_lockless();
+          snap->capacity = hash_map.bucket_count();
+          snap->load_factor = hash_map.load_factor();
+          snap->max_load_factor = hash_map.max_load_factor();
+          probe_stats_.Fill(snap);
+        });
+    const char* wal = std::getenv("TF_SSDHASH_WAL");
+    use_wal_ = (wal != nullptr && wal[0] == '1');
+    if (use_wal_) {
+      LOG(INFO) << "Use index WAL in SSDHashKV of Multi-tier "
+                << "Embedding Storage!";
+      wal_fs_.open(path_ + "index.wal",
+                   std::ios::app | std::ios::out | std::ios::binary);
+      CHECK(wal_fs_.good());
+    }
   }
 
   void SetTotalDims(int total_dims) {
@@ -257,6 +311,7 @@ class SSDHashKV : public KVInterface<K, V> {
   }
 
   ~SSDHashKV() {
+    KVStatsCollector::GetInstance()->Unregister(stats_id_);
     if (buffer_cur > 0) {
       if (is_async_compaction == nullptr|| is_async_compaction[0] == '0') {
         emb_files[current_version]->Write(write_buffer, buffer_cur * val_len);
@@ -266,6 +321,14 @@ class SSDHashKV : public KVInterface<K, V> {
       TF_CHECK_OK(UpdateFlushStatus());
       buffer_cur = 0;
     }
+    if (use_wal_) {
+      // Clean shutdown: the tier is rebuilt from the checkpoint on
+      // restart, so the crash-recovery state goes away with the value
+      // log below.
+      wal_fs_.close();
+      std::remove((path_ + "index.wal").c_str());
+      std::remove((path_ + "index.snapshot").c_str());
+    }
     for (auto it : emb_files) {
       if (!it->is_deleted) {
         it->DeleteFile();
@@ -279,6 +342,7 @@ class SSDHashKV : public KVInterface<K, V> {
       shutdown = true;
       delete compaction_thread;
     }
+    delete compaction_scheduler_;
   }
 
   Status UpdateFlushStatus() {
@@ -289,13 +353,81 @@ class SSDHashKV : public KVInterface<K, V> {
                                 " in SSDHashKV.");
       } else {
         iter.second->flushed = true;
+        if (use_wal_) {
+          AppendWalEntry(key_buffer[i], iter.second->version,
+                         iter.second->offset);
+        }
       }
     }
+    if (use_wal_) {
+      MaybeWriteSnapshot();
+    }
+    return Status::OK();
+  }
+
+  // Rebuilds the in-memory index of a crashed instance from its last
+  // snapshot plus the WAL tail, instead of re-importing the whole tier
+  // from a checkpoint. prior_prefix is the file prefix of the crashed
+  // instance (the "ssd_kv_<micros>_" path its files were written
+  // under). Must be called before the first Commit; the value log
+  // files of the crashed instance are adopted and compacted away as
+  // usual.
+  Status RestoreFromWal(const std::string& prior_prefix) {
+    std::map<K, WalEntry> latest;
+    TF_RETURN_IF_ERROR(
+        ReadWalEntries(prior_prefix + "index.snapshot", &latest));
+    // The WAL may hold a torn trailing record from the crash; replay
+    // stops at the first short read.
+    ReadWalEntries(prior_prefix + "index.wal", &latest).IgnoreError();
+    size_t max_version = 0;
+    for (auto& it : latest) {
+      if (it.second.version > max_version) {
+        max_version = it.second.version;
+      }
+    }
+    // Drop the empty file the constructor created; the recovered value
+    // log takes its place and new appends go to a fresh file past it.
+    for (auto it : emb_files) {
+      it->DeleteFile();
+      delete it;
+    }
+    emb_files.clear();
+    std::vector<size_t> per_file_count(max_version + 1, 0);
+    for (size_t v = 0; v <= max_version; ++v) {
+      emb_files.emplace_back(new EmbFile(prior_prefix, v, buffer_size));
+    }
+    for (auto& it : latest) {
+      EmbPosition* posi = new EmbPosition(it.second.offset,
+                                          it.second.version, -1, true);
+      hash_map.insert_lockless(
+          std::pair<K, EmbPosition*>(it.first, posi));
+      ++per_file_count[it.second.version];
+    }
+    for (size_t v = 0; v <= max_version; ++v) {
+      emb_files[v]->app_count = per_file_count[v];
+    }
+    total_app_count = latest.size();
+    current_version = max_version + 1;
+    evict_version = current_version;
+    current_offset = 0;
+    CreateFile(current_version);
+    if (use_wal_) {
+      mutex_lock l(wal_mu_);
+      WriteIndexSnapshot();
+      std::remove((prior_prefix + "index.snapshot").c_str());
+      std::remove((prior_prefix + "index.wal").c_str());
+    }
+    LOG(INFO) << "SSDHashKV recovered " << latest.size()
+              << " keys from " << prior_prefix;
     return Status::OK();
   }
 
   Status Lookup(K key, ValuePtr<V>** value_ptr) {
+    // Only the index probe is sampled; the file read below is tier
+    // latency, not hash health.
+    uint64 sample = KVStatsCollector::Begin();
     auto iter = hash_map.find_wait_free(key);
+    probe_stats_.End(sample);
     if (iter.first == EMPTY_KEY_) {
       return errors::NotFound("Unable to find Key: ", key, " in SSDHashKV.");
     } else {
@@ -314,6 +446,76 @@ class SSDHashKV : public KVInterface<K, V> {
     }
   }
 
+  Status BatchLookup(const K* keys, size_t n, ValuePtr<V>** value_ptrs) {
+    // Resolve all positions first, then serve flushed entries grouped by
+    // file so that every hit file is mapped exactly once.
+    std::map<size_t, std::vector<size_t>> flushed_slots;
+    std::vector<EmbPosition*> posis(n, nullptr);
+    for (size_t i = 0; i < n; ++i) {
+      uint64 sample = KVStatsCollector::Begin();
+      auto iter = hash_map.find_wait_free(keys[i]);
+      probe_stats_.End(sample);
+      if (iter.first == EMPTY_KEY_) {
+        value_ptrs[i] = nullptr;
+        continue;
+      }
+      EmbPosition* posi = iter.second;
+      ValuePtr<V>* val = new_value_ptr_fn_(total_dims_);
+      value_ptrs[i] = val;
+      posis[i] = posi;
+      if (posi->flushed) {
+        flushed_slots[posi->version].emplace_back(i);
+      } else {
+        memcpy((char*)val->GetPtr(), write_buffer + posi->buffer_offset,
+               val_len);
+        posi->invalid = true;
+      }
+    }
+    if (use_batch_aio_) {
+      // Submit every flushed read in one batch and reap completions,
+      // so the misses of a gather hit the SSD queue in parallel
+      // instead of as serialized 4KB reads.
+      std::vector<struct aiocb> cbs;
+      std::vector<size_t> slots;
+      for (auto& it : flushed_slots) {
+        slots.insert(slots.end(), it.second.begin(), it.second.end());
+      }
+      cbs.resize(slots.size());
+      for (size_t j = 0; j < slots.size(); ++j) {
+        size_t i = slots[j];
+        memset(&cbs[j], 0, sizeof(struct aiocb));
+        cbs[j].aio_fildes = emb_files[posis[i]->version]->fd;
+        cbs[j].aio_buf = (char*)(value_ptrs[i]->GetPtr());
+        cbs[j].aio_nbytes = val_len;
+        cbs[j].aio_offset = posis[i]->offset;
+        aio_read(&cbs[j]);
+      }
+      for (size_t j = 0; j < slots.size(); ++j) {
+        const struct aiocb* wait_list[1] = {&cbs[j]};
+        while (aio_error(&cbs[j]) == EINPROGRESS) {
+          aio_suspend(wait_list, 1, nullptr);
+        }
+        if (aio_return(&cbs[j]) != static_cast<ssize_t>(val_len)) {
+          LOG(ERROR) << "Failed to batch-read key " << keys[slots[j]]
+                     << " in SSDHashKV.";
+        }
+        posis[slots[j]]->invalid = true;
+      }
+    } else {
+      for (auto& it : flushed_slots) {
+        EmbFile* file = emb_files[it.first];
+        file->Map();
+        for (size_t i : it.second) {
+          file->ReadWithoutMap((char*)(value_ptrs[i]->GetPtr()), val_len,
+                               posis[i]->offset);
+          posis[i]->invalid = true;
+        }
+        file->Unmap();
+      }
+    }
+    return Status::OK();
+  }
+
   Status Insert(K key, const ValuePtr<V>* value_ptr) { return Status::OK(); }
 
   Status BatchInsert(const std::vector<K>& keys,
@@ -323,6 +525,7 @@ class SSDHashKV : public KVInterface<K, V> {
 
   Status BatchCommit(const std::vector<K>& keys,
                      const std::vector<ValuePtr<V>*>& value_ptrs) {
+    compaction_scheduler_->RecordUserWrite(keys.size() * val_len);
     compaction_fn();
     __sync_fetch_and_add(&total_app_count, keys.size());
     for (int i = 0; i < keys.size(); i++) {
@@ -334,6 +537,7 @@ class SSDHashKV : public KVInterface<K, V> {
   }
 
   Status Commit(K key, const ValuePtr<V>* value_ptr) {
+    compaction_scheduler_->RecordUserWrite(val_len);
     compaction_fn();
     __sync_fetch_and_add(&total_app_count, 1);
     check_buffer_fn();
@@ -359,6 +563,66 @@ class SSDHashKV : public KVInterface<K, V> {
   void FreeValuePtr(ValuePtr<V>* value_ptr) { delete value_ptr; }
 
  private:
+  // On-disk record of the index WAL and snapshot: where the latest
+  // flushed value of a key lives. Positions still in the write buffer
+  // are not logged; they are appended once their buffer is durable.
+  struct WalEntry {
+    K key;
+    size_t version;
+    size_t offset;
+  };
+
+  void AppendWalEntry(K key, size_t version, size_t offset) {
+    WalEntry e{key, version, offset};
+    mutex_lock l(wal_mu_);
+    wal_fs_.write(reinterpret_cast<const char*>(&e), sizeof(e));
+  }
+
+  // Called after every durable buffer flush: pushes the freshly logged
+  // positions to disk, and every snapshot_interval flushes folds the
+  // WAL into a full snapshot so the replay tail stays short.
+  void MaybeWriteSnapshot() {
+    mutex_lock l(wal_mu_);
+    wal_fs_.flush();
+    if (++flushes_since_snapshot_ >= snapshot_interval) {
+      WriteIndexSnapshot();
+    }
+  }
+
+  // Dumps every flushed position to <prefix>index.snapshot and
+  // truncates the WAL. Caller holds wal_mu_.
+  void WriteIndexSnapshot() {
+    std::string tmp_path = path_ + "index.snapshot.tmp";
+    std::fstream snap(tmp_path,
+                      std::ios::trunc | std::ios::out | std::ios::binary);
+    for (auto it : hash_map) {
+      EmbPosition* posi = it.second;
+      if (posi == nullptr || !posi->flushed || posi->invalid) continue;
+      WalEntry e{it.first, posi->version, static_cast<size_t>(posi->offset)};
+      snap.write(reinterpret_cast<const char*>(&e), sizeof(e));
+    }
+    snap.flush();
+    snap.close();
+    std::rename(tmp_path.c_str(), (path_ + "index.snapshot").c_str());
+    wal_fs_.close();
+    wal_fs_.open(path_ + "index.wal",
+                 std::ios::trunc | std::ios::out | std::ios::binary);
+    flushes_since_snapshot_ = 0;
+  }
+
+  Status ReadWalEntries(const std::string& fname,
+                        std::map<K, WalEntry>* latest) {
+    std::ifstream fs(fname, std::ios::in | std::ios::binary);
+    if (!fs.good()) {
+      return errors::NotFound("Unable to open: ", fname);
+    }
+    WalEntry e;
+    while (fs.read(reinterpret_cast<char*>(&e), sizeof(e))) {
+      (*latest)[e.key] = e;  // later records win
+    }
+    return Status::OK();
+  }
+
   void WriteFile(size_t version, size_t curr_buffer_offset) {
     emb_files[version]->Write(write_buffer, curr_buffer_offset);
     emb_files[version]->app_count += buffer_cur;
@@ -378,6 +642,8 @@ class SSDHashKV : public KVInterface<K, V> {
       compaction_version = ++current_version;
       CreateFile(compaction_version);
     }
+    compaction_scheduler_->ThrottleWriteBytes(n_ids * val_len);
+    compaction_scheduler_->RecordCompactionWrite(n_ids * val_len);
     emb_files[compaction_version]->Write(value_buffer, n_ids * val_len);
     emb_files[compaction_version]->app_count += n_ids;
     emb_files[compaction_version]->Flush();
@@ -403,6 +669,12 @@ class SSDHashKV : public KVInterface<K, V> {
           delete ep;
         } else {
           pos_out_of_date_compact.emplace_back(pos_buffer[i]);
+          if (use_wal_) {
+            // Only positions that won the swap are logged; a rewrite
+            // that lost to a concurrent update must not clobber the
+            // newer record on replay.
+            AppendWalEntry(id_buffer[i], compaction_version, offset);
+          }
         }
       }
     }
@@ -569,9 +841,13 @@ class SSDHashKV : public KVInterface<K, V> {
 
   void MoveToNewFile() {
     ValuePtr<V>* val = new_value_ptr_fn_(total_dims_);
+    int64 moved = 0;
     for (auto it : evict_file_map) {
       EmbFile* file = emb_files[it.first];
       total_app_count -= file->app_invalid_count;
+      // The live records of a victim file are scattered reads; pay for
+      // them before faulting the file in.
+      compaction_scheduler_->ThrottleReads(it.second.size());
       file->Map();
       for (auto it_vec : it.second) {
         EmbPosition* posi = it_vec.second;
@@ -580,7 +856,10 @@ class SSDHashKV : public KVInterface<K, V> {
         SaveKV(it_vec.first, val, true);
       }
       file->Unmap();
+      moved += it.second.size();
     }
+    compaction_scheduler_->ThrottleWriteBytes(moved * val_len);
+    compaction_scheduler_->RecordCompactionWrite(moved * val_len);
     delete val;
   }
 
@@ -595,6 +874,7 @@ class SSDHashKV : public KVInterface<K, V> {
     for (auto it : evict_file_map) {
       EmbFile* file = emb_files[it.first];
       __sync_fetch_and_sub(&total_app_count, file->app_invalid_count);
+      compaction_scheduler_->ThrottleReads(it.second.size());
       file->Map();
       for (auto it_vec : it.second) {
         EmbPosition* posi = it_vec.second;
@@ -628,20 +908,29 @@ class SSDHashKV : public KVInterface<K, V> {
     //These parameter that can be adjusted in the future
     if (hash_size * 3 / 2 < total_app_count ||
         total_app_count - hash_size > cap_invalid_id) {
+      // A pass over budget is deferred to idle time; the trigger
+      // condition keeps holding so nothing is lost.
+      if (!compaction_scheduler_->Admit(hash_size, total_app_count)) {
+        return;
+      }
       // delete the evict_files
       DeleteInvalidFiles();
       // Initialize evict_file_map
       InitializeEvictMap();
       // read embeddings and write to new file
       MoveToNewFile();
+      compaction_scheduler_->FinishPass();
     }
   }
 
-  void CompactionAsync() {
+  bool CompactionAsync() {
     int64 hash_size = hash_map.size_lockless();
     //These parameter that can be adjusted in the future
     if (hash_size * 3 / 2 < total_app_count ||
         total_app_count - hash_size > cap_invalid_id) {
+      if (!compaction_scheduler_->Admit(hash_size, total_app_count)) {
+        return false;
+      }
       DeleteInvalidRecord();
       // delete the evict_files
       DeleteInvalidFiles();
@@ -649,7 +938,10 @@ class SSDHashKV : public KVInterface<K, V> {
       InitializeEvictMapWithoutErase();
       // read embeddings and write to new file
       MoveToNewFileAsync();
+      compaction_scheduler_->FinishPass();
+      return true;
     }
+    return false;
   }
 
   void CompactionThread() {
@@ -658,7 +950,12 @@ class SSDHashKV : public KVInterface<K, V> {
       }
     }
     while (!shutdown) {
-      CompactionAsync();
+      // Back off when nothing ran (no garbage, or a deferred pass) so
+      // the thread stops burning a core and retries once the tier has
+      // had a moment of idle time.
+      if (!CompactionAsync()) {
+        Env::Default()->SleepForMicroseconds(1000);
+      }
     }
   }
 
@@ -688,9 +985,15 @@ class SSDHashKV : public KVInterface<K, V> {
 
   char* write_buffer;
   K* key_buffer;
+  bool use_batch_aio_;
+  bool use_wal_;
+  size_t flushes_since_snapshot_;
+  std::fstream wal_fs_;
+  mutex wal_mu_;
   const char* is_async_compaction;
   EmbFile* active_file;
   Allocator* alloc;
+  CompactionScheduler* compaction_scheduler_;
 
   int total_dims_;
   std::string path_;
@@ -698,12 +1001,15 @@ class SSDHashKV : public KVInterface<K, V> {
 
   typedef google::dense_hash_map_lockless<K, EmbPosition*> LockLessHashMap;
   LockLessHashMap hash_map;
+  KVProbeStats probe_stats_;
+  int64 stats_id_ = -1;
   mutex mu;
   static const int EMPTY_KEY_;
   static const int DELETED_KEY_;
   static const int cap_invalid_pos;
   static const int cap_invalid_id;
   static const size_t buffer_size;
+  static const size_t snapshot_interval;
 
 
   std::vector<EmbFile*> emb_files;
@@ -734,6 +1040,8 @@ template <class K, class V>
 const int SSDHashKV<K, V>::cap_invalid_id = 10000000;
 template <class K, class V>
 const size_t SSDHashKV<K, V>::buffer_size = 1<<27;
+template <class K, class V>
+const size_t SSDHashKV<K, V>::snapshot_interval = 64;
 
 }  // namespace embedding
 }  // namespace tensorflow
@@ -0,0 +1,223 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_TIER_STATS_H_
+#define TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_TIER_STATS_H_
+
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/profile_utils/cpu_utils.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace embedding {
+
+// Aggregated view of one storage tier since process start. Tier indices
+// follow the StorageManager level order (0 = DRAM, then the configured
+// lower tiers); the last slot counts lookups no tier could serve.
+struct TierStatsSnapshot {
+  int64 hits = 0;
+  int64 samples = 0;
+  int64 cycles = 0;
+  int64 hist[24] = {0};
+};
+
+// Per-tier hit and latency telemetry for multi-tier EmbeddingVar
+// storage, so production can tell which tier served a gather and alert
+// on SSD-hit-rate regressions. Lookup threads count every hit and
+// rdtsc-sample every 64th lookup into thread-local slabs, so the hot
+// path never touches shared cache lines; a detached export thread folds
+// the slabs together every TF_EV_TIER_STATS_INTERVAL_SEC seconds, logs
+// the per-tier hit counts and latency histogram, and invokes any
+// registered export hooks. The slab reads race with the writers, which
+// is fine for monotonic telemetry counters.
+//
+// Disabled (and free apart from one branch) unless
+// TF_EV_TIER_STATS_INTERVAL_SEC is set to a positive number of seconds.
+class TierStatsCollector {
+ public:
+  static const int kMaxTiers = 4;
+  static const int kNumBuckets = 24;
+  static const int kSampleEvery = 64;  // must be a power of two
+
+  static TierStatsCollector* GetInstance() {
+    static TierStatsCollector* instance = new TierStatsCollector();
+    return instance;
+  }
+
+  static bool Enabled() {
+    static int64 interval = IntervalFromEnv();
+    return interval > 0;
+  }
+
+  // Returns the rdtsc timestamp when this lookup is latency-sampled,
+  // 0 otherwise. Pass the result to Record.
+  static uint64 Begin() {
+    if (!Enabled()) {
+      return 0;
+    }
+    ThreadStats* stats = GetInstance()->LocalStats();
+    if ((stats->ops++ & (kSampleEvery - 1)) != 0) {
+      return 0;
+    }
+    return profile_utils::CpuUtils::GetCurrentClockCycle();
+  }
+
+  // Records a lookup served by the given tier; pass the tier count for
+  // a lookup no tier could serve.
+  static void Record(int tier, uint64 begin_cycle) {
+    if (!Enabled()) {
+      return;
+    }
+    if (tier >= kMaxTiers) {
+      tier = kMaxTiers - 1;
+    }
+    ThreadStats* stats = GetInstance()->LocalStats();
+    stats->hits[tier]++;
+    if (begin_cycle != 0) {
+      uint64 delta =
+          profile_utils::CpuUtils::GetCurrentClockCycle() - begin_cycle;
+      stats->samples[tier]++;
+      stats->cycles[tier] += delta;
+      stats->hist[tier][Bucket(delta)]++;
+    }
+  }
+
+  // The hook is invoked by the export thread with the cumulative
+  // per-tier snapshots at every interval, e.g. to feed a serving
+  // metrics backend.
+  void RegisterExportHook(
+      std::function<void(const std::vector<TierStatsSnapshot>&)> hook) {
+    mutex_lock l(mu_);
+    export_hooks_.emplace_back(std::move(hook));
+  }
+
+  std::vector<TierStatsSnapshot> Snapshot() {
+    std::vector<TierStatsSnapshot> result(kMaxTiers);
+    mutex_lock l(mu_);
+    for (auto stats : thread_stats_) {
+      for (int t = 0; t < kMaxTiers; ++t) {
+        result[t].hits += stats->hits[t];
+        result[t].samples += stats->samples[t];
+        result[t].cycles += stats->cycles[t];
+        for (int b = 0; b < kNumBuckets; ++b) {
+          result[t].hist[b] += stats->hist[t][b];
+        }
+      }
+    }
+    return result;
+  }
+
+ private:
+  struct ThreadStats {
+    uint64 ops = 0;
+    int64 hits[kMaxTiers] = {0};
+    int64 samples[kMaxTiers] = {0};
+    int64 cycles[kMaxTiers] = {0};
+    int64 hist[kMaxTiers][kNumBuckets] = {{0}};
+  };
+
+  TierStatsCollector() {
+    if (Enabled()) {
+      export_thread_.reset(Env::Default()->StartThread(
+          ThreadOptions(), "ev_tier_stats_export",
+          [this]() { ExportLoop(); }));
+    }
+  }
+
+  static int64 IntervalFromEnv() {
+    const char* env = std::getenv("TF_EV_TIER_STATS_INTERVAL_SEC");
+    if (env == nullptr) {
+      return 0;
+    }
+    return atoll(env);
+  }
+
+  static int Bucket(uint64 cycles) {
+    int bucket = 0;
+    while (cycles > 1 && bucket < kNumBuckets - 1) {
+      cycles >>= 1;
+      ++bucket;
+    }
+    return bucket;
+  }
+
+  // The slab outlives its thread on purpose: the export thread keeps
+  // reading it and per-process slab count is bounded by peak thread
+  // count.
+  ThreadStats* LocalStats() {
+    static thread_local ThreadStats* stats = nullptr;
+    if (stats == nullptr) {
+      stats = new ThreadStats();
+      mutex_lock l(mu_);
+      thread_stats_.emplace_back(stats);
+    }
+    return stats;
+  }
+
+  void ExportLoop() {
+    int64 interval = IntervalFromEnv();
+    std::vector<TierStatsSnapshot> prev(kMaxTiers);
+    while (true) {
+      Env::Default()->SleepForMicroseconds(interval * 1000 * 1000);
+      std::vector<TierStatsSnapshot> curr = Snapshot();
+      for (int t = 0; t < kMaxTiers; ++t) {
+        int64 hits = curr[t].hits - prev[t].hits;
+        int64 samples = curr[t].samples - prev[t].samples;
+        if (hits == 0) {
+          continue;
+        }
+        int64 cycles = curr[t].cycles - prev[t].cycles;
+        string hist;
+        for (int b = 0; b < kNumBuckets; ++b) {
+          strings::StrAppend(&hist, b == 0 ? "" : ",",
+                             curr[t].hist[b] - prev[t].hist[b]);
+        }
+        LOG(INFO) << "EV tier stats, tier:" << t
+                  << " (last tier counts misses), hits:" << hits
+                  << ", sampled:" << samples << ", avg cycles:"
+                  << (samples == 0 ? 0 : cycles / samples)
+                  << ", log2 cycle hist:[" << hist << "]";
+      }
+      std::vector<std::function<void(const std::vector<TierStatsSnapshot>&)>>
+          hooks;
+      {
+        mutex_lock l(mu_);
+        hooks = export_hooks_;
+      }
+      for (auto& hook : hooks) {
+        hook(curr);
+      }
+      prev.swap(curr);
+    }
+  }
+
+  mutex mu_;
+  std::vector<ThreadStats*> thread_stats_;
+  std::vector<std::function<void(const std::vector<TierStatsSnapshot>&)>>
+      export_hooks_;
+  std::unique_ptr<Thread> export_thread_;
+};
+
+}  // namespace embedding
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_TIER_STATS_H_
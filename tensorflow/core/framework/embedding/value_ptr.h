@@ -5,7 +5,9 @@
 #include <bitset>
 #include <atomic>
 #include <memory>
+#include <vector>
 
+#include "tensorflow/core/framework/numeric_types.h"
 #include "tensorflow/core/framework/typed_allocator.h"
 #if GOOGLE_CUDA
 #if !TENSORFLOW_USE_GPU_EV
@@ -20,7 +22,8 @@ enum class LayoutType {
   LIGHT,
   NORMAL,
   LEVELDB,
-  NORMAL_CONTIGUOUS
+  NORMAL_CONTIGUOUS,
+  COMPRESSED
 };
 
 namespace {
@@ -117,12 +120,30 @@ struct NormalHeader {
     meta.SetHeaderSize(sizeof(NormalHeader) / sizeof(int64));
   }
 
+  // The upper 16 bits of global_step carry the key's dim bucket
+  // (0 = full model dim), mirroring the slotflag packing used by
+  // FixedLengthHeader. Steps comfortably fit in the low 48 bits.
   inline int64 GetGlobalStep() {
-    return global_step;
+    return global_step & 0x0000ffffffffffff;
   }
 
   inline void SetGlobalStep(int64 gs) {
-    global_step = gs;
+    int64 temp = global_step;
+    temp &= 0xffff000000000000;
+    gs &= 0x0000ffffffffffff;
+    temp |= gs;
+    global_step = temp;
+  }
+
+  inline int GetDimBucket() {
+    return (int)(((uint64)global_step) >> 48);
+  }
+
+  inline void SetDimBucket(int bucket) {
+    int64 temp = global_step;
+    temp &= 0x0000ffffffffffff;
+    temp |= ((int64)bucket << 48);
+    global_step = temp;
   }
 
   inline int64 GetFreqCounter() {
@@ -243,6 +264,43 @@ class ValuePtr {
     }
   }
 
+  // Dim bucket of this key: 0 means the columns hold the full model
+  // dim, a non-zero bucket marks a low-frequency key whose columns were
+  // allocated at a shorter length. Only layouts whose header has room
+  // for the bucket record it; everyone else always reports 0.
+  virtual int GetDimBucket() { return 0; }
+
+  virtual void SetDimBucket(int bucket) {}
+
+  // Reallocates every materialized column from old_len to new_len when
+  // a key leaves a short dim bucket. The new tails are zeroed and the
+  // old rows are handed back through *retired instead of being freed,
+  // because a concurrent reader may still hold them. Pointer-per-column
+  // layouts only; the bucket never becomes non-zero elsewhere.
+  virtual void PromoteColumns(Allocator* allocator, int64 old_len,
+      int64 new_len, std::vector<V*>* retired) {
+    MetaHeader* meta = (MetaHeader*)ptr_;
+    while(flag_.test_and_set(std::memory_order_acquire));
+    if (GetDimBucket() == 0) {
+      // Lost the race against another promoter.
+      flag_.clear(std::memory_order_release);
+      return;
+    }
+    auto metadata = meta->GetColumnBitset();
+    for (int i = 0; i < COLUMN_BITSET_SIZE; i++) {
+      if (!metadata.test(i)) continue;
+      V** column = &((V**)((int64*)ptr_ + meta->GetHeaderSize()))[i];
+      V* tensor_val = (V*)allocator->AllocateRaw(
+          Allocator::kAllocatorAlignment, sizeof(V) * new_len);
+      memcpy(tensor_val, *column, sizeof(V) * old_len);
+      memset(tensor_val + old_len, 0, sizeof(V) * (new_len - old_len));
+      retired->push_back(*column);
+      *column = tensor_val;
+    }
+    SetDimBucket(0);
+    flag_.clear(std::memory_order_release);
+  }
+
   virtual void Free(const V* v) {}
 
   virtual void Destroy(Allocator* allocator) {
@@ -354,6 +412,14 @@ class NormalValuePtr : public ValuePtr<V> {
     MetaHeader* meta = (MetaHeader*)this->ptr_;
     return ((NormalHeader*)this->ptr_)->AddFreq(count);
   }
+
+  int GetDimBucket() {
+    return ((NormalHeader*)this->ptr_)->GetDimBucket();
+  }
+
+  void SetDimBucket(int bucket) {
+    ((NormalHeader*)this->ptr_)->SetDimBucket(bucket);
+  }
 };
 
 template <class V>
@@ -431,6 +497,196 @@ class NormalContiguousValuePtr : public ValuePtr<V>{
       *((V*)this->ptr_ + sizeof(FixedLengthHeader) / sizeof(V) + i) = val;
     }
   }
+
+ protected:
+  // For subclasses that provide their own storage behind ptr_.
+  NormalContiguousValuePtr() {}
+};
+
+template <class V>
+class InlineValuePtr : public NormalContiguousValuePtr<V> {
+/* Small-value variant of NormalContiguousValuePtr: the header and the
+   payload live inside the ValuePtr object itself, so a tiny row
+   (dim-1 to dim-4 biases and counters, where the header plus pointer
+   indirection outweighs the payload) costs one allocation and no
+   pointer chase. Behavior matches NormalContiguousValuePtr exactly;
+   only the block's home differs, so Destroy is a no-op and the
+   storage goes away with the object. Selected automatically by the
+   storage manager when the whole row fits kInlineCapacity values. */
+ public:
+  static constexpr size_t kInlineCapacity = 4;
+
+  InlineValuePtr(Allocator* allocator, size_t size) {
+    DCHECK_LE(size, kInlineCapacity);
+    this->ptr_ = buf_;
+    memset(buf_, 0, sizeof(buf_));
+    new ((char*)this->ptr_) FixedLengthHeader();
+  }
+
+  ~InlineValuePtr() {
+  }
+
+  virtual void Destroy(Allocator* allocator) override {
+  }
+
+ private:
+  alignas(sizeof(int64)) char buf_[sizeof(FixedLengthHeader) +
+                                   sizeof(V) * kInlineCapacity];
+};
+
+template <class V>
+class MmapContiguousValuePtr : public ValuePtr<V> {
+/* ValuePtr whose payload lives in a MAP_PRIVATE mapping of the
+   checkpoint's value segment instead of allocator memory. Only the
+   FixedLengthHeader plus the payload pointer is malloc'd locally (the
+   bundle stores no headers). Writes through the returned pointer fault
+   the page copy-on-write, so a row only materializes in anonymous
+   memory on its first update while untouched rows stay backed by the
+   page cache. Destroy leaves the payload alone; the mapping outlives
+   every row restored from it. Restored rows hold one embedding column,
+   so this layout requires slot_num == 0. */
+ public:
+  explicit MmapContiguousValuePtr(V* payload) {
+    this->ptr_ = (void*) malloc(sizeof(FixedLengthHeader) + sizeof(V*));
+    new ((char*)this->ptr_) FixedLengthHeader();
+    *(V**)((char*)this->ptr_ + sizeof(FixedLengthHeader)) = payload;
+    // The restored row is already initialized.
+    int8* m = (int8*)((char*)this->ptr_ + 6);
+    *m |= 1;
+  }
+
+  ~MmapContiguousValuePtr() {
+    free(this->ptr_);
+  }
+
+  virtual V* GetOrAllocate(Allocator* allocator, int64 value_len, const V* default_v, int emb_index, int offset) override {
+    return *(V**)((char*)this->ptr_ + sizeof(FixedLengthHeader)) + offset;
+  }
+
+  virtual V* GetValue(int emb_index, int offset) {
+    int8 meta = *((int8*)((char*)this->ptr_ + 6));
+    std::bitset<8> bs(meta);
+    if (bs.test(emb_index)) {
+      return *(V**)((char*)this->ptr_ + sizeof(FixedLengthHeader)) + offset;
+    } else {
+      return nullptr;
+    }
+  }
+
+  virtual void Destroy(Allocator* allocator) {
+  }
+
+  int64 GetStep() {
+    return ((FixedLengthHeader*)this->ptr_)->GetGlobalStep();
+  }
+
+  void SetStep(int64 gs) {
+    ((FixedLengthHeader*)this->ptr_)->SetGlobalStep(gs);
+  }
+
+  int64 GetFreq() {
+    return ((FixedLengthHeader*)this->ptr_)->GetFreqCounter();
+  }
+
+  void SetFreq(int64 freq) {
+    ((FixedLengthHeader*)this->ptr_)->SetFreqCounter(freq);
+  }
+
+  void AddFreq() {
+    ((FixedLengthHeader*)this->ptr_)->AddFreq();
+  }
+
+  void AddFreq(int count) {
+    ((FixedLengthHeader*)this->ptr_)->AddFreq(count);
+  }
+};
+
+template <class V>
+class CompressedValuePtr : public ValuePtr<V> {
+/* Quantized variant of NormalContiguousValuePtr: the payload behind
+   FixedLengthHeader holds fp16 instead of V, halving the resident size
+   of a DRAM tier. There is no direct V* view into the payload, so
+   GetValue returns nullptr and readers must go through Dequantize,
+   which the lookup path of the filters does. Intended for inference
+   tables; the apply ops need a float view and should keep using the
+   float layouts. */
+  public:
+   CompressedValuePtr(Allocator* allocator, size_t size) {
+    this->ptr_ = allocator->AllocateRaw(Allocator::kAllocatorAlignment,
+      sizeof(FixedLengthHeader) + sizeof(Eigen::half) * size);
+    memset(this->ptr_ + sizeof(FixedLengthHeader), 0,
+           sizeof(Eigen::half) * size);
+    new ((char*)this->ptr_) FixedLengthHeader();
+   }
+
+   ~CompressedValuePtr() {
+   }
+
+  virtual V* GetOrAllocate(Allocator* allocator, int64 value_len, const V* default_v, int emb_index, int offset) override {
+    int8 meta = *((int8*)((char*)this->ptr_ + 6));
+    std::bitset<8> bs(meta);
+    if (!bs.test(emb_index)) {
+      while(this->flag_.test_and_set(std::memory_order_acquire));
+      meta = *((int8*)((char*)this->ptr_ + 6));
+      bs = std::bitset<8>(meta);
+      if (!bs.test(emb_index)) {
+        Quantize(default_v, value_len, offset);
+        int8* m = (int8*)((char*)this->ptr_ + 6);
+        *m |= (1 <<  emb_index);
+      }
+      this->flag_.clear(std::memory_order_release);
+    }
+    // No float view exists into the quantized payload.
+    return nullptr;
+  }
+
+  virtual V* GetValue(int emb_index, int offset) {
+    return nullptr;
+  }
+
+  void Quantize(const V* src, int64 value_len, int offset) {
+    Eigen::half* dst = (Eigen::half*)((char*)this->ptr_ +
+        sizeof(FixedLengthHeader)) + offset;
+    for (int64 i = 0; i < value_len; ++i) {
+      dst[i] = Eigen::half(src[i]);
+    }
+  }
+
+  void Dequantize(int offset, int64 value_len, V* out) {
+    const Eigen::half* src = (const Eigen::half*)((char*)this->ptr_ +
+        sizeof(FixedLengthHeader)) + offset;
+    for (int64 i = 0; i < value_len; ++i) {
+      out[i] = static_cast<V>(src[i]);
+    }
+  }
+
+  virtual void Destroy(Allocator* allocator) {
+    allocator->DeallocateRaw(this->ptr_);
+  }
+
+  int64 GetStep() {
+    return ((FixedLengthHeader*)this->ptr_)->GetGlobalStep();
+  }
+
+  void SetStep(int64 gs) {
+    ((FixedLengthHeader*)this->ptr_)->SetGlobalStep(gs);
+  }
+
+  int64 GetFreq() {
+    return ((FixedLengthHeader*)this->ptr_)->GetFreqCounter();
+  }
+
+  void SetFreq(int64 freq) {
+    ((FixedLengthHeader*)this->ptr_)->SetFreqCounter(freq);
+  }
+
+  void AddFreq() {
+    ((FixedLengthHeader*)this->ptr_)->AddFreq();
+  }
+
+  void AddFreq(int count) {
+    ((FixedLengthHeader*)this->ptr_)->AddFreq(count);
+  }
 };
 
 template <class V>
@@ -0,0 +1,215 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_ZSTD_DICT_CODEC_H_
+#define TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_ZSTD_DICT_CODEC_H_
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <zdict.h>
+#include <zstd.h>
+
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+namespace embedding {
+
+// Dictionary-trained zstd codec for cold-tier embedding rows. Rows of
+// one table share layout and value distribution, which generic zstd
+// barely exploits at row granularity; a dictionary trained over the
+// first rows the table commits recovers most of the cross-row
+// redundancy. The codec samples until the training corpus is large
+// enough, trains once, and compresses everything committed afterwards.
+//
+// Every stored value is framed with a one byte tag so rows written
+// before training finished stay readable:
+//   [kRawTag][original bytes]
+//   [kZstdDictTag][dict version byte][zstd frame]
+class ZstdDictCodec {
+ public:
+  static constexpr char kRawTag = 0x00;
+  static constexpr char kZstdDictTag = 0x01;
+
+  // TF_LEVELDB_ZSTD_DICT=true turns the codec on for LevelDBKV.
+  static bool EnabledFromEnv() {
+    static const bool enabled = [] {
+      bool value = false;
+      Status s = ReadBoolFromEnvVar("TF_LEVELDB_ZSTD_DICT", false, &value);
+      if (!s.ok()) {
+        LOG(ERROR) << s.error_message();
+      }
+      return value;
+    }();
+    return enabled;
+  }
+
+  ZstdDictCodec() {
+    int64 level = 3;
+    TF_CHECK_OK(ReadInt64FromEnvVar("TF_LEVELDB_ZSTD_LEVEL", 3, &level));
+    level_ = static_cast<int>(level);
+  }
+
+  ~ZstdDictCodec() {
+    if (cdict_ != nullptr) ZSTD_freeCDict(cdict_);
+    if (ddict_ != nullptr) ZSTD_freeDDict(ddict_);
+  }
+
+  bool trained() const {
+    return trained_.load(std::memory_order_acquire);
+  }
+
+  // Dictionary version carried in the frame; bumped if retraining is
+  // ever added so stale frames are detected instead of misdecoded.
+  int version() const { return 1; }
+
+  // Serialized dictionary, empty until trained.
+  std::string dict_bytes() const {
+    mutex_lock l(mu_);
+    return dict_bytes_;
+  }
+
+  // Feeds one uncompressed value into the training corpus. No-op once
+  // the dictionary is trained (or training failed).
+  void AddSample(const char* data, size_t len) {
+    if (trained() || len == 0) return;
+    mutex_lock l(mu_);
+    if (trained() || sampling_failed_) return;
+    samples_.append(data, len);
+    sample_sizes_.push_back(len);
+    if (samples_.size() >= kTrainCorpusBytes &&
+        sample_sizes_.size() >= kMinSamples) {
+      TrainLocked();
+    }
+  }
+
+  // Appends the framed encoding of [data, data+len) to *out. Until the
+  // dictionary exists — or when compression does not pay for a row —
+  // the frame is raw.
+  void Encode(const char* data, size_t len, std::string* out) {
+    out->clear();
+    if (trained()) {
+      const size_t bound = ZSTD_compressBound(len);
+      out->resize(kFrameHeaderBytes + bound);
+      const size_t n = ZSTD_compress_usingCDict(
+          GetCCtx(), &(*out)[kFrameHeaderBytes], bound, data, len, cdict_);
+      if (!ZSTD_isError(n) && n < len) {
+        (*out)[0] = kZstdDictTag;
+        (*out)[1] = static_cast<char>(version());
+        out->resize(kFrameHeaderBytes + n);
+        return;
+      }
+      out->clear();
+    }
+    out->push_back(kRawTag);
+    out->append(data, len);
+  }
+
+  // Decodes a framed value into buf. The decompressed size must be at
+  // most cap; rows of one table are fixed width so callers know it.
+  Status Decode(const char* data, size_t len, char* buf, size_t cap) {
+    if (len < 1) {
+      return errors::DataLoss("Empty compressed embedding value");
+    }
+    if (data[0] == kRawTag) {
+      if (len - 1 > cap) {
+        return errors::DataLoss("Stored embedding value larger than row: ",
+                                len - 1, " vs ", cap);
+      }
+      memcpy(buf, data + 1, len - 1);
+      return Status::OK();
+    }
+    if (data[0] != kZstdDictTag || len < kFrameHeaderBytes) {
+      return errors::DataLoss("Unknown embedding value framing tag");
+    }
+    if (data[1] != static_cast<char>(version()) || !trained()) {
+      return errors::DataLoss(
+          "Embedding value compressed with unavailable dictionary version ",
+          static_cast<int>(data[1]));
+    }
+    const size_t n = ZSTD_decompress_usingDDict(
+        GetDCtx(), buf, cap, data + kFrameHeaderBytes,
+        len - kFrameHeaderBytes, ddict_);
+    if (ZSTD_isError(n)) {
+      return errors::DataLoss("Corrupt zstd embedding value: ",
+                              ZSTD_getErrorName(n));
+    }
+    return Status::OK();
+  }
+
+ private:
+  static constexpr size_t kFrameHeaderBytes = 2;
+  // ~100KB dictionaries beat smaller ones on wide rows and are still
+  // negligible next to the tier they compress.
+  static constexpr size_t kDictCapacityBytes = 112640;
+  // zdict wants roughly 100 samples per dictionary byte of corpus;
+  // 4MB over at least 100 rows is enough for row-structured data.
+  static constexpr size_t kTrainCorpusBytes = 4 << 20;
+  static constexpr size_t kMinSamples = 100;
+
+  void TrainLocked() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    std::string dict(kDictCapacityBytes, '\0');
+    const size_t n =
+        ZDICT_trainFromBuffer(&dict[0], dict.size(), samples_.data(),
+                              sample_sizes_.data(), sample_sizes_.size());
+    if (ZDICT_isError(n)) {
+      LOG(WARNING) << "zstd dictionary training failed ("
+                   << ZDICT_getErrorName(n)
+                   << "); storing this table's cold tier uncompressed";
+      sampling_failed_ = true;
+    } else {
+      dict.resize(n);
+      cdict_ = ZSTD_createCDict(dict.data(), dict.size(), level_);
+      ddict_ = ZSTD_createDDict(dict.data(), dict.size());
+      dict_bytes_ = std::move(dict);
+      // cdict_/ddict_ are published by this release store and immutable
+      // afterwards, so readers need no lock.
+      trained_.store(true, std::memory_order_release);
+    }
+    samples_.clear();
+    samples_.shrink_to_fit();
+    sample_sizes_.clear();
+  }
+
+  static ZSTD_CCtx* GetCCtx() {
+    thread_local ZSTD_CCtx* cctx = ZSTD_createCCtx();
+    return cctx;
+  }
+
+  static ZSTD_DCtx* GetDCtx() {
+    thread_local ZSTD_DCtx* dctx = ZSTD_createDCtx();
+    return dctx;
+  }
+
+  int level_;
+  mutable mutex mu_;
+  std::string samples_ GUARDED_BY(mu_);
+  std::vector<size_t> sample_sizes_ GUARDED_BY(mu_);
+  bool sampling_failed_ GUARDED_BY(mu_) = false;
+  std::string dict_bytes_ GUARDED_BY(mu_);
+  ZSTD_CDict* cdict_ = nullptr;
+  ZSTD_DDict* ddict_ = nullptr;
+  std::atomic<bool> trained_{false};
+};
+
+}  // namespace embedding
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_FRAMEWORK_EMBEDDING_ZSTD_DICT_CODEC_H_
@@ -14,7 +14,14 @@ limitations under the License.
 ==============================================================================*/
 
 #include <atomic>
+#include <errno.h>
 #include <list>
+#include <string.h>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
 #include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/allocator_registry.h"
 #include "tensorflow/core/framework/tracking_allocator.h"
@@ -23,7 +30,9 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/mem.h"
 #include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 
@@ -59,6 +68,30 @@ constexpr size_t kChunkSize = ( 1 << 22);  // 4MB chunk size
 constexpr size_t kPageSize = (1 << 12);    // 4KB page by default
 constexpr size_t kPageShift = 12;
 constexpr size_t kPageCount = kChunkSize / kPageSize;
+constexpr size_t kHugePageSize = (1 << 21);  // 2MB hugepage
+
+// When enabled, chunks are 2MB-aligned and advised to the kernel as
+// hugepage candidates so embedding values sit in 2MB TLB entries instead
+// of sprawling across 4KB pages.
+bool UseHugePages() {
+  static bool use_huge_pages = [] {
+    bool value = false;
+    Status s = ReadBoolFromEnvVar("TF_EV_ALLOCATOR_USE_HUGEPAGES",
+                                  false, &value);
+    if (!s.ok()) {
+      LOG(WARNING) << "Invalid TF_EV_ALLOCATOR_USE_HUGEPAGES: " << s;
+    }
+#ifndef __linux__
+    if (value) {
+      LOG(WARNING) << "TF_EV_ALLOCATOR_USE_HUGEPAGES is only supported "
+                   << "on Linux; ignored.";
+      value = false;
+    }
+#endif
+    return value;
+  }();
+  return use_huge_pages;
+}
 
 #if defined __x86_64__
 constexpr int kAddressBits =
@@ -174,16 +207,80 @@ class FreeList {
   std::list<void*> list_;
 };
 
+// Slots move between a thread's free list and the shared depot in whole
+// magazines, so the shared lock is taken once per kMagazineBatch slots
+// rather than per slot.
+constexpr int kMagazineBatch = 64;
+// A thread keeps at most this many free slots of a size class before it
+// returns a magazine to the depot.
+constexpr int kMagazineCap = 4 * kMagazineBatch;
+
+// Shared overflow depot for one size class. Keeps slots freed by one
+// thread (e.g. feature eviction) reusable by the insert threads instead
+// of letting every thread grow private free lists while others carve
+// fresh chunks.
+class CentralDepot {
+ public:
+  void PushBatch(int n, void** ptrs) {
+    std::lock_guard<spin_lock> l(lock_);
+    free_list_.PushBatch(n, ptrs);
+  }
+
+  int PopBatch(int n, void** ret) {
+    std::lock_guard<spin_lock> l(lock_);
+    return free_list_.PopBatch(n, ret);
+  }
+
+ private:
+  spin_lock lock_;
+  FreeList free_list_;
+};
+
+// Lazily creates one depot per size class; shared by all thread arenas.
+// Size classes are exact slot sizes, so each registered embedding value
+// length gets its own depot.
+class DepotMap {
+ public:
+  CentralDepot* GetDepot(size_t num_bytes) {
+    std::lock_guard<spin_lock> l(lock_);
+    auto it = depots_.find(num_bytes);
+    if (it != depots_.end()) {
+      return it->second;
+    }
+    auto d = new CentralDepot;
+    depots_.emplace(num_bytes, d);
+    return d;
+  }
+
+ private:
+  spin_lock lock_;
+  std::unordered_map<size_t, CentralDepot*> depots_;
+};
+
 class Chunk {
  public:
   Chunk(size_t chunk_size, size_t slot_size, Bin* bin, PageMap* pm) :
       chunk_size_(chunk_size), slot_size_(slot_size) {
     slot_count_ = chunk_size_ / slot_size_;
-    start_ = (char*)port::AlignedMalloc(chunk_size_, kPageSize);
+    const size_t alignment = UseHugePages() ? kHugePageSize : kPageSize;
+    start_ = (char*)port::AlignedMalloc(chunk_size_, alignment);
     if (start_ == nullptr) {
       LOG(FATAL) << "OOM, can't create new Chunk for EVAllocator,"
                  << "please check free memory.";
     }
+#ifdef __linux__
+    if (UseHugePages()) {
+      // Best effort; the kernel may still back the range with 4KB pages
+      // when transparent hugepages are unavailable.
+      if (madvise(start_, chunk_size_, MADV_HUGEPAGE) != 0) {
+        static std::atomic<bool> logged(false);
+        if (!logged.exchange(true)) {
+          LOG(WARNING) << "madvise(MADV_HUGEPAGE) failed for EVAllocator "
+                       << "chunk: " << strerror(errno);
+        }
+      }
+    }
+#endif
     pm->SetBin(start_, kPageCount, bin);
     current_ = start_;
     end_ = start_ + chunk_size_;
@@ -236,7 +333,8 @@ class Chunk {
 
 class Bin {
  public:
-  Bin(size_t s, PageMap* pm) : bin_size_(s), page_map_(pm) {
+  Bin(size_t s, PageMap* pm, CentralDepot* depot)
+      : bin_size_(s), page_map_(pm), depot_(depot) {
     current_chunk_ = CreateChunk();
   }
 
@@ -252,6 +350,14 @@ class Bin {
       return ptr;
     }
 
+    // Refill a magazine from the shared depot before carving new chunks.
+    void* magazine[kMagazineBatch];
+    int refilled = depot_->PopBatch(kMagazineBatch, magazine);
+    if (refilled > 0) {
+      free_list_.PushBatch(refilled - 1, magazine + 1);
+      return magazine[0];
+    }
+
     ptr = current_chunk_->Allocate();
     if (ptr == nullptr) {
       current_chunk_ = CreateChunk();
@@ -261,13 +367,20 @@ class Bin {
   }
 
   size_t BatchAllocate(size_t num, void** ret) {
-    auto allocated = free_list_.PopBatch(num, ret);
+    size_t allocated = free_list_.PopBatch(num, ret);
     auto remains = num - allocated;
     if (remains == 0) {
       return num;
     }
 
     void** cur = ret + allocated;
+    allocated = depot_->PopBatch(remains, cur);
+    remains -= allocated;
+    if (remains == 0) {
+      return num;
+    }
+
+    cur += allocated;
     allocated = current_chunk_->BatchAllocate(remains, cur);
     remains -= allocated;
     if (remains == 0) {
@@ -299,6 +412,12 @@ class Bin {
 
   void Deallocate(void* ptr) {
     free_list_.Push(ptr);
+    if (free_list_.length() > kMagazineCap) {
+      // Return a full magazine to the depot for other threads to reuse.
+      void* magazine[kMagazineBatch];
+      int n = free_list_.PopBatch(kMagazineBatch, magazine);
+      depot_->PushBatch(n, magazine);
+    }
   }
 
   size_t BinSize() const {
@@ -315,6 +434,7 @@ class Bin {
  private:
   size_t bin_size_;
   PageMap* page_map_ = nullptr;
+  CentralDepot* depot_ = nullptr;
   Chunk* current_chunk_ = nullptr;
 
   FreeList free_list_;
@@ -324,7 +444,8 @@ class Bin {
 // Thread local arena
 class ThreadLocalArena {
  public:
-  ThreadLocalArena(PageMap* pm) : page_map_(pm) {}
+  ThreadLocalArena(PageMap* pm, DepotMap* dm)
+      : page_map_(pm), depot_map_(dm) {}
 
   ~ThreadLocalArena() {
     for (auto it = bins_.begin(); it != bins_.end(); ++it) {
@@ -334,38 +455,32 @@ class ThreadLocalArena {
   }
 
   void* Allocate(size_t num_bytes) {
-    auto it = bins_.find(num_bytes);
-    if (it != bins_.end()) {
-      return it->second->Allocate();
-    }
-    auto b = new Bin(num_bytes, page_map_);
-    bins_.emplace(num_bytes, b);
-    return b->Allocate();
+    return GetBin(num_bytes)->Allocate();
   }
 
   size_t BatchAllocate(size_t num, size_t num_bytes, void** ret) {
-    auto it = bins_.find(num_bytes);
-    if (it != bins_.end()) {
-      return it->second->BatchAllocate(num, ret);
-    }
-    auto b = new Bin(num_bytes, page_map_);
-    bins_.emplace(num_bytes, b);
-    return b->BatchAllocate(num, ret);
+    return GetBin(num_bytes)->BatchAllocate(num, ret);
   }
 
   void Deallocate(size_t num_bytes, void* ptr) {
+    GetBin(num_bytes)->Deallocate(ptr);
+  }
+
+ private:
+  Bin* GetBin(size_t num_bytes) {
     auto it = bins_.find(num_bytes);
     if (it != bins_.end()) {
-      return it->second->Deallocate(ptr);
+      return it->second;
     }
-    auto b = new Bin(num_bytes, page_map_);
+    auto b = new Bin(num_bytes, page_map_, depot_map_->GetDepot(num_bytes));
     bins_.emplace(num_bytes, b);
-    return b->Deallocate(ptr);
+    return b;
   }
 
  private:
   std::unordered_map<size_t, Bin*> bins_;
   PageMap* page_map_ = nullptr;
+  DepotMap* depot_map_ = nullptr;
 };
 
 class EVAllocatorImpl {
@@ -373,6 +488,7 @@ class EVAllocatorImpl {
   EVAllocatorImpl() {
     pthread_key_create(&key_, nullptr);
     page_map_ = new PageMap();
+    depot_map_ = new DepotMap();
   }
 
   ~EVAllocatorImpl() {
@@ -404,7 +520,7 @@ class EVAllocatorImpl {
     ThreadLocalArena* arena =
       static_cast<ThreadLocalArena*>(pthread_getspecific(key_));
     if (arena == nullptr) {
-      arena = new ThreadLocalArena(page_map_);
+      arena = new ThreadLocalArena(page_map_, depot_map_);
       pthread_setspecific(key_, arena);
     }
     return arena;
@@ -413,6 +529,7 @@ class EVAllocatorImpl {
  private:
   pthread_key_t key_;
   PageMap* page_map_ = nullptr;
+  DepotMap* depot_map_ = nullptr;
 };
 
 class EVAllocator : public Allocator {
@@ -574,24 +691,36 @@ class EVAllocatorFactory : public AllocatorFactory {
   }
 
   SubAllocator* CreateSubAllocator(int numa_node) override {
-    return new EVSubAllocator(new EVAllocator);
+    return new EVSubAllocator(new EVAllocator, numa_node);
   }
 
  private:
+  // Pins sub-allocations to the requested NUMA node so that pools built
+  // on top of EVAllocator stay node-local; falls back to the plain
+  // EVAllocator when no node is requested or NUMA is unavailable.
   class EVSubAllocator : public SubAllocator {
    public:
-    explicit EVSubAllocator(EVAllocator* ev_allocator)
-        : SubAllocator({}, {}), ev_allocator_(ev_allocator) {}
+    explicit EVSubAllocator(EVAllocator* ev_allocator, int numa_node)
+        : SubAllocator({}, {}), ev_allocator_(ev_allocator),
+          numa_node_(numa_node) {}
 
     void* Alloc(size_t alignment, size_t num_bytes) override {
+      if (numa_node_ != port::kNUMANoAffinity && port::NUMAEnabled()) {
+        return port::NUMAMalloc(numa_node_, num_bytes, alignment);
+      }
       return ev_allocator_->AllocateRaw(alignment, num_bytes);
     }
 
     void Free(void* ptr, size_t num_bytes) override {
+      if (numa_node_ != port::kNUMANoAffinity && port::NUMAEnabled()) {
+        port::NUMAFree(ptr, num_bytes);
+        return;
+      }
       ev_allocator_->DeallocateRaw(ptr);
     }
    private:
     EVAllocator* ev_allocator_;
+    int numa_node_;
   };
 };
 
@@ -153,6 +153,34 @@ TEST(EVAllocator, TestBatchAllocateAndDeallocate) {
   }
 }
 
+TEST(EVAllocator, TestCrossThreadDeallocateAndReuse) {
+  auto allocator = ev_allocator();
+  constexpr int size = 1000;
+  constexpr int allocate_size = 272;  // a 68-float embedding row
+
+  void** ptrs = new void*[size];
+  for (int i = 0; i < size; ++i) {
+    ptrs[i] = allocator->AllocateRaw(4, allocate_size);
+  }
+
+  // Free on a different thread; the slots flow back through the shared
+  // depot in magazines and must stay usable from this thread.
+  std::unique_ptr<Thread> t(Env::Default()->StartThread(
+      ThreadOptions(), "", [allocator, ptrs, size]() {
+        for (int i = 0; i < size; ++i) {
+          allocator->DeallocateRaw(ptrs[i]);
+        }
+      }));
+  t.reset(nullptr);
+
+  for (int i = 0; i < size; ++i) {
+    void* p = allocator->AllocateRaw(4, allocate_size);
+    EXPECT_NE(p, nullptr);
+    memset(p, 0, allocate_size);
+  }
+  delete[] ptrs;
+}
+
 TEST(EVAllocator, TestMultiThreadAllocate40B) {
   auto allocator = ev_allocator();
   
@@ -36,6 +36,7 @@ limitations under the License.
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/gtl/map_util.h"
 #include "tensorflow/core/util/device_name_utils.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/equal_graph_def.h"
 
 namespace tensorflow {
@@ -1061,6 +1062,7 @@ FunctionLibraryDefinition::FunctionLibraryDefinition(
     : default_registry_(other.default_registry_) {
   tf_shared_lock l(other.mu_);
   function_defs_ = other.function_defs_;
+  lazy_function_defs_ = other.lazy_function_defs_;
   func_grad_ = other.func_grad_;
 }
 
@@ -1069,10 +1071,15 @@ FunctionLibraryDefinition::FunctionLibraryDefinition(
     const FunctionDefLibrary& def_lib)
     : default_registry_(default_registry),
       function_defs_(def_lib.function_size()) {
+  const bool lazy = LazyDeserializationEnabled();
   for (const auto& fdef : def_lib.function()) {
     // The latter function definition wins.
-    auto& ptr = function_defs_[fdef.signature().name()];
-    ptr.reset(new FunctionDefAndOpRegistration(fdef));
+    if (lazy) {
+      lazy_function_defs_[fdef.signature().name()] = fdef.SerializeAsString();
+    } else {
+      auto& ptr = function_defs_[fdef.signature().name()];
+      ptr.reset(new FunctionDefAndOpRegistration(fdef));
+    }
   }
   for (const auto& grad : def_lib.gradient()) {
     func_grad_[grad.function_name()] = grad.gradient_func();
@@ -1081,12 +1088,50 @@ FunctionLibraryDefinition::FunctionLibraryDefinition(
 
 FunctionLibraryDefinition::~FunctionLibraryDefinition() {}
 
+/* static */ bool FunctionLibraryDefinition::LazyDeserializationEnabled() {
+  static const bool enabled = [] {
+    bool value = false;
+    TF_CHECK_OK(ReadBoolFromEnvVar("TF_LAZY_FUNCTION_DESERIALIZATION", false,
+                                   &value));
+    return value;
+  }();
+  return enabled;
+}
+
+void FunctionLibraryDefinition::MaterializeFunction(const string& func) const {
+  {
+    tf_shared_lock l(mu_);
+    if (lazy_function_defs_.empty() ||
+        lazy_function_defs_.find(func) == lazy_function_defs_.end()) {
+      return;
+    }
+  }
+  mutex_lock l(mu_);
+  MaterializeFunctionLocked(func);
+}
+
+void FunctionLibraryDefinition::MaterializeFunctionLocked(
+    const string& func) const {
+  auto iter = lazy_function_defs_.find(func);
+  if (iter == lazy_function_defs_.end()) return;
+  FunctionDef fdef;
+  if (fdef.ParseFromString(iter->second)) {
+    auto& ptr = function_defs_[func];
+    ptr.reset(new FunctionDefAndOpRegistration(fdef));
+  } else {
+    LOG(ERROR) << "Failed to parse lazily held FunctionDef '" << func << "'";
+  }
+  lazy_function_defs_.erase(iter);
+}
+
 bool FunctionLibraryDefinition::Contains(const string& func) const {
   tf_shared_lock l(mu_);
-  return function_defs_.find(func) != function_defs_.end();
+  return function_defs_.find(func) != function_defs_.end() ||
+         lazy_function_defs_.find(func) != lazy_function_defs_.end();
 }
 
 const FunctionDef* FunctionLibraryDefinition::Find(const string& func) const {
+  MaterializeFunction(func);
   tf_shared_lock l(mu_);
   auto result = FindHelper(func);
   if (result) {
@@ -1115,6 +1160,8 @@ Status FunctionLibraryDefinition::AddFunctionDef(const FunctionDef& fdef) {
 Status FunctionLibraryDefinition::AddFunctionDefHelper(const FunctionDef& fdef,
                                                        bool* added) {
   *added = false;
+  // Duplicate detection below needs the parsed form.
+  MaterializeFunctionLocked(fdef.signature().name());
   std::shared_ptr<FunctionDefAndOpRegistration>& entry =
       function_defs_[fdef.signature().name()];
   if (entry) {
@@ -1141,6 +1188,8 @@ Status FunctionLibraryDefinition::AddFunctionDefHelper(const FunctionDef& fdef,
 Status FunctionLibraryDefinition::AddHelper(
     std::shared_ptr<FunctionDefAndOpRegistration> registration, bool* added) {
   *added = false;
+  // Duplicate detection below needs the parsed form.
+  MaterializeFunctionLocked(registration->fdef.signature().name());
   std::shared_ptr<FunctionDefAndOpRegistration>& entry =
       function_defs_[registration->fdef.signature().name()];
   if (entry) {
@@ -1174,6 +1223,7 @@ Status FunctionLibraryDefinition::CopyFunctionDefFrom(
         "' because CopyFunctionDefFrom() requires that both libraries have the "
         "same default registry.");
   }
+  other.MaterializeFunction(func);
   std::shared_ptr<FunctionDefAndOpRegistration> function_def;
   {
     tf_shared_lock l(other.mu_);
@@ -1249,6 +1299,44 @@ Status FunctionLibraryDefinition::AddLibrary(
       funcs.push_back(iter.second->fdef.signature().name());
     }
   }
+  for (const auto& iter : clone.lazy_function_defs_) {
+    // Keep still-serialized functions lazy across merges; only a name
+    // collision forces a parse for the duplicate check.
+    const bool in_parsed =
+        function_defs_.find(iter.first) != function_defs_.end();
+    auto lazy_iter = lazy_function_defs_.find(iter.first);
+    if (!in_parsed && lazy_iter != lazy_function_defs_.end() &&
+        lazy_iter->second == iter.second) {
+      // Byte-identical duplicate.
+      continue;
+    }
+    if (!in_parsed && lazy_iter == lazy_function_defs_.end()) {
+      const OpDef* op_def;
+      if (default_registry_->LookUpOpDef(iter.first, &op_def).ok()) {
+        Remove(funcs, funcs_with_grads);
+        return errors::InvalidArgument(
+            "Cannot add function '", iter.first,
+            "' because an op with the same name already exists.");
+      }
+      lazy_function_defs_[iter.first] = iter.second;
+      funcs.push_back(iter.first);
+      continue;
+    }
+    FunctionDef fdef;
+    if (!fdef.ParseFromString(iter.second)) {
+      Remove(funcs, funcs_with_grads);
+      return errors::InvalidArgument("Cannot parse function '", iter.first,
+                                     "'.");
+    }
+    s = AddFunctionDefHelper(fdef, &added);
+    if (!s.ok()) {
+      Remove(funcs, funcs_with_grads);
+      return s;
+    }
+    if (added) {
+      funcs.push_back(iter.first);
+    }
+  }
   for (auto iter : clone.func_grad_) {
     GradientDef grad;
     grad.set_function_name(iter.first);
@@ -1323,6 +1411,9 @@ Status FunctionLibraryDefinition::RemoveFunction(const string& func) {
 Status FunctionLibraryDefinition::RemoveFunctionHelper(const string& func) {
   const auto& i = function_defs_.find(func);
   if (i == function_defs_.end()) {
+    if (lazy_function_defs_.erase(func) > 0) {
+      return Status::OK();
+    }
     return errors::InvalidArgument("Tried to remove non-existent function '",
                                    func, "'.");
   }
@@ -1364,6 +1455,7 @@ string FunctionLibraryDefinition::FindGradientHelper(const string& func) const {
 
 Status FunctionLibraryDefinition::LookUp(
     const string& op, const OpRegistrationData** op_reg_data) const {
+  MaterializeFunction(op);
   tf_shared_lock l(mu_);
   auto iter = function_defs_.find(op);
   if (iter != function_defs_.end()) {
@@ -1377,7 +1469,8 @@ string FunctionLibraryDefinition::UniqueFunctionName(StringPiece prefix) const {
   tf_shared_lock l(mu_);
   int index = 0;
   string name = strings::StrCat(prefix, index);
-  while (function_defs_.find(name) != function_defs_.end()) {
+  while (function_defs_.find(name) != function_defs_.end() ||
+         lazy_function_defs_.find(name) != lazy_function_defs_.end()) {
     ++index;
     name = strings::StrCat(prefix, index);
   }
@@ -1399,6 +1492,11 @@ const FunctionDef* FunctionLibraryDefinition::GetAttrImpl(
     return nullptr;
   }
   const string& func_name = forward_func_attrs->name();
+  MaterializeFunction(func_name);
+  {
+    const string& grad = FindGradient(func_name);
+    if (!grad.empty()) MaterializeFunction(grad);
+  }
   {
     tf_shared_lock l(mu_);
     const string& grad_name = FindGradientHelper(func_name);
@@ -1415,10 +1513,13 @@ const FunctionDef* FunctionLibraryDefinition::GetAttrImpl(
 std::vector<string> FunctionLibraryDefinition::ListFunctionNames() const {
   std::vector<string> function_names;
   tf_shared_lock l(mu_);
-  function_names.reserve(function_defs_.size());
+  function_names.reserve(function_defs_.size() + lazy_function_defs_.size());
   for (const auto& it : function_defs_) {
     function_names.emplace_back(it.first);
   }
+  for (const auto& it : lazy_function_defs_) {
+    function_names.emplace_back(it.first);
+  }
   return function_names;
 }
 
@@ -1428,6 +1529,15 @@ FunctionDefLibrary FunctionLibraryDefinition::ToProto() const {
   for (const auto& f : function_defs_) {
     *lib.add_function() = f.second->fdef;
   }
+  for (const auto& f : lazy_function_defs_) {
+    // Parse straight into the output proto without materializing the
+    // library entry.
+    if (!lib.add_function()->ParseFromString(f.second)) {
+      LOG(ERROR) << "Failed to parse lazily held FunctionDef '" << f.first
+                 << "'";
+      lib.mutable_function()->RemoveLast();
+    }
+  }
   for (const auto& g : func_grad_) {
     GradientDef* gd = lib.add_gradient();
     gd->set_function_name(g.first);
@@ -427,7 +427,7 @@ class FunctionLibraryDefinition : public OpRegistryInterface {
 
   size_t num_functions() const {
     tf_shared_lock l(mu_);
-    return function_defs_.size();
+    return function_defs_.size() + lazy_function_defs_.size();
   }
 
   // Returns all the function names in the FunctionLibraryDefinition.
@@ -497,10 +497,27 @@ class FunctionLibraryDefinition : public OpRegistryInterface {
   // unless `func` has a gradient.
   Status RemoveGradient(const string& func) EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
+  // Returns true when TF_LAZY_FUNCTION_DESERIALIZATION is set. In lazy
+  // mode the constructor keeps each FunctionDef in serialized form under
+  // its name and defers parsing and signature indexing to the first
+  // lookup, so libraries with tens of thousands of functions only pay
+  // for the handful a serving path actually instantiates.
+  static bool LazyDeserializationEnabled();
+
+  // Parses and indexes `func` if it is still held in serialized form.
+  // The hot path (already materialized or unknown name) only takes the
+  // shared lock.
+  void MaterializeFunction(const string& func) const LOCKS_EXCLUDED(mu_);
+  void MaterializeFunctionLocked(const string& func) const
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
   mutable mutex mu_;
   const OpRegistryInterface* const default_registry_;
-  gtl::FlatMap<string, std::shared_ptr<FunctionDefAndOpRegistration>>
+  mutable gtl::FlatMap<string, std::shared_ptr<FunctionDefAndOpRegistration>>
       function_defs_ GUARDED_BY(mu_);
+  // Serialized FunctionDefs not yet materialized, keyed by name. Only
+  // populated in lazy mode; a name lives in exactly one of the two maps.
+  mutable gtl::FlatMap<string, string> lazy_function_defs_ GUARDED_BY(mu_);
   gtl::FlatMap<string, string> func_grad_ GUARDED_BY(mu_);
 };
 
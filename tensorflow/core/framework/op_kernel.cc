@@ -34,6 +34,7 @@ limitations under the License.
 #include "tensorflow/core/framework/node_def.pb.h"
 #include "tensorflow/core/framework/node_def_util.h"
 #include "tensorflow/core/framework/op_def_util.h"
+#include "tensorflow/core/framework/output_slab_recycler.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/graph/graph.h"
 #include "tensorflow/core/lib/core/errors.h"
@@ -766,6 +767,18 @@ Status OpKernelContext::allocate_output(int index, const TensorShape& shape,
           " more than once.  Try turning off the ScopedAllocator optimizer.");
     }
   }
+  if (params_->output_slab_recycler != nullptr && attr.scope_id <= 0 &&
+      !params_->track_allocations) {
+    auto recycled = MakeUnique<Tensor>();
+    if (params_->output_slab_recycler->Lookup(params_->output_slab_node_id,
+                                              index, type, shape,
+                                              recycled.get())) {
+      record_tensor_reference(*recycled);
+      outputs_[index] = TensorValue(recycled.release());
+      *output = outputs_[index].tensor;
+      return Status::OK();
+    }
+  }
   auto output_tensor = MakeUnique<Tensor>();
   Status s = allocate_tensor(type, shape, output_tensor.get(), attr);
   if (s.ok()) {
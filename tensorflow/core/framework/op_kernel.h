@@ -75,6 +75,7 @@ class FunctionLibraryRuntime;
 class OpKernelConstruction;  // declared below
 class OpKernelContext;       // declared below,
 class OpRegistryInterface;
+class OutputSlabRecycler;
 class ResourceMgr;
 class ScopedStepContainer;
 class CollectiveExecutor;
@@ -751,6 +752,13 @@ class OpKernelContext {
     // For implementing `OpKernelContext::output_required()`. If null, all
     // outputs are required.
     bool* outputs_required_array = nullptr;
+
+    // If non-null, allocate_output first offers this node's output
+    // buffer from a previous step instead of allocating (see
+    // output_slab_recycler.h). Set by the executor for CPU devices
+    // when TF_OUTPUT_SLAB_RECYCLE=1.
+    OutputSlabRecycler* output_slab_recycler = nullptr;
+    int output_slab_node_id = -1;
   };
 
   // params must outlive the OpKernelContext.
@@ -0,0 +1,117 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_FRAMEWORK_OUTPUT_SLAB_RECYCLER_H_
+#define TENSORFLOW_CORE_FRAMEWORK_OUTPUT_SLAB_RECYCLER_H_
+
+#include <atomic>
+#include <cstdlib>
+#include <unordered_map>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// Cross-step recycling of output buffers, keyed by (node id, output
+// index). Serving graphs produce the same shapes step after step, so
+// instead of returning each output buffer to the allocator at the end
+// of a step and asking for an identical one at the start of the next —
+// which is where BFC fragmentation accumulates over long uptimes — the
+// executor keeps one reference to every node's last output and
+// allocate_output hands the same buffer out again when the requested
+// dtype and shape match.
+//
+// Safety rests on a single invariant: a cached buffer is only reissued
+// when the recycler's own reference is the last one
+// (Tensor::RefCountIsOne). Fetched outputs, forwarded buffers and
+// still-running concurrent steps all hold extra references, and any of
+// them simply forces that slot down the ordinary allocator path for
+// the step. Shape changes replace the cached entry, so dynamic nodes
+// degrade to plain allocation rather than misbehaving.
+//
+// Enabled with TF_OUTPUT_SLAB_RECYCLE=1; one instance per executor,
+// installed for CPU devices only. Steady-state retained memory is at
+// most one extra working set of the graph's outputs.
+class OutputSlabRecycler {
+ public:
+  static bool EnabledFromEnv() {
+    static const bool enabled = [] {
+      const char* env = std::getenv("TF_OUTPUT_SLAB_RECYCLE");
+      return env != nullptr && env[0] == '1';
+    }();
+    return enabled;
+  }
+
+  ~OutputSlabRecycler() {
+    const int64 hits = hits_.load(std::memory_order_relaxed);
+    const int64 misses = misses_.load(std::memory_order_relaxed);
+    if (hits + misses > 0) {
+      VLOG(1) << "OutputSlabRecycler retired, cached slabs:" << slabs_.size()
+              << ", hits:" << hits << ", misses:" << misses;
+    }
+  }
+
+  // If the slab cached for (node_id, output_index) matches (type,
+  // shape) exactly and nothing outside the cache references it, shares
+  // it into *out and returns true.
+  bool Lookup(int node_id, int output_index, DataType type,
+              const TensorShape& shape, Tensor* out) {
+    if (shape.num_elements() == 0) {
+      return false;
+    }
+    mutex_lock l(mu_);
+    auto it = slabs_.find(Key(node_id, output_index));
+    if (it == slabs_.end() || it->second.dtype() != type ||
+        it->second.shape() != shape || !it->second.RefCountIsOne()) {
+      misses_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    *out = it->second;
+    return true;
+  }
+
+  // Remembers the buffer this node just produced so the next step can
+  // reuse it. Cheap when the output already is the cached slab (the
+  // steady state once recycling kicks in).
+  void Store(int node_id, int output_index, const Tensor& t) {
+    if (!t.IsInitialized() || t.NumElements() == 0) {
+      return;
+    }
+    mutex_lock l(mu_);
+    Tensor& slab = slabs_[Key(node_id, output_index)];
+    if (!slab.SharesBufferWith(t)) {
+      slab = t;
+    }
+  }
+
+ private:
+  static uint64 Key(int node_id, int output_index) {
+    return (static_cast<uint64>(node_id) << 16) |
+           static_cast<uint64>(output_index & 0xffff);
+  }
+
+  mutex mu_;
+  std::unordered_map<uint64, Tensor> slabs_ GUARDED_BY(mu_);
+  std::atomic<int64> hits_{0};
+  std::atomic<int64> misses_{0};
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_FRAMEWORK_OUTPUT_SLAB_RECYCLER_H_
@@ -0,0 +1,73 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/framework/output_slab_recycler.h"
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+TEST(OutputSlabRecyclerTest, ReusesBufferOnceSoleOwner) {
+  OutputSlabRecycler recycler;
+  Tensor out;
+  EXPECT_FALSE(
+      recycler.Lookup(1, 0, DT_FLOAT, TensorShape({4}), &out));
+
+  const void* data;
+  {
+    Tensor produced(DT_FLOAT, TensorShape({4}));
+    data = produced.tensor_data().data();
+    recycler.Store(1, 0, produced);
+    // `produced` still references the buffer, so it must not be
+    // reissued.
+    EXPECT_FALSE(
+        recycler.Lookup(1, 0, DT_FLOAT, TensorShape({4}), &out));
+  }
+  // The cache holds the only reference now.
+  ASSERT_TRUE(recycler.Lookup(1, 0, DT_FLOAT, TensorShape({4}), &out));
+  EXPECT_EQ(data, out.tensor_data().data());
+}
+
+TEST(OutputSlabRecyclerTest, RejectsMismatchedShapeOrType) {
+  OutputSlabRecycler recycler;
+  { recycler.Store(2, 0, Tensor(DT_FLOAT, TensorShape({2, 3}))); }
+  Tensor out;
+  EXPECT_FALSE(
+      recycler.Lookup(2, 0, DT_FLOAT, TensorShape({3, 2}), &out));
+  EXPECT_FALSE(
+      recycler.Lookup(2, 0, DT_INT32, TensorShape({2, 3}), &out));
+  EXPECT_FALSE(
+      recycler.Lookup(2, 1, DT_FLOAT, TensorShape({2, 3}), &out));
+  EXPECT_TRUE(
+      recycler.Lookup(2, 0, DT_FLOAT, TensorShape({2, 3}), &out));
+}
+
+TEST(OutputSlabRecyclerTest, ReissuedBufferNotSharedTwice) {
+  OutputSlabRecycler recycler;
+  { recycler.Store(3, 0, Tensor(DT_FLOAT, TensorShape({8}))); }
+  Tensor first;
+  ASSERT_TRUE(recycler.Lookup(3, 0, DT_FLOAT, TensorShape({8}), &first));
+  // A concurrent step would see the outstanding reference and take the
+  // allocator path instead.
+  Tensor second;
+  EXPECT_FALSE(
+      recycler.Lookup(3, 0, DT_FLOAT, TensorShape({8}), &second));
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -155,15 +155,16 @@ class LocalRendezvousImpl : public Rendezvous {
     uint64 key_hash = KeyHash(key.FullKey());
     VLOG(2) << "Send " << this << " " << key_hash << " " << key.FullKey();
 
-    mu_.lock();
-    if (!status_.ok()) {
+    Shard* shard = GetShard(key_hash);
+    shard->mu.lock();
+    if (!shard->status.ok()) {
       // Rendezvous has been aborted.
-      Status s = status_;
-      mu_.unlock();
+      Status s = shard->status;
+      shard->mu.unlock();
       return s;
     }
 
-    ItemQueue* queue = &table_[key_hash];
+    ItemQueue* queue = &shard->table[key_hash];
     if (queue->empty() || queue->front()->IsSendValue()) {
       // There is no waiter for this message. Append the message
       // into the queue. The waiter will pick it up when arrives.
@@ -177,7 +178,7 @@ class LocalRendezvousImpl : public Rendezvous {
         item->send_args.device_context->Ref();
       }
       queue->push_back(item);
-      mu_.unlock();
+      shard->mu.unlock();
       return Status::OK();
     }
 
@@ -188,11 +189,11 @@ class LocalRendezvousImpl : public Rendezvous {
     // Delete the queue when the last element has been consumed.
     if (queue->size() == 1) {
       VLOG(2) << "Clean up Send/Recv queue (key:" << key.FullKey() << "). ";
-      table_.erase(key_hash);
+      shard->table.erase(key_hash);
     } else {
       queue->pop_front();
     }
-    mu_.unlock();
+    shard->mu.unlock();
 
     // Notify the waiter by invoking its done closure, outside the
     // lock.
@@ -209,15 +210,16 @@ class LocalRendezvousImpl : public Rendezvous {
     uint64 key_hash = KeyHash(key.FullKey());
     VLOG(2) << "Send " << this << " " << key_hash << " " << key.FullKey();
 
-    mu_.lock();
-    if (!status_.ok()) {
+    Shard* shard = GetShard(key_hash);
+    shard->mu.lock();
+    if (!shard->status.ok()) {
       // Rendezvous has been aborted.
-      Status s = status_;
-      mu_.unlock();
+      Status s = shard->status;
+      shard->mu.unlock();
       return s;
     }
 
-    ItemQueue* queue = &table_[key_hash];
+    ItemQueue* queue = &shard->table[key_hash];
     if (queue->empty() || queue->front()->IsSendValue()) {
       // There is no waiter for this message. Append the message
       // into the queue. The waiter will pick it up when arrives.
@@ -231,14 +233,14 @@ class LocalRendezvousImpl : public Rendezvous {
         item->send_args.device_context->Ref();
       }
       queue->push_back(item);
-      mu_.unlock();
+      shard->mu.unlock();
       return Status::OK();
     }
 
     // There is an earliest waiter to consume this message.
     Item* item = queue->front();
     queue->pop_front();
-    mu_.unlock();
+    shard->mu.unlock();
 
     // Notify the waiter by invoking its done closure, outside the
     // lock.
@@ -254,16 +256,17 @@ class LocalRendezvousImpl : public Rendezvous {
     uint64 key_hash = KeyHash(key.FullKey());
     VLOG(2) << "Recv " << this << " " << key_hash << " " << key.FullKey();
 
-    mu_.lock();
-    if (!status_.ok()) {
+    Shard* shard = GetShard(key_hash);
+    shard->mu.lock();
+    if (!shard->status.ok()) {
       // Rendezvous has been aborted.
-      Status s = status_;
-      mu_.unlock();
+      Status s = shard->status;
+      shard->mu.unlock();
       done(s, Args(), recv_args, Tensor(), false);
       return;
     }
 
-    ItemQueue* queue = &table_[key_hash];
+    ItemQueue* queue = &shard->table[key_hash];
     if (queue->empty() || !queue->front()->IsSendValue()) {
       // There is no message to pick up.
       // Only recv-related fields need to be filled.
@@ -276,14 +279,15 @@ class LocalRendezvousImpl : public Rendezvous {
                                                           key_hash] {
           Item* item = nullptr;
           {
-            mutex_lock l(mu_);
-            ItemQueue* queue = &table_[key_hash];
+            Shard* shard = GetShard(key_hash);
+            mutex_lock l(shard->mu);
+            ItemQueue* queue = &shard->table[key_hash];
             if (!queue->empty() && !queue->front()->IsSendValue()) {
               for (auto it = queue->begin(); it != queue->end(); it++) {
                 if ((*it)->cancellation_token == token) {
                   item = *it;
                   if (queue->size() == 1) {
-                    table_.erase(key_hash);
+                    shard->table.erase(key_hash);
                   } else {
                     queue->erase(it);
                   }
@@ -302,7 +306,7 @@ class LocalRendezvousImpl : public Rendezvous {
         });
       }
       if (already_cancelled) {
-        mu_.unlock();
+        shard->mu.unlock();
         done(StatusGroup::MakeDerived(
                  errors::Cancelled("RecvAsync is cancelled.")),
              Args(), recv_args, Tensor(), /*is_dead=*/false);
@@ -338,7 +342,7 @@ class LocalRendezvousImpl : public Rendezvous {
         item->recv_args.device_context->Ref();
       }
       queue->push_back(item);
-      mu_.unlock();
+      shard->mu.unlock();
       return;
     }
 
@@ -350,11 +354,11 @@ class LocalRendezvousImpl : public Rendezvous {
     // Delete the queue when the last element has been consumed.
     if (queue->size() == 1) {
       VLOG(2) << "Clean up Send/Recv queue (key:" << key.FullKey() << "). ";
-      table_.erase(key_hash);
+      shard->table.erase(key_hash);
     } else {
       queue->pop_front();
     }
-    mu_.unlock();
+    shard->mu.unlock();
 
     // Invokes the done() by invoking its done closure, outside scope
     // of the table lock.
@@ -368,16 +372,17 @@ class LocalRendezvousImpl : public Rendezvous {
     uint64 key_hash = KeyHash(key.FullKey());
     VLOG(2) << "Recv " << this << " " << key_hash << " " << key.FullKey();
 
-    mu_.lock();
-    if (!status_.ok()) {
+    Shard* shard = GetShard(key_hash);
+    shard->mu.lock();
+    if (!shard->status.ok()) {
       // Rendezvous has been aborted.
-      Status s = status_;
-      mu_.unlock();
+      Status s = shard->status;
+      shard->mu.unlock();
       done(s, Args(), recv_args, nullptr, nullptr, false);
       return;
     }
 
-    ItemQueue* queue = &table_[key_hash];
+    ItemQueue* queue = &shard->table[key_hash];
     if (queue->empty() || !queue->front()->IsSendValue()) {
       // There is no message to pick up.
       // Only recv-related fileds need to be filled.
@@ -388,7 +393,7 @@ class LocalRendezvousImpl : public Rendezvous {
         item->recv_args.device_context->Ref();
       }
       queue->push_back(item);
-      mu_.unlock();
+      shard->mu.unlock();
       return;
     }
 
@@ -396,7 +401,7 @@ class LocalRendezvousImpl : public Rendezvous {
     // this key.  Consumes the message and invokes the done closure.
     Item* item = queue->front();
     queue->pop_front();
-    mu_.unlock();
+    shard->mu.unlock();
 
     // Invokes the done() by invoking its done closure, outside scope
     // of the table lock.
@@ -408,22 +413,24 @@ class LocalRendezvousImpl : public Rendezvous {
 
   void StartAbort(const Status& status) override {
     CHECK(!status.ok());
-    Table table;
-    {
-      mutex_lock l(mu_);
-      status_.Update(status);
-      table_.swap(table);
+    std::vector<Table> tables(kNumShards);
+    for (int i = 0; i < kNumShards; ++i) {
+      mutex_lock l(shards_[i].mu);
+      shards_[i].status.Update(status);
+      shards_[i].table.swap(tables[i]);
     }
-    for (auto& p : table) {
-      for (Item* item : p.second) {
-        if (!item->IsSendValue()) {
-          if (item->ref_value != nullptr && item->ref_mutex != nullptr) {
-            item->ref_waiter(status, Args(), Args(), nullptr, nullptr, false);
-          } else {
-            item->waiter(status, Args(), Args(), Tensor(), false);
+    for (auto& table : tables) {
+      for (auto& p : table) {
+        for (Item* item : p.second) {
+          if (!item->IsSendValue()) {
+            if (item->ref_value != nullptr && item->ref_mutex != nullptr) {
+              item->ref_waiter(status, Args(), Args(), nullptr, nullptr, false);
+            } else {
+              item->waiter(status, Args(), Args(), Tensor(), false);
+            }
           }
+          delete item;
         }
-        delete item;
       }
     }
   }
@@ -472,13 +479,32 @@ class LocalRendezvousImpl : public Rendezvous {
   typedef std::deque<Item*> ItemQueue;
   typedef gtl::FlatMap<uint64, ItemQueue> Table;
 
-  // TODO(zhifengc): shard table_.
-  mutex mu_;
-  Table table_ GUARDED_BY(mu_);
-  Status status_ GUARDED_BY(mu_);
+  // One lock and table per shard, selected by the precomputed key
+  // hash. Single-host serving drives millions of intra-process
+  // Send/Recvs per second through one rendezvous, and a single mutex
+  // serializes all of them. Per-key queues are untouched, so pairing
+  // and FIFO order per key are unchanged.
+  static const int kNumShards = 16;
+  struct Shard {
+    mutex mu;
+    Table table GUARDED_BY(mu);
+    Status status GUARDED_BY(mu);
+  };
+  Shard shards_[kNumShards];
+
+  Shard* GetShard(uint64 key_hash) {
+    return &shards_[key_hash % kNumShards];
+  }
 
   ~LocalRendezvousImpl() override {
-    if (!table_.empty()) {
+    bool has_items = false;
+    for (int i = 0; i < kNumShards; ++i) {
+      if (!shards_[i].table.empty()) {
+        has_items = true;
+        break;
+      }
+    }
+    if (has_items) {
       StartAbort(errors::Cancelled("LocalRendezvousImpl deleted"));
     }
   }
@@ -129,6 +129,7 @@ void ResourceMgr::Clear() {
   {
     mutex_lock l(mu_);
     tmp_containers = std::move(containers_);
+    generation_.fetch_add(1, std::memory_order_release);
   }
   for (const auto& p : tmp_containers) {
     delete p.second;
@@ -183,6 +184,7 @@ Status ResourceMgr::DoCreate(const string& container, TypeIndex type,
 
   if ((*b)->insert(std::move(key_and_value)).second) {
     TF_RETURN_IF_ERROR(InsertDebugTypeName(type.hash_code(), type.name()));
+    generation_.fetch_add(1, std::memory_order_release);
     return Status::OK();
   }
   return errors::AlreadyExists("Resource ", container, "/", name, "/",
@@ -225,6 +227,7 @@ Status ResourceMgr::DoDelete(const string& container, uint64 type_hash_code,
     }
     std::swap(resource_and_name, iter->second);
     b->erase(iter);
+    generation_.fetch_add(1, std::memory_order_release);
   }
   DCHECK(resource_and_name.resource != nullptr);
   return Status::OK();
@@ -258,6 +261,7 @@ Status ResourceMgr::Cleanup(const string& container) {
     }
     b = iter->second;
     containers_.erase(iter);
+    generation_.fetch_add(1, std::memory_order_release);
   }
   CHECK(b != nullptr);
   delete b;
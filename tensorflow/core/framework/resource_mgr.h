@@ -221,6 +221,14 @@ class ResourceMgr {
   // Returns a text description for all resources.
   string DebugString() const;
 
+  // Incremented on every mutation (Create/Delete/Cleanup/Clear).
+  // Kernels that resolve the same resource every step can cache the
+  // looked-up pointer and revalidate it with this single atomic load
+  // instead of taking mu_ on each call.
+  int64 generation() const {
+    return generation_.load(std::memory_order_acquire);
+  }
+
  private:
   typedef std::pair<uint64, string> Key;
   struct KeyHash {
@@ -252,6 +260,7 @@ class ResourceMgr {
   const string default_container_;
   mutable mutex mu_;
   std::unordered_map<string, Container*> containers_ GUARDED_BY(mu_);
+  std::atomic<int64> generation_{0};
 
   template <typename T, bool use_dynamic_cast = false>
   Status LookupInternal(const string& container, const string& name,
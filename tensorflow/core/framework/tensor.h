@@ -669,6 +669,7 @@ class Tensor {
   friend class TensorTestHelper;      // For access to set_shape.
   friend class CastOpBase;            // For access to set_dtype.
   friend class OpKernelContext;       // For access to RefCountIsOne().
+  friend class OutputSlabRecycler;    // For access to RefCountIsOne().
   friend class ScopedAllocator;       // For access to buf_.
   friend class XlaTensor;             // For access to RefCountIsOne().
   template <typename Device, typename T>
@@ -426,6 +426,14 @@ Graph::~Graph() {
 const VersionDef& Graph::versions() const { return *versions_; }
 void Graph::set_versions(const VersionDef& versions) { *versions_ = versions; }
 
+void Graph::ReserveNodes(int num_nodes) {
+  nodes_.reserve(nodes_.size() + num_nodes);
+}
+
+void Graph::ReserveEdges(int num_edges) {
+  edges_.reserve(edges_.size() + num_edges);
+}
+
 Node* Graph::AddNode(NodeDef node_def, Status* status) {
   const OpDef* op_def;
   status->Update(ops_.LookUpOpDef(node_def.op(), &op_def));
@@ -604,6 +604,14 @@ class Graph {
   // name.
   Status AddFunctionLibrary(const FunctionDefLibrary& fdef_lib);
 
+  // Pre-sizes the internal node and edge storage for an additional
+  // num_nodes nodes / num_edges edges.  When importing a large
+  // GraphDef the counts are known up front, and reserving once avoids
+  // repeated re-growth of the id-indexed arrays during bulk
+  // construction.
+  void ReserveNodes(int num_nodes);
+  void ReserveEdges(int num_edges);
+
   // The number of live nodes in the graph.
   //
   // Because nodes can be removed from the graph, num_nodes() is often
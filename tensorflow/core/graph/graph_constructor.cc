@@ -41,14 +41,19 @@ limitations under the License.
 #include "tensorflow/core/graph/node_builder.h"
 #include "tensorflow/core/graph/tensor_id.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/gtl/flatmap.h"
 #include "tensorflow/core/lib/gtl/flatset.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/strings/scanner.h"
 #include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/public/version.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 
@@ -168,6 +173,9 @@ class GraphConstructor {
     TF_RETURN_IF_ERROR(ValidateInputMapAndControlDependencies());
     TF_RETURN_IF_ERROR(BuildNodeIndex());
     TF_RETURN_IF_ERROR(InitFromEdges());
+    if (opts_.importing) {
+      TF_RETURN_IF_ERROR(PreValidateNodeDefs());
+    }
 
     // NOTE: Convert() invokes `consume_node_def()` on each node in the input
     // graph, so `get_node_def()` is no longer usable once it is called.
@@ -188,6 +196,7 @@ class GraphConstructor {
   Status ValidateInputMapAndControlDependencies();
   Status BuildNodeIndex();
   Status InitFromEdges();
+  Status PreValidateNodeDefs();
   Status Convert();
   Status AddBackEdges();
   Status UpdateVersionDef();
@@ -208,7 +217,9 @@ class GraphConstructor {
   Status MakeNode(NodeDef&& node_def, Node** node);
   Status MakeEdge(Node* src, int output_index, Node* dst, int input_index);
   Status ValidateShape(Node* node);
-  Status ModifyNodeDefForImport(NodeDef* node_def);
+  // `gdef_index` is the node's index within node_defs_, used to pick up the
+  // op def cached by PreValidateNodeDefs(); -1 forces a registry lookup.
+  Status ModifyNodeDefForImport(NodeDef* node_def, int gdef_index = -1);
   // Modifies node_def's inputs according to opts_.input_map.
   // input_already_exists is a pre-initialized vector of length
   // node_def->input_size(). This function will mark inputs that are remapped to
@@ -295,6 +306,14 @@ class GraphConstructor {
   // Intermediate datastructure used to track the destinations of back edges.
   absl::flat_hash_set<int> merge_node_indices_;
 
+  // Per-node op defs resolved by PreValidateNodeDefs(), indexed like
+  // node_defs_. Empty unless pre_validated_ is set.
+  std::vector<const OpDef*> pre_validated_op_defs_;
+
+  // True once PreValidateNodeDefs() has looked up and validated every
+  // NodeDef, which lets Convert() skip the per-node re-validation.
+  bool pre_validated_ = false;
+
   // Mapping from node name to the index within node_defs_.
   struct NodeInfo {
     explicit NodeInfo(int i) : gdef_index(i), node(nullptr) {}
@@ -589,6 +608,7 @@ Status GraphConstructor::ValidateInputMapAndControlDependencies() {
 
 Status GraphConstructor::BuildNodeIndex() {
   // Validate the node names and add them to gdef_nodes_ and gdef_prefixes_.
+  gdef_nodes_.reserve(node_def_count());
   for (int n = 0; n < node_def_count(); ++n) {
     const NodeDef& node_def = get_node_def(n);
     if (!IsValidNodeName(node_def.name(), opts_.allow_internal_ops)) {
@@ -728,6 +748,57 @@ Status GraphConstructor::MakeNode(NodeDef&& node_def, Node** node) {
   return Status::OK();
 }
 
+Status GraphConstructor::PreValidateNodeDefs() {
+  // Op registry lookup and attr validation are independent per node and are a
+  // large share of the serial Convert() loop on multi-million node graphs, so
+  // run them up front across threads; ModifyNodeDefForImport() then reuses
+  // the cached op defs and skips re-validation.
+  const int num_nodes = node_def_count();
+  static constexpr int kMinNodesForParallelValidation = 16384;
+  int64 num_threads;
+  TF_RETURN_IF_ERROR(ReadInt64FromEnvVar("TF_GRAPH_IMPORT_VALIDATION_THREADS",
+                                         port::NumSchedulableCPUs(),
+                                         &num_threads));
+  if (num_nodes < kMinNodesForParallelValidation || num_threads <= 1) {
+    return Status::OK();
+  }
+  pre_validated_op_defs_.resize(num_nodes, nullptr);
+  mutex mu;
+  Status first_error;
+  thread::ThreadPool pool(Env::Default(), "graph_import_validation",
+                          static_cast<int>(num_threads));
+  pool.ParallelFor(
+      num_nodes, 10000 /* rough cycles per node */,
+      [this, &mu, &first_error](int64 begin, int64 end) {
+        for (int64 i = begin; i < end; ++i) {
+          const NodeDef& original = get_node_def(i);
+          const OpDef* op_def;
+          Status s = g_->op_registry()->LookUpOpDef(original.op(), &op_def);
+          if (s.ok()) {
+            // Validate a defaulted copy: the original may legitimately omit
+            // attrs that have defaults. The mutable NodeDef gets its defaults
+            // in ModifyNodeDefForImport(), after input remapping and
+            // renaming, neither of which affects validity.
+            NodeDef defaulted = original;
+            AddDefaultsToNodeDef(*op_def, &defaulted);
+            s = ValidateNodeDef(defaulted, *op_def);
+            if (s.ok() && versions()) {
+              s = CheckOpDeprecation(*op_def, versions()->producer());
+            }
+          }
+          if (!s.ok()) {
+            mutex_lock l(mu);
+            if (first_error.ok()) first_error = s;
+            return;
+          }
+          pre_validated_op_defs_[i] = op_def;
+        }
+      });
+  TF_RETURN_IF_ERROR(first_error);
+  pre_validated_ = true;
+  return Status::OK();
+}
+
 Status GraphConstructor::ValidateShape(Node* node) {
   if (!opts_.importing || !opts_.validate_shape) return Status::OK();
   TF_RETURN_IF_ERROR(refiner_->AddNode(node));
@@ -823,13 +894,21 @@ Status GraphConstructor::ValidateShape(Node* node) {
   return Status::OK();
 }
 
-Status GraphConstructor::ModifyNodeDefForImport(NodeDef* node_def) {
-  const OpDef* op_def;
-  TF_RETURN_IF_ERROR(g_->op_registry()->LookUpOpDef(node_def->op(), &op_def));
+Status GraphConstructor::ModifyNodeDefForImport(NodeDef* node_def,
+                                                int gdef_index) {
+  const OpDef* op_def =
+      pre_validated_ && gdef_index >= 0 ? pre_validated_op_defs_[gdef_index]
+                                        : nullptr;
+  if (op_def == nullptr) {
+    TF_RETURN_IF_ERROR(
+        g_->op_registry()->LookUpOpDef(node_def->op(), &op_def));
+  }
   AddDefaultsToNodeDef(*op_def, node_def);
-  TF_RETURN_IF_ERROR(ValidateNodeDef(*node_def, *op_def));
-  if (versions()) {
-    TF_RETURN_IF_ERROR(CheckOpDeprecation(*op_def, versions()->producer()));
+  if (!pre_validated_) {
+    TF_RETURN_IF_ERROR(ValidateNodeDef(*node_def, *op_def));
+    if (versions()) {
+      TF_RETURN_IF_ERROR(CheckOpDeprecation(*op_def, versions()->producer()));
+    }
   }
   return Status::OK();
 }
@@ -1105,6 +1184,22 @@ Status GraphConstructor::Convert() {
     TF_RETURN_IF_ERROR(g_->AddFunctionLibrary(*library()));
   }
 
+  // Bulk-reserve the graph's id-indexed node and edge arrays from the
+  // GraphDef counts.  On graphs with hundreds of megabytes of nodes
+  // the repeated re-growth during node-by-node construction otherwise
+  // shows up prominently in session creation time.  The edge estimate
+  // adds one per node for the control edges FixupSourceAndSinkEdges
+  // may attach to roots and leaves.
+  {
+    const int num_nodes = node_def_count();
+    int num_inputs = 0;
+    for (int n = 0; n < num_nodes; ++n) {
+      num_inputs += get_node_def(n).input_size();
+    }
+    g_->ReserveNodes(num_nodes);
+    g_->ReserveEdges(num_inputs + num_nodes);
+  }
+
   std::vector<InputInfo> inputs;
   int processed = 0;
 
@@ -1218,7 +1313,7 @@ Status GraphConstructor::Convert() {
       if (opts_.uniquify_names && (prefix_.empty() || !opts_.uniquify_prefix)) {
         UniquifyNames(input_already_exists, &node_def);
       }
-      TF_RETURN_IF_ERROR(ModifyNodeDefForImport(&node_def));
+      TF_RETURN_IF_ERROR(ModifyNodeDefForImport(&node_def, o));
     }
     TF_RETURN_IF_ERROR(MakeNode(std::move(node_def), &node));
 
@@ -0,0 +1,294 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/concat_elimination.h"
+
+#include "absl/container/flat_hash_set.h"
+#include "tensorflow/core/common_runtime/scoped_allocator.h"
+#include "tensorflow/core/common_runtime/scoped_allocator_mgr.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/tensor_id.h"
+#include "tensorflow/core/grappler/costs/graph_properties.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/mutable_graph_view.h"
+#include "tensorflow/core/grappler/op_types.h"
+#include "tensorflow/core/grappler/optimizers/scoped_allocator_optimizer.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/grappler/utils/frame.h"
+#include "tensorflow/core/lib/gtl/flatset.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+const char kScopedAllocatorAttrName[] = "_scoped_allocator";
+
+// Scope ids handed out by this pass start well above the range used by
+// ScopedAllocatorOptimizer (which counts up from 1), so both passes can run
+// on the same graph without their per-step allocator ids colliding.
+constexpr int32 kConcatEliminationBaseId = 1 << 20;
+
+// Ops that are known to allocate their outputs through the standard
+// allocate_output path, so they honor the scope id planted on the output's
+// allocator attributes. Ops that may forward an input buffer (Identity,
+// Reshape, in-place element-wise updates, ...) must stay off this list.
+bool IsEligibleProducer(const NodeDef& node) {
+  static const gtl::FlatSet<string>* eligible_ops = new gtl::FlatSet<string>{
+      "Gather",
+      "GatherV2",
+      "GatherNd",
+      "SparseSegmentSum",
+      "SparseSegmentMean",
+      "SparseSegmentSqrtN",
+      "SparseSegmentSumWithNumSegments",
+      "SparseSegmentMeanWithNumSegments",
+      "SparseSegmentSqrtNWithNumSegments",
+      "SegmentSum",
+      "UnsortedSegmentSum",
+      "FusedEmbeddingSparsePostLookUp",
+      "MatMul",
+      "_FusedMatMul",
+      "BiasAdd",
+  };
+  return eligible_ops->count(node.op()) > 0;
+}
+
+// True iff output `output_slot` of `node` is already committed to some
+// scoped allocator.
+bool HasScopedAllocatorOnSlot(const NodeDef& node, int output_slot) {
+  std::vector<int32> scope_ids;
+  Status s = GetNodeAttr(AttrSlice(node), kScopedAllocatorAttrName, &scope_ids);
+  if (!s.ok()) return false;
+  for (int i = 0; i + 1 < scope_ids.size(); i += 2) {
+    if (scope_ids[i] == output_slot) return true;
+  }
+  return false;
+}
+
+// One data input of a candidate concat.
+struct ProducerDesc {
+  NodeDef* node;
+  int output_slot;
+  TensorShape shape;
+};
+
+// Checks whether `concat` can be replaced by a scoped allocation and, if so,
+// fills in the producers, element type, and output shape.
+bool MatchConcat(const MutableGraphView& view,
+                 const GraphProperties& properties, const FrameView& frames,
+                 NodeDef* concat, std::vector<ProducerDesc>* producers,
+                 DataType* dtype, TensorShape* output_shape) {
+  if (concat->op() != "ConcatV2") return false;
+  if (!frames.Frames(*concat).empty()) return false;
+
+  int n;
+  if (!TryGetNodeAttr(AttrSlice(*concat), "N", &n) || n < 2) return false;
+  if (!TryGetNodeAttr(AttrSlice(*concat), "T", dtype)) return false;
+  // The backing tensor is carved up in whole allocation-alignment units.
+  if (Allocator::kAllocatorAlignment % DataTypeSize(*dtype) != 0) return false;
+
+  // The output shape must be known so the backing tensor can be preallocated.
+  if (!properties.HasOutputProperties(concat->name())) return false;
+  const auto& concat_props = properties.GetOutputProperties(concat->name());
+  if (concat_props.size() != 1 ||
+      !TensorShape::IsValid(concat_props[0].shape()) ||
+      !PartialTensorShape(concat_props[0].shape()).IsFullyDefined()) {
+    return false;
+  }
+  *output_shape = TensorShape(concat_props[0].shape());
+
+  // The concat axis must be a known constant, and every dimension in front of
+  // it degenerate, so that each input occupies one contiguous slice of the
+  // result. Axis 1 over a real batch dimension would need strided writes,
+  // which a scoped allocation cannot express.
+  NodeDef* axis_node = view.GetNode(NodeName(concat->input(n)));
+  if (axis_node == nullptr || !IsConstant(*axis_node)) return false;
+  Tensor axis_tensor;
+  if (!axis_tensor.FromProto(axis_node->attr().at("value").tensor()) ||
+      axis_tensor.dims() != 0) {
+    return false;
+  }
+  int64 axis = axis_tensor.dtype() == DT_INT64
+                   ? axis_tensor.scalar<int64>()()
+                   : static_cast<int64>(axis_tensor.scalar<int32>()());
+  if (axis < 0) axis += output_shape->dims();
+  if (axis < 0 || axis >= output_shape->dims()) return false;
+  for (int64 d = 0; d < axis; ++d) {
+    if (output_shape->dim_size(d) != 1) return false;
+  }
+
+  absl::flat_hash_set<string> seen_inputs;
+  for (int i = 0; i < n; ++i) {
+    const TensorId input_id = ParseTensorName(concat->input(i));
+    // A tensor cannot occupy two fields of the same backing allocation.
+    if (!seen_inputs.insert(input_id.ToString()).second) return false;
+    NodeDef* producer = view.GetNode(input_id.node());
+    if (producer == nullptr || !IsEligibleProducer(*producer)) return false;
+    if (producer->device() != concat->device()) return false;
+    if (!frames.Frames(*producer).empty()) return false;
+    if (HasScopedAllocatorOnSlot(*producer, input_id.index())) return false;
+    if (!properties.HasOutputProperties(producer->name())) return false;
+    const auto& props = properties.GetOutputProperties(producer->name());
+    if (input_id.index() >= props.size()) return false;
+    const auto& prop = props[input_id.index()];
+    if (prop.dtype() != *dtype || !TensorShape::IsValid(prop.shape()) ||
+        !PartialTensorShape(prop.shape()).IsFullyDefined()) {
+      return false;
+    }
+    producers->push_back(
+        {producer, input_id.index(), TensorShape(prop.shape())});
+  }
+
+  // The scoped allocator aligns every field; any padding between fields would
+  // surface as garbage in the middle of the concatenated result.
+  std::vector<TensorShape> shapes;
+  shapes.reserve(producers->size());
+  for (const ProducerDesc& p : *producers) shapes.push_back(p.shape);
+  std::vector<ScopedAllocator::Field> fields;
+  ScopedAllocatorMgr::PopulateFields(/*scope_id=*/0, shapes, *dtype, &fields);
+  int64 exact_offset = 0;
+  for (int i = 0; i < fields.size(); ++i) {
+    if (fields[i].offset != exact_offset) return false;
+    exact_offset += shapes[i].num_elements() * DataTypeSize(*dtype);
+  }
+  return true;
+}
+
+Status RewriteConcat(const std::vector<ProducerDesc>& producers,
+                     DataType dtype, const TensorShape& output_shape,
+                     int32 sa_id, int64 invocation_count, NodeDef* concat,
+                     MutableGraphView* view) {
+  const string& device = concat->device();
+  const string sa_name = strings::StrCat("concat_elimination_sa_", sa_id, "_",
+                                         invocation_count);
+  const string sac_name = strings::StrCat("concat_elimination_sa_concat_",
+                                          sa_id, "_", invocation_count);
+
+  std::vector<TensorShape> input_shapes;
+  input_shapes.reserve(producers.size());
+  for (const ProducerDesc& p : producers) input_shapes.push_back(p.shape);
+  TensorShape sa_shape({output_shape.num_elements()});
+
+  NodeDef sa_node;
+  NodeDefBuilder sa_builder(sa_name, "_ScopedAllocator");
+  sa_builder.Device(device);
+  sa_builder.Attr("sa_name", sa_name);
+  sa_builder.Attr("T", dtype);
+  sa_builder.Attr("id", sa_id);
+  sa_builder.Attr("shapes", input_shapes);
+  sa_builder.Attr("shape", sa_shape);
+  sa_builder.Attr("expected_call_count",
+                  static_cast<int64>(producers.size()));
+  TF_RETURN_IF_ERROR(sa_builder.Finalize(&sa_node));
+  view->AddNode(std::move(sa_node));
+
+  // Commit each producer output to its field of the backing tensor, and make
+  // sure the allocator exists before any producer runs.
+  for (int i = 0; i < producers.size(); ++i) {
+    const ProducerDesc& p = producers[i];
+    ScopedAllocatorOptimizer::ExtendNodeAttr(
+        kScopedAllocatorAttrName, {p.output_slot, sa_id + 1 + i}, p.node);
+    TF_RETURN_IF_ERROR(view->AddControllingFanin(
+        p.node->name(), TensorId(sa_name, Graph::kControlSlot)));
+  }
+
+  NodeDef sac_node;
+  NodeDefBuilder sac_builder(sac_name, "_ScopedAllocatorConcat");
+  sac_builder.Device(device);
+  sac_builder.Attr("sa_name", sa_name);
+  sac_builder.Attr("id", sa_id);
+  sac_builder.Attr("T", dtype);
+  sac_builder.Attr("shape", output_shape);
+  sac_builder.Attr("reshape", true);
+  sac_builder.Attr("N", static_cast<int>(producers.size()));
+  sac_builder.Input(NodeDefBuilder::NodeOut(sa_name, 0, dtype));
+  std::vector<NodeDefBuilder::NodeOut> sac_inputs;
+  for (const ProducerDesc& p : producers) {
+    sac_inputs.push_back(
+        NodeDefBuilder::NodeOut(p.node->name(), p.output_slot, dtype));
+  }
+  sac_builder.Input(sac_inputs);
+  TF_RETURN_IF_ERROR(sac_builder.Finalize(&sac_node));
+  // Keep any control inputs the concat had.
+  for (const string& input : concat->input()) {
+    if (IsControlInput(input)) sac_node.add_input(input);
+  }
+  view->AddNode(std::move(sac_node));
+
+  // The concat itself becomes dead and is left to the pruning passes.
+  return view->UpdateFanouts(concat->name(), sac_name);
+}
+
+}  // namespace
+
+Status ConcatElimination::Optimize(Cluster* cluster, const GrapplerItem& item,
+                                   GraphDef* optimized_graph) {
+  GraphProperties properties(item);
+  TF_RETURN_IF_ERROR(properties.InferStatically(
+      /*assume_valid_feeds=*/false, /*aggressive_shape_inference=*/false,
+      /*include_tensor_values=*/false));
+  *optimized_graph = item.graph;
+  MutableGraphView view(optimized_graph);
+
+  FrameView frames;
+  TF_RETURN_IF_ERROR(frames.InferFromGraph(*optimized_graph));
+  const std::unordered_set<string> nodes_to_preserve = item.NodesToPreserve();
+
+  // The nodes created here are stateful, so their names (and thus the sa_name
+  // keys in the per-step ScopedAllocatorMgr) must be unique per process.
+  static std::atomic<int64> invocation_counter(1);
+  const int64 invocation_count =
+      invocation_counter.fetch_add(1, std::memory_order_seq_cst);
+
+  std::vector<NodeDef*> candidates;
+  const int num_nodes = item.graph.node_size();
+  for (int i = 0; i < num_nodes; ++i) {
+    NodeDef* node = optimized_graph->mutable_node(i);
+    if (node->op() == "ConcatV2" &&
+        nodes_to_preserve.count(node->name()) == 0) {
+      candidates.push_back(node);
+    }
+  }
+
+  int32 next_sa_id = kConcatEliminationBaseId;
+  for (NodeDef* concat : candidates) {
+    std::vector<ProducerDesc> producers;
+    DataType dtype;
+    TensorShape output_shape;
+    if (!MatchConcat(view, properties, frames, concat, &producers, &dtype,
+                     &output_shape)) {
+      continue;
+    }
+    VLOG(1) << "ConcatElimination replacing " << concat->name() << " ("
+            << producers.size() << " inputs) with a scoped allocation";
+    const int32 sa_id = next_sa_id;
+    next_sa_id += producers.size() + 1;
+    TF_RETURN_IF_ERROR(RewriteConcat(producers, dtype, output_shape, sa_id,
+                                     invocation_count, concat, &view));
+  }
+  return Status::OK();
+}
+
+void ConcatElimination::Feedback(Cluster* cluster, const GrapplerItem& item,
+                                 const GraphDef& optimize_output,
+                                 double result) {
+  // Nothing to do for ConcatElimination.
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
@@ -0,0 +1,63 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_CONCAT_ELIMINATION_H_
+#define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_CONCAT_ELIMINATION_H_
+
+#include "tensorflow/core/grappler/optimizers/graph_optimizer.h"
+#include "tensorflow/core/protobuf/rewriter_config.pb.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// Removes the copy performed by a ConcatV2 whose inputs can be produced
+// directly into the concatenated buffer.
+//
+// For an eligible ConcatV2 a _ScopedAllocator node is inserted that
+// preallocates the concatenated tensor, each producer is marked to allocate
+// its output from a slice of that backing tensor, and the ConcatV2 is replaced
+// with a _ScopedAllocatorConcat that merely re-exposes the backing tensor.
+// This matters for feature-column graphs that end in one wide concat of
+// hundreds of embedding outputs, where the concat copy dominates memory
+// bandwidth.
+//
+// A concat is eligible when its producers allocate their outputs (a fixed
+// allowlist of ops), everything lives on one device with statically known
+// shapes outside of loops, and the inputs are laid out contiguously in the
+// result, i.e. the concat axis is the first non-degenerate dimension and each
+// slice meets the allocator alignment. Strided layouts (e.g. axis 1 with a
+// real batch dimension) cannot be expressed with scoped allocators and are
+// left untouched.
+class ConcatElimination : public GraphOptimizer {
+ public:
+  ConcatElimination() = default;
+  explicit ConcatElimination(RewriterConfig::Toggle opt_level) {}
+  ~ConcatElimination() override {}
+
+  string name() const override { return "concat_elimination"; };
+
+  bool UsesFunctionLibrary() const override { return false; }
+
+  Status Optimize(Cluster* cluster, const GrapplerItem& item,
+                  GraphDef* output) override;
+
+  void Feedback(Cluster* cluster, const GrapplerItem& item,
+                const GraphDef& optimize_output, double result) override;
+};
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_CONCAT_ELIMINATION_H_
@@ -0,0 +1,102 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/concat_elimination.h"
+
+#include "absl/strings/match.h"
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/grappler/utils/grappler_test.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+class ConcatEliminationTest : public GrapplerTest {
+ protected:
+  // Concat of two GatherV2 outputs. With axis 0 each input is a contiguous
+  // slice of the result, so the concat is eligible; each slice is
+  // 4 x 8 floats = 128 bytes, a multiple of the allocator alignment.
+  GrapplerItem BuildGatherConcatItem(int axis) {
+    tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+
+    Tensor params_tensor(DT_FLOAT, TensorShape({16, 8}));
+    test::FillIota<float>(&params_tensor, 1.0f);
+    Output params = ops::Const(s.WithOpName("params"), params_tensor);
+    Output ids_a =
+        ops::Const<int32>(s.WithOpName("ids_a"), {0, 2, 4, 6}, {4});
+    Output ids_b =
+        ops::Const<int32>(s.WithOpName("ids_b"), {1, 3, 5, 7}, {4});
+    Output gather_axis = ops::Const(s.WithOpName("gather_axis"), 0);
+    Output gather_a =
+        ops::GatherV2(s.WithOpName("gather_a"), params, ids_a, gather_axis);
+    Output gather_b =
+        ops::GatherV2(s.WithOpName("gather_b"), params, ids_b, gather_axis);
+    Output concat =
+        ops::Concat(s.WithOpName("concat"), {gather_a, gather_b},
+                    ops::Const(s.WithOpName("concat_axis"), axis));
+    Output output = ops::Identity(s.WithOpName("output"), concat);
+
+    GrapplerItem item;
+    item.fetch = {"output"};
+    TF_CHECK_OK(s.ToGraphDef(&item.graph));
+    return item;
+  }
+};
+
+TEST_F(ConcatEliminationTest, ReplacesContiguousConcat) {
+  GrapplerItem item = BuildGatherConcatItem(/*axis=*/0);
+  const auto tensors_expected = EvaluateNodes(item.graph, item.fetch);
+
+  ConcatElimination optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  EXPECT_EQ(1, CountOpNodes(output, "_ScopedAllocator"));
+  EXPECT_EQ(1, CountOpNodes(output, "_ScopedAllocatorConcat"));
+  // The fetch node must now read from the scoped allocator concat.
+  for (const NodeDef& node : output.node()) {
+    if (node.name() == "output") {
+      EXPECT_TRUE(absl::StartsWith(node.input(0),
+                                   "concat_elimination_sa_concat_"))
+          << node.input(0);
+    }
+  }
+
+  const auto tensors = EvaluateNodes(output, item.fetch);
+  ASSERT_EQ(1, tensors.size());
+  test::ExpectTensorEqual<float>(tensors_expected[0], tensors[0]);
+}
+
+TEST_F(ConcatEliminationTest, SkipsStridedConcat) {
+  // Axis 1 over a real leading dimension needs strided writes, which a
+  // scoped allocation cannot express.
+  GrapplerItem item = BuildGatherConcatItem(/*axis=*/1);
+
+  ConcatElimination optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  EXPECT_EQ(0, CountOpNodes(output, "_ScopedAllocator"));
+  EXPECT_EQ(0, CountOpNodes(output, "_ScopedAllocatorConcat"));
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
@@ -0,0 +1,390 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/fused_embedding_rewrite.h"
+
+#include "absl/container/flat_hash_set.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/mutable_graph_view.h"
+#include "tensorflow/core/grappler/op_types.h"
+#include "tensorflow/core/grappler/optimizers/custom_graph_optimizer_registry.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+// The unfused subgraph produced by embedding_lookup_sparse /
+// safe_embedding_lookup_sparse for a single-partition variable:
+//
+//   F = SparseFillEmptyRows(sp_indices, sp_values, sp_dense_shape, default)
+//   U = Unique(F:1)
+//   G = GatherV2(params, U:0, 0)
+//   SS = StridedSlice(F:0)  [-> Cast]   (segment ids = first indices column)
+//   S = SparseSegment{Sum,Mean,SqrtN}(G, U:1, segment_ids)
+//
+// optionally followed by the empty-row zeroing emitted when no default value
+// was given:
+//
+//   W = Select(Tile(Reshape(F:2)), ZerosLike(S), S)
+struct EmbeddingLookupPattern {
+  NodeDef* fill = nullptr;
+  NodeDef* unique = nullptr;
+  NodeDef* strided_slice = nullptr;
+  NodeDef* cast = nullptr;  // Optional.
+  NodeDef* gather = nullptr;
+  NodeDef* segment = nullptr;
+  // Optional empty-row zeroing tail; all set or all null.
+  NodeDef* reshape = nullptr;
+  NodeDef* tile = nullptr;
+  NodeDef* zeros_like = nullptr;
+  NodeDef* select = nullptr;
+
+  // Default value passed to SparseFillEmptyRows, or -1 when the zeroing tail
+  // is present (the python fused path encodes "no default" the same way).
+  int64 default_id = -1;
+  string combiner;
+
+  NodeDef* final_node() const { return select != nullptr ? select : segment; }
+};
+
+bool HasControlInput(const NodeDef& node) {
+  for (const string& input : node.input()) {
+    if (IsControlInput(input)) return true;
+  }
+  return false;
+}
+
+// Returns the node behind `node.input(i)`, requiring that it is consumed at
+// output port `expected_port`.
+NodeDef* GetInputNode(const MutableGraphView& view, const NodeDef& node, int i,
+                      int expected_port) {
+  if (i >= node.input_size()) return nullptr;
+  int port;
+  const string name = ParseNodeName(node.input(i), &port);
+  if (port != expected_port) return nullptr;
+  return view.GetNode(name);
+}
+
+// Returns true iff output `port` of `node` is consumed by `consumer` and by
+// nothing else. The rewrite deletes nothing, but it only fires when every
+// intermediate result is private to the pattern; a gradient subgraph hanging
+// off any of these ports (i.e. a training graph) fails this check.
+bool HasExclusiveFanout(const MutableGraphView& view, NodeDef* node, int port,
+                        const NodeDef* consumer) {
+  const auto& fanout =
+      view.GetFanout(MutableGraphView::OutputPort(node, port));
+  return fanout.size() == 1 && fanout.begin()->node == consumer;
+}
+
+bool HasNoFanout(const MutableGraphView& view, NodeDef* node, int port) {
+  return view.GetFanout(MutableGraphView::OutputPort(node, port)).empty();
+}
+
+// Reads the scalar integer constant behind `node`, e.g. a GatherV2 axis or a
+// SparseFillEmptyRows default value.
+bool GetScalarIntConst(const NodeDef& node, int64* value) {
+  if (!IsConstant(node)) return false;
+  const auto it = node.attr().find("value");
+  if (it == node.attr().end()) return false;
+  Tensor tensor;
+  if (!tensor.FromProto(it->second.tensor())) return false;
+  if (tensor.dims() != 0) return false;
+  if (tensor.dtype() == DT_INT64) {
+    *value = tensor.scalar<int64>()();
+  } else if (tensor.dtype() == DT_INT32) {
+    *value = tensor.scalar<int32>()();
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool GetCombiner(const NodeDef& node, string* combiner) {
+  if (node.op() == "SparseSegmentSum") {
+    *combiner = "sum";
+  } else if (node.op() == "SparseSegmentMean") {
+    *combiner = "mean";
+  } else if (node.op() == "SparseSegmentSqrtN") {
+    *combiner = "sqrtn";
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Matches the optional Select-based empty-row zeroing above `segment` and
+// fills in the tail fields of `pattern`. Returns false if `segment` has
+// consumers that are neither that tail nor absent.
+bool MatchZeroingTail(const MutableGraphView& view,
+                      EmbeddingLookupPattern* pattern) {
+  const auto& fanout = view.GetFanout(
+      MutableGraphView::OutputPort(pattern->segment, 0));
+  NodeDef* zeros_like = nullptr;
+  NodeDef* select = nullptr;
+  for (const auto& port : fanout) {
+    if (IsZerosLike(*port.node) && zeros_like == nullptr) {
+      zeros_like = port.node;
+    } else if (IsSelect(*port.node) && select == nullptr) {
+      select = port.node;
+    } else {
+      return false;
+    }
+  }
+  if (zeros_like == nullptr || select == nullptr) return false;
+  if (HasControlInput(*zeros_like) || HasControlInput(*select)) return false;
+  if (GetInputNode(view, *select, 1, 0) != zeros_like ||
+      GetInputNode(view, *select, 2, 0) != pattern->segment) {
+    return false;
+  }
+  if (!HasExclusiveFanout(view, zeros_like, 0, select)) return false;
+
+  // The condition input is Tile(Reshape(F:2)).
+  NodeDef* tile = GetInputNode(view, *select, 0, 0);
+  if (tile == nullptr || !IsTile(*tile) || HasControlInput(*tile)) {
+    return false;
+  }
+  NodeDef* reshape = GetInputNode(view, *tile, 0, 0);
+  if (reshape == nullptr || !IsReshape(*reshape) ||
+      HasControlInput(*reshape)) {
+    return false;
+  }
+  if (GetInputNode(view, *reshape, 0, 2) != pattern->fill) return false;
+  if (!HasExclusiveFanout(view, pattern->fill, 2, reshape) ||
+      !HasExclusiveFanout(view, reshape, 0, tile) ||
+      !HasExclusiveFanout(view, tile, 0, select)) {
+    return false;
+  }
+
+  pattern->reshape = reshape;
+  pattern->tile = tile;
+  pattern->zeros_like = zeros_like;
+  pattern->select = select;
+  return true;
+}
+
+// Attempts to match the unfused lookup subgraph rooted at the segment
+// reduction `segment`.
+bool MatchEmbeddingLookup(const MutableGraphView& view, NodeDef* segment,
+                          EmbeddingLookupPattern* pattern) {
+  if (!GetCombiner(*segment, &pattern->combiner)) return false;
+  if (HasControlInput(*segment)) return false;
+  pattern->segment = segment;
+
+  // segment.input(0): GatherV2(params, Unique:0, 0) with float params.
+  NodeDef* gather = GetInputNode(view, *segment, 0, 0);
+  if (gather == nullptr || HasControlInput(*gather)) return false;
+  if (gather->op() == "GatherV2") {
+    NodeDef* axis = GetInputNode(view, *gather, 2, 0);
+    int64 axis_value;
+    if (axis == nullptr || !GetScalarIntConst(*axis, &axis_value) ||
+        axis_value != 0) {
+      return false;
+    }
+  } else if (gather->op() != "Gather") {
+    return false;
+  }
+  const auto tparams = gather->attr().find("Tparams");
+  if (tparams == gather->attr().end() || tparams->second.type() != DT_FLOAT) {
+    return false;
+  }
+  pattern->gather = gather;
+
+  // segment.input(1): Unique:1, with Unique:0 feeding the gather.
+  NodeDef* unique = GetInputNode(view, *segment, 1, 1);
+  if (unique == nullptr || unique->op() != "Unique" ||
+      HasControlInput(*unique)) {
+    return false;
+  }
+  if (GetInputNode(view, *gather, 1, 0) != unique) return false;
+  pattern->unique = unique;
+
+  // segment.input(2): segment ids, StridedSlice(F:0) optionally cast to
+  // int32.
+  NodeDef* segment_ids = GetInputNode(view, *segment, 2, 0);
+  if (segment_ids == nullptr) return false;
+  if (IsCast(*segment_ids)) {
+    if (HasControlInput(*segment_ids)) return false;
+    pattern->cast = segment_ids;
+    segment_ids = GetInputNode(view, *segment_ids, 0, 0);
+    if (segment_ids == nullptr) return false;
+  }
+  if (!IsStridedSlice(*segment_ids) || HasControlInput(*segment_ids)) {
+    return false;
+  }
+  pattern->strided_slice = segment_ids;
+
+  // The slice and the unique both read from the same SparseFillEmptyRows.
+  NodeDef* fill = GetInputNode(view, *pattern->strided_slice, 0, 0);
+  if (fill == nullptr || fill->op() != "SparseFillEmptyRows" ||
+      HasControlInput(*fill)) {
+    return false;
+  }
+  if (GetInputNode(view, *unique, 0, 1) != fill) return false;
+  pattern->fill = fill;
+
+  // Every intermediate output must be private to the pattern.
+  if (!HasExclusiveFanout(view, fill, 0, pattern->strided_slice) ||
+      !HasExclusiveFanout(view, fill, 1, unique) ||
+      !HasNoFanout(view, fill, 3) ||
+      !HasExclusiveFanout(view, unique, 0, gather) ||
+      !HasExclusiveFanout(view, unique, 1, segment) ||
+      !HasExclusiveFanout(view, gather, 0, segment)) {
+    return false;
+  }
+  if (pattern->cast != nullptr) {
+    if (!HasExclusiveFanout(view, pattern->strided_slice, 0, pattern->cast) ||
+        !HasExclusiveFanout(view, pattern->cast, 0, segment)) {
+      return false;
+    }
+  } else if (!HasExclusiveFanout(view, pattern->strided_slice, 0, segment)) {
+    return false;
+  }
+
+  if (MatchZeroingTail(view, pattern)) {
+    // No default value: empty rows are filled with a placeholder id and
+    // zeroed after the reduction, which the post op does when its default_id
+    // is >= 0.
+    pattern->default_id = -1;
+  } else {
+    // Without the zeroing tail the default value fed to SparseFillEmptyRows
+    // participates in the reduction like a real id, so it must be a known
+    // constant we can hand to the pre op.
+    NodeDef* default_value = GetInputNode(view, *pattern->fill, 3, 0);
+    if (default_value == nullptr ||
+        !GetScalarIntConst(*default_value, &pattern->default_id) ||
+        pattern->default_id < 0) {
+      return false;
+    }
+    if (!HasNoFanout(view, pattern->fill, 2)) return false;
+  }
+  return true;
+}
+
+// Replaces the matched subgraph with
+//
+//   pre = FusedEmbeddingSparsePreLookUp(Shape(params), values, indices,
+//                                       dense_shape)
+//   gather' = GatherV2(params, pre:0, 0)
+//   post = FusedEmbeddingSparsePostLookUp(gather', pre:1, dense_shape,
+//                                         pre:2, pre:0)
+//
+// and reroutes the consumers of the pattern's final node to `post`. The
+// unfused nodes become dead and are left for the dependency pruner.
+Status RewriteEmbeddingLookup(const EmbeddingLookupPattern& pattern,
+                              MutableGraphView* view) {
+  const string prefix =
+      strings::StrCat(pattern.segment->name(), "/fused_embedding");
+  const NodeDef& fill = *pattern.fill;
+  const NodeDef& gather = *pattern.gather;
+
+  // With the zeroing tail present the fused ops reproduce the python path
+  // for default_id=None: the pre op flags empty rows and the post op zeroes
+  // them. Without it, the pre op fills empty rows with the pattern's constant
+  // default id and the post op leaves them alone.
+  const int64 pre_default_id = pattern.select != nullptr ? -1 : pattern.default_id;
+  const int64 post_default_id = pattern.select != nullptr ? 0 : -1;
+
+  NodeDef weight_shape;
+  weight_shape.set_name(strings::StrCat(prefix, "/weight_shape"));
+  weight_shape.set_op("Shape");
+  weight_shape.set_device(gather.device());
+  weight_shape.add_input(gather.input(0));
+  (*weight_shape.mutable_attr())["T"].set_type(DT_FLOAT);
+  (*weight_shape.mutable_attr())["out_type"].set_type(DT_INT64);
+
+  NodeDef pre;
+  pre.set_name(strings::StrCat(prefix, "/pre"));
+  pre.set_op("FusedEmbeddingSparsePreLookUp");
+  pre.set_device(fill.device());
+  pre.add_input(weight_shape.name());
+  pre.add_input(fill.input(1));  // sp_values
+  pre.add_input(fill.input(0));  // sp_indices
+  pre.add_input(fill.input(2));  // sp_dense_shape
+  (*pre.mutable_attr())["num_partitions"].set_i(1);
+  (*pre.mutable_attr())["partition_axis"].set_i(0);
+  (*pre.mutable_attr())["fill_empty_row"].set_b(true);
+  (*pre.mutable_attr())["prune_invalid_id"].set_b(false);
+  (*pre.mutable_attr())["default_id"].set_i(pre_default_id);
+  (*pre.mutable_attr())["partition_strategy"].set_s("div");
+
+  NodeDef fused_gather = gather;
+  fused_gather.set_name(strings::StrCat(prefix, "/gather"));
+  fused_gather.set_input(1, pre.name());
+
+  NodeDef post;
+  post.set_name(strings::StrCat(prefix, "/post"));
+  post.set_op("FusedEmbeddingSparsePostLookUp");
+  post.set_device(pattern.segment->device());
+  post.add_input(fused_gather.name());                     // emb_shards
+  post.add_input(strings::StrCat(pre.name(), ":1"));       // partitioned_indices
+  post.add_input(fill.input(2));                           // sp_dense_shape
+  post.add_input(strings::StrCat(pre.name(), ":2"));       // row_empty_and_invalid_flags
+  post.add_input(pre.name());                              // partitioned_values
+  (*post.mutable_attr())["T"].set_type(DT_FLOAT);
+  (*post.mutable_attr())["num_partitions"].set_i(1);
+  (*post.mutable_attr())["partition_axis"].set_i(0);
+  (*post.mutable_attr())["combiner"].set_s(pattern.combiner);
+  (*post.mutable_attr())["max_norm"].set_f(-1.0f);
+  (*post.mutable_attr())["default_id"].set_i(post_default_id);
+
+  view->AddNode(std::move(weight_shape));
+  view->AddNode(std::move(pre));
+  view->AddNode(std::move(fused_gather));
+  NodeDef* post_node = view->AddNode(std::move(post));
+  return view->UpdateFanouts(pattern.final_node()->name(), post_node->name());
+}
+
+}  // namespace
+
+Status FusedEmbeddingRewrite::Optimize(Cluster* cluster,
+                                       const GrapplerItem& item,
+                                       GraphDef* optimized_graph) {
+  *optimized_graph = item.graph;
+  MutableGraphView view(optimized_graph);
+
+  absl::flat_hash_set<string> fetch_nodes;
+  for (const string& fetch : item.fetch) {
+    fetch_nodes.insert(NodeName(fetch));
+  }
+
+  // Collect the segment reduction roots up front; the rewrite only appends
+  // nodes, so the original ones stay valid while we iterate.
+  std::vector<NodeDef*> candidates;
+  const int num_nodes = item.graph.node_size();
+  for (int i = 0; i < num_nodes; ++i) {
+    candidates.push_back(optimized_graph->mutable_node(i));
+  }
+
+  for (NodeDef* node : candidates) {
+    EmbeddingLookupPattern pattern;
+    if (!MatchEmbeddingLookup(view, node, &pattern)) continue;
+    // Fetching the unfused result directly gives the rewrite no consumer to
+    // reroute; leave such lookups alone.
+    if (fetch_nodes.contains(pattern.final_node()->name())) continue;
+    VLOG(2) << "Fusing embedding lookup rooted at "
+            << SummarizeNodeDef(*pattern.segment);
+    TF_RETURN_IF_ERROR(RewriteEmbeddingLookup(pattern, &view));
+  }
+  return Status::OK();
+}
+
+REGISTER_GRAPH_OPTIMIZER_AS(FusedEmbeddingRewrite, "fused_embedding_rewrite");
+
+}  // namespace grappler
+}  // namespace tensorflow
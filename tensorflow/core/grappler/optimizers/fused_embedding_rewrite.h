@@ -0,0 +1,66 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_FUSED_EMBEDDING_REWRITE_H_
+#define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_FUSED_EMBEDDING_REWRITE_H_
+
+#include "tensorflow/core/grappler/optimizers/custom_graph_optimizer.h"
+#include "tensorflow/core/protobuf/rewriter_config.pb.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// Rewrites unfused sparse embedding lookup subgraphs
+//
+//   SparseFillEmptyRows -> Unique -> Gather(V2) -> SparseSegment{Sum,Mean,
+//   SqrtN}
+//
+// into the fused FusedEmbeddingSparsePreLookUp / Gather /
+// FusedEmbeddingSparsePostLookUp form, so models built with the plain
+// embedding_lookup_sparse python API benefit from the fused kernels without
+// being retouched.
+//
+// The rewrite is forward-only: patterns whose intermediate outputs have
+// consumers outside the pattern (e.g. attached gradient subgraphs) are left
+// untouched, so it is intended for inference graphs. Only single-partition
+// float32 lookups are matched; partitioned variables keep the unfused path.
+//
+// Registered as the custom graph optimizer "fused_embedding_rewrite"; enable
+// it through RewriterConfig.custom_optimizers.
+class FusedEmbeddingRewrite : public CustomGraphOptimizer {
+ public:
+  FusedEmbeddingRewrite() = default;
+  ~FusedEmbeddingRewrite() override = default;
+
+  string name() const override { return "fused_embedding_rewrite"; }
+
+  bool UsesFunctionLibrary() const override { return false; }
+
+  Status Init(const tensorflow::RewriterConfig_CustomGraphOptimizer* config =
+                  nullptr) override {
+    return Status::OK();
+  }
+
+  Status Optimize(Cluster* cluster, const GrapplerItem& item,
+                  GraphDef* optimized_graph) override;
+
+  void Feedback(Cluster* cluster, const GrapplerItem& item,
+                const GraphDef& optimized_graph, double result) override {}
+};
+
+}  // namespace grappler
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_FUSED_EMBEDDING_REWRITE_H_
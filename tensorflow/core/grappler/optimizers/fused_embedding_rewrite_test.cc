@@ -0,0 +1,122 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/fused_embedding_rewrite.h"
+
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/grappler/utils/grappler_test.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+class FusedEmbeddingRewriteTest : public GrapplerTest {
+ protected:
+  // Builds the subgraph that embedding_lookup_sparse emits for a
+  // single-partition float variable: SparseFillEmptyRows -> Unique ->
+  // GatherV2 -> SparseSegmentSum, with segment ids carved out of the filled
+  // indices by StridedSlice + Cast. The result is wrapped in an Identity so
+  // the reduction itself is not a fetch node.
+  GrapplerItem BuildLookupItem() {
+    tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+
+    Tensor params_tensor(DT_FLOAT, TensorShape({8, 4}));
+    test::FillIota<float>(&params_tensor, 1.0f);
+    Output params = ops::Const(s.WithOpName("params"), params_tensor);
+
+    Output sp_indices = ops::Const<int64>(s.WithOpName("sp_indices"),
+                                          {0ll, 0ll, 1ll, 0ll, 3ll, 0ll},
+                                          {3, 2});
+    Output sp_values =
+        ops::Const<int64>(s.WithOpName("sp_values"), {3ll, 1ll, 5ll}, {3});
+    Output sp_dense_shape =
+        ops::Const<int64>(s.WithOpName("sp_dense_shape"), {4ll, 1ll}, {2});
+    Output default_value =
+        ops::Const<int64>(s.WithOpName("default_value"), 0ll, {});
+
+    auto fill = ops::SparseFillEmptyRows(s.WithOpName("fill"), sp_indices,
+                                         sp_values, sp_dense_shape,
+                                         default_value);
+    auto unique = ops::Unique(s.WithOpName("unique"), fill.output_values);
+    Output gather =
+        ops::GatherV2(s.WithOpName("gather"), params, unique.y,
+                      ops::Const(s.WithOpName("axis"), 0));
+    Output segment_ids_64 = ops::StridedSlice(
+        s.WithOpName("segment_ids_64"), fill.output_indices,
+        ops::Const<int32>(s.WithOpName("begin"), {0, 0}, {2}),
+        ops::Const<int32>(s.WithOpName("end"), {0, 1}, {2}),
+        ops::Const<int32>(s.WithOpName("strides"), {1, 1}, {2}),
+        ops::StridedSlice::Attrs().BeginMask(1).EndMask(1).ShrinkAxisMask(2));
+    Output segment_ids =
+        ops::Cast(s.WithOpName("segment_ids"), segment_ids_64, DT_INT32);
+    Output segment = ops::SparseSegmentSum(s.WithOpName("segment"), gather,
+                                           unique.idx, segment_ids);
+    Output output = ops::Identity(s.WithOpName("output"), segment);
+
+    GrapplerItem item;
+    item.fetch = {"output"};
+    TF_CHECK_OK(s.ToGraphDef(&item.graph));
+    return item;
+  }
+};
+
+TEST_F(FusedEmbeddingRewriteTest, FusesInferenceLookup) {
+  GrapplerItem item = BuildLookupItem();
+  const auto tensors_expected = EvaluateNodes(item.graph, item.fetch);
+
+  FusedEmbeddingRewrite optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  EXPECT_EQ(1, CountOpNodes(output, "FusedEmbeddingSparsePreLookUp"));
+  EXPECT_EQ(1, CountOpNodes(output, "FusedEmbeddingSparsePostLookUp"));
+  // The fetch node must now read from the fused post op.
+  for (const NodeDef& node : output.node()) {
+    if (node.name() == "output") {
+      EXPECT_EQ("segment/fused_embedding/post", NodeName(node.input(0)));
+    }
+  }
+
+  const auto tensors = EvaluateNodes(output, item.fetch);
+  ASSERT_EQ(1, tensors.size());
+  test::ExpectTensorNear<float>(tensors_expected[0], tensors[0], 1e-6);
+}
+
+TEST_F(FusedEmbeddingRewriteTest, SkipsLookupWithExternalConsumer) {
+  GrapplerItem item = BuildLookupItem();
+  // A consumer outside the pattern (here, on the unique ids) marks the graph
+  // as needing the intermediate results, e.g. for gradients.
+  NodeDef* extra = item.graph.add_node();
+  extra->set_name("external");
+  extra->set_op("Identity");
+  extra->add_input("unique");
+  (*extra->mutable_attr())["T"].set_type(DT_INT64);
+
+  FusedEmbeddingRewrite optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  EXPECT_EQ(0, CountOpNodes(output, "FusedEmbeddingSparsePreLookUp"));
+  EXPECT_EQ(0, CountOpNodes(output, "FusedEmbeddingSparsePostLookUp"));
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
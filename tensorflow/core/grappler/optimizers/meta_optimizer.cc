@@ -15,6 +15,8 @@ limitations under the License.
 
 #include "tensorflow/core/grappler/optimizers/meta_optimizer.h"
 
+#include <list>
+
 #include "absl/strings/str_join.h"
 #include "absl/strings/substitute.h"
 #include "tensorflow/core/common_runtime/function.h"
@@ -40,6 +42,7 @@ limitations under the License.
 #include "tensorflow/core/grappler/optimizers/pin_to_host_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/remapper.h"
 #include "tensorflow/core/grappler/optimizers/concat_cast_fusing.h"
+#include "tensorflow/core/grappler/optimizers/concat_elimination.h"
 #include "tensorflow/core/grappler/optimizers/scoped_allocator_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/shape_optimizer.h"
 #include "tensorflow/core/grappler/utils/canonicalizer.h"
@@ -49,7 +52,11 @@ limitations under the License.
 #include "tensorflow/core/grappler/utils/tpu.h"
 #include "tensorflow/core/grappler/verifiers/structure_verifier.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/gtl/map_util.h"
+#include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/util/dump_graph.h"
 #include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/ptr_util.h"
@@ -177,6 +184,87 @@ bool MemoryOptimizerEnabled(
   return mem_opt_type != RewriterConfig::NO_MEM_OPT;
 }
 
+// Workers used to optimize independent function bodies concurrently.
+// TF_GRAPPLER_FUNCTION_PARALLELISM=0 (the default) keeps the sequential
+// order; -1 uses all cores.
+int32 FunctionOptimizationParallelismFromEnv() {
+  static const int32 threads = [] {
+    int64 value = 0;
+    TF_CHECK_OK(
+        ReadInt64FromEnvVar("TF_GRAPPLER_FUNCTION_PARALLELISM", 0, &value));
+    if (value < 0) value = port::MaxParallelism();
+    return static_cast<int32>(value);
+  }();
+  return threads;
+}
+
+// Process-wide memoization of meta optimizer output, keyed on graph
+// content and config rather than item id, so re-optimizing an unchanged
+// graph (e.g. after a model version bump re-creates the session) is a
+// copy instead of a full pipeline run. Armed by TF_GRAPPLER_ITEM_CACHE.
+class OptimizedGraphCache {
+ public:
+  static bool Enabled() {
+    static const bool enabled = [] {
+      bool value = false;
+      Status s = ReadBoolFromEnvVar("TF_GRAPPLER_ITEM_CACHE", false, &value);
+      if (!s.ok()) {
+        LOG(ERROR) << s.error_message();
+      }
+      return value;
+    }();
+    return enabled;
+  }
+
+  static OptimizedGraphCache* Global() {
+    static OptimizedGraphCache* cache = new OptimizedGraphCache;
+    return cache;
+  }
+
+  bool Lookup(uint64 key, GraphDef* graph) {
+    mutex_lock l(mu_);
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+      if (it->first == key) {
+        *graph = it->second;
+        entries_.splice(entries_.begin(), entries_, it);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void Insert(uint64 key, const GraphDef& graph) {
+    mutex_lock l(mu_);
+    entries_.emplace_front(key, graph);
+    if (entries_.size() > kMaxEntries) {
+      entries_.pop_back();
+    }
+  }
+
+ private:
+  // Optimized 1M+ node graphs are large; keep only a few.
+  static constexpr size_t kMaxEntries = 4;
+
+  mutex mu_;
+  std::list<std::pair<uint64, GraphDef>> entries_ GUARDED_BY(mu_);
+};
+
+uint64 GrapplerItemCacheKey(const GrapplerItem& item,
+                            const ConfigProto& config) {
+  uint64 key = DeterministicProtoHash64(item.graph);
+  key = Hash64Combine(key, DeterministicProtoHash64(config));
+  for (const string& fetch : item.fetch) {
+    key = Hash64Combine(key, Hash64(fetch));
+  }
+  for (const string& keep : item.keep_ops) {
+    key = Hash64Combine(key, Hash64(keep));
+  }
+  for (const string& device : item.devices()) {
+    key = Hash64Combine(key, Hash64(device));
+  }
+  return key;
+}
+
 }  // namespace
 
 #define MK_OPT(NAME, VALUE) \
@@ -213,6 +301,7 @@ std::unique_ptr<GraphOptimizer> MetaOptimizer::MakeNewOptimizer(
   MK_OPT("pin_to_host",
          new PinToHostOptimizer(cfg_.pin_to_host_optimization()));
   MK_OPT("concat_cast_fusing", new ConcatCastFusing());
+  MK_OPT("concat_elimination", new ConcatElimination());
 
   return std::unique_ptr<GraphOptimizer>();
 }
@@ -527,7 +616,10 @@ Status MetaOptimizer::OptimizeGraph(Cluster* cluster, const GrapplerItem& item,
                                    }) != optimization_result.results.end();
 
   // Record graph optimization result.
-  optimization_results_.push_back(optimization_result);
+  {
+    mutex_lock l(results_mu_);
+    optimization_results_.push_back(optimization_result);
+  }
 
   if (is_optimized) {
     TF_RETURN_IF_ERROR(TopologicalSort(optimized_graph));
@@ -609,7 +701,10 @@ Status MetaOptimizer::RunOptimizer(
 Status MetaOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
                                GraphDef* optimized_graph) {
   VLOG(1) << "Starting optimization for grappler item: " << item.id;
-  optimization_results_.clear();
+  {
+    mutex_lock l(results_mu_);
+    optimization_results_.clear();
+  }
 
   // Constructs a FunctionLibraryDefinition with functions that are reachable
   // from the nodes of the graph.
@@ -632,6 +727,18 @@ Status MetaOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
 
   GrapplerItem trimmed_item = item.WithGraph(std::move(trimmed_graph));
 
+  // The cache key covers graph content, config, fetches, keeps and
+  // devices but not item.id, so an identical graph resubmitted under a
+  // new model version is served without re-running the pipeline.
+  uint64 cache_key = 0;
+  if (OptimizedGraphCache::Enabled()) {
+    cache_key = GrapplerItemCacheKey(trimmed_item, config_proto_);
+    if (OptimizedGraphCache::Global()->Lookup(cache_key, optimized_graph)) {
+      VLOG(1) << "Optimized graph served from cache, item=" << item.id;
+      return Status::OK();
+    }
+  }
+
   VLOG(1) << absl::Substitute(
       "Deleted $0 unreachable functions from the graph (library size = $1)",
       item.graph.library().function_size() -
@@ -694,13 +801,21 @@ Status MetaOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
   bool optimize_function_library =
       item.optimization_options().optimize_function_library;
 
+  // Function bodies are independent partitions of the optimization
+  // work: every candidate below is turned into its own GrapplerItem
+  // against the pass-start library, so bodies can be optimized by a
+  // pool of workers and merged back in library order. Functions
+  // specialized during a pass are picked up by the next pass, the same
+  // place the sequential order handled them.
+  const int32 function_parallelism = FunctionOptimizationParallelismFromEnv();
+
   while (optimize_function_library) {
     optimize_function_library = false;
+    GRAPPLER_RETURN_IF_DEADLINE_EXCEEDED();
 
-    int function_idx = 0;
+    // Collect this pass's candidates against the current library.
+    std::vector<const FunctionDef*> candidates;
     for (const FunctionDef& func : optimized_graph->library().function()) {
-      GRAPPLER_RETURN_IF_DEADLINE_EXCEEDED();
-
       const string& func_name = func.signature().name();
 
       // Skip functions that are not reachable from the optimized graph.
@@ -716,88 +831,137 @@ Status MetaOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
       // the function optimizer, before we can optimize function body.
       if (IsParametrized(func)) continue;
 
-      VLOG(3) << "Optimize function: function=" << func_name << " ["
-              << function_idx++ << " of "
-              << optimized_graph->library().function_size() << "]";
-
-      // Function optimization might specialize nested function calls, so we
-      // have to reset the flag and do at least one more pass over the library.
-      optimize_function_library = true;
       optimized_funcs.insert(func_name);
+      candidates.push_back(&func);
+    }
+    if (candidates.empty()) break;
+
+    // Function optimization might specialize nested function calls, so we
+    // have to reset the flag and do at least one more pass over the library.
+    optimize_function_library = true;
 
-      // Make a GrapplerItem from a FunctionDef.
+    VLOG(3) << "Optimize " << candidates.size() << " functions of "
+            << optimized_graph->library().function_size()
+            << " in the library this pass";
+
+    struct FunctionOptimizationResult {
       GrapplerFunctionItem func_item;
-      TF_RETURN_IF_ERROR(MakeGrapplerFunctionItem(
-          func, flib, trimmed_item.graph.versions().producer(), &func_item));
-
-      // If we need to compute the gradient of optimized function at runtime, we
-      // can't perform non-differentiable rewrites.
-      func_item.optimization_options().allow_non_differentiable_rewrites =
-          !differentiable_functions.contains(func_name);
-
-      // Device set available to the function is defined only by the runtime,
-      // when we instantiate and execute the function. We can't use all devices
-      // available to the main graph, because after partitioning the function
-      // call node might execute on a remote worker.
-      if (!func_item.devices().empty()) {
-        return errors::Internal("GrapplerFunctionItem devices must be empty.");
-      }
+      GraphDef optimized_graph;
+      Status status;
+    };
+    const int num_candidates = candidates.size();
+    std::vector<FunctionOptimizationResult> func_results(num_candidates);
+
+    const bool is_tpu_graph = IsTPUGraphDef(*optimized_graph);
+    auto optimize_function_body = [&](int idx) {
+      const FunctionDef& func = *candidates[idx];
+      const string& func_name = func.signature().name();
+      FunctionOptimizationResult& result = func_results[idx];
+      auto body = [&]() -> Status {
+        // Make a GrapplerItem from a FunctionDef.
+        GrapplerFunctionItem& func_item = result.func_item;
+        TF_RETURN_IF_ERROR(MakeGrapplerFunctionItem(
+            func, flib, trimmed_item.graph.versions().producer(), &func_item));
+
+        // If we need to compute the gradient of optimized function at runtime,
+        // we can't perform non-differentiable rewrites.
+        func_item.optimization_options().allow_non_differentiable_rewrites =
+            !differentiable_functions.contains(func_name);
+
+        // Device set available to the function is defined only by the runtime,
+        // when we instantiate and execute the function. We can't use all
+        // devices available to the main graph, because after partitioning the
+        // function call node might execute on a remote worker.
+        if (!func_item.devices().empty()) {
+          return errors::Internal(
+              "GrapplerFunctionItem devices must be empty.");
+        }
 
-      // We are not allowed to prune certain types of ops from the graph
-      // instantiated by the function definition, because we must guarantee
-      // function execution semantics wrt side effects (see
-      // function_optimizer.cc).
-      func_item.optimization_options().allow_pruning_stateful_and_dataset_ops =
-          false;
-
-      // TODO(b/129545186): Shape inference in GraphProperties doesn't work well
-      // with _Arg nodes. Replace them with Placeholders with unknown shape.
-      absl::flat_hash_set<absl::string_view> input_nodes;
-      for (auto& input_arg : func_item.inputs()) {
-        input_nodes.insert(input_arg.node_name);
-      }
-      for (NodeDef& func_node : *func_item.graph.mutable_node()) {
-        if (input_nodes.contains(func_node.name())) {
-          func_node.set_op("Placeholder");
-          auto& attrs = *func_node.mutable_attr();
-          attrs["dtype"] = attrs["T"];
-          attrs.erase("index");
-          attrs.erase("T");
-          TensorShapeProto unknown_shape;
-          unknown_shape.set_unknown_rank(true);
-          *(attrs["shape"].mutable_shape()) = unknown_shape;
+        // We are not allowed to prune certain types of ops from the graph
+        // instantiated by the function definition, because we must guarantee
+        // function execution semantics wrt side effects (see
+        // function_optimizer.cc).
+        func_item.optimization_options()
+            .allow_pruning_stateful_and_dataset_ops = false;
+
+        // TODO(b/129545186): Shape inference in GraphProperties doesn't work
+        // well with _Arg nodes. Replace them with Placeholders with unknown
+        // shape.
+        absl::flat_hash_set<absl::string_view> input_nodes;
+        for (auto& input_arg : func_item.inputs()) {
+          input_nodes.insert(input_arg.node_name);
+        }
+        for (NodeDef& func_node : *func_item.graph.mutable_node()) {
+          if (input_nodes.contains(func_node.name())) {
+            func_node.set_op("Placeholder");
+            auto& attrs = *func_node.mutable_attr();
+            attrs["dtype"] = attrs["T"];
+            attrs.erase("index");
+            attrs.erase("T");
+            TensorShapeProto unknown_shape;
+            unknown_shape.set_unknown_rank(true);
+            *(attrs["shape"].mutable_shape()) = unknown_shape;
+          }
         }
-      }
 
-      // Optimize function body graph.
-      GraphDef optimized_func_graph;
-      if (IsTPUGraphDef(*optimized_graph)) {
-        // Skip optimizing functions if this is a TPU graph. Currently, Grappler
-        // passes do not handle TPU functions correctly in a variety of ways
-        // (Note that due to the pre-placement TPU graph rewriting passes, the
-        // TPU-related ops are encapsulated away into functions). For example,
-        // TPU graphs contain TPUReplicateMetadata node that carries relevant
-        // TPU metadata and Grappler passes could prune that away. Grappler
-        // passes could also cause issues around shape inference. Since the
-        // desired and existing behavior is to not optimize TPU functions with
-        // Grappler, this check preserves that. The only execption is
-        // implementation selector what is required to swap in some TPU specific
-        // lowering code and is verified the work correctly on TPUs.
-        ImplementationSelector implementation_selector;
-
-        // Implementation selector needs to have access to valid function
-        // signature and attributes, and it doesn't need actual function body.
-        FunctionDefLibrary func_item_function_library;
-        func_item_function_library.Swap(func_item.graph.mutable_library());
-        *func_item.graph.mutable_library() =
-            GetFunctionDefLibraryStub(func_item_function_library);
-
-        TF_RETURN_IF_ERROR(implementation_selector.Optimize(
-            cluster, func_item, &optimized_func_graph));
-      } else {
-        TF_RETURN_IF_ERROR(
-            OptimizeGraph(cluster, func_item, &optimized_func_graph));
+        // Optimize function body graph.
+        if (is_tpu_graph) {
+          // Skip optimizing functions if this is a TPU graph. Currently,
+          // Grappler passes do not handle TPU functions correctly in a variety
+          // of ways (Note that due to the pre-placement TPU graph rewriting
+          // passes, the TPU-related ops are encapsulated away into functions).
+          // For example, TPU graphs contain TPUReplicateMetadata node that
+          // carries relevant TPU metadata and Grappler passes could prune that
+          // away. Grappler passes could also cause issues around shape
+          // inference. Since the desired and existing behavior is to not
+          // optimize TPU functions with Grappler, this check preserves that.
+          // The only execption is implementation selector what is required to
+          // swap in some TPU specific lowering code and is verified the work
+          // correctly on TPUs.
+          ImplementationSelector implementation_selector;
+
+          // Implementation selector needs to have access to valid function
+          // signature and attributes, and it doesn't need actual function
+          // body.
+          FunctionDefLibrary func_item_function_library;
+          func_item_function_library.Swap(func_item.graph.mutable_library());
+          *func_item.graph.mutable_library() =
+              GetFunctionDefLibraryStub(func_item_function_library);
+
+          TF_RETURN_IF_ERROR(implementation_selector.Optimize(
+              cluster, func_item, &result.optimized_graph));
+        } else {
+          TF_RETURN_IF_ERROR(
+              OptimizeGraph(cluster, func_item, &result.optimized_graph));
+        }
+        return Status::OK();
+      };
+      result.status = body();
+    };
+
+    if (function_parallelism > 1 && num_candidates > 1) {
+      thread::ThreadPool pool(
+          Env::Default(), "grappler_function_optimization",
+          std::min<int32>(function_parallelism, num_candidates));
+      for (int i = 0; i < num_candidates; ++i) {
+        pool.Schedule([&optimize_function_body, i]() {
+          optimize_function_body(i);
+        });
       }
+      // The pool destructor joins the workers.
+    } else {
+      for (int i = 0; i < num_candidates; ++i) {
+        optimize_function_body(i);
+      }
+    }
+
+    // Merge phase: apply results in library order so the outcome does
+    // not depend on worker scheduling.
+    for (int i = 0; i < num_candidates; ++i) {
+      TF_RETURN_IF_ERROR(func_results[i].status);
+      const string& func_name = candidates[i]->signature().name();
+      GrapplerFunctionItem& func_item = func_results[i].func_item;
+      GraphDef& optimized_func_graph = func_results[i].optimized_graph;
 
       // Function body optimization might have created new specialized
       // functions for each instantiation context. Add them to the library.
@@ -817,10 +981,8 @@ Status MetaOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
       TF_RETURN_IF_ERROR(flib.ReplaceFunction(func_name, optimized_func));
     }
 
-    // If optimized at least one function, update the graph library.
-    if (optimize_function_library) {
-      *optimized_graph->mutable_library() = flib.ToProto();
-    }
+    // Update the graph library with this pass's results.
+    *optimized_graph->mutable_library() = flib.ToProto();
   }
 
   VLOG(1) << "Optimized " << optimized_funcs.size()
@@ -832,10 +994,15 @@ Status MetaOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
                         reinterpret_cast<uintptr_t>(optimized_graph)),
         *optimized_graph);
   }
+
+  if (OptimizedGraphCache::Enabled()) {
+    OptimizedGraphCache::Global()->Insert(cache_key, *optimized_graph);
+  }
   return Status::OK();
 }
 
 void MetaOptimizer::PrintResult() {
+  mutex_lock l(results_mu_);
   for (const GraphOptimizationResult& graph_result : optimization_results_) {
     LOG(INFO) << "Optimization results for grappler item: " << graph_result.id;
     for (const OptimizerResult& result : graph_result.results) {
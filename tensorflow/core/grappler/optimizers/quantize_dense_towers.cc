@@ -0,0 +1,247 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/quantize_dense_towers.h"
+
+#include <cmath>
+#include <set>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/optimizers/custom_graph_optimizer_registry.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+bool HasFloatT(const NodeDef& node) {
+  auto it = node.attr().find("T");
+  return it != node.attr().end() && it->second.type() == DT_FLOAT;
+}
+
+bool GetBoolAttr(const NodeDef& node, const string& name) {
+  auto it = node.attr().find(name);
+  return it != node.attr().end() && it->second.b();
+}
+
+}  // namespace
+
+Status QuantizeDenseTowers::Optimize(Cluster* cluster,
+                                     const GrapplerItem& item,
+                                     GraphDef* optimized_graph) {
+  *optimized_graph = item.graph;
+#ifndef INTEL_MKL
+  // QuantizedMatMulWithBiasAndRelu only has an MKL-DNN kernel (the one
+  // that lowers to VNNI); without it the rewrite would leave the graph
+  // unrunnable.
+  VLOG(1) << "quantize_dense_towers requires the MKL build; "
+          << "graph left unchanged.";
+  return Status::OK();
+#else
+  NodeMap node_map(optimized_graph);
+
+  // Nodes used as control dependencies must keep existing; skip chains
+  // touching them rather than re-homing the control edges.
+  absl::flat_hash_set<string> control_consumed;
+  for (const NodeDef& node : optimized_graph->node()) {
+    for (const string& input : node.input()) {
+      if (!input.empty() && input[0] == '^') {
+        control_consumed.insert(string(NodeNameAsStringPiece(input)));
+      }
+    }
+  }
+
+  std::set<string> nodes_to_delete;
+  int num_rewritten = 0;
+  const int node_count = optimized_graph->node_size();
+  for (int i = 0; i < node_count; ++i) {
+    NodeDef* relu = optimized_graph->mutable_node(i);
+    if (relu->op() != "Relu" || !HasFloatT(*relu) ||
+        relu->input_size() < 1) {
+      continue;
+    }
+
+    NodeDef* biasadd = node_map.GetNode(NodeName(relu->input(0)));
+    if (biasadd == nullptr || biasadd->op() != "BiasAdd" ||
+        !HasFloatT(*biasadd) || biasadd->input_size() != 2 ||
+        node_map.GetOutputs(biasadd->name()).size() != 1 ||
+        control_consumed.contains(biasadd->name())) {
+      continue;
+    }
+
+    NodeDef* matmul = node_map.GetNode(NodeName(biasadd->input(0)));
+    if (matmul == nullptr || matmul->op() != "MatMul" ||
+        !HasFloatT(*matmul) || matmul->input_size() != 2 ||
+        GetBoolAttr(*matmul, "transpose_a") ||
+        GetBoolAttr(*matmul, "transpose_b") ||
+        node_map.GetOutputs(matmul->name()).size() != 1 ||
+        control_consumed.contains(matmul->name())) {
+      continue;
+    }
+
+    NodeDef* weights = node_map.GetNode(NodeName(matmul->input(1)));
+    NodeDef* bias = node_map.GetNode(NodeName(biasadd->input(1)));
+    if (weights == nullptr || weights->op() != "Const" || bias == nullptr ||
+        bias->op() != "Const") {
+      continue;
+    }
+
+    // Weight scale fixed at load: quantize the Const here, symmetric
+    // qint8 so the kernel's SCALED weight path applies.
+    Tensor weights_t;
+    if (weights->attr().count("value") == 0 ||
+        !weights_t.FromProto(weights->attr().at("value").tensor()) ||
+        weights_t.dtype() != DT_FLOAT || weights_t.NumElements() == 0) {
+      continue;
+    }
+    float abs_max = 0.0f;
+    auto weights_flat = weights_t.flat<float>();
+    for (int64 j = 0; j < weights_flat.size(); ++j) {
+      abs_max = std::max(abs_max, std::abs(weights_flat(j)));
+    }
+    if (abs_max == 0.0f) {
+      continue;
+    }
+    const float scale = abs_max / 127.0f;
+    Tensor quantized_t(DT_QINT8, weights_t.shape());
+    auto quantized_flat = quantized_t.flat<qint8>();
+    for (int64 j = 0; j < weights_flat.size(); ++j) {
+      int32 q = static_cast<int32>(std::round(weights_flat(j) / scale));
+      q = std::max(-127, std::min(127, q));
+      quantized_flat(j) = qint8(q);
+    }
+
+    const string base = matmul->name();
+    const string& device = matmul->device();
+    const string x = matmul->input(0);
+    auto add_node = [&](const string& name, const string& op) {
+      NodeDef* node = optimized_graph->add_node();
+      node->set_name(name);
+      node->set_op(op);
+      node->set_device(device);
+      node_map.AddNode(name, node);
+      return node;
+    };
+    auto add_const = [&](const string& name, const Tensor& value) {
+      NodeDef* node = add_node(name, "Const");
+      (*node->mutable_attr())["dtype"].set_type(value.dtype());
+      value.AsProtoTensorContent(
+          (*node->mutable_attr())["value"].mutable_tensor());
+      return node;
+    };
+
+    NodeDef* w_q = add_const(strings::StrCat(base, "/weights_quantized"),
+                             quantized_t);
+    Tensor w_min_t(DT_FLOAT, TensorShape({}));
+    w_min_t.scalar<float>()() = -abs_max;
+    Tensor w_max_t(DT_FLOAT, TensorShape({}));
+    w_max_t.scalar<float>()() = abs_max;
+    NodeDef* w_min =
+        add_const(strings::StrCat(base, "/weights_min"), w_min_t);
+    NodeDef* w_max =
+        add_const(strings::StrCat(base, "/weights_max"), w_max_t);
+
+    // Dynamic per-batch calibration: reduce the activation over both
+    // dimensions each step and quantize with the observed range.
+    Tensor axes_t(DT_INT32, TensorShape({2}));
+    axes_t.vec<int32>()(0) = 0;
+    axes_t.vec<int32>()(1) = 1;
+    NodeDef* axes =
+        add_const(strings::StrCat(base, "/act_range_axes"), axes_t);
+    NodeDef* act_min = add_node(strings::StrCat(base, "/act_min"), "Min");
+    act_min->add_input(x);
+    act_min->add_input(axes->name());
+    (*act_min->mutable_attr())["T"].set_type(DT_FLOAT);
+    (*act_min->mutable_attr())["Tidx"].set_type(DT_INT32);
+    (*act_min->mutable_attr())["keep_dims"].set_b(false);
+    NodeDef* act_max = add_node(strings::StrCat(base, "/act_max"), "Max");
+    act_max->add_input(x);
+    act_max->add_input(axes->name());
+    (*act_max->mutable_attr())["T"].set_type(DT_FLOAT);
+    (*act_max->mutable_attr())["Tidx"].set_type(DT_INT32);
+    (*act_max->mutable_attr())["keep_dims"].set_b(false);
+
+    NodeDef* act_q =
+        add_node(strings::StrCat(base, "/act_quantized"), "QuantizeV2");
+    act_q->add_input(x);
+    act_q->add_input(act_min->name());
+    act_q->add_input(act_max->name());
+    (*act_q->mutable_attr())["T"].set_type(DT_QUINT8);
+    (*act_q->mutable_attr())["mode"].set_s("MIN_FIRST");
+
+    NodeDef* q_matmul = add_node(strings::StrCat(base, "/quantized"),
+                                 "QuantizedMatMulWithBiasAndRelu");
+    q_matmul->add_input(act_q->name());
+    q_matmul->add_input(w_q->name());
+    q_matmul->add_input(biasadd->input(1));
+    q_matmul->add_input(strings::StrCat(act_q->name(), ":1"));
+    q_matmul->add_input(strings::StrCat(act_q->name(), ":2"));
+    q_matmul->add_input(w_min->name());
+    q_matmul->add_input(w_max->name());
+    (*q_matmul->mutable_attr())["T1"].set_type(DT_QUINT8);
+    (*q_matmul->mutable_attr())["T2"].set_type(DT_QINT8);
+    (*q_matmul->mutable_attr())["Toutput"].set_type(DT_QINT32);
+    (*q_matmul->mutable_attr())["transpose_a"].set_b(false);
+    (*q_matmul->mutable_attr())["transpose_b"].set_b(false);
+    (*q_matmul->mutable_attr())["input_quant_mode"].set_s("MIN_FIRST");
+
+    // The Relu node becomes the Dequantize and keeps its name, so every
+    // downstream consumer (and fetch) is untouched. Control inputs on
+    // the Relu are carried over.
+    std::vector<string> control_inputs;
+    for (const string& input : relu->input()) {
+      if (!input.empty() && input[0] == '^') {
+        control_inputs.push_back(input);
+      }
+    }
+    relu->set_op("Dequantize");
+    relu->clear_input();
+    relu->add_input(q_matmul->name());
+    relu->add_input(strings::StrCat(q_matmul->name(), ":1"));
+    relu->add_input(strings::StrCat(q_matmul->name(), ":2"));
+    for (const string& input : control_inputs) {
+      relu->add_input(input);
+    }
+    relu->clear_attr();
+    (*relu->mutable_attr())["T"].set_type(DT_QINT32);
+    (*relu->mutable_attr())["mode"].set_s("MIN_FIRST");
+
+    nodes_to_delete.insert(matmul->name());
+    nodes_to_delete.insert(biasadd->name());
+    ++num_rewritten;
+  }
+
+  if (!nodes_to_delete.empty()) {
+    EraseNodesFromGraph(nodes_to_delete, optimized_graph);
+  }
+  if (num_rewritten > 0) {
+    LOG(INFO) << "quantize_dense_towers rewrote " << num_rewritten
+              << " MatMul+BiasAdd+Relu chain(s) to int8.";
+  }
+  return Status::OK();
+#endif  // INTEL_MKL
+}
+
+REGISTER_GRAPH_OPTIMIZER_AS(QuantizeDenseTowers, "quantize_dense_towers");
+
+}  // namespace grappler
+}  // namespace tensorflow
@@ -0,0 +1,67 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_QUANTIZE_DENSE_TOWERS_H_
+#define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_QUANTIZE_DENSE_TOWERS_H_
+
+#include "tensorflow/core/grappler/optimizers/custom_graph_optimizer.h"
+#include "tensorflow/core/protobuf/rewriter_config.pb.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// Rewrites the MatMul -> BiasAdd -> Relu chains of dense ranking towers
+// into int8 inference with dynamic per-batch calibration:
+//
+//   - weights (a Const) are quantized at rewrite time to a symmetric
+//     qint8 tensor with its range baked in as scalar Consts, so the
+//     weight scale is fixed at load;
+//   - activations get inline Min/Max reductions feeding QuantizeV2, so
+//     the activation scale tracks each batch;
+//   - the chain becomes QuantizedMatMulWithBiasAndRelu (qint32 output)
+//     followed by a Dequantize that keeps the Relu's node name, leaving
+//     every downstream consumer untouched.
+//
+// The quantized matmul kernel is provided by the MKL build, which lowers
+// to VNNI on hosts that have it; without INTEL_MKL the pass leaves the
+// graph unchanged. Only float chains with unfanned intermediate nodes
+// and Const weights/bias are rewritten. Registered as the custom graph
+// optimizer "quantize_dense_towers"; enable it through
+// RewriterConfig.custom_optimizers.
+class QuantizeDenseTowers : public CustomGraphOptimizer {
+ public:
+  QuantizeDenseTowers() = default;
+  ~QuantizeDenseTowers() override = default;
+
+  string name() const override { return "quantize_dense_towers"; }
+
+  bool UsesFunctionLibrary() const override { return false; }
+
+  Status Init(const tensorflow::RewriterConfig_CustomGraphOptimizer* config =
+                  nullptr) override {
+    return Status::OK();
+  }
+
+  Status Optimize(Cluster* cluster, const GrapplerItem& item,
+                  GraphDef* optimized_graph) override;
+
+  void Feedback(Cluster* cluster, const GrapplerItem& item,
+                const GraphDef& optimized_graph, double result) override {}
+};
+
+}  // namespace grappler
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_QUANTIZE_DENSE_TOWERS_H_
@@ -0,0 +1,150 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/quantize_dense_towers.h"
+
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/grappler/utils/grappler_test.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+class QuantizeDenseTowersTest : public GrapplerTest {
+ protected:
+  // One dense tower layer: x * W + b, relu'd, with Const weights/bias as
+  // a frozen inference graph has them.
+  GrapplerItem BuildDenseTowerItem() {
+    tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+
+    Tensor weights_tensor(DT_FLOAT, TensorShape({4, 3}));
+    test::FillIota<float>(&weights_tensor, -5.0f);
+    Tensor bias_tensor(DT_FLOAT, TensorShape({3}));
+    test::FillIota<float>(&bias_tensor, 0.5f);
+    Tensor input_tensor(DT_FLOAT, TensorShape({2, 4}));
+    test::FillIota<float>(&input_tensor, 0.25f);
+
+    Output x = ops::Const(s.WithOpName("x"), input_tensor);
+    Output weights = ops::Const(s.WithOpName("weights"), weights_tensor);
+    Output bias = ops::Const(s.WithOpName("bias"), bias_tensor);
+    Output matmul = ops::MatMul(s.WithOpName("matmul"), x, weights);
+    Output biasadd = ops::BiasAdd(s.WithOpName("biasadd"), matmul, bias);
+    Output relu = ops::Relu(s.WithOpName("relu"), biasadd);
+
+    GrapplerItem item;
+    item.fetch = {"relu"};
+    TF_CHECK_OK(s.ToGraphDef(&item.graph));
+    return item;
+  }
+};
+
+#ifdef INTEL_MKL
+TEST_F(QuantizeDenseTowersTest, RewritesDenseTowerChain) {
+  GrapplerItem item = BuildDenseTowerItem();
+
+  QuantizeDenseTowers optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  NodeMap node_map(&output);
+  // The chain collapsed into the quantized fused matmul; the Relu's name
+  // now belongs to the trailing Dequantize so fetches keep working.
+  const NodeDef* q_matmul = node_map.GetNode("matmul/quantized");
+  ASSERT_NE(q_matmul, nullptr);
+  EXPECT_EQ(q_matmul->op(), "QuantizedMatMulWithBiasAndRelu");
+  const NodeDef* dequantize = node_map.GetNode("relu");
+  ASSERT_NE(dequantize, nullptr);
+  EXPECT_EQ(dequantize->op(), "Dequantize");
+  EXPECT_EQ(node_map.GetNode("matmul"), nullptr);
+  EXPECT_EQ(node_map.GetNode("biasadd"), nullptr);
+
+  // Weights were quantized at rewrite time; activations get per-batch
+  // Min/Max calibration feeding QuantizeV2.
+  const NodeDef* w_q = node_map.GetNode("matmul/weights_quantized");
+  ASSERT_NE(w_q, nullptr);
+  EXPECT_EQ(w_q->attr().at("dtype").type(), DT_QINT8);
+  const NodeDef* act_q = node_map.GetNode("matmul/act_quantized");
+  ASSERT_NE(act_q, nullptr);
+  EXPECT_EQ(act_q->op(), "QuantizeV2");
+  EXPECT_NE(node_map.GetNode("matmul/act_min"), nullptr);
+  EXPECT_NE(node_map.GetNode("matmul/act_max"), nullptr);
+
+  auto tensors = EvaluateNodes(output, item.fetch);
+  ASSERT_EQ(tensors.size(), 1);
+  auto expected = EvaluateNodes(item.graph, item.fetch);
+  ASSERT_EQ(expected.size(), 1);
+  // int8 with per-batch ranges is lossy; a loose tolerance is all the
+  // rewrite promises.
+  test::ExpectClose(expected[0], tensors[0], /*atol=*/1e-1, /*rtol=*/1e-1);
+}
+
+TEST_F(QuantizeDenseTowersTest, SkipsFannedOutIntermediate) {
+  GrapplerItem item = BuildDenseTowerItem();
+  // A second consumer of the BiasAdd means the chain cannot be fused.
+  NodeDef* extra = item.graph.add_node();
+  extra->set_name("extra");
+  extra->set_op("Identity");
+  extra->add_input("biasadd");
+  (*extra->mutable_attr())["T"].set_type(DT_FLOAT);
+
+  QuantizeDenseTowers optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  NodeMap node_map(&output);
+  EXPECT_NE(node_map.GetNode("matmul"), nullptr);
+  EXPECT_NE(node_map.GetNode("biasadd"), nullptr);
+  EXPECT_EQ(node_map.GetNode("relu")->op(), "Relu");
+}
+
+TEST_F(QuantizeDenseTowersTest, SkipsNonConstWeights) {
+  GrapplerItem item = BuildDenseTowerItem();
+  // Weights behind an Identity are not a Const anymore.
+  NodeDef* weights_id = item.graph.add_node();
+  weights_id->set_name("weights_id");
+  weights_id->set_op("Identity");
+  weights_id->add_input("weights");
+  (*weights_id->mutable_attr())["T"].set_type(DT_FLOAT);
+  NodeMap pre_map(&item.graph);
+  pre_map.GetNode("matmul")->set_input(1, "weights_id");
+
+  QuantizeDenseTowers optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  NodeMap node_map(&output);
+  EXPECT_NE(node_map.GetNode("matmul"), nullptr);
+  EXPECT_EQ(node_map.GetNode("relu")->op(), "Relu");
+}
+#else
+TEST_F(QuantizeDenseTowersTest, NoOpWithoutMkl) {
+  GrapplerItem item = BuildDenseTowerItem();
+
+  QuantizeDenseTowers optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  CompareGraphs(item.graph, output);
+}
+#endif  // INTEL_MKL
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
@@ -14,6 +14,8 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/grappler/optimizers/scoped_allocator_optimizer.h"
 
+#include <cstdlib>
+
 #include "tensorflow/core/common_runtime/scoped_allocator.h"
 #include "tensorflow/core/common_runtime/scoped_allocator_mgr.h"
 #include "tensorflow/core/framework/graph.pb.h"
@@ -43,6 +45,17 @@ namespace {
 
 const char kScopedAllocatorAttrName[] = "_scoped_allocator";
 
+// Set TF_SCOPED_ALLOCATOR_ELIDE_CONCAT=1 to rewrite a downstream
+// axis-0 concat of a coalesced op set into a Reshape of the flat
+// backing tensor.  The replacement op already wrote its output
+// contiguously in field order, so the concat's copy is pure overhead
+// whenever the backing layout has no alignment padding between
+// fields.
+bool ElideDownstreamConcatEnabled() {
+  const char* flag = std::getenv("TF_SCOPED_ALLOCATOR_ELIDE_CONCAT");
+  return flag != nullptr && flag[0] == '1';
+}
+
 // Node names often have some kind of name_scope prefix, with slashes,
 // and a _nn numeric suffix.  Returns true if the main part of the node_name
 // matches op_name, i.e. it looks from the name like this node is
@@ -644,6 +657,125 @@ class UnaryElementwiseRewriter : public ScopedAllocatorOptimizer::Rewriter {
     return Status::OK();
   }
 
+  // If the sole consumer of the new ScopedAllocatorSplit is an axis-0
+  // concat taking the split outputs in field order, that concat
+  // merely re-materializes the backing tensor the replacement op
+  // already produced.  Mutate the concat into a Reshape of the flat
+  // replacement-op output and remove the split, eliminating the copy.
+  // Bails out without touching the graph whenever the pattern does
+  // not hold exactly, e.g. when alignment padding between the backing
+  // fields would make the flat layout differ from the concat result.
+  Status MaybeElideDownstreamConcat(GraphDef* graph, NodeMap* node_map,
+                                    const std::vector<TensorShape>& input_shapes,
+                                    const string& device_name, DataType dtype,
+                                    const string& sas_name,
+                                    const string& sa_op_name) {
+    // The flat backing tensor equals the axis-0 concat only if
+    // PopulateFields added no padding between fields.
+    for (const TensorShape& shape : input_shapes) {
+      if ((shape.num_elements() * DataTypeSize(dtype)) %
+              Allocator::kAllocatorAlignment !=
+          0) {
+        return Status::OK();
+      }
+    }
+    // All fields must agree on the non-concat dimensions.
+    const int rank = input_shapes[0].dims();
+    if (rank < 1) return Status::OK();
+    int64 dim0_sum = 0;
+    for (const TensorShape& shape : input_shapes) {
+      if (shape.dims() != rank) return Status::OK();
+      for (int d = 1; d < rank; ++d) {
+        if (shape.dim_size(d) != input_shapes[0].dim_size(d)) {
+          return Status::OK();
+        }
+      }
+      dim0_sum += shape.dim_size(0);
+    }
+    std::set<NodeDef*> split_outputs = node_map->GetOutputs(sas_name);
+    if (split_outputs.size() != 1) return Status::OK();
+    NodeDef* concat = *split_outputs.begin();
+    const bool is_v2 = concat->op() == "ConcatV2";
+    if (!is_v2 && concat->op() != "Concat") return Status::OK();
+    const int num_fields = static_cast<int>(input_shapes.size());
+    std::vector<string> data_inputs;
+    std::vector<string> ctl_inputs;
+    for (const string& input : concat->input()) {
+      if (!input.empty() && input[0] == '^') {
+        ctl_inputs.push_back(input);
+      } else {
+        data_inputs.push_back(input);
+      }
+    }
+    if (data_inputs.size() != static_cast<size_t>(num_fields + 1)) {
+      return Status::OK();
+    }
+    // Concat takes the axis first, ConcatV2 takes it last.
+    const string& axis_input = is_v2 ? data_inputs.back() : data_inputs.front();
+    const int field_base = is_v2 ? 0 : 1;
+    for (int i = 0; i < num_fields; ++i) {
+      int position = 0;
+      string input_node = ParseNodeName(data_inputs[field_base + i], &position);
+      if (input_node != sas_name || position != i) return Status::OK();
+    }
+    int axis_position = 0;
+    NodeDef* axis_node =
+        node_map->GetNode(ParseNodeName(axis_input, &axis_position));
+    if (axis_node == nullptr || axis_node->op() != "Const") {
+      return Status::OK();
+    }
+    Tensor axis_tensor;
+    if (!GetNodeAttr(*axis_node, "value", &axis_tensor).ok() ||
+        axis_tensor.NumElements() != 1) {
+      return Status::OK();
+    }
+    const int64 axis = axis_tensor.dtype() == DT_INT32
+                           ? static_cast<int64>(axis_tensor.flat<int32>()(0))
+                           : axis_tensor.flat<int64>()(0);
+    if (axis != 0) return Status::OK();
+
+    VLOG(1) << "Eliding concat " << concat->name()
+            << " below ScopedAllocatorSplit " << sas_name;
+    // Materialize the concat result shape as a Const for the Reshape.
+    string shape_name = strings::StrCat(sas_name, "_elided_concat_shape");
+    Tensor shape_tensor(DT_INT64, TensorShape({rank}));
+    shape_tensor.flat<int64>()(0) = dim0_sum;
+    for (int d = 1; d < rank; ++d) {
+      shape_tensor.flat<int64>()(d) = input_shapes[0].dim_size(d);
+    }
+    NodeDefBuilder shape_builder(shape_name, "Const");
+    shape_builder.Device(device_name);
+    shape_builder.Attr("dtype", DT_INT64);
+    shape_builder.Attr("value", shape_tensor);
+    NodeDef* shape_node = graph->add_node();
+    LOG_WARNING_AND_RETURN_IF_ERROR(shape_builder.Finalize(shape_node));
+    node_map->AddNode(shape_name, shape_node);
+
+    // Mutate the concat in place so its consumers (possibly fetch
+    // nodes) keep their input names.
+    node_map->RemoveInputs(concat->name());
+    concat->clear_input();
+    concat->clear_attr();
+    concat->set_op("Reshape");
+    (*concat->mutable_attr())["T"].set_type(dtype);
+    (*concat->mutable_attr())["Tshape"].set_type(DT_INT64);
+    concat->add_input(strings::StrCat(sa_op_name, ":0"));
+    concat->add_input(shape_name);
+    for (const string& ctl_input : ctl_inputs) {
+      concat->add_input(ctl_input);
+    }
+    node_map->AddOutput(sa_op_name, concat->name());
+    node_map->AddOutput(shape_name, concat->name());
+
+    // The split no longer has any consumer; drop it.
+    NodeDef* sas_node = node_map->GetNode(sas_name);
+    node_map->RemoveInputs(sas_name);
+    sas_node->clear_input();
+    node_map->RemoveOutputs(sas_name);
+    RemoveNode(sas_node, graph, node_map);
+    return Status::OK();
+  }
+
   // Given a collection of instances of op_name, presumed to be
   // logically parallel and operating on tensors of the same type,
   // replace them by a single instance.  First find the upstream Ops
@@ -740,6 +872,15 @@ class UnaryElementwiseRewriter : public ScopedAllocatorOptimizer::Rewriter {
     TF_RETURN_IF_ERROR(RewireSubgraph(graph, node_map, ops, op_instance_names,
                                       op_name, sas_name));
 
+    // Inference subgraphs often concatenate the sibling outputs right
+    // away; in that case the split/concat pair is redundant.
+    if (ElideDownstreamConcatEnabled()) {
+      TF_RETURN_IF_ERROR(MaybeElideDownstreamConcat(graph, node_map,
+                                                    input_shapes, device_name,
+                                                    dtype, sas_name,
+                                                    sa_op_name));
+    }
+
     *applied = true;
     return Status::OK();
   }
@@ -104,6 +104,47 @@ class ScopedAllocatorOptimizerTest : public ::testing::Test {
     TF_CHECK_OK(s.ToGraphDef(graph_def));
   }
 
+  // Constructs the following graph.
+  //
+  // The two Abs outputs feed a single axis-0 concat, so with concat
+  // elision enabled the optimizer should turn `cat` into a Reshape of
+  // the coalesced Abs output and drop the ScopedAllocatorSplit.  The
+  // {4, 4} float shapes make each backing field exactly one
+  // allocator-alignment unit, so no padding blocks the rewrite.
+  /*
+        a    b    c
+         \  / \  /
+          s1   s2
+          |    |
+          a1   a2
+           \   /
+            cat
+  */
+  void BuildAbsConcatGraph(GraphDef* graph_def) {
+    Scope s = Scope::NewRootScope();
+    s = s.WithDevice("/job:localhost/replica:0/task:0/device:CPU:0");
+
+    Output a = ops::Const<float>(s.WithOpName("a"), 1.0, {4, 4});
+    Output b = ops::Const<float>(s.WithOpName("b"), -2.0, {4, 4});
+    Output c = ops::Const<float>(s.WithOpName("c"), 3.0, {4, 4});
+    Output s1 = ops::Add(s.WithOpName("s1"), a, b);
+    Output s2 = ops::Add(s.WithOpName("s2"), b, c);
+    Output a1 = ops::Abs(s.WithOpName("a1"), s1);
+    Output a2 = ops::Abs(s.WithOpName("a2"), s2);
+    Output axis = ops::Const<int32>(s.WithOpName("axis"), 0, {});
+    Output cat = ops::Concat(s.WithOpName("cat"), {a1, a2}, axis);
+    TF_CHECK_OK(s.ToGraphDef(graph_def));
+
+    TensorShapeProto shape_proto;
+    shape_proto.add_dim()->set_size(4);
+    shape_proto.add_dim()->set_size(4);
+    for (NodeDef& n : *graph_def->mutable_node()) {
+      if (n.op() == "Add" || n.op() == "Abs") {
+        AddNodeAttr("_output_shapes", {shape_proto}, &n);
+      }
+    }
+  }
+
   // Constructs the following graph.
   //
   // We have 2 different name scopes in this graph.  s3, a3, a4, r3, and r4 are
@@ -261,6 +302,33 @@ TEST_F(ScopedAllocatorOptimizerTest, UnaryRewriteOnly) {
   }
 }
 
+TEST_F(ScopedAllocatorOptimizerTest, UnaryElideDownstreamConcat) {
+  // An axis-0 concat that consumes all of the coalesced outputs in
+  // field order should be rewritten into a Reshape of the flat
+  // backing tensor, and the ScopedAllocatorSplit should disappear.
+  setenv("TF_SCOPED_ALLOCATOR_ELIDE_CONCAT", "1", 1);
+  GrapplerItem item;
+  BuildAbsConcatGraph(&item.graph);
+
+  ScopedAllocatorOptions opts;
+  opts.add_enable_op("Abs");
+  ScopedAllocatorOptimizer sao(RewriterConfig::ON, opts);
+
+  GraphDef optimized_graph;
+  Status s = sao.Optimize(nullptr /*cluster*/, item, &optimized_graph);
+  unsetenv("TF_SCOPED_ALLOCATOR_ELIDE_CONCAT");
+  TF_ASSERT_OK(s);
+
+  NodeMap node_map(&optimized_graph);
+  EXPECT_EQ(nullptr, node_map.GetNode("scoped_allocator_split_1_1"));
+  NodeDef* cat = node_map.GetNode("cat");
+  ASSERT_TRUE(cat);
+  EXPECT_EQ("Reshape", cat->op());
+  ASSERT_EQ(2, cat->input_size());
+  EXPECT_EQ("scoped_allocator_1_1_Abs:0", cat->input(0));
+  EXPECT_EQ("scoped_allocator_split_1_1_elided_concat_shape", cat->input(1));
+}
+
 TEST_F(ScopedAllocatorOptimizerTest, UnaryExecute) {
   // Builds the same graph as UnaryRewriteOnly but also executes it and
   // validates the output.
@@ -0,0 +1,351 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/smart_stage_rewrite.h"
+
+#include <set>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/optimizers/custom_graph_optimizer_registry.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+// Ops that belong to the sparse lookup frontier and may execute on the
+// prefetching threads. Deliberately narrow: id preprocessing, the gathers
+// themselves and cheap shape plumbing. Dense compute must stay on the
+// training step even when its inputs happen to be staged, otherwise the
+// rewrite would drag the whole forward pass behind the buffer.
+bool IsFrontierOp(const NodeDef& node) {
+  static const auto* const kFrontierOps = new absl::flat_hash_set<string>({
+      "Identity", "Cast", "Reshape", "ExpandDims", "Squeeze", "StridedSlice",
+      "Slice", "Shape", "Size", "ZerosLike", "Fill", "Tile", "Select",
+      "ConcatV2", "Pack", "Unpack", "Unique", "UniqueV2", "Bucketize",
+      "StringToHashBucket", "StringToHashBucketFast", "StringToNumber",
+      "AsString", "SparseFillEmptyRows", "SparseReshape", "SparseSegmentSum",
+      "SparseSegmentMean", "SparseSegmentSqrtN", "DynamicPartition",
+      "DynamicStitch", "ParallelDynamicStitch", "Gather", "GatherV2",
+      "GatherNd", "ResourceGather", "KvResourceGather", "LookupTableFind",
+      "LookupTableFindV2",
+  });
+  return kFrontierOps->contains(node.op());
+}
+
+// Producers a frontier op may keep consuming from its new position in front
+// of the put: constants and resource handles, which yield the same value on
+// either side of the boundary.
+bool IsFreeProducer(const NodeDef& node) {
+  static const auto* const kFreeOps = new absl::flat_hash_set<string>({
+      "Const", "HostConst", "VarHandleOp", "KvVarHandleOp", "HashTableV2",
+      "MutableHashTableV2", "MutableHashTableOfTensorsV2",
+      "MutableDenseHashTableV2",
+  });
+  return kFreeOps->contains(node.op());
+}
+
+// One data input edge: `consumer.input(input_index)` reads output `port` of
+// some producer.
+struct InputRef {
+  NodeDef* consumer;
+  int input_index;
+  int port;
+};
+
+// Maps each producer name to its data-input readers, and records which nodes
+// appear as control dependencies anywhere. Nodes in `ignore` (already moved,
+// about to be erased) are not walked.
+void BuildFanouts(GraphDef* graph, const absl::flat_hash_set<string>& ignore,
+                  absl::flat_hash_map<string, std::vector<InputRef>>* fanouts,
+                  absl::flat_hash_set<string>* control_consumed) {
+  for (NodeDef& node : *graph->mutable_node()) {
+    if (ignore.contains(node.name())) continue;
+    for (int i = 0; i < node.input_size(); ++i) {
+      const string& input = node.input(i);
+      if (IsControlInput(input)) {
+        control_consumed->insert(NodeName(input));
+        continue;
+      }
+      int port;
+      const string producer = ParseNodeName(input, &port);
+      (*fanouts)[producer].push_back({&node, i, port});
+    }
+  }
+}
+
+string TensorIdStr(const string& node_name, int port) {
+  return port == 0 ? node_name : strings::StrCat(node_name, ":", port);
+}
+
+int NumStagedSlots(const NodeDef& node) {
+  const auto it = node.attr().find("dtypes");
+  if (it == node.attr().end()) return -1;
+  return it->second.list().type_size();
+}
+
+// Appends one record element to the staged buffer: the put gains `tensor` as
+// an extra data input (kept in front of any control inputs) and both sides
+// grow their dtypes list.
+void AppendStagedSlot(const string& tensor, DataType dtype, NodeDef* put,
+                      NodeDef* take) {
+  const int num_slots = NumStagedSlots(*put);
+  put->add_input(tensor);
+  for (int i = put->input_size() - 1; i > num_slots; --i) {
+    put->mutable_input()->SwapElements(i, i - 1);
+  }
+  (*put->mutable_attr())["dtypes"].mutable_list()->add_type(dtype);
+  (*take->mutable_attr())["dtypes"].mutable_list()->add_type(dtype);
+}
+
+// Moves `x` in front of the put: a copy of `x` reading the put's inputs is
+// added on the producer side, every consumed output of `x` becomes a staged
+// slot, and `x`'s readers are rerouted to the corresponding take outputs.
+// `x` itself becomes dead and is erased by the caller.
+Status MoveAcrossBoundary(NodeDef* x, NodeDef* put, NodeDef* take,
+                          const std::vector<InputRef>& x_fanout,
+                          GraphDef* graph, NodeMap* node_map) {
+  const OpDef* op_def = nullptr;
+  TF_RETURN_IF_ERROR(OpRegistry::Global()->LookUpOpDef(x->op(), &op_def));
+  DataTypeVector out_types;
+  TF_RETURN_IF_ERROR(OutputTypesForNode(*x, *op_def, &out_types));
+
+  NodeDef* staged = graph->add_node();
+  *staged = *x;
+  staged->set_name(strings::StrCat(x->name(), "/smart_stage"));
+  for (int i = 0; i < staged->input_size(); ++i) {
+    int port;
+    const string producer = ParseNodeName(staged->input(i), &port);
+    if (producer == take->name()) {
+      staged->set_input(i, put->input(port));
+    }
+  }
+  node_map->AddNode(staged->name(), staged);
+
+  std::vector<int> slot_of_port(out_types.size(), -1);
+  for (const InputRef& ref : x_fanout) {
+    if (ref.port < 0 || ref.port >= static_cast<int>(out_types.size())) {
+      return errors::InvalidArgument("Bad output port ", ref.port, " of ",
+                                     x->name(), " consumed by ",
+                                     ref.consumer->name());
+    }
+    if (slot_of_port[ref.port] < 0) {
+      AppendStagedSlot(TensorIdStr(staged->name(), ref.port),
+                       out_types[ref.port], put, take);
+      slot_of_port[ref.port] = NumStagedSlots(*take) - 1;
+    }
+    ref.consumer->set_input(
+        ref.input_index, TensorIdStr(take->name(), slot_of_port[ref.port]));
+  }
+  return Status::OK();
+}
+
+// Drops staged slots that no longer have readers on the take side, e.g. raw
+// ids once the gather consuming them has been moved in front of the put.
+// Rewrites the put's data inputs, both dtypes lists, and the remaining take
+// readers' port numbers.
+void PruneUnusedSlots(NodeDef* put, NodeDef* take,
+                      const absl::flat_hash_set<string>& moved,
+                      GraphDef* graph) {
+  const int num_slots = NumStagedSlots(*take);
+  if (num_slots <= 0 || NumStagedSlots(*put) != num_slots ||
+      put->input_size() < num_slots) {
+    return;
+  }
+  std::vector<bool> used(num_slots, false);
+  std::vector<InputRef> readers;
+  for (NodeDef& node : *graph->mutable_node()) {
+    if (moved.contains(node.name())) continue;
+    for (int i = 0; i < node.input_size(); ++i) {
+      const string& input = node.input(i);
+      if (IsControlInput(input)) continue;
+      int port;
+      if (ParseNodeName(input, &port) != take->name()) continue;
+      if (port < 0 || port >= num_slots) return;
+      used[port] = true;
+      readers.push_back({&node, i, port});
+    }
+  }
+  std::vector<int> remap(num_slots, -1);
+  int num_kept = 0;
+  for (int p = 0; p < num_slots; ++p) {
+    if (used[p]) remap[p] = num_kept++;
+  }
+  // Nothing to prune, or a buffer nobody reads (leave that one alone).
+  if (num_kept == num_slots || num_kept == 0) return;
+
+  std::vector<string> new_inputs;
+  std::vector<DataType> new_types;
+  const auto& old_types = take->attr().at("dtypes").list();
+  for (int p = 0; p < num_slots; ++p) {
+    if (!used[p]) continue;
+    new_inputs.push_back(put->input(p));
+    new_types.push_back(old_types.type(p));
+  }
+  for (int i = num_slots; i < put->input_size(); ++i) {
+    new_inputs.push_back(put->input(i));  // Control inputs keep their place.
+  }
+  put->clear_input();
+  for (const string& input : new_inputs) put->add_input(input);
+  auto* put_types = (*put->mutable_attr())["dtypes"].mutable_list();
+  auto* take_types = (*take->mutable_attr())["dtypes"].mutable_list();
+  put_types->clear_type();
+  take_types->clear_type();
+  for (DataType dtype : new_types) {
+    put_types->add_type(dtype);
+    take_types->add_type(dtype);
+  }
+  for (const InputRef& ref : readers) {
+    ref.consumer->set_input(ref.input_index,
+                            TensorIdStr(take->name(), remap[ref.port]));
+  }
+}
+
+// Repeatedly moves eligible take readers in front of the put until the
+// frontier stops growing, then compacts the staged record.
+Status WidenBoundary(NodeDef* put, NodeDef* take,
+                     const absl::flat_hash_set<string>& pinned,
+                     GraphDef* graph, NodeMap* node_map,
+                     absl::flat_hash_set<string>* moved) {
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    absl::flat_hash_map<string, std::vector<InputRef>> fanouts;
+    absl::flat_hash_set<string> control_consumed;
+    BuildFanouts(graph, *moved, &fanouts, &control_consumed);
+
+    std::vector<NodeDef*> candidates;
+    absl::flat_hash_set<string> seen;
+    for (const InputRef& ref : fanouts[take->name()]) {
+      if (seen.insert(ref.consumer->name()).second) {
+        candidates.push_back(ref.consumer);
+      }
+    }
+    for (NodeDef* x : candidates) {
+      if (!IsFrontierOp(*x)) continue;
+      if (pinned.contains(x->name())) continue;
+      // Control edges pin a node to its side of the boundary: they encode an
+      // ordering against the training step we must not break.
+      if (control_consumed.contains(x->name())) continue;
+      bool eligible = true;
+      for (const string& input : x->input()) {
+        if (IsControlInput(input)) {
+          eligible = false;
+          break;
+        }
+        int port;
+        const string producer = ParseNodeName(input, &port);
+        if (producer == take->name()) {
+          if (port < 0 || port >= NumStagedSlots(*put) ||
+              port >= put->input_size()) {
+            eligible = false;
+            break;
+          }
+          continue;
+        }
+        NodeDef* producer_node = node_map->GetNode(producer);
+        if (producer_node == nullptr || !IsFreeProducer(*producer_node)) {
+          eligible = false;
+          break;
+        }
+      }
+      if (!eligible) continue;
+      const auto it = fanouts.find(x->name());
+      if (it == fanouts.end() || it->second.empty()) continue;
+      TF_RETURN_IF_ERROR(
+          MoveAcrossBoundary(x, put, take, it->second, graph, node_map));
+      moved->insert(x->name());
+      changed = true;
+      VLOG(1) << "smart_stage_rewrite: moved " << x->name() << " (" << x->op()
+              << ") in front of " << put->name();
+    }
+  }
+  PruneUnusedSlots(put, take, *moved, graph);
+  return Status::OK();
+}
+
+// Identity of a staged buffer, same convention as the resource container.
+string BufferKey(const NodeDef& node) {
+  string container, shared_name;
+  auto it = node.attr().find("container");
+  if (it != node.attr().end()) container = it->second.s();
+  it = node.attr().find("shared_name");
+  if (it != node.attr().end()) shared_name = it->second.s();
+  return strings::StrCat(container, "/", shared_name);
+}
+
+}  // namespace
+
+Status SmartStageRewrite::Optimize(Cluster* cluster, const GrapplerItem& item,
+                                   GraphDef* optimized_graph) {
+  *optimized_graph = item.graph;
+  NodeMap node_map(optimized_graph);
+
+  absl::flat_hash_set<string> pinned;
+  for (const string& fetch : item.fetch) {
+    pinned.insert(NodeName(fetch));
+  }
+  for (const auto& feed : item.feed) {
+    pinned.insert(NodeName(feed.first));
+  }
+
+  absl::flat_hash_map<string, std::vector<NodeDef*>> puts;
+  absl::flat_hash_map<string, std::vector<NodeDef*>> takes;
+  for (NodeDef& node : *optimized_graph->mutable_node()) {
+    if (node.op() == "TensorBufferPut") {
+      puts[BufferKey(node)].push_back(&node);
+    } else if (node.op() == "TensorBufferTake") {
+      takes[BufferKey(node)].push_back(&node);
+    }
+  }
+
+  absl::flat_hash_set<string> moved;
+  for (const auto& entry : puts) {
+    const auto it = takes.find(entry.first);
+    if (entry.second.size() != 1 || it == takes.end() ||
+        it->second.size() != 1) {
+      // Several producers or clients on one buffer: the 1:1 rewiring below
+      // does not apply.
+      VLOG(1) << "smart_stage_rewrite: skipping shared buffer " << entry.first;
+      continue;
+    }
+    NodeDef* put = entry.second[0];
+    NodeDef* take = it->second[0];
+    const int num_slots = NumStagedSlots(*put);
+    if (num_slots <= 0 || NumStagedSlots(*take) != num_slots ||
+        put->input_size() < num_slots) {
+      continue;
+    }
+    TF_RETURN_IF_ERROR(
+        WidenBoundary(put, take, pinned, optimized_graph, &node_map, &moved));
+  }
+  if (!moved.empty()) {
+    EraseNodesFromGraph(std::set<string>(moved.begin(), moved.end()),
+                        optimized_graph);
+  }
+  return Status::OK();
+}
+
+REGISTER_GRAPH_OPTIMIZER_AS(SmartStageRewrite, "smart_stage_rewrite");
+
+}  // namespace grappler
+}  // namespace tensorflow
@@ -0,0 +1,67 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_SMART_STAGE_REWRITE_H_
+#define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_SMART_STAGE_REWRITE_H_
+
+#include "tensorflow/core/grappler/optimizers/custom_graph_optimizer.h"
+#include "tensorflow/core/protobuf/rewriter_config.pb.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// Widens an existing tf.staged prefetching boundary (TensorBufferPut /
+// TensorBufferTake pair) so that the sparse lookup frontier executes on the
+// prefetching threads instead of the training step.
+//
+// For each staged buffer, consumers of the take side that belong to the
+// lookup frontier - sparse id preprocessing and the embedding gathers
+// themselves, i.e. ops whose only other inputs are constants or resource
+// handles - are moved in front of the put, and their results are staged in
+// place of their inputs. With capacity >= 2 this overlaps step N+1's lookups
+// with step N's dense compute; gathers running on the prefetching threads
+// read the embedding version current at staging time, one step behind the
+// dense pass, which is the usual staleness trade of pipelined training.
+//
+// Only graphs that already stage their input (via tf.staged) are touched:
+// the put op is re-run by the PrefetchRunner threads, so a boundary cannot
+// be created where no runner exists. Registered as the custom graph
+// optimizer "smart_stage_rewrite"; enable it through
+// RewriterConfig.custom_optimizers.
+class SmartStageRewrite : public CustomGraphOptimizer {
+ public:
+  SmartStageRewrite() = default;
+  ~SmartStageRewrite() override = default;
+
+  string name() const override { return "smart_stage_rewrite"; }
+
+  bool UsesFunctionLibrary() const override { return false; }
+
+  Status Init(const tensorflow::RewriterConfig_CustomGraphOptimizer* config =
+                  nullptr) override {
+    return Status::OK();
+  }
+
+  Status Optimize(Cluster* cluster, const GrapplerItem& item,
+                  GraphDef* optimized_graph) override;
+
+  void Feedback(Cluster* cluster, const GrapplerItem& item,
+                const GraphDef& optimized_graph, double result) override {}
+};
+
+}  // namespace grappler
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_SMART_STAGE_REWRITE_H_
@@ -0,0 +1,175 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/smart_stage_rewrite.h"
+
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/grappler/utils/grappler_test.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+class SmartStageRewriteTest : public GrapplerTest {
+ protected:
+  // A staged input pipeline as tf.staged builds it: the ids cross a
+  // TensorBufferPut / TensorBufferTake pair and a GatherV2 against constant
+  // params consumes them on the training side.
+  //
+  //   ids -> put ~~~ take -> gather(params, take, axis) -> output
+  GrapplerItem BuildStagedGatherItem() {
+    tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+
+    Tensor params_tensor(DT_FLOAT, TensorShape({8, 4}));
+    test::FillIota<float>(&params_tensor, 1.0f);
+    Output params = ops::Const(s.WithOpName("params"), params_tensor);
+    Output ids = ops::Const<int64>(s.WithOpName("ids"), {3ll, 1ll, 5ll}, {3});
+    Output axis = ops::Const(s.WithOpName("axis"), 0);
+
+    GrapplerItem item;
+    item.fetch = {"output"};
+    TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+    NodeDef* put = item.graph.add_node();
+    put->set_name("put");
+    put->set_op("TensorBufferPut");
+    put->add_input("ids");
+    (*put->mutable_attr())["dtypes"].mutable_list()->add_type(DT_INT64);
+    (*put->mutable_attr())["shared_name"].set_s("stage");
+
+    NodeDef* take = item.graph.add_node();
+    take->set_name("take");
+    take->set_op("TensorBufferTake");
+    (*take->mutable_attr())["dtypes"].mutable_list()->add_type(DT_INT64);
+    (*take->mutable_attr())["shared_name"].set_s("stage");
+
+    NodeDef* gather = item.graph.add_node();
+    gather->set_name("gather");
+    gather->set_op("GatherV2");
+    gather->add_input("params");
+    gather->add_input("take");
+    gather->add_input("axis");
+    (*gather->mutable_attr())["Tparams"].set_type(DT_FLOAT);
+    (*gather->mutable_attr())["Tindices"].set_type(DT_INT64);
+    (*gather->mutable_attr())["Taxis"].set_type(DT_INT32);
+
+    NodeDef* output = item.graph.add_node();
+    output->set_name("output");
+    output->set_op("Identity");
+    output->add_input("gather");
+    (*output->mutable_attr())["T"].set_type(DT_FLOAT);
+    return item;
+  }
+
+  const NodeDef* FindNode(const GraphDef& graph, const string& name) {
+    for (const NodeDef& node : graph.node()) {
+      if (node.name() == name) return &node;
+    }
+    return nullptr;
+  }
+};
+
+TEST_F(SmartStageRewriteTest, MovesGatherInFrontOfPut) {
+  GrapplerItem item = BuildStagedGatherItem();
+
+  SmartStageRewrite optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  // The gather now runs on the producer side, reading the raw ids.
+  const NodeDef* staged_gather = FindNode(output, "gather/smart_stage");
+  ASSERT_NE(staged_gather, nullptr);
+  EXPECT_EQ("GatherV2", staged_gather->op());
+  EXPECT_EQ("ids", staged_gather->input(1));
+  EXPECT_EQ(nullptr, FindNode(output, "gather"));
+
+  // The buffer stages the gathered values instead of the ids.
+  const NodeDef* put = FindNode(output, "put");
+  const NodeDef* take = FindNode(output, "take");
+  ASSERT_NE(put, nullptr);
+  ASSERT_NE(take, nullptr);
+  ASSERT_EQ(1, put->input_size());
+  EXPECT_EQ("gather/smart_stage", put->input(0));
+  ASSERT_EQ(1, take->attr().at("dtypes").list().type_size());
+  EXPECT_EQ(DT_FLOAT, take->attr().at("dtypes").list().type(0));
+  EXPECT_EQ("take", FindNode(output, "output")->input(0));
+}
+
+TEST_F(SmartStageRewriteTest, KeepsSlotWithRemainingReader) {
+  GrapplerItem item = BuildStagedGatherItem();
+  // A training-side consumer of the raw ids (e.g. the gradient scatter)
+  // keeps the ids slot alive next to the new values slot.
+  NodeDef* ids_out = item.graph.add_node();
+  ids_out->set_name("ids_out");
+  ids_out->set_op("Identity");
+  ids_out->add_input("take");
+  (*ids_out->mutable_attr())["T"].set_type(DT_INT64);
+  item.fetch.push_back("ids_out");
+
+  SmartStageRewrite optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  ASSERT_NE(FindNode(output, "gather/smart_stage"), nullptr);
+  const NodeDef* take = FindNode(output, "take");
+  ASSERT_NE(take, nullptr);
+  ASSERT_EQ(2, take->attr().at("dtypes").list().type_size());
+  EXPECT_EQ(DT_INT64, take->attr().at("dtypes").list().type(0));
+  EXPECT_EQ(DT_FLOAT, take->attr().at("dtypes").list().type(1));
+  EXPECT_EQ("take:1", FindNode(output, "output")->input(0));
+  EXPECT_EQ("take", FindNode(output, "ids_out")->input(0));
+}
+
+TEST_F(SmartStageRewriteTest, LeavesDenseComputeBehindTheBuffer) {
+  GrapplerItem item = BuildStagedGatherItem();
+  // Replace the Identity consumer with a MatMul: dense compute is not part
+  // of the lookup frontier and must stay on the training step.
+  for (NodeDef& node : *item.graph.mutable_node()) {
+    if (node.name() == "output") {
+      node.set_op("MatMul");
+      node.add_input("params");
+      node.clear_attr();
+      (*node.mutable_attr())["T"].set_type(DT_FLOAT);
+      (*node.mutable_attr())["transpose_a"].set_b(false);
+      (*node.mutable_attr())["transpose_b"].set_b(true);
+    }
+  }
+  // Fetch through an extra Identity so the MatMul itself is not pinned.
+  NodeDef* final_node = item.graph.add_node();
+  final_node->set_name("final");
+  final_node->set_op("Identity");
+  final_node->add_input("output");
+  (*final_node->mutable_attr())["T"].set_type(DT_FLOAT);
+  item.fetch = {"final"};
+
+  SmartStageRewrite optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  ASSERT_NE(FindNode(output, "gather/smart_stage"), nullptr);
+  EXPECT_EQ(nullptr, FindNode(output, "output/smart_stage"));
+  const NodeDef* matmul = FindNode(output, "output");
+  ASSERT_NE(matmul, nullptr);
+  EXPECT_EQ("take", matmul->input(0));
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
@@ -0,0 +1,211 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/sparse_grad_dedup.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/op_def.pb.h"
+#include "tensorflow/core/grappler/costs/graph_properties.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/optimizers/custom_graph_optimizer_registry.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/util/device_name_utils.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+// Positions of the "grad" and "indices" input args of a sparse apply
+// op, resolved from the op registry so every Sparse/ResourceSparse/Kv
+// variant is covered without an op table. Returns false when the op
+// does not carry both args as single tensors.
+bool LookupGradAndIndices(const NodeDef& node, int* grad_index,
+                          int* indices_index) {
+  const OpDef* op_def = nullptr;
+  if (!OpRegistry::Global()->LookUpOpDef(node.op(), &op_def).ok()) {
+    return false;
+  }
+  *grad_index = -1;
+  *indices_index = -1;
+  for (int i = 0; i < op_def->input_arg_size(); ++i) {
+    const OpDef::ArgDef& arg = op_def->input_arg(i);
+    if (!arg.number_attr().empty() || !arg.type_list_attr().empty()) {
+      return false;
+    }
+    if (arg.name() == "grad") *grad_index = i;
+    if (arg.name() == "indices") *indices_index = i;
+  }
+  return *grad_index >= 0 && *indices_index >= 0;
+}
+
+// True when the edge from `producer` to `consumer` crosses a device or
+// task boundary. Unplaced nodes (empty device) never cross: before
+// placement there is no wire to save bytes on, and the pass runs again
+// on the placed graph.
+bool CrossesBoundary(const NodeDef& producer, const NodeDef& consumer) {
+  if (producer.device().empty() || consumer.device().empty()) {
+    return false;
+  }
+  DeviceNameUtils::ParsedName src;
+  DeviceNameUtils::ParsedName dst;
+  if (!DeviceNameUtils::ParseFullName(producer.device(), &src) ||
+      !DeviceNameUtils::ParseFullName(consumer.device(), &dst)) {
+    return false;
+  }
+  return src.job != dst.job || src.replica != dst.replica ||
+         src.task != dst.task || src.type != dst.type || src.id != dst.id;
+}
+
+DataType GetTypeAttr(const NodeDef& node, const string& attr_name,
+                     DataType fallback) {
+  const auto it = node.attr().find(attr_name);
+  if (it == node.attr().end()) return fallback;
+  return it->second.type();
+}
+
+}  // namespace
+
+Status SparseGradDedup::Optimize(Cluster* cluster, const GrapplerItem& item,
+                                 GraphDef* optimized_graph) {
+  *optimized_graph = item.graph;
+
+  absl::flat_hash_map<string, NodeDef*> nodes_by_name;
+  for (NodeDef& node : *optimized_graph->mutable_node()) {
+    nodes_by_name[node.name()] = &node;
+  }
+
+  // A rewrite candidate: the apply node plus the resolved positions of
+  // its grad and indices inputs.
+  struct Candidate {
+    NodeDef* apply;
+    int grad_index;
+    int indices_index;
+    NodeDef* grad_producer;
+  };
+  std::vector<Candidate> candidates;
+
+  for (NodeDef& node : *optimized_graph->mutable_node()) {
+    if (node.op().find("SparseApply") == string::npos) continue;
+    int grad_index, indices_index;
+    if (!LookupGradAndIndices(node, &grad_index, &indices_index)) continue;
+    if (node.input_size() <= std::max(grad_index, indices_index)) continue;
+    if (IsControlInput(node.input(grad_index)) ||
+        IsControlInput(node.input(indices_index))) {
+      continue;
+    }
+    const auto grad_it = nodes_by_name.find(NodeName(node.input(grad_index)));
+    const auto idx_it =
+        nodes_by_name.find(NodeName(node.input(indices_index)));
+    if (grad_it == nodes_by_name.end() || idx_it == nodes_by_name.end()) {
+      continue;
+    }
+    if (!CrossesBoundary(*grad_it->second, node)) continue;
+    // Already deduplicated, by hand or by an earlier run of this pass.
+    if (grad_it->second->op() == "UnsortedSegmentSum" &&
+        idx_it->second->op() == "Unique") {
+      continue;
+    }
+    candidates.push_back({&node, grad_index, indices_index, grad_it->second});
+  }
+  if (candidates.empty()) {
+    return Status::OK();
+  }
+
+  // Shape inference only runs when there is something to rewrite; it is
+  // the expensive part of this pass.
+  GraphProperties properties(item);
+  TF_RETURN_IF_ERROR(properties.InferStatically(false));
+
+  for (const Candidate& c : candidates) {
+    NodeDef* apply = c.apply;
+    const string grad_input = apply->input(c.grad_index);
+    const string indices_input = apply->input(c.indices_index);
+
+    // Skip tiny tensors: below the threshold the three inserted ops
+    // cost more than the duplicate bytes they remove. Unknown shapes
+    // are rewritten; a dynamic sparse gradient is exactly the skewed
+    // hot-id case this pass exists for.
+    int port;
+    const string grad_node_name = ParseNodeName(grad_input, &port);
+    const auto& output_props = properties.GetOutputProperties(grad_node_name);
+    if (port < static_cast<int>(output_props.size())) {
+      const TensorShapeProto& shape = output_props[port].shape();
+      if (!shape.unknown_rank()) {
+        int64 elements = 1;
+        bool known = true;
+        for (const auto& dim : shape.dim()) {
+          if (dim.size() < 0) {
+            known = false;
+            break;
+          }
+          elements *= dim.size();
+        }
+        if (known && elements < min_grad_elements_) continue;
+      }
+    }
+
+    const DataType grad_type = GetTypeAttr(*apply, "T", DT_FLOAT);
+    const DataType indices_type = GetTypeAttr(*apply, "Tindices", DT_INT64);
+    const string& device = c.grad_producer->device();
+    const string base = strings::StrCat(apply->name(), "/grad_dedup");
+
+    NodeDef* unique = optimized_graph->add_node();
+    unique->set_name(strings::StrCat(base, "/unique"));
+    unique->set_op("Unique");
+    unique->set_device(device);
+    unique->add_input(indices_input);
+    (*unique->mutable_attr())["T"].set_type(indices_type);
+    (*unique->mutable_attr())["out_idx"].set_type(DT_INT32);
+
+    NodeDef* num_segments = optimized_graph->add_node();
+    num_segments->set_name(strings::StrCat(base, "/num_segments"));
+    num_segments->set_op("Size");
+    num_segments->set_device(device);
+    num_segments->add_input(unique->name());
+    (*num_segments->mutable_attr())["T"].set_type(indices_type);
+    (*num_segments->mutable_attr())["out_type"].set_type(DT_INT32);
+
+    NodeDef* segment_sum = optimized_graph->add_node();
+    segment_sum->set_name(strings::StrCat(base, "/segment_sum"));
+    segment_sum->set_op("UnsortedSegmentSum");
+    segment_sum->set_device(device);
+    segment_sum->add_input(grad_input);
+    segment_sum->add_input(strings::StrCat(unique->name(), ":1"));
+    segment_sum->add_input(num_segments->name());
+    (*segment_sum->mutable_attr())["T"].set_type(grad_type);
+    (*segment_sum->mutable_attr())["Tindices"].set_type(DT_INT32);
+    (*segment_sum->mutable_attr())["Tnumsegments"].set_type(DT_INT32);
+
+    apply->set_input(c.grad_index, segment_sum->name());
+    apply->set_input(c.indices_index, unique->name());
+
+    VLOG(1) << "sparse_grad_dedup: combined gradient " << grad_input
+            << " -> " << apply->name() << " on " << device;
+  }
+
+  return Status::OK();
+}
+
+REGISTER_GRAPH_OPTIMIZER_AS(SparseGradDedup, "sparse_grad_dedup");
+
+}  // namespace grappler
+}  // namespace tensorflow
@@ -0,0 +1,81 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_SPARSE_GRAD_DEDUP_H_
+#define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_SPARSE_GRAD_DEDUP_H_
+
+#include "tensorflow/core/grappler/optimizers/custom_graph_optimizer.h"
+#include "tensorflow/core/protobuf/rewriter_config.pb.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// Deduplicates sparse gradients on the worker before they cross to the
+// parameter server.
+//
+// A skewed batch repeats hot ids many times, so the (indices, grad)
+// pair behind a sparse apply op carries one gradient row per
+// occurrence. When the apply op sits on a different task or device
+// than the gradient producer, every duplicate row is serialized over
+// the wire just to be summed on the other side. This pass finds sparse
+// apply ops whose grad/indices inputs cross a device or task boundary
+// and inserts Unique + UnsortedSegmentSum on the producer's device, so
+// only one combined row per distinct id is pushed.
+//
+// Duplicate-index handling of the apply ops is order-dependent only in
+// floating point rounding; pre-combining with a segment sum is the
+// documented IndexedSlices semantics and what the in-kernel grouping
+// of the Kv apply ops already does.
+//
+// Edges whose gradient has a statically known size below
+// min_grad_elements (config parameter, default 4096) are skipped: for
+// tiny tensors the three extra ops cost more than the bytes saved.
+// Registered as the custom graph optimizer "sparse_grad_dedup"; enable
+// it through RewriterConfig.custom_optimizers.
+class SparseGradDedup : public CustomGraphOptimizer {
+ public:
+  SparseGradDedup() = default;
+  ~SparseGradDedup() override = default;
+
+  string name() const override { return "sparse_grad_dedup"; }
+
+  bool UsesFunctionLibrary() const override { return false; }
+
+  Status Init(const tensorflow::RewriterConfig_CustomGraphOptimizer* config =
+                  nullptr) override {
+    if (config != nullptr) {
+      const auto& params = config->parameter_map();
+      const auto it = params.find("min_grad_elements");
+      if (it != params.end()) {
+        min_grad_elements_ = it->second.i();
+      }
+    }
+    return Status::OK();
+  }
+
+  Status Optimize(Cluster* cluster, const GrapplerItem& item,
+                  GraphDef* optimized_graph) override;
+
+  void Feedback(Cluster* cluster, const GrapplerItem& item,
+                const GraphDef& optimized_graph, double result) override {}
+
+ private:
+  int64 min_grad_elements_ = 4096;
+};
+
+}  // namespace grappler
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_SPARSE_GRAD_DEDUP_H_
@@ -0,0 +1,159 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/sparse_grad_dedup.h"
+
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/grappler/utils/grappler_test.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+constexpr char kWorker[] = "/job:worker/replica:0/task:0/device:CPU:0";
+constexpr char kPs[] = "/job:ps/replica:0/task:0/device:CPU:0";
+
+class SparseGradDedupTest : public GrapplerTest {
+ protected:
+  // A worker-side sparse gradient pushed to a PS-side apply op:
+  //
+  //   grad, indices (worker) -> SparseApplyAdagrad(var, accum, lr, ...) (ps)
+  //
+  // `rows` sets the gradient's leading dimension, so tests can land on
+  // either side of the size threshold.
+  GrapplerItem BuildCrossTaskApplyItem(int rows, const string& grad_device,
+                                       const string& apply_device) {
+    GrapplerItem item;
+    item.fetch = {"apply"};
+
+    NodeDef* var = item.graph.add_node();
+    var->set_name("var");
+    var->set_op("VariableV2");
+    var->set_device(apply_device);
+    (*var->mutable_attr())["dtype"].set_type(DT_FLOAT);
+    TensorShapeProto* var_shape =
+        (*var->mutable_attr())["shape"].mutable_shape();
+    var_shape->add_dim()->set_size(1024);
+    var_shape->add_dim()->set_size(16);
+
+    NodeDef* accum = item.graph.add_node();
+    *accum = *var;
+    accum->set_name("accum");
+
+    NodeDef* lr = item.graph.add_node();
+    lr->set_name("lr");
+    lr->set_op("Const");
+    lr->set_device(apply_device);
+    (*lr->mutable_attr())["dtype"].set_type(DT_FLOAT);
+    Tensor lr_tensor(0.1f);
+    lr_tensor.AsProtoTensorContent(
+        (*lr->mutable_attr())["value"].mutable_tensor());
+
+    NodeDef* grad = item.graph.add_node();
+    grad->set_name("grad");
+    grad->set_op("Const");
+    grad->set_device(grad_device);
+    (*grad->mutable_attr())["dtype"].set_type(DT_FLOAT);
+    Tensor grad_tensor(DT_FLOAT, TensorShape({rows, 16}));
+    grad_tensor.flat<float>().setZero();
+    grad_tensor.AsProtoTensorContent(
+        (*grad->mutable_attr())["value"].mutable_tensor());
+
+    NodeDef* indices = item.graph.add_node();
+    indices->set_name("indices");
+    indices->set_op("Const");
+    indices->set_device(grad_device);
+    (*indices->mutable_attr())["dtype"].set_type(DT_INT64);
+    Tensor indices_tensor(DT_INT64, TensorShape({rows}));
+    indices_tensor.flat<int64>().setZero();
+    indices_tensor.AsProtoTensorContent(
+        (*indices->mutable_attr())["value"].mutable_tensor());
+
+    NodeDef* apply = item.graph.add_node();
+    apply->set_name("apply");
+    apply->set_op("SparseApplyAdagrad");
+    apply->set_device(apply_device);
+    apply->add_input("var");
+    apply->add_input("accum");
+    apply->add_input("lr");
+    apply->add_input("grad");
+    apply->add_input("indices");
+    (*apply->mutable_attr())["T"].set_type(DT_FLOAT);
+    (*apply->mutable_attr())["Tindices"].set_type(DT_INT64);
+    (*apply->mutable_attr())["use_locking"].set_b(false);
+    return item;
+  }
+
+  const NodeDef* FindNode(const GraphDef& graph, const string& name) {
+    for (const NodeDef& node : graph.node()) {
+      if (node.name() == name) return &node;
+    }
+    return nullptr;
+  }
+};
+
+TEST_F(SparseGradDedupTest, DeduplicatesCrossTaskGradient) {
+  GrapplerItem item = BuildCrossTaskApplyItem(1024, kWorker, kPs);
+  SparseGradDedup optimizer;
+  TF_ASSERT_OK(optimizer.Init());
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  const NodeDef* unique = FindNode(output, "apply/grad_dedup/unique");
+  const NodeDef* segment_sum =
+      FindNode(output, "apply/grad_dedup/segment_sum");
+  ASSERT_NE(unique, nullptr);
+  ASSERT_NE(segment_sum, nullptr);
+  // The combine runs on the worker so only deduplicated rows cross.
+  EXPECT_EQ(unique->device(), kWorker);
+  EXPECT_EQ(segment_sum->device(), kWorker);
+  EXPECT_EQ(unique->input(0), "indices");
+  EXPECT_EQ(segment_sum->input(0), "grad");
+
+  const NodeDef* apply = FindNode(output, "apply");
+  ASSERT_NE(apply, nullptr);
+  EXPECT_EQ(apply->input(3), "apply/grad_dedup/segment_sum");
+  EXPECT_EQ(apply->input(4), "apply/grad_dedup/unique");
+}
+
+TEST_F(SparseGradDedupTest, LeavesSameDeviceEdgeAlone) {
+  GrapplerItem item = BuildCrossTaskApplyItem(1024, kPs, kPs);
+  SparseGradDedup optimizer;
+  TF_ASSERT_OK(optimizer.Init());
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  EXPECT_EQ(FindNode(output, "apply/grad_dedup/unique"), nullptr);
+  EXPECT_EQ(output.node_size(), item.graph.node_size());
+}
+
+TEST_F(SparseGradDedupTest, SkipsTinyGradientBelowThreshold) {
+  // 8 x 16 = 128 elements, under the default 4096 threshold.
+  GrapplerItem item = BuildCrossTaskApplyItem(8, kWorker, kPs);
+  SparseGradDedup optimizer;
+  TF_ASSERT_OK(optimizer.Init());
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  EXPECT_EQ(FindNode(output, "apply/grad_dedup/unique"), nullptr);
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
@@ -13,6 +13,9 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <algorithm>
+#include <atomic>
+
 #include "tensorflow/core/framework/function.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
@@ -27,8 +30,12 @@ limitations under the License.
 #include "tensorflow/core/kernels/split_lib.h"
 #include "tensorflow/core/lib/gtl/cleanup.h"
 #include "tensorflow/core/lib/random/random.h"
+#include "tensorflow/core/lib/strings/numbers.h"
+#include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/context.h"
 #include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 
@@ -208,6 +215,39 @@ Status Split(OpKernelContext* context, const Tensor& input,
   return SplitCPU<T>(context, input, sizes, outputs);
 }
 
+namespace {
+
+// Sequence-length bucket boundaries for batch assembly, from
+// TF_BATCH_LENGTH_BUCKETS (comma separated, e.g. "32,64,128"). When set,
+// each request is zero-padded along dim 1 up to its bucket boundary and
+// batched only with requests of the same bucket, so one long request no
+// longer inflates the padded compute of a whole mixed batch. Empty (the
+// default) keeps the length-oblivious behavior.
+const std::vector<int64>& BatchLengthBucketsFromEnv() {
+  static const std::vector<int64>* buckets = [] {
+    auto* result = new std::vector<int64>;
+    string spec;
+    TF_CHECK_OK(ReadStringFromEnvVar("TF_BATCH_LENGTH_BUCKETS", "", &spec));
+    for (const string& part : str_util::Split(spec, ',')) {
+      int64 boundary = 0;
+      if (strings::safe_strto64(part, &boundary) && boundary > 0) {
+        result->push_back(boundary);
+      } else if (!part.empty()) {
+        LOG(WARNING) << "Ignoring malformed TF_BATCH_LENGTH_BUCKETS entry: "
+                     << part;
+      }
+    }
+    std::sort(result->begin(), result->end());
+    return result;
+  }();
+  return *buckets;
+}
+
+// Batches assembled between padding-efficiency log lines.
+constexpr int64 kPaddingReportInterval = 256;
+
+}  // namespace
+
 // A class encapsulating the state and logic for batching tensors.
 class BatchResource : public ResourceBase {
  public:
@@ -274,10 +314,37 @@ class BatchResource : public ResourceBase {
     batch_components->context = context;
     batch_components->done_callback = std::move(done_callback);
 
-    BatcherQueue* batcher_queue;
+    // Length-aware bucketing: pad the request up to its bucket boundary
+    // and assemble it only with same-bucket requests. Tasks of different
+    // padded lengths could not share a Concat anyway, so every bucket
+    // gets its own queue (and thus its own timeout clock).
+    string batcher_queue = batcher_queue_name;
+    if (!BatchLengthBucketsFromEnv().empty() &&
+        !batch_components->inputs.empty() &&
+        batch_components->inputs[0].dims() >= 2) {
+      const int64 length = batch_components->inputs[0].dim_size(1);
+      int64 bucket = length;
+      for (const int64 boundary : BatchLengthBucketsFromEnv()) {
+        if (boundary >= length) {
+          bucket = boundary;
+          break;
+        }
+      }
+      if (bucket != length) {
+        TF_RETURN_IF_ERROR(PadToSequenceLength(context, length, bucket,
+                                               &batch_components->inputs));
+      }
+      const int64 rows = batch_components->inputs[0].dim_size(0);
+      sequence_elements_.fetch_add(rows * length, std::memory_order_relaxed);
+      sequence_pad_elements_.fetch_add(rows * (bucket - length),
+                                       std::memory_order_relaxed);
+      batcher_queue = strings::StrCat(batcher_queue_name, "/len", bucket);
+    }
+
+    BatcherQueue* batcher_queue_ptr;
     TF_RETURN_IF_ERROR(
-        LookupOrCreateBatcherQueue(batcher_queue_name, &batcher_queue));
-    return batcher_queue->Schedule(&batch_components);
+        LookupOrCreateBatcherQueue(batcher_queue, &batcher_queue_ptr));
+    return batcher_queue_ptr->Schedule(&batch_components);
   }
 
  private:
@@ -317,6 +384,41 @@ class BatchResource : public ResourceBase {
     return Status::OK();
   }
 
+  // Zero-pads dim 1 of every rank >= 2 input whose dim 1 equals the
+  // task's sequence length up to 'padded_length'. Other inputs (e.g.
+  // per-request side features with a different dim 1) pass through
+  // untouched.
+  static Status PadToSequenceLength(OpKernelContext* context, int64 length,
+                                    int64 padded_length,
+                                    std::vector<Tensor>* inputs) {
+    for (Tensor& tensor : *inputs) {
+      if (tensor.dims() < 2 || tensor.dim_size(1) != length) continue;
+      if (!DataTypeCanUseMemcpy(tensor.dtype())) {
+        return errors::InvalidArgument(
+            "Length bucketing requires flat-memory input types; got ",
+            DataTypeString(tensor.dtype()));
+      }
+      TensorShape padded_shape = tensor.shape();
+      padded_shape.set_dim(1, padded_length);
+      Tensor padded;
+      TF_RETURN_IF_ERROR(
+          context->allocate_temp(tensor.dtype(), padded_shape, &padded));
+      char* dst = const_cast<char*>(padded.tensor_data().data());
+      memset(dst, 0, padded.tensor_data().size());
+      const int64 rows = tensor.dim_size(0);
+      if (rows > 0) {
+        const char* src = tensor.tensor_data().data();
+        const int64 row_bytes = tensor.tensor_data().size() / rows;
+        const int64 padded_row_bytes = padded.tensor_data().size() / rows;
+        for (int64 r = 0; r < rows; ++r) {
+          memcpy(dst + r * padded_row_bytes, src + r * row_bytes, row_bytes);
+        }
+      }
+      tensor = padded;
+    }
+    return Status::OK();
+  }
+
   // Returns the smallest entry in 'allowed_batch_sizes_' that is greater than
   // or equal to 'batch_size'. If 'allowed_batch_sizes_' is empty, simply
   // returns 'batch_size'.
@@ -342,6 +444,7 @@ class BatchResource : public ResourceBase {
 
     const int padded_batch_size = RoundToLowestAllowedBatchSize(batch.size());
     const int padding_amount = padded_batch_size - batch.size();
+    RecordPaddingStats(batch.size(), padding_amount);
 
     // All tasks should have the same number of input edges.
     const int num_inputs = batch.task(0).inputs.size();
@@ -699,6 +802,35 @@ class BatchResource : public ResourceBase {
 
   std::vector<int32> allowed_batch_sizes_;
   FunctionLibraryRuntime::Handle fhandle_;
+
+  // Padding-efficiency accounting: batch-dimension padding rows added by
+  // allowed_batch_sizes rounding, and sequence-dimension padding elements
+  // added by length bucketing. Summarized in the log every
+  // kPaddingReportInterval assembled batches.
+  void RecordPaddingStats(int64 real_rows, int64 pad_rows) const {
+    batch_rows_.fetch_add(real_rows, std::memory_order_relaxed);
+    batch_pad_rows_.fetch_add(pad_rows, std::memory_order_relaxed);
+    const int64 batches =
+        batches_assembled_.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (batches % kPaddingReportInterval == 0) {
+      const double rows = batch_rows_.load(std::memory_order_relaxed);
+      const double pad = batch_pad_rows_.load(std::memory_order_relaxed);
+      const double seq = sequence_elements_.load(std::memory_order_relaxed);
+      const double seq_pad =
+          sequence_pad_elements_.load(std::memory_order_relaxed);
+      LOG(INFO) << "Batching padding efficiency after " << batches
+                << " batches: batch-dim "
+                << 100.0 * rows / std::max(rows + pad, 1.0)
+                << "%, sequence-dim "
+                << 100.0 * seq / std::max(seq + seq_pad, 1.0) << "%";
+    }
+  }
+
+  mutable std::atomic<int64> batch_rows_{0};
+  mutable std::atomic<int64> batch_pad_rows_{0};
+  mutable std::atomic<int64> batches_assembled_{0};
+  mutable std::atomic<int64> sequence_elements_{0};
+  mutable std::atomic<int64> sequence_pad_elements_{0};
 };
 
 class BatchFunctionKernel : public AsyncOpKernel {
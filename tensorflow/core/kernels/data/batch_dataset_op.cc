@@ -22,6 +22,7 @@ limitations under the License.
 #include "tensorflow/core/lib/gtl/cleanup.h"
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/util/batch_util.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 namespace data {
@@ -66,6 +67,27 @@ class BatchDatasetOp::Dataset : public DatasetBase {
             PartialTensorShape({-1}).Concatenate(input_shape));
       }
     }
+
+    // When all components have static shapes, the batch tensors can be
+    // allocated up front and each element copied into its slice as soon as
+    // the input iterator produces it, instead of buffering a full batch of
+    // element tensors first.
+    bool slab_copy = false;
+    TF_CHECK_OK(ReadBoolFromEnvVar("TF_DATA_BATCH_SLAB_COPY", false,
+                                   &slab_copy));
+    if (slab_copy) {
+      for (const auto& input_shape : input_shapes) {
+        TensorShape element_shape;
+        if (!input_shape.IsFullyDefined() ||
+            !input_shape.AsTensorShape(&element_shape)) {
+          slab_copy = false;
+          fixed_element_shapes_.clear();
+          break;
+        }
+        fixed_element_shapes_.push_back(std::move(element_shape));
+      }
+    }
+    slab_copy_ = slab_copy;
   }
 
   ~Dataset() override { input_->Unref(); }
@@ -136,6 +158,9 @@ class BatchDatasetOp::Dataset : public DatasetBase {
     Status GetNextInternal(IteratorContext* ctx,
                            std::vector<Tensor>* out_tensors,
                            bool* end_of_sequence) override {
+      if (dataset()->slab_copy_) {
+        return SlabBatch(ctx, out_tensors, end_of_sequence);
+      }
       // Each row of `batch_elements` is a tuple of tensors from the
       // input iterator.
       std::vector<std::vector<Tensor>> batch_elements;
@@ -248,6 +273,82 @@ class BatchDatasetOp::Dataset : public DatasetBase {
       return model::MakeKnownRatioNode(std::move(args), dataset()->batch_size_);
     }
 
+    // Batches statically shaped components by preallocating the batch
+    // tensors and copying each element into its slice as it arrives, so no
+    // per-batch buffer of element tensors is kept alive.
+    Status SlabBatch(IteratorContext* ctx, std::vector<Tensor>* out_tensors,
+                     bool* end_of_sequence) {
+      const auto& element_shapes = dataset()->fixed_element_shapes_;
+      const DataTypeVector& dtypes = dataset()->output_dtypes();
+      std::vector<Tensor> batch_components;
+      batch_components.reserve(element_shapes.size());
+      for (size_t i = 0; i < element_shapes.size(); ++i) {
+        TensorShape batch_component_shape({dataset()->batch_size_});
+        batch_component_shape.AppendShape(element_shapes[i]);
+        batch_components.emplace_back(ctx->allocator({}), dtypes[i],
+                                      batch_component_shape);
+        if (!batch_components.back().IsInitialized()) {
+          return errors::ResourceExhausted(
+              "Failed to allocate memory for the batch of component ", i);
+        }
+      }
+
+      int64 num_batch_elements = 0;
+      {
+        mutex_lock l(mu_);
+        if (!input_impl_) {
+          *end_of_sequence = true;
+          return Status::OK();
+        }
+        *end_of_sequence = false;
+        while (num_batch_elements < dataset()->batch_size_ &&
+               !*end_of_sequence) {
+          std::vector<Tensor> batch_element_tuple;
+          TF_RETURN_IF_ERROR(
+              input_impl_->GetNext(ctx, &batch_element_tuple, end_of_sequence));
+          if (*end_of_sequence) {
+            input_impl_.reset();
+            break;
+          }
+          for (size_t i = 0; i < batch_element_tuple.size(); ++i) {
+            if (batch_element_tuple[i].shape() != element_shapes[i]) {
+              return errors::InvalidArgument(
+                  "Cannot batch tensors with different shapes in component ",
+                  i, ". Expected shape ", element_shapes[i].DebugString(),
+                  " and element ", num_batch_elements, " had shape ",
+                  batch_element_tuple[i].shape().DebugString(), ".");
+            }
+            TF_RETURN_IF_ERROR(batch_util::CopyElementToSlice(
+                std::move(batch_element_tuple[i]), &batch_components[i],
+                num_batch_elements));
+          }
+          ++num_batch_elements;
+        }
+      }
+
+      if (num_batch_elements == 0) {
+        DCHECK(*end_of_sequence);
+        return Status::OK();
+      }
+      if (dataset()->drop_remainder_ &&
+          num_batch_elements < dataset()->batch_size_) {
+        *end_of_sequence = true;
+        return Status::OK();
+      }
+
+      out_tensors->reserve(batch_components.size());
+      for (Tensor& batch_component : batch_components) {
+        if (num_batch_elements == dataset()->batch_size_) {
+          out_tensors->push_back(std::move(batch_component));
+        } else {
+          // A partial final batch aliases the leading rows of the slab.
+          out_tensors->push_back(batch_component.Slice(0, num_batch_elements));
+        }
+      }
+      *end_of_sequence = false;
+      return Status::OK();
+    }
+
     Status SaveInternal(IteratorStateWriter* writer) override {
       mutex_lock l(mu_);
       if (!input_impl_) {
@@ -280,6 +381,8 @@ class BatchDatasetOp::Dataset : public DatasetBase {
   const DatasetBase* const input_;
   const int op_version_;
   std::vector<PartialTensorShape> output_shapes_;
+  bool slab_copy_ = false;
+  std::vector<TensorShape> fixed_element_shapes_;
 };
 
 BatchDatasetOp::BatchDatasetOp(OpKernelConstruction* ctx)
@@ -33,6 +33,7 @@ limitations under the License.
 #include "tensorflow/core/kernels/data/captured_function.h"
 #include "tensorflow/core/kernels/data/dataset_utils.h"
 #include "tensorflow/core/kernels/data/optional_ops.h"
+#include "tensorflow/core/kernels/data/unbounded_thread_pool.h"
 #include "tensorflow/core/kernels/ops_util.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/refcount.h"
@@ -44,6 +45,7 @@ limitations under the License.
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/public/session_options.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 namespace data {
@@ -885,6 +887,44 @@ class OneShotIteratorOp : public AsyncOpKernel {
   const int graph_def_version_;
 };
 
+// Returns the process-wide thread pool on which blocking `GetNext()` calls
+// are issued, or `nullptr` if the per-kernel background worker should be
+// used instead.
+//
+// Each `IteratorGetNext` kernel owns a single-threaded `BackgroundWorker`,
+// which has two costs under concurrent steps: every kernel instance pins an
+// idle thread for the lifetime of the session, and concurrent invocations of
+// the same kernel serialize behind that one thread even when the downstream
+// graph could overlap them. The shared `UnboundedThreadPool` creates threads
+// lazily and recycles them, so a stalled input pipeline parks a cached
+// thread instead of an executor thread, and each in-flight `GetNext()` gets
+// its own logical thread. The `done` callback remains the continuation that
+// resumes the step once data is available.
+UnboundedThreadPool* IteratorGetNextThreadPool() {
+  static const bool use_unbounded_pool = []() {
+    bool enabled;
+    TF_CHECK_OK(ReadBoolFromEnvVar("TF_DATA_UNBOUNDED_GET_NEXT", true,
+                                   &enabled));
+    return enabled;
+  }();
+  if (!use_unbounded_pool) {
+    return nullptr;
+  }
+  static UnboundedThreadPool* pool =
+      new UnboundedThreadPool(Env::Default(), "tf_data_iterator_get_next");
+  return pool;
+}
+
+void ScheduleGetNext(UnboundedThreadPool* pool,
+                     BackgroundWorker* background_worker,
+                     std::function<void()> fn) {
+  if (pool != nullptr) {
+    pool->Schedule(std::move(fn));
+  } else {
+    background_worker->Schedule(std::move(fn));
+  }
+}
+
 }  // namespace
 
 void IteratorGetNextOp::ComputeAsync(OpKernelContext* ctx, DoneCallback done) {
@@ -892,9 +932,9 @@ void IteratorGetNextOp::ComputeAsync(OpKernelContext* ctx, DoneCallback done) {
   OP_REQUIRES_OK_ASYNC(
       ctx, LookupResource(ctx, HandleFromInput(ctx, 0), &iterator), done);
   // The call to `iterator->GetNext()` may block and depend on an
-  // inter-op thread pool thread, so we issue the call from the
-  // owned thread pool.
-  background_worker_.Schedule(std::bind(
+  // inter-op thread pool thread, so we issue the call from the shared
+  // unbounded pool (or, when that is disabled, the owned thread pool).
+  ScheduleGetNext(IteratorGetNextThreadPool(), &background_worker_, std::bind(
       [ctx, iterator](DoneCallback done) {
         std::vector<Tensor> components;
         bool end_of_sequence = false;
@@ -941,9 +981,9 @@ void IteratorGetNextAsOptionalOp::ComputeAsync(OpKernelContext* ctx,
   OP_REQUIRES_OK_ASYNC(
       ctx, LookupResource(ctx, HandleFromInput(ctx, 0), &iterator), done);
   // The call to `iterator->GetNext()` may block and depend on an
-  // inter-op thread pool thread, so we issue the call from the
-  // owned thread pool.
-  background_worker_.Schedule(std::bind(
+  // inter-op thread pool thread, so we issue the call from the shared
+  // unbounded pool (or, when that is disabled, the owned thread pool).
+  ScheduleGetNext(IteratorGetNextThreadPool(), &background_worker_, std::bind(
       [this, ctx, iterator](DoneCallback done) {
         std::vector<Tensor> components;
         bool end_of_sequence = false;
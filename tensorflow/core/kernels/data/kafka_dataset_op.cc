@@ -771,8 +771,10 @@ class KafkaReadableResource : public ResourceBase {
     Tensor* key_tensor;
     TF_RETURN_IF_ERROR(allocate_func(shape, &message_tensor, &key_tensor));
     for (size_t i = 0; i < message_value.size(); i++) {
-      message_tensor->flat<tstring>()(i) = message_value[i];
-      key_tensor->flat<tstring>()(i) = key_value[i];
+      // Move the consumed bytes into the output instead of copying them a
+      // second time.
+      message_tensor->flat<tstring>()(i) = std::move(message_value[i]);
+      key_tensor->flat<tstring>()(i) = std::move(key_value[i]);
     }
     return Status::OK();
   }
@@ -841,8 +843,10 @@ class KafkaReadableResource : public ResourceBase {
     Tensor* key_tensor;
     TF_RETURN_IF_ERROR(allocate_func(shape, &message_tensor, &key_tensor));
     for (size_t i = 0; i < message_value.size(); i++) {
-      message_tensor->flat<tstring>()(i) = message_value[i];
-      key_tensor->flat<tstring>()(i) = key_value[i];
+      // Move the consumed bytes into the output instead of copying them a
+      // second time.
+      message_tensor->flat<tstring>()(i) = std::move(message_value[i]);
+      key_tensor->flat<tstring>()(i) = std::move(key_value[i]);
     }
     return Status::OK();
   }
@@ -1537,8 +1541,10 @@ class KafkaGroupReadableResource : public ResourceBase {
       continue_fetch_tensor->scalar<int64>()() = 0;
     }
     for (size_t i = 0; i < message_value.size(); i++) {
-      message_tensor->flat<tstring>()(i) = message_value[i];
-      key_tensor->flat<tstring>()(i) = key_value[i];
+      // Move the consumed bytes into the output instead of copying them a
+      // second time.
+      message_tensor->flat<tstring>()(i) = std::move(message_value[i]);
+      key_tensor->flat<tstring>()(i) = std::move(key_value[i]);
     }
 
     return Status::OK();
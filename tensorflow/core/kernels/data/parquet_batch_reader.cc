@@ -14,13 +14,17 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/parquet_batch_reader.h"
 
+#include <deque>
 #include <memory>
 #include <numeric>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/strings/match.h"
 #include "tensorflow/core/kernels/data/arrow_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
 
 namespace tensorflow {
 namespace data {
@@ -32,7 +36,7 @@ class ParquetBatchReader::Impl {
        const DataTypeVector& field_dtypes,
        const std::vector<int32>& field_ragged_ranks,
        const int64 partition_count, const int64 partition_index,
-       const bool drop_remainder)
+       const bool drop_remainder, const int64 read_ahead)
       : filename_(filename),
         batch_size_(batch_size),
         field_names_(field_names),
@@ -40,7 +44,18 @@ class ParquetBatchReader::Impl {
         field_ragged_ranks_(field_ragged_ranks),
         partition_count_(partition_count),
         partition_index_(partition_index),
-        drop_remainder_(drop_remainder) {}
+        drop_remainder_(drop_remainder),
+        read_ahead_(read_ahead) {}
+
+  ~Impl() {
+    {
+      mutex_lock l(mu_);
+      cancelled_ = true;
+      space_cv_.notify_all();
+    }
+    // Joins the readahead worker, if any.
+    worker_.reset();
+  }
 
   Status Open() {
     if (TF_PREDICT_TRUE(batch_reader_)) {
@@ -101,10 +116,37 @@ class ParquetBatchReader::Impl {
 
     TF_RETURN_IF_ARROW_ERROR(reader_->GetRecordBatchReader(
         row_group_indices_, column_indices_, &batch_reader_));
+
+    if (read_ahead_ > 0) {
+      // Decode upcoming batches on a worker so the trainer consumes the
+      // current batch while the next one is being read.
+      worker_.reset(Env::Default()->StartThread(
+          ThreadOptions(), "parquet_read_ahead",
+          [this]() { ReadAheadLoop(); }));
+    }
     return Status::OK();
   }
 
   Status Read(std::vector<Tensor>* output_tensors) {
+    if (read_ahead_ <= 0) {
+      return ReadNextBatch(output_tensors);
+    }
+
+    mutex_lock l(mu_);
+    while (buffered_.empty() && !worker_done_) {
+      read_cv_.wait(l);
+    }
+    if (!buffered_.empty()) {
+      *output_tensors = std::move(buffered_.front());
+      buffered_.pop_front();
+      space_cv_.notify_one();
+      return Status::OK();
+    }
+    return worker_status_;
+  }
+
+ private:
+  Status ReadNextBatch(std::vector<Tensor>* output_tensors) {
     // Read next batch from parquet file.
     std::shared_ptr<::arrow::RecordBatch> batch;
     TF_RETURN_IF_ARROW_ERROR(batch_reader_->ReadNext(&batch));
@@ -126,7 +168,33 @@ class ParquetBatchReader::Impl {
     return Status::OK();
   }
 
- private:
+  void ReadAheadLoop() {
+    while (true) {
+      std::vector<Tensor> tensors;
+      Status s = ReadNextBatch(&tensors);
+      mutex_lock l(mu_);
+      if (cancelled_) {
+        return;
+      }
+      if (!s.ok()) {
+        // Including the OutOfRange that ends the file.
+        worker_status_ = s;
+        worker_done_ = true;
+        read_cv_.notify_all();
+        return;
+      }
+      while (buffered_.size() >= static_cast<size_t>(read_ahead_) &&
+             !cancelled_) {
+        space_cv_.wait(l);
+      }
+      if (cancelled_) {
+        return;
+      }
+      buffered_.push_back(std::move(tensors));
+      read_cv_.notify_one();
+    }
+  }
+
   const string filename_;
   const int64 batch_size_;
   std::vector<string> field_names_;
@@ -139,16 +207,28 @@ class ParquetBatchReader::Impl {
   std::unique_ptr<::arrow::RecordBatchReader> batch_reader_;
   std::vector<int> row_group_indices_;
   std::vector<int> column_indices_;
+
+  // Readahead state, used when read_ahead_ > 0.
+  const int64 read_ahead_;
+  std::unique_ptr<Thread> worker_;
+  mutex mu_;
+  condition_variable read_cv_;
+  condition_variable space_cv_;
+  std::deque<std::vector<Tensor>> buffered_ GUARDED_BY(mu_);
+  Status worker_status_ GUARDED_BY(mu_);
+  bool worker_done_ GUARDED_BY(mu_) = false;
+  bool cancelled_ GUARDED_BY(mu_) = false;
 };
 
 ParquetBatchReader::ParquetBatchReader(
     const string& filename, const int64 batch_size,
     const std::vector<string>& field_names, const DataTypeVector& field_dtypes,
     const std::vector<int32>& field_ragged_ranks, const int64 partition_count,
-    const int64 partition_index, const bool drop_remainder)
+    const int64 partition_index, const bool drop_remainder,
+    const int64 read_ahead)
     : pimpl_(new ParquetBatchReader::Impl(
           filename, batch_size, field_names, field_dtypes, field_ragged_ranks,
-          partition_count, partition_index, drop_remainder)) {}
+          partition_count, partition_index, drop_remainder, read_ahead)) {}
 
 Status ParquetBatchReader::Open() { return pimpl_->Open(); }
 
@@ -31,7 +31,7 @@ class ParquetBatchReader {
                      const DataTypeVector& field_dtypes,
                      const std::vector<int32>& field_ragged_ranks,
                      const int64 partition_count, const int64 partition_index,
-                     const bool drop_remainder);
+                     const bool drop_remainder, const int64 read_ahead);
 
   Status Open();
 
@@ -38,7 +38,7 @@ class ParquetTabularDatasetOp::Dataset : public DatasetBase {
           const DataTypeVector& field_dtypes,
           const std::vector<int32>& field_ragged_ranks,
           const int64 partition_count, const int64 partition_index,
-          const bool drop_remainder)
+          const bool drop_remainder, const int64 read_ahead)
       : DatasetBase(DatasetContext(ctx)),
         filename_(std::move(filename)),
         batch_size_(batch_size),
@@ -47,7 +47,8 @@ class ParquetTabularDatasetOp::Dataset : public DatasetBase {
         field_ragged_ranks_(std::move(field_ragged_ranks)),
         partition_count_(partition_count),
         partition_index_(partition_index),
-        drop_remainder_(drop_remainder) {
+        drop_remainder_(drop_remainder),
+        read_ahead_(read_ahead) {
     int64 num_outputs = field_names.size();
     for (int64 i = 0; i < field_names.size(); ++i) {
       output_dtypes_.push_back(std::move(field_dtypes[i]));
@@ -64,7 +65,7 @@ class ParquetTabularDatasetOp::Dataset : public DatasetBase {
     reader_ = absl::make_unique<ParquetBatchReader>(
         filename_, batch_size_, field_names_, field_dtypes_,
         field_ragged_ranks_, partition_count_, partition_index_,
-        drop_remainder_);
+        drop_remainder_, read_ahead_);
   }
 
   Status Open() {
@@ -107,6 +108,8 @@ class ParquetTabularDatasetOp::Dataset : public DatasetBase {
     b->BuildAttrValue(partition_index_, &partition_index);
     AttrValue drop_remainder;
     b->BuildAttrValue(drop_remainder_, &drop_remainder);
+    AttrValue read_ahead;
+    b->BuildAttrValue(read_ahead_, &read_ahead);
     TF_RETURN_IF_ERROR(
         b->AddDataset(this, {{0, filename}, {1, batch_size}}, {},
                       {{"field_names", field_names},
@@ -114,7 +117,8 @@ class ParquetTabularDatasetOp::Dataset : public DatasetBase {
                        {"field_ragged_ranks", field_ragged_ranks},
                        {"partition_count", partition_count},
                        {"partition_index", partition_index},
-                       {"drop_remainder", drop_remainder}},
+                       {"drop_remainder", drop_remainder},
+                       {"read_ahead", read_ahead}},
                       output));
     return Status::OK();
   }
@@ -129,6 +133,7 @@ class ParquetTabularDatasetOp::Dataset : public DatasetBase {
   const int64 partition_count_;
   const int64 partition_index_;
   const bool drop_remainder_;
+  const int64 read_ahead_;
   DataTypeVector output_dtypes_;
   std::vector<PartialTensorShape> output_shapes_;
   std::unique_ptr<ParquetBatchReader> reader_;
@@ -181,7 +186,8 @@ ParquetTabularDatasetOp::ParquetTabularDatasetOp(OpKernelConstruction* ctx)
     : DatasetOpKernel(ctx),
       partition_count_(1),
       partition_index_(0),
-      drop_remainder_(false) {
+      drop_remainder_(false),
+      read_ahead_(0) {
   OP_REQUIRES_OK(ctx, ctx->GetAttr("field_names", &field_names_));
   OP_REQUIRES_OK(ctx, ctx->GetAttr("field_dtypes", &field_dtypes_));
   OP_REQUIRES_OK(ctx,
@@ -189,6 +195,7 @@ ParquetTabularDatasetOp::ParquetTabularDatasetOp(OpKernelConstruction* ctx)
   OP_REQUIRES_OK(ctx, ctx->GetAttr("partition_count", &partition_count_));
   OP_REQUIRES_OK(ctx, ctx->GetAttr("partition_index", &partition_index_));
   OP_REQUIRES_OK(ctx, ctx->GetAttr("drop_remainder", &drop_remainder_));
+  OP_REQUIRES_OK(ctx, ctx->GetAttr("read_ahead", &read_ahead_));
 }
 
 void ParquetTabularDatasetOp::MakeDataset(OpKernelContext* ctx,
@@ -203,7 +210,8 @@ void ParquetTabularDatasetOp::MakeDataset(OpKernelContext* ctx,
 
   Dataset* ds = new Dataset(
       ctx, filename, batch_size, field_names_, field_dtypes_,
-      field_ragged_ranks_, partition_count_, partition_index_, drop_remainder_);
+      field_ragged_ranks_, partition_count_, partition_index_, drop_remainder_,
+      read_ahead_);
   OP_REQUIRES_OK(ctx, ds->Open());
   *output = ds;
 }
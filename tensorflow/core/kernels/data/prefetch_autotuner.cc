@@ -15,25 +15,54 @@ limitations under the License.
 
 #include "tensorflow/core/kernels/data/prefetch_autotuner.h"
 
+#include <algorithm>
+
 #include "tensorflow/core/framework/model.h"
+#include "tensorflow/core/platform/mem.h"
 
 namespace tensorflow {
 namespace data {
 
+namespace {
+// Determines what strategy to use for increasing the buffer size limit. For
+// limits less than the threshold, an exponential increase is used, while for
+// limits greater than or equal to the threshold, a linear increase is used.
+size_t kBufferLimitThreshold = 2048;
+
+// Share of available RAM a single prefetch buffer may occupy.
+constexpr double kRamBudgetShare = 0.1;
+
+// Number of consecutive consumptions with a mostly full buffer after which
+// the buffer limit is halved.
+constexpr int64 kShrinkThreshold = 64;
+}  // namespace
+
 PrefetchAutotuner::PrefetchAutotuner(int64 initial_buffer_size)
-    : buffer_limit_(initial_buffer_size) {
+    : buffer_limit_(initial_buffer_size),
+      ram_budget_(kRamBudgetShare * port::AvailableRam()) {
   if (initial_buffer_size == model::kAutotune) {
     mode_ = Mode::kUpswing;
     buffer_limit_ = 1;
   }
 }
 
-namespace {
-// Determines what strategy to use for increasing the buffer size limit. For
-// limits less than the threshold, an exponential increase is used, while for
-// limits greater than or equal to the threshold, a linear increase is used.
-size_t kBufferLimitThreshold = 2048;
-}  // namespace
+void PrefetchAutotuner::RecordElementBytes(int64 bytes) {
+  if (mode_ == Mode::kDisabled || bytes <= 0) {
+    return;
+  }
+  if (avg_element_bytes_ == 0) {
+    avg_element_bytes_ = bytes;
+  } else {
+    avg_element_bytes_ = (avg_element_bytes_ * 7 + bytes) / 8;
+  }
+}
+
+int64 PrefetchAutotuner::MemoryLimit() const {
+  if (avg_element_bytes_ <= 0) {
+    return kint64max;
+  }
+  return std::max<int64>(1, ram_budget_ / avg_element_bytes_);
+}
 
 void PrefetchAutotuner::RecordConsumption(size_t current_buffer_size) {
   switch (mode_) {
@@ -46,12 +75,28 @@ void PrefetchAutotuner::RecordConsumption(size_t current_buffer_size) {
       return;
     case Mode::kDownswing:
       if (current_buffer_size == 0) {
-        if (buffer_limit_ >= kBufferLimitThreshold) {
-          buffer_limit_ += kBufferLimitThreshold;
-        } else {
-          buffer_limit_ *= 2;
+        full_count_ = 0;
+        if (buffer_limit_ < MemoryLimit()) {
+          if (buffer_limit_ >= kBufferLimitThreshold) {
+            buffer_limit_ += kBufferLimitThreshold;
+          } else {
+            buffer_limit_ *= 2;
+          }
+          buffer_limit_ = std::min(buffer_limit_, MemoryLimit());
+          mode_ = Mode::kUpswing;
+        }
+        return;
+      }
+      // A buffer that the consumer never gets close to draining is oversized:
+      // it holds memory without reducing consumer wait time.
+      if (buffer_limit_ > 1 &&
+          static_cast<int64>(current_buffer_size) * 2 >= buffer_limit_) {
+        if (++full_count_ >= kShrinkThreshold) {
+          buffer_limit_ /= 2;
+          full_count_ = 0;
         }
-        mode_ = Mode::kUpswing;
+      } else {
+        full_count_ = 0;
       }
       return;
   }
@@ -33,8 +33,10 @@ namespace data {
 // if the prefetching thread is able to successfully fill the buffer at its
 // current size.
 //
-// Note: in the current implementation, we never decrease the buffer_limit().
-// This should change in the future!
+// The buffer limit is additionally bounded by a memory budget: once the
+// average element size is known, the limit never grows beyond the number of
+// elements that fit in the budget, and a buffer that stays persistently full
+// is shrunk since it holds memory without reducing consumer wait time.
 //
 // PrefetchAutotuner is NOT thread safe.
 class PrefetchAutotuner {
@@ -46,6 +48,10 @@ class PrefetchAutotuner {
   void RecordConsumption(size_t current_buffer_size);
   void RecordEmpty() { RecordConsumption(0); }
 
+  // Records the byte size of a dequeued element, used to keep the buffer
+  // limit within the memory budget.
+  void RecordElementBytes(int64 bytes);
+
  private:
   // PrefetchAutotuner operates as a state machine.
   enum class Mode {
@@ -61,7 +67,17 @@ class PrefetchAutotuner {
     kDownswing,
   };
 
+  // Returns the largest buffer limit that fits in the memory budget given the
+  // observed element size. Unbounded until an element size is recorded.
+  int64 MemoryLimit() const;
+
   int64 buffer_limit_;
+  const int64 ram_budget_;
+  // Moving average of the element byte size.
+  int64 avg_element_bytes_ = 0;
+  // Number of consecutive consumptions that left the buffer at least half
+  // full, used to detect oversized buffers.
+  int64 full_count_ = 0;
   Mode mode_ = Mode::kDisabled;
 };
 
@@ -80,6 +80,34 @@ TEST(PrefetchAutotuner, EnabledSteady) {
   }
 }
 
+TEST(PrefetchAutotuner, MemoryBudget) {
+  PrefetchAutotuner t(model::kAutotune);
+  // Pretend each element is enormous; the limit must stop growing once the
+  // budget is exhausted instead of doubling forever.
+  t.RecordElementBytes(kint64max / 4);
+  EXPECT_EQ(1, t.buffer_limit());
+  t.RecordConsumption(1);
+  t.RecordConsumption(0);
+  EXPECT_EQ(1, t.buffer_limit());
+  t.RecordConsumption(0);
+  EXPECT_EQ(1, t.buffer_limit());
+}
+
+TEST(PrefetchAutotuner, ShrinksPersistentlyFullBuffer) {
+  PrefetchAutotuner t(model::kAutotune);
+  t.RecordConsumption(1);
+  t.RecordConsumption(0);
+  t.RecordConsumption(2);
+  t.RecordConsumption(0);
+  EXPECT_EQ(4, t.buffer_limit());
+  t.RecordConsumption(4);
+  // A buffer that stays at least half full for long enough is halved.
+  for (int i = 0; i < 128; ++i) {
+    t.RecordConsumption(3);
+  }
+  EXPECT_LT(t.buffer_limit(), 4);
+}
+
 }  // namespace
 }  // namespace data
 }  // namespace tensorflow
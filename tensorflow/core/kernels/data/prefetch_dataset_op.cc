@@ -339,6 +339,7 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
         RecordBufferDequeue(ctx, *out_tensors);
       }
       if (legacy_autotune_) {
+        auto_tuner_.RecordElementBytes(GetAllocatedBytes(*out_tensors));
         auto_tuner_.RecordConsumption(buffer_.size());
         buffer_size_->value = auto_tuner_.buffer_limit();
       }
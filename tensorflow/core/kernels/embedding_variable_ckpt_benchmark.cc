@@ -0,0 +1,345 @@
+/* Copyright 2022 The DeepRec Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Standalone benchmark for the EmbeddingVar checkpoint path.
+//
+// Populates a synthetic EV at configurable scale, then runs repeated
+// full-save / restore / incremental-save cycles and reports wall time,
+// throughput over the logical bytes moved, and resident set size after
+// each phase. A final phase measures the stall a full save inflicts on a
+// concurrent training-style lookup/update loop (p99 batch latency with
+// and without the save running).
+//
+// Example:
+//   bazel run -c opt //tensorflow/core/kernels:embedding_variable_ckpt_benchmark -- \
+//     --num_keys=8388608 --value_size=64 --skew=1.2 --cycles=3 --use_ssd=false
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/kernels/incr_save_restore_ops.h"
+#include "tensorflow/core/kernels/kv_variable_ops.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/init_main.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/util/command_line_flags.h"
+#include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
+
+namespace tensorflow {
+namespace {
+
+double ResidentMiB() {
+  long size = 0, resident = 0;
+  FILE* fp = fopen("/proc/self/statm", "r");
+  if (fp == nullptr) return 0.0;
+  if (fscanf(fp, "%ld %ld", &size, &resident) != 2) resident = 0;
+  fclose(fp);
+  return resident * getpagesize() / 1024.0 / 1024.0;
+}
+
+struct BenchConfig {
+  int64 num_keys = 1 << 20;
+  int64 value_size = 64;
+  float skew = 1.2f;       // 0 = uniform draws; larger = hotter head.
+  bool use_ssd = false;    // DRAM_SSDHASH instead of pure DRAM.
+  int32 cycles = 3;
+  float incr_fraction = 0.05f;
+  int32 train_threads = 4;
+  string ckpt_dir = "/tmp/ev_ckpt_bench";
+};
+
+// Draws a key in [0, num_keys) with a power-law bias toward small ids.
+int64 SkewedKey(const BenchConfig& config, std::mt19937_64* rng) {
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  double u = uniform(*rng);
+  if (config.skew > 0.0) {
+    u = std::pow(u, config.skew);
+  }
+  int64 key = static_cast<int64>(u * config.num_keys);
+  return std::min(key, config.num_keys - 1);
+}
+
+EmbeddingVar<int64, float>* CreateEV(const BenchConfig& config,
+                                     const string& name) {
+  Tensor default_value(DT_FLOAT, TensorShape({config.value_size}));
+  default_value.flat<float>().setConstant(1.0f);
+  embedding::StorageManager<int64, float>* storage_manager = nullptr;
+  EmbeddingVar<int64, float>* variable = nullptr;
+  if (config.use_ssd) {
+    // Keep the DRAM budget small so part of the population really lives
+    // on the SSD tier during the save.
+    std::vector<int64> size = {1 << 22, 1 << 30, 1 << 30, 1 << 30};
+    storage_manager = new embedding::StorageManager<int64, float>(
+        name, embedding::StorageConfig(embedding::DRAM_SSDHASH,
+                                       config.ckpt_dir, size,
+                                       "normal_contiguous"));
+    TF_CHECK_OK(storage_manager->Init());
+    variable = new EmbeddingVar<int64, float>(
+        name, storage_manager,
+        EmbeddingConfig(/*emb_index = */ 0, /*primary_emb_index = */ 0,
+                        /*block_num = */ 1, /*slot_num = */ 0,
+                        /*name = */ "", /*steps_to_live = */ 0,
+                        /*filter_freq = */ 0, /*max_freq = */ 999999,
+                        /*l2_weight_threshold = */ -1.0,
+                        /*layout = */ "normal_contiguous"));
+  } else {
+    storage_manager = new embedding::StorageManager<int64, float>(
+        name, embedding::StorageConfig());
+    TF_CHECK_OK(storage_manager->Init());
+    variable = new EmbeddingVar<int64, float>(name, storage_manager);
+  }
+  variable->Init(default_value, 1);
+  return variable;
+}
+
+void Populate(const BenchConfig& config, EmbeddingVar<int64, float>* ev) {
+  for (int64 i = 0; i < config.num_keys; ++i) {
+    ValuePtr<float>* value_ptr = nullptr;
+    TF_CHECK_OK(ev->LookupOrCreateKey(i, &value_ptr));
+    typename TTypes<float>::Flat vflat = ev->flat(value_ptr);
+    vflat(0) = static_cast<float>(i);
+  }
+}
+
+// Logical bytes per saved key: values, key, version, freq.
+int64 BytesPerKey(const BenchConfig& config) {
+  return config.value_size * sizeof(float) + 3 * sizeof(int64);
+}
+
+void ReportPhase(const string& phase, int cycle, double seconds,
+                 int64 logical_bytes) {
+  LOG(INFO) << phase << " cycle " << cycle << ": " << seconds << " s, "
+            << (logical_bytes / seconds / 1024.0 / 1024.0) << " MiB/s, rss "
+            << ResidentMiB() << " MiB";
+}
+
+double RunFullSave(const BenchConfig& config, EmbeddingVar<int64, float>* ev,
+                   const string& prefix) {
+  Tensor part_offset_tensor(DT_INT32, TensorShape({kSavedPartitionNum + 1}));
+  const uint64 begin_us = Env::Default()->NowMicros();
+  BundleWriter writer(Env::Default(), prefix);
+  TF_CHECK_OK(
+      DumpEmbeddingValues(ev, "var/part_0", &writer, &part_offset_tensor));
+  TF_CHECK_OK(writer.Finish());
+  return (Env::Default()->NowMicros() - begin_us) / 1e6;
+}
+
+double RunRestore(const BenchConfig& config, const string& prefix) {
+  EmbeddingVar<int64, float>* restored = CreateEV(config, "EVRestored");
+  const uint64 begin_us = Env::Default()->NowMicros();
+  BundleReader reader(Env::Default(), prefix);
+  TF_CHECK_OK(reader.status());
+  TF_CHECK_OK(DynamicRestoreValue(restored, &reader, "var/part_0",
+                                  /*orig_partnum = */ 1));
+  const double seconds = (Env::Default()->NowMicros() - begin_us) / 1e6;
+  if (restored->Size() != config.num_keys) {
+    LOG(ERROR) << "Restore size mismatch: got " << restored->Size()
+               << " keys, expected " << config.num_keys;
+  }
+  restored->Unref();
+  return seconds;
+}
+
+// Touches a skewed subset of keys, then dumps only that subset the way
+// the incremental-save kernels do.
+double RunIncrSave(const BenchConfig& config, EmbeddingVar<int64, float>* ev,
+                   const string& prefix, std::mt19937_64* rng,
+                   int64* incr_key_count) {
+  std::set<int64> touched;
+  const int64 target =
+      static_cast<int64>(config.num_keys * config.incr_fraction);
+  while (static_cast<int64>(touched.size()) < target) {
+    touched.insert(SkewedKey(config, rng));
+  }
+  std::vector<int64> incr_keys(touched.begin(), touched.end());
+  for (int64 key : incr_keys) {
+    ValuePtr<float>* value_ptr = nullptr;
+    TF_CHECK_OK(ev->LookupOrCreateKey(key, &value_ptr));
+    typename TTypes<float>::Flat vflat = ev->flat(value_ptr);
+    vflat -= vflat.constant(0.05f);
+  }
+  *incr_key_count = incr_keys.size();
+
+  const uint64 begin_us = Env::Default()->NowMicros();
+  BundleWriter writer(Env::Default(), prefix);
+  const size_t bytes_limit = 8 << 20;
+  char* dump_buffer = (char*)malloc(sizeof(char) * bytes_limit);
+
+  IncrKeyDumpIterator<int64> key_dump_iter(incr_keys);
+  TF_CHECK_OK(SaveTensorWithFixedBuffer(
+      "var/part_0-incr_keys", &writer, dump_buffer, bytes_limit,
+      &key_dump_iter, TensorShape({static_cast<int64>(incr_keys.size())})));
+
+  IncrEVValueDumpIterator<int64, float> value_dump_iter(incr_keys, ev);
+  TF_CHECK_OK(SaveTensorWithFixedBuffer(
+      "var/part_0-incr_values", &writer, dump_buffer, bytes_limit,
+      &value_dump_iter,
+      TensorShape({static_cast<int64>(incr_keys.size()), ev->ValueLen()})));
+
+  IncrEVVersionDumpIterator<int64, float, int64> version_dump_iter(incr_keys,
+                                                                   ev);
+  TF_CHECK_OK(SaveTensorWithFixedBuffer(
+      "var/part_0-incr_versions", &writer, dump_buffer, bytes_limit,
+      &version_dump_iter,
+      TensorShape({static_cast<int64>(incr_keys.size())})));
+
+  free(dump_buffer);
+  TF_CHECK_OK(writer.Finish());
+  return (Env::Default()->NowMicros() - begin_us) / 1e6;
+}
+
+// Training-style worker: skewed lookup/update loop recording per-batch
+// latencies until `stop` is set.
+void TrainWorker(const BenchConfig& config, EmbeddingVar<int64, float>* ev,
+                 uint64 seed, std::atomic<bool>* stop,
+                 std::vector<double>* batch_latencies_ms) {
+  const int64 kBatch = 512;
+  std::mt19937_64 rng(seed);
+  while (!stop->load(std::memory_order_relaxed)) {
+    const uint64 begin_us = Env::Default()->NowMicros();
+    for (int64 i = 0; i < kBatch; ++i) {
+      ValuePtr<float>* value_ptr = nullptr;
+      TF_CHECK_OK(ev->LookupOrCreateKey(SkewedKey(config, &rng), &value_ptr));
+      typename TTypes<float>::Flat vflat = ev->flat(value_ptr);
+      vflat -= vflat.constant(0.01f);
+    }
+    batch_latencies_ms->push_back(
+        (Env::Default()->NowMicros() - begin_us) / 1000.0);
+  }
+}
+
+double P99(std::vector<double>* latencies) {
+  if (latencies->empty()) return 0.0;
+  size_t idx = std::min(latencies->size() - 1,
+                        static_cast<size_t>(latencies->size() * 0.99));
+  std::nth_element(latencies->begin(), latencies->begin() + idx,
+                   latencies->end());
+  return (*latencies)[idx];
+}
+
+// Runs the training loop for `seconds`, optionally with a concurrent full
+// save, and returns the p99 batch latency in milliseconds.
+double MeasureTrainP99(const BenchConfig& config,
+                       EmbeddingVar<int64, float>* ev, const string& prefix,
+                       bool with_save) {
+  std::atomic<bool> stop(false);
+  std::vector<std::vector<double>> latencies(config.train_threads);
+  std::vector<std::thread> workers;
+  for (int i = 0; i < config.train_threads; ++i) {
+    workers.emplace_back(TrainWorker, config, ev, /*seed = */ 17 * (i + 1),
+                         &stop, &latencies[i]);
+  }
+  if (with_save) {
+    RunFullSave(config, ev, prefix);
+  } else {
+    Env::Default()->SleepForMicroseconds(2 * 1000 * 1000);
+  }
+  stop.store(true);
+  for (auto& t : workers) t.join();
+
+  std::vector<double> all;
+  for (auto& per_thread : latencies) {
+    all.insert(all.end(), per_thread.begin(), per_thread.end());
+  }
+  return P99(&all);
+}
+
+int Run(const BenchConfig& config) {
+  TF_CHECK_OK(Env::Default()->RecursivelyCreateDir(config.ckpt_dir));
+  LOG(INFO) << "Populating " << config.num_keys << " keys, value_size "
+            << config.value_size << ", skew " << config.skew << ", storage "
+            << (config.use_ssd ? "DRAM_SSDHASH" : "DRAM");
+
+  const double rss_before = ResidentMiB();
+  EmbeddingVar<int64, float>* ev = CreateEV(config, "EmbeddingVar");
+  Populate(config, ev);
+  LOG(INFO) << "Populated, ev rss delta " << ResidentMiB() - rss_before
+            << " MiB";
+
+  std::mt19937_64 rng(42);
+  const int64 full_bytes = config.num_keys * BytesPerKey(config);
+  for (int cycle = 0; cycle < config.cycles; ++cycle) {
+    const string prefix =
+        io::JoinPath(config.ckpt_dir, strings::StrCat("full-", cycle));
+    ReportPhase("full-save", cycle, RunFullSave(config, ev, prefix),
+                full_bytes);
+    ReportPhase("restore", cycle, RunRestore(config, prefix), full_bytes);
+
+    int64 incr_key_count = 0;
+    const string incr_prefix =
+        io::JoinPath(config.ckpt_dir, strings::StrCat("incr-", cycle));
+    const double incr_seconds =
+        RunIncrSave(config, ev, incr_prefix, &rng, &incr_key_count);
+    ReportPhase("incr-save", cycle, incr_seconds,
+                incr_key_count * BytesPerKey(config));
+  }
+
+  const double baseline_p99 = MeasureTrainP99(
+      config, ev, io::JoinPath(config.ckpt_dir, "stall-baseline"),
+      /*with_save = */ false);
+  const double save_p99 = MeasureTrainP99(
+      config, ev, io::JoinPath(config.ckpt_dir, "stall-save"),
+      /*with_save = */ true);
+  LOG(INFO) << "train p99 batch latency: baseline " << baseline_p99
+            << " ms, during full save " << save_p99 << " ms ("
+            << (baseline_p99 > 0.0 ? save_p99 / baseline_p99 : 0.0) << "x)";
+  LOG(INFO) << "peak rss " << ResidentMiB() << " MiB";
+
+  ev->Unref();
+  return 0;
+}
+
+}  // namespace
+}  // namespace tensorflow
+
+int main(int argc, char** argv) {
+  tensorflow::BenchConfig config;
+  std::vector<tensorflow::Flag> flag_list = {
+      tensorflow::Flag("num_keys", &config.num_keys,
+                       "number of keys to populate"),
+      tensorflow::Flag("value_size", &config.value_size,
+                       "embedding value length"),
+      tensorflow::Flag("skew", &config.skew,
+                       "power-law exponent for key draws (0 = uniform)"),
+      tensorflow::Flag("use_ssd", &config.use_ssd,
+                       "use DRAM_SSDHASH storage instead of pure DRAM"),
+      tensorflow::Flag("cycles", &config.cycles,
+                       "save/restore/incr-save cycles to run"),
+      tensorflow::Flag("incr_fraction", &config.incr_fraction,
+                       "fraction of keys touched before each incr-save"),
+      tensorflow::Flag("train_threads", &config.train_threads,
+                       "concurrent training threads in the stall phase"),
+      tensorflow::Flag("ckpt_dir", &config.ckpt_dir,
+                       "directory for checkpoint files"),
+  };
+  const tensorflow::string usage = tensorflow::Flags::Usage(argv[0], flag_list);
+  if (!tensorflow::Flags::Parse(&argc, argv, flag_list)) {
+    LOG(ERROR) << usage;
+    return -1;
+  }
+  tensorflow::port::InitMain(argv[0], &argc, &argv);
+  return tensorflow::Run(config);
+}
@@ -1,3 +1,5 @@
+#include <cmath>
+#include <random>
 #include <thread>
 
 #include "tensorflow/core/framework/op.h"
@@ -35,7 +37,14 @@
 #include <time.h>
 #include <sys/resource.h>
 #include "tensorflow/core/framework/embedding/kv_interface.h"
+#include "tensorflow/core/framework/embedding/admission_tuner.h"
 #include "tensorflow/core/framework/embedding/cache.h"
+#include "tensorflow/core/framework/embedding/compaction_scheduler.h"
+#include "tensorflow/core/framework/embedding/embedding_qos.h"
+#include "tensorflow/core/framework/embedding/gather_result_cache.h"
+#include "tensorflow/core/framework/embedding/health_stats.h"
+#include "tensorflow/core/framework/embedding/read_snapshot.h"
+#include "tensorflow/core/framework/embedding/zstd_dict_codec.h"
 #include "tensorflow/core/kernels/kv_variable_ops.h"
 #ifdef TENSORFLOW_USE_JEMALLOC
 #include "jemalloc/jemalloc.h"
@@ -320,6 +329,58 @@ TEST(EmbeddingVariableTest, TestEVExportSmallLockless) {
   }
 }
 
+TEST(EmbeddingVariableTest, TestEVValidateRestoreCompatibility) {
+  int64 value_size = 8;
+  Tensor value(DT_FLOAT, TensorShape({value_size}));
+  test::FillValues<float>(&value, std::vector<float>(value_size, 9.0));
+  auto storage_manager = new embedding::StorageManager<int64, float>(
+                 "EmbeddingVar", embedding::StorageConfig());
+  TF_CHECK_OK(storage_manager->Init());
+  EmbeddingVar<int64, float>* variable
+    = new EmbeddingVar<int64, float>("EmbeddingVar",
+        storage_manager, EmbeddingConfig(0, 0, 1, 1, "", 5));
+  variable->Init(value, 1);
+
+  Tensor part_offset_tensor(DT_INT32,  TensorShape({kSavedPartitionNum + 1}));
+  for (int64 i = 0; i < 5; i++) {
+    ValuePtr<float>* value_ptr = nullptr;
+    variable->LookupOrCreateKey(i, &value_ptr);
+    typename TTypes<float>::Flat vflat = variable->flat(value_ptr);
+  }
+
+  BundleWriter writer(Env::Default(), Prefix("foo"));
+  DumpEmbeddingValues(variable, "var/part_0", &writer, &part_offset_tensor);
+  TF_ASSERT_OK(writer.Finish());
+
+  BundleReader reader(Env::Default(), Prefix("foo"));
+  TF_ASSERT_OK(reader.status());
+
+  // Matching width passes.
+  TF_EXPECT_OK(EVValidateRestoreCompatibility(
+      variable, "var/part_0", &reader, "-keys", "-values"));
+
+  // A variable whose embedding dim changed must be rejected from the
+  // metadata alone.
+  Tensor wide_value(DT_FLOAT, TensorShape({value_size * 2}));
+  test::FillValues<float>(&wide_value,
+                          std::vector<float>(value_size * 2, 9.0));
+  auto wide_storage_manager = new embedding::StorageManager<int64, float>(
+                 "EmbeddingVarWide", embedding::StorageConfig());
+  TF_CHECK_OK(wide_storage_manager->Init());
+  EmbeddingVar<int64, float>* wide_variable
+    = new EmbeddingVar<int64, float>("EmbeddingVarWide",
+        wide_storage_manager, EmbeddingConfig(0, 0, 1, 1, "", 5));
+  wide_variable->Init(wide_value, 1);
+  Status s = EVValidateRestoreCompatibility(
+      wide_variable, "var/part_0", &reader, "-keys", "-values");
+  EXPECT_EQ(s.code(), error::INVALID_ARGUMENT);
+
+  // A name absent from the bundle must be rejected too.
+  s = EVValidateRestoreCompatibility(
+      variable, "missing_var/part_0", &reader, "-keys", "-values");
+  EXPECT_EQ(s.code(), error::INVALID_ARGUMENT);
+}
+
 TEST(EmbeddingVariableTest, TestEVExportLargeLockless) {
 
   int64 value_size = 128;
@@ -491,6 +552,53 @@ TEST(EmbeddingVariableTest, TestBloomFilter) {
 
 }
 
+TEST(EmbeddingVariableTest, TestAdaptiveDim) {
+  setenv("TF_EV_ADAPTIVE_DIM_SHORT_LEN", "4", 1);
+  setenv("TF_EV_ADAPTIVE_DIM_PROMOTE_FREQ", "6", 1);
+  int value_size = 16;
+  Tensor value(DT_FLOAT, TensorShape({value_size}));
+  test::FillValues<float>(&value, std::vector<float>(value_size, 10.0));
+
+  auto storage_manager = new embedding::StorageManager<int64, float>(
+                 "EmbeddingVar", embedding::StorageConfig());
+  TF_CHECK_OK(storage_manager->Init());
+  EmbeddingVar<int64, float>* var
+    = new EmbeddingVar<int64, float>("EmbeddingVar",
+        storage_manager,
+          EmbeddingConfig(0, 0, 1, 1, "", 0, 2));
+
+  var->Init(value, 1);
+  ASSERT_TRUE(var->IsAdaptiveDim());
+
+  float *val = (float *)malloc(value_size * sizeof(float));
+  // Two gathers admit the key (filter_freq = 2) into the short bucket:
+  // the stored prefix serves the first 4 elements, the rest is padding.
+  var->LookupOrCreate(1, val, nullptr);
+  var->LookupOrCreate(1, val, nullptr);
+  var->LookupOrCreate(1, val, nullptr);
+  for (int i = 0; i < 4; i++) ASSERT_EQ(val[i], 10.0);
+  for (int i = 4; i < value_size; i++) ASSERT_EQ(val[i], 0.0);
+
+  ValuePtr<float>* value_ptr = nullptr;
+  TF_CHECK_OK(var->LookupKey(1, &value_ptr));
+  ASSERT_NE(value_ptr->GetDimBucket(), 0);
+  ASSERT_EQ(var->EffectiveValueLen(value_ptr), 4);
+
+  // Four more gathers push the counter to the promotion frequency; the
+  // row is reallocated at full length with the initializer tail.
+  var->LookupOrCreate(1, val, nullptr);
+  var->LookupOrCreate(1, val, nullptr);
+  var->LookupOrCreate(1, val, nullptr);
+  var->LookupOrCreate(1, val, nullptr);
+  ASSERT_EQ(value_ptr->GetDimBucket(), 0);
+  ASSERT_EQ(var->EffectiveValueLen(value_ptr), value_size);
+  for (int i = 0; i < value_size; i++) ASSERT_EQ(val[i], 10.0);
+
+  free(val);
+  unsetenv("TF_EV_ADAPTIVE_DIM_SHORT_LEN");
+  unsetenv("TF_EV_ADAPTIVE_DIM_PROMOTE_FREQ");
+}
+
 TEST(EmbeddingVariableTest, TestBloomCounterInt64) {
   int value_size = 10;
   Tensor value(DT_FLOAT, TensorShape({value_size}));
@@ -958,6 +1066,181 @@ BENCHMARK(BM_HYBRID_LOCKLESS)
     ->Arg(8)
     ->Arg(16);
 
+// ---------------------------------------------------------------------------
+// EmbeddingVar microbenchmark suite.
+//
+// Drives lookup / insert / apply-style access against EmbeddingVar across
+// key distributions (uniform, zipf 0.9 / 1.2), value lengths, thread counts
+// and storage tiers (DRAM, DRAM+SSD), so tier configuration changes can be
+// evaluated offline instead of on a canary. Throughput is reported through
+// ItemsProcessed; the p99 latency of 512-key batches goes into the
+// benchmark label.
+
+enum BenchKeyDist { BENCH_UNIFORM = 0, BENCH_ZIPF09 = 1, BENCH_ZIPF12 = 2 };
+enum BenchMode { BENCH_LOOKUP = 0, BENCH_INSERT = 1, BENCH_APPLY = 2 };
+
+std::vector<int64> GenerateBenchKeys(int64 num_ops, int64 key_space,
+                                     int dist) {
+  std::vector<int64> keys(num_ops);
+  std::mt19937_64 gen(2027);
+  if (dist == BENCH_UNIFORM) {
+    for (int64 i = 0; i < num_ops; ++i) {
+      keys[i] = gen() % key_space;
+    }
+  } else {
+    // Inverse-CDF sampling of a bounded power law. Not an exact zipf pmf,
+    // but it reproduces the hot-key skew of production id streams well
+    // enough for tier sizing.
+    const double s = (dist == BENCH_ZIPF09) ? 0.9 : 1.2;
+    const double one_minus_s = 1.0 - s;
+    const double span =
+        std::pow(static_cast<double>(key_space), one_minus_s) - 1.0;
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    for (int64 i = 0; i < num_ops; ++i) {
+      double x = std::pow(uniform(gen) * span + 1.0, 1.0 / one_minus_s);
+      keys[i] = std::min(key_space - 1, static_cast<int64>(x));
+    }
+  }
+  return keys;
+}
+
+EmbeddingVar<int64, float>* CreateBenchEV(int64 value_size, bool use_ssd) {
+  Tensor value(DT_FLOAT, TensorShape({value_size}));
+  test::FillValues<float>(&value, std::vector<float>(value_size, 1.0));
+  embedding::StorageManager<int64, float>* storage_manager = nullptr;
+  EmbeddingVar<int64, float>* variable = nullptr;
+  if (use_ssd) {
+    // Keep the DRAM budget small so a part of the working set really
+    // lives on the SSD tier and promotions show up in the numbers.
+    std::vector<int64> size = {1 << 22, 1 << 30, 1 << 30, 1 << 30};
+    storage_manager = new embedding::StorageManager<int64, float>(
+        "EmbeddingVar",
+        embedding::StorageConfig(embedding::DRAM_SSDHASH, testing::TmpDir(),
+                                 size, "normal_contiguous"));
+    TF_CHECK_OK(storage_manager->Init());
+    variable = new EmbeddingVar<int64, float>("EmbeddingVar", storage_manager,
+        EmbeddingConfig(/*emb_index = */0, /*primary_emb_index = */0,
+                        /*block_num = */1, /*slot_num = */0,
+                        /*name = */"", /*steps_to_live = */0,
+                        /*filter_freq = */0, /*max_freq = */999999,
+                        /*l2_weight_threshold = */-1.0,
+                        /*layout = */"normal_contiguous"));
+  } else {
+    storage_manager = new embedding::StorageManager<int64, float>(
+        "EmbeddingVar", embedding::StorageConfig());
+    TF_CHECK_OK(storage_manager->Init());
+    variable = new EmbeddingVar<int64, float>("EmbeddingVar",
+        storage_manager);
+  }
+  variable->Init(value, 1);
+  return variable;
+}
+
+void BenchWorker(EmbeddingVar<int64, float>* variable, const int64* keys,
+                 int64 num_keys, int64 value_size, int mode,
+                 std::vector<double>* batch_latencies_ms) {
+  const int64 kBatch = 512;
+  float* val = (float*)malloc(sizeof(float) * (value_size + 1));
+  for (int64 start = 0; start < num_keys; start += kBatch) {
+    const int64 end = std::min(num_keys, start + kBatch);
+    const uint64 begin_us = Env::Default()->NowMicros();
+    for (int64 i = start; i < end; ++i) {
+      if (mode == BENCH_LOOKUP) {
+        variable->LookupOrCreate(keys[i], val, nullptr);
+      } else if (mode == BENCH_INSERT) {
+        ValuePtr<float>* value_ptr = nullptr;
+        variable->LookupOrCreateKey(keys[i], &value_ptr);
+      } else {
+        ValuePtr<float>* value_ptr = nullptr;
+        variable->LookupOrCreateKey(keys[i], &value_ptr);
+        typename TTypes<float>::Flat vflat = variable->flat(value_ptr);
+        vflat -= vflat.constant(0.05f);
+      }
+    }
+    batch_latencies_ms->push_back(
+        (Env::Default()->NowMicros() - begin_us) / 1000.0);
+  }
+  free(val);
+}
+
+void BM_EV_Access(int iters, int value_size, int thread_num, int dist,
+                  int mode, bool use_ssd) {
+  testing::StopTiming();
+  testing::UseRealTime();
+
+  const int64 num_ops = 1 << 20;
+  const int64 key_space = 1 << 20;
+  const int64 total_iters = iters;
+  std::vector<int64> keys = GenerateBenchKeys(num_ops, key_space, dist);
+  EmbeddingVar<int64, float>* variable = CreateBenchEV(value_size, use_ssd);
+
+  if (mode != BENCH_INSERT) {
+    // Preload the whole key space so steady-state access dominates over
+    // first-touch allocation.
+    float* val = (float*)malloc(sizeof(float) * (value_size + 1));
+    for (int64 i = 0; i < key_space; ++i) {
+      variable->LookupOrCreate(i, val, nullptr);
+    }
+    free(val);
+  }
+
+  std::vector<std::vector<double>> latencies(thread_num);
+  testing::StartTiming();
+  while (iters--) {
+    std::vector<std::thread> workers(thread_num);
+    for (int i = 0; i < thread_num; ++i) {
+      workers[i] = std::thread(BenchWorker, variable,
+          keys.data() + i * (num_ops / thread_num), num_ops / thread_num,
+          (int64)value_size, mode, &latencies[i]);
+    }
+    for (auto& t : workers) {
+      t.join();
+    }
+  }
+  testing::StopTiming();
+
+  std::vector<double> all_batches;
+  for (auto& per_thread : latencies) {
+    all_batches.insert(all_batches.end(), per_thread.begin(),
+                       per_thread.end());
+  }
+  double p99_ms = 0.0;
+  if (!all_batches.empty()) {
+    size_t idx = std::min(all_batches.size() - 1,
+                          static_cast<size_t>(all_batches.size() * 0.99));
+    std::nth_element(all_batches.begin(), all_batches.begin() + idx,
+                     all_batches.end());
+    p99_ms = all_batches[idx];
+  }
+  testing::SetLabel(strings::StrCat("p99_batch_ms=", p99_ms));
+  testing::ItemsProcessed(total_iters * num_ops);
+}
+
+// Each (distribution, mode, storage) combination gets its own BM_ entry;
+// ArgPair covers (value length, thread count).
+#define EV_ACCESS_BENCH(NAME, DIST, MODE, USE_SSD)                     \
+  void BM_##NAME(int iters, int value_size, int thread_num) {          \
+    BM_EV_Access(iters, value_size, thread_num, DIST, MODE, USE_SSD);  \
+  }                                                                    \
+  BENCHMARK(BM_##NAME)                                                 \
+      ->ArgPair(8, 4)                                                  \
+      ->ArgPair(32, 4)                                                 \
+      ->ArgPair(64, 1)                                                 \
+      ->ArgPair(64, 4)                                                 \
+      ->ArgPair(64, 16)                                                \
+      ->ArgPair(256, 4);
+
+EV_ACCESS_BENCH(EV_LOOKUP_UNIFORM_DRAM, BENCH_UNIFORM, BENCH_LOOKUP, false)
+EV_ACCESS_BENCH(EV_LOOKUP_ZIPF09_DRAM, BENCH_ZIPF09, BENCH_LOOKUP, false)
+EV_ACCESS_BENCH(EV_LOOKUP_ZIPF12_DRAM, BENCH_ZIPF12, BENCH_LOOKUP, false)
+EV_ACCESS_BENCH(EV_INSERT_UNIFORM_DRAM, BENCH_UNIFORM, BENCH_INSERT, false)
+EV_ACCESS_BENCH(EV_INSERT_ZIPF12_DRAM, BENCH_ZIPF12, BENCH_INSERT, false)
+EV_ACCESS_BENCH(EV_APPLY_ZIPF09_DRAM, BENCH_ZIPF09, BENCH_APPLY, false)
+EV_ACCESS_BENCH(EV_LOOKUP_UNIFORM_DRAM_SSD, BENCH_UNIFORM, BENCH_LOOKUP, true)
+EV_ACCESS_BENCH(EV_LOOKUP_ZIPF09_DRAM_SSD, BENCH_ZIPF09, BENCH_LOOKUP, true)
+EV_ACCESS_BENCH(EV_LOOKUP_ZIPF12_DRAM_SSD, BENCH_ZIPF12, BENCH_LOOKUP, true)
+
+#undef EV_ACCESS_BENCH
 
 TEST(EmbeddingVariableTest, TestAllocate) {
   int value_len = 8;
@@ -1003,6 +1286,48 @@ TEST(EmbeddingVariableTest, TestEVStorageType_DRAM) {
   LOG(INFO) << "size:" << variable->Size();
 }
 
+TEST(EmbeddingVariableTest, TestInlineValuePtr) {
+  float default_v[4] = {1.0, 2.0, 3.0, 4.0};
+  ValuePtr<float>* value_ptr = new InlineValuePtr<float>(ev_allocator(), 4);
+  float* val = value_ptr->GetOrAllocate(ev_allocator(), 4, default_v, 0, 0);
+  for (int i = 0; i < 4; i++) {
+    ASSERT_EQ(val[i], default_v[i]);
+  }
+  // The payload lives inside the ValuePtr object itself.
+  ASSERT_EQ((char*)value_ptr->GetPtr() + sizeof(FixedLengthHeader),
+            (char*)val);
+  ASSERT_EQ(value_ptr->GetValue(0, 0), val);
+  value_ptr->SetStep(7);
+  ASSERT_EQ(value_ptr->GetStep(), 7);
+  value_ptr->AddFreq();
+  value_ptr->AddFreq(2);
+  ASSERT_EQ(value_ptr->GetFreq(), 3);
+  value_ptr->Destroy(ev_allocator());
+  delete value_ptr;
+}
+
+TEST(EmbeddingVariableTest, TestCompactionSchedulerBudget) {
+  // A long idle threshold so the test never looks idle by accident.
+  setenv("TF_SSDHASH_COMPACTION_IDLE_MS", "60000", 1);
+  embedding::CompactionScheduler sched(testing::TmpDir());
+  // Over half the appends are garbage: emergency pass, always admitted.
+  ASSERT_TRUE(sched.Admit(10, 100));
+  // Within the 2x write-amplification budget.
+  sched.RecordUserWrite(1 << 20);
+  sched.RecordCompactionWrite(1 << 20);
+  ASSERT_TRUE(sched.Admit(90, 100));
+  // Over budget with recent user traffic: deferred.
+  sched.RecordCompactionWrite(4 << 20);
+  ASSERT_FALSE(sched.Admit(90, 100));
+  // An idle tier runs the deferred pass regardless of budget.
+  setenv("TF_SSDHASH_COMPACTION_IDLE_MS", "0", 1);
+  embedding::CompactionScheduler idle_sched(testing::TmpDir());
+  idle_sched.RecordUserWrite(1);
+  idle_sched.RecordCompactionWrite(100);
+  ASSERT_TRUE(idle_sched.Admit(90, 100));
+  unsetenv("TF_SSDHASH_COMPACTION_IDLE_MS");
+}
+
 void t1(KVInterface<int64, float>* hashmap) {
   for (int i = 0; i< 100; ++i) {
     hashmap->Insert(i, new NormalValuePtr<float>(ev_allocator(), 100));
@@ -1062,6 +1387,75 @@ TEST(EmbeddingVariableTest, TestBatchCommitofDBKV) {
   }
 }
 
+TEST(EmbeddingVariableTest, TestSpeculativeBatchGet) {
+  setenv("TF_EV_SPECULATIVE_GET", "1", 1);
+  int64 value_size = 4;
+  Tensor value(DT_FLOAT, TensorShape({value_size}));
+  test::FillValues<float>(&value, std::vector<float>(value_size, 9.0));
+  std::vector<int64> size;
+  size.emplace_back(1000);
+  auto storage_manager = new embedding::StorageManager<int64, float>(
+                 "EmbeddingVar", embedding::StorageConfig(embedding::LEVELDB, testing::TmpDir(), size, "normal_contiguous"));
+  TF_CHECK_OK(storage_manager->Init());
+  EmbeddingVar<int64, float>* variable
+    = new EmbeddingVar<int64, float>("EmbeddingVar",
+        storage_manager,
+          EmbeddingConfig(/*emb_index = */0, /*primary_emb_index = */0,
+                          /*block_num = */1, /*slot_num = */0,
+                          /*name = */"", /*steps_to_live = */0,
+                          /*filter_freq = */0, /*max_freq = */999999,
+                          /*l2_weight_threshold = */-1.0, /*layout = */"normal_contiguous",
+                          /*max_element_size = */0, /*false_positive_probability = */-1.0,
+                          /*counter_type = */DT_UINT64));
+  variable->Init(value, 1);
+
+  // Park keys 0..9 in the bottom tier only: the DRAM tier's BatchCommit
+  // is a no-op while LevelDB persists the rows.
+  std::vector<int64> key_list;
+  std::vector<ValuePtr<float>*> value_ptr_list;
+  for (int64 i = 0; i < 10; i++) {
+    key_list.emplace_back(i);
+    value_ptr_list.emplace_back(
+        new NormalContiguousValuePtr<float>(ev_allocator(), 4));
+  }
+  variable->BatchCommit(key_list, value_ptr_list);
+  ASSERT_FALSE(storage_manager->ShouldProbeSpeculatively());
+
+  // Drive the level-0 hit rate through the warm-up window with misses.
+  const size_t warmup = 1 << 14;
+  std::vector<int64> miss_keys(warmup);
+  for (size_t i = 0; i < warmup; ++i) {
+    miss_keys[i] = 1000000 + (int64)i;
+  }
+  std::vector<ValuePtr<float>*> miss_ptrs(warmup, nullptr);
+  TF_CHECK_OK(storage_manager->BatchGet(miss_keys.data(), warmup,
+                                        miss_ptrs.data()));
+  ASSERT_TRUE(storage_manager->ShouldProbeSpeculatively());
+
+  // This get takes the speculative branch: the bottom tier is probed on
+  // the thread pool while level 0 misses, and the bottom-tier results
+  // fill the empty slots.
+  int64 keys[4] = {0, 9, 2000000, 3};
+  ValuePtr<float>* got[4] = {nullptr, nullptr, nullptr, nullptr};
+  TF_CHECK_OK(storage_manager->BatchGet(keys, 4, got));
+  ASSERT_NE(got[0], nullptr);
+  ASSERT_NE(got[1], nullptr);
+  ASSERT_EQ(got[2], nullptr);
+  ASSERT_NE(got[3], nullptr);
+
+  // Aging: one all-hit batch crosses the stats window, the counters are
+  // halved and the mode switches off once level 0 is warm again.
+  ValuePtr<float>* vp = nullptr;
+  TF_CHECK_OK(storage_manager->GetOrCreate(100, &vp, 4));
+  const size_t window = 1 << 20;
+  std::vector<int64> hot_keys(window, 100);
+  std::vector<ValuePtr<float>*> hot_ptrs(window, nullptr);
+  TF_CHECK_OK(storage_manager->BatchGet(hot_keys.data(), window,
+                                        hot_ptrs.data()));
+  ASSERT_FALSE(storage_manager->ShouldProbeSpeculatively());
+  unsetenv("TF_EV_SPECULATIVE_GET");
+}
+
 void InsertAndCommit(KVInterface<int64, float>* hashmap) {
   for (int64 i = 0; i< 100; ++i) {
     const ValuePtr<float>* tmp= new NormalContiguousValuePtr<float>(ev_allocator(), 100);
@@ -1085,6 +1479,145 @@ TEST(EmbeddingVariableTest, TestSizeDBKV) {
   LOG(INFO) << "2 size:" << hashmap->Size();
 }
 
+TEST(EmbeddingVariableTest, TestBatchLookupLockless) {
+  KVInterface<int64, float>* hashmap = new LocklessHashMap<int64, float>();
+  for (int64 i = 0; i < 10; ++i) {
+    hashmap->Insert(i, new NormalValuePtr<float>(ev_allocator(), 100));
+  }
+  // Mixed batch: present keys interleaved with absent ones.
+  int64 keys[5] = {0, 100, 3, 200, 9};
+  ValuePtr<float>* value_ptrs[5];
+  TF_CHECK_OK(hashmap->BatchLookup(keys, 5, value_ptrs));
+  for (int i = 0; i < 5; ++i) {
+    ValuePtr<float>* expected = nullptr;
+    if (!hashmap->Lookup(keys[i], &expected).ok()) {
+      expected = nullptr;
+    }
+    // The lockless map hands out the stored pointer itself.
+    ASSERT_EQ(value_ptrs[i], expected);
+  }
+  ASSERT_EQ(value_ptrs[1], nullptr);
+  ASSERT_EQ(value_ptrs[3], nullptr);
+}
+
+TEST(EmbeddingVariableTest, TestBatchLookupLevelDBKV) {
+  KVInterface<int64, float>* hashmap = new LevelDBKV<int64, float>(testing::TmpDir());
+  hashmap->SetTotalDims(126);
+  for (int64 i = 0; i < 10; ++i) {
+    ValuePtr<float>* tmp = new NormalContiguousValuePtr<float>(ev_allocator(), 126);
+    tmp->SetValue((float)i, 126);
+    hashmap->Commit(i, tmp);
+  }
+  auto row = [](ValuePtr<float>* vp) {
+    return (float*)((char*)vp->GetPtr() + sizeof(FixedLengthHeader));
+  };
+  int64 keys[5] = {0, 100, 3, 200, 9};
+  ValuePtr<float>* value_ptrs[5];
+  TF_CHECK_OK(hashmap->BatchLookup(keys, 5, value_ptrs));
+  for (int i = 0; i < 5; ++i) {
+    ValuePtr<float>* expected = nullptr;
+    if (!hashmap->Lookup(keys[i], &expected).ok()) {
+      ASSERT_EQ(value_ptrs[i], nullptr);
+      continue;
+    }
+    // LevelDB decodes a fresh ValuePtr per probe; compare the rows.
+    ASSERT_NE(value_ptrs[i], nullptr);
+    for (int j = 0; j < 126; ++j) {
+      ASSERT_EQ(row(value_ptrs[i])[j], row(expected)[j]);
+      ASSERT_EQ(row(value_ptrs[i])[j], (float)keys[i]);
+    }
+  }
+}
+
+TEST(EmbeddingVariableTest, TestBatchLookupSSDKV) {
+  std::string temp_dir = testing::TmpDir();
+  Allocator* alloc = ev_allocator();
+  KVInterface<int64, float>* hashmap = new SSDHashKV<int64, float>(temp_dir, alloc);
+  hashmap->SetTotalDims(126);
+  for (int64 i = 0; i < 10; ++i) {
+    ValuePtr<float>* tmp = new NormalContiguousValuePtr<float>(alloc, 126);
+    tmp->SetValue((float)i, 126);
+    hashmap->Commit(i, tmp);
+  }
+  auto row = [](ValuePtr<float>* vp) {
+    return (float*)((char*)vp->GetPtr() + sizeof(FixedLengthHeader));
+  };
+  int64 keys[5] = {0, 100, 3, 200, 9};
+  ValuePtr<float>* value_ptrs[5];
+  TF_CHECK_OK(hashmap->BatchLookup(keys, 5, value_ptrs));
+  for (int i = 0; i < 5; ++i) {
+    ValuePtr<float>* expected = nullptr;
+    if (!hashmap->Lookup(keys[i], &expected).ok()) {
+      ASSERT_EQ(value_ptrs[i], nullptr);
+      continue;
+    }
+    ASSERT_NE(value_ptrs[i], nullptr);
+    for (int j = 0; j < 126; ++j) {
+      ASSERT_EQ(row(value_ptrs[i])[j], row(expected)[j]);
+      ASSERT_EQ(row(value_ptrs[i])[j], (float)keys[i]);
+    }
+  }
+}
+
+TEST(EmbeddingVariableTest, TestSSDBatchAIORead) {
+  setenv("TF_SSDHASH_BATCH_AIO_READ", "1", 1);
+  std::string temp_dir = io::JoinPath(testing::TmpDir(), "ssd_batch_aio");
+  TF_CHECK_OK(Env::Default()->RecursivelyCreateDir(temp_dir));
+  Allocator* alloc = ev_allocator();
+  KVInterface<int64, float>* hashmap = new SSDHashKV<int64, float>(temp_dir, alloc);
+  // Rows sized so the write buffer spills to disk after 31 commits:
+  // only flushed entries are served through the AIO submit/reap path.
+  const int dims = 1 << 20;
+  hashmap->SetTotalDims(dims);
+  for (int64 i = 0; i < 34; ++i) {
+    ValuePtr<float>* tmp = new NormalContiguousValuePtr<float>(alloc, dims);
+    tmp->SetValue((float)i, dims);
+    hashmap->Commit(i, tmp);
+    tmp->Destroy(alloc);
+    delete tmp;
+  }
+  auto row = [](ValuePtr<float>* vp) {
+    return (float*)((char*)vp->GetPtr() + sizeof(FixedLengthHeader));
+  };
+  // Keys 0..30 sit in the flushed value-log file, 31..33 are still in
+  // the write buffer, the rest miss.
+  int64 keys[6] = {0, 11, 30, 32, 100, 200};
+  ValuePtr<float>* value_ptrs[6];
+  TF_CHECK_OK(hashmap->BatchLookup(keys, 6, value_ptrs));
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_NE(value_ptrs[i], nullptr);
+    for (int j = 0; j < dims; j += 1013) {
+      ASSERT_EQ(row(value_ptrs[i])[j], (float)keys[i]);
+    }
+    value_ptrs[i]->Destroy(alloc);
+    delete value_ptrs[i];
+  }
+  ASSERT_EQ(value_ptrs[4], nullptr);
+  ASSERT_EQ(value_ptrs[5], nullptr);
+
+  // Error path: truncate the value log behind the open fds, so every
+  // batched read reaps short. The lookup must log-and-continue, not
+  // hang on the reap loop.
+  std::vector<std::string> children;
+  TF_CHECK_OK(Env::Default()->GetChildren(temp_dir, &children));
+  int truncated = 0;
+  for (const std::string& child : children) {
+    if (child.size() > 4 && child.substr(child.size() - 4) == ".emb") {
+      ASSERT_EQ(truncate(io::JoinPath(temp_dir, child).c_str(), 0), 0);
+      ++truncated;
+    }
+  }
+  ASSERT_GT(truncated, 0);
+  TF_CHECK_OK(hashmap->BatchLookup(keys, 6, value_ptrs));
+  for (int i = 0; i < 4; ++i) {
+    if (value_ptrs[i] != nullptr) {
+      value_ptrs[i]->Destroy(alloc);
+      delete value_ptrs[i];
+    }
+  }
+  unsetenv("TF_SSDHASH_BATCH_AIO_READ");
+}
+
 TEST(EmbeddingVariableTest, TestSSDIterator) {
   std::string temp_dir = testing::TmpDir();
   Allocator* alloc = ev_allocator();
@@ -1155,8 +1688,10 @@ TEST(EmbeddingVariableTest, TestLRUCache) {
   int64 size = cache->get_evic_ids(evict_ids, num_evict);
   ASSERT_EQ(size, num_ids);
   ASSERT_EQ(cache->size(), 0);
+  // All ids are evicted; get_evic_ids returns them as a sorted run
+  // (raw LRU order here would be 10..29,0..9).
   for (int i = 0; i < size; i++) {
-    ASSERT_EQ(evict_ids[i], (num_access % num_ids + i) % num_ids);
+    ASSERT_EQ(evict_ids[i], i);
   }
 }
 
@@ -1174,8 +1709,9 @@ TEST(EmbeddingVariableTest, TestLFUCache) {
   int64 size = cache->get_evic_ids(evict_ids, num_evict);
   ASSERT_EQ(size, num_ids);
   ASSERT_EQ(cache->size(), 0);
+  // Same sorted-run contract as TestLRUCache.
   for (int i = 0; i < size; i++) {
-    ASSERT_EQ(evict_ids[i], (num_access % num_ids + i) % num_ids);
+    ASSERT_EQ(evict_ids[i], i);
   }
 }
 
@@ -1515,8 +2051,177 @@ TEST(KVInterfaceTest, TestSSDKVCompaction) {
   }
 }
 
+TEST(GatherResultCacheTest, HitAfterInsert) {
+  GatherResultCache<int64, float> cache(64, 4, /*ttl_nanos=*/int64{1} << 60);
+  std::vector<float> row = {1.0f, 2.0f, 3.0f, 4.0f};
+  std::vector<float> out(4, 0.0f);
+  ASSERT_FALSE(cache.Lookup(42, out.data()));
+  cache.Insert(42, row.data());
+  ASSERT_TRUE(cache.Lookup(42, out.data()));
+  for (int i = 0; i < 4; i++) {
+    ASSERT_EQ(out[i], row[i]);
+  }
+  ASSERT_FALSE(cache.Lookup(43, out.data()));
+}
 
+TEST(GatherResultCacheTest, EpochBumpInvalidates) {
+  GatherResultCache<int64, float> cache(64, 4, /*ttl_nanos=*/int64{1} << 60);
+  std::vector<float> row = {1.0f, 2.0f, 3.0f, 4.0f};
+  std::vector<float> out(4, 0.0f);
+  cache.Insert(42, row.data());
+  ASSERT_TRUE(cache.Lookup(42, out.data()));
+  cache.BumpEpoch();
+  ASSERT_FALSE(cache.Lookup(42, out.data()));
+  // Re-inserting under the new epoch serves again.
+  cache.Insert(42, row.data());
+  ASSERT_TRUE(cache.Lookup(42, out.data()));
+}
 
+TEST(GatherResultCacheTest, TtlExpires) {
+  GatherResultCache<int64, float> cache(64, 4, /*ttl_nanos=*/1);
+  std::vector<float> row = {1.0f, 2.0f, 3.0f, 4.0f};
+  std::vector<float> out(4, 0.0f);
+  cache.Insert(42, row.data());
+  Env::Default()->SleepForMicroseconds(1000);
+  ASSERT_FALSE(cache.Lookup(42, out.data()));
+}
+
+TEST(ZstdDictCodecTest, RawRoundTripBeforeTraining) {
+  ZstdDictCodec codec;
+  std::vector<float> row(256);
+  for (int i = 0; i < 256; i++) row[i] = i * 0.5f;
+  std::string framed;
+  codec.Encode((char*)row.data(), row.size() * sizeof(float), &framed);
+  ASSERT_EQ(framed[0], ZstdDictCodec::kRawTag);
+  std::vector<float> decoded(256);
+  TF_ASSERT_OK(codec.Decode(framed.data(), framed.size(),
+                            (char*)decoded.data(),
+                            decoded.size() * sizeof(float)));
+  ASSERT_EQ(memcmp(row.data(), decoded.data(), row.size() * sizeof(float)),
+            0);
+}
+
+TEST(ZstdDictCodecTest, TrainedRoundTrip) {
+  ZstdDictCodec codec;
+  // Feed a corpus of similar rows until the dictionary trains.
+  const size_t row_floats = 1024;
+  std::vector<float> row(row_floats);
+  for (int s = 0; s < 1200 && !codec.trained(); s++) {
+    for (size_t i = 0; i < row_floats; i++) {
+      row[i] = (i % 16) * 0.25f + (s % 3);
+    }
+    codec.AddSample((char*)row.data(), row_floats * sizeof(float));
+  }
+  ASSERT_TRUE(codec.trained());
+  std::string framed;
+  codec.Encode((char*)row.data(), row_floats * sizeof(float), &framed);
+  ASSERT_EQ(framed[0], ZstdDictCodec::kZstdDictTag);
+  ASSERT_LT(framed.size(), row_floats * sizeof(float));
+  std::vector<float> decoded(row_floats);
+  TF_ASSERT_OK(codec.Decode(framed.data(), framed.size(),
+                            (char*)decoded.data(),
+                            decoded.size() * sizeof(float)));
+  ASSERT_EQ(
+      memcmp(row.data(), decoded.data(), row_floats * sizeof(float)), 0);
+}
+
+TEST(TableQosBucketTest, WithinBurstDoesNotWait) {
+  TableQosBucket bucket(1000.0, QosPriority::kLow);
+  const uint64 begin = Env::Default()->NowMicros();
+  // The bucket starts full with one second of rate.
+  bucket.Acquire(1000);
+  ASSERT_LT(Env::Default()->NowMicros() - begin, 100 * 1000);
+  ASSERT_EQ(bucket.QueueDepth(), 0);
+}
+
+TEST(TableQosBucketTest, LowPriorityWaitsForRefill) {
+  TableQosBucket bucket(10000.0, QosPriority::kLow);
+  bucket.Acquire(10000);
+  const uint64 begin = Env::Default()->NowMicros();
+  // The burst is drained, so another 1000 keys must wait for ~100ms of
+  // refill at 10000 keys/s.
+  bucket.Acquire(1000);
+  ASSERT_GE(Env::Default()->NowMicros() - begin, 50 * 1000);
+}
+
+TEST(TableQosBucketTest, HighPriorityNeverWaits) {
+  TableQosBucket bucket(10000.0, QosPriority::kHigh);
+  bucket.Acquire(10000);
+  const uint64 begin = Env::Default()->NowMicros();
+  bucket.Acquire(10000);
+  ASSERT_LT(Env::Default()->NowMicros() - begin, 100 * 1000);
+}
+
+TEST(TableHealthStatsTest, WindowAggregatesAndResets) {
+  TableHealthStats stats;
+  stats.RecordSampledUpdate(true, 2.0, 0.5);
+  stats.RecordSampledUpdate(true, 4.0, 0.25);
+  stats.RecordSampledUpdate(false, 0.0, 0.0);
+  ASSERT_TRUE(stats.ReportAndReset("var_health"));
+  // The window was consumed by the report.
+  ASSERT_FALSE(stats.ReportAndReset("var_health"));
+}
+
+TEST(TableHealthStatsTest, SamplesOneInInterval) {
+  int sampled = 0;
+  for (int i = 0; i < 2 * TableHealthStats::kSampleInterval; ++i) {
+    if (TableHealthStats::ShouldSample()) ++sampled;
+  }
+  // Stride sampling: at most one extra hit from the thread's initial
+  // countdown phase.
+  ASSERT_GE(sampled, 2);
+  ASSERT_LE(sampled, 3);
+}
+
+TEST(AdmissionThresholdTunerTest, RaisesThresholdOverBudget) {
+  // Budget of 100 keys at 100 bytes/row.
+  AdmissionThresholdTuner tuner(100 * 100, 1);
+  ASSERT_EQ(tuner.Threshold(), 1);
+  // A novelty spike: ~65k distinct keys observed once each, far over
+  // the 100-key budget, so the singleton bucket must be rejected.
+  for (int i = 0; i < (1 << 16); ++i) {
+    tuner.RecordObservation(1, 100);
+  }
+  ASSERT_GT(tuner.Threshold(), 1);
+}
+
+TEST(AdmissionThresholdTunerTest, StaysLowUnderBudget) {
+  AdmissionThresholdTuner tuner(1LL << 40, 16);
+  for (int i = 0; i < (1 << 16); ++i) {
+    tuner.RecordObservation(1, 100);
+  }
+  // Everything fits a huge budget: the tuner relaxes to admit all.
+  ASSERT_EQ(tuner.Threshold(), 1);
+}
+
+TEST(EmbeddingReadEpochTest, WriterDrainsActiveReader) {
+  EmbeddingReadEpoch* epoch = EmbeddingReadEpoch::GetInstance();
+  const int shard = epoch->EnterRead();
+  std::atomic<bool> update_done(false);
+  std::unique_ptr<Thread> writer(Env::Default()->StartThread(
+      ThreadOptions(), "ev_epoch_writer", [epoch, &update_done]() {
+        epoch->BeginUpdate("var_a");
+        update_done.store(true);
+        epoch->EndUpdate("var_a");
+      }));
+  // The writer must not get past the drain while the reader is in the
+  // epoch.
+  Env::Default()->SleepForMicroseconds(100 * 1000);
+  ASSERT_FALSE(update_done.load());
+  epoch->ExitRead(shard);
+  writer.reset();
+  ASSERT_TRUE(update_done.load());
+}
+
+TEST(EmbeddingReadEpochTest, VersionVectorBumpsPerUpdate) {
+  EmbeddingReadEpoch* epoch = EmbeddingReadEpoch::GetInstance();
+  const int64 before = epoch->TableVersion("var_b");
+  epoch->BeginUpdate("var_b");
+  // Odd while the import is applying.
+  ASSERT_EQ(epoch->TableVersion("var_b"), before + 1);
+  epoch->EndUpdate("var_b");
+  ASSERT_EQ(epoch->TableVersion("var_b"), before + 2);
+}
 
 } // namespace
 } // namespace embedding
@@ -0,0 +1,197 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_FROZEN_HASH_SEGMENT_H_
+#define TENSORFLOW_CORE_KERNELS_FROZEN_HASH_SEGMENT_H_
+
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+namespace lookup {
+
+// Hashes a value by its raw bytes. Only trivially copyable types have a
+// stable in-memory representation, so only those key/value types can be
+// fingerprinted and laid out in a shared segment.
+template <class T, bool = std::is_trivially_copyable<T>::value>
+struct RawBytesHash {
+  static constexpr bool kSupported = false;
+  static uint64 Run(const T& value, uint64 seed) { return 0; }
+};
+
+template <class T>
+struct RawBytesHash<T, true> {
+  static constexpr bool kSupported = true;
+  static uint64 Run(const T& value, uint64 seed) {
+    return Hash64(reinterpret_cast<const char*>(&value), sizeof(T), seed);
+  }
+};
+
+// Immutable open-addressing hash segment built once from a populated
+// static table. The whole segment is one contiguous allocation —
+// occupancy bytes, then keys, then values — so it has the layout of a
+// read-only mapped region, and lookups are a linear probe with no
+// per-node pointers. Every session in a DirectSessionGroup (and every
+// model version whose table fingerprints the same) attaches to the same
+// segment by shared_ptr instead of keeping a private unordered_map.
+template <class K, class V>
+class FrozenHashSegment {
+ public:
+  // Order-independent content fingerprint; includes the dtypes and the
+  // entry count so distinct table types never alias.
+  static uint64 Fingerprint(const std::unordered_map<K, V>& table) {
+    uint64 fp = Hash64Combine(DataTypeToEnum<K>::v(),
+                              Hash64Combine(DataTypeToEnum<V>::v(),
+                                            table.size()));
+    for (const auto& kv : table) {
+      fp += RawBytesHash<V>::Run(kv.second,
+                                 RawBytesHash<K>::Run(kv.first, 0x9E3779B9));
+    }
+    return fp;
+  }
+
+  static std::shared_ptr<FrozenHashSegment> Build(
+      const std::unordered_map<K, V>& table) {
+    // Half-full keeps linear probe runs short; the duplicate maps this
+    // replaces cost far more than the empty slots.
+    int64 buckets = 2;
+    while (buckets < static_cast<int64>(table.size()) * 2) {
+      buckets <<= 1;
+    }
+    std::shared_ptr<FrozenHashSegment> segment(new FrozenHashSegment(buckets));
+    for (const auto& kv : table) {
+      int64 i = RawBytesHash<K>::Run(kv.first, kProbeSeed) & segment->mask_;
+      while (segment->occupied_[i]) {
+        i = (i + 1) & segment->mask_;
+      }
+      segment->occupied_[i] = 1;
+      segment->keys_[i] = kv.first;
+      segment->values_[i] = kv.second;
+    }
+    segment->num_entries_ = table.size();
+    return segment;
+  }
+
+  bool Find(const K& key, V* value) const {
+    for (int64 i = RawBytesHash<K>::Run(key, kProbeSeed) & mask_;;
+         i = (i + 1) & mask_) {
+      if (!occupied_[i]) {
+        return false;
+      }
+      if (keys_[i] == key) {
+        *value = values_[i];
+        return true;
+      }
+    }
+  }
+
+  void ForEach(const std::function<void(const K&, const V&)>& fn) const {
+    for (int64 i = 0; i <= mask_; ++i) {
+      if (occupied_[i]) {
+        fn(keys_[i], values_[i]);
+      }
+    }
+  }
+
+  int64 size() const { return num_entries_; }
+
+  int64 MemoryUsed() const {
+    return (mask_ + 1) * (1 + sizeof(K) + sizeof(V));
+  }
+
+ private:
+  static constexpr uint64 kProbeSeed = 0xA5A5A5A5A5A5A5A5ull;
+
+  explicit FrozenHashSegment(int64 buckets) : mask_(buckets - 1) {
+    const int64 occupied_bytes = Align(buckets);
+    const int64 key_bytes = Align(buckets * sizeof(K));
+    buffer_.reset(new char[occupied_bytes + key_bytes +
+                           buckets * sizeof(V)]());
+    occupied_ = reinterpret_cast<uint8*>(buffer_.get());
+    keys_ = reinterpret_cast<K*>(buffer_.get() + occupied_bytes);
+    values_ = reinterpret_cast<V*>(buffer_.get() + occupied_bytes + key_bytes);
+  }
+
+  static int64 Align(int64 bytes) {
+    return (bytes + alignof(std::max_align_t) - 1) &
+           ~static_cast<int64>(alignof(std::max_align_t) - 1);
+  }
+
+  const int64 mask_;
+  int64 num_entries_ = 0;
+  std::unique_ptr<char[]> buffer_;
+  uint8* occupied_;
+  K* keys_;
+  V* values_;
+};
+
+// Process-wide registry of frozen segments keyed by content fingerprint.
+// Entries are held weakly: a segment lives exactly as long as some table
+// references it, so unloading the last model version that uses a
+// vocabulary frees it.
+class FrozenSegmentRegistry {
+ public:
+  static FrozenSegmentRegistry* Global() {
+    static FrozenSegmentRegistry* registry = new FrozenSegmentRegistry;
+    return registry;
+  }
+
+  // Sharing is opt-in; the fingerprint is content-derived, so enabling
+  // it assumes tables with equal contents are interchangeable.
+  static bool ShareEnabled() {
+    static bool enabled = []() {
+      bool value = false;
+      TF_CHECK_OK(ReadBoolFromEnvVar("TF_LOOKUP_SHARE_FROZEN_TABLES", false,
+                                     &value));
+      return value;
+    }();
+    return enabled;
+  }
+
+  template <class Segment>
+  std::shared_ptr<Segment> FindOrBuild(
+      uint64 fingerprint, const std::function<std::shared_ptr<Segment>()>&
+                              build) {
+    mutex_lock l(mu_);
+    auto it = segments_.find(fingerprint);
+    if (it != segments_.end()) {
+      if (auto held = it->second.lock()) {
+        return std::static_pointer_cast<Segment>(held);
+      }
+    }
+    std::shared_ptr<Segment> built = build();
+    segments_[fingerprint] = std::static_pointer_cast<void>(built);
+    return built;
+  }
+
+ private:
+  FrozenSegmentRegistry() = default;
+
+  mutex mu_;
+  std::unordered_map<uint64, std::weak_ptr<void>> segments_ GUARDED_BY(mu_);
+};
+
+}  // namespace lookup
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_FROZEN_HASH_SEGMENT_H_
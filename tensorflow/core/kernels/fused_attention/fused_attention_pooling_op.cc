@@ -0,0 +1,286 @@
+#define EIGEN_USE_THREADS
+
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/bounds_check.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace tensorflow {
+
+typedef Eigen::ThreadPoolDevice CPUDevice;
+
+namespace {
+
+// dot(a, b) over `dim` floats.
+template <typename T>
+inline T RowDot(const T* a, const T* b, int64 dim) {
+#if defined(__GNUC__) && (__GNUC__ > 6) && (__AVX512F__)
+  const int64 remainder = dim & 0x0F;
+  __m512 acc = _mm512_setzero_ps();
+  for (int64 d = 0; d < dim - remainder; d += 16) {
+    acc = _mm512_fmadd_ps(_mm512_loadu_ps(a + d), _mm512_loadu_ps(b + d), acc);
+  }
+  if (remainder) {
+    const __mmask16 mask = 0xFFFF >> (16 - remainder);
+    acc = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a + dim - remainder),
+                          _mm512_maskz_loadu_ps(mask, b + dim - remainder),
+                          acc);
+  }
+  return _mm512_reduce_add_ps(acc);
+#else
+  T dot = 0;
+  for (int64 d = 0; d < dim; ++d) {
+    dot += a[d] * b[d];
+  }
+  return dot;
+#endif
+}
+
+// out += coeff * a over `dim` floats.
+template <typename T>
+inline void RowAxpy(T coeff, const T* a, T* out, int64 dim) {
+#if defined(__GNUC__) && (__GNUC__ > 6) && (__AVX512F__)
+  const int64 remainder = dim & 0x0F;
+  const __m512 c = _mm512_set1_ps(coeff);
+  for (int64 d = 0; d < dim - remainder; d += 16) {
+    _mm512_storeu_ps(out + d, _mm512_fmadd_ps(c, _mm512_loadu_ps(a + d),
+                                              _mm512_loadu_ps(out + d)));
+  }
+  if (remainder) {
+    const __mmask16 mask = 0xFFFF >> (16 - remainder);
+    const int64 d = dim - remainder;
+    _mm512_mask_storeu_ps(
+        out + d, mask,
+        _mm512_fmadd_ps(c, _mm512_maskz_loadu_ps(mask, a + d),
+                        _mm512_maskz_loadu_ps(mask, out + d)));
+  }
+#else
+  for (int64 d = 0; d < dim; ++d) {
+    out[d] += coeff * a[d];
+  }
+#endif
+}
+
+}  // namespace
+
+// One-pass dot-product attention pooling over a padded key sequence:
+// scores from query . keys, numerically stable softmax over the first
+// seq_len[b] steps, and the weighted sum of the keys, without materializing
+// the tiled query or the masked score paddings. Rows with seq_len <= 0 pool
+// to zero. The attention weights are a second output consumed by the
+// gradient kernel so the softmax is not recomputed backwards.
+template <typename T, typename Tlen>
+class FusedAttentionPoolingOp : public OpKernel {
+public:
+  explicit FusedAttentionPoolingOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("scale", &scale_));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor* query_tensor = &context->input(0);
+    const Tensor* keys_tensor = &context->input(1);
+    const Tensor* seq_len_tensor = &context->input(2);
+    OP_REQUIRES(context, query_tensor->dims() == 2,
+                errors::InvalidArgument("query must be 2-D [batch, dim], got ",
+                                        query_tensor->shape().DebugString()));
+    OP_REQUIRES(context, keys_tensor->dims() == 3,
+                errors::InvalidArgument(
+                    "keys must be 3-D [batch, seq, dim], got ",
+                    keys_tensor->shape().DebugString()));
+    const int64 batch = keys_tensor->dim_size(0);
+    const int64 seq = keys_tensor->dim_size(1);
+    const int64 dim = keys_tensor->dim_size(2);
+    OP_REQUIRES(context,
+                query_tensor->dim_size(0) == batch &&
+                    query_tensor->dim_size(1) == dim &&
+                    seq_len_tensor->NumElements() == batch,
+                errors::InvalidArgument(
+                    "query/keys/seq_len batch or dim mismatch: ",
+                    query_tensor->shape().DebugString(), " vs ",
+                    keys_tensor->shape().DebugString(), " vs ",
+                    seq_len_tensor->shape().DebugString()));
+    const T* query = query_tensor->flat<T>().data();
+    const T* keys = keys_tensor->flat<T>().data();
+    const Tlen* seq_len = seq_len_tensor->flat<Tlen>().data();
+
+    Tensor* pooled_tensor = nullptr;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(0, TensorShape({batch, dim}),
+                                            &pooled_tensor));
+    Tensor* alphas_tensor = nullptr;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(1, TensorShape({batch, seq}),
+                                            &alphas_tensor));
+    T* pooled = pooled_tensor->flat<T>().data();
+    T* alphas = alphas_tensor->flat<T>().data();
+    if (batch == 0) return;
+
+    const float scale = scale_;
+    const int64 unit_cost = seq * dim * 4;
+    auto& worker_threads = *(context->device()->tensorflow_cpu_worker_threads());
+    thread::ThreadPool* thread_pool = worker_threads.workers;
+
+    thread_pool->ParallelFor(batch, unit_cost,
+        [query, keys, seq_len, pooled, alphas, seq, dim, scale](
+            int64 begin_batch, int64 end_batch) {
+          for (int64 b = begin_batch; b < end_batch; ++b) {
+            const T* q = query + b * dim;
+            const T* k = keys + b * seq * dim;
+            T* out = pooled + b * dim;
+            T* alpha = alphas + b * seq;
+            int64 valid = static_cast<int64>(seq_len[b]);
+            if (valid > seq) valid = seq;
+            memset(out, 0, dim * sizeof(T));
+            memset(alpha, 0, seq * sizeof(T));
+            if (valid <= 0) continue;
+
+            // Scores over the valid steps, tracking the max for a stable
+            // softmax; the padded steps never enter the sum, which is the
+            // masked-softmax the unfused graph built with tf.where.
+            T max_score = -std::numeric_limits<T>::infinity();
+            for (int64 t = 0; t < valid; ++t) {
+              alpha[t] = scale * RowDot(q, k + t * dim, dim);
+              if (alpha[t] > max_score) max_score = alpha[t];
+            }
+            T sum = 0;
+            for (int64 t = 0; t < valid; ++t) {
+              alpha[t] = std::exp(alpha[t] - max_score);
+              sum += alpha[t];
+            }
+            const T inv_sum = T(1) / sum;
+            for (int64 t = 0; t < valid; ++t) {
+              alpha[t] *= inv_sum;
+              RowAxpy(alpha[t], k + t * dim, out, dim);
+            }
+          }
+        });
+  }
+
+private:
+  float scale_;
+};
+
+#define REGISTER_FUSED_ATTENTION_POOLING(Tlen)                  \
+  REGISTER_KERNEL_BUILDER(Name("FusedAttentionPooling")         \
+                              .Device(DEVICE_CPU)               \
+                              .TypeConstraint<float>("T")       \
+                              .TypeConstraint<Tlen>("Tlen"),    \
+                          FusedAttentionPoolingOp<float, Tlen>);
+REGISTER_FUSED_ATTENTION_POOLING(int32);
+REGISTER_FUSED_ATTENTION_POOLING(int64);
+#undef REGISTER_FUSED_ATTENTION_POOLING
+
+// With s_t = scale * dot(q, k_t), a = softmax(s) over the valid steps and
+// pooled = sum_t a_t k_t, the incoming gradient g gives
+//   da_t = dot(g, k_t)
+//   ds_t = a_t * (da_t - sum_u a_u da_u)
+//   dq   = scale * sum_t ds_t k_t
+//   dk_t = a_t g + scale * ds_t q
+// and zero for the padded steps. alphas from the forward pass make this a
+// single sweep over the valid keys.
+template <typename T, typename Tlen>
+class FusedAttentionPoolingGradOp : public OpKernel {
+public:
+  explicit FusedAttentionPoolingGradOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("scale", &scale_));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor* grad_tensor = &context->input(0);
+    const Tensor* query_tensor = &context->input(1);
+    const Tensor* keys_tensor = &context->input(2);
+    const Tensor* seq_len_tensor = &context->input(3);
+    const Tensor* alphas_tensor = &context->input(4);
+    OP_REQUIRES(context, keys_tensor->dims() == 3,
+                errors::InvalidArgument(
+                    "keys must be 3-D [batch, seq, dim], got ",
+                    keys_tensor->shape().DebugString()));
+    const int64 batch = keys_tensor->dim_size(0);
+    const int64 seq = keys_tensor->dim_size(1);
+    const int64 dim = keys_tensor->dim_size(2);
+    OP_REQUIRES(context,
+                grad_tensor->NumElements() == batch * dim &&
+                    query_tensor->NumElements() == batch * dim &&
+                    seq_len_tensor->NumElements() == batch &&
+                    alphas_tensor->NumElements() == batch * seq,
+                errors::InvalidArgument(
+                    "pooled_grad/query/seq_len/alphas do not match keys shape ",
+                    keys_tensor->shape().DebugString()));
+    const T* grad = grad_tensor->flat<T>().data();
+    const T* query = query_tensor->flat<T>().data();
+    const T* keys = keys_tensor->flat<T>().data();
+    const Tlen* seq_len = seq_len_tensor->flat<Tlen>().data();
+    const T* alphas = alphas_tensor->flat<T>().data();
+
+    Tensor* query_grad_tensor = nullptr;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(0, query_tensor->shape(),
+                                            &query_grad_tensor));
+    Tensor* keys_grad_tensor = nullptr;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(1, keys_tensor->shape(),
+                                            &keys_grad_tensor));
+    T* query_grad = query_grad_tensor->flat<T>().data();
+    T* keys_grad = keys_grad_tensor->flat<T>().data();
+    if (batch == 0) return;
+
+    const float scale = scale_;
+    const int64 unit_cost = seq * dim * 8;
+    auto& worker_threads = *(context->device()->tensorflow_cpu_worker_threads());
+    thread::ThreadPool* thread_pool = worker_threads.workers;
+
+    thread_pool->ParallelFor(batch, unit_cost,
+        [grad, query, keys, seq_len, alphas, query_grad, keys_grad, seq, dim,
+         scale](int64 begin_batch, int64 end_batch) {
+          std::vector<T> ds(seq);
+          for (int64 b = begin_batch; b < end_batch; ++b) {
+            const T* g = grad + b * dim;
+            const T* q = query + b * dim;
+            const T* k = keys + b * seq * dim;
+            const T* alpha = alphas + b * seq;
+            T* q_grad = query_grad + b * dim;
+            T* k_grad = keys_grad + b * seq * dim;
+            int64 valid = static_cast<int64>(seq_len[b]);
+            if (valid > seq) valid = seq;
+            memset(q_grad, 0, dim * sizeof(T));
+            memset(k_grad, 0, seq * dim * sizeof(T));
+            if (valid <= 0) continue;
+
+            T weighted_sum = 0;
+            for (int64 t = 0; t < valid; ++t) {
+              ds[t] = RowDot(g, k + t * dim, dim);
+              weighted_sum += alpha[t] * ds[t];
+            }
+            for (int64 t = 0; t < valid; ++t) {
+              ds[t] = alpha[t] * (ds[t] - weighted_sum);
+              RowAxpy(scale * ds[t], k + t * dim, q_grad, dim);
+              T* k_grad_t = k_grad + t * dim;
+              RowAxpy(alpha[t], g, k_grad_t, dim);
+              RowAxpy(scale * ds[t], q, k_grad_t, dim);
+            }
+          }
+        });
+  }
+
+private:
+  float scale_;
+};
+
+#define REGISTER_FUSED_ATTENTION_POOLING_GRAD(Tlen)             \
+  REGISTER_KERNEL_BUILDER(Name("FusedAttentionPoolingGrad")     \
+                              .Device(DEVICE_CPU)               \
+                              .TypeConstraint<float>("T")       \
+                              .TypeConstraint<Tlen>("Tlen"),    \
+                          FusedAttentionPoolingGradOp<float, Tlen>);
+REGISTER_FUSED_ATTENTION_POOLING_GRAD(int32);
+REGISTER_FUSED_ATTENTION_POOLING_GRAD(int64);
+#undef REGISTER_FUSED_ATTENTION_POOLING_GRAD
+
+}  // namespace tensorflow
@@ -0,0 +1,267 @@
+#include <cmath>
+
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/kernels/ops_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/public/session.h"
+#include "tensorflow/cc/ops/standard_ops.h"
+
+namespace tensorflow {
+namespace {
+
+class FusedAttentionPoolingOpTest : public OpsTestBase {
+ protected:
+  void MakeOp(float scale) {
+    TF_EXPECT_OK(NodeDefBuilder("fused_attention_pooling",
+                                "FusedAttentionPooling")
+                     .Attr("T", DT_FLOAT)
+                     .Attr("Tlen", DT_INT32)
+                     .Attr("scale", scale)
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_INT32))
+                     .Finalize(node_def()));
+    TF_EXPECT_OK(InitOp());
+  }
+};
+
+TEST_F(FusedAttentionPoolingOpTest, MaskedSoftmaxPooling_Float) {
+  const int batch = 3;
+  const int seq = 4;
+  const int dim = 17;  // exercise the 16-wide remainder path
+  const float scale = 0.5f;
+
+  MakeOp(scale);
+
+  float query_array[batch * dim];
+  for (int i = 0; i < batch * dim; i++) {
+    query_array[i] = 0.125f * ((i * 5) % 9) - 0.5f;
+  }
+  float keys_array[batch * seq * dim];
+  for (int i = 0; i < batch * seq * dim; i++) {
+    keys_array[i] = 0.25f * ((i * 7) % 11) - 1.0f;
+  }
+  // One fully valid row, one partially padded row, one empty row.
+  int seq_len_array[batch] = {4, 2, 0};
+
+  AddInputFromArray<float>(TensorShape({batch, dim}), query_array);
+  AddInputFromArray<float>(TensorShape({batch, seq, dim}), keys_array);
+  AddInputFromArray<int32>(TensorShape({batch}), seq_len_array);
+
+  TF_ASSERT_OK(RunOpKernel());
+  TF_EXPECT_OK(device_->Sync());
+
+  float alpha_array[batch * seq];
+  float pooled_array[batch * dim];
+  for (int b = 0; b < batch; b++) {
+    int valid = seq_len_array[b];
+    float max_score = -1e30f;
+    for (int t = 0; t < valid; t++) {
+      float dot = 0.0f;
+      for (int d = 0; d < dim; d++) {
+        dot += query_array[b * dim + d] * keys_array[(b * seq + t) * dim + d];
+      }
+      alpha_array[b * seq + t] = scale * dot;
+      max_score = std::max(max_score, alpha_array[b * seq + t]);
+    }
+    float sum = 0.0f;
+    for (int t = 0; t < valid; t++) {
+      alpha_array[b * seq + t] = std::exp(alpha_array[b * seq + t] - max_score);
+      sum += alpha_array[b * seq + t];
+    }
+    for (int t = valid; t < seq; t++) {
+      alpha_array[b * seq + t] = 0.0f;
+    }
+    for (int d = 0; d < dim; d++) {
+      pooled_array[b * dim + d] = 0.0f;
+    }
+    for (int t = 0; t < valid; t++) {
+      alpha_array[b * seq + t] /= sum;
+      for (int d = 0; d < dim; d++) {
+        pooled_array[b * dim + d] +=
+            alpha_array[b * seq + t] * keys_array[(b * seq + t) * dim + d];
+      }
+    }
+  }
+
+  Tensor expected_pooled(allocator(), DT_FLOAT, TensorShape({batch, dim}));
+  test::FillValues<float>(&expected_pooled, pooled_array);
+  test::ExpectTensorNear<float>(expected_pooled, *GetOutput(0), 1e-5);
+
+  Tensor expected_alphas(allocator(), DT_FLOAT, TensorShape({batch, seq}));
+  test::FillValues<float>(&expected_alphas, alpha_array);
+  test::ExpectTensorNear<float>(expected_alphas, *GetOutput(1), 1e-5);
+}
+
+class FusedAttentionPoolingGradOpTest : public OpsTestBase {
+ protected:
+  void MakeOp(float scale) {
+    TF_EXPECT_OK(NodeDefBuilder("fused_attention_pooling_grad",
+                                "FusedAttentionPoolingGrad")
+                     .Attr("T", DT_FLOAT)
+                     .Attr("Tlen", DT_INT32)
+                     .Attr("scale", scale)
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_INT32))
+                     .Input(FakeInput(DT_FLOAT))
+                     .Finalize(node_def()));
+    TF_EXPECT_OK(InitOp());
+  }
+};
+
+TEST_F(FusedAttentionPoolingGradOpTest, MatchesSoftmaxChainRule_Float) {
+  const int batch = 2;
+  const int seq = 3;
+  const int dim = 5;
+  const float scale = 1.0f;
+
+  MakeOp(scale);
+
+  float grad_array[batch * dim];
+  for (int i = 0; i < batch * dim; i++) {
+    grad_array[i] = 0.5f * ((i % 4) - 1);
+  }
+  float query_array[batch * dim];
+  for (int i = 0; i < batch * dim; i++) {
+    query_array[i] = 0.25f * ((i * 3) % 7) - 0.75f;
+  }
+  float keys_array[batch * seq * dim];
+  for (int i = 0; i < batch * seq * dim; i++) {
+    keys_array[i] = 0.125f * ((i * 5) % 13) - 0.5f;
+  }
+  int seq_len_array[batch] = {3, 2};
+
+  // Forward reference to obtain the alphas the grad kernel consumes.
+  float alpha_array[batch * seq];
+  for (int b = 0; b < batch; b++) {
+    int valid = seq_len_array[b];
+    float max_score = -1e30f;
+    for (int t = 0; t < valid; t++) {
+      float dot = 0.0f;
+      for (int d = 0; d < dim; d++) {
+        dot += query_array[b * dim + d] * keys_array[(b * seq + t) * dim + d];
+      }
+      alpha_array[b * seq + t] = scale * dot;
+      max_score = std::max(max_score, alpha_array[b * seq + t]);
+    }
+    float sum = 0.0f;
+    for (int t = 0; t < valid; t++) {
+      alpha_array[b * seq + t] = std::exp(alpha_array[b * seq + t] - max_score);
+      sum += alpha_array[b * seq + t];
+    }
+    for (int t = 0; t < valid; t++) {
+      alpha_array[b * seq + t] /= sum;
+    }
+    for (int t = valid; t < seq; t++) {
+      alpha_array[b * seq + t] = 0.0f;
+    }
+  }
+
+  AddInputFromArray<float>(TensorShape({batch, dim}), grad_array);
+  AddInputFromArray<float>(TensorShape({batch, dim}), query_array);
+  AddInputFromArray<float>(TensorShape({batch, seq, dim}), keys_array);
+  AddInputFromArray<int32>(TensorShape({batch}), seq_len_array);
+  AddInputFromArray<float>(TensorShape({batch, seq}), alpha_array);
+
+  TF_ASSERT_OK(RunOpKernel());
+  TF_EXPECT_OK(device_->Sync());
+
+  float query_grad_array[batch * dim];
+  float keys_grad_array[batch * seq * dim];
+  for (int i = 0; i < batch * dim; i++) query_grad_array[i] = 0.0f;
+  for (int i = 0; i < batch * seq * dim; i++) keys_grad_array[i] = 0.0f;
+  for (int b = 0; b < batch; b++) {
+    int valid = seq_len_array[b];
+    float ds[seq];
+    float weighted_sum = 0.0f;
+    for (int t = 0; t < valid; t++) {
+      float dot = 0.0f;
+      for (int d = 0; d < dim; d++) {
+        dot += grad_array[b * dim + d] * keys_array[(b * seq + t) * dim + d];
+      }
+      ds[t] = dot;
+      weighted_sum += alpha_array[b * seq + t] * dot;
+    }
+    for (int t = 0; t < valid; t++) {
+      ds[t] = alpha_array[b * seq + t] * (ds[t] - weighted_sum);
+      for (int d = 0; d < dim; d++) {
+        query_grad_array[b * dim + d] +=
+            scale * ds[t] * keys_array[(b * seq + t) * dim + d];
+        keys_grad_array[(b * seq + t) * dim + d] +=
+            alpha_array[b * seq + t] * grad_array[b * dim + d] +
+            scale * ds[t] * query_array[b * dim + d];
+      }
+    }
+  }
+
+  Tensor expected_query_grad(allocator(), DT_FLOAT, TensorShape({batch, dim}));
+  test::FillValues<float>(&expected_query_grad, query_grad_array);
+  test::ExpectTensorNear<float>(expected_query_grad, *GetOutput(0), 1e-5);
+
+  Tensor expected_keys_grad(allocator(), DT_FLOAT,
+                            TensorShape({batch, seq, dim}));
+  test::FillValues<float>(&expected_keys_grad, keys_grad_array);
+  test::ExpectTensorNear<float>(expected_keys_grad, *GetOutput(1), 1e-5);
+}
+
+//----------------------------------------------------------------------------//
+// Performance benchmarks                                                     //
+//----------------------------------------------------------------------------//
+static Graph* FusedAttentionPooling(int batch, int seq, int dim) {
+  Graph* g = new Graph(OpRegistry::Global());
+  DataType dtype = DT_FLOAT;
+
+  Tensor query(dtype, TensorShape({batch, dim}));
+  query.flat<float>().setRandom();
+  Tensor keys(dtype, TensorShape({batch, seq, dim}));
+  keys.flat<float>().setRandom();
+  Tensor seq_len(DT_INT32, TensorShape({batch}));
+  for (int b = 0; b < batch; b++) {
+    seq_len.flat<int32>()(b) = seq;
+  }
+
+  Node* query_in = test::graph::Constant(g, query);
+  Node* keys_in = test::graph::Constant(g, keys);
+  Node* seq_len_in = test::graph::Constant(g, seq_len);
+  auto nodeBuilder = NodeBuilder(g->NewName("n"), "FusedAttentionPooling")
+                    .Input(query_in)
+                    .Input(keys_in)
+                    .Input(seq_len_in)
+                    .Attr("T", dtype)
+                    .Attr("Tlen", DT_INT32)
+                    .Attr("scale", 1.0f);
+  TF_CHECK_OK(nodeBuilder.Finalize(g, nullptr));
+
+  return g;
+}
+
+#define BM_FusedAttentionPooling(BATCH, SEQ, DIM, NTH)                          \
+  static void BM_FusedAttentionPooling##_##BATCH##_##SEQ##_##DIM##_##NTH##_CPU( \
+  int iters) {                                                                  \
+  testing::UseRealTime();                                                       \
+  testing::ItemsProcessed(static_cast<int64>(iters) * BATCH * SEQ * DIM * 2);   \
+  SessionOptions opts;                                                          \
+  opts.config.set_intra_op_parallelism_threads(NTH);                            \
+  test::Benchmark("cpu", FusedAttentionPooling(BATCH, SEQ, DIM),                \
+                  &opts).Run(iters);                                            \
+  }                                                                             \
+  BENCHMARK(BM_FusedAttentionPooling##_##BATCH##_##SEQ##_##DIM##_##NTH##_CPU);  \
+
+#define BM_FusedAttentionPooling_NTH(BATCH, SEQ, DIM)  \
+  BM_FusedAttentionPooling(BATCH, SEQ, DIM, 1);        \
+  BM_FusedAttentionPooling(BATCH, SEQ, DIM, 4);        \
+  BM_FusedAttentionPooling(BATCH, SEQ, DIM, 8);        \
+
+BM_FusedAttentionPooling_NTH(512, 50, 36);
+BM_FusedAttentionPooling_NTH(512, 200, 36);
+BM_FusedAttentionPooling_NTH(2048, 50, 36);
+}
+}
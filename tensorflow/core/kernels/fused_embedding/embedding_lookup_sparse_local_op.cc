@@ -15,11 +15,43 @@ namespace {
     // input: input tensor value (it sores the id)
     // cols: How many elements to do SparseSegmentSum
     // output: rows * embedding_size
-    template<typename T>
-    static void sparse_gather_v1(T *input, int rows, int cols, 
+    // A non-zero SPEC_SIZE bakes the embedding value length into the
+    // instantiation (see the dispatch in sparse_gather): the accumulator
+    // fits in registers and the per-value loops fully unroll and vectorize.
+    template<typename T, int64 SPEC_SIZE = 0>
+    static void sparse_gather_v1(T *input, int rows, int cols,
                                 float *embedding_table, float *output,
                                 int embedding_size, bool is_mean) {
     T *pidx = input;
+    if (SPEC_SIZE != 0) {
+        for (int i = 0; i < rows; ++i) {
+        float value[SPEC_SIZE != 0 ? SPEC_SIZE : 1] = {0};
+        int dense_num = 0;
+        for (int k = 0; k < cols; ++k) {
+            int embedding_row = (int)pidx[k];
+            if (embedding_row >= 0) {
+            // Same per-element summation order as the generic loop below,
+            // just walking the table row contiguously.
+            float *pembedding = &embedding_table[embedding_row * SPEC_SIZE];
+            for (int64 j = 0; j < SPEC_SIZE; ++j) {
+                value[j] += pembedding[j];
+            }
+            dense_num += 1;
+            }
+        }
+        if (is_mean && dense_num > 0) {
+            for (int64 j = 0; j < SPEC_SIZE; ++j) {
+            *output++ = value[j] / dense_num;
+            }
+        } else {
+            for (int64 j = 0; j < SPEC_SIZE; ++j) {
+            *output++ = value[j];
+            }
+        }
+        pidx += cols;
+        }
+        return;
+    }
     for (int i = 0; i < rows; ++i) {
         for (int j = 0; j < embedding_size; ++j) {
         float value = 0;
@@ -68,9 +100,13 @@ namespace {
     }
 
     // input cols = 1
-    template<typename T>
-    static void sparse_gather_column1(T *input, int rows, float *embedding_table, 
+    // A non-zero SPEC_SIZE turns the copy loops into constant-length ones.
+    template<typename T, int64 SPEC_SIZE = 0>
+    static void sparse_gather_column1(T *input, int rows, float *embedding_table,
                             float *output, int embedding_size) {
+    if (SPEC_SIZE != 0) {
+        embedding_size = SPEC_SIZE;
+    }
     T *pidx = input;
     for (int i = 0; i < rows; ++i) {
         int embedding_row = *pidx++;
@@ -95,11 +131,31 @@ namespace {
         sparse_gather_embeddingsize1(input, rows, cols, embedding_table, output,
                                     is_mean);
     } else if (cols == 1) {
-        sparse_gather_column1(input, rows, embedding_table, output, embedding_size);
+        // Serving traffic concentrates on a few embedding dimensions, so the
+        // hot value lengths dispatch to shape-specialized instantiations
+        // where the trip counts are compile-time constants; other shapes
+        // fall back to the generic variant.
+        auto gather_fn = &sparse_gather_column1<T>;
+        switch (embedding_size) {
+          case 8: gather_fn = &sparse_gather_column1<T, 8>; break;
+          case 16: gather_fn = &sparse_gather_column1<T, 16>; break;
+          case 32: gather_fn = &sparse_gather_column1<T, 32>; break;
+          case 64: gather_fn = &sparse_gather_column1<T, 64>; break;
+          case 128: gather_fn = &sparse_gather_column1<T, 128>; break;
+        }
+        gather_fn(input, rows, embedding_table, output, embedding_size);
     } else {
         //printf("General sparse gather!\n");
-        sparse_gather_v1(input, rows, cols, embedding_table, output, embedding_size, 
-                        is_mean);
+        auto gather_fn = &sparse_gather_v1<T>;
+        switch (embedding_size) {
+          case 8: gather_fn = &sparse_gather_v1<T, 8>; break;
+          case 16: gather_fn = &sparse_gather_v1<T, 16>; break;
+          case 32: gather_fn = &sparse_gather_v1<T, 32>; break;
+          case 64: gather_fn = &sparse_gather_v1<T, 64>; break;
+          case 128: gather_fn = &sparse_gather_v1<T, 128>; break;
+        }
+        gather_fn(input, rows, cols, embedding_table, output, embedding_size,
+                  is_mean);
     }
     }
 
@@ -132,8 +188,14 @@ namespace {
       }
     }
 
-    template<typename T>
+    // row_nums is the embedding value length; a non-zero SPEC_ROWS makes it
+    // a compile-time constant so the per-value loops fully unroll (see the
+    // dispatch in sparse_gather).
+    template<typename T, int64 SPEC_ROWS = 0>
     static void row_add_mean(std::map<T *, std::vector<T *>> &mapSet, int64 row_nums, bool is_mean) {
+    if (SPEC_ROWS != 0) {
+      row_nums = SPEC_ROWS;
+    }
 
 #define L(n) srcs[index + n][row]
 
@@ -247,7 +309,15 @@ namespace {
       }
 
       // row_add(mapSet, embedding_size);
-      row_add_mean(mapSet, embedding_size, is_mean);
+      auto combine_fn = &row_add_mean<float>;
+      switch (embedding_size) {
+        case 8: combine_fn = &row_add_mean<float, 8>; break;
+        case 16: combine_fn = &row_add_mean<float, 16>; break;
+        case 32: combine_fn = &row_add_mean<float, 32>; break;
+        case 64: combine_fn = &row_add_mean<float, 64>; break;
+        case 128: combine_fn = &row_add_mean<float, 128>; break;
+      }
+      combine_fn(mapSet, embedding_size, is_mean);
 
       for (int i = 0; i < rows; ++i) {
         if (row_values[i] == 0) {
@@ -199,6 +199,163 @@ namespace {
         feature_nums[partitioned_indices(indices, indice_dim, i)]++;
     }
   }
+
+  static inline bool indices_sorted_by_row(
+      std::vector<std::tuple<size_t, const int64*>> &indices, int indice_dim) {
+    for (size_t p = 0; p < indices.size(); ++p) {
+      size_t sub_nnz = std::get<0>(indices[p]);
+      const int64 *sub_indices = std::get<1>(indices[p]);
+      for (size_t i = 1; i < sub_nnz; ++i) {
+        if (sub_indices[i * indice_dim] < sub_indices[(i - 1) * indice_dim]) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  // Fast path for the common case where the pre op already emitted each
+  // partition's indices sorted by output row. Runs of equal rows are
+  // summed in a single stack accumulator and flushed to the output row
+  // once per run, so neither the per-element partition scan nor the
+  // per-row staging buffer of sparse_partitioned_gather is needed.
+  // row_values receives the number of features per output row.
+  // When output_transposed is set the flush scatters the accumulator as
+  // a column of an [embedding_size, rows] output instead, fusing the
+  // layout transform into the write that has to happen anyway.
+  static void sparse_sorted_segment_gather(
+                          std::vector<std::tuple<size_t, const int64*>> &indices, int indice_dim, int rows,
+                          std::vector<std::tuple<size_t, const float*>> &embedding_tables, float *output,
+                          const int64_t embedding_size, SparseSegmentReductionOperation operation,
+                          const bool set_empty_row_zero, const int *empty_row,
+                          uint64_t *row_values, const bool output_transposed) {
+#if defined(__GNUC__) && (__GNUC__ > 6) && (__AVX512F__)
+    auto avx512_add = [](const float* input, float* output, const int64_t num) {
+      constexpr size_t float_displacement = 4;
+      constexpr size_t float_alignment = 16;
+      int64_t quotient = num >> float_displacement;
+      int64_t remainder = num & 0x000F;
+
+      for (int64_t j = 0; j < quotient; ++j) {
+        int64_t offset = j << float_displacement;
+        __m512 a = _mm512_loadu_ps(&input[offset]);
+        __m512 b = _mm512_loadu_ps(&output[offset]);
+        _mm512_storeu_ps(&output[offset], _mm512_add_ps(a, b));
+      }
+
+      if (remainder != 0) {
+        __mmask16 mask = 0xffff >> (float_alignment - remainder);
+        int64_t offset = quotient << float_displacement;
+        __m512 zero = _mm512_setzero_ps();
+        __m512 a = _mm512_mask_loadu_ps(zero, mask, &input[offset]);
+        __m512 b = _mm512_mask_loadu_ps(zero, mask, &output[offset]);
+        _mm512_mask_storeu_ps(&output[offset], mask,
+                              _mm512_mask_add_ps(zero, mask, a, b));
+      }
+    };
+
+    auto avx512_scale = [](float* output, const float* scale, const int64_t num) {
+      constexpr size_t float_displacement = 4;
+      constexpr size_t float_alignment = 16;
+      int64_t quotient = num >> float_displacement;
+      int64_t remainder = num & 0x000F;
+      __m512 scale_ = _mm512_broadcastss_ps(_mm_load_ss(scale));
+
+      for (int64_t j = 0; j < quotient; ++j) {
+        int64_t offset = j << float_displacement;
+        __m512 a = _mm512_loadu_ps(&output[offset]);
+        _mm512_storeu_ps(&output[offset], _mm512_mul_ps(a, scale_));
+      }
+
+      if (remainder != 0) {
+        __mmask16 mask = 0xffff >> (float_alignment - remainder);
+        int64_t offset = quotient << float_displacement;
+        __m512 zero = _mm512_setzero_ps();
+        __m512 a = _mm512_mask_loadu_ps(zero, mask, &output[offset]);
+        _mm512_mask_storeu_ps(&output[offset], mask,
+                              _mm512_mask_mul_ps(zero, mask, a, scale_));
+      }
+    };
+#endif
+
+    float* accumulator = new float[embedding_size];
+    int partitions_num = indices.size();
+    for (int p = 0; p < partitions_num; ++p) {
+      size_t sub_nnz = std::get<0>(indices[p]);
+      const int64 *sub_indices = std::get<1>(indices[p]);
+      const float *table = std::get<1>(embedding_tables[p]);
+      size_t i = 0;
+      while (i < sub_nnz) {
+        int64 row = sub_indices[i * indice_dim];
+        size_t run_end = i + 1;
+        while (run_end < sub_nnz && sub_indices[run_end * indice_dim] == row) {
+          ++run_end;
+        }
+        memcpy(accumulator, &table[i * embedding_size],
+               embedding_size * sizeof(float));
+        for (size_t k = i + 1; k < run_end; ++k) {
+#if defined(__GNUC__) && (__GNUC__ > 6) && (__AVX512F__)
+          avx512_add(&table[k * embedding_size], accumulator, embedding_size);
+#else
+          for (int64_t j = 0; j < embedding_size; ++j) {
+            accumulator[j] += table[k * embedding_size + j];
+          }
+#endif
+        }
+        // A row split across partitions is completed by accumulating
+        // into the (zero-initialized) output instead of overwriting.
+        if (output_transposed) {
+          for (int64_t j = 0; j < embedding_size; ++j) {
+            output[j * rows + row] += accumulator[j];
+          }
+        } else {
+#if defined(__GNUC__) && (__GNUC__ > 6) && (__AVX512F__)
+          avx512_add(accumulator, &output[row * embedding_size], embedding_size);
+#else
+          for (int64_t j = 0; j < embedding_size; ++j) {
+            output[row * embedding_size + j] += accumulator[j];
+          }
+#endif
+        }
+        row_values[row] += run_end - i;
+        i = run_end;
+      }
+    }
+    delete[] accumulator;
+
+    for (int64_t i = 0; i < rows; ++i) {
+      if (set_empty_row_zero && empty_row[i] == 1) {
+        if (output_transposed) {
+          for (int64_t j = 0; j < embedding_size; ++j) {
+            output[j * rows + i] = 0;
+          }
+        } else {
+          memset(&output[i * embedding_size], 0, embedding_size * sizeof(float));
+        }
+        continue;
+      }
+      if (row_values[i] == 0 ||
+          operation == SparseSegmentReductionOperation::kSum) {
+        continue;
+      }
+      float scale = (operation == SparseSegmentReductionOperation::kMean)
+          ? 1.0 / static_cast<float>(row_values[i])
+          : 1.0 / std::sqrt(row_values[i]);
+      if (output_transposed) {
+        for (int64_t j = 0; j < embedding_size; ++j) {
+          output[j * rows + i] *= scale;
+        }
+        continue;
+      }
+#if defined(__GNUC__) && (__GNUC__ > 6) && (__AVX512F__)
+      avx512_scale(&output[i * embedding_size], &scale, embedding_size);
+#else
+      for (int64_t j = 0; j < embedding_size; ++j) {
+        output[i * embedding_size + j] *= scale;
+      }
+#endif
+    }
+  }
 }
 
 template <typename Device>
@@ -213,6 +370,7 @@ public:
     int temp_default_id;
     OP_REQUIRES_OK(ctx, ctx->GetAttr("default_id", &temp_default_id));
     default_id_ = int64_t(temp_default_id);
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("output_transposed", &output_transposed_));
     if (combiner_ == "sum") {
       operation_ = SparseSegmentReductionOperation::kSum;
     } else if (combiner_ == "mean") {
@@ -258,10 +416,16 @@ public:
 
     const int *empty_row = row_empty_and_invalid_flags->flat<int>().data();
 
+    // With output_transposed the op emits [embedding_size, batch_size]
+    // directly, so a dense tower that concatenates per-feature blocks
+    // along axis 0 gets its MatMul-ready layout without a separate
+    // transpose pass over the combined block.
+    const TensorShape output_shape =
+        output_transposed_ ? TensorShape({embedding_size, batch_size})
+                           : TensorShape({batch_size, embedding_size});
     Tensor* emb_vectors_tensor = nullptr;
     OP_REQUIRES_OK(
-        ctx, ctx->allocate_output(0, TensorShape({batch_size, embedding_size}),
-                                  &emb_vectors_tensor));
+        ctx, ctx->allocate_output(0, output_shape, &emb_vectors_tensor));
     float *output = (float *)emb_vectors_tensor->tensor_data().data();
     memset(output, 0, batch_size * embedding_size * sizeof(float));
 
@@ -294,9 +458,33 @@ public:
       indices.emplace_back(std::make_tuple(sub_nnz, partitioned_indices[i].flat<int64>().data()));
     }
 
-    sparse_partitioned_gather(input_size, indices, indice_dim, batch_size,
-            embedding_tables, output, embedding_size, operation_, set_empty_row_zero, empty_row);
-    set_feature_nums(feature_nums, input_size, indices, indice_dim);
+    if (indices_sorted_by_row(indices, indice_dim)) {
+      std::vector<uint64_t> row_values(batch_size, 0);
+      sparse_sorted_segment_gather(indices, indice_dim, batch_size,
+              embedding_tables, output, embedding_size, operation_,
+              set_empty_row_zero, empty_row, row_values.data(),
+              output_transposed_);
+      for (int i = 0; i < batch_size; ++i) {
+        feature_nums[i] = row_values[i];
+      }
+    } else if (output_transposed_) {
+      // The unsorted fallback combines into row-major staging; transpose
+      // while flushing the staging buffer into the output.
+      std::vector<float> staging(batch_size * embedding_size, 0.0f);
+      sparse_partitioned_gather(input_size, indices, indice_dim, batch_size,
+              embedding_tables, staging.data(), embedding_size, operation_,
+              set_empty_row_zero, empty_row);
+      set_feature_nums(feature_nums, input_size, indices, indice_dim);
+      for (int64_t i = 0; i < batch_size; ++i) {
+        for (int64_t j = 0; j < embedding_size; ++j) {
+          output[j * batch_size + i] = staging[i * embedding_size + j];
+        }
+      }
+    } else {
+      sparse_partitioned_gather(input_size, indices, indice_dim, batch_size,
+              embedding_tables, output, embedding_size, operation_, set_empty_row_zero, empty_row);
+      set_feature_nums(feature_nums, input_size, indices, indice_dim);
+    }
   }
 
 private:
@@ -305,6 +493,7 @@ int num_partitions_;
   std::string combiner_;
   float max_norm_;
   int64_t default_id_;
+  bool output_transposed_;
   SparseSegmentReductionOperation operation_;
 };
 
@@ -326,6 +515,7 @@ class FusedSafeEmbeddingPostLookupGradOp : public OpKernel {
     int temp_default_id;
     OP_REQUIRES_OK(ctx, ctx->GetAttr("default_id", &temp_default_id));
     default_id_ = int64_t(temp_default_id);
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("output_transposed", &output_transposed_));
     if (combiner_ == "sum") {
       operation_ = SparseSegmentReductionOperation::kSum;
     } else if (combiner_ == "mean") {
@@ -360,8 +550,15 @@ class FusedSafeEmbeddingPostLookupGradOp : public OpKernel {
     OP_REQUIRES_OK(ctx, ctx->output_list("grad_shards", &grad_shards));
 
     const float *top_grad = top_grad_tensor->flat<float>().data();
-    const int64_t batch_size = top_grad_tensor->shape().dim_size(0);
+    // With output_transposed the forward op emitted
+    // [emb_vec_size, batch_size], so top_grad arrives transposed too and
+    // its columns are gathered with a batch_size stride.
+    const int64_t batch_size = output_transposed_
+        ? top_grad_tensor->shape().dim_size(1)
+        : top_grad_tensor->shape().dim_size(0);
     const int64_t emb_vec_size = emb_shards[0].shape().dim_size(1);
+    const int64_t tg_row_stride = output_transposed_ ? 1 : emb_vec_size;
+    const int64_t tg_col_stride = output_transposed_ ? batch_size : 1;
     const int *f_nums = feature_nums->flat<int>().data();
     const int *empty_row = row_empty_and_invalid_flags->flat<int>().data();
 
@@ -394,6 +591,12 @@ class FusedSafeEmbeddingPostLookupGradOp : public OpKernel {
           int64 idx = indices[j*indices_col];
           if (set_empty_row_zero == true && empty_row[idx] == 1)
             memset(&grad[j*emb_vec_size], 0, sizeof(float)*emb_vec_size);
+          else if (output_transposed_) {
+            for (int k = 0; k < emb_vec_size; ++k) {
+              grad[j*emb_vec_size + k] =
+                  top_grad[idx*tg_row_stride + k*tg_col_stride];
+            }
+          }
           else
             memcpy(&grad[j*emb_vec_size], &top_grad[idx*emb_vec_size], sizeof(float)*emb_vec_size);
         }
@@ -405,7 +608,8 @@ class FusedSafeEmbeddingPostLookupGradOp : public OpKernel {
             memset(&grad[j*emb_vec_size], 0, sizeof(float)*emb_vec_size);
           else {
             for (int k = 0; k < emb_vec_size; ++k) {
-              grad[j*emb_vec_size + k] = top_grad[idx*emb_vec_size + k] / f_nums[idx];
+              grad[j*emb_vec_size + k] =
+                  top_grad[idx*tg_row_stride + k*tg_col_stride] / f_nums[idx];
               if (max_norm_ > 0.0 && l2_norm[j] > max_norm_) {
                 grad[j*emb_vec_size + k] *= max_norm_ / l2_norm[j];
               }
@@ -420,7 +624,8 @@ class FusedSafeEmbeddingPostLookupGradOp : public OpKernel {
             memset(&grad[j*emb_vec_size], 0, sizeof(float)*emb_vec_size);
           else {
             for (int k = 0; k < emb_vec_size; ++k) {
-              grad[j*emb_vec_size + k] = top_grad[idx*emb_vec_size + k] / std::sqrt(f_nums[idx]);
+              grad[j*emb_vec_size + k] =
+                  top_grad[idx*tg_row_stride + k*tg_col_stride] / std::sqrt(f_nums[idx]);
               if (max_norm_ > 0.0 && l2_norm[j] > max_norm_) {
                 grad[j*emb_vec_size + k] *= max_norm_ / l2_norm[j];
               }
@@ -441,6 +646,7 @@ private:
   std::string combiner_;
   float max_norm_;
   int64_t default_id_;
+  bool output_transposed_;
   SparseSegmentReductionOperation operation_;
 };
 
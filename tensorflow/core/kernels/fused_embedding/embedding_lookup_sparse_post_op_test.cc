@@ -34,7 +34,8 @@ class FusedSafeEmbeddingPostLookupOpTest : public OpsTestBase {
  protected:
   void MakeOpAndSetDevice(Device device, int num_partitions, DataType dtype,
                           const std::string& combiner, const float max_norm,
-                          const int default_id) {
+                          const int default_id,
+                          const bool output_transposed = false) {
     if (device == Device::GPU) {
       SetDevice(DEVICE_GPU,
                 std::unique_ptr<tensorflow::Device>(DeviceFactory::NewDevice(
@@ -49,6 +50,7 @@ class FusedSafeEmbeddingPostLookupOpTest : public OpsTestBase {
                      .Attr("combiner", combiner)
                      .Attr("max_norm", max_norm)
                      .Attr("default_id", default_id)
+                     .Attr("output_transposed", output_transposed)
                      .Input(FakeInput(num_partitions, dtype))
                      .Input(FakeInput(num_partitions, DT_INT64))
                      .Input(FakeInput(DT_INT64))
@@ -277,6 +279,95 @@ TEST_F(FusedSafeEmbeddingPostLookupOpTest, Partition2_Sum_Default_0) {
 }
 
 
+TEST_F(FusedSafeEmbeddingPostLookupOpTest, Partition2_Mean_Sorted) {
+  const int nnz = 4;
+  const int batch_size = 2;
+  const int emb_vector_dim = 4;
+  const int entries = 8;
+
+  MakeOpAndSetDevice(Device::CPU, 2, DT_FLOAT, "mean", -1.0, -1);
+
+  // emb_shards
+  AddInputFromArray<float>(TensorShape({2, emb_vector_dim}),
+                           {1.0, 1.0, 1.0, 1.0, 3.0, 3.0, 3.0, 3.0});
+  AddInputFromArray<float>(TensorShape({2, emb_vector_dim}),
+                           {5.0, 5.0, 5.0, 5.0, 9.0, 9.0, 9.0, 9.0});
+
+  // partitioned_indices, sorted by row within each partition
+  AddInputFromArray<int64>(TensorShape({2, 2}), {0, 0, 0, 5});
+  AddInputFromArray<int64>(TensorShape({2, 2}), {0, 6, 1, 0});
+
+  // sp_dense_shape
+  AddInputFromArray<int64>(TensorShape({2}), {batch_size, entries});
+
+  // row_empty_and_invalid_flags
+  AddInputFromArray<int>(TensorShape({batch_size + nnz}), {0, 0, 1, 1, 1, 1});
+
+  TF_ASSERT_OK(RunOpKernel());
+  TF_EXPECT_OK(device_->Sync());
+
+  {
+    Tensor expected_emb_vectors(allocator(), DT_FLOAT,
+                                TensorShape({batch_size, emb_vector_dim}));
+    test::FillValues<float>(
+        &expected_emb_vectors,
+        {3.0, 3.0, 3.0, 3.0, 9.0, 9.0, 9.0, 9.0});
+    test::ExpectTensorNear<float>(expected_emb_vectors, *GetOutput(0), 1e-4);
+  }
+  {
+    Tensor feature_nums_expected(allocator(), DT_INT32,
+                                 TensorShape({batch_size}));
+    test::FillValues<int>(&feature_nums_expected, {3, 1});
+    test::ExpectTensorEqual<int32>(feature_nums_expected, *GetOutput(1));
+  }
+}
+
+TEST_F(FusedSafeEmbeddingPostLookupOpTest, Partition2_Sum_Transposed) {
+  const int nnz = 3;
+  const int batch_size = 3;
+  const int emb_vector_dim = 4;
+  const int entries = 8;
+
+  MakeOpAndSetDevice(Device::CPU, 2, DT_FLOAT, "sum", -1.0, -1,
+                     /*output_transposed=*/true);
+
+  // emb_shards
+  AddInputFromArray<float>(TensorShape({2, emb_vector_dim}),
+                           {1.0, 1.0, 1.0, 1.0, 2.0, 2.0, 2.0, 2.0});
+  AddInputFromArray<float>(TensorShape({2, emb_vector_dim}),
+                           {10.0, 10.0, 10.0, 10.0, 13.0, 13.0, 13.0, 13.0});
+
+  // partitioned_indices
+  AddInputFromArray<int64>(TensorShape({2, 2}), {0, 0, 0, 5});
+  AddInputFromArray<int64>(TensorShape({2, 2}), {1, 4, 2, 0});
+
+  // sp_dense_shape
+  AddInputFromArray<int64>(TensorShape({2}), {batch_size, entries});
+
+  // row_empty_and_invalid_flags
+  AddInputFromArray<int>(TensorShape({batch_size + nnz}), {0, 0, 1, 1, 1, 1});
+
+  TF_ASSERT_OK(RunOpKernel());
+  TF_EXPECT_OK(device_->Sync());
+
+  {
+    // Same combined rows as Partition2_Sum_No_Default, emitted as
+    // [emb_vector_dim, batch_size] columns.
+    Tensor expected_emb_vectors(allocator(), DT_FLOAT,
+                                TensorShape({emb_vector_dim, batch_size}));
+    test::FillValues<float>(
+        &expected_emb_vectors,
+        {3.0, 10.0, 13.0, 3.0, 10.0, 13.0, 3.0, 10.0, 13.0, 3.0, 10.0, 13.0});
+    test::ExpectTensorNear<float>(expected_emb_vectors, *GetOutput(0), 1e-4);
+  }
+  {
+    Tensor feature_nums_expected(allocator(), DT_INT32,
+                                 TensorShape({batch_size}));
+    test::FillValues<int>(&feature_nums_expected, {2, 1, 1});
+    test::ExpectTensorEqual<int32>(feature_nums_expected, *GetOutput(1));
+  }
+}
+
 //----------------------------------------------------------------------------//
 // Performance benchmarks                                                     //
 //----------------------------------------------------------------------------//
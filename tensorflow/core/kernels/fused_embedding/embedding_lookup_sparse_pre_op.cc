@@ -239,7 +239,14 @@ class FusedEmbeddingSparsePreLookUpCPU : public OpKernel {
       }
     }
 
-    // 3 packaging the output tensor
+    // 3 packaging the output tensors. The per-partition counts in
+    // id_index_array double as CSR-style row pointers: after allocating
+    // each partition at its known size, every element's final slot is
+    // its partition's running offset, so one O(nnz) scatter replaces
+    // the old rescan of all ids once per partition.
+    std::vector<int64_t*> sub_values_ptrs(num_partitions_);
+    std::vector<int64_t*> sub_indices_ptrs(num_partitions_);
+    std::vector<int64_t> write_offsets(num_partitions_, 0);
     for (int i = 0; i < num_partitions_; ++i) {
       int64_t size = id_index_array[i];
       if (fill_empty_row_ && i == default_p_seg) {
@@ -250,34 +257,36 @@ class FusedEmbeddingSparsePreLookUpCPU : public OpKernel {
       OP_REQUIRES_OK(ctx, partitioned_values.allocate(
                               i, TensorShape({static_cast<int64_t>(size)}),
                               &sub_partitioned_values));
-      int64_t* sub_p_values = reinterpret_cast<int64_t*>(
+      sub_values_ptrs[i] = reinterpret_cast<int64_t*>(
           sub_partitioned_values->flat<int64>().data());
 
       Tensor* sub_partitioned_indices;
       OP_REQUIRES_OK(ctx, partitioned_indices.allocate(
                               i, TensorShape({static_cast<int64_t>(size), 2}),
                               &sub_partitioned_indices));
+      sub_indices_ptrs[i] = reinterpret_cast<int64_t*>(
+          sub_partitioned_indices->flat<int64>().data());
+    }
 
-      int64_t* sub_p_indces = reinterpret_cast<int64_t*>(
-                                  sub_partitioned_indices->flat<int64>().data());
-      if (!size) continue;
-
-      int sub_part_index = 0;
-      for (int index = 0; index < nnz; ++index) {
-        if (id_index_array[(index) * 2 + num_partitions_ + 1] == i) {
-          sub_p_values[sub_part_index] = id_index_array[(index) * 2 + num_partitions_ + 2];
-          sub_p_indces[sub_part_index * 2] = *(indices + (index) * 2);
-          sub_p_indces[sub_part_index * 2 + 1] = *(indices + (index) * 2 + 1);
-          ++sub_part_index;
-        }
+    for (int64_t index = 0; index < nnz; ++index) {
+      const int64_t seg = id_index_array[index * 2 + num_partitions_ + 1];
+      if (seg >= num_partitions_) {
+        continue;  // pruned invalid id
       }
-      if (fill_empty_row_ && default_p_seg == i) {
-        memcpy(sub_p_indces + sub_part_index * 2,
-          empty_index_.data(), empty_index_.size() * sizeof(int64_t));
+      const int64_t pos = write_offsets[seg]++;
+      sub_values_ptrs[seg][pos] = id_index_array[index * 2 + num_partitions_ + 2];
+      sub_indices_ptrs[seg][pos * 2] = *(indices + index * 2);
+      sub_indices_ptrs[seg][pos * 2 + 1] = *(indices + index * 2 + 1);
+    }
 
-        std::fill(sub_p_values + sub_part_index,
-          sub_p_values + size, default_p_val);
-      }
+    if (fill_empty_row_ && !empty_index_.empty()) {
+      const int64_t tail = id_index_array[default_p_seg];
+      memcpy(sub_indices_ptrs[default_p_seg] + tail * 2,
+        empty_index_.data(), empty_index_.size() * sizeof(int64_t));
+
+      std::fill(sub_values_ptrs[default_p_seg] + tail,
+        sub_values_ptrs[default_p_seg] + tail +
+            (empty_index_.size() >> 1), default_p_val);
     }
     delete[] min_id_per_seg;
     delete[] id_index_array;
@@ -118,6 +118,11 @@ class FusedEmbeddingSparsePostLookUpGPU : public OpKernel {
     int temp_default_id;
     OP_REQUIRES_OK(ctx, ctx->GetAttr("default_id", &temp_default_id));
     default_id_ = int64_t(temp_default_id);
+    bool output_transposed;
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("output_transposed", &output_transposed));
+    OP_REQUIRES(ctx, !output_transposed,
+                errors::Unimplemented(
+                    "output_transposed is only supported on CPU"));
   }
 
   void Compute(OpKernelContext* ctx) override {
@@ -234,6 +239,11 @@ class FusedEmbeddingSparsePostLookUpGradGPU : public OpKernel {
     int temp_default_id;
     OP_REQUIRES_OK(ctx, ctx->GetAttr("default_id", &temp_default_id));
     default_id_ = int64_t(temp_default_id);
+    bool output_transposed;
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("output_transposed", &output_transposed));
+    OP_REQUIRES(ctx, !output_transposed,
+                errors::Unimplemented(
+                    "output_transposed is only supported on CPU"));
   }
 
   void Compute(OpKernelContext* ctx) override {
@@ -11,6 +11,7 @@
 #include "tensorflow/core/kernels/fused_embedding/fused_embedding_common.cu.h"
 #include "tensorflow/core/util/gpu_kernel_helper.h"
 #include "cub/device/device_radix_sort.cuh"
+#include "cub/device/device_scan.cuh"
 #include "cub/device/device_select.cuh"
 #include "cub/iterator/constant_input_iterator.cuh"
 #include "cub/thread/thread_operators.cuh"
@@ -120,6 +121,43 @@ __global__ void CalcElementsOffsetPerPartition(
   elements_offset_per_partition[blockIdx.x] = int64_t(pos + 1);
 }
 
+__global__ void MarkUniqueBoundaries(const int64_t* values_sorted,
+                                     const int64_t nnz, int* flags) {
+  const int offset = blockIdx.x * blockDim.x + threadIdx.x;
+  if (offset < nnz) {
+    flags[offset] =
+        (offset == 0 || values_sorted[offset] != values_sorted[offset - 1])
+            ? 1
+            : 0;
+  }
+}
+
+// unique_accum is the inclusive scan of the boundary flags, so
+// unique_accum[end - 1] is the number of distinct values in [0, end).
+// Values never cross a partition boundary, so the cumulative counts at
+// the partition ends give every partition's unique count.
+__global__ void CollectUniqueCounts(const int* unique_accum,
+                                    const int64_t* elements_offset,
+                                    const int num_partitions,
+                                    int* unique_cum_counts) {
+  const int i = blockIdx.x * blockDim.x + threadIdx.x;
+  if (i < num_partitions) {
+    const int64_t end = elements_offset[i];
+    unique_cum_counts[i] = end > 0 ? unique_accum[end - 1] : 0;
+  }
+}
+
+// Local inverse mapping for one partition's occurrence range: occurrence
+// start + j maps to unique row unique_accum[start + j] - unique_accum[start].
+__global__ void RebaseInverse(const int* unique_accum, const int64_t start,
+                              const int64_t size, int64_t* inverse_out) {
+  const int j = blockIdx.x * blockDim.x + threadIdx.x;
+  if (j < size) {
+    inverse_out[j] =
+        int64_t(unique_accum[start + j]) - int64_t(unique_accum[start]);
+  }
+}
+
 __global__ void GatherAndConvertToSubPartition(
     const int64_t* sub_values_sorted, int64_t* sub_partitioned_values,
     const int64_t partition_start_base, const int64_t partition_size) {
@@ -185,7 +223,7 @@ class FusedEmbeddingSparsePreLookUpGPU : public OpKernel {
     size_t max_cub_bytes = 0;
     size_t temp_storage_bytes = 0;
 
-    if (num_partitions_ > 1) {
+    if (num_partitions_ > 1 || do_unique_) {
       cub::DeviceRadixSort::SortPairs(
           (void*)nullptr, temp_storage_bytes, (int64_t*)nullptr,
           (int64_t*)nullptr, (IndicePair*)nullptr, (IndicePair*)nullptr,
@@ -194,6 +232,20 @@ class FusedEmbeddingSparsePreLookUpGPU : public OpKernel {
                                                          : max_cub_bytes;
     }
 
+    if (do_unique_) {
+      cub::DeviceScan::InclusiveSum((void*)nullptr, temp_storage_bytes,
+                                    (int*)nullptr, (int*)nullptr,
+                                    int(nnz + batch_size), stream);
+      max_cub_bytes = temp_storage_bytes > max_cub_bytes ? temp_storage_bytes
+                                                         : max_cub_bytes;
+      cub::DeviceSelect::Flagged((void*)nullptr, temp_storage_bytes,
+                                 (int64_t*)nullptr, (int*)nullptr,
+                                 (int64_t*)nullptr, (int*)nullptr,
+                                 int(nnz + batch_size), stream);
+      max_cub_bytes = temp_storage_bytes > max_cub_bytes ? temp_storage_bytes
+                                                         : max_cub_bytes;
+    }
+
     if (fill_empty_row_ || prune_invalid_id_) {
       cub::DeviceSelect::Flagged(nullptr, temp_storage_bytes, (int64_t*)nullptr,
                                  (int*)nullptr, (int64_t*)nullptr,
@@ -352,9 +404,14 @@ class FusedEmbeddingSparsePreLookUpGPU : public OpKernel {
     OpOutputList partitioned_indices;
     OP_REQUIRES_OK(
         ctx, ctx->output_list("partitioned_indices", &partitioned_indices));
+    OpOutputList partitioned_inverse;
+    if (do_unique_) {
+      OP_REQUIRES_OK(
+          ctx, ctx->output_list("partitioned_inverse", &partitioned_inverse));
+    }
 
     // 4. set output
-    if (num_partitions_ == 1) {
+    if (num_partitions_ == 1 && !do_unique_) {
       // single partition case, just directly copy
       Tensor* pv_out;
       OP_REQUIRES_OK(
@@ -374,7 +431,8 @@ class FusedEmbeddingSparsePreLookUpGPU : public OpKernel {
                       stream);
 
     } else {
-      // multi-partitions case, calcaulate indices and split them.
+      // multi-partitions (or unique) case: sort, then calculate indices
+      // and split them.
       Tensor values_sorted;
       OP_REQUIRES_OK(ctx, ctx->allocate_temp(DT_INT64, TensorShape{new_nnz},
                                              &values_sorted));
@@ -392,71 +450,156 @@ class FusedEmbeddingSparsePreLookUpGPU : public OpKernel {
 
       // 4.1 calculate how many elements for each
       // partition
-      Tensor partition_sizes_accumulate;
-      OP_REQUIRES_OK(
-          ctx,
-          ctx->allocate_temp(
-              DT_INT64, TensorShape({static_cast<int64_t>(num_partitions_)}),
-              &partition_sizes_accumulate));
-      cudaMemcpyAsync(partition_sizes_accumulate.flat<int64>().data(),
-                      partition_sizes_accumulate_.data(),
-                      num_partitions_ * sizeof(int64_t), cudaMemcpyHostToDevice,
-                      stream);
-
       Tensor elements_offset_per_partition;
-      OP_REQUIRES_OK(
-          ctx,
-          ctx->allocate_temp(
-              DT_INT64, TensorShape({static_cast<int64_t>(num_partitions_)}),
-              &elements_offset_per_partition));
+      elements_offset_per_partition_.clear();
+      if (num_partitions_ > 1) {
+        Tensor partition_sizes_accumulate;
+        OP_REQUIRES_OK(
+            ctx,
+            ctx->allocate_temp(
+                DT_INT64, TensorShape({static_cast<int64_t>(num_partitions_)}),
+                &partition_sizes_accumulate));
+        cudaMemcpyAsync(partition_sizes_accumulate.flat<int64>().data(),
+                        partition_sizes_accumulate_.data(),
+                        num_partitions_ * sizeof(int64_t),
+                        cudaMemcpyHostToDevice, stream);
+
+        OP_REQUIRES_OK(
+            ctx,
+            ctx->allocate_temp(
+                DT_INT64, TensorShape({static_cast<int64_t>(num_partitions_)}),
+                &elements_offset_per_partition));
 
-      {
-        const int blocks = num_partitions_;
-        const int threads = 1;
-        CalcElementsOffsetPerPartition<<<blocks, threads, 0, stream>>>(
+        {
+          const int blocks = num_partitions_;
+          const int threads = 1;
+          CalcElementsOffsetPerPartition<<<blocks, threads, 0, stream>>>(
+              reinterpret_cast<const int64_t*>(
+                  values_sorted.flat<int64>().data()),
+              reinterpret_cast<int64_t*>(
+                  partition_sizes_accumulate.flat<int64>().data()),
+              reinterpret_cast<int64_t*>(
+                  elements_offset_per_partition.flat<int64>().data()),
+              int(new_nnz));
+          CK_CUDA_THROW_(cudaGetLastError());
+        }
+
+        elements_offset_per_partition_.resize(num_partitions_);
+        cudaMemcpyAsync(elements_offset_per_partition_.data(),
+                        elements_offset_per_partition.flat<int64>().data(),
+                        num_partitions_ * sizeof(int64_t),
+                        cudaMemcpyDeviceToHost, stream);
+      } else {
+        // unique single-partition case: the whole range is partition 0.
+        elements_offset_per_partition_.assign(1, new_nnz);
+      }
+
+      // 4.1.1 run-length dedup of the sorted values: boundary flags, an
+      // inclusive scan giving the occurrence->unique mapping, and a
+      // flagged select producing the unique value list. Everything stays
+      // on the device; the host only learns the per-partition unique
+      // counts, and through the same single synchronize that already
+      // fetches the partition offsets.
+      Tensor unique_flags;
+      Tensor unique_accum;
+      Tensor unique_sorted;
+      std::vector<int> unique_cum_counts(num_partitions_, 0);
+      if (do_unique_ && new_nnz > 0) {
+        if (!(fill_empty_row_ || prune_invalid_id_)) {
+          OP_REQUIRES_OK(ctx, ctx->allocate_temp(DT_INT32, TensorShape{1},
+                                                 &selected_num_d));
+        }
+        OP_REQUIRES_OK(ctx, ctx->allocate_temp(DT_INT32, TensorShape{new_nnz},
+                                               &unique_flags));
+        OP_REQUIRES_OK(ctx, ctx->allocate_temp(DT_INT32, TensorShape{new_nnz},
+                                               &unique_accum));
+        OP_REQUIRES_OK(ctx, ctx->allocate_temp(DT_INT64, TensorShape{new_nnz},
+                                               &unique_sorted));
+        {
+          const int threads = linear_mapping_threads;
+          const int blocks = CalcBlocksLinearMapping(new_nnz, threads);
+          MarkUniqueBoundaries<<<blocks, threads, 0, stream>>>(
+              reinterpret_cast<const int64_t*>(
+                  values_sorted.flat<int64>().data()),
+              new_nnz, unique_flags.flat<int>().data());
+          CK_CUDA_THROW_(cudaGetLastError());
+        }
+        cub::DeviceScan::InclusiveSum(
+            cub_temp_storage.flat<int8>().data(), max_cub_bytes,
+            unique_flags.flat<int>().data(), unique_accum.flat<int>().data(),
+            int(new_nnz), stream);
+        CK_CUDA_THROW_(cudaGetLastError());
+        cub::DeviceSelect::Flagged(
+            cub_temp_storage.flat<int8>().data(), max_cub_bytes,
             reinterpret_cast<const int64_t*>(
                 values_sorted.flat<int64>().data()),
-            reinterpret_cast<int64_t*>(
-                partition_sizes_accumulate.flat<int64>().data()),
-            reinterpret_cast<int64_t*>(
-                elements_offset_per_partition.flat<int64>().data()),
-            int(new_nnz));
+            unique_flags.flat<int>().data(),
+            reinterpret_cast<int64_t*>(unique_sorted.flat<int64>().data()),
+            selected_num_d.flat<int>().data(), int(new_nnz), stream);
         CK_CUDA_THROW_(cudaGetLastError());
+
+        if (num_partitions_ > 1) {
+          Tensor unique_cum_counts_d;
+          OP_REQUIRES_OK(
+              ctx,
+              ctx->allocate_temp(
+                  DT_INT32, TensorShape({static_cast<int64_t>(num_partitions_)}),
+                  &unique_cum_counts_d));
+          {
+            const int threads = linear_mapping_threads;
+            const int blocks =
+                CalcBlocksLinearMapping(num_partitions_, threads);
+            CollectUniqueCounts<<<blocks, threads, 0, stream>>>(
+                unique_accum.flat<int>().data(),
+                reinterpret_cast<const int64_t*>(
+                    elements_offset_per_partition.flat<int64>().data()),
+                num_partitions_, unique_cum_counts_d.flat<int>().data());
+            CK_CUDA_THROW_(cudaGetLastError());
+          }
+          cudaMemcpyAsync(unique_cum_counts.data(),
+                          unique_cum_counts_d.flat<int>().data(),
+                          num_partitions_ * sizeof(int), cudaMemcpyDeviceToHost,
+                          stream);
+        } else {
+          cudaMemcpyAsync(unique_cum_counts.data(),
+                          unique_accum.flat<int>().data() + (new_nnz - 1),
+                          sizeof(int), cudaMemcpyDeviceToHost, stream);
+        }
       }
 
-      elements_offset_per_partition_.clear();
-      elements_offset_per_partition_.resize(num_partitions_);
-      // stream_executor::DeviceMemoryBase
-      // elements_offset_per_partition_wrapped(
-      //     elements_offset_per_partition.flat<int64>().data(),
-      //     num_partitions_);
-      // stream->ThenMemcpy(elements_offset_per_partition_.data(),
-      //                    elements_offset_per_partition_wrapped,
-      //                    num_partitions_ *
-      //                    sizeof(int64_t));
-      // stream->BlockHostUntilDone();
-
-      cudaMemcpyAsync(elements_offset_per_partition_.data(),
-                      elements_offset_per_partition.flat<int64>().data(),
-                      num_partitions_ * sizeof(int64_t), cudaMemcpyDeviceToHost,
-                      stream);
       cudaStreamSynchronize(stream);
 
       // 4.2 set output
       int64_t sub_start_offset = 0;
+      int64_t unique_start_offset = 0;
       for (int i = 0; i < num_partitions_; i++) {
         int64_t size = elements_offset_per_partition_[i] - sub_start_offset;
+        const int64_t unique_size =
+            do_unique_
+                ? unique_cum_counts[i] - (i == 0 ? 0 : unique_cum_counts[i - 1])
+                : size;
 
         Tensor* sub_partitioned_values;
-        OP_REQUIRES_OK(ctx, partitioned_values.allocate(
-                                i, TensorShape({static_cast<int64_t>(size)}),
-                                &sub_partitioned_values));
+        OP_REQUIRES_OK(
+            ctx, partitioned_values.allocate(
+                     i,
+                     TensorShape({static_cast<int64_t>(
+                         do_unique_ ? unique_size : size)}),
+                     &sub_partitioned_values));
 
         Tensor* sub_partitioned_indices;
         OP_REQUIRES_OK(ctx, partitioned_indices.allocate(
                                 i, TensorShape({static_cast<int64_t>(size), 2}),
                                 &sub_partitioned_indices));
 
+        Tensor* sub_partitioned_inverse = nullptr;
+        if (do_unique_) {
+          OP_REQUIRES_OK(ctx,
+                         partitioned_inverse.allocate(
+                             i, TensorShape({static_cast<int64_t>(size)}),
+                             &sub_partitioned_inverse));
+        }
+
         if (size > 0) {
           // some partition does not have any
           // element that falls in it
@@ -465,15 +608,33 @@ class FusedEmbeddingSparsePreLookUpGPU : public OpKernel {
 
           const int partition_start_base =
               i == 0 ? 0 : partition_sizes_accumulate_[i - 1];
-          GatherAndConvertToSubPartition<<<blocks, threads, 0, stream>>>(
-              reinterpret_cast<const int64_t*>(
-                  values_sorted.flat<int64>().data()) +
-                  sub_start_offset,
-              reinterpret_cast<int64_t*>(
-                  sub_partitioned_values->flat<int64>().data()),
-              partition_start_base, size);
-
-          CK_CUDA_THROW_(cudaGetLastError());
+          if (do_unique_) {
+            blocks = CalcBlocksLinearMapping(unique_size, threads);
+            GatherAndConvertToSubPartition<<<blocks, threads, 0, stream>>>(
+                reinterpret_cast<const int64_t*>(
+                    unique_sorted.flat<int64>().data()) +
+                    unique_start_offset,
+                reinterpret_cast<int64_t*>(
+                    sub_partitioned_values->flat<int64>().data()),
+                partition_start_base, unique_size);
+            CK_CUDA_THROW_(cudaGetLastError());
+
+            blocks = CalcBlocksLinearMapping(size, threads);
+            RebaseInverse<<<blocks, threads, 0, stream>>>(
+                unique_accum.flat<int>().data(), sub_start_offset, size,
+                reinterpret_cast<int64_t*>(
+                    sub_partitioned_inverse->flat<int64>().data()));
+            CK_CUDA_THROW_(cudaGetLastError());
+          } else {
+            GatherAndConvertToSubPartition<<<blocks, threads, 0, stream>>>(
+                reinterpret_cast<const int64_t*>(
+                    values_sorted.flat<int64>().data()) +
+                    sub_start_offset,
+                reinterpret_cast<int64_t*>(
+                    sub_partitioned_values->flat<int64>().data()),
+                partition_start_base, size);
+            CK_CUDA_THROW_(cudaGetLastError());
+          }
 
           // stream_executor::DeviceMemoryBase
           // sub_indices_sorted_wrapped(
@@ -496,11 +657,17 @@ class FusedEmbeddingSparsePreLookUpGPU : public OpKernel {
               size * 2 * sizeof(int64_t), cudaMemcpyDeviceToDevice, stream);
         }
         sub_start_offset = elements_offset_per_partition_[i];
+        unique_start_offset += unique_size;
       }
     }
     // Op kernel execution done
   }
 
+ protected:
+  // Set by the Unique variant: deduplicate the sorted values on device
+  // and emit the occurrence->unique inverse mapping per partition.
+  bool do_unique_ = false;
+
  private:
   int num_partitions_;
   int partition_axis_;
@@ -511,11 +678,26 @@ class FusedEmbeddingSparsePreLookUpGPU : public OpKernel {
   std::vector<int64_t> elements_offset_per_partition_;
 };
 
+class FusedEmbeddingSparsePreLookUpUniqueGPU
+    : public FusedEmbeddingSparsePreLookUpGPU {
+ public:
+  explicit FusedEmbeddingSparsePreLookUpUniqueGPU(OpKernelConstruction* ctx)
+      : FusedEmbeddingSparsePreLookUpGPU(ctx) {
+    do_unique_ = true;
+  }
+};
+
 REGISTER_KERNEL_BUILDER(Name("FusedEmbeddingSparsePreLookUp")
                             .Device(DEVICE_GPU)
                             .HostMemory("partition_shapes")
                             .HostMemory("sp_dense_shape"),
                         FusedEmbeddingSparsePreLookUpGPU);
+
+REGISTER_KERNEL_BUILDER(Name("FusedEmbeddingSparsePreLookUpUnique")
+                            .Device(DEVICE_GPU)
+                            .HostMemory("partition_shapes")
+                            .HostMemory("sp_dense_shape"),
+                        FusedEmbeddingSparsePreLookUpUniqueGPU);
 }  // namespace tensorflow
 
 #endif  // GOOGLE_CUDA
@@ -348,5 +348,108 @@ TEST_F(FusedEmbeddingSparsePreLookUpOpTest,
   }
 }
 
+class FusedEmbeddingSparsePreLookUpUniqueOpTest : public OpsTestBase {
+ protected:
+  void MakeOpAndSetDevice(Device device, const int num_partitions,
+                          const bool fill_empty_row,
+                          const bool prune_invalid_id, const int default_id) {
+    if (device == Device::GPU) {
+      SetDevice(DEVICE_GPU,
+                std::unique_ptr<tensorflow::Device>(DeviceFactory::NewDevice(
+                    "GPU", {}, "/job:a/replica:0/task:0")));
+    }
+
+    TF_EXPECT_OK(NodeDefBuilder("fused_embedding_sparse_pre_look_up_unique",
+                                "FusedEmbeddingSparsePreLookUpUnique")
+                     .Attr("num_partitions", num_partitions)
+                     .Attr("partition_axis", 0)
+                     .Attr("fill_empty_row", fill_empty_row)
+                     .Attr("prune_invalid_id", prune_invalid_id)
+                     .Attr("default_id", default_id)
+                     .Input(FakeInput(num_partitions, DT_INT64))
+                     .Input(FakeInput(DT_INT64))
+                     .Input(FakeInput(DT_INT64))
+                     .Input(FakeInput(DT_INT64))
+                     .Finalize(node_def()));
+    TF_EXPECT_OK(InitOp());
+  }
+};
+
+TEST_F(FusedEmbeddingSparsePreLookUpUniqueOpTest, Partition2_Unique) {
+  MakeOpAndSetDevice(Device::GPU, 2, false, false, -1);
+  // partition_shapes 0
+  AddInputFromArray<int64>(TensorShape({2}), {6, 16});
+  // partition_shapes 1
+  AddInputFromArray<int64>(TensorShape({2}), {10, 16});
+  // sp_values
+  AddInputFromArray<int64>(TensorShape({8}), {1, 5, 1, 7, 9, 7, 1, 9});
+  // sp_indices
+  AddInputFromArray<int64>(TensorShape({8, 2}),
+                           {0, 0, 0, 1, 1, 0, 1, 1, 2, 0, 2, 1, 3, 0, 3, 1});
+  // sp_dense_shape
+  AddInputFromArray<int64>(TensorShape({2}), {4, 2});
+
+  TF_ASSERT_OK(RunOpKernel());
+  TF_EXPECT_OK(device_->Sync());
+
+  // Output order: values x2, indices x2, flags, inverse x2.
+  {
+    Tensor expected_values(allocator(), DT_INT64, TensorShape({2}));
+    test::FillValues<int64>(&expected_values, {1, 5});
+    test::ExpectTensorEqual<int64>(expected_values, *GetOutput(0));
+
+    Tensor expected_indices(allocator(), DT_INT64, TensorShape({4, 2}));
+    test::FillValues<int64>(&expected_indices, {0, 0, 1, 0, 3, 0, 0, 1});
+    test::ExpectTensorEqual<int64>(expected_indices, *GetOutput(2));
+
+    Tensor expected_inverse(allocator(), DT_INT64, TensorShape({4}));
+    test::FillValues<int64>(&expected_inverse, {0, 0, 0, 1});
+    test::ExpectTensorEqual<int64>(expected_inverse, *GetOutput(5));
+  }
+
+  {
+    // rebased to the second partition: 7 -> 1, 9 -> 3
+    Tensor expected_values(allocator(), DT_INT64, TensorShape({2}));
+    test::FillValues<int64>(&expected_values, {1, 3});
+    test::ExpectTensorEqual<int64>(expected_values, *GetOutput(1));
+
+    Tensor expected_indices(allocator(), DT_INT64, TensorShape({4, 2}));
+    test::FillValues<int64>(&expected_indices, {1, 1, 2, 1, 2, 0, 3, 1});
+    test::ExpectTensorEqual<int64>(expected_indices, *GetOutput(3));
+
+    Tensor expected_inverse(allocator(), DT_INT64, TensorShape({4}));
+    test::FillValues<int64>(&expected_inverse, {0, 0, 1, 1});
+    test::ExpectTensorEqual<int64>(expected_inverse, *GetOutput(6));
+  }
+}
+
+TEST_F(FusedEmbeddingSparsePreLookUpUniqueOpTest, Partition1_Unique) {
+  MakeOpAndSetDevice(Device::GPU, 1, false, false, -1);
+  // partition_shapes 0
+  AddInputFromArray<int64>(TensorShape({2}), {10, 16});
+  // sp_values
+  AddInputFromArray<int64>(TensorShape({5}), {3, 3, 8, 3, 8});
+  // sp_indices
+  AddInputFromArray<int64>(TensorShape({5, 2}),
+                           {0, 0, 1, 0, 2, 0, 3, 0, 0, 1});
+  // sp_dense_shape
+  AddInputFromArray<int64>(TensorShape({2}), {4, 2});
+
+  TF_ASSERT_OK(RunOpKernel());
+  TF_EXPECT_OK(device_->Sync());
+
+  Tensor expected_values(allocator(), DT_INT64, TensorShape({2}));
+  test::FillValues<int64>(&expected_values, {3, 8});
+  test::ExpectTensorEqual<int64>(expected_values, *GetOutput(0));
+
+  Tensor expected_indices(allocator(), DT_INT64, TensorShape({5, 2}));
+  test::FillValues<int64>(&expected_indices, {0, 0, 1, 0, 3, 0, 2, 0, 0, 1});
+  test::ExpectTensorEqual<int64>(expected_indices, *GetOutput(1));
+
+  Tensor expected_inverse(allocator(), DT_INT64, TensorShape({5}));
+  test::FillValues<int64>(&expected_inverse, {0, 0, 0, 1, 1});
+  test::ExpectTensorEqual<int64>(expected_inverse, *GetOutput(3));
+}
+
 }  // namespace
 }  // namespace tensorflow
\ No newline at end of file
@@ -0,0 +1,228 @@
+#define EIGEN_USE_THREADS
+
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/bounds_check.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+
+#include <cstring>
+
+namespace tensorflow {
+
+typedef Eigen::ThreadPoolDevice CPUDevice;
+
+// Computes the packed strict-lower-triangle pairwise dot products of the
+// feature rows, i.e. the 'dot' interaction of DLRM-style models:
+//   interactions[b, i * (i - 1) / 2 + j] = dot(features[b, i], features[b, j])
+// for j < i. Only num_features * (num_features - 1) / 2 dots are computed and
+// written straight into the packed output, instead of the full
+// num_features x num_features BatchMatMul followed by a boolean_mask.
+template <typename T>
+class FusedInteractionDotOp : public OpKernel {
+public:
+  explicit FusedInteractionDotOp(OpKernelConstruction* context)
+      : OpKernel(context) {}
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor* features_tensor = &context->input(0);
+    OP_REQUIRES(context, features_tensor->dims() == 3,
+                errors::InvalidArgument(
+                    "features must be 3-D [batch, num_features, dim], got ",
+                    features_tensor->shape().DebugString()));
+    const int64 batch = features_tensor->dim_size(0);
+    const int64 num_features = features_tensor->dim_size(1);
+    const int64 dim = features_tensor->dim_size(2);
+    const int64 output_dim = num_features * (num_features - 1) / 2;
+    const T* features = features_tensor->flat<T>().data();
+
+    Tensor* output_tensor = nullptr;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(0, TensorShape({batch, output_dim}),
+                                            &output_tensor));
+    T* output = output_tensor->flat<T>().data();
+    if (batch == 0 || output_dim == 0) return;
+
+    const int64 unit_cost = output_dim * dim * 4;
+    auto& worker_threads = *(context->device()->tensorflow_cpu_worker_threads());
+    thread::ThreadPool* thread_pool = worker_threads.workers;
+
+    thread_pool->ParallelFor(batch, unit_cost,
+        [&features, &output, num_features, dim, output_dim, this](
+            int64 begin_batch, int64 end_batch) {
+          forward(features, output, begin_batch, end_batch, num_features, dim,
+                  output_dim);
+        });
+  }
+
+private:
+  void forward(const T* features, T* output, int64 begin_batch,
+               int64 end_batch, int64 num_features, int64 dim,
+               int64 output_dim) {
+    for (int64 b = begin_batch; b < end_batch; ++b) {
+      const T* x = features + b * num_features * dim;
+      T* out = output + b * output_dim;
+#if defined(__GNUC__) && (__GNUC__ > 6) && (__AVX512F__)
+      const int64 remainder = dim & 0x0F;
+      const __mmask16 tail_mask = 0xFFFF >> (16 - remainder);
+      for (int64 i = 1; i < num_features; ++i) {
+        const T* x_i = x + i * dim;
+        for (int64 j = 0; j < i; ++j) {
+          const T* x_j = x + j * dim;
+          __m512 acc = _mm512_setzero_ps();
+          for (int64 d = 0; d < dim - remainder; d += 16) {
+            acc = _mm512_fmadd_ps(_mm512_loadu_ps(x_i + d),
+                                  _mm512_loadu_ps(x_j + d), acc);
+          }
+          if (remainder) {
+            acc = _mm512_fmadd_ps(
+                _mm512_maskz_loadu_ps(tail_mask, x_i + dim - remainder),
+                _mm512_maskz_loadu_ps(tail_mask, x_j + dim - remainder), acc);
+          }
+          *out++ = _mm512_reduce_add_ps(acc);
+        }
+      }
+#else
+      for (int64 i = 1; i < num_features; ++i) {
+        const T* x_i = x + i * dim;
+        for (int64 j = 0; j < i; ++j) {
+          const T* x_j = x + j * dim;
+          T dot = 0;
+          for (int64 d = 0; d < dim; ++d) {
+            dot += x_i[d] * x_j[d];
+          }
+          *out++ = dot;
+        }
+      }
+#endif
+    }
+  }
+};
+
+REGISTER_KERNEL_BUILDER(Name("FusedInteractionDot")         \
+                            .Device(DEVICE_CPU)             \
+                            .TypeConstraint<float>("T"),    \
+                        FusedInteractionDotOp<float>);
+
+// interactions[b, i * (i - 1) / 2 + j] = dot(x[b, i], x[b, j]), so every pair
+// (i, j) contributes its incoming gradient to both rows:
+//   x_grad[b, i] += g * x[b, j] and x_grad[b, j] += g * x[b, i].
+// One walk over the packed gradient touches each pair once; batches are
+// independent, so parallelizing over the batch keeps each output row owned
+// by one thread.
+template <typename T>
+class FusedInteractionDotGradOp : public OpKernel {
+public:
+  explicit FusedInteractionDotGradOp(OpKernelConstruction* context)
+      : OpKernel(context) {}
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor* grad_tensor = &context->input(0);
+    const Tensor* features_tensor = &context->input(1);
+    OP_REQUIRES(context, features_tensor->dims() == 3,
+                errors::InvalidArgument(
+                    "features must be 3-D [batch, num_features, dim], got ",
+                    features_tensor->shape().DebugString()));
+    const int64 batch = features_tensor->dim_size(0);
+    const int64 num_features = features_tensor->dim_size(1);
+    const int64 dim = features_tensor->dim_size(2);
+    const int64 output_dim = num_features * (num_features - 1) / 2;
+    OP_REQUIRES(context,
+                grad_tensor->dims() == 2 &&
+                    grad_tensor->dim_size(0) == batch &&
+                    grad_tensor->dim_size(1) == output_dim,
+                errors::InvalidArgument(
+                    "interactions_grad must be [", batch, ", ", output_dim,
+                    "], got ", grad_tensor->shape().DebugString()));
+    const T* grad = grad_tensor->flat<T>().data();
+    const T* features = features_tensor->flat<T>().data();
+
+    Tensor* features_grad_tensor = nullptr;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(0, features_tensor->shape(),
+                                            &features_grad_tensor));
+    T* features_grad = features_grad_tensor->flat<T>().data();
+    if (batch == 0) return;
+
+    const int64 unit_cost = output_dim * dim * 8;
+    auto& worker_threads = *(context->device()->tensorflow_cpu_worker_threads());
+    thread::ThreadPool* thread_pool = worker_threads.workers;
+
+    thread_pool->ParallelFor(batch, unit_cost,
+        [&grad, &features, &features_grad, num_features, dim, output_dim,
+         this](int64 begin_batch, int64 end_batch) {
+          backward(grad, features, features_grad, begin_batch, end_batch,
+                   num_features, dim, output_dim);
+        });
+  }
+
+private:
+  void backward(const T* grad, const T* features, T* features_grad,
+                int64 begin_batch, int64 end_batch, int64 num_features,
+                int64 dim, int64 output_dim) {
+    for (int64 b = begin_batch; b < end_batch; ++b) {
+      const T* g = grad + b * output_dim;
+      const T* x = features + b * num_features * dim;
+      T* x_grad = features_grad + b * num_features * dim;
+      memset(x_grad, 0, num_features * dim * sizeof(T));
+#if defined(__GNUC__) && (__GNUC__ > 6) && (__AVX512F__)
+      const int64 remainder = dim & 0x0F;
+      const __mmask16 tail_mask = 0xFFFF >> (16 - remainder);
+      for (int64 i = 1; i < num_features; ++i) {
+        const T* x_i = x + i * dim;
+        T* x_grad_i = x_grad + i * dim;
+        for (int64 j = 0; j < i; ++j) {
+          const T* x_j = x + j * dim;
+          T* x_grad_j = x_grad + j * dim;
+          __m512 coeff = _mm512_set1_ps(*g++);
+          for (int64 d = 0; d < dim - remainder; d += 16) {
+            _mm512_storeu_ps(
+                x_grad_i + d,
+                _mm512_fmadd_ps(coeff, _mm512_loadu_ps(x_j + d),
+                                _mm512_loadu_ps(x_grad_i + d)));
+            _mm512_storeu_ps(
+                x_grad_j + d,
+                _mm512_fmadd_ps(coeff, _mm512_loadu_ps(x_i + d),
+                                _mm512_loadu_ps(x_grad_j + d)));
+          }
+          if (remainder) {
+            const int64 d = dim - remainder;
+            _mm512_mask_storeu_ps(
+                x_grad_i + d, tail_mask,
+                _mm512_fmadd_ps(coeff,
+                                _mm512_maskz_loadu_ps(tail_mask, x_j + d),
+                                _mm512_maskz_loadu_ps(tail_mask,
+                                                      x_grad_i + d)));
+            _mm512_mask_storeu_ps(
+                x_grad_j + d, tail_mask,
+                _mm512_fmadd_ps(coeff,
+                                _mm512_maskz_loadu_ps(tail_mask, x_i + d),
+                                _mm512_maskz_loadu_ps(tail_mask,
+                                                      x_grad_j + d)));
+          }
+        }
+      }
+#else
+      for (int64 i = 1; i < num_features; ++i) {
+        const T* x_i = x + i * dim;
+        T* x_grad_i = x_grad + i * dim;
+        for (int64 j = 0; j < i; ++j) {
+          const T* x_j = x + j * dim;
+          T* x_grad_j = x_grad + j * dim;
+          const T coeff = *g++;
+          for (int64 d = 0; d < dim; ++d) {
+            x_grad_i[d] += coeff * x_j[d];
+            x_grad_j[d] += coeff * x_i[d];
+          }
+        }
+      }
+#endif
+    }
+  }
+};
+
+REGISTER_KERNEL_BUILDER(Name("FusedInteractionDotGrad")     \
+                            .Device(DEVICE_CPU)             \
+                            .TypeConstraint<float>("T"),    \
+                        FusedInteractionDotGradOp<float>);
+
+}  // namespace tensorflow
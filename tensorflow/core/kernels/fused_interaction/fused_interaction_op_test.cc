@@ -0,0 +1,165 @@
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/kernels/ops_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/public/session.h"
+#include "tensorflow/cc/ops/standard_ops.h"
+
+namespace tensorflow {
+namespace {
+
+class FusedInteractionDotOpTest : public OpsTestBase {
+ protected:
+  void MakeOp(DataType dtype) {
+    TF_EXPECT_OK(NodeDefBuilder("fused_interaction_dot", "FusedInteractionDot")
+                     .Attr("T", dtype)
+                     .Input(FakeInput(dtype))
+                     .Finalize(node_def()));
+    TF_EXPECT_OK(InitOp());
+  }
+};
+
+TEST_F(FusedInteractionDotOpTest, PacksLowerTriangle_Float) {
+  const int batch = 2;
+  const int num_features = 3;
+  const int dim = 17;  // exercise the 16-wide remainder path
+
+  MakeOp(DT_FLOAT);
+
+  float input_array[batch * num_features * dim];
+  for (int i = 0; i < batch * num_features * dim; i++) {
+    input_array[i] = 0.25f * ((i * 7) % 11) - 1.0f;
+  }
+  AddInputFromArray<float>(TensorShape({batch, num_features, dim}),
+                           input_array);
+
+  TF_ASSERT_OK(RunOpKernel());
+  TF_EXPECT_OK(device_->Sync());
+
+  const int output_dim = num_features * (num_features - 1) / 2;
+  Tensor expected_output(allocator(), DT_FLOAT,
+                         TensorShape({batch, output_dim}));
+  float output_array[batch * output_dim];
+  for (int b = 0; b < batch; b++) {
+    int out_idx = 0;
+    for (int i = 1; i < num_features; i++) {
+      for (int j = 0; j < i; j++) {
+        float dot = 0.0f;
+        for (int d = 0; d < dim; d++) {
+          dot += input_array[(b * num_features + i) * dim + d] *
+                 input_array[(b * num_features + j) * dim + d];
+        }
+        output_array[b * output_dim + out_idx++] = dot;
+      }
+    }
+  }
+  test::FillValues<float>(&expected_output, output_array);
+  test::ExpectTensorNear<float>(expected_output, *GetOutput(0), 1e-5);
+}
+
+class FusedInteractionDotGradOpTest : public OpsTestBase {
+ protected:
+  void MakeOp(DataType dtype) {
+    TF_EXPECT_OK(NodeDefBuilder("fused_interaction_dot_grad",
+                                "FusedInteractionDotGrad")
+                     .Attr("T", dtype)
+                     .Input(FakeInput(dtype))
+                     .Input(FakeInput(dtype))
+                     .Finalize(node_def()));
+    TF_EXPECT_OK(InitOp());
+  }
+};
+
+TEST_F(FusedInteractionDotGradOpTest, AccumulatesBothRows_Float) {
+  const int batch = 2;
+  const int num_features = 4;
+  const int dim = 17;
+  const int output_dim = num_features * (num_features - 1) / 2;
+
+  MakeOp(DT_FLOAT);
+
+  float grad_array[batch * output_dim];
+  for (int i = 0; i < batch * output_dim; i++) {
+    grad_array[i] = 0.5f * ((i % 5) - 2);
+  }
+  float input_array[batch * num_features * dim];
+  for (int i = 0; i < batch * num_features * dim; i++) {
+    input_array[i] = 0.25f * ((i * 3) % 13) - 1.5f;
+  }
+  AddInputFromArray<float>(TensorShape({batch, output_dim}), grad_array);
+  AddInputFromArray<float>(TensorShape({batch, num_features, dim}),
+                           input_array);
+
+  TF_ASSERT_OK(RunOpKernel());
+  TF_EXPECT_OK(device_->Sync());
+
+  Tensor expected_output(allocator(), DT_FLOAT,
+                         TensorShape({batch, num_features, dim}));
+  float output_array[batch * num_features * dim];
+  for (int i = 0; i < batch * num_features * dim; i++) {
+    output_array[i] = 0.0f;
+  }
+  for (int b = 0; b < batch; b++) {
+    int g_idx = 0;
+    for (int i = 1; i < num_features; i++) {
+      for (int j = 0; j < i; j++) {
+        float g = grad_array[b * output_dim + g_idx++];
+        for (int d = 0; d < dim; d++) {
+          output_array[(b * num_features + i) * dim + d] +=
+              g * input_array[(b * num_features + j) * dim + d];
+          output_array[(b * num_features + j) * dim + d] +=
+              g * input_array[(b * num_features + i) * dim + d];
+        }
+      }
+    }
+  }
+  test::FillValues<float>(&expected_output, output_array);
+  test::ExpectTensorNear<float>(expected_output, *GetOutput(0), 1e-5);
+}
+
+//----------------------------------------------------------------------------//
+// Performance benchmarks                                                     //
+//----------------------------------------------------------------------------//
+static Graph* FusedInteractionDot(int batch, int num_features, int dim) {
+  Graph* g = new Graph(OpRegistry::Global());
+  DataType dtype = DT_FLOAT;
+
+  Tensor in(dtype, TensorShape({batch, num_features, dim}));
+  in.flat<float>().setRandom();
+
+  Node* input_in = test::graph::Constant(g, in);
+  auto nodeBuilder = NodeBuilder(g->NewName("n"), "FusedInteractionDot")
+                    .Input(input_in)
+                    .Attr("T", dtype);
+  TF_CHECK_OK(nodeBuilder.Finalize(g, nullptr));
+
+  return g;
+}
+
+#define BM_FusedInteractionDot(BATCH, N, DIM, NTH)                              \
+  static void BM_FusedInteractionDot##_##BATCH##_##N##_##DIM##_##NTH##_CPU(     \
+  int iters) {                                                                  \
+  testing::UseRealTime();                                                       \
+  testing::ItemsProcessed(static_cast<int64>(iters) * BATCH *                   \
+                          (N * (N - 1) / 2) * DIM);                             \
+  SessionOptions opts;                                                          \
+  opts.config.set_intra_op_parallelism_threads(NTH);                            \
+  test::Benchmark("cpu", FusedInteractionDot(BATCH, N, DIM), &opts).Run(iters); \
+  }                                                                             \
+  BENCHMARK(BM_FusedInteractionDot##_##BATCH##_##N##_##DIM##_##NTH##_CPU);      \
+
+#define BM_FusedInteractionDot_NTH(BATCH, N, DIM)  \
+  BM_FusedInteractionDot(BATCH, N, DIM, 1);        \
+  BM_FusedInteractionDot(BATCH, N, DIM, 4);        \
+  BM_FusedInteractionDot(BATCH, N, DIM, 8);        \
+
+BM_FusedInteractionDot_NTH(512, 27, 16);
+BM_FusedInteractionDot_NTH(512, 27, 64);
+BM_FusedInteractionDot_NTH(2048, 27, 16);
+}
+}
@@ -65,25 +65,47 @@ public:
     int64 remainder_block_num = remainder_128 >> 4;  // 16-size block num in 128-remainder
     int64 remainder_block_num_total = remainder_block_num+ !!remainder_16;  // total 16-size block num in remainder
 
+    // Serving traffic concentrates on a few embedding dimensions, so hot row
+    // lengths are dispatched to shape-specialized instantiations where the
+    // trip counts are compile-time constants and the remainder handling folds
+    // away. Other shapes fall back to the generic variant.
+    auto forward_fn = &FusedL2NormalizeOp::forward_avx512<8>;
+    switch (cols) {
+      case 32: forward_fn = &FusedL2NormalizeOp::forward_avx512<8, 32>; break;
+      case 64: forward_fn = &FusedL2NormalizeOp::forward_avx512<8, 64>; break;
+      case 128: forward_fn = &FusedL2NormalizeOp::forward_avx512<8, 128>; break;
+      case 256: forward_fn = &FusedL2NormalizeOp::forward_avx512<8, 256>; break;
+      case 512: forward_fn = &FusedL2NormalizeOp::forward_avx512<8, 512>; break;
+    }
+
     thread_pool->ParallelFor(total_unit, unit_cost, [&input, &output, rows, cols, block_num, remainder_block_num,
-         remainder_block_num_total, remainder_128, remainder_16, this](int64 begin_unit, int64 end_unit) {
+         remainder_block_num_total, remainder_128, remainder_16, forward_fn, this](int64 begin_unit, int64 end_unit) {
           auto begin_row = begin_unit * BLOCK_SIZE;
           auto end_row = end_unit * BLOCK_SIZE;
           if (end_row > rows) {
             end_row = rows;
           }
-          forward_avx512<8>(input, output, begin_row, end_row, cols, block_num, remainder_block_num,
+          (this->*forward_fn)(input, output, begin_row, end_row, cols, block_num, remainder_block_num,
                                remainder_block_num_total, remainder_128, remainder_16);
         });
 #else
-    thread_pool->ParallelFor(total_unit, unit_cost, 
-         [&input, &output, rows, cols, this](int64 begin_unit, int64 end_unit) {
+    auto forward_fn = &FusedL2NormalizeOp::forward<8>;
+    switch (cols) {
+      case 32: forward_fn = &FusedL2NormalizeOp::forward<8, 32>; break;
+      case 64: forward_fn = &FusedL2NormalizeOp::forward<8, 64>; break;
+      case 128: forward_fn = &FusedL2NormalizeOp::forward<8, 128>; break;
+      case 256: forward_fn = &FusedL2NormalizeOp::forward<8, 256>; break;
+      case 512: forward_fn = &FusedL2NormalizeOp::forward<8, 512>; break;
+    }
+
+    thread_pool->ParallelFor(total_unit, unit_cost,
+         [&input, &output, rows, cols, forward_fn, this](int64 begin_unit, int64 end_unit) {
           auto begin_row = begin_unit * BLOCK_SIZE;
           auto end_row = end_unit * BLOCK_SIZE;
           if (end_row > rows) {
             end_row = rows;
           }
-          forward<8>(input, output, begin_row, end_row, cols);
+          (this->*forward_fn)(input, output, begin_row, end_row, cols);
         });
 #endif
   }
@@ -94,9 +116,14 @@ private:
   // temp = tf.math.maximum(temp, epsilon)
   // temp = tf.math.rsqrt(temp)
   // outputs = tf.math.multiply(temp, inputs)
-  template <int SUM_BLOCK_SIZE>
+  // A non-zero SPEC_COLS bakes the row length into the instantiation so the
+  // loop bounds are compile-time constants (see the dispatch in Compute).
+  template <int SUM_BLOCK_SIZE, int64 SPEC_COLS = 0>
   void forward(const T* input, T* output, int64 begin_row, int64 end_row,
                int64 cols) {
+    if (SPEC_COLS != 0) {
+      cols = SPEC_COLS;
+    }
     int64 remainder = cols % SUM_BLOCK_SIZE;
     for (int64 i = begin_row; i < end_row; ++i) {
       T row_sum = 0;
@@ -131,9 +158,20 @@ private:
   }
 
 #if defined(__GNUC__) && (__GNUC__ > 6) && (__AVX512F__)
-  template <int SUM_BLOCK_SIZE>
+  template <int SUM_BLOCK_SIZE, int64 SPEC_COLS = 0>
   void forward_avx512(const T* input, T* output, int64 begin_row, int64 end_row, int64 cols, int64 block_num, int64 remainder_block_num,
                          int64 remainder_block_num_total, int64 remainder_128, int64 remainder_16) {
+    if (SPEC_COLS != 0) {
+      // Shape-specialized instantiation: recompute the bounds from the
+      // compile-time row length so they constant-fold and the remainder
+      // paths vanish for 128-aligned shapes.
+      cols = SPEC_COLS;
+      block_num = SPEC_COLS >> 7;
+      remainder_128 = SPEC_COLS & 0x7F;
+      remainder_16 = remainder_128 & 0x0F;
+      remainder_block_num = remainder_128 >> 4;
+      remainder_block_num_total = remainder_block_num + !!remainder_16;
+    }
     for (int64 i = begin_row; i < end_row; ++i) {
       float row_sum = 0.0;
       // Sum of squares of the inputs
@@ -286,25 +324,45 @@ public:
     int64 remainder_block_num = remainder_128 >> 4;  // 16-size block num in 128-remainder
     int64 remainder_block_num_total = remainder_block_num+ !!remainder_16;  // total 16-size block num in remainder
 
+    // Same shape-specialized dispatch as the forward kernel: hot row lengths
+    // get instantiations whose loop bounds are compile-time constants.
+    auto backward_fn = &FusedL2NormalizeGradOp::backward_avx512<8>;
+    switch (cols) {
+      case 32: backward_fn = &FusedL2NormalizeGradOp::backward_avx512<8, 32>; break;
+      case 64: backward_fn = &FusedL2NormalizeGradOp::backward_avx512<8, 64>; break;
+      case 128: backward_fn = &FusedL2NormalizeGradOp::backward_avx512<8, 128>; break;
+      case 256: backward_fn = &FusedL2NormalizeGradOp::backward_avx512<8, 256>; break;
+      case 512: backward_fn = &FusedL2NormalizeGradOp::backward_avx512<8, 512>; break;
+    }
+
     thread_pool->ParallelFor(total_unit, unit_cost, [&y_grad, &x, &x_grad, rows, cols, block_num, remainder_block_num,
-         remainder_block_num_total, remainder_128, remainder_16, this](int64 begin_unit, int64 end_unit) {
+         remainder_block_num_total, remainder_128, remainder_16, backward_fn, this](int64 begin_unit, int64 end_unit) {
           auto begin_row = begin_unit * BLOCK_SIZE;
           auto end_row = end_unit * BLOCK_SIZE;
           if (end_row > rows) {
             end_row = rows;
           }
-          backward_avx512<8>(y_grad, x, x_grad, begin_row, end_row, cols, block_num, 
+          (this->*backward_fn)(y_grad, x, x_grad, begin_row, end_row, cols, block_num,
                                remainder_block_num, remainder_block_num_total, remainder_128, remainder_16);
         });
 #else
-    thread_pool->ParallelFor(total_unit, unit_cost, 
-         [&y_grad, &x, &x_grad, rows, cols, this](int64 begin_unit, int64 end_unit) {
+    auto backward_fn = &FusedL2NormalizeGradOp::backward<8>;
+    switch (cols) {
+      case 32: backward_fn = &FusedL2NormalizeGradOp::backward<8, 32>; break;
+      case 64: backward_fn = &FusedL2NormalizeGradOp::backward<8, 64>; break;
+      case 128: backward_fn = &FusedL2NormalizeGradOp::backward<8, 128>; break;
+      case 256: backward_fn = &FusedL2NormalizeGradOp::backward<8, 256>; break;
+      case 512: backward_fn = &FusedL2NormalizeGradOp::backward<8, 512>; break;
+    }
+
+    thread_pool->ParallelFor(total_unit, unit_cost,
+         [&y_grad, &x, &x_grad, rows, cols, backward_fn, this](int64 begin_unit, int64 end_unit) {
           auto begin_row = begin_unit * BLOCK_SIZE;
           auto end_row = end_unit * BLOCK_SIZE;
           if (end_row > rows) {
             end_row = rows;
           }
-          backward<8>(y_grad, x, x_grad, begin_row, end_row, cols);
+          (this->*backward_fn)(y_grad, x, x_grad, begin_row, end_row, cols);
         });
 #endif
   }
@@ -314,9 +372,14 @@ private:
   // keepdims=True) + 1e-12) # rsqrt quickly sum = tf.math.reduce_sum(y_grad *
   // x, reduction_indices=1, keepdims=True) grad_x = y_grad * rvar - x * ((sum *
   // rvar) * (rvar * rvar))
-  template <int SUM_BLOCK_SIZE>
+  // A non-zero SPEC_COLS bakes the row length into the instantiation so the
+  // loop bounds are compile-time constants (see the dispatch in Compute).
+  template <int SUM_BLOCK_SIZE, int64 SPEC_COLS = 0>
   void backward(const float* y_grad, const float* x, float* x_grad,
                 int64 begin_row, int64 end_row, int64 cols) {
+    if (SPEC_COLS != 0) {
+      cols = SPEC_COLS;
+    }
     int64 remainder = cols % SUM_BLOCK_SIZE;
     for (int64 i = begin_row; i < end_row; ++i) {
       T x_row_sum = 0.0;
@@ -365,10 +428,21 @@ private:
   }
 
 #if defined(__GNUC__) && (__GNUC__ > 6) && (__AVX512F__)
-  template <int SUM_BLOCK_SIZE>
+  template <int SUM_BLOCK_SIZE, int64 SPEC_COLS = 0>
   void backward_avx512(const float* y_grad, const float* x, float* x_grad, int64 begin_row, int64 end_row, int64 cols,
                           int64 block_num, int64 remainder_block_num, int64 remainder_block_num_total, int64 remainder_128,
                           int64 remainder_16) {
+    if (SPEC_COLS != 0) {
+      // Shape-specialized instantiation: recompute the bounds from the
+      // compile-time row length so they constant-fold and the remainder
+      // paths vanish for 128-aligned shapes.
+      cols = SPEC_COLS;
+      block_num = SPEC_COLS >> 7;
+      remainder_128 = SPEC_COLS & 0x7F;
+      remainder_16 = remainder_128 & 0x0F;
+      remainder_block_num = remainder_128 >> 4;
+      remainder_block_num_total = remainder_block_num + !!remainder_16;
+    }
     for (int64 i = begin_row; i < end_row; ++i) {
       T x_row_sum = 0.0;
       T y_grad_row_sum = 0.0;
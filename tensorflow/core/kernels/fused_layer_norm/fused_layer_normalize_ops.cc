@@ -81,6 +81,30 @@ class FusedLayerNormOp : public OpKernel {
         *(context->device()->tensorflow_cpu_worker_threads());
     thread::ThreadPool* thread_pool = worker_threads.workers;
 
+    // Hot row lengths (the usual hidden sizes) are dispatched to
+    // shape-specialized instantiations whose loop bounds are compile-time
+    // constants, so the remainder handling folds away. Other shapes fall
+    // back to the generic variant.
+#ifdef __AVX512F__
+    auto forward_fn = &FusedLayerNormOp::forward_avx512<0>;
+    switch (cols) {
+      case 32: forward_fn = &FusedLayerNormOp::forward_avx512<32>; break;
+      case 64: forward_fn = &FusedLayerNormOp::forward_avx512<64>; break;
+      case 128: forward_fn = &FusedLayerNormOp::forward_avx512<128>; break;
+      case 256: forward_fn = &FusedLayerNormOp::forward_avx512<256>; break;
+      case 512: forward_fn = &FusedLayerNormOp::forward_avx512<512>; break;
+    }
+#else
+    auto forward_fn = &FusedLayerNormOp::forward<0>;
+    switch (cols) {
+      case 32: forward_fn = &FusedLayerNormOp::forward<32>; break;
+      case 64: forward_fn = &FusedLayerNormOp::forward<64>; break;
+      case 128: forward_fn = &FusedLayerNormOp::forward<128>; break;
+      case 256: forward_fn = &FusedLayerNormOp::forward<256>; break;
+      case 512: forward_fn = &FusedLayerNormOp::forward<512>; break;
+    }
+#endif  //AVX512F
+
     thread_pool->ParallelFor(total_unit, unit_cost,
         [&](int64 begin_unit, int64 end_unit) {
           auto begin_row = begin_unit * 16;
@@ -89,10 +113,10 @@ class FusedLayerNormOp : public OpKernel {
             end_row = rows;
           }
 #ifdef __AVX512F__
-          forward_avx512(input, gamma, beta, output, mean, rvariance, cols, begin_row, end_row, block_num, 
+          (this->*forward_fn)(input, gamma, beta, output, mean, rvariance, cols, begin_row, end_row, block_num,
                          remainder_block_num, remainder_block_num_total, remainder_128, remainder_16, one_over_cols);
 #else
-          forward(input, gamma, beta, output, mean, rvariance, cols, begin_row, end_row, one_over_cols);
+          (this->*forward_fn)(input, gamma, beta, output, mean, rvariance, cols, begin_row, end_row, one_over_cols);
 #endif  //AVX512F
         });
   }
@@ -100,8 +124,14 @@ class FusedLayerNormOp : public OpKernel {
 
  private:
 // Compute the rows locate in the range of [begin_row, begin_row + ROWS)
-  void forward(const float* input, const float* gamma, const float* beta, float* output, float* mean, 
+  // A non-zero SPEC_COLS bakes the row length into the instantiation so the
+  // loop bounds are compile-time constants (see the dispatch in Compute).
+  template <int64 SPEC_COLS = 0>
+  void forward(const float* input, const float* gamma, const float* beta, float* output, float* mean,
                               float* rvariance, int64 cols, int64 begin_row, int64 end_row, const float one_over_cols) {
+    if (SPEC_COLS != 0) {
+      cols = SPEC_COLS;
+    }
     for (int64 i = begin_row; i < end_row; i++){
       // Sum
       int64 j = 0;
@@ -172,10 +202,22 @@ class FusedLayerNormOp : public OpKernel {
 
 #ifdef __AVX512F__
   // AVX512 block size = 8; pack 8 * 16 = 128;
-  inline void forward_avx512(const float* input, const float* gamma, const float* beta, float* output, 
+  template <int64 SPEC_COLS = 0>
+  inline void forward_avx512(const float* input, const float* gamma, const float* beta, float* output,
                               float* mean, float* rvariance, int64 cols, int64 begin_row, int64 end_row,
-                              int64 block_num, int64 remainder_block_num,int64 remainder_block_num_total, 
+                              int64 block_num, int64 remainder_block_num,int64 remainder_block_num_total,
                               int64 remainder_128, int64 remainder_16, const float one_over_cols) {
+    if (SPEC_COLS != 0) {
+      // Shape-specialized instantiation: recompute the bounds from the
+      // compile-time row length so they constant-fold and the remainder
+      // paths vanish for 128-aligned shapes.
+      cols = SPEC_COLS;
+      block_num = SPEC_COLS >> 7;
+      remainder_128 = SPEC_COLS & 0x7F;
+      remainder_16 = remainder_128 & 0x0F;
+      remainder_block_num = remainder_128 >> 4;
+      remainder_block_num_total = remainder_block_num + !!remainder_16;
+    }
     for (int64 i = begin_row; i < end_row; ++i) {
       // Sum
       for (int64 j = 0; j < block_num; ++j) {
@@ -353,20 +395,38 @@ class FusedLayerNormGradOp : public OpKernel {
         *(context->device()->tensorflow_cpu_worker_threads());
     thread::ThreadPool* thread_pool = worker_threads.workers;
 
+    // Same shape-specialized dispatch as the forward kernel: hot row lengths
+    // get instantiations whose loop bounds are compile-time constants.
 #ifdef __AVX512F__
+    auto backward_fn = &FusedLayerNormGradOp::backward<0>;
+    switch (cols) {
+      case 32: backward_fn = &FusedLayerNormGradOp::backward<32>; break;
+      case 64: backward_fn = &FusedLayerNormGradOp::backward<64>; break;
+      case 128: backward_fn = &FusedLayerNormGradOp::backward<128>; break;
+      case 256: backward_fn = &FusedLayerNormGradOp::backward<256>; break;
+      case 512: backward_fn = &FusedLayerNormGradOp::backward<512>; break;
+    }
     const int total_unit = (rows >= 128 ? 8 : (rows + 15) / 16);
-    const int64 rows_per_unit = (rows + total_unit - 1) / total_unit; 
+    const int64 rows_per_unit = (rows + total_unit - 1) / total_unit;
     const int64 unit_cost = rows_per_unit * cols * 100;
-    thread_pool->ParallelFor(total_unit, unit_cost, 
-        [&](int64 begin_unit, int64 end_unit) 
-        {auto begin_row = begin_unit * rows_per_unit; 
-            auto end_row = end_unit * rows_per_unit; 
-            if (end_row > rows) 
+    thread_pool->ParallelFor(total_unit, unit_cost,
+        [&](int64 begin_unit, int64 end_unit)
+        {auto begin_row = begin_unit * rows_per_unit;
+            auto end_row = end_unit * rows_per_unit;
+            if (end_row > rows)
             {end_row = rows;}
-            backward(y_grad, x, mean, rvariance, gamma, x_grad, gamma_grad,
-                     beta_grad, cols, begin_row, end_row); 
-        }); 
+            (this->*backward_fn)(y_grad, x, mean, rvariance, gamma, x_grad,
+                     gamma_grad, beta_grad, cols, begin_row, end_row);
+        });
 #else
+    auto backward_fn = &FusedLayerNormGradOp::backward<0>;
+    switch (cols) {
+      case 32: backward_fn = &FusedLayerNormGradOp::backward<32>; break;
+      case 64: backward_fn = &FusedLayerNormGradOp::backward<64>; break;
+      case 128: backward_fn = &FusedLayerNormGradOp::backward<128>; break;
+      case 256: backward_fn = &FusedLayerNormGradOp::backward<256>; break;
+      case 512: backward_fn = &FusedLayerNormGradOp::backward<512>; break;
+    }
     const float one_over_cols = 1.0f / cols;
     const int64 total_unit = (rows + 15) / 16;
     const int64 unit_cost =
@@ -379,26 +439,30 @@ class FusedLayerNormGradOp : public OpKernel {
           if (end_row > rows) {
             end_row = rows;
           }
-          backward(y_grad, x, mean, rvariance, gamma, x_grad, gamma_grad,
-                   beta_grad, begin_row, end_row, cols, one_over_cols);
+          (this->*backward_fn)(y_grad, x, mean, rvariance, gamma, x_grad,
+                   gamma_grad, beta_grad, begin_row, end_row, cols,
+                   one_over_cols);
         });
 #endif // backward compute
   }
 
  private:
 #ifdef __AVX512F__
+  // A non-zero SPEC_COLS bakes the row length into the instantiation so the
+  // loop bounds are compile-time constants (see the dispatch in Compute).
+  template <int64 SPEC_COLS = 0>
   void backward(const float* diff, const float* x, const float* mean,
                    const float* rvariance, const float* gamma, float* x_diff,
                    float* gamma_diff, float* beta_diff, int64 cols,
                    int begin_row, int end_row) {
     int i = begin_row;
     for (; i + 3 < end_row; i += 4) {
-      backward_avx512<4>(diff, x, mean, rvariance, gamma, x_diff, gamma_diff,
-                       beta_diff, cols, i);
+      backward_avx512<4, SPEC_COLS>(diff, x, mean, rvariance, gamma, x_diff,
+                       gamma_diff, beta_diff, cols, i);
     }
     for (; i < end_row; ++i) {
-      backward_avx512<1>(diff, x, mean, rvariance, gamma, x_diff, gamma_diff,
-                       beta_diff, cols, i);
+      backward_avx512<1, SPEC_COLS>(diff, x, mean, rvariance, gamma, x_diff,
+                       gamma_diff, beta_diff, cols, i);
     }
   }
 #else
@@ -408,10 +472,16 @@ class FusedLayerNormGradOp : public OpKernel {
   //   grad from rvariance: sum_row(y_grad * gamma * (x - mean)) * (- [rvariance]^3) * (x - mean) / #cols
   // For gradient of gamma, grad = y_grad * (x - mean) * rvariance
   // For gradient of beta, grad = y_grad
+  // A non-zero SPEC_COLS bakes the row length into the instantiation so the
+  // loop bounds are compile-time constants (see the dispatch in Compute).
+  template <int64 SPEC_COLS = 0>
   void backward(const float* y_grad, const float* x, const float* mean,
                     const float* rvariance, const float* gamma, float* x_grad,
                     float* gamma_grad, float* beta_grad, int64 begin_row,
                     int64 end_row, int64 cols, const float one_over_cols) {
+    if (SPEC_COLS != 0) {
+      cols = SPEC_COLS;
+    }
     for (int64 i = begin_row; i < end_row; ++i) {
       int64 j = 0;
       float sum_m = 0;
@@ -517,12 +587,17 @@ class FusedLayerNormGradOp : public OpKernel {
 #endif // backward define
 
 #ifdef __AVX512F__
-  template <int ROWS>
+  template <int ROWS, int64 SPEC_COLS = 0>
   inline void backward_avx512(const float* y_grad, const float* x,
                               const float* mean, const float* rvariance,
                               const float* gamma, float* x_grad,
                               float* gamma_grad, float* beta_grad, int64 cols,
                               int64 start_row) {
+    if (SPEC_COLS != 0) {
+      // Shape-specialized instantiation: the bounds below constant-fold and
+      // the remainder path vanishes for 16-aligned shapes.
+      cols = SPEC_COLS;
+    }
     float sum_m[ROWS], sum_r[ROWS];
     __m512 vsum_m[ROWS], vsum_r[ROWS], vmean[ROWS], vrvariance[ROWS];
 
@@ -416,7 +416,18 @@ class IndicesIncrRecorder: public ResourceBase {
     std::vector<std::vector<K> > incr_keys_parts;
     incr_keys_parts.resize(kSavedPartitionNum);
 
+    // Keys recorded since the base save but evicted from the variable in
+    // the meantime become tombstones, so a merger can delete them from
+    // the base checkpoint instead of resurrecting stale rows. incr_keys
+    // is a std::set, so both the delta segments (within each partition)
+    // and the tombstone list come out sorted by key.
+    std::vector<K> tombstone_keys;
     for (auto& ik : incr_keys) {
+      ValuePtr<V>* value_ptr = nullptr;
+      if (!emb_var->LookupKey(ik, &value_ptr).ok()) {
+        tombstone_keys.push_back(ik);
+        continue;
+      }
       for (int partid = 0; partid < kSavedPartitionNum; partid++) {
         if (ik % kSavedPartitionNum == partid &&
             emb_var->GetFreq(ik) >= emb_var->MinFreq()) {
@@ -483,6 +494,15 @@ class IndicesIncrRecorder: public ResourceBase {
       free(dump_buffer);
       return st;
     }
+
+    IncrKeyDumpIterator<K> tombstone_dump_iter(tombstone_keys);
+    st = SaveTensorWithFixedBuffer(tensor_name + "-sparse_incr_tombstones",
+        writer, dump_buffer, bytes_limit, &tombstone_dump_iter,
+        TensorShape({tombstone_keys.size()}));
+    if (!st.ok()) {
+      free(dump_buffer);
+      return st;
+    }
     free(dump_buffer);
     return Status::OK();
   }
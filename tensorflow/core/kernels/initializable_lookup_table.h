@@ -153,6 +153,11 @@ class InitializableLookupTable : public LookupInterface {
   virtual Status DoFind(const Tensor& keys, Tensor* values,
                         const Tensor& default_value) = 0;
 
+  // Called once by Initialize() after the table is fully populated,
+  // while still holding mu_ and before the table is marked initialized.
+  // Lets implementations seal or share their backing storage.
+  virtual Status DoPostInitialize() { return Status::OK(); }
+
   virtual Status AreEntriesSame(const InitTableIterator& iter, bool* result);
 
   mutex mu_;
@@ -19,9 +19,18 @@ limitations under the License.
 #define EIGEN_USE_GPU
 #endif
 
+#include <atomic>
+#include <list>
+#include <unordered_map>
+
 #include "tensorflow/core/framework/bounds_check.h"
 #include "tensorflow/core/framework/embedding/cache.h"
+#include "tensorflow/core/framework/embedding/embedding_qos.h"
+#include "tensorflow/core/framework/embedding/read_snapshot.h"
+#include "tensorflow/core/framework/embedding/gather_result_cache.h"
+#include "tensorflow/core/framework/embedding/gpu_hot_key_cache.h"
 #include "tensorflow/core/framework/embedding/config.pb.h"
+#include "tensorflow/core/framework/embedding/frozen_embedding_var.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/resource_mgr.h"
@@ -33,6 +42,7 @@ limitations under the License.
 #include "tensorflow/core/kernels/training_op_helpers.h"
 #include "tensorflow/core/kernels/variable_ops.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/mem.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/types.h"
@@ -51,6 +61,34 @@ namespace {
 const int64 kEmbeddingVarUseDB = -214;
 const int64 kInitializableEmbeddingVarUseDB = -215;
 const char* kInferenceMode = "INFERENCE_MODE";
+
+// Self-tuning per-item cost for Shard(). The static estimates fed to
+// the work sharder (row bytes or a constant) miss the real per-key cost
+// of a hash lookup plus row copy, which varies with table size and
+// layout, so small batches get carved into pure-overhead shards while
+// large ones underparallelize. Each kernel instance measures the CPU
+// nanoseconds its shards actually spent per item and folds them into an
+// EWMA that seeds the next step's cost estimate.
+class AdaptiveShardCost {
+ public:
+  explicit AdaptiveShardCost(int64 initial_cost_ns)
+      : cost_ns_(initial_cost_ns) {}
+
+  int64 cost() const { return cost_ns_.load(std::memory_order_relaxed); }
+
+  void Update(int64 worked_ns, int64 items) {
+    if (worked_ns <= 0 || items <= 0) {
+      return;
+    }
+    const int64 per_item = std::max(worked_ns / items, static_cast<int64>(1));
+    const int64 current = cost_ns_.load(std::memory_order_relaxed);
+    cost_ns_.store(current + (per_item - current) / 4,
+                   std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<int64> cost_ns_;
+};
 }
 
 #define REGISTER_KV_VAR_HANDLE(ktype, vtype)                           \
@@ -138,10 +176,34 @@ class DestroyKvResourceOp : public OpKernel {
 REGISTER_KERNEL_BUILDER(Name("DestroyKvResourceOp").Device(DEVICE_CPU),
                         DestroyKvResourceOp);
 
+constexpr int64 DEFAULT_EV_INIT_THREAD_NUM = 4;
+
+// Dedicated pool for EmbeddingVar initialization. Jobs with hundreds
+// of tables used to serialize their InitializeKvVariableOp work on the
+// shared inter-op threads; scheduling the table setup here lets
+// independent tables build their storage managers concurrently while
+// the executor threads stay free for the rest of the init graph.
+class KvInitThreadPool {
+ public:
+  static thread::ThreadPool* GetInstance() {
+    static thread::ThreadPool tp(Env::Default(),
+        "init_ev_threadpool", ThreadNum());
+    return &tp;
+  }
+
+ private:
+  static int64 ThreadNum() {
+    int64 thread_num = DEFAULT_EV_INIT_THREAD_NUM;
+    TF_CHECK_OK(ReadInt64FromEnvVar("TF_EV_INIT_THREAD_NUM",
+          DEFAULT_EV_INIT_THREAD_NUM, &thread_num));
+    return thread_num;
+  }
+};
+
 template <typename TKey, typename TValue>
-class InitializeKvVariableOp : public OpKernel {
+class InitializeKvVariableOp : public AsyncOpKernel {
  public:
-  explicit InitializeKvVariableOp(OpKernelConstruction* c) : OpKernel(c) {
+  explicit InitializeKvVariableOp(OpKernelConstruction* c) : AsyncOpKernel(c) {
     OP_REQUIRES_OK(c, c->GetAttr("dtype", &dtype_));
     OP_REQUIRES_OK(c, c->GetAttr("counter_type", &counter_type_));
     OP_REQUIRES_OK(c, c->GetAttr("shape", &shape_));
@@ -219,15 +281,34 @@ class InitializeKvVariableOp : public OpKernel {
       layout_ = "normal_contiguous";
     }
     OP_REQUIRES_OK(c, c->GetAttr("ht_partition_num", &ht_partition_num_));
+    TF_CHECK_OK(ReadBoolFromEnvVar("TF_ENABLE_EV_ASYNC_INIT", true,
+                                   &ev_async_init_));
   }
 
-  void Compute(OpKernelContext* context) override {
+  void ComputeAsync(OpKernelContext* context, DoneCallback done) override {
+    // All the real work — building the storage manager and the default
+    // value table — happens inside the resource creator lambdas, so the
+    // whole body moves to the init pool. `done` is only called after
+    // SetInitialized, so downstream ops observe the same ordering as
+    // the old synchronous kernel.
+    auto do_compute = [this, context, done]() {
+      DoCompute(context, done);
+    };
+    if (ev_async_init_) {
+      KvInitThreadPool::GetInstance()->Schedule(do_compute);
+    } else {
+      do_compute();
+    }
+  }
+
+ private:
+  void DoCompute(OpKernelContext* context, const DoneCallback& done) {
     const Tensor& default_values = context->input(2);
 
-    OP_REQUIRES(context, dtype_ == default_values.dtype(),
+    OP_REQUIRES_ASYNC(context, dtype_ == default_values.dtype(),
                 errors::InvalidArgument(
                     "Variable and value dtypes don't match; respectively, ",
-                    dtype_, " and ", default_values.dtype()));
+                    dtype_, " and ", default_values.dtype()), done);
 
     ResourceHandle handle_self = HandleFromInput(context, 0);
     ResourceHandle handle_primary = HandleFromInput(context, 1);
@@ -238,7 +319,7 @@ class InitializeKvVariableOp : public OpKernel {
     if (handle_self.name() == handle_primary.name() &&
         handle_self.container() == handle_primary.container()) {
 
-      OP_REQUIRES_OK(context,
+      OP_REQUIRES_OK_ASYNC(context,
           LookupOrCreateResource<EmbeddingVar<TKey, TValue>>(
             context, handle_self, &ev,
             [this, default_values, opname, context,
@@ -263,11 +344,11 @@ class InitializeKvVariableOp : public OpKernel {
                              record_freq_, record_version_),
                          allocator);
             return Status::OK();
-            }));
+            }), done);
       ev->Init(default_values, default_value_dim_);
     } else {
       EmbeddingVar<TKey, TValue>* primary_variable = nullptr;
-      OP_REQUIRES_OK(
+      OP_REQUIRES_OK_ASYNC(
        context,
        LookupOrCreateResource<EmbeddingVar<TKey, TValue>>(
            context, handle_primary, &primary_variable,
@@ -293,9 +374,9 @@ class InitializeKvVariableOp : public OpKernel {
                         allocator);
             // default_values is slot value, should not to initialize primary value
             return Status::OK();
-           }));
+           }), done);
 
-      OP_REQUIRES_OK(
+      OP_REQUIRES_OK_ASYNC(
         context,
         LookupOrCreateResource<EmbeddingVar<TKey, TValue>>(
             context, handle_self, &ev,
@@ -315,16 +396,16 @@ class InitializeKvVariableOp : public OpKernel {
                                   record_freq_, record_version_),
                   primary_variable->GetAllocator());
              return (*ptr)->Init(default_values, default_value_dim_);
-            }));
+            }), done);
       core::ScopedUnref unref_me(primary_variable);
     }
     core::ScopedUnref unref_me(ev);
     if (steps_to_live_ != kEmbeddingVarUseDB) {
       ev->SetInitialized();
     }
+    done();
   }
 
- private:
   DataType dtype_;
   DataType counter_type_;
   TensorShape shape_;
@@ -348,6 +429,7 @@ class InitializeKvVariableOp : public OpKernel {
   float default_value_no_permission_;
   bool record_freq_;
   bool record_version_;
+  bool ev_async_init_;
 };
 
 #define REGISTER_KERNELS(ktype, vtype)                               \
@@ -446,6 +528,10 @@ class KvResourceGatherOp : public OpKernel {
     OP_REQUIRES_OK(c,
         c->GetAttr("is_use_default_value_tensor",
           &is_use_default_value_tensor_));
+    // Nodes serialized before the attr existed carry no default.
+    if (c->HasAttr("output_dim")) {
+      OP_REQUIRES_OK(c, c->GetAttr("output_dim", &output_dim_));
+    }
     if (is_use_default_value_tensor_) {
       get_default_v_fn_ = [](TValue* default_v, TKey id, int64 index,
                             int64 total_dim, int64 len) {
@@ -480,14 +566,24 @@ class KvResourceGatherOp : public OpKernel {
   }
 
   void Compute(OpKernelContext* c) override {
+    embedding::PinStepToReadEpoch(c);
     EmbeddingVar<TKey, TValue>* ev = nullptr;
-    OP_REQUIRES_OK(c, LookupResource(c, HandleFromInput(c, 0), &ev));
+    OP_REQUIRES_OK(c, LookupEmbeddingVarCached(c, &ev));
     core::ScopedUnref unref_me(ev);
     const Tensor& indices = c->input(1);
     const int64 N = indices.NumElements();
 
+    if (qos_ != nullptr && N > 0) {
+      qos_->Acquire(N);
+    }
+
+    const int64 value_len = ev->ValueLen();
+    OP_REQUIRES(c, output_dim_ <= value_len,
+        errors::InvalidArgument("output_dim ", output_dim_,
+            " exceeds the stored embedding width ", value_len));
+    const int64 out_dim = output_dim_ > 0 ? output_dim_ : value_len;
     TensorShape result_shape = indices.shape();
-    TensorShape value_shape({ev->ValueLen()});
+    TensorShape value_shape({out_dim});
     result_shape.AppendShape(value_shape);
 
     Tensor* out = nullptr;
@@ -510,31 +606,67 @@ class KvResourceGatherOp : public OpKernel {
       } else {
         default_v = ev->GetDefaultValuePtr();
       }
-      OP_REQUIRES(c, ev->ValueLen() == slice_elems,
+      OP_REQUIRES(c, out_dim == slice_elems,
           errors::InvalidArgument(
-              "ev's value_len should same with output's dimension(1)",
-              std::to_string(slice_elems), std::to_string(ev->ValueLen())));
+              "ev's output width should same with output's dimension(1)",
+              std::to_string(slice_elems), std::to_string(out_dim)));
       OP_REQUIRES(c, !ev->IsMultiLevel() || (ev->IsMultiLevel() && ev->CacheSize() >= N),
           errors::InvalidArgument(
               "MultiLevel EV's Cache size ", ev->CacheSize(),
               " should large than IDs in batch ", N));
-      const size_t slice_bytes = slice_elems * sizeof(TValue);
-      auto do_work = [this, indices_flat,
-           out_base, slice_elems, c, default_v, ev, counts] (
+      std::atomic<int64> worked_ns(0);
+      auto do_work = [this, indices_flat, out_base, slice_elems, value_len,
+           c, default_v, ev, counts, &worked_ns] (
                int64 start, int64 limit) {
-        for (int64 i = start; i < limit; ++i) {
-          TValue* default_v_ptr = get_default_v_fn_(
-              default_v, indices_flat(i), i, ev->GetDefaultValueDim(),
-              ev->ValueLen());
-          int32 count = get_count_fn_(counts, i);
-          lookup_fn_(ev, indices_flat(i),
-              out_base + i * slice_elems, default_v_ptr, count);
+        const uint64 begin_ns = Env::Default()->NowNanos();
+        embedding::GatherResultCache<TKey, TValue>* cache =
+            gather_cache_.get();
+        if (is_inference_ && cache == nullptr && slice_elems == value_len) {
+          // Inference reads neither create keys nor promote tiers, so
+          // the whole shard can be handed to the storage layer as one
+          // batched probe instead of a tier walk per key.
+          ev->BatchLookup(indices_flat.data() + start,
+                          out_base + start * slice_elems, limit - start,
+                          default_v);
+        } else if (slice_elems == value_len) {
+          for (int64 i = start; i < limit; ++i) {
+            TValue* out_ptr = out_base + i * slice_elems;
+            if (cache != nullptr && cache->Lookup(indices_flat(i), out_ptr)) {
+              continue;
+            }
+            TValue* default_v_ptr = get_default_v_fn_(
+                default_v, indices_flat(i), i, ev->GetDefaultValueDim(),
+                ev->ValueLen());
+            int32 count = get_count_fn_(counts, i);
+            lookup_fn_(ev, indices_flat(i), out_ptr, default_v_ptr, count);
+            if (cache != nullptr) {
+              cache->Insert(indices_flat(i), out_ptr);
+            }
+          }
+        } else {
+          // Prefix gather: the row is stored once at full width, the
+          // op serves its first slice_elems features.
+          std::vector<TValue> row(value_len);
+          for (int64 i = start; i < limit; ++i) {
+            TValue* default_v_ptr = get_default_v_fn_(
+                default_v, indices_flat(i), i, ev->GetDefaultValueDim(),
+                ev->ValueLen());
+            int32 count = get_count_fn_(counts, i);
+            lookup_fn_(ev, indices_flat(i), row.data(), default_v_ptr,
+                count);
+            memcpy(out_base + i * slice_elems, row.data(),
+                   slice_elems * sizeof(TValue));
+          }
         }
+        worked_ns.fetch_add(Env::Default()->NowNanos() - begin_ns,
+                            std::memory_order_relaxed);
       };
       auto worker_threads = c->device()->tensorflow_cpu_worker_threads();
       Shard(worker_threads->num_threads,
             worker_threads->workers, indices_size,
-            slice_bytes, do_work);
+            shard_cost_.cost(), do_work);
+      shard_cost_.Update(worked_ns.load(std::memory_order_relaxed),
+                         indices_size);
       ev->storage_manager()->Schedule([ev, indices]() {
         embedding::BatchCache<TKey>* cache = ev->Cache();
         if (cache) {
@@ -544,7 +676,65 @@ class KvResourceGatherOp : public OpKernel {
     }
   }
 
+  ~KvResourceGatherOp() override {
+    if (cached_ev_ != nullptr) {
+      cached_ev_->Unref();
+    }
+  }
+
   private:
+    // Resolves the EmbeddingVar behind input 0, serving repeat steps
+    // from a per-kernel cache so the ResourceMgr lock is only taken
+    // when the manager has mutated since the last resolution. The
+    // caller owns one ref on *ev.
+    Status LookupEmbeddingVarCached(OpKernelContext* c,
+                                    EmbeddingVar<TKey, TValue>** ev) {
+      const ResourceHandle& handle = HandleFromInput(c, 0);
+      ResourceMgr* mgr = c->resource_manager();
+      const int64 generation = mgr->generation();
+      {
+        mutex_lock l(cache_mu_);
+        if (cached_ev_ != nullptr && cached_generation_ == generation &&
+            cached_handle_.container() == handle.container() &&
+            cached_handle_.name() == handle.name()) {
+          cached_ev_->Ref();
+          *ev = cached_ev_;
+          return Status::OK();
+        }
+      }
+      TF_RETURN_IF_ERROR(LookupResource(c, handle, ev));
+      mutex_lock l(cache_mu_);
+      if (cached_ev_ != nullptr) {
+        cached_ev_->Unref();
+      }
+      (*ev)->Ref();
+      cached_ev_ = *ev;
+      cached_generation_ = generation;
+      cached_handle_ = handle;
+      // Buckets are immortal, so like the gather cache the pointer is
+      // resolved here under cache_mu_ and read unlocked in Compute.
+      qos_ = embedding::EmbeddingQosRegistry::GetInstance()->Lookup(
+          (*ev)->Name());
+      // A new resolution means the table behind the handle may have
+      // changed (e.g. restore); memoized rows are from the old version.
+      if (gather_cache_ != nullptr) {
+        gather_cache_->BumpEpoch();
+      } else if (is_inference_) {
+        // Inference serves immutable rows, so repeat keys can be
+        // memoized past the DRAM hash map entirely; see
+        // gather_result_cache.h. The sharded gather reads the pointer
+        // unlocked, ordered by this mutex.
+        const int64 slots =
+            embedding::GatherResultCache<TKey, TValue>::SlotsFromEnv();
+        if (slots > 0) {
+          gather_cache_.reset(new embedding::GatherResultCache<TKey, TValue>(
+              slots, (*ev)->ValueLen(),
+              embedding::GatherResultCache<TKey, TValue>::TtlNanosFromEnv()));
+        }
+      }
+      return Status::OK();
+    }
+
     bool is_use_default_value_tensor_;
     bool is_inference_;
     std::function<
@@ -552,6 +742,20 @@ class KvResourceGatherOp : public OpKernel {
     std::function<int32(int32*, int64)> get_count_fn_;
     std::function<void(EmbeddingVar<TKey, TValue>* ev,
       TKey key, TValue* val, TValue* default_v, int count)> lookup_fn_;
+    mutex cache_mu_;
+    EmbeddingVar<TKey, TValue>* cached_ev_ GUARDED_BY(cache_mu_) = nullptr;
+    int64 cached_generation_ GUARDED_BY(cache_mu_) = -1;
+    ResourceHandle cached_handle_ GUARDED_BY(cache_mu_);
+    // Inference-only memoization of gather results; created under
+    // cache_mu_ once the value width is known, then read unlocked.
+    std::unique_ptr<embedding::GatherResultCache<TKey, TValue>> gather_cache_;
+    // Per-table rate limit, or nullptr when no TF_EV_QOS_LIMITS rule
+    // matches; see embedding_qos.h.
+    embedding::TableQosBucket* qos_ = nullptr;
+    // -1 serves the full stored width.
+    int64 output_dim_ = -1;
+    // Seeded with a mid-range guess; converges within a few steps.
+    AdaptiveShardCost shard_cost_{1000};
 };
 
 #define REGISTER_GATHER_FULL(dev, ktype, vtype)                   \
@@ -573,6 +777,124 @@ TF_CALL_REAL_NUMBER_TYPES(REGISTER_GATHER_ALL_INDICES)
 #undef REGISTER_GATHER_ALL_INDICES
 #undef REGISTER_GATHER_FULL
 
+// Gathers from N embedding variables in one kernel invocation, sharding
+// jointly across variables and keys, so 400+ sparse features cost one
+// executor dispatch instead of one per feature.
+template <typename TKey, typename TValue>
+class GroupKvResourceGatherOp : public OpKernel {
+ public:
+  explicit GroupKvResourceGatherOp(OpKernelConstruction* c) : OpKernel(c) {
+    OP_REQUIRES_OK(c, c->GetAttr("N", &num_vars_));
+    OP_REQUIRES_OK(c, c->GetAttr("is_inference", &is_inference_));
+    bool is_inference;
+    TF_CHECK_OK(ReadBoolFromEnvVar(kInferenceMode, false, &is_inference));
+    is_inference_ |= is_inference;
+    if (!is_inference_) {
+      lookup_fn_ = [](EmbeddingVar<TKey, TValue>* ev, TKey key,
+                      TValue* val, TValue* default_v) {
+        ev->LookupOrCreate(key, val, default_v);
+      };
+    } else {
+      lookup_fn_ = [](EmbeddingVar<TKey, TValue>* ev, TKey key,
+                      TValue* val, TValue* default_v) {
+        ev->Lookup(key, val, default_v);
+      };
+    }
+  }
+
+  void Compute(OpKernelContext* c) override {
+    embedding::PinStepToReadEpoch(c);
+    std::vector<EmbeddingVar<TKey, TValue>*> evs(num_vars_);
+    std::vector<const TKey*> keys(num_vars_);
+    std::vector<int64> key_nums(num_vars_);
+    std::vector<int64> value_lens(num_vars_);
+    // Prefix sums over keys and output elements so a flat work index
+    // maps to (variable, key) and its output offset.
+    std::vector<int64> key_offsets(num_vars_ + 1);
+    std::vector<int64> out_offsets(num_vars_ + 1);
+    key_offsets[0] = 0;
+    out_offsets[0] = 0;
+    for (int i = 0; i < num_vars_; ++i) {
+      OP_REQUIRES_OK(c, LookupResource(c, HandleFromInput(c, i), &evs[i]));
+      const Tensor& indices = c->input(num_vars_ + i);
+      keys[i] = (const TKey*)indices.data();
+      key_nums[i] = indices.NumElements();
+      value_lens[i] = evs[i]->ValueLen();
+      key_offsets[i + 1] = key_offsets[i] + key_nums[i];
+      out_offsets[i + 1] = out_offsets[i] + key_nums[i] * value_lens[i];
+      OP_REQUIRES(c, !evs[i]->IsMultiLevel() ||
+          (evs[i]->IsMultiLevel() && evs[i]->CacheSize() >= key_nums[i]),
+          errors::InvalidArgument(
+              "MultiLevel EV's Cache size ", evs[i]->CacheSize(),
+              " should large than IDs in batch ", key_nums[i]));
+    }
+    Tensor* out = nullptr;
+    OP_REQUIRES_OK(c, c->allocate_output(
+        0, TensorShape({out_offsets[num_vars_]}), &out));
+    TValue* out_base = (TValue*)out->data();
+
+    const int64 total_keys = key_offsets[num_vars_];
+    if (total_keys > 0) {
+      const size_t avg_bytes =
+          out_offsets[num_vars_] / total_keys * sizeof(TValue);
+      auto do_work = [this, &evs, &keys, &key_offsets, &out_offsets,
+           &value_lens, out_base] (int64 start, int64 limit) {
+        int var = 0;
+        while (key_offsets[var + 1] <= start) {
+          ++var;
+        }
+        for (int64 w = start; w < limit; ++w) {
+          while (key_offsets[var + 1] <= w) {
+            ++var;
+          }
+          int64 i = w - key_offsets[var];
+          TValue* val = out_base + out_offsets[var] + i * value_lens[var];
+          lookup_fn_(evs[var], keys[var][i], val,
+                     evs[var]->GetDefaultValuePtr());
+        }
+      };
+      auto worker_threads = c->device()->tensorflow_cpu_worker_threads();
+      Shard(worker_threads->num_threads, worker_threads->workers,
+            total_keys, avg_bytes, do_work);
+    }
+
+    for (int i = 0; i < num_vars_; ++i) {
+      EmbeddingVar<TKey, TValue>* ev = evs[i];
+      if (ev->IsMultiLevel()) {
+        const Tensor& indices = c->input(num_vars_ + i);
+        ev->storage_manager()->Schedule([ev, indices]() {
+          embedding::BatchCache<TKey>* cache = ev->Cache();
+          if (cache) {
+            cache->add_to_rank(indices);
+          }
+        });
+      }
+      ev->Unref();
+    }
+  }
+
+ private:
+  int num_vars_;
+  bool is_inference_;
+  std::function<void(EmbeddingVar<TKey, TValue>* ev,
+    TKey key, TValue* val, TValue* default_v)> lookup_fn_;
+};
+
+#define REGISTER_GROUP_GATHER_FULL(dev, ktype, vtype)             \
+  REGISTER_KERNEL_BUILDER(Name("GroupKvResourceGather")           \
+                              .Device(DEVICE_##dev)               \
+                              .TypeConstraint<vtype>("dtype")     \
+                              .TypeConstraint<ktype>("Tkeys"),    \
+                          GroupKvResourceGatherOp<ktype, vtype>)
+
+#define REGISTER_GROUP_GATHER_ALL_INDICES(type)                   \
+  REGISTER_GROUP_GATHER_FULL(CPU, int32, type);                   \
+  REGISTER_GROUP_GATHER_FULL(CPU, int64, type)
+
+TF_CALL_REAL_NUMBER_TYPES(REGISTER_GROUP_GATHER_ALL_INDICES)
+#undef REGISTER_GROUP_GATHER_ALL_INDICES
+#undef REGISTER_GROUP_GATHER_FULL
+
 #if GOOGLE_CUDA
 #if !TENSORFLOW_USE_GPU_EV
 template <typename TKey, typename TValue>
@@ -582,6 +904,14 @@ class KvResourceGatherGPUOp : public OpKernel {
     OP_REQUIRES_OK(c,
         c->GetAttr("is_use_default_value_tensor",
           &is_use_default_value_tensor_));
+    if (c->HasAttr("output_dim")) {
+      int64 output_dim = -1;
+      OP_REQUIRES_OK(c, c->GetAttr("output_dim", &output_dim));
+      OP_REQUIRES(c, output_dim == -1,
+          errors::Unimplemented(
+              "output_dim prefix slicing is only supported by the CPU "
+              "gather kernel"));
+    }
     if (is_use_default_value_tensor_) {
       get_default_v_fn_ = [](TValue* default_v, TKey id, int64 index,
                             int64 total_dim, int64 len) {
@@ -645,40 +975,64 @@ class KvResourceGatherGPUOp : public OpKernel {
               " should large than IDs in batch ", N));
       const size_t slice_bytes = slice_elems * sizeof(TValue);
       if (ev->IsHBMDRAM()) {
-        bool* init_flags = new bool[indices_size]();
-        bool* copyback_flags = new bool[indices_size]();
-        TValue** memcpy_address = new TValue*[indices_size];
-        TValue** default_values = new TValue*[indices_size];
-        TKey* ids = new TKey[indices_size];
-        auto do_work = [this, indices_flat,
-            out_base, slice_elems, c, ev,
-            default_values, init_flags, copyback_flags, memcpy_address, ids] (int64 start, int64 limit) {
-          for (int64 i = start; i < limit; ++i) {
-            TValue* default_v;
-            default_v = ev->GetDefaultValuePtr() +
-                          ((indices_flat(i)) % ev->GetDefaultValueDim()) * ev->ValueLen();
-            default_values[i] = default_v;
-            ids[i] = indices_flat(i);
-          }
-          ev->LookupWithFreqBatch(ids, init_flags, copyback_flags, memcpy_address, start, limit);
-        };
-
-        auto worker_threads = c->device()->tensorflow_cpu_worker_threads();
-        Shard(8, worker_threads->workers, indices_size,
-            slice_bytes, do_work);
+        embedding::GPUHotKeyCache<TKey, TValue>* gpu_cache = ev->GPUCache();
+        bool* hit_flags = nullptr;
+        bool all_hit = false;
+        if (gpu_cache != nullptr) {
+          // Try the HBM-resident cache first: a batch whose keys all hit
+          // is served entirely on the device and never reaches the host
+          // hash tables below.
+          const cudaStream_t& stream = c->eigen_device<GPUDevice>().stream();
+          hit_flags = new bool[indices_size]();
+          all_hit = gpu_cache->Gather(&indices_flat(0), indices_size,
+                                      out_base, hit_flags, stream);
+        }
+        if (!all_hit) {
+          bool* init_flags = new bool[indices_size]();
+          bool* copyback_flags = new bool[indices_size]();
+          TValue** memcpy_address = new TValue*[indices_size];
+          TValue** default_values = new TValue*[indices_size];
+          TKey* ids = new TKey[indices_size];
+          auto do_work = [this, indices_flat,
+              out_base, slice_elems, c, ev,
+              default_values, init_flags, copyback_flags, memcpy_address, ids] (int64 start, int64 limit) {
+            for (int64 i = start; i < limit; ++i) {
+              TValue* default_v;
+              default_v = ev->GetDefaultValuePtr() +
+                            ((indices_flat(i)) % ev->GetDefaultValueDim()) * ev->ValueLen();
+              default_values[i] = default_v;
+              ids[i] = indices_flat(i);
+            }
+            ev->LookupWithFreqBatch(ids, init_flags, copyback_flags, memcpy_address, start, limit);
+          };
+
+          auto worker_threads = c->device()->tensorflow_cpu_worker_threads();
+          Shard(8, worker_threads->workers, indices_size,
+              slice_bytes, do_work);
 
-        ev->CopyBackToGPU(ids, indices_size, copyback_flags, memcpy_address);
+          ev->CopyBackToGPU(ids, indices_size, copyback_flags, memcpy_address);
 
-        ev->CreateGPUBatch(out_base, default_values, indices_size, slice_elems, init_flags, memcpy_address);
-        delete []init_flags;
-        delete []copyback_flags;
-        delete []memcpy_address;
-        delete []default_values;
-        delete []ids;
+          ev->CreateGPUBatch(out_base, default_values, indices_size, slice_elems, init_flags, memcpy_address);
+          if (gpu_cache != nullptr) {
+            // The missed rows now live at stable HBM addresses, admit
+            // them so the next batch can stay on the device.
+            const cudaStream_t& stream = c->eigen_device<GPUDevice>().stream();
+            gpu_cache->Insert(ids, indices_size, hit_flags, memcpy_address,
+                              stream);
+          }
+          delete []init_flags;
+          delete []copyback_flags;
+          delete []memcpy_address;
+          delete []default_values;
+          delete []ids;
+        }
+        delete []hit_flags;
       } else {
+        std::atomic<int64> worked_ns(0);
         auto do_work = [this, indices_flat,
-             out_base, slice_elems, c, default_v, ev, counts] (
+             out_base, slice_elems, c, default_v, ev, counts, &worked_ns] (
                  int64 start, int64 limit) {
+          const uint64 begin_ns = Env::Default()->NowNanos();
           for (int64 i = start; i < limit; ++i) {
             TValue* default_v_ptr = get_default_v_fn_(
                 default_v, indices_flat(i), i, ev->GetDefaultValueDim(),
@@ -687,11 +1041,15 @@ class KvResourceGatherGPUOp : public OpKernel {
             ev->LookupOrCreate(indices_flat(i),
                 out_base + i * slice_elems, default_v_ptr, count);
           }
+          worked_ns.fetch_add(Env::Default()->NowNanos() - begin_ns,
+                              std::memory_order_relaxed);
         };
         auto worker_threads = c->device()->tensorflow_cpu_worker_threads();
         Shard(worker_threads->num_threads,
               worker_threads->workers, indices_size,
-              slice_bytes, do_work);
+              shard_cost_.cost(), do_work);
+        shard_cost_.Update(worked_ns.load(std::memory_order_relaxed),
+                           indices_size);
       }
       ev->storage_manager()->Schedule([ev, indices]() {
         embedding::BatchCache<TKey>* cache = ev->Cache();
@@ -707,6 +1065,8 @@ class KvResourceGatherGPUOp : public OpKernel {
     std::function<
       TValue*(TValue*, TKey, int64, int64, int64)> get_default_v_fn_;
     std::function<int32(int32*, int64)> get_count_fn_;
+    // Seeded with a mid-range guess; converges within a few steps.
+    AdaptiveShardCost shard_cost_{1000};
 };
 
 #define REGISTER_GATHER_FULL(dev, ktype, vtype)                   \
@@ -1021,9 +1381,30 @@ class KvResourceImportV2Op: public AsyncOpKernel {
                    << s.ToString();
       }
 
+      // Metadata-only compatibility pass: fail on a changed dim or
+      // dtype now, before minutes of streaming are sunk into the load.
+      // TF_EV_VALIDATE_RESTORE=false skips it.
+      static const bool validate_restore = [] {
+        bool b = true;
+        TF_CHECK_OK(ReadBoolFromEnvVar("TF_EV_VALIDATE_RESTORE", true, &b));
+        return b;
+      }();
+      if (validate_restore) {
+        const uint64 begin_us = Env::Default()->NowMicros();
+        Status vs = EVValidateRestoreCompatibility(
+            ev, name_string, &reader, "-keys", "-values");
+        if (!vs.ok()) {
+          LOG(FATAL) << "EV restore pre-validation failed: " << vs.ToString();
+        }
+        VLOG(1) << "EV restore pre-validation of " << name_string
+                << " passed in " << Env::Default()->NowMicros() - begin_us
+                << "us";
+      }
+
       EVRestoreDynamically(
           ev, name_string, partition_id_, partition_num_, context, &reader,
-          "-partition_offset", "-keys", "-values", "-versions", "-freqs", reset_version_);
+          "-partition_offset", "-keys", "-values", "-versions", "-freqs",
+          reset_version_, file_name_string);
       ev->SetInitialized();
       done();
     };
@@ -1136,11 +1517,21 @@ class KvResourceIncrImportOp: public AsyncOpKernel {
               << "partition_num:"
               << partition_num_;
 
+    // With consistent lookups enabled, mark the table's version odd and
+    // drain the read epoch so no in-flight request sees this table
+    // half-updated relative to the others in the same delta.
+    const bool pin_readers = embedding::EmbeddingReadEpoch::Enabled();
+    if (pin_readers) {
+      embedding::EmbeddingReadEpoch::GetInstance()->BeginUpdate(name_string);
+    }
     EVRestoreDynamically(
         ev, name_string, partition_id_, partition_num_, context, &reader,
         "-incr_partition_offset", "-sparse_incr_keys", "-sparse_incr_values",
         "-sparse_incr_versions", "-sparse_incr_freqs");
     ev->SetInitialized();
+    if (pin_readers) {
+      embedding::EmbeddingReadEpoch::GetInstance()->EndUpdate(name_string);
+    }
     done();
   }
 
@@ -1258,6 +1649,636 @@ TF_CALL_REAL_NUMBER_TYPES(REGISTER_KERNELS_ALL_INDEX)
 #undef REGISTER_KERNELS_ALL_INDEX
 #undef REGISTER_KERNELS
 
+// Op that outputs only the keys and values updated since the last
+// delta export, using the dirty set tracked on the EmbeddingVar.
+template<typename TKey, typename TValue>
+class KvResourceDeltaExportOp : public OpKernel {
+ public:
+  explicit KvResourceDeltaExportOp(OpKernelConstruction *ctx) : OpKernel(ctx) {}
+
+  void Compute(OpKernelContext *ctx) override {
+    EmbeddingVar<TKey, TValue> *ev = nullptr;
+    OP_REQUIRES_OK(ctx, LookupResource(ctx, HandleFromInput(ctx, 0), &ev));
+    core::ScopedUnref unref_me(ev);
+    OP_REQUIRES(ctx, ev->IsDeltaExportEnabled(),
+        errors::FailedPrecondition(
+            "KvResourceDeltaExport requires dirty-set tracking, "
+            "set TF_EV_DELTA_EXPORT=1 before creating the EmbeddingVar."));
+    std::vector<TKey> key_list;
+    std::vector<TValue *> valueptr_list;
+    std::vector<int64> version_list;
+    std::vector<int64> freq_list;
+    ev->GetDeltaSnapshot(&key_list, &valueptr_list, &version_list, &freq_list);
+
+    // The full-export fallback can report filtered or forward-only
+    // features; drop them so every emitted row has a value.
+    int64 total_size = 0;
+    for (size_t i = 0; i < key_list.size(); i++) {
+      TValue *value = valueptr_list[i];
+      if (value == nullptr || value == reinterpret_cast<TValue*>(-1)) {
+        continue;
+      }
+      key_list[total_size] = key_list[i];
+      valueptr_list[total_size] = value;
+      if (version_list.size() != 0) {
+        version_list[total_size] = version_list[i];
+      }
+      if (freq_list.size() != 0) {
+        freq_list[total_size] = freq_list[i];
+      }
+      total_size++;
+    }
+
+    Tensor *keys_output_tensor = NULL;
+    Tensor *values_output_tensor = NULL;
+    Tensor *versions_output_tensor = NULL;
+    Tensor *freq_output_tensor = NULL;
+
+    OP_REQUIRES_OK(ctx, ctx->allocate_output(
+          0, TensorShape({total_size}), &keys_output_tensor));
+    OP_REQUIRES_OK(ctx, ctx->allocate_output(
+          1, TensorShape({total_size, ev->ValueLen()}),
+          &values_output_tensor));
+    OP_REQUIRES_OK(ctx, ctx->allocate_output(
+          2, TensorShape({version_list.size() == 0 ? 0 : total_size}),
+          &versions_output_tensor));
+    OP_REQUIRES_OK(ctx, ctx->allocate_output(
+          3, TensorShape({freq_list.size() == 0 ? 0 : total_size}),
+          &freq_output_tensor));
+
+    auto keys_output = keys_output_tensor->template flat<TKey>();
+    auto val_matrix = values_output_tensor->matrix<TValue>();
+    auto versions_output = versions_output_tensor->template flat<int64>();
+    auto freq_output = freq_output_tensor->template flat<int64>();
+
+    for (int64 i = 0; i < total_size; i++) {
+      keys_output(i) = key_list[i];
+      TValue *value = valueptr_list[i];
+      for (int64 m = 0; m < ev->ValueLen(); m++) {
+        val_matrix(i, m) = *(value + m);
+      }
+      if (version_list.size() != 0) {
+        versions_output(i) = version_list[i];
+      }
+      if (freq_list.size() != 0) {
+        freq_output(i) = freq_list[i];
+      }
+    }
+  }
+};
+
+#define REGISTER_KERNELS(ktype, vtype)                         \
+  REGISTER_KERNEL_BUILDER(Name("KvResourceDeltaExport")        \
+                            .Device(DEVICE_CPU)                \
+                            .TypeConstraint<ktype>("Tkeys")    \
+                            .TypeConstraint<vtype>("Tvalues"), \
+                          KvResourceDeltaExportOp<ktype, vtype>);
+#define REGISTER_KERNELS_ALL_INDEX(type)                       \
+  REGISTER_KERNELS(int32, type)                                \
+  REGISTER_KERNELS(int64, type)
+TF_CALL_REAL_NUMBER_TYPES(REGISTER_KERNELS_ALL_INDEX)
+#undef REGISTER_KERNELS_ALL_INDEX
+#undef REGISTER_KERNELS
+
+// Source-side export of a key-range migration: emits every row whose
+// key falls in [range_start, range_limit).
+template<typename TKey, typename TValue>
+class KvResourceExportKeyRangeOp : public OpKernel {
+ public:
+  explicit KvResourceExportKeyRangeOp(OpKernelConstruction *ctx)
+      : OpKernel(ctx) {}
+
+  void Compute(OpKernelContext *ctx) override {
+    EmbeddingVar<TKey, TValue> *ev = nullptr;
+    OP_REQUIRES_OK(ctx, LookupResource(ctx, HandleFromInput(ctx, 0), &ev));
+    core::ScopedUnref unref_me(ev);
+    const int64 range_start = ctx->input(1).scalar<int64>()();
+    const int64 range_limit = ctx->input(2).scalar<int64>()();
+    OP_REQUIRES(ctx, range_start <= range_limit,
+        errors::InvalidArgument("range_start ", range_start,
+            " must not exceed range_limit ", range_limit));
+
+    std::vector<TKey> key_list;
+    std::vector<TValue *> valueptr_list;
+    std::vector<int64> version_list;
+    std::vector<int64> freq_list;
+    embedding::Iterator* it = nullptr;
+    ev->GetSnapshot(&key_list, &valueptr_list, &version_list,
+                    &freq_list, &it);
+
+    // Keep only the requested range; the snapshot can also report
+    // filtered or forward-only features without a value, drop those so
+    // every emitted row can be imported.
+    int64 total_size = 0;
+    for (size_t i = 0; i < key_list.size(); i++) {
+      int64 key = static_cast<int64>(key_list[i]);
+      TValue *value = valueptr_list[i];
+      if (key < range_start || key >= range_limit ||
+          value == nullptr || value == reinterpret_cast<TValue*>(-1)) {
+        continue;
+      }
+      key_list[total_size] = key_list[i];
+      valueptr_list[total_size] = value;
+      if (version_list.size() != 0) {
+        version_list[total_size] = version_list[i];
+      }
+      if (freq_list.size() != 0) {
+        freq_list[total_size] = freq_list[i];
+      }
+      total_size++;
+    }
+
+    Tensor *keys_output_tensor = NULL;
+    Tensor *values_output_tensor = NULL;
+    Tensor *versions_output_tensor = NULL;
+    Tensor *freq_output_tensor = NULL;
+
+    OP_REQUIRES_OK(ctx, ctx->allocate_output(
+          0, TensorShape({total_size}), &keys_output_tensor));
+    OP_REQUIRES_OK(ctx, ctx->allocate_output(
+          1, TensorShape({total_size, ev->ValueLen()}),
+          &values_output_tensor));
+    OP_REQUIRES_OK(ctx, ctx->allocate_output(
+          2, TensorShape({version_list.size() == 0 ? 0 : total_size}),
+          &versions_output_tensor));
+    OP_REQUIRES_OK(ctx, ctx->allocate_output(
+          3, TensorShape({freq_list.size() == 0 ? 0 : total_size}),
+          &freq_output_tensor));
+
+    auto keys_output = keys_output_tensor->template flat<TKey>();
+    auto val_matrix = values_output_tensor->matrix<TValue>();
+    auto versions_output = versions_output_tensor->template flat<int64>();
+    auto freq_output = freq_output_tensor->template flat<int64>();
+
+    for (int64 i = 0; i < total_size; i++) {
+      keys_output(i) = key_list[i];
+      TValue *value = valueptr_list[i];
+      for (int64 m = 0; m < ev->ValueLen(); m++) {
+        val_matrix(i, m) = *(value + m);
+      }
+      if (version_list.size() != 0) {
+        versions_output(i) = version_list[i];
+      }
+      if (freq_list.size() != 0) {
+        freq_output(i) = freq_list[i];
+      }
+    }
+  }
+};
+
+#define REGISTER_KERNELS(ktype, vtype)                         \
+  REGISTER_KERNEL_BUILDER(Name("KvResourceExportKeyRange")     \
+                            .Device(DEVICE_CPU)                \
+                            .TypeConstraint<ktype>("Tkeys")    \
+                            .TypeConstraint<vtype>("Tvalues"), \
+                          KvResourceExportKeyRangeOp<ktype, vtype>);
+#define REGISTER_KERNELS_ALL_INDEX(type)                       \
+  REGISTER_KERNELS(int32, type)                                \
+  REGISTER_KERNELS(int64, type)
+TF_CALL_REAL_NUMBER_TYPES(REGISTER_KERNELS_ALL_INDEX)
+#undef REGISTER_KERNELS_ALL_INDEX
+#undef REGISTER_KERNELS
+
+// Destination-side import of a key-range migration: inserts the rows
+// produced by KvResourceExportKeyRange, carrying value, version and
+// freq over unchanged.
+template<typename TKey, typename TValue>
+class KvResourceImportKeyRangeOp : public OpKernel {
+ public:
+  explicit KvResourceImportKeyRangeOp(OpKernelConstruction *ctx)
+      : OpKernel(ctx) {}
+
+  void Compute(OpKernelContext *ctx) override {
+    EmbeddingVar<TKey, TValue> *ev = nullptr;
+    OP_REQUIRES_OK(ctx, LookupResource(ctx, HandleFromInput(ctx, 0), &ev));
+    core::ScopedUnref unref_me(ev);
+    const Tensor& keys = ctx->input(1);
+    const Tensor& values = ctx->input(2);
+    const Tensor& versions = ctx->input(3);
+    const Tensor& freqs = ctx->input(4);
+    const int64 key_num = keys.NumElements();
+    OP_REQUIRES(ctx, values.dim_size(0) == key_num,
+        errors::InvalidArgument("values has ", values.dim_size(0),
+            " rows for ", key_num, " keys"));
+    OP_REQUIRES(ctx, values.dim_size(1) == ev->ValueLen(),
+        errors::InvalidArgument("migrated value length ",
+            values.dim_size(1), " does not match destination value length ",
+            ev->ValueLen()));
+    OP_REQUIRES(ctx,
+        versions.NumElements() == 0 || versions.NumElements() == key_num,
+        errors::InvalidArgument("versions must be empty or hold one entry "
+            "per key"));
+    OP_REQUIRES(ctx,
+        freqs.NumElements() == 0 || freqs.NumElements() == key_num,
+        errors::InvalidArgument("freqs must be empty or hold one entry "
+            "per key"));
+    if (key_num == 0) {
+      return;
+    }
+
+    // The filter import always reads the version and freq buffers;
+    // back the optional inputs with zeros when the source recorded
+    // neither.
+    std::vector<int64> zero_versions;
+    std::vector<int64> zero_freqs;
+    const char* version_buf = nullptr;
+    if (versions.NumElements() != 0) {
+      version_buf = versions.tensor_data().data();
+    } else {
+      zero_versions.resize(key_num, 0);
+      version_buf = reinterpret_cast<const char*>(zero_versions.data());
+    }
+    const char* freq_buf = nullptr;
+    if (freqs.NumElements() != 0) {
+      freq_buf = freqs.tensor_data().data();
+    } else {
+      zero_freqs.resize(key_num, 0);
+      freq_buf = reinterpret_cast<const char*>(zero_freqs.data());
+    }
+
+    RestoreBuffer restore_buff;
+    restore_buff.key_buffer = const_cast<char*>(keys.tensor_data().data());
+    restore_buff.value_buffer = const_cast<char*>(values.tensor_data().data());
+    restore_buff.version_buffer = const_cast<char*>(version_buf);
+    restore_buff.freq_buffer = const_cast<char*>(freq_buf);
+    Status s = ev->Import(restore_buff, key_num, /*bucket_num=*/1,
+                          /*partition_id=*/0, /*partition_num=*/1,
+                          /*is_filter=*/false);
+    // The buffers alias the input tensors; keep the destructor away.
+    restore_buff.key_buffer = nullptr;
+    restore_buff.value_buffer = nullptr;
+    restore_buff.version_buffer = nullptr;
+    restore_buff.freq_buffer = nullptr;
+    OP_REQUIRES_OK(ctx, s);
+    LOG(INFO) << "EV:" << HandleFromInput(ctx, 0).name()
+              << ", imported migrated key range of " << key_num << " rows";
+  }
+};
+
+#define REGISTER_KERNELS(ktype, vtype)                         \
+  REGISTER_KERNEL_BUILDER(Name("KvResourceImportKeyRange")     \
+                            .Device(DEVICE_CPU)                \
+                            .TypeConstraint<ktype>("Tkeys")    \
+                            .TypeConstraint<vtype>("Tvalues"), \
+                          KvResourceImportKeyRangeOp<ktype, vtype>);
+#define REGISTER_KERNELS_ALL_INDEX(type)                       \
+  REGISTER_KERNELS(int32, type)                                \
+  REGISTER_KERNELS(int64, type)
+TF_CALL_REAL_NUMBER_TYPES(REGISTER_KERNELS_ALL_INDEX)
+#undef REGISTER_KERNELS_ALL_INDEX
+#undef REGISTER_KERNELS
+
+// Drain step of a key-range migration: removes the migrated rows from
+// the source once routing no longer sends the range here.
+template<typename TKey, typename TValue>
+class KvResourceRemoveKeyRangeOp : public OpKernel {
+ public:
+  explicit KvResourceRemoveKeyRangeOp(OpKernelConstruction *ctx)
+      : OpKernel(ctx) {}
+
+  void Compute(OpKernelContext *ctx) override {
+    EmbeddingVar<TKey, TValue> *ev = nullptr;
+    OP_REQUIRES_OK(ctx, LookupResource(ctx, HandleFromInput(ctx, 0), &ev));
+    core::ScopedUnref unref_me(ev);
+    const int64 range_start = ctx->input(1).scalar<int64>()();
+    const int64 range_limit = ctx->input(2).scalar<int64>()();
+    OP_REQUIRES(ctx, range_start <= range_limit,
+        errors::InvalidArgument("range_start ", range_start,
+            " must not exceed range_limit ", range_limit));
+
+    std::vector<TKey> key_list;
+    std::vector<ValuePtr<TValue>*> value_ptr_list;
+    OP_REQUIRES_OK(ctx,
+        ev->storage_manager()->GetSnapshot(&key_list, &value_ptr_list));
+    int64 removed = 0;
+    for (auto key : key_list) {
+      int64 k = static_cast<int64>(key);
+      if (k < range_start || k >= range_limit) {
+        continue;
+      }
+      TF_CHECK_OK(ev->storage_manager()->Remove(key));
+      removed++;
+    }
+    LOG(INFO) << "EV:" << HandleFromInput(ctx, 0).name()
+              << ", removed " << removed << " rows of migrated key range ["
+              << range_start << ", " << range_limit << ")";
+  }
+};
+
+#define REGISTER_KERNELS(ktype, vtype)                         \
+  REGISTER_KERNEL_BUILDER(Name("KvResourceRemoveKeyRange")     \
+                            .Device(DEVICE_CPU)                \
+                            .TypeConstraint<ktype>("Tkeys")    \
+                            .TypeConstraint<vtype>("Tvalues"), \
+                          KvResourceRemoveKeyRangeOp<ktype, vtype>);
+#define REGISTER_KERNELS_ALL_INDEX(type)                       \
+  REGISTER_KERNELS(int32, type)                                \
+  REGISTER_KERNELS(int64, type)
+TF_CALL_REAL_NUMBER_TYPES(REGISTER_KERNELS_ALL_INDEX)
+#undef REGISTER_KERNELS_ALL_INDEX
+#undef REGISTER_KERNELS
+
+// Worker-side lookup cache for read-heavy remote EV tables. One
+// resource caches one table; the graph consults it before the PS
+// gather and inserts the fetched rows afterwards, so steady traffic on
+// slow-moving tables stops hitting the PS at all.
+template<typename TValue>
+class EmbeddingLookupCache : public ResourceBase {
+ public:
+  explicit EmbeddingLookupCache(const string& name) : name_(name) {}
+
+  string DebugString() const override {
+    mutex_lock l(mu_);
+    return strings::StrCat("EmbeddingLookupCache ", name_, " entries ",
+                           entries_.size());
+  }
+
+  struct Entry {
+    std::vector<TValue> value;
+    int64 version = 0;
+    uint64 expire_micros = 0;  // 0 means no TTL expiry
+    typename std::list<int64>::iterator lru_it;
+  };
+
+  mutable mutex mu_;
+  std::unordered_map<int64, Entry> entries_ GUARDED_BY(mu_);
+  // Most recently used at the front.
+  std::list<int64> lru_ GUARDED_BY(mu_);
+
+ private:
+  const string name_;
+};
+
+template<typename TKey, typename TValue>
+class KvResourceCacheFindOp : public OpKernel {
+ public:
+  explicit KvResourceCacheFindOp(OpKernelConstruction *ctx) : OpKernel(ctx) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("dim", &dim_));
+    OP_REQUIRES(ctx, dim_ > 0,
+        errors::InvalidArgument("dim must be > 0, got ", dim_));
+  }
+
+  void Compute(OpKernelContext *ctx) override {
+    EmbeddingLookupCache<TValue>* cache = nullptr;
+    OP_REQUIRES_OK(ctx, LookupOrCreateResource<EmbeddingLookupCache<TValue>>(
+        ctx, HandleFromInput(ctx, 0), &cache,
+        [ctx](EmbeddingLookupCache<TValue>** ptr) {
+          *ptr = new EmbeddingLookupCache<TValue>(
+              HandleFromInput(ctx, 0).name());
+          return Status::OK();
+        }));
+    core::ScopedUnref unref(cache);
+    const Tensor& keys = ctx->input(1);
+    const int64 watermark = ctx->input(2).scalar<int64>()();
+    const int64 num_keys = keys.NumElements();
+    Tensor* values_tensor = nullptr;
+    Tensor* hits_tensor = nullptr;
+    OP_REQUIRES_OK(ctx, ctx->allocate_output(
+        0, TensorShape({num_keys, dim_}), &values_tensor));
+    OP_REQUIRES_OK(ctx, ctx->allocate_output(
+        1, TensorShape({num_keys}), &hits_tensor));
+    auto keys_vec = keys.template flat<TKey>();
+    auto values = values_tensor->matrix<TValue>();
+    auto hits = hits_tensor->flat<bool>();
+    const uint64 now = Env::Default()->NowMicros();
+
+    mutex_lock l(cache->mu_);
+    for (int64 i = 0; i < num_keys; ++i) {
+      const int64 key = static_cast<int64>(keys_vec(i));
+      auto it = cache->entries_.find(key);
+      bool hit = it != cache->entries_.end() &&
+                 (it->second.expire_micros == 0 ||
+                  now < it->second.expire_micros) &&
+                 it->second.version >= watermark;
+      hits(i) = hit;
+      if (hit) {
+        const std::vector<TValue>& row = it->second.value;
+        if (static_cast<int64>(row.size()) != dim_) {
+          // One cache covers one table; a dim mismatch means the
+          // cache is being shared, treat it as a miss.
+          hits(i) = false;
+          hit = false;
+        } else {
+          for (int64 j = 0; j < dim_; ++j) {
+            values(i, j) = row[j];
+          }
+          cache->lru_.splice(cache->lru_.begin(), cache->lru_,
+                             it->second.lru_it);
+        }
+      }
+      if (!hit) {
+        for (int64 j = 0; j < dim_; ++j) {
+          values(i, j) = TValue(0);
+        }
+      }
+    }
+  }
+
+ private:
+  int32 dim_;
+};
+
+#define REGISTER_KERNELS(ktype, vtype)                         \
+  REGISTER_KERNEL_BUILDER(Name("KvResourceCacheFind")          \
+                            .Device(DEVICE_CPU)                \
+                            .TypeConstraint<ktype>("Tkeys")    \
+                            .TypeConstraint<vtype>("dtype"),   \
+                          KvResourceCacheFindOp<ktype, vtype>);
+#define REGISTER_KERNELS_ALL_INDEX(type)                       \
+  REGISTER_KERNELS(int32, type)                                \
+  REGISTER_KERNELS(int64, type)
+TF_CALL_REAL_NUMBER_TYPES(REGISTER_KERNELS_ALL_INDEX)
+#undef REGISTER_KERNELS_ALL_INDEX
+#undef REGISTER_KERNELS
+
+template<typename TKey, typename TValue>
+class KvResourceCacheInsertOp : public OpKernel {
+ public:
+  explicit KvResourceCacheInsertOp(OpKernelConstruction *ctx)
+      : OpKernel(ctx) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("capacity", &capacity_));
+    OP_REQUIRES(ctx, capacity_ > 0,
+        errors::InvalidArgument("capacity must be > 0, got ", capacity_));
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("ttl_seconds", &ttl_seconds_));
+    OP_REQUIRES(ctx, ttl_seconds_ >= 0,
+        errors::InvalidArgument("ttl_seconds must be >= 0, got ",
+                                ttl_seconds_));
+  }
+
+  void Compute(OpKernelContext *ctx) override {
+    EmbeddingLookupCache<TValue>* cache = nullptr;
+    OP_REQUIRES_OK(ctx, LookupOrCreateResource<EmbeddingLookupCache<TValue>>(
+        ctx, HandleFromInput(ctx, 0), &cache,
+        [ctx](EmbeddingLookupCache<TValue>** ptr) {
+          *ptr = new EmbeddingLookupCache<TValue>(
+              HandleFromInput(ctx, 0).name());
+          return Status::OK();
+        }));
+    core::ScopedUnref unref(cache);
+    const Tensor& keys = ctx->input(1);
+    const Tensor& values = ctx->input(2);
+    const int64 version = ctx->input(3).scalar<int64>()();
+    const int64 num_keys = keys.NumElements();
+    OP_REQUIRES(ctx, values.dims() == 2 && values.dim_size(0) == num_keys,
+        errors::InvalidArgument("values must be [num_keys, dim], got ",
+                                values.shape().DebugString()));
+    const int64 dim = values.dim_size(1);
+    auto keys_vec = keys.template flat<TKey>();
+    auto values_mat = values.matrix<TValue>();
+    const uint64 expire = ttl_seconds_ == 0
+        ? 0
+        : Env::Default()->NowMicros() +
+              static_cast<uint64>(ttl_seconds_) * 1000 * 1000;
+
+    mutex_lock l(cache->mu_);
+    for (int64 i = 0; i < num_keys; ++i) {
+      const int64 key = static_cast<int64>(keys_vec(i));
+      auto it = cache->entries_.find(key);
+      if (it == cache->entries_.end()) {
+        while (static_cast<int64>(cache->entries_.size()) >= capacity_) {
+          cache->entries_.erase(cache->lru_.back());
+          cache->lru_.pop_back();
+        }
+        cache->lru_.push_front(key);
+        it = cache->entries_.emplace(key,
+            typename EmbeddingLookupCache<TValue>::Entry()).first;
+        it->second.lru_it = cache->lru_.begin();
+      } else {
+        cache->lru_.splice(cache->lru_.begin(), cache->lru_,
+                           it->second.lru_it);
+      }
+      auto& entry = it->second;
+      entry.value.assign(&values_mat(i, 0), &values_mat(i, 0) + dim);
+      entry.version = version;
+      entry.expire_micros = expire;
+    }
+  }
+
+ private:
+  int64 capacity_;
+  int64 ttl_seconds_;
+};
+
+#define REGISTER_KERNELS(ktype, vtype)                         \
+  REGISTER_KERNEL_BUILDER(Name("KvResourceCacheInsert")        \
+                            .Device(DEVICE_CPU)                \
+                            .TypeConstraint<ktype>("Tkeys")    \
+                            .TypeConstraint<vtype>("dtype"),   \
+                          KvResourceCacheInsertOp<ktype, vtype>);
+#define REGISTER_KERNELS_ALL_INDEX(type)                       \
+  REGISTER_KERNELS(int32, type)                                \
+  REGISTER_KERNELS(int64, type)
+TF_CALL_REAL_NUMBER_TYPES(REGISTER_KERNELS_ALL_INDEX)
+#undef REGISTER_KERNELS_ALL_INDEX
+#undef REGISTER_KERNELS
+
+#define REGISTER_KERNELS(vtype)                                \
+  REGISTER_KERNEL_BUILDER(Name("KvResourceLookupCache")        \
+                            .Device(DEVICE_CPU)                \
+                            .HostMemory("cache"),              \
+                          ResourceHandleOp<EmbeddingLookupCache<vtype>>);
+REGISTER_KERNELS(float)
+#undef REGISTER_KERNELS
+
+// Writes the frozen read-only serving file for an EmbeddingVar.
+template<typename TKey, typename TValue>
+class KvResourceFreezeOp : public OpKernel {
+ public:
+  explicit KvResourceFreezeOp(OpKernelConstruction *ctx) : OpKernel(ctx) {}
+
+  void Compute(OpKernelContext *ctx) override {
+    EmbeddingVar<TKey, TValue> *ev = nullptr;
+    OP_REQUIRES_OK(ctx, LookupResource(ctx, HandleFromInput(ctx, 0), &ev));
+    core::ScopedUnref unref_me(ev);
+    const Tensor& path = ctx->input(1);
+    OP_REQUIRES(ctx, TensorShapeUtils::IsScalar(path.shape()),
+        errors::InvalidArgument("path must be a scalar string"));
+    const std::string path_string = path.scalar<string>()();
+    OP_REQUIRES_OK(ctx, (FrozenEmbeddingVar<TKey, TValue>::Freeze(
+            ev, path_string, ctx->env())));
+  }
+};
+
+#define REGISTER_KERNELS(ktype, vtype)                         \
+  REGISTER_KERNEL_BUILDER(Name("KvResourceFreeze")             \
+                            .Device(DEVICE_CPU)                \
+                            .TypeConstraint<ktype>("Tkeys")    \
+                            .TypeConstraint<vtype>("Tvalues"), \
+                          KvResourceFreezeOp<ktype, vtype>);
+#define REGISTER_KERNELS_ALL_INDEX(type)                       \
+  REGISTER_KERNELS(int32, type)                                \
+  REGISTER_KERNELS(int64, type)
+TF_CALL_REAL_NUMBER_TYPES(REGISTER_KERNELS_ALL_INDEX)
+#undef REGISTER_KERNELS_ALL_INDEX
+#undef REGISTER_KERNELS
+
+// Serving-only gather against a frozen EmbeddingVar file. The mapped
+// file is cached in the resource manager keyed by its path, so every
+// gather on the same model shares one mapping, and the first Compute is
+// the only one that touches the filesystem.
+template<typename TKey, typename TValue>
+class FrozenKvResourceGatherOp : public OpKernel {
+ public:
+  explicit FrozenKvResourceGatherOp(OpKernelConstruction *ctx)
+      : OpKernel(ctx) {}
+
+  void Compute(OpKernelContext *ctx) override {
+    const Tensor& path = ctx->input(0);
+    OP_REQUIRES(ctx, TensorShapeUtils::IsScalar(path.shape()),
+        errors::InvalidArgument("path must be a scalar string"));
+    const std::string path_string = path.scalar<string>()();
+    FrozenEmbeddingVar<TKey, TValue>* var = nullptr;
+    OP_REQUIRES_OK(ctx,
+        ctx->resource_manager()->template LookupOrCreate<
+            FrozenEmbeddingVar<TKey, TValue>>(
+            "frozen_embedding_var", path_string, &var,
+            [&path_string](FrozenEmbeddingVar<TKey, TValue>** out) {
+              return FrozenEmbeddingVar<TKey, TValue>::Load(path_string, out);
+            }));
+    core::ScopedUnref unref_me(var);
+
+    const Tensor& indices = ctx->input(1);
+    const Tensor& default_value = ctx->input(2);
+    const int64 N = indices.NumElements();
+    const int64 value_len = var->ValueLen();
+    OP_REQUIRES(ctx, default_value.NumElements() == value_len,
+        errors::InvalidArgument(
+            "default_value must have the frozen value_len (",
+            value_len, ") elements, got ", default_value.NumElements()));
+
+    TensorShape result_shape = indices.shape();
+    result_shape.AppendShape(TensorShape({value_len}));
+    Tensor* out = nullptr;
+    OP_REQUIRES_OK(ctx, ctx->allocate_output(0, result_shape, &out));
+    if (N == 0) return;
+
+    auto out_flat = out->shaped<TValue, 2>({N, value_len});
+    auto indices_flat = indices.flat<TKey>();
+    TValue* default_v = (TValue*)default_value.data();
+    auto worker_threads = ctx->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads->num_threads, worker_threads->workers, N,
+          value_len * sizeof(TValue),
+          [&](int64 start, int64 limit) {
+            for (int64 i = start; i < limit; ++i) {
+              var->Lookup(indices_flat(i), &out_flat(i, 0), default_v);
+            }
+          });
+  }
+};
+
+#define REGISTER_KERNELS(ktype, vtype)                         \
+  REGISTER_KERNEL_BUILDER(Name("FrozenKvResourceGather")       \
+                            .Device(DEVICE_CPU)                \
+                            .TypeConstraint<ktype>("Tkeys")    \
+                            .TypeConstraint<vtype>("dtype"),   \
+                          FrozenKvResourceGatherOp<ktype, vtype>);
+#define REGISTER_KERNELS_ALL_INDEX(type)                       \
+  REGISTER_KERNELS(int32, type)                                \
+  REGISTER_KERNELS(int64, type)
+TF_CALL_REAL_NUMBER_TYPES(REGISTER_KERNELS_ALL_INDEX)
+#undef REGISTER_KERNELS_ALL_INDEX
+#undef REGISTER_KERNELS
+
 template<typename TKey, typename TValue>
 class KvResourceGeneratePartitionedTensorOp : public OpKernel {
  public:
@@ -1596,6 +2617,14 @@ class KvResourceGatherOpGPU : public OpKernel {
     OP_REQUIRES_OK(c,
         c->GetAttr("is_use_default_value_tensor",
           &is_use_default_value_tensor_));
+    if (c->HasAttr("output_dim")) {
+      int64 output_dim = -1;
+      OP_REQUIRES_OK(c, c->GetAttr("output_dim", &output_dim));
+      OP_REQUIRES(c, output_dim == -1,
+          errors::Unimplemented(
+              "output_dim prefix slicing is only supported by the CPU "
+              "gather kernel"));
+    }
   }
 
   void Compute(OpKernelContext* c) override {
@@ -1995,5 +3024,35 @@ TF_CALL_REAL_NUMBER_TYPES(REGISTER_KERNELS_ALL_INDEX)
 #undef REGISTER_KERNELS_ALL_INDEX
 #undef REGISTER_EV_GET_VERSION
 
+template <typename TKey, typename TValue>
+class EVGetMemoryUsageOp : public OpKernel {
+ public:
+  explicit EVGetMemoryUsageOp(OpKernelConstruction* c) : OpKernel(c) {}
+
+  void Compute(OpKernelContext* ctx) override {
+    EmbeddingVar<TKey, TValue>* ev = nullptr;
+    OP_REQUIRES_OK(ctx,
+                   LookupResource(ctx, HandleFromInput(ctx, 0), &ev));
+    core::ScopedUnref unref_me(ev);
+
+    Tensor* output;
+    OP_REQUIRES_OK(ctx, ctx->allocate_output(0, TensorShape({}), &output));
+    output->scalar<int64>()() = ev->MemoryUsage();
+  }
+};
+
+#define REGISTER_EV_GET_MEMORY_USAGE(ktype, vtype)              \
+  REGISTER_KERNEL_BUILDER(Name("EVGetMemoryUsage")              \
+                            .Device(DEVICE_CPU)                 \
+                            .TypeConstraint<ktype>("Tkeys")     \
+                            .TypeConstraint<vtype>("Tvalues"),  \
+                          EVGetMemoryUsageOp<ktype, vtype>);
+#define REGISTER_KERNELS_ALL_INDEX(type)                        \
+  REGISTER_EV_GET_MEMORY_USAGE(int32, type)                     \
+  REGISTER_EV_GET_MEMORY_USAGE(int64, type)
+TF_CALL_REAL_NUMBER_TYPES(REGISTER_KERNELS_ALL_INDEX)
+#undef REGISTER_KERNELS_ALL_INDEX
+#undef REGISTER_EV_GET_MEMORY_USAGE
+
 }  // namespace tensorflow
 
@@ -16,6 +16,10 @@ limitations under the License.
 #ifndef TENSORFLOW_KERNELS_KV_VARIABLE_OPS_H_
 #define TENSORFLOW_KERNELS_KV_VARIABLE_OPS_H_
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
 #include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/bounds_check.h"
 #include "tensorflow/core/framework/embedding/embedding_var.h"
@@ -24,7 +28,10 @@ limitations under the License.
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/types.h"
@@ -45,6 +52,30 @@ using GPUDevice = Eigen::GpuDevice;
 
 namespace {
   const int kSavedPartitionNum = 1000;
+
+  // TF_EV_SNAPSHOT_DUMP=1 makes DumpEmbeddingValues copy the embedding
+  // rows into a private buffer while the storage manager mutex is held,
+  // then release the mutex before the bundle is written. The lock is then
+  // only held for the duration of a memcpy instead of the full
+  // serialization, so training keeps updating the variable while the
+  // checkpoint streams out. Costs one transient copy of the values.
+  inline bool EVSnapshotDumpEnabled() {
+    const char* env = std::getenv("TF_EV_SNAPSHOT_DUMP");
+    return env != nullptr && env[0] == '1';
+  }
+
+  // TF_EV_RANGE_SHARDED_SAVE=1 dumps each EV part with globally sorted
+  // keys dealt into kSavedPartitionNum contiguous quantile buckets, and
+  // records the bucket boundary keys as <tensor>-range_split_points,
+  // instead of the mod-1000 bucketing. A restoring PS then owns a
+  // contiguous run of buckets and reads one byte range sized to its own
+  // share per dumped tensor, so elastic resharding I/O is proportional
+  // to that share. Only valid when the serving partitioner places keys
+  // by the same ranges: the restore path imports its range unfiltered.
+  inline bool EVRangeShardedSaveEnabled() {
+    const char* env = std::getenv("TF_EV_RANGE_SHARDED_SAVE");
+    return env != nullptr && env[0] == '1';
+  }
 }
 
 template<class T>
@@ -106,6 +137,84 @@ class EVValueDumpIterator: public  DumpIterator<T> {
   int64 col_idx_;
 };
 
+// Iterates the per-saved-partition buckets in order without first
+// concatenating them into one flat list, so dumping does not hold a
+// second copy of every key/version/freq.
+template<class T>
+class EVPartsDumpIterator: public DumpIterator<T> {
+ public:
+  explicit EVPartsDumpIterator(std::vector<std::vector<T> >& parts)
+      : parts_(parts), part_idx_(0), idx_(0) {
+    SkipEmptyParts();
+  }
+
+  bool HasNext() const {
+    return part_idx_ < parts_.size();
+  }
+
+  T Next() {
+    T v = parts_[part_idx_][idx_++];
+    if (idx_ >= parts_[part_idx_].size()) {
+      ++part_idx_;
+      idx_ = 0;
+      SkipEmptyParts();
+    }
+    return v;
+  }
+
+ private:
+  void SkipEmptyParts() {
+    while (part_idx_ < parts_.size() && parts_[part_idx_].empty()) {
+      ++part_idx_;
+    }
+  }
+
+  std::vector<std::vector<T> >& parts_;
+  size_t part_idx_;
+  size_t idx_;
+};
+
+template<class K, class T>
+class EVValuePartsDumpIterator: public DumpIterator<T> {
+ public:
+  EVValuePartsDumpIterator(EmbeddingVar<K, T>*& ev,
+      std::vector<std::vector<T*> >& parts)
+      : ev_(ev), parts_(parts), part_idx_(0), keys_idx_(0), col_idx_(0) {
+    SkipEmptyParts();
+  }
+
+  bool HasNext() const {
+    return part_idx_ < parts_.size();
+  }
+
+  T Next() {
+    T v = parts_[part_idx_][keys_idx_][col_idx_++];
+    if (col_idx_ >= ev_->ValueLen()) {
+      col_idx_ = 0;
+      ++keys_idx_;
+      if (keys_idx_ >= parts_[part_idx_].size()) {
+        keys_idx_ = 0;
+        ++part_idx_;
+        SkipEmptyParts();
+      }
+    }
+    return v;
+  }
+
+ private:
+  void SkipEmptyParts() {
+    while (part_idx_ < parts_.size() && parts_[part_idx_].empty()) {
+      ++part_idx_;
+    }
+  }
+
+  EmbeddingVar<K, T>* ev_;
+  std::vector<std::vector<T*> >& parts_;
+  size_t part_idx_;
+  size_t keys_idx_;
+  int64 col_idx_;
+};
+
 template<class T>
 class EVVersionDumpIterator: public  DumpIterator<T> {
  public:
@@ -190,7 +299,8 @@ Status DumpEmbeddingValues(EmbeddingVar<K, V>* ev,
   std::vector<int64> tot_freq_filter_list;
   std::vector<int64> tot_version_filter_list;
   embedding::Iterator* it = nullptr;
-  mutex_lock l(*ev->storage_manager()->get_mutex());
+  std::unique_ptr<mutex_lock> l(
+      new mutex_lock(*ev->storage_manager()->get_mutex()));
   int64 total_size = ev->GetSnapshot(&tot_key_list,
       &tot_valueptr_list, &tot_version_list, &tot_freq_list, &it);
   VLOG(1) << "EV:" << tensor_key << ", save size:" << total_size;
@@ -201,6 +311,38 @@ Status DumpEmbeddingValues(EmbeddingVar<K, V>* ev,
     }
   }
 
+  // In snapshot mode, materialize a private copy of the embedding rows
+  // while the storage manager is locked and hand out the copies instead of
+  // the live ValuePtr memory, so the lock can be dropped before any bundle
+  // I/O. The multi-tier iterator path streams straight out of the backing
+  // store and cannot be detached from the lock, so it keeps the old
+  // behavior.
+  std::unique_ptr<V[]> snapshot_values;
+  if (EVSnapshotDumpEnabled() && it == nullptr) {
+    int64 value_len = ev->ValueLen();
+    int64 num_rows = 0;
+    for (V* valueptr : tot_valueptr_list) {
+      if (valueptr != nullptr && valueptr != reinterpret_cast<V*>(-1)) {
+        ++num_rows;
+      }
+    }
+    snapshot_values.reset(new V[num_rows * value_len]);
+    int64 row = 0;
+    for (size_t i = 0; i < tot_valueptr_list.size(); ++i) {
+      V* valueptr = tot_valueptr_list[i];
+      if (valueptr == nullptr || valueptr == reinterpret_cast<V*>(-1)) {
+        continue;
+      }
+      V* copied = snapshot_values.get() + row * value_len;
+      memcpy(copied, valueptr, value_len * sizeof(V));
+      tot_valueptr_list[i] = copied;
+      ++row;
+    }
+    l.reset();
+    VLOG(1) << "EV:" << tensor_key << ", snapshot dump copied "
+            << num_rows << " rows, lock released before bundle write";
+  }
+
   std::vector<std::vector<K> > key_list_parts;
   std::vector<std::vector<V* > > valueptr_list_parts;
   std::vector<std::vector<int64 > > version_list_parts;
@@ -210,13 +352,6 @@ Status DumpEmbeddingValues(EmbeddingVar<K, V>* ev,
   std::vector<std::vector<int64 > > version_filter_list_parts;
   std::vector<std::vector<int64 > > freq_filter_list_parts;
 
-  std::vector<K> partitioned_tot_key_list;
-  std::vector<V* > partitioned_tot_valueptr_list;
-  std::vector<int64> partitioned_tot_version_list;
-  std::vector<int64> partitioned_tot_freq_list;
-  std::vector<K> partitioned_tot_key_filter_list;
-  std::vector<int64> partitioned_tot_version_filter_list;
-  std::vector<int64> partitioned_tot_freq_filter_list;
   std::vector<int64> part_filter_offset;
 
   key_list_parts.resize(kSavedPartitionNum);
@@ -227,95 +362,207 @@ Status DumpEmbeddingValues(EmbeddingVar<K, V>* ev,
   version_filter_list_parts.resize(kSavedPartitionNum);
   freq_filter_list_parts.resize(kSavedPartitionNum);
   part_filter_offset.resize(kSavedPartitionNum + 1);
-  //partitioned_tot_key_list.resize(tot_key_list.size());
-  //partitioned_tot_valueptr_list.resize(tot_valueptr_list.size());
 
   // save the ev with kSavedPartitionNum piece of tensor
   // so that we can dynamically load ev with changed partition number
+  bool range_sharded = EVRangeShardedSaveEnabled();
+  if (range_sharded && it != nullptr) {
+    // The multi-tier iterator streams an unsorted tail after the
+    // partitioned lists, which cannot be folded into sorted ranges.
+    LOG(WARNING) << "EV " << tensor_key << " uses a multi-tier iterator "
+                 << "dump, falling back to mod-partitioned save.";
+    range_sharded = false;
+  }
+  Tensor range_split_tensor(DT_INT64,
+                            TensorShape({kSavedPartitionNum + 1}));
   int64 filter_freq = ev->MinFreq();
-  for (size_t i = 0; i < tot_key_list.size(); i++) {
-    for (int partid = 0; partid < kSavedPartitionNum; partid++) {
-      if (tot_key_list[i] % kSavedPartitionNum == partid) {
-        if (tot_valueptr_list[i] == reinterpret_cast<V*>(-1)) {
-            // only forward, no backward, bypass
-        } else if (tot_valueptr_list[i] == nullptr) {
-          key_filter_list_parts[partid].push_back(tot_key_list[i]);
+  auto bucket_range = [&](int64 start, int64 end,
+      std::vector<std::vector<K> >& keys,
+      std::vector<std::vector<V*> >& valueptrs,
+      std::vector<std::vector<int64> >& versions,
+      std::vector<std::vector<int64> >& freqs,
+      std::vector<std::vector<K> >& filter_keys,
+      std::vector<std::vector<int64> >& filter_versions,
+      std::vector<std::vector<int64> >& filter_freqs) {
+    for (int64 i = start; i < end; ++i) {
+      int64 partid = tot_key_list[i] % kSavedPartitionNum;
+      if (partid < 0) continue;
+      V* valueptr = tot_valueptr_list[i];
+      if (valueptr == reinterpret_cast<V*>(-1)) {
+        // only forward, no backward, bypass
+      } else if (valueptr == nullptr) {
+        filter_keys[partid].push_back(tot_key_list[i]);
+      } else {
+        keys[partid].push_back(tot_key_list[i]);
+        valueptrs[partid].push_back(valueptr);
+      }
+      if (i < tot_version_list.size()) {
+        if (valueptr == nullptr) {
+          filter_versions[partid].push_back(tot_version_list[i]);
         } else {
-          key_list_parts[partid].push_back(tot_key_list[i]);
-          valueptr_list_parts[partid].push_back(tot_valueptr_list[i]);
+          versions[partid].push_back(tot_version_list[i]);
         }
-        break;
       }
-    }
-  }
-
-  for (size_t i = 0; i < tot_version_list.size(); i++) {
-    for (int partid = 0; partid < kSavedPartitionNum; partid++) {
-      if (tot_key_list[i] % kSavedPartitionNum == partid) {
-        if (tot_valueptr_list[i] == nullptr) {
-          version_filter_list_parts[partid].push_back(tot_version_list[i]);
+      if (i < tot_freq_list.size()) {
+        if (valueptr == nullptr) {
+          filter_freqs[partid].push_back(tot_freq_list[i]);
         } else {
-          version_list_parts[partid].push_back(tot_version_list[i]);
+          freqs[partid].push_back(tot_freq_list[i]);
         }
-        break;
       }
     }
+  };
+
+  // Partitioning is pure bucketing, so shard the snapshot across a
+  // transient pool and stitch the per-shard buckets back together in
+  // shard order; within a saved partition the key order is unchanged.
+  int64 tot_key_num = tot_key_list.size();
+  const int64 kMinKeysPerDumpShard = 1 << 16;
+  int64 num_shards = 1;
+  if (tot_key_num >= 2 * kMinKeysPerDumpShard) {
+    num_shards = std::min<int64>(port::NumSchedulableCPUs(),
+                                 tot_key_num / kMinKeysPerDumpShard);
   }
-  
-  for (size_t i = 0; i < tot_freq_list.size(); i++) {
-    for (int partid = 0; partid < kSavedPartitionNum; partid++) {
-      if (tot_key_list[i] % kSavedPartitionNum == partid) {
-        if (tot_valueptr_list[i] == nullptr) {
-          freq_filter_list_parts[partid].push_back(tot_freq_list[i]);
+  if (range_sharded) {
+    // One global sort, then contiguous quantile slices become the
+    // buckets; within a bucket keys stay ascending, so a restoring
+    // PS's share is one contiguous run of every dumped tensor.
+    std::vector<int64> order(tot_key_num);
+    for (int64 i = 0; i < tot_key_num; ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](int64 a, int64 b) {
+      return tot_key_list[a] < tot_key_list[b];
+    });
+    auto split_flat = range_split_tensor.flat<int64>();
+    for (int partid = 0; partid < kSavedPartitionNum; ++partid) {
+      int64 start = partid * tot_key_num / kSavedPartitionNum;
+      int64 end = (partid + 1) * tot_key_num / kSavedPartitionNum;
+      split_flat(partid) = (start < tot_key_num)
+          ? static_cast<int64>(tot_key_list[order[start]])
+          : (partid > 0 ? split_flat(partid - 1) : 0);
+      for (int64 j = start; j < end; ++j) {
+        int64 i = order[j];
+        V* valueptr = tot_valueptr_list[i];
+        if (valueptr == reinterpret_cast<V*>(-1)) {
+          // only forward, no backward, bypass
+        } else if (valueptr == nullptr) {
+          key_filter_list_parts[partid].push_back(tot_key_list[i]);
         } else {
-          freq_list_parts[partid].push_back(tot_freq_list[i]);
+          key_list_parts[partid].push_back(tot_key_list[i]);
+          valueptr_list_parts[partid].push_back(valueptr);
+        }
+        if (i < tot_version_list.size()) {
+          if (valueptr == nullptr) {
+            version_filter_list_parts[partid].push_back(
+                tot_version_list[i]);
+          } else {
+            version_list_parts[partid].push_back(tot_version_list[i]);
+          }
+        }
+        if (i < tot_freq_list.size()) {
+          if (valueptr == nullptr) {
+            freq_filter_list_parts[partid].push_back(tot_freq_list[i]);
+          } else {
+            freq_list_parts[partid].push_back(tot_freq_list[i]);
+          }
         }
-        break;
       }
     }
+    split_flat(kSavedPartitionNum) =
+        tot_key_num > 0
+            ? static_cast<int64>(tot_key_list[order[tot_key_num - 1]]) + 1
+            : 0;
+  } else if (num_shards > 1) {
+    std::vector<std::vector<std::vector<K> > > shard_keys(
+        num_shards, std::vector<std::vector<K> >(kSavedPartitionNum));
+    std::vector<std::vector<std::vector<V*> > > shard_valueptrs(
+        num_shards, std::vector<std::vector<V*> >(kSavedPartitionNum));
+    std::vector<std::vector<std::vector<int64> > > shard_versions(
+        num_shards, std::vector<std::vector<int64> >(kSavedPartitionNum));
+    std::vector<std::vector<std::vector<int64> > > shard_freqs(
+        num_shards, std::vector<std::vector<int64> >(kSavedPartitionNum));
+    std::vector<std::vector<std::vector<K> > > shard_filter_keys(
+        num_shards, std::vector<std::vector<K> >(kSavedPartitionNum));
+    std::vector<std::vector<std::vector<int64> > > shard_filter_versions(
+        num_shards, std::vector<std::vector<int64> >(kSavedPartitionNum));
+    std::vector<std::vector<std::vector<int64> > > shard_filter_freqs(
+        num_shards, std::vector<std::vector<int64> >(kSavedPartitionNum));
+
+    thread::ThreadPool pool(Env::Default(), ThreadOptions(),
+                            "ev_dump_partition", num_shards, false);
+    BlockingCounter counter(num_shards);
+    int64 shard_size = tot_key_num / num_shards;
+    for (int64 s = 0; s < num_shards; ++s) {
+      int64 start = s * shard_size;
+      int64 end = (s == num_shards - 1) ? tot_key_num : start + shard_size;
+      pool.Schedule([&, s, start, end]() {
+        bucket_range(start, end, shard_keys[s], shard_valueptrs[s],
+                     shard_versions[s], shard_freqs[s], shard_filter_keys[s],
+                     shard_filter_versions[s], shard_filter_freqs[s]);
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+
+    for (int64 s = 0; s < num_shards; ++s) {
+      for (int partid = 0; partid < kSavedPartitionNum; partid++) {
+        key_list_parts[partid].insert(key_list_parts[partid].end(),
+            shard_keys[s][partid].begin(), shard_keys[s][partid].end());
+        valueptr_list_parts[partid].insert(valueptr_list_parts[partid].end(),
+            shard_valueptrs[s][partid].begin(),
+            shard_valueptrs[s][partid].end());
+        version_list_parts[partid].insert(version_list_parts[partid].end(),
+            shard_versions[s][partid].begin(), shard_versions[s][partid].end());
+        freq_list_parts[partid].insert(freq_list_parts[partid].end(),
+            shard_freqs[s][partid].begin(), shard_freqs[s][partid].end());
+        key_filter_list_parts[partid].insert(
+            key_filter_list_parts[partid].end(),
+            shard_filter_keys[s][partid].begin(),
+            shard_filter_keys[s][partid].end());
+        version_filter_list_parts[partid].insert(
+            version_filter_list_parts[partid].end(),
+            shard_filter_versions[s][partid].begin(),
+            shard_filter_versions[s][partid].end());
+        freq_filter_list_parts[partid].insert(
+            freq_filter_list_parts[partid].end(),
+            shard_filter_freqs[s][partid].begin(),
+            shard_filter_freqs[s][partid].end());
+      }
+    }
+  } else {
+    bucket_range(0, tot_key_num, key_list_parts, valueptr_list_parts,
+                 version_list_parts, freq_list_parts, key_filter_list_parts,
+                 version_filter_list_parts, freq_filter_list_parts);
   }
-  // LOG(INFO) << "EV:" << tensor_key << ", key_list_parts:" << key_list_parts.size();
 
   auto part_offset_flat = part_offset_tensor->flat<int32>();
   part_offset_flat(0) = 0;
   part_filter_offset[0] = 0;
-  int ptsize = 0;
+  int64 ptsize = 0;
+  int64 tot_version_num = 0;
+  int64 tot_freq_num = 0;
+  int64 tot_key_filter_num = 0;
+  int64 tot_version_filter_num = 0;
+  int64 tot_freq_filter_num = 0;
   for (int partid = 0; partid < kSavedPartitionNum; partid++) {
-    std::vector<K>& key_list = key_list_parts[partid];
-    std::vector<V* >& valueptr_list = valueptr_list_parts[partid];
-    std::vector<int64>& version_list = version_list_parts[partid];
-    std::vector<int64>& freq_list = freq_list_parts[partid];
-    std::vector<K>& key_filter_list = key_filter_list_parts[partid];
-    std::vector<int64>& version_filter_list =
-      version_filter_list_parts[partid];
-    std::vector<int64>& freq_filter_list = freq_filter_list_parts[partid];
-
-    ptsize += key_list.size();
-    for (int inpid = 0; inpid < key_list.size(); inpid++) {
-      partitioned_tot_key_list.push_back(key_list[inpid]);
-      partitioned_tot_valueptr_list.push_back(valueptr_list[inpid]);
-    }
-    for (int inpid = 0; inpid < version_list.size(); inpid++) {
-      partitioned_tot_version_list.push_back(version_list[inpid]);
-    }
-    for (int inpid = 0; inpid < freq_list.size(); inpid++) {
-      partitioned_tot_freq_list.push_back(freq_list[inpid]);
-    }
-    for (int inpid = 0; inpid < key_filter_list.size(); inpid++) {
-      partitioned_tot_key_filter_list.push_back(key_filter_list[inpid]);
-    }
-    for (int inpid = 0; inpid < version_filter_list.size(); inpid++) {
-      partitioned_tot_version_filter_list.push_back(version_filter_list[inpid]);
-    }
-    for (int inpid = 0; inpid < freq_filter_list.size(); inpid++) {
-      partitioned_tot_freq_filter_list.push_back(freq_filter_list[inpid]);
-    }
-
-    part_offset_flat(partid + 1) = part_offset_flat(partid) + key_list.size();
-    part_filter_offset[partid + 1] = part_filter_offset[partid] + key_filter_list.size();
+    ptsize += key_list_parts[partid].size();
+    tot_version_num += version_list_parts[partid].size();
+    tot_freq_num += freq_list_parts[partid].size();
+    tot_key_filter_num += key_filter_list_parts[partid].size();
+    tot_version_filter_num += version_filter_list_parts[partid].size();
+    tot_freq_filter_num += freq_filter_list_parts[partid].size();
+
+    part_offset_flat(partid + 1) =
+        part_offset_flat(partid) + key_list_parts[partid].size();
+    part_filter_offset[partid + 1] =
+        part_filter_offset[partid] + key_filter_list_parts[partid].size();
   }
   // TODO: DB iterator not support partition_offset
   writer->Add(tensor_key + "-partition_offset", *part_offset_tensor);
+  if (range_sharded) {
+    // Marks the dump as range-partitioned; restore must not apply the
+    // mod-bucket selection to it.
+    writer->Add(tensor_key + "-range_split_points", range_split_tensor);
+  }
   for(int i = 0; i <  kSavedPartitionNum + 1; i++) {
     part_offset_flat(i) = part_filter_offset[i];
   }
@@ -324,75 +571,77 @@ Status DumpEmbeddingValues(EmbeddingVar<K, V>* ev,
   VLOG(1) << "EV before partition:" << tensor_key << ", keysize:" <<  tot_key_list.size()
           << ", valueptr size:" << tot_valueptr_list.size();
   VLOG(1) << "EV after partition:" << tensor_key << ", ptsize:" << ptsize
-          << ", keysize:"<<  partitioned_tot_key_list.size()
-          <<", valueptr size:" << partitioned_tot_valueptr_list.size();
+          << ", filtered keysize:" << tot_key_filter_num;
 
   size_t bytes_limit = 8 << 20;
   char* dump_buffer = (char*)malloc(sizeof(char) * bytes_limit);
   Status st;
 
-  EVKeyDumpIterator<K> ev_key_dump_iter(partitioned_tot_key_list);
+  // Dump straight out of the per-partition buckets so we never hold a
+  // second, concatenated copy of the keys/versions/freqs while the
+  // bundle is written.
+  EVPartsDumpIterator<K> ev_key_dump_iter(key_list_parts);
   st = SaveTensorWithFixedBuffer(tensor_key + "-keys", writer, dump_buffer,
                                  bytes_limit, &ev_key_dump_iter,
-                                 TensorShape({partitioned_tot_key_list.size() + iterator_size}),
+                                 TensorShape({ptsize + iterator_size}),
                                  it);
   if (!st.ok()) {
     free(dump_buffer);
     return st;
   }
 
-  EVValueDumpIterator<K, V> ev_value_dump_iter(ev, partitioned_tot_valueptr_list);
+  EVValuePartsDumpIterator<K, V> ev_value_dump_iter(ev, valueptr_list_parts);
   st = SaveTensorWithFixedBuffer(tensor_key + "-values", writer, dump_buffer,
       bytes_limit, &ev_value_dump_iter,
-      TensorShape({partitioned_tot_key_list.size() + iterator_size, ev->ValueLen()}),
+      TensorShape({ptsize + iterator_size, ev->ValueLen()}),
       it, ev->storage_manager()->GetOffset(ev->GetEmbeddingIndex()));
   if (!st.ok()) {
     free(dump_buffer);
     return st;
   }
 
-  EVVersionDumpIterator<int64> ev_version_dump_iter(partitioned_tot_version_list);
+  EVPartsDumpIterator<int64> ev_version_dump_iter(version_list_parts);
   st = SaveTensorWithFixedBuffer(tensor_key + "-versions", writer, dump_buffer,
       bytes_limit, &ev_version_dump_iter,
-      TensorShape({partitioned_tot_version_list.size()}));
+      TensorShape({tot_version_num}));
   if (!st.ok()) {
     free(dump_buffer);
     return st;
   }
 
-  EVFreqDumpIterator<int64> ev_freq_dump_iter(partitioned_tot_freq_list);
+  EVPartsDumpIterator<int64> ev_freq_dump_iter(freq_list_parts);
   st = SaveTensorWithFixedBuffer(tensor_key + "-freqs", writer, dump_buffer,
       bytes_limit, &ev_freq_dump_iter,
-      TensorShape({partitioned_tot_freq_list.size()}));
+      TensorShape({tot_freq_num}));
   if (!st.ok()) {
     free(dump_buffer);
     return st;
   }
 
-  EVKeyDumpIterator<K> ev_key_filter_dump_iter(partitioned_tot_key_filter_list);
+  EVPartsDumpIterator<K> ev_key_filter_dump_iter(key_filter_list_parts);
   st = SaveTensorWithFixedBuffer(tensor_key + "-keys_filtered",
       writer, dump_buffer, bytes_limit, &ev_key_filter_dump_iter,
-      TensorShape({partitioned_tot_key_filter_list.size()}));
+      TensorShape({tot_key_filter_num}));
   if (!st.ok()) {
     free(dump_buffer);
     return st;
   }
 
-  EVVersionDumpIterator<int64> ev_version_filter_dump_iter(
-      partitioned_tot_version_filter_list);
+  EVPartsDumpIterator<int64> ev_version_filter_dump_iter(
+      version_filter_list_parts);
   st = SaveTensorWithFixedBuffer(tensor_key + "-versions_filtered",
       writer, dump_buffer, bytes_limit, &ev_version_filter_dump_iter,
-      TensorShape({partitioned_tot_version_filter_list.size()}));
+      TensorShape({tot_version_filter_num}));
   if (!st.ok()) {
     free(dump_buffer);
     return st;
   }
 
-  EVFreqDumpIterator<int64> ev_freq_filter_dump_iter(
-      partitioned_tot_freq_filter_list);
+  EVPartsDumpIterator<int64> ev_freq_filter_dump_iter(
+      freq_filter_list_parts);
   st = SaveTensorWithFixedBuffer(tensor_key + "-freqs_filtered",
       writer, dump_buffer, bytes_limit, &ev_freq_filter_dump_iter,
-      TensorShape({partitioned_tot_freq_filter_list.size()}));
+      TensorShape({tot_freq_filter_num}));
   if (!st.ok()) {
     free(dump_buffer);
     return st;
@@ -537,10 +786,116 @@ Status DynamicRestoreValue(EmbeddingVar<K, V>* ev, BundleReader* reader,
   return Status::OK();
 }
 
+// Zero-copy restore: maps the bundle's value segment MAP_PRIVATE and
+// inserts MmapContiguousValuePtrs that point into the mapping, so
+// startup is bounded by page-fault rate instead of copy bandwidth and
+// peak RSS is not doubled. The first update of a row faults its page
+// copy-on-write. The mapping intentionally outlives the restore; rows
+// keep referencing it for the life of the variable. Only usable for
+// primary variables without slots, full-table restores (partition
+// repartitioning still needs the copying path).
+template<typename K, typename V>
+Status EVRestoreWithMmap(EmbeddingVar<K, V>* ev, BundleReader* reader,
+    const std::string& tensor_key, const std::string& tensor_value,
+    const std::string& tensor_version, bool reset_version) {
+  TensorShape key_shape, value_shape, version_shape;
+  TF_RETURN_IF_ERROR(reader->LookupTensorShape(tensor_key, &key_shape));
+  TF_RETURN_IF_ERROR(reader->LookupTensorShape(tensor_value, &value_shape));
+  TF_RETURN_IF_ERROR(
+      reader->LookupTensorShape(tensor_version, &version_shape));
+  if (ev->GetSlotNum() > 0) {
+    return errors::FailedPrecondition(
+        "mmap restore requires an EV without slot variables");
+  }
+  int64 value_len = value_shape.dim_size(1);
+  if (value_len != ev->ValueLen()) {
+    return errors::FailedPrecondition(
+        "mmap restore value_len mismatch: ", value_len, " vs ",
+        ev->ValueLen());
+  }
+  int64 value_size, value_offset;
+  string value_filename;
+  TF_RETURN_IF_ERROR(reader->GetTensorFileInfo(
+      tensor_value, &value_size, &value_filename, &value_offset));
+  int fd = open(value_filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return errors::Internal("mmap restore failed to open ", value_filename);
+  }
+  int64 page_size = sysconf(_SC_PAGESIZE);
+  int64 aligned_offset = value_offset / page_size * page_size;
+  int64 delta = value_offset - aligned_offset;
+  char* base = (char*)mmap(nullptr, value_size + delta,
+                           PROT_READ | PROT_WRITE, MAP_PRIVATE, fd,
+                           aligned_offset);
+  close(fd);
+  if (base == MAP_FAILED) {
+    return errors::Internal("mmap restore failed to map ", value_filename);
+  }
+  V* values = (V*)(base + delta);
+
+  TF_RETURN_IF_ERROR(reader->LookupHeader(tensor_key,
+      sizeof(K) * key_shape.dim_size(0)));
+  bool has_version = reader->LookupHeader(tensor_version,
+      sizeof(int64) * version_shape.dim_size(0)).ok();
+
+  size_t buffer_size = 8 << 20;
+  std::unique_ptr<char[]> key_buffer(new char[buffer_size]);
+  std::unique_ptr<char[]> version_buffer(new char[buffer_size]);
+  int64 tot_key_num = key_shape.dim_size(0);
+  int64 row = 0;
+  size_t key_bytes_read = 0;
+  size_t version_bytes_read = 0;
+  while (tot_key_num > 0) {
+    size_t read_key_num =
+        std::min((int64)(buffer_size / sizeof(K)), tot_key_num);
+    TF_RETURN_IF_ERROR(reader->LookupSegment(tensor_key,
+        read_key_num * sizeof(K), key_buffer.get(), key_bytes_read));
+    if (key_bytes_read == 0) {
+      break;
+    }
+    read_key_num = key_bytes_read / sizeof(K);
+    K* keys = (K*)key_buffer.get();
+    int64* versions = nullptr;
+    if (has_version && !reset_version) {
+      TF_RETURN_IF_ERROR(reader->LookupSegment(tensor_version,
+          read_key_num * sizeof(int64), version_buffer.get(),
+          version_bytes_read));
+      if (version_bytes_read == read_key_num * sizeof(int64)) {
+        versions = (int64*)version_buffer.get();
+      }
+    }
+    for (size_t i = 0; i < read_key_num; ++i, ++row) {
+      ValuePtr<V>* value_ptr =
+          new MmapContiguousValuePtr<V>(values + row * value_len);
+      if (versions != nullptr) {
+        value_ptr->SetStep(versions[i]);
+      }
+      Status s = ev->storage_manager()->Insert(keys[i], value_ptr);
+      if (!s.ok()) {
+        delete value_ptr;
+      }
+    }
+    tot_key_num -= read_key_num;
+  }
+  LOG(INFO) << "restored " << row << " keys of " << tensor_key
+            << " from mmap of " << value_filename;
+  return Status::OK();
+}
+
 template<typename K, typename V>
 Status EVRestoreNoPartition(EmbeddingVar<K, V>* ev, BundleReader* reader,
     std::string tensor_key, std::string tensor_value,
     std::string tensor_version, std::string tensor_freq, bool reset_version=false) {
+  const char* mmap_restore = std::getenv("TF_EV_RESTORE_MMAP");
+  if (mmap_restore != nullptr && mmap_restore[0] == '1') {
+    Status ms = EVRestoreWithMmap(ev, reader, tensor_key, tensor_value,
+                                  tensor_version, reset_version);
+    if (ms.ok()) {
+      return ms;
+    }
+    LOG(WARNING) << "mmap restore unavailable for " << tensor_key << ": "
+                 << ms.ToString() << ", falling back to copying restore";
+  }
   TensorShape key_shape;
   TensorShape value_shape;
   TensorShape version_shape;
@@ -647,6 +1002,8 @@ Status EVRestoreNoPartition(EmbeddingVar<K, V>* ev, BundleReader* reader,
   size_t freq_filter_bytes_read = 0;
 
   int64 tot_key_num = key_shape.dim_size(0);
+  // Presize the hash table so the bulk load below does not rehash.
+  TF_CHECK_OK(ev->Reserve(tot_key_num));
   size_t value_unit_bytes = sizeof(V) *  value_shape.dim_size(1);
   std::string key_str = "|";
   while(tot_key_num > 0) {
@@ -782,6 +1139,463 @@ Status EVRestoreOldFromCheckpoint(EmbeddingVar<K, V>* ev,
   return s;
 }
 
+// Restores one saved part of a range-sharded dump (see
+// EVRangeShardedSaveEnabled). This PS owns the contiguous bucket run
+// [partition_id*kSavedPartitionNum/partition_num, next PS's start), so
+// its keys/values/versions/freqs are each one contiguous byte range of
+// the dumped tensors, located directly from the partition offsets and
+// read with a single streaming pass instead of strided per-bucket
+// lookups. Keys are imported unfiltered; the serving partitioner must
+// place keys by the same ranges.
+template<typename K, typename V>
+Status EVRestoreRangeSharded(EmbeddingVar<K, V>* ev,
+    const std::string& tensor_name, int partition_id, int partition_num,
+    BundleReader* reader, const std::string& part_offset_tensor_suffix,
+    const std::string& key_suffix, const std::string& value_suffix,
+    const std::string& version_suffix, const std::string& freq_suffix,
+    bool reset_version) {
+  string tensor_key = tensor_name + key_suffix;
+  string tensor_value = tensor_name + value_suffix;
+  string tensor_version = tensor_name + version_suffix;
+  string tensor_freq = tensor_name + freq_suffix;
+  string offset_tensor_name = tensor_name + part_offset_tensor_suffix;
+  string offset_filter_tensor_name =
+      tensor_name + "-partition_filter_offset";
+
+  TensorShape key_shape, value_shape, version_shape, freq_shape;
+  TensorShape key_filter_shape;
+  TF_RETURN_IF_ERROR(reader->LookupTensorShape(tensor_key, &key_shape));
+  TF_RETURN_IF_ERROR(reader->LookupTensorShape(tensor_value, &value_shape));
+  TF_RETURN_IF_ERROR(
+      reader->LookupTensorShape(tensor_version, &version_shape));
+  bool filter_flag = true;
+  Status st = reader->LookupTensorShape(tensor_freq, &freq_shape);
+  if (!st.ok()) {
+    if (st.code() == error::NOT_FOUND) {
+      freq_shape = version_shape;
+    } else {
+      return st;
+    }
+  }
+  bool restore_filter_flag = true;
+  st = reader->LookupTensorShape(tensor_key + "_filtered",
+      &key_filter_shape);
+  if (!st.ok()) {
+    if (st.code() == error::NOT_FOUND) {
+      restore_filter_flag = false;
+    } else {
+      return st;
+    }
+  }
+
+  TF_RETURN_IF_ERROR(reader->LookupHeader(tensor_key,
+      sizeof(K) * key_shape.dim_size(0)));
+  TF_RETURN_IF_ERROR(reader->LookupHeader(tensor_value,
+      sizeof(V) * value_shape.dim_size(0) * value_shape.dim_size(1)));
+  TF_RETURN_IF_ERROR(reader->LookupHeader(tensor_version,
+      sizeof(int64) * version_shape.dim_size(0)));
+  st = reader->LookupHeader(tensor_freq,
+      sizeof(int64) * freq_shape.dim_size(0));
+  if (!st.ok()) {
+    if (st.code() == error::NOT_FOUND) {
+      filter_flag = false;
+    } else {
+      return st;
+    }
+  }
+  if (restore_filter_flag) {
+    TF_RETURN_IF_ERROR(reader->LookupHeader(tensor_key + "_filtered",
+        sizeof(K) * key_filter_shape.dim_size(0)));
+    reader->LookupHeader(tensor_version + "_filtered",
+        sizeof(int64) * key_filter_shape.dim_size(0)).IgnoreError();
+    reader->LookupHeader(tensor_freq + "_filtered",
+        sizeof(int64) * key_filter_shape.dim_size(0)).IgnoreError();
+  }
+
+  std::vector<int32> part_offset(kSavedPartitionNum + 1);
+  TF_RETURN_IF_ERROR(reader->LookupHeader(offset_tensor_name,
+      sizeof(int32) * (kSavedPartitionNum + 1)));
+  size_t offset_bytes_read = 0;
+  TF_RETURN_IF_ERROR(reader->LookupSegment(offset_tensor_name,
+      (kSavedPartitionNum + 1) * sizeof(int32),
+      (char*)part_offset.data(), offset_bytes_read));
+  std::vector<int32> part_filter_offset(kSavedPartitionNum + 1, 0);
+  if (restore_filter_flag) {
+    TF_RETURN_IF_ERROR(reader->LookupHeader(offset_filter_tensor_name,
+        sizeof(int32) * (kSavedPartitionNum + 1)));
+    TF_RETURN_IF_ERROR(reader->LookupSegment(offset_filter_tensor_name,
+        (kSavedPartitionNum + 1) * sizeof(int32),
+        (char*)part_filter_offset.data(), offset_bytes_read));
+  }
+
+  const int begin_bucket =
+      partition_id * kSavedPartitionNum / partition_num;
+  const int end_bucket =
+      (partition_id + 1) * kSavedPartitionNum / partition_num;
+  const int32 subpart_offset = part_offset[begin_bucket];
+  int64 tot_key_num = part_offset[end_bucket] - subpart_offset;
+  TF_CHECK_OK(ev->Reserve(tot_key_num));
+  size_t value_unit_bytes = sizeof(V) * value_shape.dim_size(1);
+  int64 key_part_offset = subpart_offset * sizeof(K);
+  int64 value_part_offset = subpart_offset * value_unit_bytes;
+  int64 version_part_offset = subpart_offset * sizeof(int64);
+  int64 freq_part_offset = subpart_offset * sizeof(int64);
+
+  VLOG(1) << "range-sharded load ev: " << tensor_name
+          << ", buckets: [" << begin_bucket << ", " << end_bucket
+          << "), partition_id:" << partition_id
+          << ", partition_num:" << partition_num
+          << ", keynum:" << tot_key_num;
+
+  size_t buffer_size = 8 << 20;
+  RestoreBuffer restore_buff;
+  restore_buff.key_buffer = new char[buffer_size];
+  restore_buff.value_buffer = new char[buffer_size];
+  restore_buff.version_buffer = new char[buffer_size];
+  restore_buff.freq_buffer = new char[buffer_size];
+
+  int64 tot_key_bytes_read(0);
+  int64 tot_value_bytes_read(0);
+  int64 tot_version_bytes_read(0);
+  int64 tot_freq_bytes_read(0);
+  size_t key_bytes_read = 0;
+  size_t value_bytes_read = 0;
+  size_t version_bytes_read = 0;
+  size_t freq_bytes_read = 0;
+  while (tot_key_num > 0) {
+    size_t read_key_num = std::min(std::min(buffer_size / sizeof(K),
+          buffer_size / value_unit_bytes), buffer_size / sizeof(int64));
+    read_key_num = std::min((int64)read_key_num, tot_key_num);
+    reader->LookupSegmentOffset(tensor_key,
+        key_part_offset + tot_key_bytes_read, read_key_num * sizeof(K),
+        restore_buff.key_buffer, key_bytes_read);
+    reader->LookupSegmentOffset(tensor_value,
+        value_part_offset + tot_value_bytes_read,
+        read_key_num * value_unit_bytes, restore_buff.value_buffer,
+        value_bytes_read);
+    if (!reset_version) {
+      reader->LookupSegmentOffset(tensor_version,
+          version_part_offset + tot_version_bytes_read,
+          read_key_num * sizeof(int64), restore_buff.version_buffer,
+          version_bytes_read);
+      if (version_bytes_read == 0) {
+        memset(restore_buff.version_buffer, -1,
+               sizeof(int64) * read_key_num);
+      }
+    } else {
+      memset(restore_buff.version_buffer, 0, read_key_num * sizeof(int64));
+    }
+    if (filter_flag) {
+      reader->LookupSegmentOffset(tensor_freq,
+          freq_part_offset + tot_freq_bytes_read,
+          read_key_num * sizeof(int64), restore_buff.freq_buffer,
+          freq_bytes_read);
+    } else {
+      int64* freq_tmp = (int64*)restore_buff.freq_buffer;
+      for (int64 i = 0; i < read_key_num; i++) {
+        freq_tmp[i] = ev->MinFreq();
+      }
+    }
+    if (key_bytes_read > 0) {
+      read_key_num = key_bytes_read / sizeof(K);
+      VLOG(2) << "restore, read_key_num:" << read_key_num;
+      // The bucket run is exactly this PS's share; import it whole.
+      st = ev->Import(restore_buff, read_key_num, 1, 0, 1, false);
+      if (!st.ok()) {
+        return st;
+      }
+    }
+    tot_key_num -= read_key_num;
+    tot_key_bytes_read += key_bytes_read;
+    tot_value_bytes_read += value_bytes_read;
+    tot_version_bytes_read += version_bytes_read;
+    tot_freq_bytes_read += freq_bytes_read;
+  }
+
+  if (restore_filter_flag) {
+    const int32 subpart_filter_offset = part_filter_offset[begin_bucket];
+    int64 tot_key_filter_num =
+        part_filter_offset[end_bucket] - subpart_filter_offset;
+    int64 key_filter_part_offset = subpart_filter_offset * sizeof(K);
+    int64 version_filter_part_offset = subpart_filter_offset * sizeof(int64);
+    int64 freq_filter_part_offset = subpart_filter_offset * sizeof(int64);
+    int64 tot_key_filter_bytes_read(0), tot_version_filter_bytes_read(0),
+          tot_freq_filter_bytes_read(0);
+    size_t key_filter_bytes_read = 0;
+    size_t version_filter_bytes_read = 0;
+    size_t freq_filter_bytes_read = 0;
+    while (tot_key_filter_num > 0) {
+      size_t read_key_num =
+          std::min(buffer_size / sizeof(K), buffer_size / sizeof(int64));
+      read_key_num = std::min((int64)read_key_num, tot_key_filter_num);
+      reader->LookupSegmentOffset(tensor_key + "_filtered",
+          key_filter_part_offset + tot_key_filter_bytes_read,
+          read_key_num * sizeof(K), restore_buff.key_buffer,
+          key_filter_bytes_read);
+      if (!reset_version) {
+        reader->LookupSegmentOffset(tensor_version + "_filtered",
+            version_filter_part_offset + tot_version_filter_bytes_read,
+            read_key_num * sizeof(int64), restore_buff.version_buffer,
+            version_filter_bytes_read);
+      } else {
+        memset(restore_buff.version_buffer, 0,
+               read_key_num * sizeof(int64));
+      }
+      reader->LookupSegmentOffset(tensor_freq + "_filtered",
+          freq_filter_part_offset + tot_freq_filter_bytes_read,
+          read_key_num * sizeof(int64), restore_buff.freq_buffer,
+          freq_filter_bytes_read);
+      if (key_filter_bytes_read > 0) {
+        read_key_num = key_filter_bytes_read / sizeof(K);
+        st = ev->Import(restore_buff, read_key_num, 1, 0, 1, true);
+        if (!st.ok()) {
+          return st;
+        }
+      }
+      tot_key_filter_num -= read_key_num;
+      tot_key_filter_bytes_read += key_filter_bytes_read;
+      tot_version_filter_bytes_read += version_filter_bytes_read;
+      tot_freq_filter_bytes_read += freq_filter_bytes_read;
+    }
+  }
+  return Status::OK();
+}
+
+// Fast compatibility check run before an EV restore begins streaming.
+// Reads only bundle metadata (dtypes and shapes from the header) and
+// cross-checks it against the variable's live configuration, so an
+// incompatible checkpoint — changed embedding dim, wrong key or value
+// dtype, keys/values out of step — fails in seconds instead of twenty
+// minutes into the load. Slot variables each run their own import op,
+// so a missing slot surfaces as that op's missing-keys error here.
+template<typename K, typename V>
+Status EVValidateRestoreCompatibility(EmbeddingVar<K, V>* ev,
+    const std::string& name_string, BundleReader* reader,
+    const std::string& key_suffix, const std::string& value_suffix) {
+  // Collect the bundle tensor names backing this variable: the plain
+  // name, or every original part_N alias when the name is partitioned
+  // (the saving job may have used a different partition count).
+  std::vector<string> tensor_names;
+  const size_t part_pos = name_string.find(part_str);
+  if (part_pos == std::string::npos) {
+    tensor_names.push_back(name_string);
+  } else {
+    size_t digits_end = part_pos + part_str.size();
+    while (digits_end < name_string.size() &&
+           isdigit(name_string[digits_end])) {
+      ++digits_end;
+    }
+    const string pre_subname = name_string.substr(0, part_pos);
+    const string post_subname = name_string.substr(digits_end);
+    for (int orig_partnum = 0; ; ++orig_partnum) {
+      const string tensor_name = pre_subname + part_str +
+          std::to_string(orig_partnum) + post_subname;
+      TensorShape unused;
+      if (!reader->LookupTensorShape(tensor_name + key_suffix, &unused).ok()) {
+        break;
+      }
+      tensor_names.push_back(tensor_name);
+    }
+    // Old-form checkpoints only carry this worker's own part.
+    if (tensor_names.empty()) {
+      tensor_names.push_back(name_string);
+    }
+  }
+
+  for (const string& tensor_name : tensor_names) {
+    DataType key_dtype, value_dtype;
+    TensorShape key_shape, value_shape;
+    Status s = reader->LookupDtypeAndShape(
+        tensor_name + key_suffix, &key_dtype, &key_shape);
+    if (!s.ok()) {
+      return errors::InvalidArgument(
+          "checkpoint has no keys tensor ", tensor_name, key_suffix,
+          " for EV ", name_string);
+    }
+    s = reader->LookupDtypeAndShape(
+        tensor_name + value_suffix, &value_dtype, &value_shape);
+    if (!s.ok()) {
+      return errors::InvalidArgument(
+          "checkpoint has no values tensor ", tensor_name, value_suffix,
+          " for EV ", name_string);
+    }
+    if (key_dtype != DataTypeToEnum<K>::v()) {
+      return errors::InvalidArgument(
+          "EV ", name_string, " key dtype mismatch: checkpoint has ",
+          DataTypeString(key_dtype), ", graph expects ",
+          DataTypeString(DataTypeToEnum<K>::v()));
+    }
+    if (value_dtype != DataTypeToEnum<V>::v()) {
+      return errors::InvalidArgument(
+          "EV ", name_string, " value dtype mismatch: checkpoint has ",
+          DataTypeString(value_dtype), ", graph expects ",
+          DataTypeString(DataTypeToEnum<V>::v()));
+    }
+    if (value_shape.dims() != 2 ||
+        value_shape.dim_size(1) != ev->ValueLen()) {
+      return errors::InvalidArgument(
+          "EV ", name_string, " embedding dim mismatch: checkpoint values ",
+          value_shape.DebugString(), ", graph expects [*, ",
+          ev->ValueLen(), "]");
+    }
+    if (key_shape.dims() != 1 ||
+        key_shape.dim_size(0) != value_shape.dim_size(0)) {
+      return errors::InvalidArgument(
+          "EV ", name_string, " corrupt part ", tensor_name, ": keys ",
+          key_shape.DebugString(), " vs values ",
+          value_shape.DebugString());
+    }
+  }
+  return Status::OK();
+}
+
+// Streams a set of subpart key runs of one checkpoint part into the
+// variable. Each call owns the reader and buffers it is handed, so
+// several shards can run on separate threads against private
+// BundleReaders: EmbeddingVar::Import inserts through the lockless
+// map, and the runs of distinct subparts are disjoint, so shards never
+// write the same row from two threads. ranges/filter_ranges are
+// [begin, end) element offsets per subpart, as read from the
+// partition-offset tensors.
+template<typename K, typename V>
+Status EVRestoreSubpartShard(EmbeddingVar<K, V>* ev, BundleReader* reader,
+    const string& tensor_key, const string& tensor_value,
+    const string& tensor_version, const string& tensor_freq,
+    size_t value_unit_bytes,
+    const std::vector<std::pair<int32, int32>>& ranges,
+    const std::vector<std::pair<int32, int32>>& filter_ranges,
+    int partition_id, int partition_num, bool reset_version,
+    bool filter_flag) {
+  size_t buffer_size = 8 << 20;
+  RestoreBuffer restore_buff;
+  restore_buff.key_buffer = new char[buffer_size];
+  restore_buff.value_buffer = new char[buffer_size];
+  restore_buff.version_buffer = new char[buffer_size];
+  restore_buff.freq_buffer = new char[buffer_size];
+  Status st;
+
+  for (size_t r = 0; r < ranges.size(); ++r) {
+    const int32 subpart_offset = ranges[r].first;
+    int64 tot_key_num = ranges[r].second - subpart_offset;
+    int64 key_part_offset = subpart_offset * sizeof(K);
+    int64 value_part_offset = subpart_offset * value_unit_bytes;
+    int64 version_part_offset = subpart_offset * sizeof(int64);
+    int64 freq_part_offset = subpart_offset * sizeof(int64);
+
+    VLOG(1) << "dynamically load ev : " << tensor_key
+            << ", subpart_offset:" << subpart_offset
+            << ", partition_id:" << partition_id
+            << ", partition_num:" << partition_num
+            << ", keynum:" << tot_key_num;
+
+    int64 tot_key_bytes_read(0);
+    int64 tot_value_bytes_read(0);
+    int64 tot_version_bytes_read(0);
+    int64 tot_freq_bytes_read(0);
+    size_t key_bytes_read = 0;
+    size_t value_bytes_read = 0;
+    size_t version_bytes_read = 0;
+    size_t freq_bytes_read = 0;
+    while (tot_key_num > 0) {
+      size_t read_key_num = std::min(std::min(buffer_size / sizeof(K),
+            buffer_size / value_unit_bytes), buffer_size / sizeof(int64));
+      read_key_num = std::min((int64)read_key_num, tot_key_num);
+      reader->LookupSegmentOffset(tensor_key,
+          key_part_offset + tot_key_bytes_read, read_key_num * sizeof(K),
+          restore_buff.key_buffer, key_bytes_read);
+      reader->LookupSegmentOffset(tensor_value,
+          value_part_offset + tot_value_bytes_read,
+          read_key_num * value_unit_bytes, restore_buff.value_buffer,
+          value_bytes_read);
+      if (!reset_version) {
+        reader->LookupSegmentOffset(tensor_version,
+            version_part_offset + tot_version_bytes_read,
+            read_key_num * sizeof(int64), restore_buff.version_buffer,
+            version_bytes_read);
+        if (version_bytes_read == 0) {
+          memset(restore_buff.version_buffer, -1, sizeof(int64) * read_key_num);
+        }
+      } else {
+        memset(restore_buff.version_buffer, 0, read_key_num * sizeof(int64));
+      }
+      if (filter_flag) {
+        reader->LookupSegmentOffset(tensor_freq,
+            freq_part_offset + tot_freq_bytes_read,
+            read_key_num * sizeof(int64), restore_buff.freq_buffer,
+            freq_bytes_read);
+      } else {
+        int64* freq_tmp = (int64*)restore_buff.freq_buffer;
+        for (int64 i = 0; i < read_key_num; i++) {
+          freq_tmp[i] = ev->MinFreq();
+        }
+      }
+      if (key_bytes_read > 0) {
+        read_key_num = key_bytes_read / sizeof(K);
+        VLOG(2) << "restore, read_key_num:" << read_key_num;
+        st = ev->Import(restore_buff, read_key_num, kSavedPartitionNum,
+            partition_id, partition_num, false);
+        if (!st.ok()) {
+          return st;
+        }
+      }
+      tot_key_num -= read_key_num;
+      tot_key_bytes_read += key_bytes_read;
+      tot_value_bytes_read += value_bytes_read;
+      tot_version_bytes_read += version_bytes_read;
+      tot_freq_bytes_read += freq_bytes_read;
+    }
+
+    if (r < filter_ranges.size()) {
+      const int32 subpart_filter_offset = filter_ranges[r].first;
+      int64 tot_key_filter_num = filter_ranges[r].second -
+          subpart_filter_offset;
+      int64 key_filter_part_offset = subpart_filter_offset * sizeof(K);
+      int64 version_filter_part_offset = subpart_filter_offset * sizeof(int64);
+      int64 freq_filter_part_offset = subpart_filter_offset * sizeof(int64);
+      int64 tot_key_filter_bytes_read(0), tot_version_filter_bytes_read(0),
+            tot_freq_filter_bytes_read(0);
+      size_t key_filter_bytes_read = 0;
+      size_t version_filter_bytes_read = 0;
+      size_t freq_filter_bytes_read = 0;
+      while (tot_key_filter_num > 0) {
+        size_t read_key_num =
+            std::min(buffer_size / sizeof(K), buffer_size / sizeof(int64));
+        read_key_num = std::min((int64)read_key_num, tot_key_filter_num);
+        reader->LookupSegmentOffset(tensor_key + "_filtered",
+            key_filter_part_offset + tot_key_filter_bytes_read,
+            read_key_num * sizeof(K), restore_buff.key_buffer,
+            key_filter_bytes_read);
+        if (!reset_version) {
+          reader->LookupSegmentOffset(tensor_version + "_filtered",
+              version_filter_part_offset + tot_version_filter_bytes_read,
+              read_key_num * sizeof(int64), restore_buff.version_buffer,
+              version_filter_bytes_read);
+        } else {
+          memset(restore_buff.version_buffer, 0, read_key_num * sizeof(int64));
+        }
+        reader->LookupSegmentOffset(tensor_freq + "_filtered",
+            freq_filter_part_offset + tot_freq_filter_bytes_read,
+            read_key_num * sizeof(int64), restore_buff.freq_buffer,
+            freq_filter_bytes_read);
+        if (key_filter_bytes_read > 0) {
+          read_key_num = key_filter_bytes_read / sizeof(K);
+          VLOG(2) << "restore, read_key_num:" << read_key_num;
+          st = ev->Import(restore_buff, read_key_num, kSavedPartitionNum,
+              partition_id, partition_num, true);
+          if (!st.ok()) {
+            return st;
+          }
+        }
+        tot_key_filter_num -= read_key_num;
+        tot_key_filter_bytes_read += key_filter_bytes_read;
+        tot_version_filter_bytes_read += version_filter_bytes_read;
+        tot_freq_filter_bytes_read += freq_filter_bytes_read;
+      }
+    }
+  }
+  return Status::OK();
+}
+
 template<typename K, typename V>
 Status EVRestoreDynamically(EmbeddingVar<K, V>* ev,
     const std::string& name_string, int partition_id,
@@ -789,7 +1603,7 @@ Status EVRestoreDynamically(EmbeddingVar<K, V>* ev,
     BundleReader* reader, const std::string& part_offset_tensor_suffix,
     const std::string& key_suffix, const std::string& value_suffix,
     const std::string& version_suffix, const std::string& freq_suffix,
-    bool reset_version = false) {
+    bool reset_version = false, const std::string& file_name_string = "") {
 
   // first check whether there is partition
   if (name_string.find(part_str) == std::string::npos) {
@@ -828,12 +1642,7 @@ Status EVRestoreDynamically(EmbeddingVar<K, V>* ev,
             << ", partition_num:" << partition_num;
 
     int orig_partnum = 0;
-    size_t buffer_size = 8 << 20;
-    RestoreBuffer restore_buff;
-    restore_buff.key_buffer = new char[buffer_size];
-    restore_buff.value_buffer = new char[buffer_size];
-    restore_buff.version_buffer = new char[buffer_size];
-    restore_buff.freq_buffer = new char[buffer_size];
+    int64 reserved_key_num = 0;
 
     for (;  ; orig_partnum++) {
       string part_id = std::to_string(orig_partnum);
@@ -855,6 +1664,25 @@ Status EVRestoreDynamically(EmbeddingVar<K, V>* ev,
                 << " not exist, reach the end of restoring";
         break;
       }
+      // A dump carrying range split points was partitioned by key
+      // range, not by mod; the strided bucket selection below would
+      // drop its keys.
+      TensorShape range_split_shape;
+      if (reader->LookupTensorShape(tensor_name + "-range_split_points",
+              &range_split_shape).ok()) {
+        st = EVRestoreRangeSharded(ev, tensor_name, partition_id,
+            partition_num, reader, part_offset_tensor_suffix, key_suffix,
+            value_suffix, version_suffix, freq_suffix, reset_version);
+        if (!st.ok()) {
+          LOG(FATAL) << "EV restoring fail:" << st.ToString();
+        }
+        continue;
+      }
+      // Presize for this worker's share of the part so the bulk load
+      // below does not rehash; resizing never shrinks the table.
+      reserved_key_num +=
+          key_shape.dim_size(0) * loaded_parts.size() / kSavedPartitionNum;
+      TF_CHECK_OK(ev->Reserve(reserved_key_num));
       st = reader->LookupTensorShape(tensor_value, &value_shape);
       if (!st.ok()) {
         break;
@@ -980,126 +1808,71 @@ Status EVRestoreDynamically(EmbeddingVar<K, V>* ev,
       }
       auto part_filter_offset_flat = part_filter_offset_tensor.flat<int32>();
 
+      size_t value_unit_bytes = sizeof(V) * value_shape.dim_size(1);
+      std::vector<std::pair<int32, int32>> ranges;
+      std::vector<std::pair<int32, int32>> filter_ranges;
       for (size_t i = 0; i < loaded_parts.size(); i++) {
         int subpart_id = loaded_parts[i];
-        int subpart_offset = part_offset_flat(subpart_id);
-
-        size_t value_unit_bytes = sizeof(V) *  value_shape.dim_size(1);
-        int64 tot_key_num = part_offset_flat(subpart_id + 1) - subpart_offset;
-        int64 key_part_offset = subpart_offset * sizeof(K);
-        int64 value_part_offset = subpart_offset *  value_unit_bytes;
-        int64 version_part_offset = subpart_offset * sizeof(int64);
-        int64 freq_part_offset = subpart_offset * sizeof(int64);
-
-        VLOG(1) << "dynamically load ev : " << name_string
-                << ", subpartid:" << loaded_parts[i]
-                << ", subpart_offset:" << subpart_offset
-                << ", partition_id:" << partition_id
-                << ", partition_num:" << partition_num
-                << ", keynum:" << tot_key_num;
-
-        int64 tot_key_bytes_read(0);
-        int64 tot_value_bytes_read(0);
-        int64 tot_version_bytes_read(0);
-        int64 tot_freq_bytes_read(0);
-        size_t key_bytes_read = 0;
-        size_t value_bytes_read = 0;
-        size_t version_bytes_read = 0;
-        size_t freq_bytes_read = 0;
-        while(tot_key_num > 0) {
-          size_t read_key_num = std::min(std::min(buffer_size / sizeof(K),
-                buffer_size / value_unit_bytes), buffer_size / sizeof(int64));
-          read_key_num = std::min((int64)read_key_num, tot_key_num);
-          reader->LookupSegmentOffset(tensor_key,
-              key_part_offset + tot_key_bytes_read, read_key_num * sizeof(K),
-              restore_buff.key_buffer, key_bytes_read);
-
-          reader->LookupSegmentOffset(tensor_value,
-              value_part_offset + tot_value_bytes_read,
-              read_key_num * value_unit_bytes, restore_buff.value_buffer,
-              value_bytes_read);
-          if (!reset_version) {
-            reader->LookupSegmentOffset(tensor_version,
-                version_part_offset + tot_version_bytes_read,
-                read_key_num * sizeof(int64), restore_buff.version_buffer,
-                version_bytes_read);
-            if (version_bytes_read == 0) {
-              memset(restore_buff.version_buffer, -1, sizeof(int64) * read_key_num);
-            }
-          } else {
-            int64 *version_tmp = (int64*)restore_buff.version_buffer;
-            memset(version_tmp, 0, read_key_num * sizeof(int64));
-          }
-          if (filter_flag) {
-            reader->LookupSegmentOffset(tensor_freq,
-                freq_part_offset + tot_freq_bytes_read,
-                read_key_num * sizeof(int64), restore_buff.freq_buffer,
-                freq_bytes_read);
-          } else {
-            int64 *freq_tmp = (int64 *)restore_buff.freq_buffer;
-            for (int64 i = 0; i < read_key_num; i++) {
-              freq_tmp[i] = ev->MinFreq();
-            }
+        ranges.emplace_back(part_offset_flat(subpart_id),
+                            part_offset_flat(subpart_id + 1));
+        if (restore_filter_flag) {
+          filter_ranges.emplace_back(part_filter_offset_flat(subpart_id),
+                                     part_filter_offset_flat(subpart_id + 1));
+        }
+      }
+      // Shard this worker's subparts over private readers so the keys,
+      // values, versions and freqs of one table stream in a single
+      // interleaved parallel pass instead of run after run. A private
+      // BundleReader per shard keeps the shared reader's state out of
+      // the picture; Import itself goes through the lockless map and
+      // distinct subparts never touch the same row. Serial when the
+      // caller did not pass the bundle path.
+      static const int64 part_threads = [] {
+        const char* env = std::getenv("TF_EV_RESTORE_PART_THREAD_NUM");
+        return (env == nullptr) ? 4 : atoll(env);
+      }();
+      if (part_threads > 1 && !file_name_string.empty() &&
+          ranges.size() > 1) {
+        int num_shards = std::min<int64>(part_threads, ranges.size());
+        std::vector<Status> shard_status(num_shards);
+        {
+          thread::ThreadPool pool(Env::Default(), "ev_restore_parts",
+                                  num_shards);
+          for (int shard = 0; shard < num_shards; ++shard) {
+            pool.Schedule([&, shard]() {
+              std::vector<std::pair<int32, int32>> shard_ranges;
+              std::vector<std::pair<int32, int32>> shard_filter_ranges;
+              for (size_t i = shard; i < ranges.size(); i += num_shards) {
+                shard_ranges.emplace_back(ranges[i]);
+                if (restore_filter_flag) {
+                  shard_filter_ranges.emplace_back(filter_ranges[i]);
+                }
+              }
+              BundleReader shard_reader(Env::Default(), file_name_string);
+              if (!shard_reader.status().ok()) {
+                shard_status[shard] = shard_reader.status();
+                return;
+              }
+              shard_status[shard] = EVRestoreSubpartShard(
+                  ev, &shard_reader, tensor_key, tensor_value,
+                  tensor_version, tensor_freq, value_unit_bytes,
+                  shard_ranges, shard_filter_ranges, partition_id,
+                  partition_num, reset_version, filter_flag);
+            });
           }
-          if (key_bytes_read > 0) {
-            read_key_num = key_bytes_read / sizeof(K);
-            VLOG(2) << "restore, read_key_num:" << read_key_num;
-            st = ev->Import(restore_buff, read_key_num, kSavedPartitionNum,
-                partition_id, partition_num, false);
-            if (!st.ok()) {
-              LOG(FATAL) <<  "EV restoring fail:" << st.ToString();
-            }
+        }  // the pool destructor joins the shards
+        for (const Status& s : shard_status) {
+          if (!s.ok()) {
+            LOG(FATAL) << "EV restoring fail:" << s.ToString();
           }
-          tot_key_num -= read_key_num;
-          tot_key_bytes_read += key_bytes_read;
-          tot_value_bytes_read += value_bytes_read;
-          tot_version_bytes_read += version_bytes_read;
-          tot_freq_bytes_read += freq_bytes_read;
         }
-
-        if (restore_filter_flag) {
-          int subpart_filter_offset = part_filter_offset_flat(subpart_id);
-          int64 key_filter_part_offset = subpart_filter_offset * sizeof(K);
-          int64 version_filter_part_offset = subpart_filter_offset * sizeof(int64);
-          int64 freq_filter_part_offset = subpart_filter_offset * sizeof(int64);
-          int64 tot_key_filter_num =
-            part_filter_offset_flat(subpart_id + 1) - subpart_filter_offset;
-          int64 tot_key_filter_bytes_read(0), tot_version_filter_bytes_read(0),
-                tot_freq_filter_bytes_read(0);
-          size_t key_filter_bytes_read = 0;
-          size_t version_filter_bytes_read = 0;
-          size_t freq_filter_bytes_read = 0;
-          while (tot_key_filter_num > 0) {
-            size_t read_key_num =
-              std::min(buffer_size / sizeof(K), buffer_size / sizeof(int64));
-            read_key_num = std::min((int64)read_key_num, tot_key_filter_num);
-            reader->LookupSegmentOffset(tensor_key + "_filtered",
-                key_filter_part_offset + key_filter_bytes_read,
-                read_key_num * sizeof(K), restore_buff.key_buffer,
-                key_filter_bytes_read);
-            if (!reset_version) {
-              reader->LookupSegmentOffset(tensor_version + "_filtered",
-                  version_filter_part_offset + version_filter_bytes_read,
-                  read_key_num * sizeof(int64), restore_buff.version_buffer,
-                  version_filter_bytes_read);
-            } else {
-              int64 *version_tmp = (int64*)restore_buff.version_buffer;
-              memset(version_tmp, 0, read_key_num * sizeof(int64));
-            }
-            reader->LookupSegmentOffset(tensor_freq + "_filtered",
-                freq_filter_part_offset + freq_filter_bytes_read,
-                read_key_num * sizeof(int64), restore_buff.freq_buffer,
-                freq_filter_bytes_read);
-            if (key_filter_bytes_read > 0) {
-              read_key_num = key_filter_bytes_read / sizeof(K);
-              VLOG(2) << "restore, read_key_num:" << read_key_num;
-              st = ev->Import(restore_buff, read_key_num, kSavedPartitionNum,
-                  partition_id, partition_num, true);
-              if (!st.ok())
-               return st;
-              tot_key_filter_num -= read_key_num;
-            }
-          }
+      } else {
+        st = EVRestoreSubpartShard(
+            ev, reader, tensor_key, tensor_value, tensor_version,
+            tensor_freq, value_unit_bytes, ranges, filter_ranges,
+            partition_id, partition_num, reset_version, filter_flag);
+        if (!st.ok()) {
+          LOG(FATAL) << "EV restoring fail:" << st.ToString();
         }
       }
     }
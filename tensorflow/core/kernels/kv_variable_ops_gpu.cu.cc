@@ -96,6 +96,9 @@ public:
 template <typename K, typename V>
 GPUHashTable<K, V>::GPUHashTable(K empty_key_sentinel, Allocator* alloc, size_t initial_capacity) : initial_bank_size(initial_capacity) {
   hash_table = new DynamicHashTable<K, int32>(initial_capacity, empty_key_sentinel, -1, gpu_hash_map_tf_allocator<uint8_t>(alloc));
+  // The insert fast path accumulates into num_successes without
+  // resetting it per batch, so it must start from a known zero.
+  *(hash_table->map_.get_num_successes()) = 0;
   cudaMallocManaged(&start_idx, sizeof(cuda::atomic<std::size_t, cuda::thread_scope_device>));
   *start_idx = 0;
 }
@@ -108,6 +111,17 @@ GPUHashTable<K, V>::~GPUHashTable() {
 
 template <typename K, typename V>
 int32 GPUHashTable<K, V>::Size() {
+  if (unreconciled_inserts > 0) {
+    // Saves and snapshots need exact sizes; the admission path defers
+    // this reconciliation to stay stream-ordered.
+    cudaDeviceSynchronize();
+    std::size_t h_num_successes =
+        hash_table->map_.get_num_successes()->load(cuda::std::memory_order_relaxed);
+    hash_table->map_.update_submap_sizes(
+        hash_table->map_.get_submaps().size() - 1, h_num_successes);
+    *(hash_table->map_.get_num_successes()) = 0;
+    unreconciled_inserts = 0;
+  }
   return hash_table->map_.get_size();
 }
 
@@ -192,6 +206,45 @@ struct KvLookupInsertKey<GPUDevice, Key, V> {
     using mutableViewT = typename cuco::dynamic_map<Key, int32, cuda::thread_scope_device, gpu_hash_map_tf_allocator<uint8_t>>::mutable_view_type;
     using ViewT = typename cuco::dynamic_map<Key, int32, cuda::thread_scope_device, gpu_hash_map_tf_allocator<uint8_t>>::view_type;
     auto& map = hash_table->hash_table->map_;
+    auto const block_size_fast = 128;
+    auto const tile_size_fast = 4;
+
+    // Fast path: when the whole batch fits in the newest submap, insert
+    // with a single stream-ordered launch and return without touching
+    // the device. The success counter keeps accumulating on the device
+    // and host-cached submap sizes are only reconciled below when the
+    // headroom estimate runs out, so fresh-key admission does not break
+    // stream concurrency with a device-wide sync every step.
+    {
+      uint32_t last_submap_idx = map.get_submaps().size() - 1;
+      std::size_t headroom =
+          map.get_max_load_factor() * map.get_submaps()[last_submap_idx]->get_capacity() -
+          map.get_submaps()[last_submap_idx]->get_size();
+      if (headroom > hash_table->unreconciled_inserts &&
+          headroom - hash_table->unreconciled_inserts >=
+              std::max<std::size_t>(num_items, map.get_min_insert_size())) {
+        auto const grid_size =
+            (tile_size_fast * num_items + block_size_fast - 1) / block_size_fast;
+        TF_CHECK_OK(GpuLaunchKernel(kv_lookup_and_insert_key_kernel<block_size_fast, tile_size_fast, Key, mutableViewT, ViewT, cuco::detail::MurmurHash3_32<Key>, thrust::equal_to<Key>>,
+                                    grid_size, block_size_fast, 0, stream,
+                                    key_first, value_first, num_items,
+                                    map.get_submap_mutable_views().data().get(), map.get_submap_views().data().get(), map.get_submaps().size(),
+                                    map.get_num_successes(), start_idx, last_submap_idx,
+                                    cuco::detail::MurmurHash3_32<Key>{}, thrust::equal_to<Key>{}));
+        hash_table->unreconciled_inserts += num_items;
+        return;
+      }
+
+      // Slow path: reconcile the deferred insert count once so the
+      // cached submap sizes are exact before growing the map.
+      if (hash_table->unreconciled_inserts > 0) {
+        CUCO_CUDA_TRY(cudaStreamSynchronize(stream));
+        std::size_t h_num_successes = map.get_num_successes()->load(cuda::std::memory_order_relaxed);
+        map.update_submap_sizes(last_submap_idx, h_num_successes);
+        hash_table->unreconciled_inserts = 0;
+      }
+    }
+
     map.reserve(map.get_size() + num_items);
     uint32_t submap_idx = 0;
     std::size_t num_to_insert = num_items;
@@ -216,7 +269,8 @@ struct KvLookupInsertKey<GPUDevice, Key, V> {
                                     map.get_submap_mutable_views().data().get(), map.get_submap_views().data().get(), map.get_submaps().size(),
                                     map.get_num_successes(), start_idx, submap_idx,
                                     cuco::detail::MurmurHash3_32<Key>{}, thrust::equal_to<Key>{}));
-        CUCO_CUDA_TRY(cudaDeviceSynchronize());
+        // Sync only this stream: other streams keep running.
+        CUCO_CUDA_TRY(cudaStreamSynchronize(stream));
         std::size_t h_num_successes = map.get_num_successes()->load(cuda::std::memory_order_relaxed);
         map.update_submap_sizes(submap_idx, h_num_successes);
         key_first += n;
@@ -225,6 +279,10 @@ struct KvLookupInsertKey<GPUDevice, Key, V> {
       }
       submap_idx++;
     }
+    // Leave the device counter at zero so later fast-path batches
+    // accumulate from a clean slate (the loop above already applied its
+    // successes to the cached submap sizes).
+    *(map.get_num_successes()) = 0;
   }
 };
 
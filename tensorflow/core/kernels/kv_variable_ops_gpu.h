@@ -48,6 +48,12 @@ public:
 
   const int32 initial_bank_size;
   cuda::atomic<std::size_t, cuda::thread_scope_device>* start_idx;
+  // Host-side upper bound on *start_idx, maintained so the per-step
+  // admission path never has to read the device-resident counter back.
+  int64 idx_upper_bound = 0;
+  // Keys inserted into the newest submap since host-cached submap sizes
+  // were last reconciled with the device; see KvLookupInsertKey.
+  std::size_t unreconciled_inserts = 0;
   int32 mem_bank_num = 0;
   std::vector<V*> bank_ptrs;
   V** d_bank_ptrs = nullptr;
@@ -179,7 +185,18 @@ class EmbeddingVarGPU : public ResourceBase {
 
   void LookupOrCreateKey(const K* key, int32* item_idxs, size_t n, cudaStream_t stream, int64 update_version = -1) {
     mutex_lock lock(lock_);
-    int remaining_size = n + *(kv_->start_idx) - kv_->mem_bank_num * kv_->initial_bank_size;
+    // Reading *start_idx here would migrate the managed counter back to
+    // the host and stall the stream every step; grow banks from a
+    // host-tracked upper bound instead, and only read the true counter
+    // when the bound says we are about to expand (a rare, already-slow
+    // event where the bound is usually a large overestimate).
+    kv_->idx_upper_bound += n;
+    int64 remaining_size = kv_->idx_upper_bound - static_cast<int64>(kv_->mem_bank_num) * kv_->initial_bank_size;
+    if (remaining_size > 0) {
+      cudaStreamSynchronize(stream);
+      kv_->idx_upper_bound = n + *(kv_->start_idx);
+      remaining_size = kv_->idx_upper_bound - static_cast<int64>(kv_->mem_bank_num) * kv_->initial_bank_size;
+    }
     bool expand_cap = remaining_size > 0 ? true : false;
     while (remaining_size > 0) {
       for (int i = 0; i < (emb_config_.block_num * (1 + emb_config_.slot_num)); ++i) {
@@ -22,6 +22,7 @@ limitations under the License.
 #include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/kernels/frozen_hash_segment.h"
 #include "tensorflow/core/kernels/lookup_util.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
@@ -179,6 +180,9 @@ class HashTable : public InitializableLookupTable {
       return 0;
     }
     std::atomic_thread_fence(std::memory_order_acquire);
+    if (frozen_) {
+      return frozen_->size();
+    }
     return table_ ? table_->size() : 0;
   }
 
@@ -187,7 +191,7 @@ class HashTable : public InitializableLookupTable {
       return errors::Aborted("HashTable is not initialized.");
     }
 
-    const int64 size = table_->size();
+    const int64 size = frozen_ ? frozen_->size() : table_->size();
 
     Tensor* keys;
     Tensor* values;
@@ -199,6 +203,14 @@ class HashTable : public InitializableLookupTable {
     auto keys_data = keys->flat<K>();
     auto values_data = values->flat<V>();
     int64 i = 0;
+    if (frozen_) {
+      frozen_->ForEach([&keys_data, &values_data, &i](const K& k, const V& v) {
+        keys_data(i) = k;
+        values_data(i) = v;
+        ++i;
+      });
+      return Status::OK();
+    }
     for (auto it = table_->begin(); it != table_->end(); ++it, ++i) {
       keys_data(i) = it->first;
       values_data(i) = it->second;
@@ -253,6 +265,16 @@ class HashTable : public InitializableLookupTable {
     const auto key_values = key.flat<K>();
     auto value_values = value->flat<V>();
 
+    if (frozen_) {
+      for (int64 i = 0; i < key_values.size(); ++i) {
+        V found;
+        value_values(i) =
+            frozen_->Find(SubtleMustCopyIfIntegral(key_values(i)), &found)
+                ? found
+                : default_val;
+      }
+      return Status::OK();
+    }
     for (int64 i = 0; i < key_values.size(); ++i) {
       value_values(i) = gtl::FindWithDefault(
           *table_, SubtleMustCopyIfIntegral(key_values(i)), default_val);
@@ -260,7 +282,32 @@ class HashTable : public InitializableLookupTable {
     return Status::OK();
   }
 
+  // Once populated the table is read-only, so sessions of a
+  // DirectSessionGroup (and other model versions) whose contents
+  // fingerprint the same can all serve from one immutable segment
+  // instead of a private map per session. The private map is dropped
+  // after the segment is attached.
+  Status DoPostInitialize() override {
+    if (!FrozenSegmentRegistry::ShareEnabled() ||
+        !RawBytesHash<K>::kSupported || !RawBytesHash<V>::kSupported ||
+        !table_ || table_->empty()) {
+      return Status::OK();
+    }
+    const uint64 fingerprint = FrozenHashSegment<K, V>::Fingerprint(*table_);
+    frozen_ = FrozenSegmentRegistry::Global()->FindOrBuild<
+        FrozenHashSegment<K, V>>(fingerprint, [this]() {
+      return FrozenHashSegment<K, V>::Build(*table_);
+    });
+    if (frozen_ != nullptr) {
+      table_.reset();
+    }
+    return Status::OK();
+  }
+
   int64 MemoryUsed() const override {
+    if (frozen_) {
+      return frozen_->MemoryUsed();
+    }
     if (table_) {
       const int64 num_elements = table_->size();
       return num_elements * (sizeof(K) + sizeof(V));
@@ -271,6 +318,7 @@ class HashTable : public InitializableLookupTable {
 
  private:
   std::unique_ptr<std::unordered_map<K, V>> table_;
+  std::shared_ptr<FrozenHashSegment<K, V>> frozen_;
 };
 
 }  // namespace lookup
@@ -123,6 +123,48 @@ class NcclAllReduceOpKernel : public NcclReduceOpBase {
 REGISTER_KERNEL_BUILDER(Name("NcclAllReduce").Device(DEVICE_GPU),
                         NcclAllReduceOpKernel);
 
+// To execute a single all-to-all, this kernel is called once for each of the
+// <k> devices in the communicator.  Chunk <i> of each device's input is
+// exchanged with chunk <i> of device <i>'s input.
+class NcclAllToAllOpKernel : public NcclAsyncOpBase {
+ public:
+  explicit NcclAllToAllOpKernel(OpKernelConstruction* c)
+      : NcclAsyncOpBase(c) {}
+
+  void ComputeAsync(OpKernelContext* c, DoneCallback done) override {
+    const Tensor* input = &c->input(0);
+    OP_REQUIRES_ASYNC(
+        c, input->dim_size(0) % num_devices() == 0,
+        errors::InvalidArgument("NcclAllToAll input first dimension (",
+                                input->dim_size(0),
+                                ") must be divisible by num_devices (",
+                                num_devices(), ")"),
+        done);
+    Tensor* output;
+    OP_REQUIRES_OK_ASYNC(c, c->allocate_output(0, input->shape(), &output),
+                         done);
+    auto actual_done = [c, done](Status s) {
+      OP_REQUIRES_OK_ASYNC(c, s, done);
+      done();
+    };
+
+    auto* compute_stream = c->op_device_context()->stream();
+    auto* gpu_info = c->device()->tensorflow_gpu_device_info();
+    auto participant = absl::make_unique<NcclManager::Participant>(
+        compute_stream->parent(), compute_stream, gpu_info,
+        input, output, /*global_rank=*/-1,
+        std::move(actual_done));
+    NcclManager::instance()->AddToAllToAll(
+        std::move(participant),
+        {GetCollectiveKey(c),
+         /*num_local_devices=*/num_devices(),
+         /*num_global_devices=*/num_devices(),
+         /*communicator_key=*/"", /*source_rank=*/-1});
+  }
+};
+REGISTER_KERNEL_BUILDER(Name("NcclAllToAll").Device(DEVICE_GPU),
+                        NcclAllToAllOpKernel);
+
 // To execute a single reduce, this kernel is called once for all but one of the
 // <k> devices in the communicator, and NcclReduceRecvKernel is called once for
 // the remaining device.
@@ -31,6 +31,7 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 #include "tensorflow/core/util/tensor_slice_reader.h"
 #include "tensorflow/core/util/tensor_slice_reader_cache.h"
@@ -871,13 +872,40 @@ Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
     }
   }
 
+  // Issue the pooled reads in (shard, file offset) order rather than key
+  // order: with multi-shard bundles the key order no longer matches the
+  // byte layout, and sequential issue order keeps remote filesystems
+  // streaming instead of seeking.
+  if (pool_restore_ops.size() > 1) {
+    std::unordered_map<const RestoreOp*, std::pair<int, int64>> locations;
+    for (auto& op : pool_restore_ops) {
+      int shard_id = 0;
+      int64 offset = 0;
+      if (default_reader
+              .LookupEntryLocation(op->tensor_name, &shard_id, &offset)
+              .ok()) {
+        locations[op.get()] = {shard_id, offset};
+      }
+    }
+    std::stable_sort(pool_restore_ops.begin(), pool_restore_ops.end(),
+                     [&locations](const std::unique_ptr<RestoreOp>& a,
+                                  const std::unique_ptr<RestoreOp>& b) {
+                       return locations[a.get()] < locations[b.get()];
+                     });
+  }
+
   {
     // Schedule any threaded operations first, skipping thread pool creation if
     // we don't have any expensive operations.
     std::unique_ptr<thread::ThreadPool> reader_pool;
     if (!pool_restore_ops.empty()) {
-      reader_pool.reset(
-          new thread::ThreadPool(Env::Default(), "restore_tensors", 8));
+      int64 num_threads = 8;
+      Status s = ReadInt64FromEnvVar("TF_RESTORE_THREAD_POOL_SIZE", 8,
+                                     &num_threads);
+      if (!s.ok() || num_threads < 1) num_threads = 8;
+      reader_pool.reset(new thread::ThreadPool(Env::Default(),
+                                               "restore_tensors",
+                                               num_threads));
       for (auto& op : pool_restore_ops) {
         reader_pool->Schedule([&op]() { op->run_with_new_reader(); });
       }
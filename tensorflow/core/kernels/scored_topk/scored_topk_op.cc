@@ -0,0 +1,177 @@
+#define EIGEN_USE_THREADS
+
+#include <algorithm>
+#include <vector>
+
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+
+#if defined(__GNUC__) && (__GNUC__ > 6) && (__AVX512F__)
+#include <immintrin.h>
+#endif
+
+namespace tensorflow {
+
+typedef Eigen::ThreadPoolDevice CPUDevice;
+
+// Fused streaming scored-topk for two-tower retrieval: scores =
+// queries x items^T followed by per-query TopK, without ever
+// materializing the [batch, num_items] score matrix. The item matrix is
+// streamed in tiles sized to stay L2-resident, each tile is scored
+// against every query of the thread's batch slice while it is hot, and
+// a per-query k-min-heap keeps the running winners. For 10M items x 64
+// dims this turns a 40MB-per-query working set into a few hundred KB.
+template <typename T>
+class FusedScoredTopKOp : public OpKernel {
+ public:
+  explicit FusedScoredTopKOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("k", &k_));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& queries_t = context->input(0);
+    const Tensor& items_t = context->input(1);
+
+    OP_REQUIRES(context, queries_t.dims() == 2,
+                errors::InvalidArgument("queries must be 2-D"));
+    OP_REQUIRES(context, items_t.dims() == 2,
+                errors::InvalidArgument("items must be 2-D"));
+    OP_REQUIRES(context, queries_t.dim_size(1) == items_t.dim_size(1),
+                errors::InvalidArgument(
+                    "queries and items must agree on the embedding "
+                    "dimension, got ",
+                    queries_t.dim_size(1), " and ", items_t.dim_size(1)));
+
+    const int64 batch = queries_t.dim_size(0);
+    const int64 num_items = items_t.dim_size(0);
+    const int64 dims = queries_t.dim_size(1);
+    OP_REQUIRES(context, num_items >= k_,
+                errors::InvalidArgument("k (", k_, ") exceeds the number of ",
+                                        "items (", num_items, ")"));
+
+    Tensor* values_t = nullptr;
+    Tensor* indices_t = nullptr;
+    OP_REQUIRES_OK(context, context->allocate_output(
+                                0, TensorShape({batch, k_}), &values_t));
+    OP_REQUIRES_OK(context, context->allocate_output(
+                                1, TensorShape({batch, k_}), &indices_t));
+
+    const T* queries = queries_t.flat<T>().data();
+    const T* items = items_t.flat<T>().data();
+    T* values = values_t->flat<T>().data();
+    int32* indices = indices_t->flat<int32>().data();
+
+    // Tile so a tile of item rows plus a query block stays inside L2.
+    const int64 tile_items =
+        std::max<int64>(1, kTileBytes / (dims * sizeof(T)));
+
+    // Shard over queries; every thread streams all item tiles for its
+    // block of queries, so a tile is loaded once per block instead of
+    // once per query.
+    const int64 cost_per_query = num_items * dims * 2;
+    auto& worker_threads =
+        *(context->device()->tensorflow_cpu_worker_threads());
+    worker_threads.workers->ParallelFor(
+        batch, cost_per_query,
+        [&](int64 begin_query, int64 end_query) {
+          ScoreQueries(queries, items, values, indices, begin_query,
+                       end_query, num_items, dims, tile_items);
+        });
+  }
+
+ private:
+  // One running candidate. The heap orders by ascending score so the
+  // root is the weakest of the current winners.
+  struct Candidate {
+    T score;
+    int32 index;
+    bool operator<(const Candidate& other) const {
+      // Ties keep the smaller item index, like sorted TopKV2 output.
+      if (score != other.score) return score > other.score;
+      return index < other.index;
+    }
+  };
+
+  void ScoreQueries(const T* queries, const T* items, T* values,
+                    int32* indices, int64 begin_query, int64 end_query,
+                    int64 num_items, int64 dims, int64 tile_items) {
+    const int64 num_queries = end_query - begin_query;
+    // heaps[q] holds the best k candidates of query begin_query + q.
+    std::vector<std::vector<Candidate>> heaps(num_queries);
+    for (auto& heap : heaps) {
+      heap.reserve(k_ + 1);
+    }
+
+    for (int64 tile_start = 0; tile_start < num_items;
+         tile_start += tile_items) {
+      const int64 tile_end = std::min(num_items, tile_start + tile_items);
+      for (int64 q = 0; q < num_queries; ++q) {
+        const T* query = queries + (begin_query + q) * dims;
+        std::vector<Candidate>& heap = heaps[q];
+        for (int64 item = tile_start; item < tile_end; ++item) {
+          const T score = Dot(query, items + item * dims, dims);
+          if (heap.size() < static_cast<size_t>(k_)) {
+            heap.push_back({score, static_cast<int32>(item)});
+            std::push_heap(heap.begin(), heap.end());
+          } else if (score > heap.front().score) {
+            std::pop_heap(heap.begin(), heap.end());
+            heap.back() = {score, static_cast<int32>(item)};
+            std::push_heap(heap.begin(), heap.end());
+          }
+        }
+      }
+    }
+
+    for (int64 q = 0; q < num_queries; ++q) {
+      std::vector<Candidate>& heap = heaps[q];
+      std::sort(heap.begin(), heap.end());
+      T* values_row = values + (begin_query + q) * k_;
+      int32* indices_row = indices + (begin_query + q) * k_;
+      for (int64 i = 0; i < k_; ++i) {
+        values_row[i] = heap[i].score;
+        indices_row[i] = heap[i].index;
+      }
+    }
+  }
+
+#if defined(__GNUC__) && (__GNUC__ > 6) && (__AVX512F__)
+  static T Dot(const T* a, const T* b, int64 dims) {
+    __m512 acc = _mm512_setzero_ps();
+    int64 d = 0;
+    for (; d + 16 <= dims; d += 16) {
+      acc = _mm512_fmadd_ps(_mm512_loadu_ps(a + d), _mm512_loadu_ps(b + d),
+                            acc);
+    }
+    const int64 remainder = dims - d;
+    if (remainder > 0) {
+      const __mmask16 mask = (1 << remainder) - 1;
+      acc = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a + d),
+                            _mm512_maskz_loadu_ps(mask, b + d), acc);
+    }
+    return _mm512_reduce_add_ps(acc);
+  }
+#else
+  static T Dot(const T* a, const T* b, int64 dims) {
+    T sum = T(0);
+    for (int64 d = 0; d < dims; ++d) {
+      sum += a[d] * b[d];
+    }
+    return sum;
+  }
+#endif
+
+  // Item tile budget; half of a common 512KB L2 so a tile, the query
+  // block and the heaps coexist without thrashing.
+  static constexpr int64 kTileBytes = 256 * 1024;
+
+  int32 k_;
+};
+
+REGISTER_KERNEL_BUILDER(
+    Name("FusedScoredTopK").Device(DEVICE_CPU).TypeConstraint<float>("T"),
+    FusedScoredTopKOp<float>);
+
+}  // namespace tensorflow
@@ -0,0 +1,128 @@
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/kernels/ops_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/public/session.h"
+
+namespace tensorflow {
+namespace {
+
+class FusedScoredTopKOpTest : public OpsTestBase {
+ protected:
+  void MakeOp(int k) {
+    TF_EXPECT_OK(NodeDefBuilder("fused_scored_topk", "FusedScoredTopK")
+                     .Attr("T", DT_FLOAT)
+                     .Attr("k", k)
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_FLOAT))
+                     .Finalize(node_def()));
+    TF_EXPECT_OK(InitOp());
+  }
+};
+
+TEST_F(FusedScoredTopKOpTest, MatchesMatMulTopK) {
+  MakeOp(2);
+
+  // Two orthogonal-ish queries over four items; scores are easy to
+  // compute by hand.
+  AddInputFromArray<float>(TensorShape({2, 2}),
+                           {1.0f, 0.0f,   //
+                            0.0f, 1.0f});
+  AddInputFromArray<float>(TensorShape({4, 2}),
+                           {3.0f, 1.0f,   //
+                            2.0f, 5.0f,   //
+                            -1.0f, 4.0f,  //
+                            0.5f, 0.5f});
+
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected_values(allocator(), DT_FLOAT, TensorShape({2, 2}));
+  test::FillValues<float>(&expected_values, {3.0f, 2.0f, 5.0f, 4.0f});
+  test::ExpectTensorEqual<float>(expected_values, *GetOutput(0));
+
+  Tensor expected_indices(allocator(), DT_INT32, TensorShape({2, 2}));
+  test::FillValues<int32>(&expected_indices, {0, 1, 1, 2});
+  test::ExpectTensorEqual<int32>(expected_indices, *GetOutput(1));
+}
+
+TEST_F(FusedScoredTopKOpTest, StreamsAcrossTiles) {
+  // Enough items to span several internal tiles; plant the winners far
+  // apart so a tiling bug that drops or re-bases indices shows up.
+  const int num_items = 20000;
+  const int dims = 48;  // not a multiple of 16: exercises the remainder
+  MakeOp(3);
+
+  std::vector<float> query(dims, 0.0f);
+  query[0] = 1.0f;
+  AddInputFromArray<float>(TensorShape({1, dims}), query);
+
+  std::vector<float> items(num_items * dims, 0.0f);
+  for (int i = 0; i < num_items; ++i) {
+    items[i * dims] = 1.0f;
+  }
+  items[17 * dims] = 30.0f;
+  items[9999 * dims] = 20.0f;
+  items[19998 * dims] = 10.0f;
+  AddInputFromArray<float>(TensorShape({num_items, dims}), items);
+
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected_values(allocator(), DT_FLOAT, TensorShape({1, 3}));
+  test::FillValues<float>(&expected_values, {30.0f, 20.0f, 10.0f});
+  test::ExpectTensorEqual<float>(expected_values, *GetOutput(0));
+
+  Tensor expected_indices(allocator(), DT_INT32, TensorShape({1, 3}));
+  test::FillValues<int32>(&expected_indices, {17, 9999, 19998});
+  test::ExpectTensorEqual<int32>(expected_indices, *GetOutput(1));
+}
+
+TEST_F(FusedScoredTopKOpTest, KLargerThanItemsFails) {
+  MakeOp(8);
+  AddInputFromArray<float>(TensorShape({1, 2}), {1.0f, 0.0f});
+  AddInputFromArray<float>(TensorShape({2, 2}),
+                           {1.0f, 0.0f, 0.0f, 1.0f});
+  EXPECT_FALSE(RunOpKernel().ok());
+}
+
+//----------------------------------------------------------------------------//
+// Performance benchmarks                                                     //
+//----------------------------------------------------------------------------//
+static Graph* FusedScoredTopK(int batch, int num_items, int dims, int k) {
+  Graph* g = new Graph(OpRegistry::Global());
+
+  Tensor queries(DT_FLOAT, TensorShape({batch, dims}));
+  queries.flat<float>().setRandom();
+  Tensor items(DT_FLOAT, TensorShape({num_items, dims}));
+  items.flat<float>().setRandom();
+
+  auto builder = NodeBuilder(g->NewName("n"), "FusedScoredTopK")
+                     .Input(test::graph::Constant(g, queries))
+                     .Input(test::graph::Constant(g, items))
+                     .Attr("T", DT_FLOAT)
+                     .Attr("k", k);
+  TF_CHECK_OK(builder.Finalize(g, nullptr));
+  return g;
+}
+
+#define BM_ScoredTopK(B, N, D, K, NTH)                                       \
+  static void BM_ScoredTopK##_##B##_##N##_##D##_##K##_##NTH##_CPU(           \
+      int iters) {                                                           \
+    testing::UseRealTime();                                                  \
+    testing::ItemsProcessed(static_cast<int64>(iters) * B * N * D);          \
+    SessionOptions opts;                                                     \
+    opts.config.set_intra_op_parallelism_threads(NTH);                       \
+    test::Benchmark("cpu", FusedScoredTopK(B, N, D, K), &opts).Run(iters);   \
+  }                                                                          \
+  BENCHMARK(BM_ScoredTopK##_##B##_##N##_##D##_##K##_##NTH##_CPU);
+
+BM_ScoredTopK(8, 100000, 64, 100, 1);
+BM_ScoredTopK(8, 100000, 64, 100, 8);
+BM_ScoredTopK(64, 1000000, 64, 100, 16);
+
+}  // namespace
+}  // namespace tensorflow
@@ -25,12 +25,38 @@ limitations under the License.
 
 #include "tensorflow/core/kernels/segment_reduction_ops.h"
 #include "tensorflow/core/framework/register_types.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/gpu_device_functions.h"
 
 namespace tensorflow {
 
 using GPUDevice = Eigen::GpuDevice;
 
+namespace {
+// Tiled two-phase sparse segment reduction. The default kernel issues one
+// atomic add per element, which collapses when the segment distribution is
+// skewed (one hot segment serializes all of its atomics on the same output
+// row). The tiled path splits the sparse rows into fixed-size chunks that
+// never cross a segment boundary, reduces each chunk without atomics, and
+// then combines the chunk partials per segment in a fixed order, so the
+// result is also deterministic. Long segments simply produce more chunks
+// and therefore get proportionally more blocks.
+constexpr int32 kSparseSegmentChunkRows = 256;
+// Below this many sparse elements the extra launches and the host copy of
+// the segment ids cost more than the atomics they save.
+constexpr int64 kSparseSegmentTiledMinSize = 32768;
+
+bool UseTiledSparseSegmentReduce() {
+  static bool enabled = [] {
+    bool value = false;
+    TF_CHECK_OK(ReadBoolFromEnvVar("DEEPREC_SPARSE_SEGMENT_REDUCE_GPU_TILED",
+                                   false, &value));
+    return value;
+  }();
+  return enabled;
+}
+}  // namespace
+
 // SortedSegmentSumFunctor kernel reduces input data just as
 // UnsortedSegmentSumCustomKernel does except that input data
 // is partitioned along the outer reduction dimension. This is
@@ -149,6 +175,52 @@ __global__ void SparseSegmentSumKernel(const int64 data_sparse_size,
   }
 }
 
+// Phase 1 of the tiled sparse segment sum. Every (chunk, column) pair is
+// owned by exactly one thread, which accumulates the chunk's rows in a
+// register and stores a single partial result; no atomics are involved.
+template <typename T, typename Index>
+__global__ void SparseSegmentSumChunkKernel(const int64 num_chunks,
+                                            const int64 data_inner_dim,
+                                            const int32* chunk_row_start,
+                                            const int32* chunk_row_count,
+                                            const T* data,
+                                            const Index* indices,
+                                            T* partial) {
+  for (int64 i : GpuGridRangeX(num_chunks * data_inner_dim)) {
+    const int64 chunk = i / data_inner_dim;
+    const int64 col = i % data_inner_dim;
+    const int32 row_start = chunk_row_start[chunk];
+    const int32 row_count = chunk_row_count[chunk];
+    T sum = T(0);
+    for (int32 r = 0; r < row_count; ++r) {
+      const Index data_row = ldg(indices + row_start + r);
+      sum += ldg(data + data_row * data_inner_dim + col);
+    }
+    partial[i] = sum;
+  }
+}
+
+// Phase 2 of the tiled sparse segment sum. Chunks of one segment are
+// contiguous in the partial buffer, so each output element adds them in a
+// fixed order; segments without rows stay zero.
+template <typename T>
+__global__ void SparseSegmentSumCombineKernel(const int64 output_total_size,
+                                              const int64 data_inner_dim,
+                                              const int32* seg_chunk_offsets,
+                                              const T* partial,
+                                              T* output) {
+  for (int64 i : GpuGridRangeX(output_total_size)) {
+    const int64 seg = i / data_inner_dim;
+    const int64 col = i % data_inner_dim;
+    T sum = T(0);
+    const int32 chunk_end = ldg(seg_chunk_offsets + seg + 1);
+    for (int32 c = ldg(seg_chunk_offsets + seg); c < chunk_end; ++c) {
+      sum += ldg(partial + c * data_inner_dim + col);
+    }
+    output[i] = sum;
+  }
+}
+
 template <typename T, typename Index>
 __global__ void SparseSegmentGradKernel(const int64 data_sparse_size,
                                         const int64 output_total_size,
@@ -296,6 +368,115 @@ void FindMaxSegId<Index>::operator()(OpKernelContext* ctx,
                              dst_vec.data() + seg_ids->NumElements());
 }
 
+// Builds the skew-aware chunk schedule on the host and launches the tiled
+// two-phase sum. Chunk boundaries follow the (sorted) segment ids, and
+// segments longer than kSparseSegmentChunkRows are split across several
+// chunks so a single hot segment cannot serialize the launch. Returns
+// false without touching 'output' when the ids turn out not to be sorted,
+// so the caller can fall back to the atomic kernel.
+template <typename T, typename Index>
+bool LaunchTiledSparseSegmentSum(OpKernelContext* ctx, const GPUDevice& d,
+                                 const int64 num_ids,
+                                 const int64 data_inner_dim,
+                                 const int64 output_row_size,
+                                 const T* data, const Index* indices,
+                                 const int32* seg_ids, T* output) {
+  AllocatorAttributes host_attr;
+  host_attr.set_on_host(true);
+  host_attr.set_gpu_compatible(true);
+  Tensor seg_ids_cpu;
+  if (!ctx->allocate_temp(DT_INT32, TensorShape({num_ids}),
+                          &seg_ids_cpu, host_attr).ok()) {
+    return false;
+  }
+  int32* ids = seg_ids_cpu.flat<int32>().data();
+  d.memcpy(ids, seg_ids, num_ids * sizeof(int32));
+  d.synchronize();
+
+  // First pass: count chunks and verify the ids are non-decreasing.
+  int64 num_chunks = 0;
+  for (int64 r = 0; r < num_ids;) {
+    const int32 seg = ids[r];
+    int64 end = r + 1;
+    while (end < num_ids && ids[end] == seg) ++end;
+    if (end < num_ids && ids[end] < seg) {
+      return false;
+    }
+    if (seg >= 0 && seg < output_row_size) {
+      num_chunks += (end - r + kSparseSegmentChunkRows - 1) /
+                    kSparseSegmentChunkRows;
+    }
+    r = end;
+  }
+  if (num_chunks == 0) {
+    return false;
+  }
+
+  Tensor chunk_start_cpu, chunk_count_cpu, seg_offsets_cpu;
+  Tensor chunk_start_dev, chunk_count_dev, seg_offsets_dev, partial_dev;
+  if (!ctx->allocate_temp(DT_INT32, TensorShape({num_chunks}),
+                          &chunk_start_cpu, host_attr).ok() ||
+      !ctx->allocate_temp(DT_INT32, TensorShape({num_chunks}),
+                          &chunk_count_cpu, host_attr).ok() ||
+      !ctx->allocate_temp(DT_INT32, TensorShape({output_row_size + 1}),
+                          &seg_offsets_cpu, host_attr).ok() ||
+      !ctx->allocate_temp(DT_INT32, TensorShape({num_chunks}),
+                          &chunk_start_dev).ok() ||
+      !ctx->allocate_temp(DT_INT32, TensorShape({num_chunks}),
+                          &chunk_count_dev).ok() ||
+      !ctx->allocate_temp(DT_INT32, TensorShape({output_row_size + 1}),
+                          &seg_offsets_dev).ok() ||
+      !ctx->allocate_temp(DataTypeToEnum<T>::v(),
+                          TensorShape({num_chunks * data_inner_dim}),
+                          &partial_dev).ok()) {
+    return false;
+  }
+
+  // Second pass: fill the schedule. Ids are sorted, so the chunks of one
+  // segment end up contiguous in chunk order.
+  int32* chunk_start = chunk_start_cpu.flat<int32>().data();
+  int32* chunk_count = chunk_count_cpu.flat<int32>().data();
+  int32* seg_offsets = seg_offsets_cpu.flat<int32>().data();
+  int64 chunk = 0;
+  int64 r = 0;
+  for (int64 seg = 0; seg < output_row_size; ++seg) {
+    seg_offsets[seg] = chunk;
+    while (r < num_ids && ids[r] < seg) ++r;
+    int64 end = r;
+    while (end < num_ids && ids[end] == seg) ++end;
+    for (int64 s = r; s < end; s += kSparseSegmentChunkRows) {
+      chunk_start[chunk] = s;
+      chunk_count[chunk] = std::min<int64>(kSparseSegmentChunkRows, end - s);
+      ++chunk;
+    }
+    r = end;
+  }
+  seg_offsets[output_row_size] = chunk;
+
+  d.memcpyHostToDevice(chunk_start_dev.flat<int32>().data(), chunk_start,
+                       num_chunks * sizeof(int32));
+  d.memcpyHostToDevice(chunk_count_dev.flat<int32>().data(), chunk_count,
+                       num_chunks * sizeof(int32));
+  d.memcpyHostToDevice(seg_offsets_dev.flat<int32>().data(), seg_offsets,
+                       (output_row_size + 1) * sizeof(int32));
+
+  GpuLaunchConfig config = GetGpuLaunchConfig(num_chunks * data_inner_dim, d);
+  SparseSegmentSumChunkKernel<T, Index>
+      <<<config.block_count, config.thread_per_block, 0, d.stream()>>>(
+          num_chunks, data_inner_dim, chunk_start_dev.flat<int32>().data(),
+          chunk_count_dev.flat<int32>().data(), data, indices,
+          partial_dev.flat<T>().data());
+
+  const int64 output_total_size = output_row_size * data_inner_dim;
+  config = GetGpuLaunchConfig(output_total_size, d);
+  SparseSegmentSumCombineKernel<T>
+      <<<config.block_count, config.thread_per_block, 0, d.stream()>>>(
+          output_total_size, data_inner_dim,
+          seg_offsets_dev.flat<int32>().data(),
+          partial_dev.flat<T>().data(), output);
+  return true;
+}
+
 template <typename T, typename Index>
 void SparseSegmentReduceFunctor<T, Index>::operator()(OpKernelContext* ctx,
                                                       const Tensor* input,
@@ -322,18 +503,29 @@ void SparseSegmentReduceFunctor<T, Index>::operator()(OpKernelContext* ctx,
 
   const GPUDevice d = ctx->eigen_device<GPUDevice>();
 
-  // initialize output by default value
-  GpuLaunchConfig config = GetGpuLaunchConfig(output_total_size, d);
-  SetToValue<<<config.block_count, config.thread_per_block,
-      0, d.stream()>>>(static_cast<int>(output_total_size),
-      output_flat.data(), T(0.0));
+  GpuLaunchConfig config;
+  bool tiled = false;
+  if (UseTiledSparseSegmentReduce() &&
+      data_sparse_size >= kSparseSegmentTiledMinSize) {
+    tiled = LaunchTiledSparseSegmentSum<T, Index>(
+        ctx, d, num_ids, data_inner_dim, output_row_size, data_flat.data(),
+        indices_flat.data(), segment_flat.data(), output_flat.data());
+  }
+  if (!tiled) {
+    // initialize output by default value
+    config = GetGpuLaunchConfig(output_total_size, d);
+    SetToValue<<<config.block_count, config.thread_per_block,
+        0, d.stream()>>>(static_cast<int>(output_total_size),
+        output_flat.data(), T(0.0));
 
-  config = GetGpuLaunchConfig(data_sparse_size, d);
-  // launch a kernel
-  SparseSegmentSumKernel<T, Index>
-      <<<config.block_count, config.thread_per_block, 0, d.stream()>>>(
-          data_sparse_size, output_total_size, data_inner_dim, data_flat.data(),
-          indices_flat.data(), segment_flat.data(), output_flat.data());
+    config = GetGpuLaunchConfig(data_sparse_size, d);
+    // launch a kernel
+    SparseSegmentSumKernel<T, Index>
+        <<<config.block_count, config.thread_per_block, 0, d.stream()>>>(
+            data_sparse_size, output_total_size, data_inner_dim,
+            data_flat.data(), indices_flat.data(), segment_flat.data(),
+            output_flat.data());
+  }
 
   if (is_mean | is_sqrtn) {
     OP_REQUIRES_OK(ctx, ctx->allocate_temp(output->dtype(),
@@ -0,0 +1,229 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+namespace {
+
+// Per-worker error-feedback state for sparse gradient compression:
+// rows that were not pushed this step (and the quantization error of
+// rows that were) accumulate here and re-enter the candidate set on
+// the next step, so compression delays small updates instead of
+// dropping them.
+class SparseGradientResidual : public ResourceBase {
+ public:
+  explicit SparseGradientResidual(const string& name) : name_(name) {}
+
+  string DebugString() const override {
+    mutex_lock l(mu_);
+    return strings::StrCat("SparseGradientResidual ", name_, " rows ",
+                           rows_.size());
+  }
+
+  mutex mu_;
+  std::unordered_map<int64, std::vector<float>> rows_ GUARDED_BY(mu_);
+
+ private:
+  const string name_;
+};
+
+// Compresses an IndexedSlices gradient before it is pushed: merges the
+// stored residual into the incoming rows, keeps the compress_ratio
+// fraction with the largest L2 norm, quantizes the kept rows to int8
+// with a per-row scale, and stores everything it did not send (dropped
+// rows plus quantization error of sent rows) back into the residual.
+template <typename TIndex>
+class SparseGradientCompressOp : public OpKernel {
+ public:
+  explicit SparseGradientCompressOp(OpKernelConstruction* c) : OpKernel(c) {
+    OP_REQUIRES_OK(c, c->GetAttr("compress_ratio", &compress_ratio_));
+    OP_REQUIRES(c, compress_ratio_ > 0.0f && compress_ratio_ <= 1.0f,
+                errors::InvalidArgument(
+                    "compress_ratio must be in (0, 1], got ",
+                    compress_ratio_));
+  }
+
+  void Compute(OpKernelContext* c) override {
+    SparseGradientResidual* residual = nullptr;
+    OP_REQUIRES_OK(c, LookupOrCreateResource<SparseGradientResidual>(
+        c, HandleFromInput(c, 0), &residual,
+        [c](SparseGradientResidual** ptr) {
+          *ptr = new SparseGradientResidual(HandleFromInput(c, 0).name());
+          return Status::OK();
+        }));
+    core::ScopedUnref unref(residual);
+
+    const Tensor& indices = c->input(1);
+    const Tensor& values = c->input(2);
+    const int64 num_rows = indices.NumElements();
+    OP_REQUIRES(c, values.dims() == 2 && values.dim_size(0) == num_rows,
+                errors::InvalidArgument(
+                    "values must be [num_indices, dim], got shape ",
+                    values.shape().DebugString(), " for ", num_rows,
+                    " indices"));
+    const int64 dim = values.dim_size(1);
+    const auto indices_vec = indices.template flat<TIndex>();
+    const auto values_mat = values.matrix<float>();
+
+    mutex_lock l(residual->mu_);
+
+    // Merge this step's rows into the residual; duplicate indices sum,
+    // matching IndexedSlices semantics.
+    auto& rows = residual->rows_;
+    for (int64 i = 0; i < num_rows; ++i) {
+      auto& row = rows[static_cast<int64>(indices_vec(i))];
+      if (row.empty()) {
+        row.resize(dim, 0.0f);
+      }
+      OP_REQUIRES(c, static_cast<int64>(row.size()) == dim,
+                  errors::InvalidArgument(
+                      "Residual row length ", row.size(),
+                      " does not match gradient dim ", dim,
+                      "; one residual resource covers one variable"));
+      for (int64 j = 0; j < dim; ++j) {
+        row[j] += values_mat(i, j);
+      }
+    }
+
+    // Rank all candidates (fresh and carried-over) by squared norm and
+    // keep the top compress_ratio fraction.
+    std::vector<std::pair<float, int64>> norms;
+    norms.reserve(rows.size());
+    for (const auto& it : rows) {
+      float sq = 0.0f;
+      for (float v : it.second) {
+        sq += v * v;
+      }
+      norms.emplace_back(sq, it.first);
+    }
+    int64 k = std::min<int64>(
+        norms.size(),
+        std::max<int64>(1, std::ceil(compress_ratio_ * norms.size())));
+    if (norms.empty()) {
+      k = 0;
+    }
+    std::partial_sort(norms.begin(), norms.begin() + k, norms.end(),
+                      [](const std::pair<float, int64>& a,
+                         const std::pair<float, int64>& b) {
+                        return a.first > b.first;
+                      });
+
+    Tensor* out_indices_tensor = nullptr;
+    Tensor* quantized_tensor = nullptr;
+    Tensor* scales_tensor = nullptr;
+    OP_REQUIRES_OK(c, c->allocate_output(0, TensorShape({k}),
+                                         &out_indices_tensor));
+    OP_REQUIRES_OK(c, c->allocate_output(1, TensorShape({k, dim}),
+                                         &quantized_tensor));
+    OP_REQUIRES_OK(c, c->allocate_output(2, TensorShape({k}),
+                                         &scales_tensor));
+    auto out_indices = out_indices_tensor->template flat<TIndex>();
+    auto quantized = quantized_tensor->matrix<int8>();
+    auto scales = scales_tensor->flat<float>();
+
+    for (int64 i = 0; i < k; ++i) {
+      const int64 index = norms[i].second;
+      auto row_it = rows.find(index);
+      std::vector<float>& row = row_it->second;
+      float max_abs = 0.0f;
+      for (float v : row) {
+        max_abs = std::max(max_abs, std::fabs(v));
+      }
+      const float scale = max_abs / 127.0f;
+      out_indices(i) = static_cast<TIndex>(index);
+      scales(i) = scale;
+      bool error_left = false;
+      for (int64 j = 0; j < dim; ++j) {
+        int32 q = 0;
+        if (scale > 0.0f) {
+          q = static_cast<int32>(std::lrintf(row[j] / scale));
+          q = std::max(-127, std::min(127, q));
+        }
+        quantized(i, j) = static_cast<int8>(q);
+        // Error feedback: only the quantization error stays behind.
+        row[j] -= q * scale;
+        error_left = error_left || row[j] != 0.0f;
+      }
+      if (!error_left) {
+        rows.erase(row_it);
+      }
+    }
+  }
+
+ private:
+  float compress_ratio_;
+};
+
+// Rebuilds the float gradient rows on the receiving side.
+class SparseGradientDecompressOp : public OpKernel {
+ public:
+  explicit SparseGradientDecompressOp(OpKernelConstruction* c)
+      : OpKernel(c) {}
+
+  void Compute(OpKernelContext* c) override {
+    const Tensor& quantized = c->input(0);
+    const Tensor& scales = c->input(1);
+    OP_REQUIRES(c, quantized.dims() == 2,
+                errors::InvalidArgument("quantized must be [rows, dim]"));
+    const int64 rows = quantized.dim_size(0);
+    const int64 dim = quantized.dim_size(1);
+    OP_REQUIRES(c, scales.NumElements() == rows,
+                errors::InvalidArgument("scales must hold one entry per row"));
+    Tensor* values_tensor = nullptr;
+    OP_REQUIRES_OK(c, c->allocate_output(0, TensorShape({rows, dim}),
+                                         &values_tensor));
+    auto values = values_tensor->matrix<float>();
+    auto quantized_mat = quantized.matrix<int8>();
+    auto scales_vec = scales.flat<float>();
+    for (int64 i = 0; i < rows; ++i) {
+      const float scale = scales_vec(i);
+      for (int64 j = 0; j < dim; ++j) {
+        values(i, j) = quantized_mat(i, j) * scale;
+      }
+    }
+  }
+};
+
+}  // namespace
+
+REGISTER_KERNEL_BUILDER(
+    Name("SparseGradientResidual").Device(DEVICE_CPU).HostMemory("resource"),
+    ResourceHandleOp<SparseGradientResidual>);
+
+REGISTER_KERNEL_BUILDER(Name("SparseGradientCompress")
+                            .Device(DEVICE_CPU)
+                            .TypeConstraint<int32>("Tindices"),
+                        SparseGradientCompressOp<int32>);
+REGISTER_KERNEL_BUILDER(Name("SparseGradientCompress")
+                            .Device(DEVICE_CPU)
+                            .TypeConstraint<int64>("Tindices"),
+                        SparseGradientCompressOp<int64>);
+
+REGISTER_KERNEL_BUILDER(Name("SparseGradientDecompress").Device(DEVICE_CPU),
+                        SparseGradientDecompressOp);
+
+}  // namespace tensorflow
@@ -0,0 +1,126 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <atomic>
+
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+namespace {
+
+// Per-variable update counter for the bounded-staleness training mode.
+// It lives on the parameter server next to the variable it covers:
+// every gradient application bumps it, and workers compare the version
+// they pulled against it to decide whether to refresh the variable
+// before the next step. Gradients are still applied immediately, so
+// throughput stays async-like; the bound only adds an occasional extra
+// pull on workers that fell behind.
+class StalenessCounter : public ResourceBase {
+ public:
+  explicit StalenessCounter(const string& name) : name_(name) {}
+
+  string DebugString() const override {
+    return strings::StrCat("StalenessCounter ", name_, " version ",
+                           version_.load(std::memory_order_relaxed));
+  }
+
+  int64 Bump() {
+    return version_.fetch_add(1, std::memory_order_relaxed) + 1;
+  }
+
+  int64 Version() const {
+    return version_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<int64> version_{0};
+  const string name_;
+};
+
+Status LookupOrCreateCounter(OpKernelContext* c,
+                             StalenessCounter** counter) {
+  return LookupOrCreateResource<StalenessCounter>(
+      c, HandleFromInput(c, 0), counter,
+      [c](StalenessCounter** ptr) {
+        *ptr = new StalenessCounter(HandleFromInput(c, 0).name());
+        return Status::OK();
+      });
+}
+
+// Bumps the counter; placed as a control dependency after the apply op
+// of the covered variable on the parameter server.
+class StalenessCounterBumpOp : public OpKernel {
+ public:
+  explicit StalenessCounterBumpOp(OpKernelConstruction* c) : OpKernel(c) {}
+
+  void Compute(OpKernelContext* c) override {
+    StalenessCounter* counter = nullptr;
+    OP_REQUIRES_OK(c, LookupOrCreateCounter(c, &counter));
+    core::ScopedUnref unref(counter);
+    Tensor* out = nullptr;
+    OP_REQUIRES_OK(c, c->allocate_output(0, TensorShape({}), &out));
+    out->scalar<int64>()() = counter->Bump();
+  }
+};
+
+// Worker-side staleness check: a scalar fetch against the counter,
+// much cheaper than re-pulling the variable itself. The worker runs it
+// colocated with the counter before a step and re-pulls the variable
+// only when `stale` comes back true.
+class StalenessCounterGateOp : public OpKernel {
+ public:
+  explicit StalenessCounterGateOp(OpKernelConstruction* c) : OpKernel(c) {
+    OP_REQUIRES_OK(c, c->GetAttr("max_staleness", &max_staleness_));
+    OP_REQUIRES(c, max_staleness_ >= 0,
+                errors::InvalidArgument("max_staleness must be >= 0, got ",
+                                        max_staleness_));
+  }
+
+  void Compute(OpKernelContext* c) override {
+    StalenessCounter* counter = nullptr;
+    OP_REQUIRES_OK(c, LookupOrCreateCounter(c, &counter));
+    core::ScopedUnref unref(counter);
+    const int64 pulled_version = c->input(1).scalar<int64>()();
+    const int64 version = counter->Version();
+    Tensor* stale_out = nullptr;
+    OP_REQUIRES_OK(c, c->allocate_output(0, TensorShape({}), &stale_out));
+    stale_out->scalar<bool>()() = version - pulled_version > max_staleness_;
+    Tensor* version_out = nullptr;
+    OP_REQUIRES_OK(c, c->allocate_output(1, TensorShape({}), &version_out));
+    version_out->scalar<int64>()() = version;
+  }
+
+ private:
+  int64 max_staleness_;
+};
+
+}  // namespace
+
+REGISTER_KERNEL_BUILDER(
+    Name("StalenessCounter").Device(DEVICE_CPU).HostMemory("resource"),
+    ResourceHandleOp<StalenessCounter>);
+
+REGISTER_KERNEL_BUILDER(Name("StalenessCounterBump").Device(DEVICE_CPU),
+                        StalenessCounterBumpOp);
+
+REGISTER_KERNEL_BUILDER(Name("StalenessCounterGate").Device(DEVICE_CPU),
+                        StalenessCounterGateOp);
+
+}  // namespace tensorflow
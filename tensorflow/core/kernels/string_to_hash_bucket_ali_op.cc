@@ -29,6 +29,9 @@ REGISTER_KERNEL_BUILDER(Name("StringToHashBucketStrong").Device(DEVICE_CPU),
 REGISTER_KERNEL_BUILDER(Name("StringToHash64").Device(DEVICE_CPU),
                         StringToHash64Op<Fingerprint64>);
 
+REGISTER_KERNEL_BUILDER(Name("StringToInternedId").Device(DEVICE_CPU),
+                        StringToInternedIdOp);
+
 REGISTER_KERNEL_BUILDER(Name("StringToHash").Device(DEVICE_CPU),
                         StringToHashOp);
 }  // namespace tensorflow
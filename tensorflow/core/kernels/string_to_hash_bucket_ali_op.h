@@ -16,7 +16,9 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_STRING_TO_HASH_BUCKET_ALI_OP_H_
 #define TENSORFLOW_CORE_KERNELS_STRING_TO_HASH_BUCKET_ALI_OP_H_
 
+#include <atomic>
 #include <string>
+#include <unordered_map>
 
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
@@ -24,6 +26,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/hash/hash.h"
 #include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/util/work_sharder.h"
 #include "tensorflow/core/platform/fingerprint.h"
 
@@ -98,31 +101,35 @@ class StringToHashBucketBatchAliOp : public OpKernel {
       Index batch_end = end - (end - start)%8;
       Index i = start;
 #if defined(__AVX512F__)
-      const char* batch_ptr[8]; 
+      const char* batch_ptr[8];
+      size_t batch_len[8];
       uint64_t input_hash[8];
-      bool enable_batch_hash = true;
       if (batch_end - start >= 8) {
         for(; i < batch_end; i+=8) {
-          // first unrolling by 8 (for Hash64V3_Batch512)
-          // double check whether all the 8 strings within 
-          // a batch having the same string length.
-          enable_batch_hash = true;
-          Index size_0 = input_flat(i).size();
+          // first unrolling by 8 (for Hash64Farm_Batch512)
+          // gather pointers and lengths; equal-length batches take the
+          // uniform-length path, mixed-length short batches (the common
+          // shape for id strings) the varying-length paths.
           batch_ptr[0] = input_flat(i).data();
+          batch_len[0] = input_flat(i).size();
+          size_t min_len = batch_len[0];
+          size_t max_len = batch_len[0];
           for(int j=1; j<8; j++) {
-            if (input_flat(i+j).size() == size_0) {
-              batch_ptr[j] = input_flat(i+j).data();
-            } else {
-              enable_batch_hash = false;
-              break;
-            }
+            batch_ptr[j] = input_flat(i+j).data();
+            batch_len[j] = input_flat(i+j).size();
+            if (batch_len[j] < min_len) min_len = batch_len[j];
+            if (batch_len[j] > max_len) max_len = batch_len[j];
           }
-          if (enable_batch_hash) {
-            Hash64Farm_Batch512(batch_ptr, &input_hash[0], size_0);
+          if (min_len == max_len) {
+            Hash64Farm_Batch512(batch_ptr, &input_hash[0], max_len);
+          } else if (min_len >= 8 && max_len <= 16) {
+            Hash64FarmLen8to16_Batch512(batch_ptr, batch_len, &input_hash[0]);
+          } else if (min_len >= 4 && max_len <= 7) {
+            Hash64FarmLen4to7_Batch512(batch_ptr, batch_len, &input_hash[0]);
           } else {
             // roll back to normal Hash64 function
             for(int j=0; j<8; j++) {
-                input_hash[j] = (uint64_t)hash(input_flat(i+j)); 
+                input_hash[j] = (uint64_t)hash(input_flat(i+j));
             }
           }
           // feed ids to output tensor
@@ -236,26 +243,30 @@ class StringToHash64Op : public OpKernel {
       auto i = start;
 #if defined(__AVX512F__)
       const char* batch_ptr[8];
+      size_t batch_len[8];
       uint64_t input_hash[8];
-      bool enable_batch_hash = true;
       if (batch_end - start >= 8) {
         for(; i < batch_end; i+=8) {
-          // first unrolling by 8 (for Hash64V3_Batch512)
-          // double check whether all the 8 strings within
-          // a batch having the same string length.
-          enable_batch_hash = true;
-          Index size_0 = input_flat(i).size();
+          // first unrolling by 8 (for Hash64Farm_Batch512)
+          // gather pointers and lengths; equal-length batches take the
+          // uniform-length path, mixed-length short batches (the common
+          // shape for id strings) the varying-length paths.
           batch_ptr[0] = input_flat(i).data();
+          batch_len[0] = input_flat(i).size();
+          size_t min_len = batch_len[0];
+          size_t max_len = batch_len[0];
           for(int j=1; j<8; j++) {
-            if (input_flat(i+j).size() == size_0) {
-              batch_ptr[j] = input_flat(i+j).data();
-            } else {
-              enable_batch_hash = false;
-              break;
-            }
+            batch_ptr[j] = input_flat(i+j).data();
+            batch_len[j] = input_flat(i+j).size();
+            if (batch_len[j] < min_len) min_len = batch_len[j];
+            if (batch_len[j] > max_len) max_len = batch_len[j];
           }
-          if (enable_batch_hash) {
-            Hash64Farm_Batch512(batch_ptr, &input_hash[0], size_0);
+          if (min_len == max_len) {
+            Hash64Farm_Batch512(batch_ptr, &input_hash[0], max_len);
+          } else if (min_len >= 8 && max_len <= 16) {
+            Hash64FarmLen8to16_Batch512(batch_ptr, batch_len, &input_hash[0]);
+          } else if (min_len >= 4 && max_len <= 7) {
+            Hash64FarmLen4to7_Batch512(batch_ptr, batch_len, &input_hash[0]);
           } else {
             // roll back to normal Hash64 function
             for(int j=0; j<8; j++) {
@@ -295,6 +306,86 @@ class StringToHash64Op : public OpKernel {
   TF_DISALLOW_COPY_AND_ASSIGN(StringToHash64Op);
 };
 
+// Process-wide string interner. A string is fingerprinted once and
+// mapped to a dense int64 id, so every downstream lookup operates on
+// 8-byte keys and the EV hash tables see a compact id space instead of
+// sparse 64-bit hashes. The table keys on Fingerprint64 of the string
+// rather than the string itself - the same collision tradeoff the
+// existing StringToHashBucketFast users already accept - which keeps
+// lookups O(1) on 8 bytes and the table free of string storage. Ids
+// are assigned in first-seen order and are only stable within one
+// process lifetime, so interned ids must not be written to checkpoints
+// that outlive the process.
+class StringIdInterner {
+ public:
+  static StringIdInterner* Global() {
+    static StringIdInterner* interner = new StringIdInterner;
+    return interner;
+  }
+
+  int64 Intern(StringPiece input) {
+    const uint64 fp = Fingerprint64(input);
+    IdShard* shard = &shards_[fp % kNumShards];
+    {
+      tf_shared_lock l(shard->mu);
+      auto iter = shard->ids.find(fp);
+      if (iter != shard->ids.end()) {
+        return iter->second;
+      }
+    }
+    mutex_lock l(shard->mu);
+    auto result = shard->ids.emplace(fp, 0);
+    if (result.second) {
+      result.first->second = next_id_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return result.first->second;
+  }
+
+ private:
+  static const int kNumShards = 16;
+
+  struct IdShard {
+    mutex mu;
+    std::unordered_map<uint64, int64> ids GUARDED_BY(mu);
+  };
+
+  IdShard shards_[kNumShards];
+  std::atomic<int64> next_id_{0};
+};
+
+class StringToInternedIdOp : public OpKernel {
+ public:
+  explicit StringToInternedIdOp(OpKernelConstruction* ctx) : OpKernel(ctx) {}
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor* input_tensor;
+    OP_REQUIRES_OK(context, context->input("input", &input_tensor));
+    const auto& input_flat = input_tensor->flat<string>();
+
+    Tensor* output_tensor = nullptr;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output("output", input_tensor->shape(),
+                                            &output_tensor));
+    auto output_flat = output_tensor->flat<int64>();
+
+    StringIdInterner* interner = StringIdInterner::Global();
+    auto RunTask = [&input_flat, &output_flat, interner](int64 start,
+                                                         int64 end) {
+      typedef decltype(input_flat.size()) Index;
+      for (Index i = start; i < end; ++i) {
+        output_flat(i) = interner->Intern(input_flat(i));
+      }
+    };
+
+    auto worker_threads = context->device()->tensorflow_cpu_worker_threads();
+    const int64 element_cost = 150;  // Hash plus one sharded table probe.
+    Shard(worker_threads->num_threads - 1, worker_threads->workers,
+          input_flat.size(), element_cost, RunTask);
+  }
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StringToInternedIdOp);
+};
+
 class StringToHashOp : public OpKernel {
  public:
   explicit StringToHashOp(OpKernelConstruction* ctx) : OpKernel(ctx) {
@@ -20,8 +20,11 @@ limitations under the License.
 #include "tensorflow/core/lib/bfloat16/bfloat16.h"
 
 #include <algorithm>
+#include <atomic>
 
 #include "tensorflow/core/framework/bounds_check.h"
+#include "tensorflow/core/framework/embedding/embedding_qos.h"
+#include "tensorflow/core/framework/embedding/health_stats.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/kernels/kv_variable_ops.h"
@@ -29,6 +32,7 @@ limitations under the License.
 #include "tensorflow/core/kernels/training_ali_op_helpers.h"
 #include "tensorflow/core/kernels/training_ali_ops.h"
 #include "tensorflow/core/kernels/variable_ops.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/work_sharder.h"
 
 #ifdef TENSORFLOW_USE_SYCL
@@ -67,11 +71,134 @@ struct ApplyAdagradDecay<CPUDevice, T> {
 
 }
 
+namespace {
+
+// Groups duplicate indices of a sparse gradient batch. The slice positions
+// are sorted by key and each run of equal keys [run_starts[k],
+// run_starts[k + 1]) belongs to one unique key, so the apply kernels can sum
+// the duplicate gradient rows and touch the optimizer state once per key.
+// Grouping also gives every key exactly one owning shard thread, where the
+// per-occurrence loop lets two threads update the same row concurrently.
+template <typename TKey>
+void GroupDuplicateIndices(const Tensor& indices,
+                           std::vector<int64>* sorted_positions,
+                           std::vector<int64>* run_starts) {
+  auto indices_vec = indices.vec<TKey>();
+  const int64 N = indices_vec.size();
+  sorted_positions->resize(N);
+  for (int64 i = 0; i < N; ++i) {
+    (*sorted_positions)[i] = i;
+  }
+  std::stable_sort(sorted_positions->begin(), sorted_positions->end(),
+                   [&indices_vec](int64 a, int64 b) {
+                     return indices_vec(a) < indices_vec(b);
+                   });
+  run_starts->clear();
+  for (int64 i = 0; i < N; ++i) {
+    if (i == 0 || indices_vec((*sorted_positions)[i]) !=
+                      indices_vec((*sorted_positions)[i - 1])) {
+      run_starts->push_back(i);
+    }
+  }
+  run_starts->push_back(N);
+}
+
+// Cross-step gradient log for the accumulation mode of the sparse apply
+// kernels. With small per-step batches the per-row locking and random
+// access of an apply dominate the useful arithmetic, so gradients are
+// buffered in per-shard logs and applied as one sorted, deduplicated
+// batch every N steps; skewed keys collapse by their repeat factor and
+// every touched row is visited once per flush. N comes from
+// TF_KV_GRAD_ACCUM_STEPS_<OPTIMIZER>, falling back to
+// TF_KV_GRAD_ACCUM_STEPS; 0 (the default) applies every step as before.
+// A flush uses the learning rate and global step of the flushing step,
+// the usual approximation for delayed sparse updates.
+template <typename TKey, typename T>
+class SparseGradAccumulator {
+ public:
+  static int64 StepsFromEnv(const string& optimizer) {
+    int64 steps = 0;
+    TF_CHECK_OK(ReadInt64FromEnvVar(
+        strings::StrCat("TF_KV_GRAD_ACCUM_STEPS_", optimizer), 0, &steps));
+    if (steps == 0) {
+      TF_CHECK_OK(ReadInt64FromEnvVar("TF_KV_GRAD_ACCUM_STEPS", 0, &steps));
+    }
+    return steps;
+  }
+
+  SparseGradAccumulator(int64 every_n, int64 inner_dim)
+      : every_n_(every_n), inner_dim_(inner_dim) {}
+
+  // Buffers one step's batch; returns true when this step must flush.
+  template <typename IndicesVec>
+  bool Append(const IndicesVec& indices_vec, const T* grad_base, int64 n) {
+    for (int64 i = 0; i < n; ++i) {
+      const TKey key = indices_vec(i);
+      Shard& shard = shards_[static_cast<uint64>(key) % kNumShards];
+      mutex_lock l(shard.mu);
+      shard.keys.push_back(key);
+      shard.grads.insert(shard.grads.end(), grad_base + i * inner_dim_,
+                         grad_base + (i + 1) * inner_dim_);
+    }
+    return (pending_steps_.fetch_add(1) + 1) % every_n_ == 0;
+  }
+
+  // Drains every shard into unique keys with summed gradient rows. The
+  // shards partition the key space, so per-shard dedup is global dedup.
+  void Drain(std::vector<TKey>* keys, std::vector<T>* grads) {
+    keys->clear();
+    grads->clear();
+    for (int64 s = 0; s < kNumShards; ++s) {
+      Shard& shard = shards_[s];
+      mutex_lock l(shard.mu);
+      const int64 n = shard.keys.size();
+      std::vector<int64> order(n);
+      for (int64 i = 0; i < n; ++i) order[i] = i;
+      std::stable_sort(order.begin(), order.end(),
+                       [&shard](int64 a, int64 b) {
+                         return shard.keys[a] < shard.keys[b];
+                       });
+      for (int64 i = 0; i < n; ++i) {
+        const TKey key = shard.keys[order[i]];
+        const T* row = shard.grads.data() + order[i] * inner_dim_;
+        if (i == 0 || key != shard.keys[order[i - 1]]) {
+          keys->push_back(key);
+          grads->insert(grads->end(), row, row + inner_dim_);
+        } else {
+          T* acc = grads->data() + (keys->size() - 1) * inner_dim_;
+          for (int64 j = 0; j < inner_dim_; ++j) {
+            acc[j] += row[j];
+          }
+        }
+      }
+      shard.keys.clear();
+      shard.grads.clear();
+    }
+  }
+
+ private:
+  static constexpr int64 kNumShards = 8;
+
+  struct Shard {
+    mutex mu;
+    std::vector<TKey> keys GUARDED_BY(mu);
+    std::vector<T> grads GUARDED_BY(mu);
+  };
+
+  const int64 every_n_;
+  const int64 inner_dim_;
+  std::atomic<int64> pending_steps_{0};
+  Shard shards_[kNumShards];
+};
+
+}  // namespace
+
 template <typename TKey, typename T, typename Tstep>
 class KvSparseApplyAdagradOp : public OpKernel {
  public:
   explicit KvSparseApplyAdagradOp(OpKernelConstruction* ctx) : OpKernel(ctx) {
     OP_REQUIRES_OK(ctx, ctx->GetAttr("use_locking", &use_exclusive_lock_));
+    accum_every_n_ = SparseGradAccumulator<TKey, T>::StepsFromEnv("ADAGRAD");
   }
 
   void Compute(OpKernelContext* ctx) override NO_THREAD_SAFETY_ANALYSIS {
@@ -121,37 +248,166 @@ class KvSparseApplyAdagradOp : public OpKernel {
 
     if (N > 0) {
       if (inner_dim > 0) {
+        // Updates draw on the same per-table token bucket as lookups,
+        // so one TF_EV_QOS_LIMITS rule caps a tenant's total traffic.
+        embedding::TableQosBucket* qos =
+            embedding::EmbeddingQosRegistry::GetInstance()->Lookup(
+                var->Name());
+        if (qos != nullptr) {
+          qos->Acquire(N);
+        }
+        embedding::TableHealthStats* health =
+            embedding::EmbeddingHealthRegistry::GetInstance()->Lookup(
+                var->Name());
         auto indices_vec = indices.vec<TKey>();
         auto grad_flat = grad.flat_outer_dims<T>();
         T lr_scalar = lr.scalar<T>()();
         Tstep gs = global_step.scalar<Tstep>()();
+
+        // Group duplicate keys so every unique row loads its state once and
+        // applies the summed gradient with a single vectorized update. This
+        // matches the pre-aggregation the python optimizers do for dense
+        // variables, and gives each row one owning shard thread. In
+        // accumulation mode the grouping instead spans the buffered
+        // micro-steps: most steps only log their batch, and every Nth
+        // step drains the log deduplicated.
+        std::vector<int64> sorted_positions;
+        std::vector<int64> run_starts;
+        std::vector<TKey> drained_keys;
+        std::vector<T> drained_grads;
+        int64 num_unique = 0;
+        const bool accumulate = accum_every_n_ > 1;
+        if (accumulate) {
+          {
+            mutex_lock l(grad_accum_mu_);
+            if (grad_accum_ == nullptr) {
+              grad_accum_.reset(new SparseGradAccumulator<TKey, T>(
+                  accum_every_n_, inner_dim));
+            }
+          }
+          if (!grad_accum_->Append(indices_vec, grad_flat.data(), N)) {
+            return;
+          }
+          grad_accum_->Drain(&drained_keys, &drained_grads);
+          num_unique = drained_keys.size();
+        } else {
+          GroupDuplicateIndices<TKey>(indices, &sorted_positions, &run_starts);
+          num_unique = run_starts.size() - 1;
+        }
+        const bool fused_pass = var->IsContiguousLayout();
+
         auto do_work = [this, ctx, &indices_vec, var, accum, &grad_flat,
-            &gs, &lr_scalar] (int64 start_i, int64 limit_i) {
-          for (int64 i = start_i; i < limit_i; i++) {
-            const TKey index = indices_vec(i);
+            &gs, &lr_scalar, &sorted_positions, &run_starts, &drained_keys,
+            &drained_grads, accumulate, health,
+            inner_dim, fused_pass] (int64 start_i, int64 limit_i) {
+          Eigen::Tensor<T, 1, Eigen::RowMajor> summed_grad(inner_dim);
+          for (int64 k = start_i; k < limit_i; k++) {
+            TKey index;
+            if (accumulate) {
+              index = drained_keys[k];
+              summed_grad = Eigen::TensorMap<
+                  Eigen::Tensor<const T, 1, Eigen::RowMajor>>(
+                      drained_grads.data() + k * inner_dim, inner_dim);
+            } else {
+              const int64 run_begin = run_starts[k];
+              const int64 run_end = run_starts[k + 1];
+              index = indices_vec(sorted_positions[run_begin]);
+              summed_grad =
+                  grad_flat.template chip<0>(sorted_positions[run_begin]);
+              for (int64 p = run_begin + 1; p < run_end; p++) {
+                summed_grad += grad_flat.template chip<0>(sorted_positions[p]);
+              }
+            }
             ValuePtr<T>* value_ptr = nullptr;
             bool is_filter = false;
             OP_REQUIRES_OK(ctx, var->LookupOrCreateKey(index, &value_ptr, &is_filter));
             var->UpdateVersion(value_ptr, gs);
+            const bool sample_health = health != nullptr &&
+                embedding::TableHealthStats::ShouldSample();
             if (is_filter) {
               auto a = accum->flat(value_ptr);
-              auto g = grad_flat.template chip<0>(i);
               auto v = var->flat(value_ptr);
-              a += g.square();
-              v -= g.constant(lr_scalar) * g * a.rsqrt();
+              if (var->IsAdaptiveDim() && v.size() < inner_dim) {
+                // Short-bucket row of an adaptive-dim variable: the
+                // gradient past the stored prefix belongs to the
+                // zero-padded tail of the gather and is dropped (the
+                // adjoint of the padding). Sized from the views, so a
+                // promotion between gather and apply stays safe.
+                T* v_ptr = &v(0);
+                const T* g_ptr = summed_grad.data();
+                if (accum->IsCompactOptState()) {
+                  Eigen::Tensor<T, 0, Eigen::RowMajor> grad_sq_mean =
+                      summed_grad.square().mean();
+                  a(0) += grad_sq_mean();
+                  const T scale = lr_scalar / Eigen::numext::sqrt(a(0));
+                  for (int64 j = 0; j < v.size(); j++) {
+                    v_ptr[j] -= scale * g_ptr[j];
+                  }
+                } else {
+                  const int64 prefix = std::min(v.size(), a.size());
+                  T* a_ptr = &a(0);
+                  for (int64 j = 0; j < prefix; j++) {
+                    a_ptr[j] += g_ptr[j] * g_ptr[j];
+                    v_ptr[j] -=
+                        lr_scalar * g_ptr[j] / Eigen::numext::sqrt(a_ptr[j]);
+                  }
+                }
+              } else if (accum->IsCompactOptState()) {
+                // Row-wise Adagrad: the accumulator is one group-shared
+                // scalar per row, fed with the mean squared gradient.
+                Eigen::Tensor<T, 0, Eigen::RowMajor> grad_sq_mean =
+                    summed_grad.square().mean();
+                a(0) += grad_sq_mean();
+                const T scale = lr_scalar / Eigen::numext::sqrt(a(0));
+                v -= summed_grad * summed_grad.constant(scale);
+              } else if (fused_pass) {
+                // NORMAL_CONTIGUOUS keeps the accumulator row adjacent
+                // to the weight row in one block, so a single fused
+                // pass streams both instead of Eigen sweeping each
+                // expression over the rows separately.
+                T* a_ptr = &a(0);
+                T* v_ptr = &v(0);
+                const T* g_ptr = summed_grad.data();
+                for (int64 j = 0; j < inner_dim; j++) {
+                  a_ptr[j] += g_ptr[j] * g_ptr[j];
+                  v_ptr[j] -=
+                      lr_scalar * g_ptr[j] / Eigen::numext::sqrt(a_ptr[j]);
+                }
+              } else {
+                a += summed_grad.square();
+                v -= summed_grad.constant(lr_scalar) * summed_grad * a.rsqrt();
+              }
               var->Commit(index, value_ptr);
+              if (sample_health) {
+                // lr*|g| bounds the applied delta; exact per-element
+                // scaling is not worth recomputing for a health signal.
+                Eigen::Tensor<T, 0, Eigen::RowMajor> v_sq = v.square().sum();
+                Eigen::Tensor<T, 0, Eigen::RowMajor> g_sq =
+                    summed_grad.square().sum();
+                health->RecordSampledUpdate(
+                    true, std::sqrt(static_cast<double>(v_sq())),
+                    static_cast<double>(lr_scalar) *
+                        std::sqrt(static_cast<double>(g_sq())));
+              }
+            } else if (sample_health) {
+              health->RecordSampledUpdate(false, 0.0, 0.0);
             }
           }
         };
         const int64 cost = 1000; //very unreliable estimate for cost per step.
         auto worker_threads = *(ctx->device()->tensorflow_cpu_worker_threads());
-        Shard(worker_threads.num_threads, worker_threads.workers, N, cost, do_work);
+        Shard(worker_threads.num_threads, worker_threads.workers, num_unique, cost, do_work);
       }
     }
   }
 
  private:
   bool use_exclusive_lock_;
+  // Accumulation mode; 0 or 1 applies every step. The log is created on
+  // first use because the gradient width is only known at compute time.
+  int64 accum_every_n_ = 0;
+  mutex grad_accum_mu_;
+  std::unique_ptr<SparseGradAccumulator<TKey, T>> grad_accum_;
 };
 
 #define REGISTER_KERNELS(Tindices, T, Tstep)                         \
@@ -192,6 +448,15 @@ class KvSparseApplyAdagradGPUOp : public OpKernel {
     OP_REQUIRES_OK(ctx, GetInputEmbeddingVar(ctx, 1, &accum));
     core::ScopedUnref unref_accum(accum);
 
+    OP_REQUIRES(ctx, !accum->IsCompactOptState(),
+                errors::InvalidArgument(
+                    "compact optimizer state is not supported by the GPU "
+                    "Adagrad kernel; unset TF_EMBEDDING_COMPACT_OPT_STATE"));
+    OP_REQUIRES(ctx, !var->IsAdaptiveDim(),
+                errors::InvalidArgument(
+                    "adaptive embedding dims are not supported by the GPU "
+                    "Adagrad kernel; unset TF_EV_ADAPTIVE_DIM_SHORT_LEN"));
+
     const Tensor& lr = ctx->input(2);
     OP_REQUIRES(ctx, IsLegacyScalar(lr.shape()),
                 errors::InvalidArgument("lr is not a scalar: ",
@@ -405,16 +670,14 @@ class KvSparseApplyAdagradOpGPU : public OpKernel {
     if (N > 0) {
       if (inner_dim > 0) {
         auto indices_flat = indices.flat<TKey>();
-        auto grad_flat = grad.flat<T>();
         Tstep gs = global_step.scalar<Tstep>()();
         const TKey* key_base = &indices_flat(0);
-        const T* grad_base = &grad_flat(0);
         T lr_scalar = lr.scalar<T>()();
         const cudaStream_t& stream = ctx->eigen_device<Device>().stream();
 
         functor::KvSparseApplyAdagrad<Device, TKey, T>()(
             N, ctx->get_allocator(AllocatorAttributes()), var, accum,
-            key_base, grad_base, lr_scalar, gs, stream);
+            key_base, grad, lr_scalar, gs, stream);
       }
     }
   }
@@ -432,7 +695,7 @@ namespace functor {
       EmbeddingVarGPU<TKey, T>* var,  \
       EmbeddingVarGPU<TKey, T>* accum,  \
       const TKey* key_base, \
-      const T* grad,  \
+      const Tensor& grad,  \
       T lr, \
       int64 gs, \
       cudaStream_t stream);             \
@@ -488,6 +751,23 @@ class KvSparseApplyFtrlOp : public OpKernel {
     OP_REQUIRES_OK(ctx, GetInputEmbeddingVar(ctx, 2, &linear_));
     core::ScopedUnref unref_linear(linear_);
 
+    // TF_EMBEDDING_COMPACT_OPT_STATE shrinks a slot to one scalar per
+    // row; only the Adagrad kernel implements the matching row-wise
+    // update, every other optimizer needs full-width slot state.
+    OP_REQUIRES(ctx,
+                !accum_->IsCompactOptState() && !linear_->IsCompactOptState(),
+                errors::InvalidArgument(
+                    "compact optimizer state is not supported by "
+                    "KvResourceSparseApplyFtrl; unset "
+                    "TF_EMBEDDING_COMPACT_OPT_STATE"));
+    // Same story for frequency-adaptive dims: only the Adagrad kernel
+    // sizes its update from the stored prefix of a short-bucket row.
+    OP_REQUIRES(ctx, !var_->IsAdaptiveDim(),
+                errors::InvalidArgument(
+                    "adaptive embedding dims are not supported by "
+                    "KvResourceSparseApplyFtrl; unset "
+                    "TF_EV_ADAPTIVE_DIM_SHORT_LEN"));
+
     const Tensor& grad = ctx->input(3);
     const Tensor& indices = ctx->input(4);
     OP_REQUIRES(ctx, TensorShapeUtils::IsVector(indices.shape()),
@@ -1210,6 +1490,19 @@ class KvSparseApplyAdagradDecayOp : public OpKernel {
     OP_REQUIRES_OK(ctx, GetInputEmbeddingVar(ctx, 2, &accum_decay_power_var));
     core::ScopedUnref unref_accum_decay_power_var(accum_decay_power_var);
 
+    OP_REQUIRES(ctx,
+                !accum->IsCompactOptState() &&
+                    !accum_decay_power_var->IsCompactOptState(),
+                errors::InvalidArgument(
+                    "compact optimizer state is not supported by "
+                    "KvResourceSparseApplyAdagradDecay; unset "
+                    "TF_EMBEDDING_COMPACT_OPT_STATE"));
+    OP_REQUIRES(ctx, !var->IsAdaptiveDim(),
+                errors::InvalidArgument(
+                    "adaptive embedding dims are not supported by "
+                    "KvResourceSparseApplyAdagradDecay; unset "
+                    "TF_EV_ADAPTIVE_DIM_SHORT_LEN"));
+
     const Tensor& lr = ctx->input(3);
     OP_REQUIRES(
       ctx, IsLegacyScalar(lr.shape()),
@@ -1358,6 +1651,17 @@ class KvSparseApplyAdamOp : public OpKernel {
     OP_REQUIRES_OK(ctx, GetInputEmbeddingVar(ctx, 2, &v));
     core::ScopedUnref unref_v(v);
 
+    OP_REQUIRES(ctx, !m->IsCompactOptState() && !v->IsCompactOptState(),
+                errors::InvalidArgument(
+                    "compact optimizer state is not supported by "
+                    "KvResourceSparseApplyAdam; unset "
+                    "TF_EMBEDDING_COMPACT_OPT_STATE"));
+    OP_REQUIRES(ctx, !var->IsAdaptiveDim(),
+                errors::InvalidArgument(
+                    "adaptive embedding dims are not supported by "
+                    "KvResourceSparseApplyAdam; unset "
+                    "TF_EV_ADAPTIVE_DIM_SHORT_LEN"));
+
     const Tensor& beta1_power = ctx->input(3);
     const Tensor& beta2_power = ctx->input(4);
     const Tensor& lr = ctx->input(5);
@@ -1431,31 +1735,67 @@ class KvSparseApplyAdamOp : public OpKernel {
           Eigen::numext::sqrt(static_cast<T>(1) - beta2_power_scalar) /
           (static_cast<T>(1) - beta1_power_scalar);
 
+      // Group duplicate keys so every unique row loads its state once and
+      // applies the summed gradient with a single vectorized update. This
+      // matches the pre-aggregation the python optimizers do for dense
+      // variables, and gives each row one owning shard thread.
+      std::vector<int64> sorted_positions;
+      std::vector<int64> run_starts;
+      GroupDuplicateIndices<Tindex>(indices, &sorted_positions, &run_starts);
+      const int64 num_unique = run_starts.size() - 1;
+
+      embedding::TableHealthStats* health =
+          embedding::EmbeddingHealthRegistry::GetInstance()->Lookup(
+              var->Name());
+
       auto DoWork = [this, ctx, inner_dim, &var, &m, &v, &grad, &indices,
            &beta1_power_scalar, &beta2_power_scalar, &lr_scalar, &beta1_scalar,
-           &beta2_scalar, &epsilon_scalar, &alpha, &global_step] (int64 start_i, int64 limit_i) {
+           &beta2_scalar, &epsilon_scalar, &alpha, &global_step,
+           &sorted_positions, &run_starts, health] (int64 start_i, int64 limit_i) {
         if (inner_dim > 0) {
           auto grad_flat = grad.flat_outer_dims<T>();
           auto indices_vec = indices.vec<Tindex>();
 
           int64 gs = global_step.scalar<int64>()();
 
-          for (int64 i = start_i; i < limit_i; i++) {
-            const Tindex index = indices_vec(i);
+          Eigen::Tensor<T, 1, Eigen::RowMajor> summed_grad(inner_dim);
+          for (int64 k = start_i; k < limit_i; k++) {
+            const int64 run_begin = run_starts[k];
+            const int64 run_end = run_starts[k + 1];
+            const Tindex index = indices_vec(sorted_positions[run_begin]);
+            summed_grad = grad_flat.template chip<0>(sorted_positions[run_begin]);
+            for (int64 p = run_begin + 1; p < run_end; p++) {
+              summed_grad += grad_flat.template chip<0>(sorted_positions[p]);
+            }
             ValuePtr<T>* value_ptr = nullptr;
             bool is_filter =false;
             OP_REQUIRES_OK(ctx, var->LookupOrCreateKey(index, &value_ptr, &is_filter));
             var->UpdateVersion(value_ptr, gs);
+            const bool sample_health = health != nullptr &&
+                embedding::TableHealthStats::ShouldSample();
             if (is_filter) {
               auto var_i = var->flat(value_ptr);
               auto m_a = m->flat(value_ptr);
               auto v_a = v->flat(value_ptr);
 
-              auto g = grad_flat.template chip<0>(i);
-              m_a += (g - m_a) * (static_cast<T>(1) - beta1_scalar);
-              v_a += (g.square() - v_a) * (static_cast<T>(1) - beta2_scalar);
+              m_a += (summed_grad - m_a) * (static_cast<T>(1) - beta1_scalar);
+              v_a += (summed_grad.square() - v_a) *
+                     (static_cast<T>(1) - beta2_scalar);
               var_i -= (m_a * alpha) / (v_a.sqrt() + epsilon_scalar);
               var->Commit(index, value_ptr);
+              if (sample_health) {
+                // alpha*|m| bounds the applied delta, close enough for
+                // a health signal.
+                Eigen::Tensor<T, 0, Eigen::RowMajor> w_sq =
+                    var_i.square().sum();
+                Eigen::Tensor<T, 0, Eigen::RowMajor> m_sq = m_a.square().sum();
+                health->RecordSampledUpdate(
+                    true, std::sqrt(static_cast<double>(w_sq())),
+                    static_cast<double>(alpha) *
+                        std::sqrt(static_cast<double>(m_sq())));
+              }
+            } else if (sample_health) {
+              health->RecordSampledUpdate(false, 0.0, 0.0);
             }
           }
         }
@@ -1463,7 +1803,7 @@ class KvSparseApplyAdamOp : public OpKernel {
 
       const int64 cost = 1000;
       auto worker_threads = *(ctx->device()->tensorflow_cpu_worker_threads());
-      Shard(worker_threads.num_threads, worker_threads.workers, N, cost, DoWork);
+      Shard(worker_threads.num_threads, worker_threads.workers, num_unique, cost, DoWork);
     }
   }
 
@@ -1984,6 +2324,17 @@ class KvSparseApplyAdamAsyncOp : public OpKernel {
     OP_REQUIRES_OK(ctx, GetInputEmbeddingVar(ctx, 2, &v));
     core::ScopedUnref unref_v(v);
 
+    OP_REQUIRES(ctx, !m->IsCompactOptState() && !v->IsCompactOptState(),
+                errors::InvalidArgument(
+                    "compact optimizer state is not supported by "
+                    "KvResourceSparseApplyAdamAsync; unset "
+                    "TF_EMBEDDING_COMPACT_OPT_STATE"));
+    OP_REQUIRES(ctx, !var->IsAdaptiveDim(),
+                errors::InvalidArgument(
+                    "adaptive embedding dims are not supported by "
+                    "KvResourceSparseApplyAdamAsync; unset "
+                    "TF_EV_ADAPTIVE_DIM_SHORT_LEN"));
+
     Tensor beta1_power;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
                             ctx, 3, use_exclusive_lock_, true, &beta1_power));
@@ -2361,6 +2712,12 @@ class KvResourceSparseApplyGradientDescentOp : public OpKernel {
     OP_REQUIRES_OK(ctx, GetInputEmbeddingVar(ctx, 0, &var));
     core::ScopedUnref unref_var(var);
 
+    OP_REQUIRES(ctx, !var->IsAdaptiveDim(),
+                errors::InvalidArgument(
+                    "adaptive embedding dims are not supported by "
+                    "KvResourceSparseApplyGradientDescent; unset "
+                    "TF_EV_ADAPTIVE_DIM_SHORT_LEN"));
+
     const Tensor& lr = ctx->input(1);
     OP_REQUIRES(
       ctx, IsLegacyScalar(lr.shape()),
@@ -2474,6 +2831,17 @@ class KvSparseApplyAdamWOp : public OpKernel {
     OP_REQUIRES_OK(ctx, GetInputEmbeddingVar(ctx, 2, &v));
     core::ScopedUnref unref_v(v);
 
+    OP_REQUIRES(ctx, !m->IsCompactOptState() && !v->IsCompactOptState(),
+                errors::InvalidArgument(
+                    "compact optimizer state is not supported by "
+                    "KvResourceSparseApplyAdamW; unset "
+                    "TF_EMBEDDING_COMPACT_OPT_STATE"));
+    OP_REQUIRES(ctx, !var->IsAdaptiveDim(),
+                errors::InvalidArgument(
+                    "adaptive embedding dims are not supported by "
+                    "KvResourceSparseApplyAdamW; unset "
+                    "TF_EV_ADAPTIVE_DIM_SHORT_LEN"));
+
     const Tensor& beta1_power = ctx->input(3);
     const Tensor& beta2_power = ctx->input(4);
     const Tensor& lr = ctx->input(5);
@@ -2610,4 +2978,99 @@ TF_CALL_float(REGISTER_CPU_KERNELS);
 #undef REGISTER_CPU_KERNELS
 #undef REGISTER_KERNELS
 
+// Sums values carried by duplicate indices so a pre-combined IndexedSlices
+// batch is pushed to the parameter server instead of one row per example.
+// Fuses the Unique + UnsortedSegmentSum pair the python optimizers emit
+// into one sort-based pass; for power-law features most duplicate rows
+// collapse here on the worker instead of serializing on the sparse-apply
+// row locks on the PS.
+template <typename T, typename Tindex>
+class DeduplicateIndexedSlicesOp : public OpKernel {
+ public:
+  explicit DeduplicateIndexedSlicesOp(OpKernelConstruction* ctx)
+      : OpKernel(ctx) {}
+
+  void Compute(OpKernelContext* ctx) override {
+    const Tensor& values = ctx->input(0);
+    const Tensor& indices = ctx->input(1);
+    OP_REQUIRES(ctx, TensorShapeUtils::IsVector(indices.shape()),
+                errors::InvalidArgument("indices must be a vector"));
+    OP_REQUIRES(ctx, values.dims() >= 1,
+                errors::InvalidArgument("values must be at least 1-D"));
+    const int64 N = indices.NumElements();
+    OP_REQUIRES(ctx, values.dim_size(0) == N,
+                errors::InvalidArgument(
+                    "values.dim_size(0) must match the number of indices, ",
+                    "got ", values.dim_size(0), " and ", N));
+
+    auto indices_vec = indices.vec<Tindex>();
+
+    // Sort the slice positions by index, then sum each run of equal
+    // indices into one output row.
+    std::vector<int64> order(N);
+    for (int64 i = 0; i < N; ++i) {
+      order[i] = i;
+    }
+    std::sort(order.begin(), order.end(),
+              [&indices_vec](int64 a, int64 b) {
+                return indices_vec(a) < indices_vec(b);
+              });
+
+    int64 num_unique = 0;
+    for (int64 i = 0; i < N; ++i) {
+      if (i == 0 || indices_vec(order[i]) != indices_vec(order[i - 1])) {
+        ++num_unique;
+      }
+    }
+
+    TensorShape out_shape = values.shape();
+    out_shape.set_dim(0, num_unique);
+    Tensor* summed_values = nullptr;
+    OP_REQUIRES_OK(ctx, ctx->allocate_output(0, out_shape, &summed_values));
+    Tensor* unique_indices = nullptr;
+    OP_REQUIRES_OK(ctx, ctx->allocate_output(1, TensorShape({num_unique}),
+                                             &unique_indices));
+    if (N == 0) {
+      return;
+    }
+
+    auto values_flat = values.flat_outer_dims<T>();
+    auto summed_flat = summed_values->flat_outer_dims<T>();
+    auto unique_vec = unique_indices->vec<Tindex>();
+
+    int64 out_row = -1;
+    Tindex last_index = 0;
+    for (int64 i = 0; i < N; ++i) {
+      const int64 pos = order[i];
+      const Tindex index = indices_vec(pos);
+      if (out_row < 0 || index != last_index) {
+        ++out_row;
+        unique_vec(out_row) = index;
+        summed_flat.template chip<0>(out_row) =
+            values_flat.template chip<0>(pos);
+        last_index = index;
+      } else {
+        summed_flat.template chip<0>(out_row) +=
+            values_flat.template chip<0>(pos);
+      }
+    }
+  }
+};
+
+#define REGISTER_KERNELS(T, Tindices)                                 \
+  REGISTER_KERNEL_BUILDER(Name("DeduplicateIndexedSlices")            \
+                              .Device(DEVICE_CPU)                     \
+                              .TypeConstraint<T>("T")                 \
+                              .TypeConstraint<Tindices>("Tindices"),  \
+                          DeduplicateIndexedSlicesOp<T, Tindices>);
+#define REGISTER_CPU_KERNELS(T) \
+  REGISTER_KERNELS(T, int32);   \
+  REGISTER_KERNELS(T, int64);
+
+TF_CALL_float(REGISTER_CPU_KERNELS);
+TF_CALL_double(REGISTER_CPU_KERNELS);
+
+#undef REGISTER_CPU_KERNELS
+#undef REGISTER_KERNELS
+
 }  // namespace tensorflow
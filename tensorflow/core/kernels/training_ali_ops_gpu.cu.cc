@@ -16,9 +16,14 @@ limitations under the License.
 #if GOOGLE_CUDA
 #define EIGEN_USE_GPU
 
+#include <mutex>
+#include <vector>
+
 #include "tensorflow/core/framework/register_types.h"
+#include "tensorflow/core/framework/tensor_reference.h"
 #include "tensorflow/core/kernels/training_ali_ops.h"
 #include "tensorflow/core/kernels/training_ali_ops_gpu.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/gpu_kernel_helper.h"
 
 namespace tensorflow {
@@ -90,6 +95,175 @@ __global__ void kv_sparse_apply_adagrad_kernel(int32* item_idxs,
   }
 }
 
+// One deferred column update for the persistent apply kernel below.
+// Plain pointers and scalars only: the struct is memcpy'd verbatim into a
+// device-side work queue.
+template <typename Value>
+struct KvApplyAdagradWorkItem {
+  int32* item_idxs;
+  const Value* grad;
+  Value* var_default_v;
+  Value* acc_default_v;
+  Value** d_banks;
+  bool** d_flags;
+  int64 dim;
+  Value lr;
+  int32 num_items;
+  int32 var_slot_idx;
+  int32 acc_slot_idx;
+  int32 slot_num;
+  int32 bank_size;
+  int32 var_default_v_num;
+  int32 acc_default_v_num;
+};
+
+// Resident kernel consuming a device-side queue of column updates. One
+// launch retires the scatter-grad updates of a whole batch of feature
+// columns: blocks stride over the rows of each descriptor in turn, so
+// launch overhead is paid once per flush instead of once per column.
+template <typename Value>
+__global__ void kv_sparse_apply_adagrad_persistent_kernel(
+    const KvApplyAdagradWorkItem<Value>* queue, int32 queue_size) {
+  for (int32 w = 0; w < queue_size; ++w) {
+    KvApplyAdagradWorkItem<Value> item = queue[w];
+    for (int32 item_idx = blockIdx.x; item_idx < item.num_items;
+         item_idx += gridDim.x) {
+      auto item_pos = item.item_idxs[item_idx];
+      auto bank_idx = item_pos / item.bank_size;
+      auto offset_in_bank = item_pos % item.bank_size;
+      auto var_slot_offset = bank_idx * item.slot_num + item.var_slot_idx;
+      auto acc_slot_offset = bank_idx * item.slot_num + item.acc_slot_idx;
+      bool var_stored = item.d_flags[var_slot_offset][offset_in_bank];
+      bool acc_stored = item.d_flags[acc_slot_offset][offset_in_bank];
+      __syncthreads();
+
+      if (item.var_default_v != nullptr && var_stored == false) {
+        item.d_flags[var_slot_offset][offset_in_bank] = true;
+        for (auto id = threadIdx.x; id < item.dim; id += blockDim.x) {
+          item.d_banks[var_slot_offset][offset_in_bank * item.dim + id] =
+              item.var_default_v[(item_idx % item.var_default_v_num) * item.dim + id];
+        }
+      }
+      if (item.acc_default_v != nullptr && acc_stored == false) {
+        item.d_flags[acc_slot_offset][offset_in_bank] = true;
+        for (auto id = threadIdx.x; id < item.dim; id += blockDim.x) {
+          item.d_banks[acc_slot_offset][offset_in_bank * item.dim + id] =
+              item.acc_default_v[(item_idx % item.acc_default_v_num) * item.dim + id];
+        }
+      }
+      for (auto id = threadIdx.x; id < item.dim; id += blockDim.x) {
+        auto tmp_offset = offset_in_bank * item.dim + id;
+        Value g = item.grad[item_idx * item.dim + id];
+        Value* acc = &item.d_banks[acc_slot_offset][tmp_offset];
+        (*acc) += g * g;
+        item.d_banks[var_slot_offset][tmp_offset] -= item.lr * g * rsqrtf(*acc);
+      }
+    }
+  }
+}
+
+// Host-side staging for the persistent apply path. Opt-in via
+// TF_KV_APPLY_PERSISTENT_BATCH: the number of KvResourceSparseApplyAdagrad
+// calls folded into one resident kernel launch. Pick a divisor of the
+// per-step apply count (typically the sparse column count) so nothing is
+// left queued across a step boundary; a global_step or stream change
+// still flushes defensively before enqueueing. Key admission
+// (LookupOrCreateKey) stays eager and stream ordered, only the scatter
+// updates are deferred, and each queued gradient holds a TensorReference
+// so its buffer cannot be recycled before the flush runs.
+template <typename TKey, typename T>
+class KvAdagradApplyQueue {
+ public:
+  static int64 BatchSizeFromEnv() {
+    static const int64 batch_size = [] {
+      int64 value = 0;
+      TF_CHECK_OK(
+          ReadInt64FromEnvVar("TF_KV_APPLY_PERSISTENT_BATCH", 0, &value));
+      return value;
+    }();
+    return batch_size;
+  }
+
+  static KvAdagradApplyQueue* Global() {
+    static KvAdagradApplyQueue* queue = new KvAdagradApplyQueue;
+    return queue;
+  }
+
+  void Enqueue(const KvApplyAdagradWorkItem<T>& item, Allocator* alloc,
+               const Tensor& grad, int64 gs, cudaStream_t stream) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (!items_.empty() && (stream != stream_ || gs != gs_)) {
+      if (gs != gs_ && !warned_) {
+        warned_ = true;
+        LOG(WARNING) << "TF_KV_APPLY_PERSISTENT_BATCH="
+                     << BatchSizeFromEnv() << " does not divide the number"
+                     << " of sparse applies per step; updates were flushed"
+                     << " at a step boundary. Set it to a divisor of the"
+                     << " per-step apply count to get full batches.";
+      }
+      FlushLocked();
+    }
+    stream_ = stream;
+    gs_ = gs;
+    items_.push_back(item);
+    allocs_.push_back(alloc);
+    grad_refs_.emplace_back(grad);
+    if (items_.size() >= static_cast<size_t>(BatchSizeFromEnv())) {
+      FlushLocked();
+    }
+  }
+
+ private:
+  void FlushLocked() {
+    const int32 queue_size = items_.size();
+    if (queue_size == 0) return;
+    const size_t bytes = queue_size * sizeof(KvApplyAdagradWorkItem<T>);
+    if (bytes > capacity_) {
+      if (h_queue_ != nullptr) {
+        cudaFreeHost(h_queue_);
+        cudaFree(d_queue_);
+      }
+      cudaMallocHost(&h_queue_, bytes);
+      cudaMalloc(&d_queue_, bytes);
+      capacity_ = bytes;
+    }
+    memcpy(h_queue_, items_.data(), bytes);
+    cudaMemcpyAsync(d_queue_, h_queue_, bytes, cudaMemcpyHostToDevice,
+                    stream_);
+
+    int device_id;
+    cudaGetDevice(&device_id);
+    int sm_count;
+    cudaDeviceGetAttribute(&sm_count, cudaDevAttrMultiProcessorCount,
+                           device_id);
+    auto const block_size = 256;
+    auto const grid_size = sm_count * 2;
+    TF_CHECK_OK(GpuLaunchKernel(kv_sparse_apply_adagrad_persistent_kernel<T>,
+                                grid_size, block_size, 0, stream_,
+                                d_queue_, queue_size));
+
+    for (int32 i = 0; i < queue_size; ++i) {
+      TypedAllocator::Deallocate(allocs_[i], items_[i].item_idxs,
+                                 items_[i].num_items);
+      grad_refs_[i].Unref();
+    }
+    items_.clear();
+    allocs_.clear();
+    grad_refs_.clear();
+  }
+
+  std::mutex mu_;
+  std::vector<KvApplyAdagradWorkItem<T>> items_;
+  std::vector<Allocator*> allocs_;
+  std::vector<TensorReference> grad_refs_;
+  cudaStream_t stream_ = nullptr;
+  int64 gs_ = -1;
+  bool warned_ = false;
+  KvApplyAdagradWorkItem<T>* h_queue_ = nullptr;
+  KvApplyAdagradWorkItem<T>* d_queue_ = nullptr;
+  size_t capacity_ = 0;
+};
+
 template <typename TKey, typename T>
 struct KvSparseApplyAdagrad<GPUDevice, TKey, T> {
   void operator()(int32 num_items,
@@ -97,12 +271,34 @@ struct KvSparseApplyAdagrad<GPUDevice, TKey, T> {
                   EmbeddingVarGPU<TKey, T>* var,
                   EmbeddingVarGPU<TKey, T>* accum,
                   const TKey* key_base,
-                  const T* grad,
+                  const Tensor& grad,
                   T lr,
                   int64 gs,
                   cudaStream_t stream) {
     int32* item_idxs = TypedAllocator::Allocate<int32>(alloc, num_items, AllocationAttributes());
     var->LookupOrCreateKey(key_base, item_idxs, num_items, stream, gs);
+    const T* grad_base = grad.flat<T>().data();
+    if (KvAdagradApplyQueue<TKey, T>::BatchSizeFromEnv() > 1) {
+      KvApplyAdagradWorkItem<T> item;
+      item.item_idxs = item_idxs;
+      item.grad = grad_base;
+      item.var_default_v = var->DefaultValuePtr();
+      item.acc_default_v = accum->DefaultValuePtr();
+      item.d_banks = var->kv()->d_bank_ptrs;
+      item.d_flags = var->kv()->d_existence_flag_ptrs;
+      item.dim = var->ValueLen();
+      item.lr = lr;
+      item.num_items = num_items;
+      item.var_slot_idx = var->EmbIdx();
+      item.acc_slot_idx = accum->EmbIdx();
+      item.slot_num = var->SlotNum();
+      item.bank_size = var->kv()->initial_bank_size;
+      item.var_default_v_num = var->GetDefaultValueDim();
+      item.acc_default_v_num = accum->GetDefaultValueDim();
+      KvAdagradApplyQueue<TKey, T>::Global()->Enqueue(item, alloc, grad, gs,
+                                                      stream);
+      return;
+    }
     auto const block_size = 256;
     auto const grid_size = num_items;
     TF_CHECK_OK(GpuLaunchKernel(kv_sparse_apply_adagrad_kernel<T>,
@@ -110,7 +306,7 @@ struct KvSparseApplyAdagrad<GPUDevice, TKey, T> {
                                 item_idxs, var->ValueLen(), var->kv()->d_bank_ptrs, var->kv()->d_existence_flag_ptrs,
                                 var->EmbIdx(), accum->EmbIdx(),
                                 var->SlotNum(), var->kv()->initial_bank_size,
-                                lr, grad, var->DefaultValuePtr(), accum->DefaultValuePtr(),
+                                lr, grad_base, var->DefaultValuePtr(), accum->DefaultValuePtr(),
                                 var->GetDefaultValueDim(), accum->GetDefaultValueDim()));
     TypedAllocator::Deallocate(alloc, item_idxs, num_items);
   }
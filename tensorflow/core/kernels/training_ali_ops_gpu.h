@@ -26,6 +26,9 @@ limitations under the License.
 namespace tensorflow {
 namespace functor {
 
+// The gradient is passed as a Tensor rather than a raw pointer: the
+// persistent-kernel mode defers the update past the end of the op and
+// must hold a reference so the buffer is not recycled before the flush.
 template <typename Device, typename TKey, typename T>
 struct KvSparseApplyAdagrad {
   void operator()(int32 num_items,
@@ -33,7 +36,7 @@ struct KvSparseApplyAdagrad {
                   EmbeddingVarGPU<TKey, T>* var,
                   EmbeddingVarGPU<TKey, T>* accum,
                   const TKey* key_base,
-                  const T* grad,
+                  const Tensor& grad,
                   T lr,
                   int64 gs,
                   cudaStream_t stream);
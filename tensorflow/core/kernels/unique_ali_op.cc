@@ -57,19 +57,19 @@ class UniqueAliOp : public OpKernel {
                                                 false, &serial_));
 
     // NOTE(zycao>: Hash map insertion and lookup performance is dominating in
-    // Unique Op. Based on benchmark results, 'google::dense_hash_map' will be
-    // used as default for most key types except string.
+    // Unique Op. Based on benchmark results, the radix-hash parallel process
+    // ("MULTIMAP") will be used as default for int32/int64 ids, and
+    // 'google::dense_hash_map' as default for other key types.
     //
     // By setting "DEEPREC_UNIQUE_OP_HASH_MAP" environment variable, a particular
     // hash map could be seleteed to use. Possible choices are listed below:
-    //     "MULTIMAP" for multimap parrallel process,
+    //     "MULTIMAP" for radix-hash parrallel process,
     //     "STL" for std::unordred_map,
     //     "ABSL" for absl::flat_hash_map,
     //     "GOOGLE" for google::dense_hash_map.
     std::string hash_map_str;
     OP_REQUIRES_OK(context, ReadStringFromEnvVar(kUniqueOpHashMapEnv,
-                                                 kGoogleHashMapString,
-                                                 &hash_map_str));
+                                                 "", &hash_map_str));
     std::transform(hash_map_str.begin(), hash_map_str.end(),
                    hash_map_str.begin(), ::toupper);
 
@@ -79,13 +79,10 @@ class UniqueAliOp : public OpKernel {
                 errors::InvalidArgument("Invaild ", kUniqueOpUniqRatioHint, "=",
                                         unique_ratio_hint_));
 
-    if (!hash_map_str.compare(kMultiMapString)) {
+    if (hash_map_str.empty()) {
+      map_flag_ = IsRadixHashKey<T>::value ? MULTIMAP : GOOGLE;
+    } else if (!hash_map_str.compare(kMultiMapString)) {
       map_flag_ = MULTIMAP;
-      static char print_once = [] {
-        LOG(INFO) << "MultiMapCompute preserved "
-          "dense hash map key: " << kPreseverdEmptyKey;
-        return '\0';
-      }();
     } else if (!hash_map_str.compare(kStlHashMapString)) {
       map_flag_ = STL;
     } else if (!hash_map_str.compare(kAbslHashMapString)) {
@@ -96,6 +93,13 @@ class UniqueAliOp : public OpKernel {
       map_flag_ = GOOGLE;
     }
 
+    if (map_flag_ == MULTIMAP) {
+      static char print_once = [] {
+        LOG(INFO) << "MultiMapCompute preserved "
+          "dense hash map key: " << kPreseverdEmptyKey;
+        return '\0';
+      }();
+    }
   }
 
   void Compute(OpKernelContext* context) override {
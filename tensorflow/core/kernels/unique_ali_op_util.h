@@ -19,6 +19,7 @@ limitations under the License.
 #include <algorithm>
 #include <limits>
 #include <functional>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
 
@@ -85,7 +86,7 @@ struct HashMapInitializer<google::dense_hash_map<K, V>> {
 template <typename K, typename V, typename H>
 struct HashMapInitializer<google::dense_hash_map<K, V, H>> {
   static void Reserve(google::dense_hash_map<K, V, H>* hash_map, int64 capacity) {
-    hash_map->set_empty_key(kPreseverdEmptyKey);
+    hash_map->set_empty_key(static_cast<K>(kPreseverdEmptyKey));
     hash_map->resize(capacity);
   }
 };
@@ -444,12 +445,12 @@ void ParallelComputeV1(OpKernelContext* context, const Tensor& input,
   t4_runner.Run();
 }
 
-template<typename TIndex, class HashMap>
+template<typename T, typename TIndex, class HashMap>
 void MultiMapCompute(OpKernelContext* context, const Tensor& input,
                      Tensor* idx, int64 axis, int64* uniq_size_out,
                      int32 num_buckets, int64 unique_ratio_hint,
                      Tensor* output) {
-  auto Tin = input.vec<int64>();
+  auto Tin = input.vec<T>();
   const int64 N = input.NumElements();
 
   auto idx_vec = idx->template vec<TIndex>();
@@ -474,7 +475,7 @@ void MultiMapCompute(OpKernelContext* context, const Tensor& input,
 
     for (int64 i = range->Start(); i < range->End(); ++i) {
       auto& id = Tin(i);
-      if (unlikely(id == kPreseverdEmptyKey)) {
+      if (unlikely(id == static_cast<T>(kPreseverdEmptyKey))) {
         st = errors::InvalidArgument(
             "Input id is preserved key of dense_hash_map, "
             "not supported: ", id);
@@ -534,9 +535,9 @@ void MultiMapCompute(OpKernelContext* context, const Tensor& input,
   AllocatorAttributes attr;
   attr.set_on_host(true);
   OP_REQUIRES_OK(context, context->allocate_temp(
-      DataTypeToEnum<int64>::v(),
+      DataTypeToEnum<T>::v(),
       TensorShape({uniq_size}), output, attr));
-  auto key_output_vec = output->template vec<int64>();
+  auto key_output_vec = output->template vec<T>();
 
   auto OutputTask = [&key_output_vec, &uniq_maps, &global_offsets,
       &Tin, &idx_vec, &map_parter]
@@ -561,6 +562,38 @@ void MultiMapCompute(OpKernelContext* context, const Tensor& input,
   t2_runner.Run();
 }
 
+// The radix-hash parallel path is only usable for integer feature ids: it
+// needs a preserved empty key for dense_hash_map and a cheap per-id radix
+// to partition on. int32 and int64 are the id types seen in practice.
+template <typename T>
+struct IsRadixHashKey {
+  static constexpr bool value = std::is_same<T, int32>::value ||
+                                std::is_same<T, int64>::value;
+};
+
+// Radix-hash parallel unique. Ids are partitioned by a radix of their hash
+// so each bucket is owned by exactly one task, then per-bucket hash maps
+// and the inverse index are built without any cross-task synchronization.
+// Non-integer key types fall back to the generic hash map implementation.
+template <typename T, typename TIndex>
+typename std::enable_if<IsRadixHashKey<T>::value>::type
+RadixHashCompute(OpKernelContext* context, const Tensor& input,
+    Tensor* idx, int64 axis, int64* uniq_size_out, int32 num_buckets,
+    int64 unique_ratio_hint, Tensor* output) {
+  MultiMapCompute<T, TIndex, google::dense_hash_map<T, TIndex, IdHash>>(
+      context, input, idx, axis, uniq_size_out, num_buckets,
+      unique_ratio_hint, output);
+}
+
+template <typename T, typename TIndex>
+typename std::enable_if<!IsRadixHashKey<T>::value>::type
+RadixHashCompute(OpKernelContext* context, const Tensor& input,
+    Tensor* idx, int64 axis, int64* uniq_size_out, int32 num_buckets,
+    int64 unique_ratio_hint, Tensor* output) {
+  SerialComputeV1<T, TIndex, google::dense_hash_map<T, TIndex>>(
+      context, input, idx, axis, uniq_size_out, output);
+}
+
 template<typename T, typename TIndex>
 void MultipleElements(OpKernelContext* context, const Tensor& input,
                       Tensor* idx, Tensor* output, int64* uniq_size,
@@ -686,11 +719,11 @@ void UniqueInternal(OpKernelContext* context, const Tensor& input,
     switch (map_flag) {
       case MULTIMAP:
         if (num_buckets > 1 && !serial) {
-          MultiMapCompute<TIndex, google::dense_hash_map<int64, TIndex, IdHash>>
+          RadixHashCompute<T, TIndex>
               (context, input, idx, axis, &uniq_size_out, num_buckets, unique_ratio_hint, output);
         } else {
-          SerialComputeV1<T, TIndex, DefaultHashMap>
-              (context, input, idx, axis, &uniq_size_out, output);
+          ComputeInternalWithHashMap<T, TIndex, DefaultHashMap>
+              (context, input, idx, axis, &uniq_size_out, N, serial, output);
         }
         break;
       case STL:
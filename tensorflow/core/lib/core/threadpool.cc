@@ -122,8 +122,44 @@ void ThreadPool::SetThreadPoolAffinity(const cpu_set_t& cpuset) {
   underlying_threadpool_->SetThreadPoolAffinity(cpuset);
 }
 
+void ThreadPool::SetSpinCount(int spin_count) {
+  underlying_threadpool_->SetSpinCount(spin_count);
+}
+
+void ThreadPool::EnableAdaptiveSpin(Env* env) { adaptive_spin_env_ = env; }
+
+void ThreadPool::AdaptiveSpinRecordArrival() {
+  // All updates are relaxed and racy by design: a lost sample only slows
+  // adaptation down, and this runs on every dispatch.
+  const uint64 now = adaptive_spin_env_->NowNanos();
+  const uint64 last =
+      last_arrival_nanos_.exchange(now, std::memory_order_relaxed);
+  if (last == 0 || now <= last) return;
+  // Gaps beyond this cannot be bridged by spinning, so workers should
+  // park; the cap also lets the estimate recover after a long idle span.
+  static const uint64 kParkThresholdNanos = 100 * 1000;
+  // Rough cost of one failed steal sweep over the queues.
+  static const uint64 kNanosPerSpinIteration = 50;
+  static const int kMaxSpinCount = 20000;
+  uint64 gap = now - last;
+  if (gap > 10 * kParkThresholdNanos) gap = 10 * kParkThresholdNanos;
+  uint64 ewma = arrival_gap_ewma_nanos_.load(std::memory_order_relaxed);
+  ewma = ewma == 0 ? gap : (ewma * 7 + gap) / 8;
+  arrival_gap_ewma_nanos_.store(ewma, std::memory_order_relaxed);
+  if ((arrival_count_.fetch_add(1, std::memory_order_relaxed) & 0xFF) != 0) {
+    return;
+  }
+  int spin_count = 0;
+  if (ewma <= kParkThresholdNanos) {
+    spin_count = static_cast<int>(ewma / kNanosPerSpinIteration) + 100;
+    if (spin_count > kMaxSpinCount) spin_count = kMaxSpinCount;
+  }
+  underlying_threadpool_->SetSpinCount(spin_count);
+}
+
 void ThreadPool::CostSchedule(std::function<void()> fn, int64 cost) {
   CHECK(fn != nullptr);
+  if (adaptive_spin_env_ != nullptr) AdaptiveSpinRecordArrival();
   if (cost < 1) {
     underlying_threadpool_->Schedule(std::move(fn));
   } else {
@@ -133,6 +169,7 @@ void ThreadPool::CostSchedule(std::function<void()> fn, int64 cost) {
 
 void ThreadPool::Schedule(std::function<void()> fn) {
   CHECK(fn != nullptr);
+  if (adaptive_spin_env_ != nullptr) AdaptiveSpinRecordArrival();
   underlying_threadpool_->Schedule(std::move(fn));
 }
 
@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_LIB_CORE_THREADPOOL_H_
 #define TENSORFLOW_CORE_LIB_CORE_THREADPOOL_H_
 
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <sched.h>
@@ -79,6 +80,19 @@ class ThreadPool {
 
   void SetThreadPoolAffinity(const cpu_set_t& cpuset);
 
+  // Sets the number of iterations an idle worker spins looking for new
+  // work before parking. Parked threads pay a wakeup latency on the next
+  // dispatch, so latency-critical pools want larger values while batch
+  // pools prefer to release the CPU quickly. Takes effect on the next
+  // time a worker runs out of work.
+  void SetSpinCount(int spin_count);
+
+  // Continuously retunes the spin count from the observed inter-arrival
+  // time of scheduled closures: tight arrival gaps keep workers spinning
+  // long enough to catch the next closure, sparse ones make them park
+  // immediately.
+  void EnableAdaptiveSpin(Env* env);
+
   // Schedules fn() for execution in the pool of threads.
   void Schedule(std::function<void()> fn);
   void CostSchedule(std::function<void()> fn, int64 cost);
@@ -146,9 +160,18 @@ class ThreadPool {
   Eigen::ThreadPoolInterface* AsEigenThreadPool() const;
 
  private:
+  // Folds the current time into the inter-arrival estimate and
+  // periodically pushes a retuned spin count down to the pool.
+  void AdaptiveSpinRecordArrival();
+
   // underlying_threadpool_ is the user_threadpool if user_threadpool is
   // provided in the constructor. Otherwise it is the eigen_threadpool_.
   Eigen::ThreadPoolInterface* underlying_threadpool_;
+  // Adaptive spin state; enabled iff adaptive_spin_env_ is non-null.
+  Env* adaptive_spin_env_ = nullptr;
+  std::atomic<uint64> last_arrival_nanos_ = {0};
+  std::atomic<uint64> arrival_gap_ewma_nanos_ = {0};
+  std::atomic<uint64> arrival_count_ = {0};
   // eigen_threadpool_ is instantiated and owned by thread::ThreadPool if
   // user_threadpool is not in the constructor.
   std::unique_ptr<Eigen::ThreadPoolTempl<EigenEnvironment>> eigen_threadpool_;
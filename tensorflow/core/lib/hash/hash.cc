@@ -839,5 +839,77 @@ void Hash64Farm_Batch512(const char** data, uint64_t* h_out, size_t len) {
   _mm512_storeu_si512((void*)h_out, ret);
 
 }
+
+// Tail loads for batches whose 8 strings have individually varying
+// lengths: lane i reads the last `back` bytes of string i.
+inline __m512i Fetch64TailBatch(const char** data, const size_t* len,
+                                size_t back) {
+  return _mm512_set_epi64(core::DecodeFixed64(data[7]+len[7]-back),
+                          core::DecodeFixed64(data[6]+len[6]-back),
+                          core::DecodeFixed64(data[5]+len[5]-back),
+                          core::DecodeFixed64(data[4]+len[4]-back),
+                          core::DecodeFixed64(data[3]+len[3]-back),
+                          core::DecodeFixed64(data[2]+len[2]-back),
+                          core::DecodeFixed64(data[1]+len[1]-back),
+                          core::DecodeFixed64(data[0]+len[0]-back));
+}
+
+inline __m512i Fetch32TailBatch(const char** data, const size_t* len,
+                                size_t back) {
+  return _mm512_set_epi64((uint64_t)core::DecodeFixed32(data[7]+len[7]-back),
+                          (uint64_t)core::DecodeFixed32(data[6]+len[6]-back),
+                          (uint64_t)core::DecodeFixed32(data[5]+len[5]-back),
+                          (uint64_t)core::DecodeFixed32(data[4]+len[4]-back),
+                          (uint64_t)core::DecodeFixed32(data[3]+len[3]-back),
+                          (uint64_t)core::DecodeFixed32(data[2]+len[2]-back),
+                          (uint64_t)core::DecodeFixed32(data[1]+len[1]-back),
+                          (uint64_t)core::DecodeFixed32(data[0]+len[0]-back));
+}
+
+// Batch fingerprints for 8 strings of individually varying lengths.
+// Hash64Farm_Batch512 above needs one shared length because its loads at
+// len-relative offsets are lane-uniform; short ids in practice rarely
+// line up that way, so these variants keep the exact per-lane formulas of
+// farmhash's HashLen0to16 while gathering the length-dependent operands
+// per lane. Results are bit-identical to Fingerprint64 on each string.
+// All 8 lengths must lie in [8, 16].
+void Hash64FarmLen8to16_Batch512(const char** data, const size_t* len,
+                                 uint64_t* h_out) {
+  __m512i k2_batch = _mm512_set1_epi64(k2);
+  __m512i factor_2_batch = _mm512_set1_epi64(2);
+  __m512i len_batch = _mm512_set_epi64(len[7], len[6], len[5], len[4],
+                                       len[3], len[2], len[1], len[0]);
+
+  __m512i mul = _mm512_mullo_epi64_hand(len_batch, factor_2_batch);
+  mul = _mm512_add_epi64(mul, k2_batch);
+  __m512i a = Fetch64Batch(data, 0);
+  a = _mm512_add_epi64(a, k2_batch);
+  __m512i b = Fetch64TailBatch(data, len, 8);
+  __m512i c = Rotate64Batch(b, 37);
+  c = _mm512_mullo_epi64_hand(c, mul);
+  c = _mm512_add_epi64(c, a);
+  __m512i d = Rotate64Batch(a, 25);
+  d = _mm512_add_epi64(d, b);
+  d = _mm512_mullo_epi64_hand(d, mul);
+  __m512i ret = HashLen16Batch(c, d, mul);
+  _mm512_storeu_si512((void*)h_out, ret);
+}
+
+// Same as above for 8 lengths in [4, 7].
+void Hash64FarmLen4to7_Batch512(const char** data, const size_t* len,
+                                uint64_t* h_out) {
+  __m512i k2_batch = _mm512_set1_epi64(k2);
+  __m512i factor_2_batch = _mm512_set1_epi64(2);
+  __m512i len_batch = _mm512_set_epi64(len[7], len[6], len[5], len[4],
+                                       len[3], len[2], len[1], len[0]);
+
+  __m512i mul = _mm512_mullo_epi64_hand(len_batch, factor_2_batch);
+  mul = _mm512_add_epi64(mul, k2_batch);
+  __m512i a = Fetch32Batch(data, 0);
+  a = _mm512_slli_epi64(a, 3);
+  a = _mm512_add_epi64(a, len_batch);
+  __m512i ret = HashLen16Batch(a, Fetch32TailBatch(data, len, 4), mul);
+  _mm512_storeu_si512((void*)h_out, ret);
+}
 #endif
 }  // namespace tensorflow
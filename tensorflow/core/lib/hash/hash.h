@@ -73,6 +73,14 @@ extern inline void HashLen33to64Batch(const char** data, uint64_t* h_out,
 extern void Hash64V3_Batch512(const char** data, uint64* h_out, 
                               size_t n, uint64 seed);
 extern void Hash64Farm_Batch512(const char** data, uint64_t* h_out, size_t n);
+extern inline __m512i Fetch64TailBatch(const char** data, const size_t* len,
+                                       size_t back);
+extern inline __m512i Fetch32TailBatch(const char** data, const size_t* len,
+                                       size_t back);
+extern void Hash64FarmLen8to16_Batch512(const char** data, const size_t* len,
+                                        uint64_t* h_out);
+extern void Hash64FarmLen4to7_Batch512(const char** data, const size_t* len,
+                                       uint64_t* h_out);
 #endif
 
 inline uint64 Hash64(const char* data, size_t n) {
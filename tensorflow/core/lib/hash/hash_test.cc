@@ -300,6 +300,65 @@ TEST(Hash, SignedUnsignedIssueHash64FarmBatch) {
     EXPECT_EQ(c.hash64, h_value[7]);
   }
 }
+
+TEST(Hash, Hash64FarmBatchVaryingLengths) {
+  // One lane per length in [8, 16] (lane 8 reuses length 16) and one
+  // lane per length in [4, 7] (lanes reuse lengths); results must match
+  // scalar Fingerprint64 bit for bit.
+  const char* base = "abcdefghijklmnop";
+  {
+    const size_t lens[8] = {8, 9, 10, 11, 12, 13, 14, 15};
+    const char* data_batch[8];
+    for (int j = 0; j < 8; j++) {
+      data_batch[j] = base;
+    }
+    uint64_t h_value[8];
+    Hash64FarmLen8to16_Batch512(data_batch, lens, &h_value[0]);
+    for (int j = 0; j < 8; j++) {
+      EXPECT_EQ(::util::Fingerprint64(base, lens[j]), h_value[j]);
+    }
+  }
+  {
+    const size_t lens[8] = {16, 16, 12, 8, 16, 12, 8, 16};
+    const char* data_batch[8];
+    for (int j = 0; j < 8; j++) {
+      data_batch[j] = base;
+    }
+    uint64_t h_value[8];
+    Hash64FarmLen8to16_Batch512(data_batch, lens, &h_value[0]);
+    for (int j = 0; j < 8; j++) {
+      EXPECT_EQ(::util::Fingerprint64(base, lens[j]), h_value[j]);
+    }
+  }
+  {
+    const size_t lens[8] = {4, 5, 6, 7, 7, 6, 5, 4};
+    const char* data_batch[8];
+    for (int j = 0; j < 8; j++) {
+      data_batch[j] = base;
+    }
+    uint64_t h_value[8];
+    Hash64FarmLen4to7_Batch512(data_batch, lens, &h_value[0]);
+    for (int j = 0; j < 8; j++) {
+      EXPECT_EQ(::util::Fingerprint64(base, lens[j]), h_value[j]);
+    }
+  }
+  // Lanes pointing at different buffers.
+  {
+    std::string inputs[8];
+    const char* data_batch[8];
+    size_t lens[8];
+    for (int j = 0; j < 8; j++) {
+      inputs[j] = std::string(8 + j, 'a' + j);
+      data_batch[j] = inputs[j].data();
+      lens[j] = inputs[j].size();
+    }
+    uint64_t h_value[8];
+    Hash64FarmLen8to16_Batch512(data_batch, lens, &h_value[0]);
+    for (int j = 0; j < 8; j++) {
+      EXPECT_EQ(::util::Fingerprint64(inputs[j].data(), lens[j]), h_value[j]);
+    }
+  }
+}
 #endif
 
 TEST(Hash, HashPtrIsNotIdentityFunction) {
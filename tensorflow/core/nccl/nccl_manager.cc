@@ -418,6 +418,12 @@ void NcclManager::AddToAllGather(std::unique_ptr<Participant> participant,
                  ncclSum /* unused */);
 }
 
+void NcclManager::AddToAllToAll(std::unique_ptr<Participant> participant,
+                                const Context& context) {
+  AddParticipant(std::move(participant), context, kAllToAll,
+                 ncclSum /* unused */);
+}
+
 void NcclManager::AddBroadcastSend(std::unique_ptr<Participant> participant,
                                    const Context& context) {
   participant->root = true;
@@ -742,6 +748,48 @@ void NcclManager::LoopKernelLaunches(NcclStream* nccl_stream) {
                                     data_type, nccl_comm, *cu_stream);
         break;
       }
+      case kAllToAll: {
+#if !TENSORFLOW_USE_ROCM && \
+    (NCCL_MAJOR > 2 || (NCCL_MAJOR == 2 && NCCL_MINOR >= 7))
+        const char* sendbuff = p->input->tensor_data().data();
+        char* recvbuff = const_cast<char*>(p->output->tensor_data().data());
+        const int num_ranks = collective->num_global_devices;
+        const size_t chunk_elements = p->input->NumElements() / num_ranks;
+        const size_t chunk_bytes =
+            chunk_elements * DataTypeSize(collective->data_type);
+
+        VLOG(2) << "call NcclAllToAll collective_key "
+                << collective->collective_key << " participant " << p_idx
+                << " sendbuff " << static_cast<const void*>(sendbuff)
+                << " recvbuff " << static_cast<const void*>(recvbuff)
+                << " chunk_elements " << chunk_elements << " nccl_comm "
+                << nccl_comm << " comm_stream " << comm_stream
+                << " cuda_stream " << cu_stream;
+        nccl_result = ncclGroupStart();
+        for (int peer = 0; peer < num_ranks && nccl_result == ncclSuccess;
+             ++peer) {
+          nccl_result = ncclSend(sendbuff + peer * chunk_bytes, chunk_elements,
+                                 data_type, peer, nccl_comm, *cu_stream);
+          if (nccl_result == ncclSuccess) {
+            nccl_result = ncclRecv(recvbuff + peer * chunk_bytes,
+                                   chunk_elements, data_type, peer, nccl_comm,
+                                   *cu_stream);
+          }
+        }
+        if (nccl_result == ncclSuccess) {
+          nccl_result = ncclGroupEnd();
+        } else {
+          ncclGroupEnd();
+        }
+        break;
+#else
+        p->done_callback(errors::Unimplemented(
+            "NcclAllToAll requires NCCL 2.7 or later for point-to-point "
+            "send/recv support"));
+        collective->Unref();
+        continue;
+#endif
+      }
     }
 
     // Run the done_callback when the nccl kernel finishes running.
@@ -180,6 +180,14 @@ class NcclManager {
   void AddToAllGather(std::unique_ptr<Participant> participant,
                       const Context& context);
 
+  // Adds one participant to an all-to-all.  The participant's input is split
+  // into `num_global_devices` equal contiguous chunks; chunk `r` is sent to
+  // rank `r`, and the chunk received from rank `r` is written at offset `r` of
+  // the output.  The input size must be divisible by the number of devices.
+  // Requires NCCL 2.7 or later (point-to-point support).
+  void AddToAllToAll(std::unique_ptr<Participant> participant,
+                     const Context& context);
+
   // AddBroadcastSend and AddBroadcastRecv combine to send data from one sender
   // to all receivers.
   void AddBroadcastSend(std::unique_ptr<Participant> participant,
@@ -208,6 +216,7 @@ class NcclManager {
     kBroadcast = 2,
     kReduce = 3,
     kAllGather = 4,
+    kAllToAll = 5,
   };
   struct Collective;
   struct Communicator;
@@ -187,6 +187,49 @@ class NcclManagerTest : public ::testing::Test {
     return test_case;
   }
 
+  // Make an all-to-all test case where each rank's input repeats the same
+  // chunk of values for every destination, so that every rank receives the
+  // same exchanged output and the shared `expected` tensor can be used.
+  TestCase* MakeAllToAllTestCase(int num_nodes, int num_ranks_per_node,
+                                 TensorShape shape) {
+    TestCase* test_case = new TestCase();
+    test_case->expected = Tensor(data_type_, shape);
+
+    const int num_ranks = num_nodes * num_ranks_per_node;
+    const int chunk_elements = shape.num_elements() / num_ranks;
+    float value_scale = 0.01;  // Small scale to avoid fp16 overflow.
+    for (int node = 0; node < num_nodes; ++node) {
+      for (int i = 0; i < num_ranks_per_node; ++i) {
+        auto* device = GetDevice(i);
+        auto* stream = device->tensorflow_gpu_device_info()->stream;
+
+        Tensor in_cpu(data_type_, shape);
+        test::FillFn<Scalar>(&in_cpu, [&](int index) {
+          return static_cast<Scalar>((index % chunk_elements + 1) *
+                                     value_scale);
+        });
+        // Chunk received from this rank in every rank's exchanged output.
+        const int rank = node * num_ranks_per_node + i;
+        for (int j = 0; j < chunk_elements; ++j) {
+          auto out_expr = test_case->expected.template flat<Scalar>();
+          out_expr(rank * chunk_elements + j) =
+              static_cast<Scalar>((j + 1) * value_scale);
+        }
+
+        value_scale *= 10;
+        test_case->ins.emplace_back(GpuAllocator(device), data_type_, shape);
+        test_case->outs.emplace_back(GpuAllocator(device), data_type_, shape);
+
+        const Tensor& in_gpu = test_case->ins.back();
+        auto in_gpu_mem = AsDeviceMemory(in_gpu.flat<Scalar>().data());
+        stream->ThenMemcpy(&in_gpu_mem, in_cpu.flat<Scalar>().data(),
+                           in_cpu.TotalBytes());
+      }
+    }
+
+    return test_case;
+  }
+
   // Make a broadcast test which broadcasts a tensor with shape `shape` from
   // `src_node`, `src_rank` to all other ranks.
   // If `in_place` is true, input and output are the same for the source,
@@ -569,6 +612,32 @@ TYPED_TEST(NcclManagerTest, BasicAllGather) {
   }
 }
 
+// Test basic all-to-all.
+TYPED_TEST(NcclManagerTest, BasicAllToAll) {
+  const int num_ranks = 4;
+  std::unique_ptr<typename TestFixture::TestCase> test_case(
+      this->MakeAllToAllTestCase(/*num_nodes=*/1, num_ranks,
+                                 TensorShape({2 * num_ranks, 3})));
+  for (int rank = 0; rank < num_ranks; ++rank) {
+    auto* device = this->GetDevice(rank);
+    VLOG(2) << "rank " << rank << " device " << device->name();
+    auto* info = device->tensorflow_gpu_device_info();
+    auto* stream = device->tensorflow_gpu_device_info()->stream;
+    auto participant = absl::make_unique<NcclManager::Participant>(
+        device->executor(), stream, info,
+        &test_case->ins[rank], &test_case->outs[rank], rank,
+        this->CreateDoneCallback(test_case.get()));
+    NcclManager::instance()->AddToAllToAll(
+        std::move(participant),
+        {"alltoall", /*num_local_devices=*/num_ranks,
+         /*num_global_devices=*/num_ranks, /*communicator_key=*/"",
+         /*source_rank=*/-1});
+  }
+
+  LOG(INFO) << "Verifying results";
+  this->VerifyResults(test_case.get());
+}
+
 // Test basic broadcast.
 TYPED_TEST(NcclManagerTest, BasicBroadcast) {
   this->RunMultiNodeBroadcastTest(/*num_nodes=*/1, /*num_ranks_per_node=*/4,
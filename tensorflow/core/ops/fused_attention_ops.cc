@@ -0,0 +1,63 @@
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/shape_inference.h"
+
+namespace tensorflow {
+
+using shape_inference::DimensionHandle;
+using shape_inference::InferenceContext;
+using shape_inference::ShapeHandle;
+
+// Pools a key sequence into one vector with dot-product attention in a
+// single pass: scores[b, t] = scale * dot(query[b], keys[b, t]) for
+// t < seq_len[b], masked softmax over the valid steps, then the weighted sum
+// of the keys. Replaces the tile/concat/matmul/where/softmax/matmul chain the
+// DIN-style sequence branches compile into. The attention weights are emitted
+// as a second output for the gradient kernel.
+REGISTER_OP("FusedAttentionPooling")
+    .Input("query: T")
+    .Input("keys: T")
+    .Input("seq_len: Tlen")
+    .Output("pooled: T")
+    .Output("alphas: T")
+    .Attr("T: {float}")
+    .Attr("Tlen: {int32, int64} = DT_INT32")
+    .Attr("scale: float = 1.0")
+    .SetShapeFn([](InferenceContext *c) {
+      ShapeHandle query;
+      ShapeHandle keys;
+      ShapeHandle seq_len;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 2, &query));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 3, &keys));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 1, &seq_len));
+      DimensionHandle batch;
+      TF_RETURN_IF_ERROR(c->Merge(c->Dim(query, 0), c->Dim(keys, 0), &batch));
+      TF_RETURN_IF_ERROR(c->Merge(batch, c->Dim(seq_len, 0), &batch));
+      DimensionHandle dim;
+      TF_RETURN_IF_ERROR(c->Merge(c->Dim(query, 1), c->Dim(keys, 2), &dim));
+      c->set_output(0, c->MakeShape({batch, dim}));
+      c->set_output(1, c->MakeShape({batch, c->Dim(keys, 1)}));
+      return Status::OK();
+    });
+
+REGISTER_OP("FusedAttentionPoolingGrad")
+    .Input("pooled_grad: T")
+    .Input("query: T")
+    .Input("keys: T")
+    .Input("seq_len: Tlen")
+    .Input("alphas: T")
+    .Output("query_grad: T")
+    .Output("keys_grad: T")
+    .Attr("T: {float}")
+    .Attr("Tlen: {int32, int64} = DT_INT32")
+    .Attr("scale: float = 1.0")
+    .SetShapeFn([](InferenceContext *c) {
+      ShapeHandle query;
+      ShapeHandle keys;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 2, &query));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 3, &keys));
+      c->set_output(0, query);
+      c->set_output(1, keys);
+      return Status::OK();
+    });
+
+}  // namespace tensorflow
@@ -126,6 +126,67 @@ REGISTER_OP("FusedEmbeddingSparsePreLookUp")
 // variables. This op has no gradient function.
 //     )doc");
 
+// Variant of FusedEmbeddingSparsePreLookUp that additionally deduplicates
+// the partitioned ids on device: partitioned_values holds each distinct id
+// of a partition once, and partitioned_inverse maps every occurrence (in
+// partitioned_indices order) back to its row in the deduplicated list. The
+// Gather after this op then reads each embedding row once and a second,
+// cheap gather over partitioned_inverse expands the rows, so the whole
+// unique/sort/inverse pipeline stays on the GPU.
+REGISTER_OP("FusedEmbeddingSparsePreLookUpUnique")
+    .Attr("num_partitions: int >= 1 = 1")
+    .Attr("partition_axis: int >= 0 = 0")  // for now only support = 0
+    .Attr("fill_empty_row: bool = false")
+    .Attr("prune_invalid_id: bool = false")
+    .Attr("default_id: int = -1")
+    .Attr("partition_strategy: {'div','mod'} = 'div'")
+    .Input("partition_shapes: num_partitions * int64")
+    .Input("sp_values: int64")
+    .Input("sp_indices: int64")
+    .Input("sp_dense_shape: int64")
+    .Output("partitioned_values: num_partitions * int64")
+    .Output("partitioned_indices: num_partitions * int64")
+    .Output("row_empty_and_invalid_flags: int32")
+    .Output("partitioned_inverse: num_partitions * int64")
+    .SetShapeFn([](InferenceContext* ctx) {
+      int num_partitions;
+      TF_RETURN_IF_ERROR(ctx->GetAttr("num_partitions", &num_partitions));
+      int partition_axis;
+      TF_RETURN_IF_ERROR(ctx->GetAttr("partition_axis", &partition_axis));
+
+      ShapeHandle unused;
+      // sp_values
+      TF_RETURN_IF_ERROR(ctx->WithRank(ctx->input(num_partitions), 1, &unused));
+      // sp_indices
+      TF_RETURN_IF_ERROR(
+          ctx->WithRank(ctx->input(num_partitions + 1), 2, &unused));
+      DimensionHandle unused_dim;
+      TF_RETURN_IF_ERROR(ctx->WithValue(ctx->Dim(unused, 1), 2, &unused_dim));
+      // sp_dense_shape
+      TF_RETURN_IF_ERROR(
+          ctx->WithRank(ctx->input(num_partitions + 2), 1, &unused));
+
+      // partition_shapes
+      for (int i = 0; i < num_partitions; i++) {
+        ShapeHandle partition_shape;
+        TF_RETURN_IF_ERROR(ctx->WithRank(ctx->input(i), 1, &partition_shape));
+        TF_RETURN_IF_ERROR(
+            ctx->WithValue(ctx->NumElements(partition_shape), 2, &unused_dim));
+
+        if (int(partition_axis) != 0) {
+          return errors::InvalidArgument("partition_axis > 0 not implemented!");
+        }
+        ctx->set_output(i, ctx->MakeShape({ctx->UnknownDim()}));
+        ctx->set_output(i + num_partitions,
+                        ctx->MakeShape({ctx->UnknownDim(), 2}));
+        ctx->set_output(2 * num_partitions + 1 + i,
+                        ctx->MakeShape({ctx->UnknownDim()}));
+      }
+      ctx->set_output(2 * num_partitions, ctx->MakeShape({ctx->UnknownDim()}));
+
+      return Status::OK();
+    });
+
 REGISTER_OP("FusedEmbeddingSparsePostLookUp")
     .Attr("T : {float32}")
     .Attr("num_partitions: int >= 1 = 1")
@@ -135,6 +196,10 @@ REGISTER_OP("FusedEmbeddingSparsePostLookUp")
                                            // if necessary
     .Attr("combiner: {'sqrtn', 'mean', 'sum'}")
     .Attr("max_norm: float = -1.0")
+    .Attr("output_transposed: bool = false")  // emit [emb_vec_size, batch]
+                                              // so the dense tower can
+                                              // consume the block without
+                                              // an extra transpose
     .Input("emb_shards: num_partitions * T")
     .Input("partitioned_indices: num_partitions * int64")
     .Input("sp_dense_shape: int64")
@@ -172,7 +237,16 @@ REGISTER_OP("FusedEmbeddingSparsePostLookUp")
           ctx->WithRank(ctx->input(2 * num_partitions + 1), 1, &unused));
 
       DimensionHandle emb_vec_size_dim = ctx->Dim(first_emb_shard_shape, 1);
-      ctx->set_output(0, ctx->MakeShape({ctx->UnknownDim(), emb_vec_size_dim}));
+      bool output_transposed;
+      TF_RETURN_IF_ERROR(
+          ctx->GetAttr("output_transposed", &output_transposed));
+      if (output_transposed) {
+        ctx->set_output(
+            0, ctx->MakeShape({emb_vec_size_dim, ctx->UnknownDim()}));
+      } else {
+        ctx->set_output(
+            0, ctx->MakeShape({ctx->UnknownDim(), emb_vec_size_dim}));
+      }
       ctx->set_output(1, ctx->MakeShape({ctx->UnknownDim()}));
       return Status::OK();
     });
@@ -194,6 +268,8 @@ REGISTER_OP("FusedEmbeddingSparsePostLookUpGrad")
     .Attr("default_id: int = -1")
     .Attr("combiner: {'sqrtn', 'mean', 'sum'}")
     .Attr("max_norm: float = -1.0")
+    .Attr("output_transposed: bool = false")  // top_grad arrives as
+                                              // [emb_vec_size, batch]
     .Input("top_grad: T")
     .Input("emb_shards: num_partitions * T")
     .Input("partitioned_indices: num_partitions * int64")
@@ -0,0 +1,45 @@
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/shape_inference.h"
+
+namespace tensorflow {
+
+using shape_inference::DimensionHandle;
+using shape_inference::InferenceContext;
+using shape_inference::ShapeHandle;
+
+// Computes the pairwise dot products between the rows of each [num_features,
+// dim] slice of `features` and packs the strict lower triangle row by row,
+// i.e. output[b, i * (i - 1) / 2 + j] = dot(features[b, i], features[b, j])
+// for j < i. This matches tf.boolean_mask over the strict lower triangle of
+// tf.matmul(features, features, transpose_b=True), without materializing the
+// full num_features x num_features matrix.
+REGISTER_OP("FusedInteractionDot")
+    .Input("features: T")
+    .Output("interactions: T")
+    .Attr("T: {float}")
+    .SetShapeFn([](InferenceContext *c) {
+      ShapeHandle features;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 3, &features));
+      DimensionHandle num_features = c->Dim(features, 1);
+      DimensionHandle output_dim = c->UnknownDim();
+      if (c->ValueKnown(num_features)) {
+        int64 n = c->Value(num_features);
+        output_dim = c->MakeDim(n * (n - 1) / 2);
+      }
+      c->set_output(0, c->MakeShape({c->Dim(features, 0), output_dim}));
+      return Status::OK();
+    });
+
+REGISTER_OP("FusedInteractionDotGrad")
+    .Input("interactions_grad: T")
+    .Input("features: T")
+    .Output("features_grad: T")
+    .Attr("T: {float}")
+    .SetShapeFn([](InferenceContext *c) {
+      ShapeHandle features;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 3, &features));
+      c->set_output(0, features);
+      return Status::OK();
+    });
+
+}  // namespace tensorflow
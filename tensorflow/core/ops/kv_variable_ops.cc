@@ -286,6 +286,7 @@ REGISTER_OP("KvResourceGather")
     .Attr("dtype: type")
     .Attr("Tkeys: {int64,int32,string}")
     .Attr("is_inference: bool = false")
+    .Attr("output_dim: int = -1")
     .SetShapeFn([](InferenceContext* c) {
       ShapeAndType handle_shape_and_type;
       TF_RETURN_IF_ERROR(
@@ -298,6 +299,11 @@ REGISTER_OP("KvResourceGather")
 	  params_subshape = handle_shape_and_type.shape;
       //TF_RETURN_IF_ERROR(
       //    c->Subshape(handle_shape_and_type.shape, 1, &params_subshape));
+      int64 output_dim = -1;
+      TF_RETURN_IF_ERROR(c->GetAttr("output_dim", &output_dim));
+      if (output_dim > 0) {
+        params_subshape = c->Vector(output_dim);
+      }
       ShapeHandle indices_shape = c->input(1);
       ShapeHandle out;
       TF_RETURN_IF_ERROR(c->Concatenate(indices_shape, params_subshape, &out));
@@ -321,6 +327,33 @@ Produces an output tensor with shape `indices.shape + params.shape[1:]` where:
     output[i, ..., j, :, ... :] = params[indices[i, ..., j], :, ..., :]
 ```
 
+When `output_dim` is positive it must not exceed the stored embedding
+width; the op then returns only the first `output_dim` features of each
+row. A table trained once at its maximum width can this way serve
+several candidate dimensions without retraining.
+)doc");
+
+REGISTER_OP("GroupKvResourceGather")
+    .Input("resources: N * resource")
+    .Input("indices: N * Tkeys")
+    .Output("output: dtype")
+    .Attr("N: int >= 1")
+    .Attr("dtype: type")
+    .Attr("Tkeys: {int64,int32}")
+    .Attr("is_inference: bool = false")
+    .SetShapeFn([](InferenceContext* c) {
+      c->set_output(0, c->Vector(InferenceContext::kUnknownDim));
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Gather slices from N embedding variables in one kernel invocation.
+
+Takes N resource handles and N indices tensors and writes all gathered
+rows into a single flat output, laid out variable by variable:
+`[var0_rows..., var1_rows..., ...]` with `indices_i.size * value_len_i`
+elements per variable. Work is sharded jointly across variables and
+keys, which removes the per-op executor dispatch cost of running
+hundreds of small KvResourceGather ops.
 )doc");
 
 REGISTER_OP("KvResourceScatterAdd")
@@ -493,6 +526,273 @@ versions: Vector of all versions present in the table.
 freqs: Vector of all freqs present in the table.
 )doc");
 
+REGISTER_OP("KvResourceDeltaExport")
+    .Input("resource_handle: resource")
+    .Output("keys: Tkeys")
+    .Output("values: Tvalues")
+    .Output("versions: int64")
+    .Output("freqs: int64")
+    .Attr("Tkeys: {int64,int32}")
+    .Attr("Tvalues: type")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle values = c->UnknownShape();
+      TF_RETURN_IF_ERROR(c->WithRankAtLeast(values, 2, &values));
+      ShapeHandle keys = c->UnknownShapeOfRank(1);
+      ShapeHandle versions = c->UnknownShapeOfRank(1);
+      ShapeHandle freqs = c->UnknownShapeOfRank(1);
+      c->set_output(0, keys);
+      c->set_output(1, values);
+      c->set_output(2, versions);
+      c->set_output(3, freqs);
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Outputs only the keys and values updated since the last delta export.
+
+Requires dirty-set tracking on the kv resource (TF_EV_DELTA_EXPORT=1).
+Falls back to a full export when the dirty set overflowed between two
+calls.
+
+resource_handle: Handle to the kvResource.
+keys: Vector of keys updated since the last delta export.
+values: Tensor of values for `keys`. Indexed in parallel with `keys`.
+versions: Vector of versions for `keys`.
+freqs: Vector of freqs for `keys`.
+)doc");
+
+REGISTER_OP("KvResourceExportKeyRange")
+    .Input("resource_handle: resource")
+    .Input("range_start: int64")
+    .Input("range_limit: int64")
+    .Output("keys: Tkeys")
+    .Output("values: Tvalues")
+    .Output("versions: int64")
+    .Output("freqs: int64")
+    .Attr("Tkeys: {int64,int32}")
+    .Attr("Tvalues: type")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle values = c->UnknownShape();
+      TF_RETURN_IF_ERROR(c->WithRankAtLeast(values, 2, &values));
+      ShapeHandle keys = c->UnknownShapeOfRank(1);
+      ShapeHandle versions = c->UnknownShapeOfRank(1);
+      ShapeHandle freqs = c->UnknownShapeOfRank(1);
+      c->set_output(0, keys);
+      c->set_output(1, values);
+      c->set_output(2, versions);
+      c->set_output(3, freqs);
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Outputs the rows of the kv resource whose key is in [range_start, range_limit).
+
+Building block for live key-range migration between parameter servers: a
+coordinator exports the range on the source PS, feeds the tensors to
+KvResourceImportKeyRange on the destination, switches lookup routing and
+then drains the source with KvResourceRemoveKeyRange.
+
+resource_handle: Handle to the kvResource.
+range_start: Scalar, inclusive lower bound of the exported key range.
+range_limit: Scalar, exclusive upper bound of the exported key range.
+keys: Vector of the keys in the range.
+values: Tensor of the values for `keys`. Indexed in parallel with `keys`.
+versions: Vector of versions for `keys`; empty when versions are not recorded.
+freqs: Vector of freqs for `keys`; empty when freqs are not recorded.
+)doc");
+
+REGISTER_OP("KvResourceImportKeyRange")
+    .Input("resource_handle: resource")
+    .Input("keys: Tkeys")
+    .Input("values: Tvalues")
+    .Input("versions: int64")
+    .Input("freqs: int64")
+    .Attr("Tkeys: {int64,int32}")
+    .Attr("Tvalues: type")
+    .SetIsStateful()
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 0, &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 1, &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 2, &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(3), 1, &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(4), 1, &unused));
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Inserts rows exported by KvResourceExportKeyRange into the kv resource.
+
+Existing keys are overwritten with the migrated value, version and freq,
+so replaying a transfer is idempotent. `versions` and `freqs` may be
+empty vectors when the source does not record them.
+
+resource_handle: Handle to the kvResource.
+keys: Vector of migrated keys.
+values: Tensor of migrated values, shape `[keys, value_len]`.
+versions: Vector of migrated versions, or empty.
+freqs: Vector of migrated freqs, or empty.
+)doc");
+
+REGISTER_OP("KvResourceRemoveKeyRange")
+    .Input("resource_handle: resource")
+    .Input("range_start: int64")
+    .Input("range_limit: int64")
+    .Attr("Tkeys: {int64,int32}")
+    .Attr("Tvalues: type")
+    .SetIsStateful()
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 0, &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 0, &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 0, &unused));
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Removes the rows of the kv resource whose key is in [range_start, range_limit).
+
+Drain step of a key-range migration; run on the source PS only after the
+range has been imported on the destination and lookup routing has been
+switched, so no request can still reach the removed rows here.
+
+resource_handle: Handle to the kvResource.
+range_start: Scalar, inclusive lower bound of the removed key range.
+range_limit: Scalar, exclusive upper bound of the removed key range.
+)doc");
+
+// Worker-side lookup cache for read-heavy remote EV tables. The graph
+// consults the cache before the PS gather, sends only the missed keys
+// to the PS and inserts the fetched rows afterwards. Entries go stale
+// by TTL or when their insert-time version drops below the watermark
+// (typically a StalenessCounter version piggybacked from pushes).
+REGISTER_OP("KvResourceLookupCache")
+    .Attr("container: string = ''")
+    .Attr("shared_name: string = ''")
+    .Output("cache: resource")
+    .SetIsStateful()
+    .SetShapeFn([](InferenceContext* c) {
+      c->set_output(0, c->Scalar());
+      return Status::OK();
+    });
+
+REGISTER_OP("KvResourceCacheFind")
+    .Input("cache: resource")
+    .Input("keys: Tkeys")
+    .Input("watermark: int64")
+    .Output("values: dtype")
+    .Output("hits: bool")
+    .Attr("dim: int")
+    .Attr("Tkeys: {int64,int32}")
+    .Attr("dtype: type")
+    .SetIsStateful()
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle keys;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 1, &keys));
+      ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 0, &unused));
+      int32 dim;
+      TF_RETURN_IF_ERROR(c->GetAttr("dim", &dim));
+      c->set_output(0, c->Matrix(c->Dim(keys, 0), dim));
+      c->set_output(1, keys);
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Looks `keys` up in a worker-side embedding cache.
+
+Rows of `values` are filled for cache hits and zero for misses; `hits`
+marks which is which. An entry only hits while it is younger than the
+cache TTL and its insert-time version is at least `watermark`.
+
+cache: Handle to a KvResourceLookupCache.
+keys: Keys to look up.
+watermark: Scalar, minimum acceptable insert-time version; 0 accepts all.
+values: `[keys, dim]`, cached rows for hits, zeros for misses.
+hits: Per-key hit marker.
+)doc");
+
+REGISTER_OP("KvResourceCacheInsert")
+    .Input("cache: resource")
+    .Input("keys: Tkeys")
+    .Input("values: dtype")
+    .Input("version: int64")
+    .Attr("capacity: int = 1048576")
+    .Attr("ttl_seconds: int = 0")
+    .Attr("Tkeys: {int64,int32}")
+    .Attr("dtype: type")
+    .SetIsStateful()
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle keys;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 1, &keys));
+      ShapeHandle values;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 2, &values));
+      ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(3), 0, &unused));
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Inserts rows fetched from the PS into a worker-side embedding cache.
+
+Evicts least-recently-used entries beyond `capacity`. `ttl_seconds` 0
+disables time-based expiry, leaving invalidation to the version
+watermark of KvResourceCacheFind.
+
+cache: Handle to a KvResourceLookupCache.
+keys: Keys of the fetched rows.
+values: `[keys, dim]`, the fetched rows.
+version: Scalar, version to record on the inserted entries.
+)doc");
+
+REGISTER_OP("KvResourceFreeze")
+    .Input("resource_handle: resource")
+    .Input("path: string")
+    .Attr("Tkeys: {int64,int32}")
+    .Attr("Tvalues: type")
+    .SetIsStateful()
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 0, &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 0, &unused));
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Writes the read-only mmap serving file for the kv resource at `path`.
+
+The file holds a bucketed sorted key index over a contiguous value
+region and can be served by FrozenKvResourceGather without building a
+hash map.
+
+resource_handle: Handle to the kvResource.
+path: Scalar, where the frozen file is written.
+)doc");
+
+REGISTER_OP("FrozenKvResourceGather")
+    .Input("path: string")
+    .Input("indices: Tkeys")
+    .Input("default_value: dtype")
+    .Output("output: dtype")
+    .Attr("dtype: type")
+    .Attr("Tkeys: {int64,int32}")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 0, &unused));
+      ShapeHandle values_subshape;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 1, &values_subshape));
+      ShapeHandle out;
+      TF_RETURN_IF_ERROR(c->Concatenate(c->input(1), values_subshape, &out));
+      c->set_output(0, out);
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Gathers rows from a frozen kv resource file written by KvResourceFreeze.
+
+The file is mapped read-only on first use and shared by every gather on
+the same path. Keys absent from the frozen file are served from
+`default_value`, matching the inference-mode behavior of
+KvResourceGather.
+
+path: Scalar, location of the frozen file.
+indices: Keys to look up.
+default_value: Row returned for missing keys, of the frozen value length.
+output: Shape `indices.shape + [value_len]`.
+)doc");
+
 REGISTER_OP("KvResourceGeneratePartitionedTensor")
     .Input("keys: Tkeys")
     .Input("values: Tvalues")
@@ -548,4 +848,18 @@ REGISTER_OP("EVGetVersion")
     })
     .Doc(R"doc()doc");
 
+REGISTER_OP("EVGetMemoryUsage")
+    .Input("resource_handle: resource")
+    .Output("output: int64")
+    .Attr("Tkeys: {int64, int32}")
+    .Attr("Tvalues: type")
+    .SetShapeFn([](InferenceContext* c) {
+      c->set_output(0, c->Scalar());
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Returns the estimated resident bytes of an embedding variable,
+summed over all of its storage tiers.
+)doc");
+
 }  // namespace tensorflow
@@ -148,4 +148,13 @@ num_devices: The number of devices participating in this reduction.
 shared_name: Identifier that is shared between ops of the same broadcast.
     )doc");
 
+REGISTER_OP("NcclAllToAll")
+    .Input("input: T")
+    .Output("data: T")
+    .Attr("T: {half, float, float64, int32, int64}")
+    .Attr("num_devices: int")
+    .Attr("shared_name: string")
+    .SetIsStateful()
+    .SetShapeFn(shape_inference::UnchangedShape);
+
 }  // namespace tensorflow
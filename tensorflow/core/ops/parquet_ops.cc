@@ -28,6 +28,7 @@ REGISTER_OP("ParquetTabularDatasetV1")
     .Attr("partition_count: int = 1")
     .Attr("partition_index: int = 0")
     .Attr("drop_remainder: bool = false")
+    .Attr("read_ahead: int = 0")
     .SetIsStateful()  // NOTE: Source dataset ops must be marked stateful to
                       // inhibit constant folding.
     .SetShapeFn([](shape_inference::InferenceContext* c) {
@@ -416,4 +416,43 @@ REGISTER_OP("ConsumeMutexLock")
     .SetIsStateful()
     .SetShapeFn([](InferenceContext* c) { return Status::OK(); });
 
+// Bounded-staleness training support: a per-variable update counter on
+// the parameter server. The PS bumps it after every gradient
+// application; workers gate their next step on it and re-pull the
+// variable when the version they hold is more than max_staleness
+// updates behind.
+REGISTER_OP("StalenessCounter")
+    .Attr("container: string = ''")
+    .Attr("shared_name: string = ''")
+    .Output("resource: resource")
+    .SetIsStateful()
+    .SetShapeFn([](InferenceContext* c) {
+      c->set_output(0, c->Scalar());
+      return Status::OK();
+    });
+
+REGISTER_OP("StalenessCounterBump")
+    .Input("counter: resource")
+    .Output("version: int64")
+    .SetIsStateful()
+    .SetShapeFn([](InferenceContext* c) {
+      c->set_output(0, c->Scalar());
+      return Status::OK();
+    });
+
+REGISTER_OP("StalenessCounterGate")
+    .Input("counter: resource")
+    .Input("pulled_version: int64")
+    .Attr("max_staleness: int = 0")
+    .Output("stale: bool")
+    .Output("version: int64")
+    .SetIsStateful()
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 0, &unused));
+      c->set_output(0, c->Scalar());
+      c->set_output(1, c->Scalar());
+      return Status::OK();
+    });
+
 }  // namespace tensorflow
@@ -0,0 +1,37 @@
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/shape_inference.h"
+
+namespace tensorflow {
+
+using shape_inference::DimensionHandle;
+using shape_inference::InferenceContext;
+using shape_inference::ShapeHandle;
+
+REGISTER_OP("FusedScoredTopK")
+    .Input("queries: T")
+    .Input("items: T")
+    .Output("values: T")
+    .Output("indices: int32")
+    .Attr("T: {float}")
+    .Attr("k: int >= 1")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle queries;
+      ShapeHandle items;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 2, &queries));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 2, &items));
+      DimensionHandle dims;
+      TF_RETURN_IF_ERROR(
+          c->Merge(c->Dim(queries, 1), c->Dim(items, 1), &dims));
+      int32 k;
+      TF_RETURN_IF_ERROR(c->GetAttr("k", &k));
+      ShapeHandle out = c->Matrix(c->Dim(queries, 0), k);
+      c->set_output(0, out);
+      c->set_output(1, out);
+      return Status::OK();
+    });
+//     .Doc(R"doc(
+// Streams queries x items^T and keeps only the k best-scoring items per
+// query, never materializing the full score matrix.
+//     )doc");
+
+}  // namespace tensorflow
@@ -677,4 +677,58 @@ REGISTER_OP("SparseInnerFlatten")
     .Output("reshape_shape: int64")
     .SetShapeFn(SparseInnerFlattenShapeFn);
 
+// Gradient compression for IndexedSlices pushes. The worker holds one
+// SparseGradientResidual per compressed variable; SparseGradientCompress
+// merges the residual into the step's gradient, keeps the top
+// compress_ratio fraction of rows by L2 norm, quantizes them to int8
+// with a per-row scale and leaves everything else (plus the
+// quantization error of the sent rows) in the residual for the next
+// step. SparseGradientDecompress rebuilds the float rows on the
+// receiving side.
+REGISTER_OP("SparseGradientResidual")
+    .Attr("container: string = ''")
+    .Attr("shared_name: string = ''")
+    .Output("resource: resource")
+    .SetIsStateful()
+    .SetShapeFn([](InferenceContext* c) {
+      c->set_output(0, c->Scalar());
+      return Status::OK();
+    });
+
+REGISTER_OP("SparseGradientCompress")
+    .Input("residual: resource")
+    .Input("indices: Tindices")
+    .Input("values: float")
+    .Output("out_indices: Tindices")
+    .Output("quantized: int8")
+    .Output("scales: float")
+    .Attr("compress_ratio: float = 0.1")
+    .Attr("Tindices: {int64,int32}")
+    .SetIsStateful()
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle indices;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 1, &indices));
+      ShapeHandle values;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 2, &values));
+      // Row count depends on the residual contents, only the value
+      // dimension carries through.
+      c->set_output(0, c->UnknownShapeOfRank(1));
+      c->set_output(1, c->Matrix(c->UnknownDim(), c->Dim(values, 1)));
+      c->set_output(2, c->UnknownShapeOfRank(1));
+      return Status::OK();
+    });
+
+REGISTER_OP("SparseGradientDecompress")
+    .Input("quantized: int8")
+    .Input("scales: float")
+    .Output("values: float")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle quantized;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 2, &quantized));
+      ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 1, &unused));
+      c->set_output(0, quantized);
+      return Status::OK();
+    });
+
 }  // namespace tensorflow
@@ -98,6 +98,13 @@ REGISTER_OP("StringToHash64")
     .Output("output: int64")
     .SetShapeFn(shape_inference::UnchangedShape);
 
+// Maps each string to a dense process-wide int64 id, assigned in
+// first-seen order. Ids are stable within one process only.
+REGISTER_OP("StringToInternedId")
+    .Input("input: string")
+    .Output("output: int64")
+    .SetShapeFn(shape_inference::UnchangedShape);
+
 REGISTER_OP("StringToHash")
     .Input("input: string")
     .Attr("hash_type: string = 'farm'")
@@ -531,4 +531,38 @@ REGISTER_OP("KvResourceSparseApplyAdamW")
     .Doc(R"doc(
 )doc");
 
+REGISTER_OP("DeduplicateIndexedSlices")
+    .Input("values: T")
+    .Input("indices: Tindices")
+    .Output("summed_values: T")
+    .Output("unique_indices: Tindices")
+    .Attr("T: numbertype")
+    .Attr("Tindices: {int32, int64}")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle values = c->input(0);
+      ShapeHandle indices;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 1, &indices));
+      if (!c->RankKnown(values)) {
+        c->set_output(0, c->UnknownShape());
+      } else {
+        TF_RETURN_IF_ERROR(c->WithRankAtLeast(values, 1, &values));
+        DimensionHandle unused;
+        TF_RETURN_IF_ERROR(
+            c->Merge(c->Dim(indices, 0), c->Dim(values, 0), &unused));
+        ShapeHandle out;
+        TF_RETURN_IF_ERROR(c->ReplaceDim(values, 0, c->UnknownDim(), &out));
+        c->set_output(0, out);
+      }
+      c->set_output(1, c->Vector(InferenceContext::kUnknownDim));
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Sums `values` rows carried by duplicate entries of `indices`.
+
+Fused replacement for the Unique + UnsortedSegmentSum pair emitted when
+sparse gradients are combined before being pushed to the parameter server.
+`unique_indices` is returned in ascending order rather than in order of
+first occurrence.
+)doc");
+
 }  // namespace tensorflow
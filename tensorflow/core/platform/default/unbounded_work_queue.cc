@@ -15,14 +15,44 @@ limitations under the License.
 
 #include "tensorflow/core/platform/unbounded_work_queue.h"
 
+#include <cstdlib>
+
 #include "absl/memory/memory.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/mutex.h"
 
 namespace tensorflow {
 
+namespace {
+// A capped pool whose queue has been stalled for this long is assumed to have
+// all of its workers blocked (e.g. on I/O or on other logical threads), and
+// is topped up past the cap to keep making progress.
+constexpr uint64 kStalledQueueMicros = 10 * 1000;  // 10ms
+
+size_t MaxThreadsFromEnv() {
+  const char* val = std::getenv("TF_UNBOUNDED_WORK_QUEUE_MAX_THREADS");
+  if (val == nullptr) {
+    return 0;
+  }
+  const long parsed = std::strtol(val, nullptr, 10);  // NOLINT(runtime/int)
+  if (parsed <= 0) {
+    return 0;
+  }
+  return static_cast<size_t>(parsed);
+}
+}  // namespace
+
 UnboundedWorkQueue::UnboundedWorkQueue(Env* env, const string& thread_name)
-    : env_(env), thread_name_(thread_name) {}
+    : env_(env), thread_name_(thread_name), max_threads_(MaxThreadsFromEnv()) {
+  {
+    mutex_lock l(work_queue_mu_);
+    last_dequeue_micros_ = env_->NowMicros();
+  }
+  if (max_threads_ > 0) {
+    monitor_thread_.reset(env_->StartThread(
+        {}, thread_name_ + "_monitor", [this]() { MonitorLoop(); }));
+  }
+}
 
 UnboundedWorkQueue::~UnboundedWorkQueue() {
   {
@@ -38,6 +68,10 @@ UnboundedWorkQueue::~UnboundedWorkQueue() {
     }
   }
 
+  // Join the monitor thread (if any) before clearing the pool, so it cannot
+  // add new workers while `threads_` is being cleared.
+  monitor_thread_.reset();
+
   {
     mutex_lock l(thread_pool_mu_);
     // Clear the list of pooled threads, which will eventually terminate due to
@@ -59,14 +93,44 @@ void UnboundedWorkQueue::Schedule(WorkFunction fn) {
   // NOTE: The queue may be non-empty, so we must account for queued work when
   // considering how many threads are free.
   if (work_queue_.size() > num_idle_threads_) {
-    // Spawn a new physical thread to process the given function.
-    // NOTE: `PooledThreadFunc` will eventually increment `num_idle_threads_`
-    // at the beginning of its work loop.
-    Thread* new_thread =
-        env_->StartThread({}, thread_name_, [this]() { PooledThreadFunc(); });
+    if (max_threads_ > 0 && num_threads_ >= max_threads_) {
+      // The pool is at its cap and all workers are busy. Queued work will be
+      // picked up when a worker finishes its current item, unless the busy
+      // workers are themselves blocked; in that case the queue stalls, and we
+      // must grow past the cap to guarantee progress.
+      if (env_->NowMicros() - last_dequeue_micros_ < kStalledQueueMicros) {
+        return;
+      }
+    }
+    StartNewThread();
+  }
+}
 
-    mutex_lock l(thread_pool_mu_);
-    thread_pool_.emplace_back(new_thread);
+void UnboundedWorkQueue::StartNewThread() {
+  // Spawn a new physical thread to process the given function.
+  // NOTE: `PooledThreadFunc` will eventually increment `num_idle_threads_`
+  // at the beginning of its work loop.
+  ++num_threads_;
+  Thread* new_thread =
+      env_->StartThread({}, thread_name_, [this]() { PooledThreadFunc(); });
+
+  mutex_lock l(thread_pool_mu_);
+  thread_pool_.emplace_back(new_thread);
+}
+
+void UnboundedWorkQueue::MonitorLoop() {
+  while (true) {
+    env_->SleepForMicroseconds(kStalledQueueMicros);
+    mutex_lock l(work_queue_mu_);
+    if (cancelled_) {
+      return;
+    }
+    if (!work_queue_.empty() && num_idle_threads_ == 0 &&
+        env_->NowMicros() - last_dequeue_micros_ >= kStalledQueueMicros) {
+      // All workers have been blocked for a full period with work queued;
+      // top up the pool so the queued work can make progress.
+      StartNewThread();
+    }
   }
 }
 
@@ -87,6 +151,7 @@ void UnboundedWorkQueue::PooledThreadFunc() {
       fn = std::move(work_queue_.front());
       work_queue_.pop_front();
       --num_idle_threads_;
+      last_dequeue_micros_ = env_->NowMicros();
     }
 
     fn();
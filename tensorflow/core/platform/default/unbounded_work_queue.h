@@ -34,6 +34,12 @@ namespace tensorflow {
 // is made. This mechanism is recommended in situations where short-lived
 // threads are created repeatedly, to avoid the overhead and memory
 // fragmentation that can result from excessive thread creation.
+//
+// The pool size may be capped by setting the environment variable
+// `TF_UNBOUNDED_WORK_QUEUE_MAX_THREADS`. A capped queue stops growing with
+// demand, but still tops up the pool when the busy workers appear to be
+// blocked rather than computing, so logical threads that block on each other
+// cannot deadlock the pool.
 class UnboundedWorkQueue {
  public:
   UnboundedWorkQueue(Env* env, const string& thread_name);
@@ -49,15 +55,31 @@ class UnboundedWorkQueue {
  private:
   void PooledThreadFunc();
 
+  // Runs only when the pool size is capped. Periodically tops up the pool
+  // when the queue is stalled by blocked workers and no `Schedule` call
+  // arrives to do so, which would otherwise deadlock logical threads that
+  // block on each other.
+  void MonitorLoop();
+
+  void StartNewThread() EXCLUSIVE_LOCKS_REQUIRED(work_queue_mu_);
+
   Env* const env_;  // Not owned.
   const string thread_name_;
+  // Soft cap on the pool size; 0 means unbounded.
+  const size_t max_threads_;
   mutex work_queue_mu_;
   condition_variable work_queue_cv_ GUARDED_BY(work_queue_mu_);
   size_t num_idle_threads_ GUARDED_BY(work_queue_mu_) = 0;
+  size_t num_threads_ GUARDED_BY(work_queue_mu_) = 0;
+  // Time at which a worker last dequeued a work item. A capped pool whose
+  // queue is non-empty while this timestamp goes stale has its workers
+  // blocked, and is allowed to grow past the cap.
+  uint64 last_dequeue_micros_ GUARDED_BY(work_queue_mu_) = 0;
   bool cancelled_ GUARDED_BY(work_queue_mu_) = false;
   std::deque<WorkFunction> work_queue_ GUARDED_BY(work_queue_mu_);
   mutex thread_pool_mu_;
   std::vector<std::unique_ptr<Thread>> thread_pool_ GUARDED_BY(thread_pool_mu_);
+  std::unique_ptr<Thread> monitor_thread_;
 };
 
 }  // namespace tensorflow
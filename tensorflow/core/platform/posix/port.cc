@@ -62,11 +62,74 @@ string Hostname() {
   return string(hostname);
 }
 
+#if defined(__linux__) && !defined(__ANDROID__)
+namespace {
+
+// Reads the first line of `path` into `buf`. Returns false when the file
+// cannot be read (e.g. not running under that cgroup layout).
+bool ReadFirstLine(const char* path, char* buf, size_t len) {
+  FILE* f = fopen(path, "r");
+  if (f == nullptr) return false;
+  bool ok = fgets(buf, len, f) != nullptr;
+  fclose(f);
+  return ok;
+}
+
+// Returns the number of CPUs' worth of bandwidth granted by the cgroup
+// CPU controller, rounded up, or -1 when no quota applies. Containers
+// commonly cap bandwidth (cpu.max / cpu.cfs_quota_us) while leaving the
+// cpuset untouched, so sched_getaffinity alone over-reports the usable
+// parallelism and thread pools sized from it thrash against the
+// throttler.
+int CgroupQuotaCPUs() {
+  char line[256];
+  // cgroup v2: cpu.max holds "<quota> <period>" or "max <period>".
+  // Resolve the process's own cgroup from /proc/self/cgroup first; in a
+  // cgroup namespace (the usual container setup) that path is simply "/".
+  char cpu_max_path[256] = "/sys/fs/cgroup/cpu.max";
+  if (ReadFirstLine("/proc/self/cgroup", line, sizeof(line))) {
+    char rel_path[200];
+    if (sscanf(line, "0::%199[^\n]", rel_path) == 1 &&
+        strcmp(rel_path, "/") != 0) {
+      snprintf(cpu_max_path, sizeof(cpu_max_path), "/sys/fs/cgroup%s/cpu.max",
+               rel_path);
+    }
+  }
+  if (ReadFirstLine(cpu_max_path, line, sizeof(line)) ||
+      ReadFirstLine("/sys/fs/cgroup/cpu.max", line, sizeof(line))) {
+    long long quota, period;
+    if (sscanf(line, "%lld %lld", &quota, &period) == 2 && quota > 0 &&
+        period > 0) {
+      return static_cast<int>((quota + period - 1) / period);
+    }
+    return -1;  // "max": no bandwidth limit.
+  }
+  // cgroup v1.
+  char period_line[256];
+  if (ReadFirstLine("/sys/fs/cgroup/cpu/cpu.cfs_quota_us", line,
+                    sizeof(line)) &&
+      ReadFirstLine("/sys/fs/cgroup/cpu/cpu.cfs_period_us", period_line,
+                    sizeof(period_line))) {
+    long long quota = atoll(line);
+    long long period = atoll(period_line);
+    if (quota > 0 && period > 0) {
+      return static_cast<int>((quota + period - 1) / period);
+    }
+  }
+  return -1;
+}
+
+}  // namespace
+#endif  // defined(__linux__) && !defined(__ANDROID__)
+
 int NumSchedulableCPUs() {
 #if defined(__linux__) && !defined(__ANDROID__)
   cpu_set_t cpuset;
   if (sched_getaffinity(0, sizeof(cpu_set_t), &cpuset) == 0) {
-    return CPU_COUNT(&cpuset);
+    int count = CPU_COUNT(&cpuset);
+    static const int quota_cpus = CgroupQuotaCPUs();
+    if (quota_cpus > 0 && quota_cpus < count) count = quota_cpus;
+    return count;
   }
   perror("sched_getaffinity");
 #endif
@@ -92,6 +92,29 @@ TEST_F(UnboundedWorkQueueTest, NestedClosures) {
   BlockUntilClosuresDone(num_closures * num_closures + num_closures);
 }
 
+TEST_F(UnboundedWorkQueueTest, CappedPoolCompletesBlockingWork) {
+  // With a pool capped well below the number of mutually blocking closures,
+  // the queue must detect the stall and top up workers past the cap.
+  setenv("TF_UNBOUNDED_WORK_QUEUE_MAX_THREADS", "2", /*overwrite=*/1);
+  auto capped_queue =
+      absl::make_unique<UnboundedWorkQueue>(Env::Default(), "capped_test");
+  unsetenv("TF_UNBOUNDED_WORK_QUEUE_MAX_THREADS");
+
+  constexpr int num_closures = 8;
+  Notification release;
+  BlockingCounter all_started(num_closures);
+  for (int i = 0; i < num_closures; ++i) {
+    capped_queue->Schedule([&release, &all_started]() {
+      all_started.DecrementCount();
+      release.WaitForNotification();
+    });
+  }
+  // Deadlocks here unless the pool grows past its cap of 2.
+  all_started.Wait();
+  release.Notify();
+  capped_queue.reset();
+}
+
 TEST_F(UnboundedWorkQueueTest, RacyDestructor) {
   constexpr int num_closures = 100;
   // Run `num_closures` closures, then delete `work_queue_`.
@@ -0,0 +1,150 @@
+/* Copyright 2022 The TensorFlow Authors All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+// This checker places the hottest kernels on a roofline model, so
+// optimization effort can follow measured headroom: a bandwidth-bound
+// kernel near its roof will not profit from better arithmetic, and a
+// compute-bound kernel will not profit from better layout.
+#ifndef TENSORFLOW_CORE_PROFILER_INTERNAL_ADVISOR_ROOFLINE_CHECKER_H_
+#define TENSORFLOW_CORE_PROFILER_INTERNAL_ADVISOR_ROOFLINE_CHECKER_H_
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#include "tensorflow/core/profiler/internal/advisor/checker.h"
+
+namespace tensorflow {
+namespace tfprof {
+
+class RooflineChecker : public Checker {
+ public:
+  string name() const override { return kCheckers[4]; }
+
+ private:
+  struct KernelRoofline {
+    string name;
+    bool on_accelerator;
+    int64 exec_micros;
+    int64 float_ops;
+    int64 moved_bytes;
+  };
+
+  AdviceProto::Checker Check(const AdvisorOptionsProto::CheckerOption& options,
+                             const TFStats* stats) override {
+    if (!stats) {
+      fprintf(stderr, "Missing profiles (e.g. graph, run_meta). Skip %s\n",
+              name().c_str());
+      return reports_;
+    }
+    std::vector<KernelRoofline> kernels;
+    for (const auto& n : stats->nodes()) {
+      BuildKernelRoofline(n.second.get(), &kernels);
+    }
+    return CheckInternal(&kernels);
+  }
+
+  AdviceProto::Checker CheckInternal(std::vector<KernelRoofline>* kernels) {
+    std::sort(kernels->begin(), kernels->end(),
+              [](const KernelRoofline& a, const KernelRoofline& b) {
+                return a.exec_micros > b.exec_micros;
+              });
+    for (size_t i = 0; i < kernels->size() && i < kMaxReportedKernels; ++i) {
+      const KernelRoofline& k = (*kernels)[i];
+      const double secs = k.exec_micros * 1e-6;
+      // Operational intensity from the op's FLOP annotation and the
+      // bytes it touched; the measured time then gives the achieved
+      // point under the roof.
+      const double intensity = 1.0 * k.float_ops / k.moved_bytes;
+      const double achieved_gflops = k.float_ops / secs * 1e-9;
+      const double achieved_gbps = k.moved_bytes / secs * 1e-9;
+      const double peak_gflops =
+          k.on_accelerator ? accel_peak_gflops_ : cpu_peak_gflops_;
+      const double peak_gbps = k.on_accelerator ? accel_peak_gbps_ : cpu_peak_gbps_;
+      const double ridge = peak_gflops / peak_gbps;
+      if (intensity < ridge) {
+        reports_.add_reports(strings::Printf(
+            "%s: bandwidth bound (intensity %.2f flop/B, ridge %.2f), "
+            "achieved %.1f GB/s = %.0f%% of %.0f GB/s peak, "
+            "%.1f GFLOP/s, time %.3fms",
+            k.name.c_str(), intensity, ridge, achieved_gbps,
+            100.0 * achieved_gbps / peak_gbps, peak_gbps, achieved_gflops,
+            k.exec_micros / 1000.0));
+      } else {
+        reports_.add_reports(strings::Printf(
+            "%s: compute bound (intensity %.2f flop/B, ridge %.2f), "
+            "achieved %.1f GFLOP/s = %.0f%% of %.0f GFLOP/s peak, "
+            "%.1f GB/s, time %.3fms",
+            k.name.c_str(), intensity, ridge, achieved_gflops,
+            100.0 * achieved_gflops / peak_gflops, peak_gflops, achieved_gbps,
+            k.exec_micros / 1000.0));
+      }
+    }
+    return reports_;
+  }
+
+  void BuildKernelRoofline(const TFGraphNode* node,
+                           std::vector<KernelRoofline>* kernels) {
+    const auto& execs = node->all_op_execs();
+    if (execs.empty()) {
+      return;
+    }
+    // TODO(xpan): Use multiple steps?
+    const int64 step = execs.rbegin()->first;
+    const ExecStep& exec = execs.rbegin()->second;
+
+    KernelRoofline k;
+    k.name = node->name();
+    k.on_accelerator = IsPlacedOnAccelerator(node->canonical_device());
+    k.exec_micros = exec.exec_micros();
+    k.float_ops = node->float_ops(step);
+    // tfprof does not see cache traffic; allocated plus emitted bytes
+    // is the closest proxy for data moved by the kernel.
+    k.moved_bytes = exec.requested_bytes() + exec.output_bytes();
+    if (k.exec_micros <= 0 || k.float_ops <= 0 || k.moved_bytes <= 0) {
+      // Without a FLOP annotation (RegisterStatistics) or allocation
+      // info there is no intensity to place on the roofline.
+      return;
+    }
+    kernels->push_back(k);
+  }
+
+  static double PeakFromEnv(const char* env_name, double default_value) {
+    const char* env = std::getenv(env_name);
+    if (env == nullptr || atof(env) <= 0) {
+      return default_value;
+    }
+    return atof(env);
+  }
+
+  static const size_t kMaxReportedKernels = 10;
+
+  // Machine ceilings; override them to match the deployment. The
+  // defaults describe a common trainer box: a ~1 TFLOP/s fp32 socket at
+  // ~100 GB/s, and a ~10 TFLOP/s fp32 accelerator at ~700 GB/s.
+  const double cpu_peak_gflops_ =
+      PeakFromEnv("TF_PROFILER_CPU_PEAK_GFLOPS", 1000.0);
+  const double cpu_peak_gbps_ = PeakFromEnv("TF_PROFILER_CPU_PEAK_GBPS", 100.0);
+  const double accel_peak_gflops_ =
+      PeakFromEnv("TF_PROFILER_ACCEL_PEAK_GFLOPS", 10000.0);
+  const double accel_peak_gbps_ =
+      PeakFromEnv("TF_PROFILER_ACCEL_PEAK_GBPS", 700.0);
+
+  AdviceProto::Checker reports_;
+};
+
+}  // namespace tfprof
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_PROFILER_INTERNAL_ADVISOR_ROOFLINE_CHECKER_H_
@@ -21,6 +21,7 @@ limitations under the License.
 #include "tensorflow/core/profiler/internal/advisor/expensive_operation_checker.h"
 #include "tensorflow/core/profiler/internal/advisor/internal_checker_runner.h"
 #include "tensorflow/core/profiler/internal/advisor/operation_checker.h"
+#include "tensorflow/core/profiler/internal/advisor/roofline_checker.h"
 #include "tensorflow/core/profiler/tfprof_options.pb.h"
 
 namespace tensorflow {
@@ -61,6 +62,11 @@ class Advisor {
           expensive_op_checker.Run(options.checkers().at(kCheckers[2]),
                                    stats_));
     }
+    if (options.checkers().find(kCheckers[4]) != options.checkers().end()) {
+      RooflineChecker roofline_checker;
+      (*ret.mutable_checkers())[kCheckers[4]].MergeFrom(
+          roofline_checker.Run(options.checkers().at(kCheckers[4]), stats_));
+    }
     for (const auto& checker : ret.checkers()) {
       fprintf(stdout, "\n%s:\n", checker.first.c_str());
       for (const string& r : checker.second.reports()) {
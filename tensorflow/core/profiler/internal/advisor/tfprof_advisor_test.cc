@@ -96,6 +96,38 @@ TEST_F(TFProfAdvisorTest, UtilizationChecker) {
                                 "low utilization"));
 }
 
+TEST_F(TFProfAdvisorTest, RooflineChecker) {
+  NodeExecStats node_stat;
+  node_stat.set_all_start_micros(10);
+  node_stat.set_op_end_rel_micros(1000);
+  auto* output = node_stat.add_output();
+  output->set_slot(0);
+  auto* alloc_desc =
+      output->mutable_tensor_description()->mutable_allocation_description();
+  alloc_desc->set_requested_bytes(1 << 20);
+  alloc_desc->set_allocated_bytes(1 << 20);
+
+  node_defs_.push_back(std::unique_ptr<NodeDef>(new NodeDef()));
+  NodeDef* def = node_defs_.back().get();
+  def->set_name("n3");
+  def->set_op("MatMul");
+  std::unique_ptr<TFGraphNode> node(new TFGraphNode(def, -1, nullptr));
+  node->AddFloatOps(1000000);
+  node->AddStepStat(0, "/job:localhost/replica:0/task:0/device:GPU:0",
+                    node_stat);
+  stats_->AddNodeForTest(0, std::move(node));
+  stats_->BuildAllViews();
+
+  AdvisorOptionsProto options;
+  (*options.mutable_checkers())[kCheckers[4]];
+  AdviceProto advice = advisor_->Advise(options);
+  // n1/n2 carry no FLOP annotation and stay off the roofline; n3 moves
+  // ~1MB for 1 MFLOP in 1ms, far below the accelerator ridge point.
+  EXPECT_EQ(advice.checkers().at(kCheckers[4]).reports_size(), 1);
+  EXPECT_TRUE(absl::StrContains(advice.checkers().at(kCheckers[4]).reports(0),
+                                "n3: bandwidth bound"));
+}
+
 TEST_F(TFProfAdvisorTest, ExpensiveOperationChecker) {
   AdvisorOptionsProto options;
   (*options.mutable_checkers())[kCheckers[2]];
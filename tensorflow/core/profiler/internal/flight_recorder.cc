@@ -0,0 +1,238 @@
+/* Copyright 2022 The DeepRec Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/profiler/internal/flight_recorder.h"
+
+#include <signal.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+#include <unordered_set>
+
+#include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/env_time.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+namespace profiler {
+
+namespace {
+
+int InitialLevel() {
+  bool enabled = false;
+  Status s = ReadBoolFromEnvVar("TF_PROFILER_FLIGHT_RECORDER", false, &enabled);
+  if (!s.ok() || !enabled) return 0;
+  int64 level = 2;
+  ReadInt64FromEnvVar("TF_PROFILER_FLIGHT_RECORDER_LEVEL", 2, &level)
+      .IgnoreError();
+  return static_cast<int>(std::max<int64>(1, level));
+}
+
+size_t RingSlots() {
+  int64 slots = 4096;
+  ReadInt64FromEnvVar("TF_PROFILER_FLIGHT_RECORDER_RING_SIZE", 4096, &slots)
+      .IgnoreError();
+  // Round up to a power of two so the ring index is a mask.
+  size_t result = 64;
+  while (result < static_cast<size_t>(std::max<int64>(1, slots))) result <<= 1;
+  return result;
+}
+
+uint64 WindowNanos() {
+  int64 secs = 10;
+  ReadInt64FromEnvVar("TF_PROFILER_FLIGHT_RECORDER_WINDOW_SECS", 10, &secs)
+      .IgnoreError();
+  return static_cast<uint64>(std::max<int64>(1, secs)) * EnvTime::kSecondsToNanos;
+}
+
+// The name table and the per-thread seen-hash caches stop growing at
+// these sizes; later names dump as raw hashes. In practice op and
+// TraceMe names are a small, stable set.
+constexpr size_t kMaxNames = 1 << 16;
+constexpr size_t kMaxSeenPerThread = 1 << 14;
+
+// Orphan snapshots retained after threads die.
+constexpr size_t kMaxOrphans = 64;
+
+std::atomic<bool> dump_requested(false);
+
+void DumpSignalHandler(int sig) {
+  // Async-signal-safe: just raise a flag; the poll thread does the work.
+  dump_requested.store(true, std::memory_order_relaxed);
+}
+
+}  // namespace
+
+std::atomic<int> FlightRecorder::flight_level_(InitialLevel());
+
+// Each thread appends to its own ring; only the slot write is on the hot
+// path. The registry mutex is only taken on thread birth/death and dump.
+class FlightRecorder::ThreadRing {
+ public:
+  ThreadRing() : mask_(RingSlots() - 1), entries_(new Entry[mask_ + 1]()) {
+    auto* env = Env::Default();
+    tid_ = env->GetCurrentThreadId();
+    FlightRecorder::Get()->RegisterThread(tid_, this);
+  }
+
+  ~ThreadRing() { FlightRecorder::Get()->UnregisterThread(tid_); }
+
+  void Record(uint64 name_hash, uint64 start_time, uint64 end_time) {
+    Entry& e = entries_[pos_++ & mask_];
+    e.name_hash = name_hash;
+    e.start_time = start_time;
+    e.end_time = end_time;
+  }
+
+  // Called under the registry mutex while the owner thread may still be
+  // writing; the entry being overwritten can be torn and is filtered by
+  // the caller's sanity checks.
+  ThreadSnapshot Snapshot() const {
+    ThreadSnapshot snap;
+    snap.tid = tid_;
+    snap.entries.assign(entries_.get(), entries_.get() + mask_ + 1);
+    return snap;
+  }
+
+ private:
+  int32 tid_;
+  const size_t mask_;
+  std::unique_ptr<Entry[]> entries_;
+  size_t pos_ = 0;
+};
+
+/*static*/ FlightRecorder* FlightRecorder::Get() {
+  static FlightRecorder* singleton = new FlightRecorder;
+  return singleton;
+}
+
+void FlightRecorder::RegisterThread(int32 tid, ThreadRing* ring) {
+  mutex_lock lock(mutex_);
+  threads_.emplace(tid, ring);
+}
+
+void FlightRecorder::UnregisterThread(int32 tid) {
+  mutex_lock lock(mutex_);
+  auto it = threads_.find(tid);
+  if (it == threads_.end()) return;
+  if (orphans_.size() >= kMaxOrphans) {
+    orphans_.erase(orphans_.begin());
+  }
+  orphans_.push_back(it->second->Snapshot());
+  threads_.erase(it);
+}
+
+void FlightRecorder::RecordName(uint64 hash, absl::string_view name) {
+  mutex_lock lock(mutex_);
+  if (names_.size() >= kMaxNames) return;
+  names_.emplace(hash, string(name));
+}
+
+/*static*/ void FlightRecorder::Record(absl::string_view name,
+                                       uint64 start_time, uint64 end_time) {
+  // First recorded event starts the dump machinery: SIGUSR2 raises a
+  // flag, a poll thread turns it into a file. Doing this lazily keeps
+  // processes that never trace free of the extra thread.
+  static bool initialized = [] {
+    signal(SIGUSR2, DumpSignalHandler);
+    // Leaked deliberately: joining the poll thread at exit would hang.
+    Env::Default()->StartThread(
+        ThreadOptions(), "flight_recorder_dump", [] {
+          while (true) {
+            Env::Default()->SleepForMicroseconds(500 * 1000);
+            if (dump_requested.exchange(false, std::memory_order_relaxed)) {
+              string path;
+              Status s = DumpToFile(&path);
+              if (s.ok()) {
+                LOG(INFO) << "Flight recorder dump written to " << path;
+              } else {
+                LOG(WARNING) << "Flight recorder dump failed: " << s;
+              }
+            }
+          }
+        });
+    return true;
+  }();
+  (void)initialized;
+
+  const uint64 hash = Hash64(name.data(), name.size());
+  // Register the name once per thread; afterwards the hot path is just
+  // a local set lookup and a ring slot write.
+  static thread_local std::unordered_set<uint64> seen_hashes;
+  if (seen_hashes.size() < kMaxSeenPerThread &&
+      seen_hashes.insert(hash).second) {
+    Get()->RecordName(hash, name);
+  }
+  static thread_local ThreadRing thread_ring;
+  thread_ring.Record(hash, start_time, end_time);
+}
+
+void FlightRecorder::DumpLocked(string* out) {
+  const uint64 now = EnvTime::Default()->NowNanos();
+  const uint64 window = WindowNanos();
+  const uint64 cutoff = now >= window ? now - window : 0;
+
+  std::vector<ThreadSnapshot> snapshots = orphans_;
+  for (const auto& entry : threads_) {
+    snapshots.push_back(entry.second->Snapshot());
+  }
+
+  for (auto& snap : snapshots) {
+    // Oldest-first within a thread; slot order in the ring is not
+    // chronological once it has wrapped.
+    std::sort(snap.entries.begin(), snap.entries.end(),
+              [](const Entry& a, const Entry& b) {
+                return a.start_time < b.start_time;
+              });
+    for (const Entry& e : snap.entries) {
+      // Skip empty slots and entries torn by a concurrent writer.
+      if (e.name_hash == 0 || e.end_time < e.start_time) continue;
+      if (e.end_time < cutoff) continue;
+      auto it = names_.find(e.name_hash);
+      strings::StrAppend(out, snap.tid, " ");
+      if (it != names_.end()) {
+        strings::StrAppend(out, it->second);
+      } else {
+        strings::StrAppend(out, "hash:", strings::Hex(e.name_hash));
+      }
+      strings::StrAppend(out, " ", e.start_time, " ", e.end_time, "\n");
+    }
+  }
+}
+
+/*static*/ void FlightRecorder::Dump(string* out) {
+  FlightRecorder* recorder = Get();
+  mutex_lock lock(recorder->mutex_);
+  recorder->DumpLocked(out);
+}
+
+/*static*/ Status FlightRecorder::DumpToFile(string* dump_path) {
+  string dir = "/tmp";
+  ReadStringFromEnvVar("TF_PROFILER_FLIGHT_RECORDER_DIR", "/tmp", &dir)
+      .IgnoreError();
+  string contents;
+  Dump(&contents);
+  *dump_path = io::JoinPath(
+      dir, strings::StrCat("flight_recorder_", getpid(), "_",
+                           EnvTime::Default()->NowSeconds(), ".trace"));
+  return WriteStringToFile(Env::Default(), *dump_path, contents);
+}
+
+}  // namespace profiler
+}  // namespace tensorflow
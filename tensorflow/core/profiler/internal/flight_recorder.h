@@ -0,0 +1,126 @@
+/* Copyright 2022 The DeepRec Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_PROFILER_INTERNAL_FLIGHT_RECORDER_H_
+#define TENSORFLOW_CORE_PROFILER_INTERNAL_FLIGHT_RECORDER_H_
+
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+
+#include "absl/base/optimization.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace profiler {
+
+// FlightRecorder is an always-on companion to TraceMeRecorder: it keeps
+// the most recent TraceMe activities in fixed-size per-thread rings so
+// the lead-up to a tail-latency event can be dumped after the fact,
+// without anyone having started a profiling session first.
+//
+// To keep the steady-state cost negligible, ring entries are fixed-size
+// (name hash + start/end nanos); the hash -> name mapping is kept in a
+// bounded side table so dumps stay readable. Retention is bounded by
+// both the ring capacity and a wall-clock window applied at dump time.
+//
+// Enabled with TF_PROFILER_FLIGHT_RECORDER=1. Knobs:
+//   TF_PROFILER_FLIGHT_RECORDER_LEVEL       TraceMe level captured (def 2)
+//   TF_PROFILER_FLIGHT_RECORDER_RING_SIZE   entries per thread (def 4096)
+//   TF_PROFILER_FLIGHT_RECORDER_WINDOW_SECS dump window in seconds (def 10)
+//   TF_PROFILER_FLIGHT_RECORDER_DIR         dump directory (def /tmp)
+//
+// Dumps are triggered by SIGUSR2, or programmatically via Dump() /
+// DumpToFile() so monitoring code can snapshot when an SLO check fires.
+// Only scoped TraceMe objects feed the recorder; the ActivityStart/
+// ActivityEnd static API does not, since start and end may land on
+// different threads.
+class FlightRecorder {
+ public:
+  // Returns whether the recorder captures traces <= level. Racy, but
+  // cheap: this is on the TraceMe hot path.
+  static inline bool Active(int level = 1) {
+    return ABSL_PREDICT_FALSE(
+        flight_level_.load(std::memory_order_relaxed) >= level);
+  }
+
+  // Records a completed activity into the calling thread's ring,
+  // overwriting the oldest entry when the ring is full. Non-blocking
+  // except for the first sighting of a name, which registers it in the
+  // name table. Times are in ns since the Unix epoch.
+  static void Record(absl::string_view name, uint64 start_time,
+                     uint64 end_time);
+
+  // Appends the retained events of every thread (and of recently died
+  // threads) to *out, one "tid name start_ns end_ns" line per event,
+  // restricted to the retention window ending now. Events being
+  // overwritten concurrently may be dropped; nothing blocks writers.
+  static void Dump(string* out);
+
+  // Dump() into a timestamped file under TF_PROFILER_FLIGHT_RECORDER_DIR
+  // and return its path in *dump_path.
+  static Status DumpToFile(string* dump_path);
+
+  // Overrides the capture level, which is normally read from the
+  // environment at startup. <= 0 disables capture. Exposed for tests and
+  // for monitoring code that arms the recorder at runtime.
+  static void SetLevel(int level) {
+    flight_level_.store(level, std::memory_order_relaxed);
+  }
+
+ private:
+  class ThreadRing;
+
+  // One retained activity. Fixed-size so ring slots never allocate.
+  struct Entry {
+    uint64 name_hash;
+    uint64 start_time;  // ns since the Unix epoch
+    uint64 end_time;
+  };
+  struct ThreadSnapshot {
+    int32 tid;
+    std::vector<Entry> entries;
+  };
+
+  static FlightRecorder* Get();
+
+  FlightRecorder() = default;
+  FlightRecorder(const FlightRecorder&) = delete;
+  FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+  void RegisterThread(int32 tid, ThreadRing* ring);
+  void UnregisterThread(int32 tid);
+  void RecordName(uint64 hash, absl::string_view name);
+  void DumpLocked(string* out);
+
+  // Capture level; <= 0 when the recorder is disabled. Static atomic so
+  // Active() is fast and safe during static initialization (the zero
+  // pre-initialization reads as disabled).
+  static std::atomic<int> flight_level_;
+
+  mutex mutex_;
+  std::unordered_map<int32, ThreadRing*> threads_ GUARDED_BY(mutex_);
+  // Snapshots of rings whose threads died; bounded, oldest dropped.
+  std::vector<ThreadSnapshot> orphans_ GUARDED_BY(mutex_);
+  // Bounded hash -> name table used to resolve ring entries at dump time.
+  std::unordered_map<uint64, string> names_ GUARDED_BY(mutex_);
+};
+
+}  // namespace profiler
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_PROFILER_INTERNAL_FLIGHT_RECORDER_H_
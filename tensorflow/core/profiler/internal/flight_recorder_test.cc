@@ -0,0 +1,73 @@
+/* Copyright 2022 The DeepRec Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/profiler/internal/flight_recorder.h"
+
+#include <thread>
+
+#include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/platform/env_time.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace profiler {
+namespace {
+
+TEST(FlightRecorderTest, DisabledByDefault) {
+  // The test environment does not set TF_PROFILER_FLIGHT_RECORDER.
+  EXPECT_FALSE(FlightRecorder::Active());
+}
+
+TEST(FlightRecorderTest, RecordsAndDumps) {
+  FlightRecorder::SetLevel(2);
+  EXPECT_TRUE(FlightRecorder::Active(2));
+  EXPECT_FALSE(FlightRecorder::Active(3));
+
+  const uint64 now = EnvTime::Default()->NowNanos();
+  FlightRecorder::Record("recent_op", now - 1000, now);
+
+  string out;
+  FlightRecorder::Dump(&out);
+  EXPECT_TRUE(str_util::StrContains(out, "recent_op"));
+  FlightRecorder::SetLevel(0);
+}
+
+TEST(FlightRecorderTest, DumpDropsEventsOutsideWindow) {
+  FlightRecorder::SetLevel(2);
+  // An event that ended near the epoch is far outside any sane window.
+  FlightRecorder::Record("ancient_op", 1, 2);
+
+  string out;
+  FlightRecorder::Dump(&out);
+  EXPECT_FALSE(str_util::StrContains(out, "ancient_op"));
+  FlightRecorder::SetLevel(0);
+}
+
+TEST(FlightRecorderTest, RetainsEventsFromDeadThreads) {
+  FlightRecorder::SetLevel(2);
+  std::thread worker([] {
+    const uint64 now = EnvTime::Default()->NowNanos();
+    FlightRecorder::Record("dead_thread_op", now - 1000, now);
+  });
+  worker.join();
+
+  string out;
+  FlightRecorder::Dump(&out);
+  EXPECT_TRUE(str_util::StrContains(out, "dead_thread_op"));
+  FlightRecorder::SetLevel(0);
+}
+
+}  // namespace
+}  // namespace profiler
+}  // namespace tensorflow
@@ -21,6 +21,7 @@ limitations under the License.
 #include "tensorflow/core/platform/env_time.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/profiler/internal/flight_recorder.h"
 #include "tensorflow/core/profiler/internal/traceme_recorder.h"
 
 #include "tensorflow/core/platform/annotation.h"
@@ -81,9 +82,13 @@ class TraceMe {
   // out their host traces based on verbosity.
   explicit TraceMe(absl::string_view activity_name, int level = 1) {
     DCHECK_GE(level, 1);
-    if (TraceMeRecorder::Active(level)) {
+    const bool session_active = TraceMeRecorder::Active(level);
+    if (session_active || FlightRecorder::Active(level)) {
       new (&no_init_.name) string(activity_name);
-      myActivityID = tracing::CallingContext::GetAndPush();
+      if (session_active) {
+        myActivityID = tracing::CallingContext::GetAndPush();
+        pushed_context_ = true;
+      }
       start_time_ = EnvTime::Default()->NowNanos();
     } else {
       start_time_ = kUntracedActivity;
@@ -97,9 +102,13 @@ class TraceMe {
   // constructor so we avoid copying them when tracing is disabled.
   explicit TraceMe(string &&activity_name, int level = 1) {
     DCHECK_GE(level, 1);
-    if (TraceMeRecorder::Active(level)) {
+    const bool session_active = TraceMeRecorder::Active(level);
+    if (session_active || FlightRecorder::Active(level)) {
       new (&no_init_.name) string(std::move(activity_name));
-      myActivityID = tracing::CallingContext::GetAndPush();
+      if (session_active) {
+        myActivityID = tracing::CallingContext::GetAndPush();
+        pushed_context_ = true;
+      }
       start_time_ = EnvTime::Default()->NowNanos();
     } else {
       start_time_ = kUntracedActivity;
@@ -128,9 +137,13 @@ class TraceMe {
   template <typename NameGeneratorT>
   explicit TraceMe(NameGeneratorT name_generator, int level = 1) {
     DCHECK_GE(level, 1);
-    if (TraceMeRecorder::Active(level)) {
+    const bool session_active = TraceMeRecorder::Active(level);
+    if (session_active || FlightRecorder::Active(level)) {
       new (&no_init_.name) string(name_generator());
-      myActivityID = tracing::CallingContext::GetAndPush();
+      if (session_active) {
+        myActivityID = tracing::CallingContext::GetAndPush();
+        pushed_context_ = true;
+      }
       start_time_ = EnvTime::Default()->NowNanos();
     } else {
       start_time_ = kUntracedActivity;
@@ -150,10 +163,16 @@ class TraceMe {
     //   event will be discarded when its start timestamp fall outside of the
     //   start/stop session timestamp.
     if (start_time_ != kUntracedActivity) {
-      if (TraceMeRecorder::Active()) {
+      const uint64 end_time = EnvTime::Default()->NowNanos();
+      // The flight recorder retains recent activities even when no
+      // profiling session is running.
+      if (FlightRecorder::Active()) {
+        FlightRecorder::Record(no_init_.name, start_time_, end_time);
+      }
+      if (pushed_context_ && TraceMeRecorder::Active()) {
         tracing::CallingContext::Pop();
         TraceMeRecorder::Record({myActivityID, std::move(no_init_.name),
-                                 start_time_, EnvTime::Default()->NowNanos(),
+                                 start_time_, end_time,
                                  tracing::CallingContext::GetCurrentContext()});
       }
       no_init_.name.~string();
@@ -194,6 +213,11 @@ class TraceMe {
 
   uint64 myActivityID = kCompleteActivity;
 
+  // Whether the constructor pushed a calling context; set only when a
+  // profiling session was active at construction, so a flight-recorder-
+  // only activity never pops a context it didn't push.
+  bool pushed_context_ = false;
+
   static uint64 ActivityStartImpl(absl::string_view activity_name);
   static void ActivityEndImpl(uint64 activity_id);
 
@@ -293,6 +293,42 @@ class SessionGroup {
       int32_t session_id = -1) = 0;
   virtual Session* GetSession(int32_t hint_id = -1) = 0;
   virtual std::unique_ptr<Session>* GetSessionPtr(int id) = 0;
+
+  /// \brief Pre-compiled execution across the group: creates the
+  /// callable on every member session and returns one group-level
+  /// handle, so RunCallable can be dispatched to any member with only
+  /// argument binding per call (no per-request feed/fetch name
+  /// resolution or signature hashing).
+  virtual Status MakeCallable(const CallableOptions& callable_options,
+                              Session::CallableHandle* out_handle) {
+    return errors::Unimplemented(
+        "MakeCallable is not supported for this session group.");
+  }
+  virtual Status RunCallable(Session::CallableHandle handle,
+                             const std::vector<Tensor>& feed_tensors,
+                             std::vector<Tensor>* fetch_tensors,
+                             RunMetadata* run_metadata,
+                             int32_t session_id = -1) {
+    return errors::Unimplemented(
+        "RunCallable is not supported for this session group.");
+  }
+  virtual Status ReleaseCallable(Session::CallableHandle handle) {
+    return errors::Unimplemented(
+        "ReleaseCallable is not supported for this session group.");
+  }
+
+  /// \brief Shared CPU resource manager of the group, or nullptr when
+  /// the group keeps no shared resources. A replacement group may be
+  /// created on top of this manager (see NewSessionGroup) so stateful
+  /// resources such as initialized lookup tables survive a model
+  /// version switch.
+  virtual ResourceMgr* GetCpuSharedResourceMgr() { return nullptr; }
+
+  /// \brief Gives up ownership of the shared CPU resource manager and
+  /// returns it, or nullptr when there is none. Called on the old group
+  /// after its manager has been adopted by a replacement group, so the
+  /// old group's destruction no longer tears the shared resources down.
+  virtual ResourceMgr* ReleaseCpuSharedResourceMgr() { return nullptr; }
 };
 
 /// \brief Create a new session with the given options.
@@ -303,9 +339,15 @@ class SessionGroup {
 /// function will return an error status and set *out_session to nullptr.
 Status NewSession(const SessionOptions& options, Session** out_session);
 
+/// When `shared_cpu_rmgr` is non-null the new group is built on top of
+/// that resource manager instead of a fresh one and takes ownership of
+/// it; combined with SessionGroup::ReleaseCpuSharedResourceMgr this
+/// lets a replacement group inherit stateful resources (vocabulary and
+/// hash tables keyed by shared_name) from the group it replaces.
 Status NewSessionGroup(const SessionOptions& options,
                        SessionGroup** out_session_group,
-                       int session_num = 1);
+                       int session_num = 1,
+                       ResourceMgr* shared_cpu_rmgr = nullptr);
 
 /// \brief Resets resource containers associated with a target.
 ///
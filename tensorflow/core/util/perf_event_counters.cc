@@ -0,0 +1,100 @@
+/* Copyright 2022 The DeepRec Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/util/perf_event_counters.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstring>
+#endif  // __linux__
+
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+
+bool PerfEventCounters::Enabled() {
+  static bool enabled = [] {
+    bool value = false;
+    TF_CHECK_OK(ReadBoolFromEnvVar("TF_NODE_PERF_COUNTERS", false, &value));
+    return value;
+  }();
+  return enabled;
+}
+
+#if defined(__linux__)
+
+namespace {
+
+int OpenHardwareCounter(uint64 config) {
+  perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.size = sizeof(attr);
+  attr.config = config;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  // pid 0, cpu -1: count this thread on whatever cpu it runs on.
+  return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+bool ReadCounter(int fd, int64* value) {
+  return fd >= 0 && read(fd, value, sizeof(*value)) == sizeof(*value);
+}
+
+struct ThreadCounters {
+  int llc_miss_fd;
+  int llc_ref_fd;
+
+  ThreadCounters() {
+    llc_miss_fd = OpenHardwareCounter(PERF_COUNT_HW_CACHE_MISSES);
+    llc_ref_fd = OpenHardwareCounter(PERF_COUNT_HW_CACHE_REFERENCES);
+    if (llc_miss_fd < 0 || llc_ref_fd < 0) {
+      static bool logged = [] {
+        LOG(WARNING) << "TF_NODE_PERF_COUNTERS is set but perf_event "
+                        "counters could not be opened (check "
+                        "kernel.perf_event_paranoid); node stats will not "
+                        "carry cache counters.";
+        return true;
+      }();
+      (void)logged;
+    }
+  }
+
+  ~ThreadCounters() {
+    if (llc_miss_fd >= 0) close(llc_miss_fd);
+    if (llc_ref_fd >= 0) close(llc_ref_fd);
+  }
+};
+
+}  // namespace
+
+bool PerfEventCounters::Read(Sample* sample) {
+  if (!Enabled()) return false;
+  static thread_local ThreadCounters counters;
+  return ReadCounter(counters.llc_miss_fd, &sample->llc_misses) &&
+         ReadCounter(counters.llc_ref_fd, &sample->llc_references);
+}
+
+#else  // !__linux__
+
+bool PerfEventCounters::Read(Sample* sample) { return false; }
+
+#endif  // __linux__
+
+}  // namespace tensorflow
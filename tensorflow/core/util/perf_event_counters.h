@@ -0,0 +1,50 @@
+/* Copyright 2022 The DeepRec Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_UTIL_PERF_EVENT_COUNTERS_H_
+#define TENSORFLOW_CORE_UTIL_PERF_EVENT_COUNTERS_H_
+
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// Thread-scoped Linux perf_event hardware counters, used by the step
+// stats collector to attribute last-level-cache behavior to individual
+// op executions. Counters are opened lazily per thread the first time a
+// thread samples, and count continuously; callers take a sample at op
+// start and end and record the delta.
+//
+// Off unless TF_NODE_PERF_COUNTERS=1. Sampling costs two read() calls
+// per op, so it is meant for profiling runs, not steady-state serving.
+// Requires kernel.perf_event_paranoid to permit unprivileged self
+// profiling; if the counters cannot be opened the first sample fails
+// and the thread never retries.
+class PerfEventCounters {
+ public:
+  struct Sample {
+    int64 llc_misses = 0;
+    int64 llc_references = 0;
+  };
+
+  // True iff TF_NODE_PERF_COUNTERS=1 (checked once).
+  static bool Enabled();
+
+  // Reads this thread's counters. Returns false when disabled,
+  // unsupported on this platform, or the counters could not be opened.
+  static bool Read(Sample* sample);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_UTIL_PERF_EVENT_COUNTERS_H_
@@ -42,6 +42,7 @@ limitations under the License.
 #include "tensorflow/core/lib/io/table_builder.h"
 #include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/saved_tensor_slice_util.h"
 #include "tensorflow/core/util/tensor_bundle/byte_swap.h"
 #include "tensorflow/core/util/tensor_slice_util.h"
@@ -380,6 +381,10 @@ table::Options TableBuilderOptions() {
   return o;
 }
 
+// Upper bound on tensor bytes queued per background shard writer, so a
+// slow disk cannot pin a large part of the checkpoint in memory.
+const int64 kMaxPendingShardBytes = 256 << 20;
+
 // Writes zeros to output buffer to align the next write to the requested
 // alignment. "size" is the current size of the buffer and is updated to the
 // new size.
@@ -420,6 +425,118 @@ BundleWriter::BundleWriter(Env* env, StringPiece prefix, const Options& options)
       new FileOutputBuffer(wrapper.release(), 8 << 20 /* 8MB write buffer */));
 
   VLOG(1) << "Writing to file " << tmp_data_path_;
+
+  int64 num_shards = options_.num_shards;
+  if (num_shards <= 1) {
+    Status s = ReadInt64FromEnvVar("TF_BUNDLE_WRITER_NUM_SHARDS", 1,
+                                   &num_shards);
+    if (!s.ok()) {
+      LOG(WARNING) << s.error_message();
+      num_shards = 1;
+    }
+  }
+  num_shards_ = std::max<int64>(num_shards, 1);
+  for (int i = 1; i < num_shards_; ++i) {
+    auto shard = std::unique_ptr<ShardState>(new ShardState);
+    shard->tmp_path = strings::StrCat(DataFilename(prefix_, i, num_shards_),
+                                      ".tempstate", random::New64());
+    std::unique_ptr<WritableFile> shard_file;
+    status_ = env_->NewWritableFile(shard->tmp_path, &shard_file);
+    if (!status_.ok()) return;
+    shard->out = std::unique_ptr<FileOutputBuffer>(new FileOutputBuffer(
+        shard_file.release(), 8 << 20 /* 8MB write buffer */));
+    ShardState* shard_ptr = shard.get();
+    shard->thread.reset(env_->StartThread(
+        ThreadOptions(), strings::StrCat("bundle_shard_writer_", i),
+        [this, shard_ptr]() { ShardWriteLoop(shard_ptr); }));
+    shards_.push_back(std::move(shard));
+    VLOG(1) << "Writing to shard file " << shard_ptr->tmp_path;
+  }
+}
+
+BundleWriter::~BundleWriter() { JoinShardWriters(); }
+
+void BundleWriter::JoinShardWriters() {
+  for (auto& shard : shards_) {
+    if (shard->thread == nullptr) continue;
+    {
+      mutex_lock l(shard->mu);
+      shard->done = true;
+      shard->cv.notify_all();
+    }
+    shard->thread.reset();  // Joins the writer.
+  }
+}
+
+void BundleWriter::ShardWriteLoop(ShardState* shard) {
+  while (true) {
+    ShardWriteTask task;
+    {
+      mutex_lock l(shard->mu);
+      while (shard->tasks.empty() && !shard->done) {
+        shard->cv.wait(l);
+      }
+      if (shard->tasks.empty()) return;
+      task = std::move(shard->tasks.front());
+      shard->tasks.pop_front();
+    }
+    const size_t data_bytes = task.val.TotalBytes();
+    size_t unused = 0;
+    Status s = WriteTensor(task.val, shard->out.get(), &unused);
+    if (s.ok()) {
+      task.entry->set_crc32c(crc32c::Mask(
+          crc32c::Value(GetBackingBuffer(task.val), data_bytes)));
+      if (task.pad_bytes > 0) {
+        s = shard->out->Append(string(task.pad_bytes, '\0'));
+      }
+    }
+    mutex_lock l(shard->mu);
+    if (!s.ok() && shard->status.ok()) {
+      shard->status = s;
+    }
+    shard->pending_bytes -= data_bytes;
+    shard->cv.notify_all();
+  }
+}
+
+Status BundleWriter::EnqueueShardWrite(const Tensor& val,
+                                       BundleEntryProto* entry) {
+  // Assign the tensor to the shard with the fewest bytes so far, so a few
+  // large tensors spread over the writers instead of queueing up behind
+  // each other.
+  ShardState* target = shards_[0].get();
+  int shard_id = 1;
+  for (int i = 1; i < static_cast<int>(shards_.size()); ++i) {
+    if (shards_[i]->size < target->size) {
+      target = shards_[i].get();
+      shard_id = i + 1;
+    }
+  }
+
+  const int64 data_bytes = val.TotalBytes();
+  entry->set_shard_id(shard_id);
+  entry->set_offset(target->size);
+  entry->set_size(data_bytes);
+  int64 pad_bytes = 0;
+  const int64 bytes_over = (target->size + data_bytes) % options_.data_alignment;
+  if (bytes_over != 0) {
+    pad_bytes = options_.data_alignment - bytes_over;
+  }
+  target->size += data_bytes + pad_bytes;
+
+  mutex_lock l(target->mu);
+  if (!target->status.ok()) {
+    status_ = target->status;
+    return status_;
+  }
+  while (target->pending_bytes > kMaxPendingShardBytes &&
+         target->status.ok()) {
+    target->cv.wait(l);
+  }
+  target->tasks.push_back(ShardWriteTask{val, entry, pad_bytes});
+  target->pending_bytes += data_bytes;
+  target->cv.notify_all();
+  return Status::OK();
 }
 
 Status BundleWriter::Add(StringPiece key, const Tensor& val) {
@@ -434,6 +551,14 @@ Status BundleWriter::Add(StringPiece key, const Tensor& val) {
   BundleEntryProto* entry = &entries_[key_string];
   entry->set_dtype(val.dtype());
   val.shape().AsProto(entry->mutable_shape());
+  if (num_shards_ > 1 && val.dtype() != DT_STRING &&
+      val.dtype() != DT_VARIANT) {
+    // Fixed-size tensors go to the background shard writers; their offset
+    // and size are known up front. String and variant tensors stay on the
+    // synchronous shard 0, where sizes are only known while writing.
+    status_ = EnqueueShardWrite(val, entry);
+    return status_;
+  }
   entry->set_shard_id(0);
   entry->set_offset(size_);
 
@@ -595,12 +720,30 @@ void BundleWriter::EndSegmentData(int64 total_bytes_written, int64 end_bytes_wri
 // TODO(zongheng): on metadata write failure or !status_.ok(), consider removing
 // the orphaned data file.
 Status BundleWriter::Finish() {
+  // Drain the background shard writers before any file is finalized.
+  JoinShardWriters();
+  for (int i = 0; i < static_cast<int>(shards_.size()); ++i) {
+    ShardState* shard = shards_[i].get();
+    if (shard->out == nullptr) continue;
+    {
+      mutex_lock l(shard->mu);
+      status_.Update(shard->status);
+    }
+    status_.Update(shard->out->Close());
+    shard->out = nullptr;
+    if (status_.ok()) {
+      status_ = Env::Default()->RenameFile(
+          shard->tmp_path, DataFilename(prefix_, i + 1, num_shards_));
+    } else {
+      Env::Default()->DeleteFile(shard->tmp_path).IgnoreError();
+    }
+  }
   if (out_) {
     status_.Update(out_->Close());
     out_ = nullptr;
     if (status_.ok()) {
-      status_ = Env::Default()->RenameFile(tmp_data_path_,
-                                           DataFilename(prefix_, 0, 1));
+      status_ = Env::Default()->RenameFile(
+          tmp_data_path_, DataFilename(prefix_, 0, num_shards_));
     } else {
       Env::Default()->DeleteFile(tmp_data_path_).IgnoreError();
     }
@@ -618,7 +761,7 @@ Status BundleWriter::Finish() {
     table::TableBuilder builder(options, file.get());
     // Header entry.
     BundleHeaderProto header;
-    header.set_num_shards(1);
+    header.set_num_shards(num_shards_);
     header.set_endianness(BundleHeaderProto::LITTLE);
     if (!port::kLittleEndian) header.set_endianness(BundleHeaderProto::BIG);
     VersionDef* version = header.mutable_version();
@@ -1174,6 +1317,16 @@ Status BundleReader::GetTensorInfo(
   return Status::OK();
 }
 
+Status BundleReader::GetTensorFileInfo(
+    StringPiece key, int64* size, string* filename, int64* offset) {
+  BundleEntryProto entry;
+  TF_RETURN_IF_ERROR(GetBundleEntryProto(key, &entry));
+  *filename = DataFilename(prefix_, entry.shard_id(), num_shards_);
+  *size = entry.size();
+  *offset = entry.offset();
+  return Status::OK();
+}
+
 Status BundleReader::ReadCurrent(Tensor* val) {
   CHECK(val != nullptr);
   BundleEntryProto entry;
@@ -1358,6 +1511,15 @@ Status BundleReader::LookupTensorShape(StringPiece key, TensorShape* shape) {
   return LookupDtypeAndShape(key, &ignored, shape);
 }
 
+Status BundleReader::LookupEntryLocation(StringPiece key, int* shard_id,
+                                         int64* offset) {
+  BundleEntryProto entry;
+  TF_RETURN_IF_ERROR(GetBundleEntryProto(key, &entry));
+  *shard_id = entry.shard_id();
+  *offset = entry.offset();
+  return Status::OK();
+}
+
 string BundleReader::DebugString() {
   // Format used below emulates that of TensorSliceReader::DebugString().
   string shape_str;
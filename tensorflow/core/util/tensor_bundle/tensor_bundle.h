@@ -63,6 +63,7 @@ limitations under the License.
 
 #include "tensorflow/core/protobuf/tensor_bundle.pb.h"
 
+#include <deque>
 #include <map>
 #include <string>
 #include <unordered_map>
@@ -77,6 +78,7 @@ limitations under the License.
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/file_system.h"
 #include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/util/tensor_bundle/naming.h"
 #include "tensorflow/core/util/tensor_slice_set.h"
@@ -112,9 +114,17 @@ class BundleWriter {
     // Alignment, in bytes, for tensor data.
     // Must be >= 1. The default size of 1 densely packs tensors.
     int data_alignment{1};
+    // Number of data shards written in parallel. When > 1, non-string
+    // tensors passed to Add() are distributed over background shard
+    // writers, each producing its own data file; the metadata table
+    // records the shard of every entry so BundleReader needs no changes.
+    // When left at the default of 1, the TF_BUNDLE_WRITER_NUM_SHARDS
+    // environment variable may raise it.
+    int num_shards{1};
   };
   BundleWriter(Env* env, StringPiece prefix,
                const Options& options = Options());
+  ~BundleWriter();
 
   // Adds the tensor "val" under key "key".
   // Across calls "key" must be unique but can be added in any order.
@@ -156,6 +166,33 @@ class BundleWriter {
   Status status() const { return status_; }
 
  private:
+  // One background data shard (see Options::num_shards). Shard 0 is the
+  // synchronous writer "out_" below; it also carries the string, variant
+  // and segment entries, whose sizes are only known while writing.
+  struct ShardWriteTask {
+    Tensor val;
+    BundleEntryProto* entry;
+    int64 pad_bytes;
+  };
+  struct ShardState {
+    string tmp_path;
+    std::unique_ptr<FileOutputBuffer> out;
+    // Total bytes assigned to this shard, including alignment padding.
+    // Only the thread calling Add() touches it.
+    int64 size = 0;
+    mutex mu;
+    condition_variable cv;
+    std::deque<ShardWriteTask> tasks GUARDED_BY(mu);
+    int64 pending_bytes GUARDED_BY(mu) = 0;
+    bool done GUARDED_BY(mu) = false;
+    Status status GUARDED_BY(mu);
+    std::unique_ptr<Thread> thread;
+  };
+
+  Status EnqueueShardWrite(const Tensor& val, BundleEntryProto* entry);
+  void ShardWriteLoop(ShardState* shard);
+  void JoinShardWriters();
+
   Env* const env_;  // Not owned.
   const Options options_;
   const string prefix_;
@@ -166,6 +203,9 @@ class BundleWriter {
   std::map<string, BundleEntryProto> entries_;
   Status status_;
   BundleEntryProto* entry_seg_;
+  int num_shards_ = 1;
+  // Background writers for shards 1 .. num_shards_ - 1.
+  std::vector<std::unique_ptr<ShardState>> shards_;
 
   TF_DISALLOW_COPY_AND_ASSIGN(BundleWriter);
 };
@@ -215,6 +255,13 @@ class BundleReader {
   Status LookupTensorShape(StringPiece key,
                            TensorShape* shape) TF_MUST_USE_RESULT;
 
+  // Looks up the data shard and byte offset at which the tensor keyed by
+  // "key" is stored.  Lets callers plan multi-tensor restores in file
+  // layout order instead of key order.
+  // REQUIRES: status().ok()
+  Status LookupEntryLocation(StringPiece key, int* shard_id,
+                             int64* offset) TF_MUST_USE_RESULT;
+
   // Looks up the tensor keyed by "key".  If "key" refers to a partitioned
   // tensor, attempts to look up the full contents using all stored slices.
   //
@@ -237,6 +284,11 @@ class BundleReader {
       StringPiece key, int64* size,
       std::unique_ptr<RandomAccessFile>* file, int64* offset);
 
+  // Like GetTensorInfo, but returns the path of the data file holding
+  // "key" for callers that map the value segment directly.
+  Status GetTensorFileInfo(
+      StringPiece key, int64* size, string* filename, int64* offset);
+
   // Looks up the tensor pointed to by the internal iterator.
   //
   // On error, "val" may contain nonsense data.
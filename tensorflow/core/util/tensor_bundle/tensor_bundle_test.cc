@@ -1113,6 +1113,39 @@ TEST_F(TensorBundleAlignmentTest, AlignmentTest) {
   }
 }
 
+TEST(TensorBundleTest, ShardedWriter) {
+  {
+    BundleWriter::Options opts;
+    opts.num_shards = 4;
+    BundleWriter writer(Env::Default(), Prefix("sharded"), opts);
+    TF_EXPECT_OK(writer.Add("foo_003", Constant_2x3<float>(3)));
+    TF_EXPECT_OK(writer.Add("foo_000", Constant_2x3<float>(0)));
+    TF_EXPECT_OK(writer.Add("foo_002", Constant_2x3<float>(2)));
+    TF_EXPECT_OK(writer.Add("foo_001", Constant_2x3<float>(1)));
+    TF_EXPECT_OK(writer.Add("big", Constant<float>(7., TensorShape({64, 64}))));
+    // String tensors stay on the synchronous shard 0.
+    TF_EXPECT_OK(
+        writer.Add("strs", Constant<tstring>("abc", TensorShape({2}))));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  // Every data shard must exist, even if some received no tensors.
+  for (int i = 0; i < 4; ++i) {
+    TF_EXPECT_OK(
+        Env::Default()->FileExists(DataFilename(Prefix("sharded"), i, 4)));
+  }
+  {
+    BundleReader reader(Env::Default(), Prefix("sharded"));
+    TF_ASSERT_OK(reader.status());
+    Expect<float>(&reader, "foo_000", Constant_2x3<float>(0));
+    Expect<float>(&reader, "foo_001", Constant_2x3<float>(1));
+    Expect<float>(&reader, "foo_002", Constant_2x3<float>(2));
+    Expect<float>(&reader, "foo_003", Constant_2x3<float>(3));
+    Expect<float>(&reader, "big", Constant<float>(7., TensorShape({64, 64})));
+    Expect<tstring>(&reader, "strs",
+                    Constant<tstring>("abc", TensorShape({2})));
+  }
+}
+
 static void BM_BundleAlignmentByteOff(int iters, int alignment,
                                       int tensor_size) {
   testing::StopTiming();
@@ -91,7 +91,8 @@ class _ParquetDataset(dataset_ops.DatasetSource):  # pylint: disable=abstract-me
       self, filename, batch_size, fields,
       partition_count=1,
       partition_index=0,
-      drop_remainder=False):
+      drop_remainder=False,
+      read_ahead=0):
     """Create a `ParquetDataset`.
 
     Args:
@@ -102,6 +103,8 @@ class _ParquetDataset(dataset_ops.DatasetSource):  # pylint: disable=abstract-me
       partition_index: (Optional.) Index of row group partitions.
       drop_remainder: (Optional.) If True, only keep batches with exactly
         `batch_size` samples.
+      read_ahead: (Optional.) Number of batches to decode ahead on a
+        background thread. Defaults to 0, which decodes synchronously.
     """
     self._filename = ops.convert_to_tensor(
       filename, dtype=dtypes.string, name='filename')
@@ -121,6 +124,7 @@ class _ParquetDataset(dataset_ops.DatasetSource):  # pylint: disable=abstract-me
     self._partition_count = partition_count
     self._partition_index = partition_index
     self._drop_remainder = drop_remainder
+    self._read_ahead = read_ahead
 
     variant_tensor = gen_parquet_ops.parquet_tabular_dataset_v1(
       self._filename,
@@ -130,7 +134,8 @@ class _ParquetDataset(dataset_ops.DatasetSource):  # pylint: disable=abstract-me
       field_ragged_ranks=self._field_ragged_ranks,
       partition_count=self._partition_count,
       partition_index=self._partition_index,
-      drop_remainder=self._drop_remainder)
+      drop_remainder=self._drop_remainder,
+      read_ahead=self._read_ahead)
     super().__init__(variant_tensor)
 
   @property
@@ -165,7 +170,8 @@ class ParquetDataset(dataset_ops.DatasetV2):  # pylint: disable=abstract-method
       partition_index=0,
       drop_remainder=False,
       num_parallel_reads=None,
-      num_sequential_reads=1):
+      num_sequential_reads=1,
+      read_ahead=0):
     """Create a `ParquetDataset`.
 
     Args:
@@ -182,11 +188,15 @@ class ParquetDataset(dataset_ops.DatasetV2):  # pylint: disable=abstract-method
         sequentially.
       num_sequential_reads: (Optional.) A `tf.int64` scalar representing the
         number of batches to read in sequential. Defaults to 1.
+      read_ahead: (Optional.) Number of batches to decode ahead on a
+        background thread per file. Defaults to 0, which decodes
+        synchronously.
     """
     filenames, self._fields = parquet_filenames_and_fields(filenames, fields)
     self._partition_count = partition_count
     self._partition_index = partition_index
     self._drop_remainder = drop_remainder
+    self._read_ahead = read_ahead
 
     def _create_dataset(f):
       f = ops.convert_to_tensor(f, dtypes.string, name='filename')
@@ -195,7 +205,8 @@ class ParquetDataset(dataset_ops.DatasetV2):  # pylint: disable=abstract-method
         fields=self._fields,
         partition_count=self._partition_count,
         partition_index=self._partition_index,
-        drop_remainder=self._drop_remainder)
+        drop_remainder=self._drop_remainder,
+        read_ahead=self._read_ahead)
     self._impl = self._build_dataset(
       _create_dataset, filenames,
       num_parallel_reads=num_parallel_reads,
@@ -251,7 +262,8 @@ def read_parquet(
     partition_index=0,
     drop_remainder=False,
     num_parallel_reads=None,
-    num_sequential_reads=1):
+    num_sequential_reads=1,
+    read_ahead=0):
   """Create a `ParquetDataset` from filenames dataset.
 
     Args:
@@ -266,6 +278,9 @@ def read_parquet(
         sequentially.
       num_sequential_reads: (Optional.) A `tf.int64` scalar representing the
         number of batches to read in sequential. Defaults to 1.
+      read_ahead: (Optional.) Number of batches to decode ahead on a
+        background thread per file. Defaults to 0, which decodes
+        synchronously.
     """
   def _apply_fn(filenames):
     return ParquetDataset(
@@ -276,6 +291,7 @@ def read_parquet(
       partition_index=partition_index,
       drop_remainder=drop_remainder,
       num_parallel_reads=num_parallel_reads,
-      num_sequential_reads=num_sequential_reads)
+      num_sequential_reads=num_sequential_reads,
+      read_ahead=read_ahead)
 
   return _apply_fn
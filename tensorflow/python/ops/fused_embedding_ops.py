@@ -12,6 +12,7 @@ from tensorflow.python.framework import sparse_tensor
 from tensorflow.python.ops import gen_fused_embedding_ops
 from tensorflow.python.ops.kv_variable_ops import EmbeddingVariable
 from tensorflow.python.ops.gen_fused_embedding_ops import fused_embedding_sparse_pre_look_up
+from tensorflow.python.ops.gen_fused_embedding_ops import fused_embedding_sparse_pre_look_up_unique
 from tensorflow.python.ops.gen_fused_embedding_ops import fused_embedding_sparse_post_look_up
 from tensorflow.python.ops.gen_fused_embedding_ops import fused_embedding_sparse_post_look_up_grad
 from tensorflow.python.util.tf_export import tf_export
@@ -27,7 +28,9 @@ def fused_embedding_lookup_sparse(params,
                                   max_norm=None,
                                   default_id=None,
                                   prune_invalid_ids=False,
-                                  blocknums=None):
+                                  do_unique=False,
+                                  blocknums=None,
+                                  output_transposed=False):
   if sparse_weights is not None:
     raise ValueError("sparse_weights is not supported yet")
 
@@ -54,16 +57,33 @@ def fused_embedding_lookup_sparse(params,
 
   with ops.name_scope(name, "fused_embedding_lookup_sparse",
                       params + [sp_ids]) as name:
-    partitioned_values, partitioned_indices, \
-      row_empty_and_invalid_flags = fused_embedding_sparse_pre_look_up(
-          partition_shapes=partition_shapes,
-          sp_values=sp_ids.values,
-          sp_indices=sp_ids.indices,
-          sp_dense_shape=sp_ids.dense_shape,
-          fill_empty_row=True,
-          default_id=default_id,
-          prune_invalid_id=bool(prune_invalid_ids)
-      )
+    if do_unique:
+      # Device-side dedup: the pre op emits each distinct id once plus an
+      # occurrence -> unique-row inverse mapping, so the heavy gather below
+      # reads every embedding row once and a cheap second gather expands
+      # it. The whole sort/unique/inverse pipeline stays on the GPU.
+      partitioned_values, partitioned_indices, \
+        row_empty_and_invalid_flags, \
+        partitioned_inverse = fused_embedding_sparse_pre_look_up_unique(
+            partition_shapes=partition_shapes,
+            sp_values=sp_ids.values,
+            sp_indices=sp_ids.indices,
+            sp_dense_shape=sp_ids.dense_shape,
+            fill_empty_row=True,
+            default_id=default_id,
+            prune_invalid_id=bool(prune_invalid_ids)
+        )
+    else:
+      partitioned_values, partitioned_indices, \
+        row_empty_and_invalid_flags = fused_embedding_sparse_pre_look_up(
+            partition_shapes=partition_shapes,
+            sp_values=sp_ids.values,
+            sp_indices=sp_ids.indices,
+            sp_dense_shape=sp_ids.dense_shape,
+            fill_empty_row=True,
+            default_id=default_id,
+            prune_invalid_id=bool(prune_invalid_ids)
+        )
 
     # fixme(marvin): ple align the meaning between pre & post op.
     default_id = 0 if default_id is None else default_id
@@ -74,13 +94,19 @@ def fused_embedding_lookup_sparse(params,
       sub_partition_values = partitioned_values[i]
       with ops.colocate_with(param):
         shard = array_ops.gather(param, sub_partition_values)
+        if do_unique:
+          shard = array_ops.gather(shard, partitioned_inverse[i])
         emb_shards.append(shard)
     emb_vectors, _ = fused_embedding_sparse_post_look_up(
       emb_shards=emb_shards, partitioned_indices=partitioned_indices,
       sp_dense_shape=sp_ids.dense_shape,
       row_empty_and_invalid_flags=row_empty_and_invalid_flags,
       partitioned_values=partitioned_values,
-      combiner=combiner, max_norm=max_norm, default_id=default_id
+      combiner=combiner, max_norm=max_norm, default_id=default_id,
+      # With output_transposed=True the combined block comes out as
+      # [emb_vec_size, batch_size], ready for a dense tower that stacks
+      # feature blocks along axis 0, with no transpose pass.
+      output_transposed=output_transposed
     )
   return emb_vectors
 
@@ -98,6 +124,7 @@ def fused_embedding_sparse_post_look_up_grad(op, top_grad_emb_vec, _):
     partitioned_indices=partitioned_indices,
     feature_nums=feature_nums, row_empty_and_invalid_flags=row_empty_and_invalid_flags,
     combiner=op.get_attr("combiner"), max_norm=op.get_attr("max_norm"),
-    default_id=op.get_attr("default_id")
+    default_id=op.get_attr("default_id"),
+    output_transposed=op.get_attr("output_transposed")
   )
   return grad_shards + [None for _ in range(0, 2 * num_partitions + 2)]
@@ -127,6 +127,52 @@ def all_max(tensors):
   return _apply_all_reduce('max', tensors)
 
 
+def all_to_all(tensors):
+  """Returns a list of tensors with the all-to-all exchange across `tensors`.
+
+  Each input tensor is split into `len(tensors)` equal chunks along its first
+  dimension; chunk `i` of tensor `j` is sent to device `i`, and output `i` is
+  the concatenation of the chunks received from every device.  This is the
+  single-op exchange used to route lookup keys and embedding values between
+  the shards of an embedding table that is hash-partitioned across GPUs.
+
+  The computation is done with an all-to-all operation, so if only some of the
+  returned tensors are evaluated then the computation will hang.
+
+  Args:
+    tensors: The input tensors to exchange; must be assigned to GPU devices,
+      and the first dimension of each must be divisible by `len(tensors)`.
+
+  Returns:
+    List of tensors, each with the exchanged data, where tensor i has the same
+    device as `tensors[i]`.
+  """
+  if not tensors:
+    raise ValueError('Must pass >0 tensors to all-to-all operations')
+
+  shared_name = _get_shared_name()
+
+  def _all_to_all():
+    """Call nccl all-to-all."""
+    res = []
+    for t in tensors:
+      _check_device(t)
+      with ops.device(t.device):
+        res.append(
+            gen_nccl_ops.nccl_all_to_all(
+                input=t,
+                num_devices=len(tensors),
+                shared_name=shared_name))
+    return res
+
+  if context.executing_eagerly():
+    # Nccl ops will block unless they are executed concurrently such as in a
+    # graph or a defun.
+    return def_function.function(_all_to_all)()
+  else:
+    return _all_to_all()
+
+
 def reduce_sum(tensors):
   """Returns a tensor with the reduce sum across `tensors`.
 
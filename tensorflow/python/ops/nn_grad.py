@@ -28,6 +28,8 @@ from tensorflow.python.ops import gen_nn_ops
 from tensorflow.python.ops import math_ops
 from tensorflow.python.ops import nn_ops
 from tensorflow.python.ops import gen_fused_l2_normalize_ops
+from tensorflow.python.ops import gen_fused_interaction_ops
+from tensorflow.python.ops import gen_fused_attention_ops
 
 
 @ops.RegisterGradient("Conv2DBackpropInput")
@@ -1181,6 +1183,28 @@ def _FusedL2NormalizeGrad(op, grad):
   return gen_fused_l2_normalize_ops.fused_l2_normalize_grad(
     grad, x, axis=axis, epsilon=epsilon)
 
+@ops.RegisterGradient("FusedInteractionDot")
+def _FusedInteractionDotGrad(op, grad):
+  """Return the gradients for FusedInteractionDot"""
+
+  features = op.inputs[0]
+
+  return gen_fused_interaction_ops.fused_interaction_dot_grad(grad, features)
+
+@ops.RegisterGradient("FusedAttentionPooling")
+def _FusedAttentionPoolingGrad(op, pooled_grad, alphas_grad):
+  """Return the gradients for FusedAttentionPooling"""
+
+  query = op.inputs[0]
+  keys = op.inputs[1]
+  seq_len = op.inputs[2]
+  alphas = op.outputs[1]
+  scale = op.get_attr("scale")
+
+  query_grad, keys_grad = gen_fused_attention_ops.fused_attention_pooling_grad(
+    pooled_grad, query, keys, seq_len, alphas, scale=scale)
+  return [query_grad, keys_grad, None]
+
 @ops.RegisterGradient("FusedLayerNorm")
 def _FusedLayerNormalizeGrad(op, grad, *args):
   """Return the gradients for FusedLayerNorm"""
@@ -36,6 +36,8 @@ from tensorflow.python.ops import linalg_ops
 from tensorflow.python.ops import math_ops
 from tensorflow.python.ops import nn_ops
 from tensorflow.python.ops import gen_fused_l2_normalize_ops
+from tensorflow.python.ops import gen_fused_interaction_ops
+from tensorflow.python.ops import gen_fused_attention_ops
 from tensorflow.python.ops import gen_sparse_ops
 from tensorflow.python.ops import init_ops
 from tensorflow.python.ops import variables
@@ -673,9 +675,64 @@ def fused_l2_normalize(x, epsilon=1e-12, name=None):
   """
   with ops.name_scope(name, "fused_l2_normalize", [x]) as name:
     x = ops.convert_to_tensor(x, name="x")
-    return gen_fused_l2_normalize_ops.fused_l2_normalize(x, 
+    return gen_fused_l2_normalize_ops.fused_l2_normalize(x,
               epsilon=epsilon, name=name)
 
+def fused_interaction_dot(features, name=None):
+  """Computes packed pairwise dot-product interactions.
+
+  For `features` of shape `[batch, num_features, dim]`, returns the strict
+  lower triangle of `tf.matmul(features, features, transpose_b=True)` packed
+  row by row into shape `[batch, num_features * (num_features - 1) / 2]`:
+
+      output[b, i * (i - 1) // 2 + j] = dot(features[b, i], features[b, j])
+
+  for `j < i`. This matches masking the strict lower triangle of the full
+  interaction matrix, without materializing the
+  `num_features x num_features` intermediate.
+
+  Args:
+    features: A 3-D float32 `Tensor` of shape `[batch, num_features, dim]`.
+    name: A name for this operation (optional).
+
+  Returns:
+    A 2-D `Tensor` of shape `[batch, num_features * (num_features - 1) / 2]`.
+  """
+  with ops.name_scope(name, "fused_interaction_dot", [features]) as name:
+    features = ops.convert_to_tensor(features, name="features")
+    return gen_fused_interaction_ops.fused_interaction_dot(features, name=name)
+
+def fused_attention_pooling(query, keys, seq_len, scale=1.0, name=None):
+  """Pools a key sequence with dot-product attention in one pass.
+
+  For `query` of shape `[batch, dim]`, `keys` of shape `[batch, seq, dim]`
+  and `seq_len` of shape `[batch]`, computes
+
+      scores[b, t] = scale * dot(query[b], keys[b, t])
+
+  for `t < seq_len[b]`, a softmax over those valid steps (padded steps get
+  zero weight, matching a mask of `-inf` paddings), and returns the weighted
+  sum of the keys. Rows with `seq_len[b] <= 0` pool to zero.
+
+  Args:
+    query: A 2-D float32 `Tensor` of shape `[batch, dim]`.
+    keys: A 3-D float32 `Tensor` of shape `[batch, seq, dim]`.
+    seq_len: A 1-D int32 or int64 `Tensor` with the valid length per row.
+    scale: Scalar multiplier applied to the scores before the softmax.
+    name: A name for this operation (optional).
+
+  Returns:
+    A 2-D `Tensor` of shape `[batch, dim]` with the pooled vectors.
+  """
+  with ops.name_scope(name, "fused_attention_pooling",
+                      [query, keys, seq_len]) as name:
+    query = ops.convert_to_tensor(query, name="query")
+    keys = ops.convert_to_tensor(keys, name="keys")
+    seq_len = ops.convert_to_tensor(seq_len, name="seq_len")
+    pooled, _ = gen_fused_attention_ops.fused_attention_pooling(
+        query, keys, seq_len, scale=scale, name=name)
+    return pooled
+
 @tf_export("nn.fused_layer_normalize")
 def fused_layer_normalize(
       x,
@@ -467,6 +467,16 @@ class IncrementalSaver(Saver):
             {self._builder._incremental_filename_tensor.name: checkpoint_file})
 
         model_checkpoint_path = compat.as_str(model_checkpoint_path)
+        # Record which full checkpoint this delta applies to, so offline
+        # tooling (e.g. incr_ckpt_merge) can pair base and delta without
+        # guessing from file mtimes.
+        full_ckpt_dir = save_path_parent
+        if os.path.basename(save_path_parent) == SUB_INCR_CKPT_DIR:
+          full_ckpt_dir = os.path.dirname(save_path_parent)
+        full_ckpt_state = get_checkpoint_state(full_ckpt_dir)
+        if full_ckpt_state and full_ckpt_state.model_checkpoint_path:
+          with gfile.GFile(model_checkpoint_path + ".base", "w") as f:
+            f.write(full_ckpt_state.model_checkpoint_path)
         if write_state:
           self._RecordLastIncrCheckpoint(model_checkpoint_path)
           checkpoint_management.update_checkpoint_state_internal(
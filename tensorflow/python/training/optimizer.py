@@ -42,6 +42,7 @@ from tensorflow.python.ops import resource_variable_ops
 from tensorflow.python.ops import state_ops
 from tensorflow.python.ops import variable_scope
 from tensorflow.python.ops import variables
+from tensorflow.python.training import gen_training_ali_ops
 from tensorflow.python.training import slot_creator
 from tensorflow.python.training.experimental import loss_scale as loss_scale_module
 from tensorflow.python.training.tracking import base as trackable
@@ -77,6 +78,13 @@ def _deduplicate_indexed_slices(values, indices):
     de-duplicated version of `indices` and `summed_values` contains the sum of
     `values` slices associated with each unique index.
   """
+  if os.environ.get("DEEPREC_FUSED_DEDUP_INDEXED_SLICES", "0") == "1":
+    # Single-pass sort + segment-sum kernel; combines duplicate keys on the
+    # worker before the gradient is pushed to the parameter server. Returns
+    # indices in ascending order instead of first-occurrence order, which
+    # the sparse apply ops do not care about.
+    return gen_training_ali_ops.deduplicate_indexed_slices(
+        values=values, indices=indices)
   unique_indices, new_index_positions = array_ops.unique(indices)
   summed_values = math_ops.unsorted_segment_sum(
       values, new_index_positions,
@@ -0,0 +1,131 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/stream_executor/gpu/gpu_graph_launch_batcher.h"
+
+#include "tensorflow/core/util/env_var.h"
+#include "tensorflow/stream_executor/gpu/gpu_executor.h"
+#include "tensorflow/stream_executor/lib/status_macros.h"
+#include "tensorflow/stream_executor/platform/logging.h"
+#include "tensorflow/stream_executor/stream.h"
+#include "tensorflow/stream_executor/stream_executor_pimpl.h"
+
+namespace stream_executor {
+namespace gpu {
+
+namespace {
+
+int64 DefaultGraphLaunchCacheSize() {
+  int64 cache_size = 0;
+  SE_CHECK_OK(tensorflow::ReadInt64FromEnvVar(
+      "TF_GPU_GRAPH_LAUNCH_CACHE_SIZE", /*default_val=*/16, &cache_size));
+  return cache_size;
+}
+
+}  // namespace
+
+GpuGraphLaunchBatcher::GpuGraphLaunchBatcher()
+    : GpuGraphLaunchBatcher(DefaultGraphLaunchCacheSize()) {}
+
+GpuGraphLaunchBatcher::GpuGraphLaunchBatcher(int64 max_cache_size)
+    : max_cache_size_(max_cache_size) {}
+
+GpuGraphLaunchBatcher::~GpuGraphLaunchBatcher() {
+  absl::MutexLock lock(&mu_);
+  for (Entry& entry : entries_) {
+    executor_->DestroyExecutableGraph(gpu_context_, entry.exec_graph);
+  }
+}
+
+bool GpuGraphLaunchBatcher::TryLaunch(Stream* stream, uint64 signature) {
+  void* exec_graph = nullptr;
+  {
+    absl::MutexLock lock(&mu_);
+    auto it = signature_to_entry_.find(signature);
+    if (it == signature_to_entry_.end()) {
+      return false;
+    }
+    // Move the entry to the front of the LRU list.
+    entries_.splice(entries_.begin(), entries_, it->second);
+    exec_graph = it->second->exec_graph;
+  }
+  VLOG(2) << "Replaying captured graph " << exec_graph << " for signature "
+          << signature;
+  stream->ThenLaunchGraph(exec_graph);
+  return true;
+}
+
+port::Status GpuGraphLaunchBatcher::BeginCapture(Stream* stream) {
+  return stream->parent()->BeginGraphCapture(stream);
+}
+
+port::Status GpuGraphLaunchBatcher::EndCaptureAndLaunch(Stream* capture_stream,
+                                                        Stream* launch_stream,
+                                                        uint64 signature) {
+  StreamExecutor* executor = capture_stream->parent();
+  void* graph = nullptr;
+  SE_ASSIGN_OR_RETURN(graph, executor->EndGraphCapture(capture_stream, graph));
+
+  void* gpu_context =
+      static_cast<GpuExecutor*>(executor->implementation())->gpu_context();
+  void* exec_graph = nullptr;
+  auto instantiated = executor->InstantiateGraph(graph, exec_graph);
+  if (!instantiated.ok()) {
+    executor->DestroyGraph(gpu_context, graph);
+    return instantiated.status();
+  }
+  exec_graph = instantiated.ValueOrDie();
+  // The template graph is only needed to instantiate the executable graph.
+  executor->DestroyGraph(gpu_context, graph);
+
+  void* evicted = nullptr;
+  {
+    absl::MutexLock lock(&mu_);
+    executor_ = executor;
+    gpu_context_ = gpu_context;
+    auto it = signature_to_entry_.find(signature);
+    if (it != signature_to_entry_.end()) {
+      // Raced with another capture of the same signature; replace the old
+      // executable graph.
+      evicted = it->second->exec_graph;
+      it->second->exec_graph = exec_graph;
+      entries_.splice(entries_.begin(), entries_, it->second);
+    } else {
+      if (static_cast<int64>(entries_.size()) >= max_cache_size_) {
+        Entry& lru = entries_.back();
+        VLOG(1) << "Evicting captured graph for signature " << lru.signature;
+        evicted = lru.exec_graph;
+        signature_to_entry_.erase(lru.signature);
+        entries_.pop_back();
+      }
+      entries_.push_front(Entry{signature, exec_graph});
+      signature_to_entry_[signature] = entries_.begin();
+    }
+  }
+  if (evicted != nullptr) {
+    executor->DestroyExecutableGraph(gpu_context, evicted);
+  }
+
+  launch_stream->ThenLaunchGraph(exec_graph);
+  return port::Status::OK();
+}
+
+size_t GpuGraphLaunchBatcher::cache_size() const {
+  absl::MutexLock lock(&mu_);
+  return entries_.size();
+}
+
+}  // namespace gpu
+}  // namespace stream_executor
@@ -0,0 +1,113 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_STREAM_EXECUTOR_GPU_GPU_GRAPH_LAUNCH_BATCHER_H_
+#define TENSORFLOW_STREAM_EXECUTOR_GPU_GPU_GRAPH_LAUNCH_BATCHER_H_
+
+#include <list>
+#include <unordered_map>
+
+#include "absl/synchronization/mutex.h"
+#include "tensorflow/stream_executor/lib/status.h"
+#include "tensorflow/stream_executor/platform/port.h"
+#include "tensorflow/stream_executor/platform/thread_annotations.h"
+
+namespace stream_executor {
+
+class Stream;
+class StreamExecutor;
+
+namespace gpu {
+
+// Batches sequences of small kernel launches into a single executable GPU
+// task graph (a CUDA graph on the CUDA platform), keyed by a caller-supplied
+// signature. Replaying a captured batch costs one driver call instead of one
+// per kernel, which matters for graphs that launch many sub-10us kernels.
+//
+// The caller owns the signature: it must hash everything that determines the
+// captured work, typically the shapes and buffer addresses fed to the
+// launches (compare BufferAllocations::Key in the XLA GPU graph-capture
+// path, which keys on argument addresses). A stale signature replays stale
+// pointers, so over-hashing is always safer than under-hashing.
+//
+// Usage per batch of launches:
+//
+//   if (!batcher.TryLaunch(stream, signature)) {
+//     SE_RETURN_IF_ERROR(batcher.BeginCapture(capture_stream));
+//     ... enqueue the kernel launches on capture_stream ...
+//     SE_RETURN_IF_ERROR(
+//         batcher.EndCaptureAndLaunch(capture_stream, stream, signature));
+//   }
+//
+// Captured work must not synchronize with the host (no BlockHostUntilDone,
+// host callbacks, or pageable memcpy) -- the same restriction the XLA thunk
+// capture path enforces.
+//
+// Cached executable graphs are evicted LRU once the cache holds
+// `max_cache_size` entries. All methods are thread-safe, but at most one
+// capture may be in flight per batcher.
+class GpuGraphLaunchBatcher {
+ public:
+  // Reads the default cache capacity from
+  // TF_GPU_GRAPH_LAUNCH_CACHE_SIZE (default 16).
+  GpuGraphLaunchBatcher();
+  explicit GpuGraphLaunchBatcher(int64 max_cache_size);
+
+  // Destroys all cached executable graphs.
+  ~GpuGraphLaunchBatcher();
+
+  GpuGraphLaunchBatcher(const GpuGraphLaunchBatcher&) = delete;
+  GpuGraphLaunchBatcher& operator=(const GpuGraphLaunchBatcher&) = delete;
+
+  // If a batch with `signature` was captured before, enqueues its executable
+  // graph on `stream` and returns true. Otherwise returns false and the
+  // caller should capture the batch.
+  bool TryLaunch(Stream* stream, uint64 signature);
+
+  // Starts capturing launches enqueued on `stream`. Use a private stream so
+  // work from other threads does not leak into the capture.
+  port::Status BeginCapture(Stream* stream);
+
+  // Ends the capture started on `capture_stream`, instantiates the captured
+  // graph, caches the executable graph under `signature` (evicting the least
+  // recently used entry if full), and enqueues it on `launch_stream`.
+  port::Status EndCaptureAndLaunch(Stream* capture_stream,
+                                   Stream* launch_stream,
+                                   uint64 signature);
+
+  size_t cache_size() const;
+
+ private:
+  struct Entry {
+    uint64 signature;
+    void* exec_graph;
+  };
+
+  const int64 max_cache_size_;
+
+  mutable absl::Mutex mu_;
+  // Most recently used entries at the front.
+  std::list<Entry> entries_ GUARDED_BY(mu_);
+  std::unordered_map<uint64, std::list<Entry>::iterator>
+      signature_to_entry_ GUARDED_BY(mu_);
+  // Set on first capture; used to destroy cached graphs.
+  StreamExecutor* executor_ GUARDED_BY(mu_) = nullptr;
+  void* gpu_context_ GUARDED_BY(mu_) = nullptr;
+};
+
+}  // namespace gpu
+}  // namespace stream_executor
+
+#endif  // TENSORFLOW_STREAM_EXECUTOR_GPU_GPU_GRAPH_LAUNCH_BATCHER_H_
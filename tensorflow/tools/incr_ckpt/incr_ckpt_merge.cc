@@ -0,0 +1,406 @@
+/* Copyright 2022 The DeepRec Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Merges an incremental checkpoint produced by IncrSave onto the full
+// checkpoint it was taken against, producing a new full checkpoint.
+//
+// The delta bundle stores, per sparse variable <name>:
+//   <name>-sparse_incr_keys / -sparse_incr_values / -sparse_incr_versions /
+//   <name>-sparse_incr_freqs    updated rows, sorted by key per partition
+//   <name>-sparse_incr_tombstones  keys evicted since the base save
+// plus full copies of any dense tensors. The base checkpoint prefix is
+// recorded next to the delta in a "<prefix>.base" sidecar file.
+//
+// Usage:
+//   incr_ckpt_merge --incr_prefix=.../incr-1234 \
+//       --output_prefix=.../merged.ckpt-1234 [--base_prefix=.../model.ckpt-1000]
+
+#include <algorithm>
+#include <cstring>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/init_main.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/command_line_flags.h"
+#include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
+
+namespace tensorflow {
+namespace {
+
+// Must match kSavedPartitionNum in kv_variable_ops.h: full EV checkpoints
+// are always written as this many logical partitions.
+const int kSavedPartitionNum = 1000;
+
+const char* const kIncrKeysSuffix = "-sparse_incr_keys";
+const char* const kIncrValuesSuffix = "-sparse_incr_values";
+const char* const kIncrVersionsSuffix = "-sparse_incr_versions";
+const char* const kIncrFreqsSuffix = "-sparse_incr_freqs";
+const char* const kIncrTombstonesSuffix = "-sparse_incr_tombstones";
+const char* const kIncrPartOffsetSuffix = "-incr_partition_offset";
+
+Status ReadTensor(BundleReader* reader, const string& key, Tensor* out) {
+  DataType dtype;
+  TensorShape shape;
+  TF_RETURN_IF_ERROR(reader->LookupDtypeAndShape(key, &dtype, &shape));
+  *out = Tensor(dtype, shape);
+  return reader->Lookup(key, out);
+}
+
+// Reads "key" if present; leaves "out" as an empty 1-D tensor of "dtype"
+// otherwise. Older deltas lack tombstones, and variables saved without
+// steps_to_live / filters have zero-length version and freq lists.
+Status ReadTensorOrEmpty(BundleReader* reader, const string& key,
+                         DataType dtype, Tensor* out) {
+  if (!reader->Contains(key)) {
+    *out = Tensor(dtype, TensorShape({0}));
+    return Status::OK();
+  }
+  return ReadTensor(reader, key, out);
+}
+
+struct MergedRow {
+  // Row index into the source values tensor; rows_from_delta tells which
+  // tensor that is.
+  int64 row;
+  bool from_delta;
+  int64 version;
+  int64 freq;
+  bool has_version;
+  bool has_freq;
+};
+
+template <typename K>
+Status MergeSparseVariable(const string& name, BundleReader* base,
+                           BundleReader* delta, BundleWriter* writer) {
+  Tensor base_keys_t, base_values_t, base_versions_t, base_freqs_t;
+  TF_RETURN_IF_ERROR(ReadTensor(base, name + "-keys", &base_keys_t));
+  TF_RETURN_IF_ERROR(ReadTensor(base, name + "-values", &base_values_t));
+  TF_RETURN_IF_ERROR(ReadTensorOrEmpty(base, name + "-versions", DT_INT64,
+                                       &base_versions_t));
+  TF_RETURN_IF_ERROR(
+      ReadTensorOrEmpty(base, name + "-freqs", DT_INT64, &base_freqs_t));
+
+  Tensor delta_keys_t, delta_values_t, delta_versions_t, delta_freqs_t;
+  Tensor tombstones_t;
+  TF_RETURN_IF_ERROR(ReadTensor(delta, name + kIncrKeysSuffix, &delta_keys_t));
+  TF_RETURN_IF_ERROR(
+      ReadTensor(delta, name + kIncrValuesSuffix, &delta_values_t));
+  TF_RETURN_IF_ERROR(ReadTensorOrEmpty(delta, name + kIncrVersionsSuffix,
+                                       DT_INT64, &delta_versions_t));
+  TF_RETURN_IF_ERROR(ReadTensorOrEmpty(delta, name + kIncrFreqsSuffix,
+                                       DT_INT64, &delta_freqs_t));
+  TF_RETURN_IF_ERROR(ReadTensorOrEmpty(delta, name + kIncrTombstonesSuffix,
+                                       base_keys_t.dtype(), &tombstones_t));
+
+  if (base_values_t.dims() != 2 || delta_values_t.dims() != 2 ||
+      base_values_t.dim_size(1) != delta_values_t.dim_size(1)) {
+    return errors::InvalidArgument(
+        name, ": base and delta value shapes are incompatible: ",
+        base_values_t.shape().DebugString(), " vs ",
+        delta_values_t.shape().DebugString());
+  }
+
+  const int64 dim = base_values_t.dim_size(1);
+  auto base_keys = base_keys_t.flat<K>();
+  auto delta_keys = delta_keys_t.flat<K>();
+  auto tombstones = tombstones_t.flat<K>();
+  const bool base_has_versions = base_versions_t.NumElements() > 0;
+  const bool base_has_freqs = base_freqs_t.NumElements() > 0;
+  const bool delta_has_versions = delta_versions_t.NumElements() > 0;
+  const bool delta_has_freqs = delta_freqs_t.NumElements() > 0;
+
+  std::unordered_map<K, MergedRow> merged;
+  merged.reserve(base_keys.size() + delta_keys.size());
+  for (int64 i = 0; i < base_keys.size(); ++i) {
+    MergedRow row = {i, false, 0, 0, base_has_versions, base_has_freqs};
+    if (base_has_versions) row.version = base_versions_t.flat<int64>()(i);
+    if (base_has_freqs) row.freq = base_freqs_t.flat<int64>()(i);
+    merged[base_keys(i)] = row;
+  }
+  for (int64 i = 0; i < delta_keys.size(); ++i) {
+    MergedRow row = {i, true, 0, 0, delta_has_versions, delta_has_freqs};
+    if (delta_has_versions) row.version = delta_versions_t.flat<int64>()(i);
+    if (delta_has_freqs) row.freq = delta_freqs_t.flat<int64>()(i);
+    merged[delta_keys(i)] = row;
+  }
+  for (int64 i = 0; i < tombstones.size(); ++i) {
+    merged.erase(tombstones(i));
+  }
+
+  // Re-partition the merged key set the same way DumpEmbeddingValues
+  // does, so the result restores through the unchanged full-restore path.
+  std::vector<std::vector<K>> key_parts(kSavedPartitionNum);
+  for (const auto& kv : merged) {
+    int64 partid = kv.first % kSavedPartitionNum;
+    if (partid < 0) continue;
+    key_parts[partid].push_back(kv.first);
+  }
+  int64 num_keys = 0;
+  Tensor part_offset_t(DT_INT32, TensorShape({kSavedPartitionNum + 1}));
+  auto part_offset = part_offset_t.flat<int32>();
+  part_offset(0) = 0;
+  for (int partid = 0; partid < kSavedPartitionNum; ++partid) {
+    std::sort(key_parts[partid].begin(), key_parts[partid].end());
+    num_keys += key_parts[partid].size();
+    part_offset(partid + 1) = part_offset(partid) + key_parts[partid].size();
+  }
+
+  Tensor out_keys_t(base_keys_t.dtype(), TensorShape({num_keys}));
+  Tensor out_values_t(base_values_t.dtype(), TensorShape({num_keys, dim}));
+  const bool out_has_versions = base_has_versions || delta_has_versions;
+  const bool out_has_freqs = base_has_freqs || delta_has_freqs;
+  Tensor out_versions_t(DT_INT64,
+                        TensorShape({out_has_versions ? num_keys : 0}));
+  Tensor out_freqs_t(DT_INT64, TensorShape({out_has_freqs ? num_keys : 0}));
+
+  auto out_keys = out_keys_t.flat<K>();
+  const float* base_values = base_values_t.flat<float>().data();
+  const float* delta_values = delta_values_t.flat<float>().data();
+  float* out_values = out_values_t.flat<float>().data();
+  int64 out_row = 0;
+  for (int partid = 0; partid < kSavedPartitionNum; ++partid) {
+    for (const K& key : key_parts[partid]) {
+      const MergedRow& row = merged[key];
+      out_keys(out_row) = key;
+      const float* src =
+          (row.from_delta ? delta_values : base_values) + row.row * dim;
+      memcpy(out_values + out_row * dim, src, dim * sizeof(float));
+      if (out_has_versions) {
+        out_versions_t.flat<int64>()(out_row) = row.has_version ? row.version
+                                                                : 0;
+      }
+      if (out_has_freqs) {
+        out_freqs_t.flat<int64>()(out_row) = row.has_freq ? row.freq : 0;
+      }
+      ++out_row;
+    }
+  }
+
+  TF_RETURN_IF_ERROR(writer->Add(name + "-partition_offset", part_offset_t));
+  TF_RETURN_IF_ERROR(writer->Add(name + "-keys", out_keys_t));
+  TF_RETURN_IF_ERROR(writer->Add(name + "-values", out_values_t));
+  TF_RETURN_IF_ERROR(writer->Add(name + "-versions", out_versions_t));
+  TF_RETURN_IF_ERROR(writer->Add(name + "-freqs", out_freqs_t));
+
+  // Filtered (not yet admitted) keys carry over from the base, minus any
+  // key the delta either updated (it is a real row now) or tombstoned.
+  if (base->Contains(name + "-keys_filtered")) {
+    Tensor fkeys_t, fversions_t, ffreqs_t;
+    TF_RETURN_IF_ERROR(ReadTensor(base, name + "-keys_filtered", &fkeys_t));
+    TF_RETURN_IF_ERROR(ReadTensorOrEmpty(base, name + "-versions_filtered",
+                                         DT_INT64, &fversions_t));
+    TF_RETURN_IF_ERROR(ReadTensorOrEmpty(base, name + "-freqs_filtered",
+                                         DT_INT64, &ffreqs_t));
+    std::unordered_set<K> dropped;
+    for (int64 i = 0; i < delta_keys.size(); ++i) dropped.insert(delta_keys(i));
+    for (int64 i = 0; i < tombstones.size(); ++i) dropped.insert(tombstones(i));
+
+    auto fkeys = fkeys_t.flat<K>();
+    const bool has_fversions = fversions_t.NumElements() > 0;
+    const bool has_ffreqs = ffreqs_t.NumElements() > 0;
+    std::vector<std::vector<int64>> fparts(kSavedPartitionNum);
+    for (int64 i = 0; i < fkeys.size(); ++i) {
+      int64 partid = fkeys(i) % kSavedPartitionNum;
+      if (partid < 0 || dropped.count(fkeys(i)) > 0) continue;
+      fparts[partid].push_back(i);
+    }
+    int64 num_fkeys = 0;
+    Tensor fpart_offset_t(DT_INT32, TensorShape({kSavedPartitionNum + 1}));
+    auto fpart_offset = fpart_offset_t.flat<int32>();
+    fpart_offset(0) = 0;
+    for (int partid = 0; partid < kSavedPartitionNum; ++partid) {
+      num_fkeys += fparts[partid].size();
+      fpart_offset(partid + 1) = fpart_offset(partid) + fparts[partid].size();
+    }
+    Tensor out_fkeys_t(fkeys_t.dtype(), TensorShape({num_fkeys}));
+    Tensor out_fversions_t(DT_INT64,
+                           TensorShape({has_fversions ? num_fkeys : 0}));
+    Tensor out_ffreqs_t(DT_INT64, TensorShape({has_ffreqs ? num_fkeys : 0}));
+    int64 out_fi = 0;
+    for (int partid = 0; partid < kSavedPartitionNum; ++partid) {
+      for (int64 i : fparts[partid]) {
+        out_fkeys_t.flat<K>()(out_fi) = fkeys(i);
+        if (has_fversions) {
+          out_fversions_t.flat<int64>()(out_fi) = fversions_t.flat<int64>()(i);
+        }
+        if (has_ffreqs) {
+          out_ffreqs_t.flat<int64>()(out_fi) = ffreqs_t.flat<int64>()(i);
+        }
+        ++out_fi;
+      }
+    }
+    TF_RETURN_IF_ERROR(
+        writer->Add(name + "-partition_filter_offset", fpart_offset_t));
+    TF_RETURN_IF_ERROR(writer->Add(name + "-keys_filtered", out_fkeys_t));
+    TF_RETURN_IF_ERROR(
+        writer->Add(name + "-versions_filtered", out_fversions_t));
+    TF_RETURN_IF_ERROR(writer->Add(name + "-freqs_filtered", out_ffreqs_t));
+  }
+
+  LOG(INFO) << name << ": " << base_keys.size() << " base rows + "
+            << delta_keys.size() << " delta rows - " << tombstones.size()
+            << " tombstones -> " << num_keys << " rows";
+  return Status::OK();
+}
+
+Status MergeIncrCheckpoint(const string& base_prefix,
+                           const string& incr_prefix,
+                           const string& output_prefix) {
+  Env* env = Env::Default();
+  BundleReader base(env, base_prefix);
+  TF_RETURN_IF_ERROR(base.status());
+  BundleReader delta(env, incr_prefix);
+  TF_RETURN_IF_ERROR(delta.status());
+  BundleWriter writer(env, output_prefix);
+
+  // Every "<name>-sparse_incr_keys" entry names a sparse variable to
+  // merge; all other delta entries are full dense copies that override
+  // the base wholesale.
+  std::set<string> sparse_names;
+  std::unordered_set<string> delta_entries;
+  delta.Seek(kHeaderEntryKey);
+  for (delta.Next(); delta.Valid(); delta.Next()) {
+    string key(delta.key());
+    delta_entries.insert(key);
+    if (str_util::EndsWith(key, kIncrKeysSuffix)) {
+      sparse_names.insert(
+          key.substr(0, key.size() - strlen(kIncrKeysSuffix)));
+    }
+  }
+
+  // Suffixes of base entries rewritten by the sparse merge, and of delta
+  // bookkeeping entries that must not leak into the merged checkpoint.
+  const std::vector<string> merged_suffixes = {
+      "-partition_offset", "-partition_filter_offset", "-keys", "-values",
+      "-versions", "-freqs", "-keys_filtered", "-versions_filtered",
+      "-freqs_filtered"};
+  auto owned_by_sparse_merge = [&](const string& key) {
+    for (const string& name : sparse_names) {
+      if (key.size() <= name.size() || key.compare(0, name.size(), name) != 0)
+        continue;
+      const string suffix = key.substr(name.size());
+      for (const string& s : merged_suffixes) {
+        if (suffix == s) return true;
+      }
+    }
+    return false;
+  };
+
+  for (const string& name : sparse_names) {
+    DataType key_dtype;
+    TensorShape unused;
+    TF_RETURN_IF_ERROR(
+        base.LookupDtypeAndShape(name + "-keys", &key_dtype, &unused));
+    if (key_dtype == DT_INT64) {
+      TF_RETURN_IF_ERROR(MergeSparseVariable<int64>(name, &base, &delta,
+                                                    &writer));
+    } else if (key_dtype == DT_INT32) {
+      TF_RETURN_IF_ERROR(MergeSparseVariable<int32>(name, &base, &delta,
+                                                    &writer));
+    } else {
+      return errors::Unimplemented(name, ": unsupported key dtype ",
+                                   DataTypeString(key_dtype));
+    }
+  }
+
+  // Dense tensors: the delta copy wins when present, the base copy is
+  // carried over otherwise.
+  std::unordered_set<string> written;
+  delta.Seek(kHeaderEntryKey);
+  for (delta.Next(); delta.Valid(); delta.Next()) {
+    string key(delta.key());
+    if (owned_by_sparse_merge(key)) continue;
+    bool is_delta_bookkeeping = false;
+    for (const char* s : {kIncrKeysSuffix, kIncrValuesSuffix,
+                          kIncrVersionsSuffix, kIncrFreqsSuffix,
+                          kIncrTombstonesSuffix, kIncrPartOffsetSuffix}) {
+      if (str_util::EndsWith(key, s)) {
+        is_delta_bookkeeping = true;
+        break;
+      }
+    }
+    if (is_delta_bookkeeping) continue;
+    Tensor val;
+    TF_RETURN_IF_ERROR(ReadTensor(&delta, key, &val));
+    TF_RETURN_IF_ERROR(writer.Add(key, val));
+    written.insert(key);
+  }
+  base.Seek(kHeaderEntryKey);
+  for (base.Next(); base.Valid(); base.Next()) {
+    string key(base.key());
+    if (owned_by_sparse_merge(key) || written.count(key) > 0) continue;
+    Tensor val;
+    TF_RETURN_IF_ERROR(ReadTensor(&base, key, &val));
+    TF_RETURN_IF_ERROR(writer.Add(key, val));
+  }
+
+  return writer.Finish();
+}
+
+int Main(int argc, char** argv) {
+  string base_prefix;
+  string incr_prefix;
+  string output_prefix;
+  std::vector<Flag> flag_list = {
+      Flag("base_prefix", &base_prefix,
+           "full checkpoint prefix; defaults to the contents of "
+           "<incr_prefix>.base"),
+      Flag("incr_prefix", &incr_prefix, "incremental checkpoint prefix"),
+      Flag("output_prefix", &output_prefix, "merged checkpoint prefix"),
+  };
+  const string usage = Flags::Usage(argv[0], flag_list);
+  if (!Flags::Parse(&argc, argv, flag_list) || incr_prefix.empty() ||
+      output_prefix.empty()) {
+    LOG(ERROR) << usage;
+    return -1;
+  }
+  port::InitMain(argv[0], &argc, &argv);
+
+  if (base_prefix.empty()) {
+    Status s = ReadFileToString(Env::Default(), incr_prefix + ".base",
+                                &base_prefix);
+    if (!s.ok()) {
+      LOG(ERROR) << "--base_prefix not set and " << incr_prefix
+                 << ".base is unreadable: " << s;
+      return -1;
+    }
+  }
+
+  Status s = MergeIncrCheckpoint(base_prefix, incr_prefix, output_prefix);
+  if (!s.ok()) {
+    LOG(ERROR) << "Merge failed: " << s;
+    return -1;
+  }
+  LOG(INFO) << "Merged " << base_prefix << " + " << incr_prefix << " -> "
+            << output_prefix;
+  return 0;
+}
+
+}  // namespace
+}  // namespace tensorflow
+
+int main(int argc, char** argv) { return tensorflow::Main(argc, argv); }